@@ -52,6 +52,7 @@ Application::~Application()
 int Application::execute(CommandLine commandLine)
 {
     sn::Log::get().openFile("snowfeet_log.txt");
+    sn::Log::get().startAsync();
 
     SN_LOG("Enter execute()");
 
@@ -72,6 +73,8 @@ int Application::execute(CommandLine commandLine)
 
     SN_LOG("Exit execute()");
 
+    sn::Log::get().stopAsync();
+
     return exitCode;
 }
 
@@ -159,22 +162,27 @@ int Application::executeEx()
         SystemGUI::processEvents();
         Joystick::updateJoysticks();
 
-        Event ev;
-        while (SystemGUI::get().popEvent(ev))
+        Event events[64];
+        u32 eventCount = 0;
+        while ((eventCount = SystemGUI::get().popEvents(events, 64)) != 0)
         {
-            // Forward event to the scene
-            if (!m_scene->onSystemEvent(ev))
+            for (u32 i = 0; i < eventCount; ++i)
             {
-                // If the event has not been handled, perform default actions
-                if (ev.type == SN_EVENT_WINDOW_ASKED_CLOSE)
-                    quit();
-            }
+                const Event & ev = events[i];
+                // Forward event to the scene
+                if (!m_scene->onSystemEvent(ev))
+                {
+                    // If the event has not been handled, perform default actions
+                    if (ev.type == SN_EVENT_WINDOW_ASKED_CLOSE)
+                        quit();
+                }
 #ifdef SN_BUILD_DEBUG
-            if (ev.type == SN_EVENT_KEY_DOWN && ev.keyboard.keyCode == SN_KEY_F3)
-            {
-                printDebugInfo = true;
-            }
+                if (ev.type == SN_EVENT_KEY_DOWN && ev.keyboard.keyCode == SN_KEY_F3)
+                {
+                    printDebugInfo = true;
+                }
 #endif
+            }
         }
 
         AssetDatabase::get().updateFileChanges();
@@ -508,13 +508,15 @@ void AssetDatabase::updateFileChanges()
     if (m_rootWatcher.isEnabled())
     {
         // TODO What if an asset saves itself upon reloading? Infinite loop?
-        FileWatcher::Event event;
-        while (m_rootWatcher.popEvent(event))
+        std::vector<FileWatcher::Event> events;
+        m_rootWatcher.popEvents(events, 256);
+        for (auto it = events.begin(); it != events.end(); ++it)
         {
+            const FileWatcher::Event & event = *it;
             switch (event.type)
             {
             case FileWatcher::FILE_MODIFIED:
-                // TODO win32: two events are received when the asset is saved (CTRL+S). Need to filter the second one!
+                // Note: duplicate events (like the two received on win32 when saving) are coalesced by the watcher
                 SN_DLOG("Received file change: " << event.path);
                 loadIndexedAssetsByPath(FilePath::join(toString(m_root), event.path));
                 break;
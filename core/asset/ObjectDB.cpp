@@ -28,8 +28,10 @@ const char * ObjectDB::ROOT_ID_TAG    = "root";
 //------------------------------------------------------------------------------
 ObjectDB::ObjectDB():
     m_nextID(0),
+    m_loadedNextID(0),
     m_rootID(NO_ROOT),
-    m_isFlattened(false)
+    m_isFlattened(false),
+    m_revision(0)
 {
 }
 
@@ -55,6 +57,7 @@ bool ObjectDB::loadFromVariant(Variant & doc)
     clear();
 
     m_nextID = nextID;
+    m_loadedNextID = nextID;
 
     // Get root ID
     Variant rootIDElem = doc[ROOT_ID_TAG];
@@ -186,19 +189,25 @@ void ObjectDB::clear()
 {
     m_objects.clear();
     m_overridedObjects.clear();
+    m_instanceIDs.clear();
+    m_sources.clear();
     m_nextID = 0;
+    m_loadedNextID = 0;
     m_rootID = NO_ROOT;
     m_isFlattened = false;
+    ++m_revision;
 }
 
 //------------------------------------------------------------------------------
 void ObjectDB::clearInstances()
 {
-    for (auto it = m_overridedObjects.begin(); it != m_overridedObjects.end(); ++it)
+    for (auto it = m_instanceIDs.begin(); it != m_instanceIDs.end(); ++it)
     {
-        u32 id = it->first;
-        m_objects.erase(id);
+        m_objects.erase(*it);
     }
+    m_instanceIDs.clear();
+    m_sources.clear();
+    m_nextID = m_loadedNextID;
 }
 
 //------------------------------------------------------------------------------
@@ -336,7 +345,18 @@ const Variant * ObjectDB::getRootObject() const
 //------------------------------------------------------------------------------
 bool ObjectDB::isFlattened()
 {
-    return m_isFlattened;
+    if (!m_isFlattened)
+        return false;
+
+    // Check if sources changed since we instantiated them
+    for (auto it = m_sources.begin(); it != m_sources.end(); ++it)
+    {
+        const SourceRef & ref = *it;
+        if (ref.db.get()->m_revision != ref.revision || !ref.db.get()->isFlattened())
+            return false;
+    }
+
+    return true;
 }
 
 //------------------------------------------------------------------------------
@@ -368,6 +388,9 @@ void ObjectDB::flatten(std::vector<ObjectDB*> & stack)
 
     m_isFlattened = false;
 
+    // Remove results of the previous flattening, if any
+    clearInstances();
+
     for (auto ooIt = m_overridedObjects.begin(); ooIt != m_overridedObjects.end(); ++ooIt)
     {
         u32 id = ooIt->first;
@@ -377,6 +400,7 @@ void ObjectDB::flatten(std::vector<ObjectDB*> & stack)
     }
 
     m_isFlattened = true;
+    ++m_revision;
 
     // DEBUG CODE: writes the objects after flattening in human-readable file
     //if (m_objects.size() > 10)
@@ -430,8 +454,20 @@ bool ObjectDB::flattenObject(OverrideObject & overrideObj, u32 id, std::vector<O
 		stack.push_back(this);
 		src->flatten(stack);
 		stack.pop_back();
+
+        if (!src->m_isFlattened)
+        {
+            // Flattening failed (cycle)
+            return false;
+        }
     }
 
+    // Remember it, so we know when to flatten again
+    SourceRef ref;
+    ref.db.set(src);
+    ref.revision = src->m_revision;
+    m_sources.push_back(ref);
+
     // Get its root object
     const Variant * srcObj = src->getRootObject();
     if (srcObj == nullptr)
@@ -450,6 +486,7 @@ bool ObjectDB::flattenObject(OverrideObject & overrideObj, u32 id, std::vector<O
         u32 instanceID = it->first == src->m_rootID ? id : makeID();
         Object & obj = m_objects[instanceID];
         obj.data = it->second.data;
+        m_instanceIDs.push_back(instanceID);
 
         srcToInstanceID[it->first] = instanceID;
     }
@@ -5,6 +5,7 @@
 #include <vector>
 #include <unordered_map>
 #include <core/asset/Asset.h>
+#include <core/util/SharedRef.h>
 
 namespace sn
 {
@@ -79,9 +80,15 @@ protected:
 
     const std::unordered_map<u32, ObjectDB::Object> & getObjects() const { return m_objects; }
 
+    /// \brief Tells if flattened data is available and up to date with its sources.
+    /// If a source database was reloaded or re-flattened since, this returns false.
     bool isFlattened();
 	void flatten();
 
+    /// \brief Gets a number that changes each time the flattened data of this database changes.
+    /// It can be used to invalidate data cached from it.
+    inline u32 getRevision() const { return m_revision; }
+
 private:
     struct Modification;
     struct OverrideObject;
@@ -126,6 +133,14 @@ private:
         std::vector<Modification> overrides;
     };
 
+    struct SourceRef
+    {
+        // Database instantiated during flattening, kept alive as long as we depend on it
+        SharedRef<ObjectDB> db;
+        // Its revision at the time it was instantiated
+        u32 revision;
+    };
+
 private:
     //---------------------------------------------
     // Fields
@@ -133,6 +148,8 @@ private:
 
     /// \brief Next ID to be generated when an object is added
     u32 m_nextID;
+    /// \brief Value of m_nextID after loading, restored when flattening again
+    u32 m_loadedNextID;
     /// \brief ID of the main object
     u32 m_rootID;
 
@@ -141,8 +158,17 @@ private:
     /// \brief Ready-to-use flattened object data
     std::unordered_map<u32, Object> m_objects;
 
+    /// \brief IDs of the objects created by flattening, in m_objects
+    std::vector<u32> m_instanceIDs;
+
+    /// \brief Databases the flattened data was made from
+    std::vector<SourceRef> m_sources;
+
     /// \brief Tells if the file has been flattened (so instances are available as ready objects)
     bool m_isFlattened;
+
+    /// \brief Incremented each time the flattened data changes
+    u32 m_revision;
 };
 
 } // namespace sn
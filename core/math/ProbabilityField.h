@@ -8,7 +8,9 @@ This file is part of the SnowfeetEngine project.
 #define __HEADER_SN_PROBABILITY_FIELD__
 
 #include <core/util/Log.h>
+#include <core/math/Random.h>
 #include <vector>
+#include <algorithm>
 
 namespace sn
 {
@@ -22,7 +24,21 @@ class ProbabilityField
 {
 public:
 
-    ProbabilityField(): m_needCompile(true)
+    /// \brief How picks are computed after frequencies changed
+    enum PickMethod
+    {
+        /// \brief Alias table (Vose's method): O(1) picks, but a bit slower to compile.
+        /// Best for fields that are picked from a lot more often than they change.
+        PICK_ALIAS = 0,
+        /// \brief Binary search in cumulated frequencies: O(log(N)) picks, cheaper to compile.
+        /// Best for fields that change almost every time they are picked from.
+        PICK_CUMULATIVE
+    };
+
+    ProbabilityField(PickMethod method = PICK_ALIAS):
+        m_method(method),
+        m_needCompile(true),
+        m_lastNonZero(0)
     {}
 
     inline u32 size() const
@@ -30,85 +46,282 @@ public:
         return m_frequencies.size();
     }
 
+    void setPickMethod(PickMethod method)
+    {
+        if (method != m_method)
+        {
+            m_method = method;
+            m_needCompile = true;
+        }
+    }
+
+    inline PickMethod getPickMethod() const { return m_method; }
+
+    /// \brief Sets the frequency of an event. The field grows if needed.
+    /// Frequencies don't have to sum up to 1, they are relative to each other.
     void setFrequency(u32 eventIndex, f32 chance)
     {
-        if (eventIndex < m_frequencies.size())
+        if (eventIndex >= m_frequencies.size())
         {
             m_frequencies.resize(eventIndex + 1, 0);
-            m_cumul.resize(m_frequencies.size() + 1);
         }
 
         m_frequencies[eventIndex] = chance;
         m_needCompile = true;
     }
 
-    f32 getFrequency(u32 eventIndex)
+    /// \brief Gets the frequency of an event, as it was set
+    f32 getFrequency(u32 eventIndex) const
     {
         return m_frequencies[eventIndex];
     }
 
+    /// \brief Picks an event from a number in [0, 1[.
+    /// \note With alias tables, close numbers don't necessarily give close events.
     u32 pick(float p)
     {
-        if (m_needCompile)
+        compileIfNeeded();
+
+        u32 n = m_frequencies.size();
+        if (n == 0)
+            return 0;
+
+        if (m_method == PICK_ALIAS)
         {
-            compile();
-            m_needCompile = false;
+            f32 scaled = p * static_cast<f32>(n);
+            u32 i = static_cast<u32>(scaled);
+            if (i >= n)
+                i = n - 1;
+            return pickAlias(i, scaled - static_cast<f32>(i));
+        }
+        else
+        {
+            return pickCumulative(p);
+        }
+    }
+
+    /// \brief Picks an event using a random generator.
+    /// With alias tables, this is more precise than pick(float) for large fields,
+    /// because the column and the coin use separate random numbers.
+    u32 pick(Random & rng)
+    {
+        compileIfNeeded();
+
+        u32 n = m_frequencies.size();
+        if (n == 0)
+            return 0;
+
+        if (m_method == PICK_ALIAS)
+        {
+            // Note: separate statements, the evaluation order of arguments is unspecified
+            u32 column = rng.nextBounded(n);
+            f32 coin = rng.nextFloat();
+            return pickAlias(column, coin);
+        }
+        else
+        {
+            return pickCumulative(rng.nextFloat());
         }
+    }
 
-        float t = p;
+    /// \brief Picks several events at once.
+    /// Gives the same results as calling pick(rng) count times.
+    void pick(Random & rng, u32 * out_events, u32 count)
+    {
+        compileIfNeeded();
+
+        u32 n = m_frequencies.size();
+        if (n == 0)
+        {
+            std::fill(out_events, out_events + count, 0);
+            return;
+        }
 
-        for (int i = 1; i < m_cumul.size(); ++i)
+        // Work on a local copy of the generator so its state can stay in registers
+        Random r = rng;
+        if (m_method == PICK_ALIAS)
+        {
+            const f32 * probabilities = &m_aliasProbabilities[0];
+            const u32 * aliases = &m_aliases[0];
+            for (u32 i = 0; i < count; ++i)
+            {
+                u32 column = r.nextBounded(n);
+                f32 coin = r.nextFloat();
+                out_events[i] = coin < probabilities[column] ? column : aliases[column];
+            }
+        }
+        else
         {
-            if (t >= m_cumul[i - 1] && t < m_cumul[i])
-                return i - 1;
+            for (u32 i = 0; i < count; ++i)
+                out_events[i] = pickCumulative(r.nextFloat());
         }
+        rng = r;
+    }
 
-        return m_frequencies.size() - 1;
+    /// \brief Builds the internal representation now instead of at the next pick.
+    void compileIfNeeded()
+    {
+        if (m_needCompile)
+        {
+            compile();
+            m_needCompile = false;
+        }
     }
 
 private:
 
+    inline u32 pickAlias(u32 column, f32 coin) const
+    {
+        return coin < m_aliasProbabilities[column] ? column : m_aliases[column];
+    }
+
+    inline u32 pickCumulative(f32 p) const
+    {
+        // Note: cumul[0] always == 0, and cumul[length-1] always == 1.
+        // Finds i such as cumul[i] <= p < cumul[i+1], which skips events of null frequency.
+        const f32 * begin = &m_cumul[1];
+        const f32 * end = begin + m_frequencies.size();
+        u32 i = static_cast<u32>(std::upper_bound(begin, end, p) - begin);
+        if (i >= m_frequencies.size())
+        {
+            // Happens if p >= 1, or due to rounding errors near 1
+            i = m_lastNonZero;
+        }
+        return i;
+    }
+
     void compile()
     {
-        normalize();
+        u32 n = m_frequencies.size();
+        if (n == 0)
+            return;
+
+        f64 sum = 0;
+        m_lastNonZero = 0;
+        for (u32 i = 0; i < n; ++i)
+        {
+            if (m_frequencies[i] > 0)
+            {
+                sum += m_frequencies[i];
+                m_lastNonZero = i;
+            }
+        }
+
+        if (sum <= 0)
+        {
+            SN_ERROR("ProbabilityField: all values are set to zero!");
+            // Fallback on a uniform distribution
+            sum = n;
+            m_tempScaled.assign(n, 1.0);
+        }
+        else
+        {
+            m_tempScaled.resize(n);
+            for (u32 i = 0; i < n; ++i)
+                m_tempScaled[i] = m_frequencies[i] > 0 ? m_frequencies[i] : 0;
+        }
+
+        if (m_method == PICK_ALIAS)
+            compileAlias(sum);
+        else
+            compileCumulative(sum);
+    }
 
-        // Note: cumul[0] always == 0, and cumul[length-1] always == 1
+    void compileCumulative(f64 sum)
+    {
+        u32 n = m_frequencies.size();
+        m_cumul.resize(n + 1);
 
-        for (int i = 0; i < m_frequencies.size(); ++i)
+        f64 cumul = 0;
+        m_cumul[0] = 0;
+        for (u32 i = 0; i < n; ++i)
         {
-            m_cumul[i + 1] = m_cumul[i] + m_frequencies[i];
+            cumul += m_tempScaled[i];
+            m_cumul[i + 1] = static_cast<f32>(cumul / sum);
         }
     }
 
-    void normalize()
+    void compileAlias(f64 sum)
     {
-        float sum = 0;
+        // Vose's alias method:
+        // each of the N columns holds the probability of its own event,
+        // and the rest is given to another event (its alias), so that all columns sum up to 1/N.
+        u32 n = m_frequencies.size();
+        m_aliasProbabilities.resize(n);
+        m_aliases.resize(n);
+        m_tempSmall.clear();
+        m_tempLarge.clear();
 
-        for (int i = 0; i < m_frequencies.size(); ++i)
+        std::vector<f64> & scaled = m_tempScaled;
+        for (u32 i = 0; i < n; ++i)
         {
-            sum += m_frequencies[i];
+            scaled[i] = scaled[i] * static_cast<f64>(n) / sum;
+            if (scaled[i] < 1.0)
+                m_tempSmall.push_back(i);
+            else
+                m_tempLarge.push_back(i);
         }
 
-        if (sum != 0)
+        while (!m_tempSmall.empty() && !m_tempLarge.empty())
         {
-            for (int i = 0; i < m_frequencies.size(); ++i)
+            u32 small = m_tempSmall.back();
+            m_tempSmall.pop_back();
+            u32 large = m_tempLarge.back();
+
+            m_aliasProbabilities[small] = static_cast<f32>(scaled[small]);
+            m_aliases[small] = large;
+
+            // The large event fills the rest of the small column
+            scaled[large] = (scaled[large] + scaled[small]) - 1.0;
+            if (scaled[large] < 1.0)
             {
-                m_frequencies[i] /= sum;
+                m_tempLarge.pop_back();
+                m_tempSmall.push_back(large);
             }
         }
+
+        // Remaining columns are full (up to rounding errors)
+        for (u32 i = 0; i < m_tempLarge.size(); ++i)
+            setLeftoverAliasColumn(m_tempLarge[i]);
+        for (u32 i = 0; i < m_tempSmall.size(); ++i)
+            setLeftoverAliasColumn(m_tempSmall[i]);
+    }
+
+    void setLeftoverAliasColumn(u32 e)
+    {
+        if (m_tempScaled[e] > 0)
+        {
+            m_aliasProbabilities[e] = 1.f;
+            m_aliases[e] = e;
+        }
         else
         {
-            SN_ERROR("ProbabilityField: all values are set to zero!");
+            // An event of zero frequency must never be picked,
+            // even if rounding errors left its column unfilled
+            m_aliasProbabilities[e] = 0.f;
+            m_aliases[e] = m_lastNonZero;
         }
     }
 
+    PickMethod m_method;
     bool m_needCompile;
-    std::vector<f32> m_frequencies; // [N]
-    std::vector<f32> m_cumul; // [N + 1];
+    std::vector<f32> m_frequencies; // [N], as given by the user
+
+    // Cumulative method
+    std::vector<f32> m_cumul; // [N + 1], normalized
+    u32 m_lastNonZero;
+
+    // Alias method
+    std::vector<f32> m_aliasProbabilities; // [N]
+    std::vector<u32> m_aliases; // [N]
+
+    // Temporary data kept to avoid reallocations when re-compiling
+    std::vector<f64> m_tempScaled;
+    std::vector<u32> m_tempSmall;
+    std::vector<u32> m_tempLarge;
 
 };
 
 } // namespace sn
 
 #endif // __HEADER_SN_PROBABILITY_FIELD__
-
@@ -0,0 +1,194 @@
+/*
+Random.cpp
+Copyright (C) 2015-2015 Marc GILLERON
+This file is part of the SnowfeetEngine project.
+*/
+
+#include <core/math/Random.h>
+#include <core/system/ThreadLocal.h>
+#include <core/system/Lock.h>
+#include <vector>
+
+namespace sn
+{
+
+namespace
+{
+    // Spreads consecutive numbers over the whole 64-bit range (SplitMix64 finalizer),
+    // so numbered streams don't have related increments
+    inline u64 mix64(u64 x)
+    {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    inline u32 mix32(u32 x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352dU;
+        x ^= x >> 15;
+        x *= 0x846ca68bU;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // Generators used by math::rand() and the like, one per thread
+    struct ThreadDefaults
+    {
+        ThreadLocal current;
+        Mutex mutex;
+        // Owned generators of all threads that used one.
+        // Note: they are only freed at exit, ThreadLocal can't tell when a thread ends.
+        std::vector<Random*> generators;
+        u64 seed;
+        u64 nextStreamIndex;
+
+        ThreadDefaults():
+            seed(Random::DEFAULT_SEED),
+            nextStreamIndex(0)
+        {}
+
+        ~ThreadDefaults()
+        {
+            for (size_t i = 0; i < generators.size(); ++i)
+                delete generators[i];
+        }
+    };
+
+    ThreadDefaults g_threadDefaults;
+}
+
+//------------------------------------------------------------------------------
+Random::Random()
+{
+    seed(DEFAULT_SEED, DEFAULT_STREAM);
+}
+
+//------------------------------------------------------------------------------
+Random::Random(u64 seedValue, u64 stream)
+{
+    seed(seedValue, stream);
+}
+
+//------------------------------------------------------------------------------
+void Random::seed(u64 seedValue, u64 stream)
+{
+    m_state = 0;
+    m_increment = (stream << 1u) | 1u;
+    next();
+    m_state += seedValue;
+    next();
+}
+
+//------------------------------------------------------------------------------
+void Random::advance(u64 delta)
+{
+    // Jump-ahead for LCGs (Brown, "Random Number Generation with Arbitrary Stride"):
+    // composes the state transition with itself by squaring.
+    u64 accMult = 1;
+    u64 accPlus = 0;
+    u64 curMult = MULTIPLIER;
+    u64 curPlus = m_increment;
+    while (delta > 0)
+    {
+        if (delta & 1)
+        {
+            accMult *= curMult;
+            accPlus = accPlus * curMult + curPlus;
+        }
+        curPlus = (curMult + 1) * curPlus;
+        curMult *= curMult;
+        delta >>= 1;
+    }
+    m_state = accMult * m_state + accPlus;
+}
+
+//------------------------------------------------------------------------------
+Random Random::split()
+{
+    u64 newSeed = (static_cast<u64>(next()) << 32) | next();
+    u64 newStream = (static_cast<u64>(next()) << 32) | next();
+    return Random(newSeed, newStream);
+}
+
+//------------------------------------------------------------------------------
+Random Random::forStream(u64 seedValue, u64 streamIndex)
+{
+    return Random(seedValue, mix64(streamIndex));
+}
+
+//------------------------------------------------------------------------------
+// Note: fill functions work on a local copy so the compiler can keep the state in registers
+void Random::fill(u32 * out_values, size_t count)
+{
+    Random r = *this;
+    for (size_t i = 0; i < count; ++i)
+        out_values[i] = r.next();
+    *this = r;
+}
+
+//------------------------------------------------------------------------------
+void Random::fill(f32 * out_values, size_t count)
+{
+    Random r = *this;
+    for (size_t i = 0; i < count; ++i)
+        out_values[i] = r.nextFloat();
+    *this = r;
+}
+
+//------------------------------------------------------------------------------
+void Random::fill(f32 * out_values, size_t count, f32 min, f32 max)
+{
+    Random r = *this;
+    for (size_t i = 0; i < count; ++i)
+        out_values[i] = r.rangef(min, max);
+    *this = r;
+}
+
+//------------------------------------------------------------------------------
+void Random::fill(s32 * out_values, size_t count, s32 min, s32 max)
+{
+    Random r = *this;
+    for (size_t i = 0; i < count; ++i)
+        out_values[i] = r.range(min, max);
+    *this = r;
+}
+
+//------------------------------------------------------------------------------
+u32 Random::hash(u32 seedValue, s32 x, s32 y)
+{
+    u32 h = mix32(seedValue ^ (static_cast<u32>(x) * 0x9e3779b1U));
+    return mix32(h ^ (static_cast<u32>(y) * 0x85ebca77U));
+}
+
+//------------------------------------------------------------------------------
+Random & Random::getThreadDefault()
+{
+    Random * r = static_cast<Random*>(g_threadDefaults.current.get());
+    if (r == nullptr)
+    {
+        Lock lock(g_threadDefaults.mutex);
+        r = new Random(g_threadDefaults.seed, mix64(g_threadDefaults.nextStreamIndex++));
+        g_threadDefaults.generators.push_back(r);
+        g_threadDefaults.current.set(r);
+    }
+    return *r;
+}
+
+//------------------------------------------------------------------------------
+void Random::setThreadDefaultSeed(u64 seedValue)
+{
+    Random & r = getThreadDefault();
+
+    Lock lock(g_threadDefaults.mutex);
+    g_threadDefaults.seed = seedValue;
+    // The calling thread takes the first stream, so a seeded single-threaded program
+    // always gets the same sequence
+    g_threadDefaults.nextStreamIndex = 1;
+    r.seed(seedValue, mix64(0));
+}
+
+} // namespace sn
+
@@ -0,0 +1,146 @@
+/*
+Random.h
+Copyright (C) 2015-2015 Marc GILLERON
+This file is part of the SnowfeetEngine project.
+*/
+
+#ifndef __HEADER_SN_RANDOM__
+#define __HEADER_SN_RANDOM__
+
+#include <core/types.h>
+#include <cstddef>
+
+namespace sn
+{
+
+/// \brief Small and fast pseudo-random number generator (PCG32, XSH-RR variant).
+/// Unlike C rand(), it has no hidden global state: each instance is an independent generator
+/// that can be owned by a system, a thread or a task, which makes results reproducible.
+/// A generator is defined by a seed and a stream: two generators with the same seed
+/// but different streams produce uncorrelated sequences.
+/// \note Not thread-safe, each thread should use its own instance.
+class SN_API Random
+{
+public:
+    static const u64 DEFAULT_SEED = 0x853c49e6748fea9bULL;
+    static const u64 DEFAULT_STREAM = 0xda3e39cb94b95bdbULL;
+
+    Random();
+    explicit Random(u64 seed, u64 stream = DEFAULT_STREAM);
+
+    /// \brief Restarts the sequence from a seed, on the given stream.
+    void seed(u64 seed, u64 stream = DEFAULT_STREAM);
+
+    /// \brief Generates a uniformly distributed 32-bit number.
+    inline u32 next()
+    {
+        u64 old = m_state;
+        m_state = old * MULTIPLIER + m_increment;
+        u32 xorShifted = static_cast<u32>(((old >> 18u) ^ old) >> 27u);
+        u32 rot = static_cast<u32>(old >> 59u);
+        return (xorShifted >> rot) | (xorShifted << ((~rot + 1u) & 31));
+    }
+
+    /// \brief Generates a number in [0, bound[ without modulo bias.
+    /// \return 0 if bound is 0.
+    inline u32 nextBounded(u32 bound)
+    {
+        // Lemire's multiply-shift, with rejection of the few values that would bias the result
+        u64 m = static_cast<u64>(next()) * bound;
+        u32 low = static_cast<u32>(m);
+        if (low < bound)
+        {
+            u32 threshold = (~bound + 1u) % bound;
+            while (low < threshold)
+            {
+                m = static_cast<u64>(next()) * bound;
+                low = static_cast<u32>(m);
+            }
+        }
+        return static_cast<u32>(m >> 32);
+    }
+
+    /// \brief Generates a number in [min, max[.
+    /// \return min if max <= min.
+    inline s32 range(s32 min, s32 max)
+    {
+        if (max <= min)
+            return min;
+        return min + static_cast<s32>(nextBounded(static_cast<u32>(max - min)));
+    }
+
+    /// \brief Generates a number in [0, 1[ with 24 bits of precision.
+    inline f32 nextFloat()
+    {
+        return static_cast<f32>(next() >> 8) * (1.f / 16777216.f);
+    }
+
+    /// \brief Generates a number in [min, max[.
+    inline f32 rangef(f32 min, f32 max)
+    {
+        return min + nextFloat() * (max - min);
+    }
+
+    /// \brief Returns true with the given probability (between 0 and 1).
+    inline bool chance(f32 probability)
+    {
+        return nextFloat() < probability;
+    }
+
+    /// \brief Moves the generator forward as if next() was called delta times,
+    /// in O(log(delta)) time. Can be used to give distinct sub-sequences to parallel tasks.
+    void advance(u64 delta);
+
+    /// \brief Creates a new generator on a different stream, seeded from this one.
+    /// This advances the current generator.
+    Random split();
+
+    /// \brief Gets the generator of a numbered stream derived from a common seed.
+    /// Parallel code should give one stream to each unit of work (row, chunk...) instead of
+    /// one to each thread, so the results don't depend on how work is distributed.
+    static Random forStream(u64 seed, u64 streamIndex);
+
+    /// \brief Fills an array with the same numbers successive calls to next() would give.
+    void fill(u32 * out_values, size_t count);
+    /// \brief Fills an array with numbers in [0, 1[, as nextFloat() would give.
+    void fill(f32 * out_values, size_t count);
+    /// \brief Fills an array with numbers in [min, max[, as rangef() would give.
+    void fill(f32 * out_values, size_t count, f32 min, f32 max);
+    /// \brief Fills an array with numbers in [min, max[, as range() would give.
+    void fill(s32 * out_values, size_t count, s32 min, s32 max);
+
+    /// \brief Stateless hash of a seed and a 2D position, useful to pick random things
+    /// on a grid in any order (the result doesn't depend on which cells were processed before).
+    static u32 hash(u32 seed, s32 x, s32 y);
+
+    /// \brief Gets the generator of the calling thread, used by math::rand() and friends.
+    /// Threads get their own stream when they first call this function.
+    static Random & getThreadDefault();
+
+    /// \brief Reseeds the generator of the calling thread, and sets the seed
+    /// used for threads that didn't use their generator yet.
+    static void setThreadDefaultSeed(u64 seed);
+
+    inline bool operator==(const Random & other) const
+    {
+        return m_state == other.m_state && m_increment == other.m_increment;
+    }
+
+    inline bool operator!=(const Random & other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    static const u64 MULTIPLIER = 6364136223846793005ULL;
+
+    u64 m_state;
+    // Always odd. Selects the stream.
+    u64 m_increment;
+
+};
+
+} // namespace sn
+
+#endif // __HEADER_SN_RANDOM__
+
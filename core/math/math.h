@@ -12,6 +12,7 @@ This file is part of the SnowfeetEngine.
 #include <cstdlib>
 #include <ctime>
 #include <core/types.h>
+#include <core/math/Random.h>
 
 namespace sn {
 namespace math {
@@ -108,35 +109,37 @@ inline const T & clamp(const T & x, const T & min, const T & max)
 /// \brief Initializes the random seed used by math random functions
 inline void randomSeed()
 {
-    std::srand(static_cast<u32>(std::time(nullptr)));
+    Random::setThreadDefaultSeed(static_cast<u64>(std::time(nullptr)));
 }
 
-/// \brief Sets a specific seed for math random functions
+/// \brief Sets a specific seed for math random functions.
+/// \note Random functions use one generator per thread, this only reseeds the calling one
+/// and the ones of threads that didn't generate anything yet.
 inline void randomSeed(s32 seed)
 {
-    std::srand(seed);
+    Random::setThreadDefaultSeed(static_cast<u64>(seed));
 }
 
 /// \brief Generates random numbers in [min, max[
-/// \note This function uses C rand().
+/// \note This function uses the calling thread's default generator.
 /// \param min : minimum value. Assumed to be < max.
 /// \param max : maximum value + 1. Assumed to be > min.
-/// \return pseudo-random number between min and max (max excluded).
+/// \return pseudo-random number between min and max (max excluded), or min if max <= min.
 inline int rand(s32 min, s32 max)
 {
-    return min + std::rand() % (max - min);
+    return Random::getThreadDefault().range(min, max);
 }
 
 /// \brief Generates random numbers in [0.f, 1.f]
-/// \note this is a quick-to-use function, but not a good random generator.
+/// \note This function uses the calling thread's default generator.
 /// \return pseudo-random floating number between 0 and 1
 inline f32 randf()
 {
-    return static_cast<f32>(std::rand()) / static_cast<f32>(RAND_MAX);
+    return static_cast<f32>(Random::getThreadDefault().next() >> 8) * (1.f / 16777215.f);
 }
 
 /// \brief Generates random numbers in [min, max].
-/// \note this is a quick-to-use function, but not a good random generator.
+/// \note This function uses the calling thread's default generator.
 /// \param min : minimum value. Assumed to be < max.
 /// \param max : maximum value. Assumed to be > min.
 /// \return pseudorandom number between min and max
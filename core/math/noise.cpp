@@ -6,9 +6,17 @@ This file is part of the SnowfeetEngine project.
 
 #include <cmath>
 #include <iostream>
+#include <vector>
+#include <algorithm>
 
 #include <core/math/noise.h>
 #include <core/math/interpolation.h>
+#include <core/system/parallel.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SN_NOISE_SSE2
+    #include <emmintrin.h>
+#endif
 
 // set at random
 #define RAND_SEQ_X 72699
@@ -152,7 +160,420 @@ f32 noise3dPerlin(
     return noise / ampMax;
 }
 
-} // namespace sn
+//==============================================================================
+// Batch generation
+//==============================================================================
+
+/*
+    Batch functions must give the same results as the scalar ones, bit for bit.
+    So they perform exactly the same floating point operations in the same order,
+    they only avoid doing them more than once:
+    - Coordinates along X and their interpolation factors are the same for every row
+    - Lattice values are computed once per lattice line and shared by all samples
+      between two lattice points, and by consecutive rows
+*/
+
+namespace
+{
+    // Same as the integer part computation in noise*Gradient()
+    inline s32 latticeCoord(f32 x)
+    {
+        return x > 0.0 ? (s32)x : (s32)x - 1;
+    }
+
+    // Samples of one octave along the X axis, the same for every row
+    struct OctaveAxis
+    {
+        s32 seed;
+        f32 f;
+        f32 amp;
+        // Lattice lines start at this coordinate
+        s32 x0Min;
+        u32 lineLength;
+        // False if lines would be longer than rows (high frequencies),
+        // in which case samples are evaluated one by one
+        bool useLines;
+        // For each sample: position of the lattice cell in lines, interpolation factor and coordinate
+        std::vector<s32> cellIndex;
+        std::vector<f32> tx;
+        std::vector<f32> xf;
+    };
+
+    struct PerlinSetup
+    {
+        std::vector<OctaveAxis> octaves;
+        f32 period;
+        f32 ampMax;
+    };
+
+    //--------------------------------------------------------------------------
+    void makePerlinSetup(PerlinSetup & setup, u32 sizeX, f32 originX, s32 seed, s32 octaves, f32 persistence, f32 period, bool smooth)
+    {
+        setup.period = period;
+
+        std::vector<f32> xs(sizeX);
+        for (u32 ix = 0; ix < sizeX; ++ix)
+        {
+            f32 x = originX + (f32)ix;
+            x /= period;
+            xs[ix] = x;
+        }
+
+        f32 f = 1.0;
+        f32 amp = 1.0;
+        f32 ampMax = 0;
+
+        setup.octaves.resize(octaves);
+        for (s32 i = 0; i < octaves; ++i)
+        {
+            OctaveAxis & oa = setup.octaves[i];
+            oa.seed = seed + i;
+            oa.f = f;
+            oa.amp = amp;
+            oa.xf.resize(sizeX);
+            oa.tx.resize(sizeX);
+            oa.cellIndex.resize(sizeX);
+
+            for (u32 ix = 0; ix < sizeX; ++ix)
+                oa.xf[ix] = xs[ix] * f;
+
+            // Coordinates only increase along X if the period is positive
+            s32 x0First = latticeCoord(oa.xf[0]);
+            s32 x0Last = latticeCoord(oa.xf[sizeX - 1]);
+            oa.x0Min = x0First;
+            oa.lineLength = static_cast<u32>(x0Last - x0First) + 2;
+            oa.useLines = period > 0 && x0Last >= x0First && oa.lineLength <= 2 * sizeX + 2;
+
+            for (u32 ix = 0; ix < sizeX; ++ix)
+            {
+                s32 x0 = latticeCoord(oa.xf[ix]);
+                f32 xl = oa.xf[ix] - (f32)x0;
+                oa.tx[ix] = smooth ? smoothCurve(xl) : xl;
+                oa.cellIndex[ix] = x0 - x0First;
+            }
+
+            ampMax += amp;
+            f *= 2.0;
+            amp *= persistence;
+        }
 
+        setup.ampMax = ampMax;
+    }
+
+    //--------------------------------------------------------------------------
+    void fillLine2D(std::vector<f32> & line, const OctaveAxis & oa, s32 y0)
+    {
+        line.resize(oa.lineLength);
+        for (u32 k = 0; k < oa.lineLength; ++k)
+            line[k] = noise2d(oa.x0Min + (s32)k, y0, oa.seed);
+    }
+
+    void fillLine3D(std::vector<f32> & line, const OctaveAxis & oa, s32 y0, s32 z0)
+    {
+        line.resize(oa.lineLength);
+        for (u32 k = 0; k < oa.lineLength; ++k)
+            line[k] = noise3d(oa.x0Min + (s32)k, y0, z0, oa.seed);
+    }
+
+    //--------------------------------------------------------------------------
+    // Same as biLinearInterpolationSmooth(), accumulated with the octave amplitude
+    void accumulateRow2D(
+        f32 * row, u32 count, const OctaveAxis & oa, 
+        const f32 * line0, const f32 * line1, f32 ty)
+    {
+        const s32 * cells = &oa.cellIndex[0];
+        const f32 * tx = &oa.tx[0];
+        const f32 amp = oa.amp;
+        u32 ix = 0;
+
+#ifdef SN_NOISE_SSE2
+        const __m128 vty = _mm_set1_ps(ty);
+        const __m128 vamp = _mm_set1_ps(amp);
+        for (; ix + 4 <= count; ix += 4)
+        {
+            const s32 * c = cells + ix;
+            __m128 v00 = _mm_setr_ps(line0[c[0]], line0[c[1]], line0[c[2]], line0[c[3]]);
+            __m128 v10 = _mm_setr_ps(line0[c[0] + 1], line0[c[1] + 1], line0[c[2] + 1], line0[c[3] + 1]);
+            __m128 v01 = _mm_setr_ps(line1[c[0]], line1[c[1]], line1[c[2]], line1[c[3]]);
+            __m128 v11 = _mm_setr_ps(line1[c[0] + 1], line1[c[1] + 1], line1[c[2] + 1], line1[c[3] + 1]);
+            __m128 t = _mm_loadu_ps(tx + ix);
+
+            __m128 u = _mm_add_ps(v00, _mm_mul_ps(_mm_sub_ps(v10, v00), t));
+            __m128 v = _mm_add_ps(v01, _mm_mul_ps(_mm_sub_ps(v11, v01), t));
+            __m128 r = _mm_add_ps(u, _mm_mul_ps(_mm_sub_ps(v, u), vty));
 
+            _mm_storeu_ps(row + ix, _mm_add_ps(_mm_loadu_ps(row + ix), _mm_mul_ps(vamp, r)));
+        }
+#endif
+
+        for (; ix < count; ++ix)
+        {
+            s32 c = cells[ix];
+            f32 u = linearInterpolation(line0[c], line0[c + 1], tx[ix]);
+            f32 v = linearInterpolation(line1[c], line1[c + 1], tx[ix]);
+            row[ix] += amp * linearInterpolation(u, v, ty);
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    // Same as triLinearInterpolation(), accumulated with the octave amplitude.
+    // lines: (y0,z0), (y0+1,z0), (y0,z0+1), (y0+1,z0+1)
+    void accumulateRow3D(
+        f32 * row, u32 count, const OctaveAxis & oa,
+        const f32 * const lines[4], f32 ty, f32 tz)
+    {
+        const s32 * cells = &oa.cellIndex[0];
+        const f32 * tx = &oa.tx[0];
+        const f32 amp = oa.amp;
+        const f32 * l00 = lines[0];
+        const f32 * l10 = lines[1];
+        const f32 * l01 = lines[2];
+        const f32 * l11 = lines[3];
+        u32 ix = 0;
+
+#ifdef SN_NOISE_SSE2
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 vty = _mm_set1_ps(ty);
+        const __m128 vtz = _mm_set1_ps(tz);
+        const __m128 omty = _mm_set1_ps(1 - ty);
+        const __m128 omtz = _mm_set1_ps(1 - tz);
+        const __m128 vamp = _mm_set1_ps(amp);
+        for (; ix + 4 <= count; ix += 4)
+        {
+            const s32 * c = cells + ix;
+#define SN_NOISE_GATHER(line, offset) _mm_setr_ps(line[c[0] + offset], line[c[1] + offset], line[c[2] + offset], line[c[3] + offset])
+            __m128 v000 = SN_NOISE_GATHER(l00, 0);
+            __m128 v100 = SN_NOISE_GATHER(l00, 1);
+            __m128 v010 = SN_NOISE_GATHER(l10, 0);
+            __m128 v110 = SN_NOISE_GATHER(l10, 1);
+            __m128 v001 = SN_NOISE_GATHER(l01, 0);
+            __m128 v101 = SN_NOISE_GATHER(l01, 1);
+            __m128 v011 = SN_NOISE_GATHER(l11, 0);
+            __m128 v111 = SN_NOISE_GATHER(l11, 1);
+#undef SN_NOISE_GATHER
+            __m128 t = _mm_loadu_ps(tx + ix);
+            __m128 omt = _mm_sub_ps(one, t);
+
+            // Same evaluation order as triLinearInterpolation()
+            __m128 r = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(v000, omt), omty), omtz);
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(v100, t), omty), omtz));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(v010, omt), vty), omtz));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(v110, t), vty), omtz));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(v001, omt), omty), vtz));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(v101, t), omty), vtz));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(v011, omt), vty), vtz));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(v111, t), vty), vtz));
+
+            _mm_storeu_ps(row + ix, _mm_add_ps(_mm_loadu_ps(row + ix), _mm_mul_ps(vamp, r)));
+        }
+#endif
+
+        for (; ix < count; ++ix)
+        {
+            s32 c = cells[ix];
+            row[ix] += amp * triLinearInterpolation(
+                l00[c], l00[c + 1], l10[c], l10[c + 1],
+                l01[c], l01[c + 1], l11[c], l11[c + 1],
+                tx[ix], ty, tz
+            );
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    struct LineCache2D
+    {
+        bool valid;
+        s32 y0;
+        std::vector<f32> lines[2];
+        LineCache2D() : valid(false), y0(0) {}
+    };
 
+    void generateRows2D(const PerlinSetup & setup, f32 originY, u32 sizeX, u32 yBegin, u32 yEnd, f32 * out)
+    {
+        std::vector<LineCache2D> caches(setup.octaves.size());
+
+        for (u32 iy = yBegin; iy < yEnd; ++iy)
+        {
+            f32 * row = out + iy * sizeX;
+            std::fill(row, row + sizeX, 0.f);
+
+            f32 y = originY + (f32)iy;
+            y /= setup.period;
+
+            for (u32 i = 0; i < setup.octaves.size(); ++i)
+            {
+                const OctaveAxis & oa = setup.octaves[i];
+                f32 yf = y * oa.f;
+
+                if (oa.useLines)
+                {
+                    s32 y0 = latticeCoord(yf);
+                    f32 ty = smoothCurve(yf - (f32)y0);
+
+                    LineCache2D & cache = caches[i];
+                    if (!cache.valid || cache.y0 != y0)
+                    {
+                        if (cache.valid && y0 == cache.y0 + 1)
+                        {
+                            // Moved to the next lattice line, the previous upper line is our lower one
+                            cache.lines[0].swap(cache.lines[1]);
+                        }
+                        else
+                        {
+                            fillLine2D(cache.lines[0], oa, y0);
+                        }
+                        fillLine2D(cache.lines[1], oa, y0 + 1);
+                        cache.y0 = y0;
+                        cache.valid = true;
+                    }
+
+                    accumulateRow2D(row, sizeX, oa, &cache.lines[0][0], &cache.lines[1][0], ty);
+                }
+                else
+                {
+                    for (u32 ix = 0; ix < sizeX; ++ix)
+                        row[ix] += oa.amp * noise2dGradient(oa.xf[ix], yf, oa.seed);
+                }
+            }
+
+            for (u32 ix = 0; ix < sizeX; ++ix)
+                row[ix] = row[ix] / setup.ampMax;
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    struct LineCache3D
+    {
+        bool valid;
+        s32 y0;
+        s32 z0;
+        // (y0,z0), (y0+1,z0), (y0,z0+1), (y0+1,z0+1)
+        std::vector<f32> lines[4];
+        LineCache3D() : valid(false), y0(0), z0(0) {}
+    };
+
+    void generateSlabs3D(
+        const PerlinSetup & setup, f32 originY, f32 originZ, 
+        u32 sizeX, u32 sizeY, u32 zBegin, u32 zEnd, f32 * out)
+    {
+        std::vector<LineCache3D> caches(setup.octaves.size());
+
+        for (u32 iz = zBegin; iz < zEnd; ++iz)
+        {
+            f32 z = originZ + (f32)iz;
+            z /= setup.period;
+
+            for (u32 iy = 0; iy < sizeY; ++iy)
+            {
+                f32 * row = out + (iz * sizeY + iy) * sizeX;
+                std::fill(row, row + sizeX, 0.f);
+
+                f32 y = originY + (f32)iy;
+                y /= setup.period;
+
+                for (u32 i = 0; i < setup.octaves.size(); ++i)
+                {
+                    const OctaveAxis & oa = setup.octaves[i];
+                    f32 yf = y * oa.f;
+                    f32 zf = z * oa.f;
+
+                    if (oa.useLines)
+                    {
+                        s32 y0 = latticeCoord(yf);
+                        s32 z0 = latticeCoord(zf);
+                        f32 ty = yf - (f32)y0;
+                        f32 tz = zf - (f32)z0;
+
+                        LineCache3D & cache = caches[i];
+                        if (!cache.valid || cache.y0 != y0 || cache.z0 != z0)
+                        {
+                            if (cache.valid && cache.z0 == z0 && y0 == cache.y0 + 1)
+                            {
+                                // Moved to the next lattice line along Y
+                                cache.lines[0].swap(cache.lines[1]);
+                                cache.lines[2].swap(cache.lines[3]);
+                            }
+                            else
+                            {
+                                fillLine3D(cache.lines[0], oa, y0, z0);
+                                fillLine3D(cache.lines[2], oa, y0, z0 + 1);
+                            }
+                            fillLine3D(cache.lines[1], oa, y0 + 1, z0);
+                            fillLine3D(cache.lines[3], oa, y0 + 1, z0 + 1);
+                            cache.y0 = y0;
+                            cache.z0 = z0;
+                            cache.valid = true;
+                        }
+
+                        const f32 * lines[4] = {
+                            &cache.lines[0][0], &cache.lines[1][0], &cache.lines[2][0], &cache.lines[3][0]
+                        };
+                        accumulateRow3D(row, sizeX, oa, lines, ty, tz);
+                    }
+                    else
+                    {
+                        for (u32 ix = 0; ix < sizeX; ++ix)
+                            row[ix] += oa.amp * noise3dGradient(oa.xf[ix], yf, zf, oa.seed);
+                    }
+                }
+
+                for (u32 ix = 0; ix < sizeX; ++ix)
+                    row[ix] = row[ix] / setup.ampMax;
+            }
+        }
+    }
+
+} // anonymous namespace
+
+//------------------------------------------------------------------------------
+void noise2dPerlin(
+        Array2D<f32> & out, f32 originX, f32 originY, s32 seed,
+        s32 octaves, f32 persistence, f32 period,
+        u32 threadCount)
+{
+    if (out.empty())
+        return;
+
+    if (octaves < 1)
+    {
+        out.fill(0);
+        return;
+    }
+
+    PerlinSetup setup;
+    makePerlinSetup(setup, out.sizeX(), originX, seed, octaves, persistence, period, true);
+
+    const u32 sizeX = out.sizeX();
+    f32 * data = out.raw();
+    parallelFor(out.sizeY(), threadCount, [&setup, originY, sizeX, data](u32 begin, u32 end) {
+        generateRows2D(setup, originY, sizeX, begin, end, data);
+    });
+}
+
+//------------------------------------------------------------------------------
+void noise3dPerlin(
+        Array3D<f32> & out, f32 originX, f32 originY, f32 originZ, s32 seed,
+        s32 octaves, f32 persistence, f32 period,
+        u32 threadCount)
+{
+    if (out.empty())
+        return;
+
+    if (octaves < 1)
+    {
+        out.fill(0);
+        return;
+    }
+
+    PerlinSetup setup;
+    makePerlinSetup(setup, out.sizeX(), originX, seed, octaves, persistence, period, false);
+
+    const u32 sizeX = out.sizeX();
+    const u32 sizeY = out.sizeY();
+    f32 * data = &out[0];
+    parallelFor(out.sizeZ(), threadCount, [&setup, originY, originZ, sizeX, sizeY, data](u32 begin, u32 end) {
+        generateSlabs3D(setup, originY, originZ, sizeX, sizeY, begin, end, data);
+    });
+}
+
+} // namespace sn
@@ -8,6 +8,8 @@ This file is part of the SnowfeetEngine project.
 #define __HEADER_SN_NOISE__
 
 #include <core/types.h>
+#include <core/util/Array2D.h>
+#include <core/util/Array3D.h>
 
 namespace sn
 {
@@ -30,6 +32,25 @@ f32 SN_API noise3dPerlin(
     s32 octaves, f32 persistence, f32 period
 );
 
+/// \brief Fills a grid with Perlin noise, faster than sampling each cell.
+/// Lattice values are shared between neighbor cells, and rows can be split between threads.
+/// The cell (x,y) receives exactly what noise2dPerlin(originX + x, originY + y, ...) returns.
+/// \param threadCount: number of threads generating rows, including the calling one.
+void SN_API noise2dPerlin(
+    Array2D<f32> & out, f32 originX, f32 originY, s32 seed,
+    s32 octaves, f32 persistence, f32 period,
+    u32 threadCount = 1
+);
+
+/// \brief Fills a grid with 3D Perlin noise, faster than sampling each cell.
+/// The cell (x,y,z) receives exactly what noise3dPerlin(originX + x, originY + y, originZ + z, ...) returns.
+/// \param threadCount: number of threads generating slabs, including the calling one.
+void SN_API noise3dPerlin(
+    Array3D<f32> & out, f32 originX, f32 originY, f32 originZ, s32 seed,
+    s32 octaves, f32 persistence, f32 period,
+    u32 threadCount = 1
+);
+
 } // namespace sn
 
 
@@ -6,7 +6,9 @@ This file is part of the SnowfeetEngine project.
 
 #include <core/pcg/AutoTiler.h>
 #include <core/util/Log.h>
+#include <core/math/Random.h>
 #include <core/sml/variant_serialize.h>
+#include <core/system/parallel.h>
 
 namespace sn
 {
@@ -23,11 +25,44 @@ const s32 g_nv8[8][2] = {
     {1, 1}
 };
 
+// Converts 3 columns of 3 connection bits into a ConnectionMask.
+// Bit (column * 3 + row) of the window tells if the neighbor at (column - 1, row - 1) connects.
+// Computing masks from columns lets a row be processed by shifting in one new column per cell.
+struct WindowToMask
+{
+    u8 table[512];
+
+    WindowToMask()
+    {
+        for(u32 window = 0; window < 512; ++window)
+        {
+            u8 mask = 0;
+            for(u32 i = 0; i < 8; ++i)
+            {
+                u32 bit = (g_nv8[i][0] + 1) * 3 + (g_nv8[i][1] + 1);
+                if(window & (1 << bit))
+                    mask |= 1 << (7 - i);
+            }
+            table[window] = mask;
+        }
+    }
+};
+
+const WindowToMask g_windowToMask;
+
+// Gets the connection bits of a column of the window, from a 256-bit connection bitmap
+inline u32 getColumnConnections(const u32 * conn, const u8 * up, const u8 * mid, const u8 * down, s32 i)
+{
+    return ((conn[up[i] >> 5] >> (up[i] & 31)) & 1)
+        | (((conn[mid[i] >> 5] >> (mid[i] & 31)) & 1) << 1)
+        | (((conn[down[i] >> 5] >> (down[i] & 31)) & 1) << 2);
+}
+
 //------------------------------------------------------------------------------
 void AutoTiler::RuleSet::addCase(ConnectionMask neighboring, u8 mask, std::vector<Out_T> variants)
 {
     // Is the case fully-specific?
-    if(mask == 0xf)
+    if(mask == 0xff)
     {
         // The mask is full, no need to generate cases
         addCase(neighboring, variants);
@@ -105,80 +140,210 @@ void AutoTiler::RuleSet::addCase(ConnectionMask neighboring, u8 mask, std::vecto
 }
 
 //------------------------------------------------------------------------------
-void AutoTiler::process(const Array2D<In_T> & inputGrid, Array2D<Out_T> & outputGrid) const
+void AutoTiler::compile()
 {
-    // For each cell in the grid
-    for(s32 y = 0; y < static_cast<s32>(inputGrid.sizeY()); ++y)
+    // In_T can't go further
+    m_compiledTypeCount = std::min(static_cast<u32>(ruleSets.size()), 256u);
+
+    m_cases.resize(m_compiledTypeCount * 256);
+    m_connections.assign(m_compiledTypeCount * 8, 0);
+    m_compiledVariants.clear();
+
+    for(u32 type = 0; type < m_compiledTypeCount; ++type)
     {
-        for(s32 x = 0; x < static_cast<s32>(inputGrid.sizeX()); ++x)
+        const RuleSet & rules = ruleSets[type];
+
+        for(auto it = rules.connections.begin(); it != rules.connections.end(); ++it)
         {
-            outputGrid.set(x,y, processTile(inputGrid, x, y));
+            In_T c = *it;
+            m_connections[type * 8 + (c >> 5)] |= 1u << (c & 31);
+        }
+
+        // Neighborings without rules use the default tile of the type
+        CompiledCase defaultCase = { static_cast<u32>(m_compiledVariants.size()), 1 };
+        m_compiledVariants.push_back(rules.defaultOutput.empty() ? defaultOutput : rules.defaultOutput[0]);
+        CompiledCase * cases = &m_cases[type * 256];
+        std::fill(cases, cases + 256, defaultCase);
+
+        for(auto it = rules.cases.begin(); it != rules.cases.end(); ++it)
+        {
+            const std::vector<Out_T> & variants = it->second;
+            CompiledCase & c = cases[it->first];
+            c.first = m_compiledVariants.size();
+            if(variants.empty())
+            {
+                c.count = 1;
+                m_compiledVariants.push_back(defaultOutput);
+            }
+            else
+            {
+                c.count = variants.size();
+                m_compiledVariants.insert(m_compiledVariants.end(), variants.begin(), variants.end());
+            }
         }
     }
+
+    m_needCompile = false;
 }
 
 //------------------------------------------------------------------------------
-AutoTiler::Out_T AutoTiler::processTile(const Array2D<In_T> & inputGrid, u32 x, u32 y) const
+void AutoTiler::process(const Array2D<In_T> & inputGrid, Array2D<Out_T> & outputGrid, u32 threadCount)
 {
-    // Get the type of the cell
-    In_T type = inputGrid.getNoEx(x,y);
+    compileIfNeeded();
 
-    Out_T outputValue = defaultOutput;
+    if(inputGrid.empty())
+    {
+        outputGrid.clear();
+        return;
+    }
 
-    // If the type is referenced
-    if(type < ruleSets.size())
+    if(outputGrid.sizeX() != inputGrid.sizeX() || outputGrid.sizeY() != inputGrid.sizeY())
     {
-        // If the type has no rules
-        const RuleSet & rules = ruleSets[type];
-        if(rules.cases.empty())
+        outputGrid.create(inputGrid.sizeX(), inputGrid.sizeY());
+    }
+
+    s32 maxX = inputGrid.sizeX() - 1;
+    parallelFor(inputGrid.sizeY(), threadCount, [this, &inputGrid, &outputGrid, maxX](u32 begin, u32 end) {
+        processRows(inputGrid, outputGrid, 0, begin, maxX, end - 1);
+    });
+}
+
+//------------------------------------------------------------------------------
+void AutoTiler::processArea(const Array2D<In_T> & inputGrid, Array2D<Out_T> & outputGrid, s32 minX, s32 minY, s32 maxX, s32 maxY)
+{
+    compileIfNeeded();
+
+    if(outputGrid.sizeX() != inputGrid.sizeX() || outputGrid.sizeY() != inputGrid.sizeY())
+    {
+        SN_ERROR("AutoTiler::processArea: output grid doesn't have the same size as the input");
+        return;
+    }
+
+    // Neighbors of changed cells have a different neighboring too
+    minX = std::max(minX - 1, 0);
+    minY = std::max(minY - 1, 0);
+    maxX = std::min(maxX + 1, static_cast<s32>(inputGrid.sizeX()) - 1);
+    maxY = std::min(maxY + 1, static_cast<s32>(inputGrid.sizeY()) - 1);
+
+    if(minX > maxX || minY > maxY)
+        return;
+
+    processRows(inputGrid, outputGrid, minX, minY, maxX, maxY);
+}
+
+//------------------------------------------------------------------------------
+void AutoTiler::loadPaddedRow(const Array2D<In_T> & inputGrid, s32 y, s32 minX, s32 maxX, std::vector<In_T> & out_row) const
+{
+    s32 sizeX = inputGrid.sizeX();
+    out_row.resize(sizeX + 2);
+
+    // Only cells from minX-1 to maxX+1 are needed
+    if(y < 0 || y >= static_cast<s32>(inputGrid.sizeY()))
+    {
+        std::fill(out_row.begin() + minX, out_row.begin() + maxX + 3, defaultInput);
+    }
+    else
+    {
+        s32 beginX = std::max(minX - 1, 0);
+        s32 endX = std::min(maxX + 2, sizeX);
+        out_row[0] = defaultInput;
+        memcpy(&out_row[beginX + 1], &inputGrid[inputGrid.getLocation(beginX, y)], (endX - beginX) * sizeof(In_T));
+        out_row[sizeX + 1] = defaultInput;
+    }
+}
+
+//------------------------------------------------------------------------------
+void AutoTiler::processRows(const Array2D<In_T> & inputGrid, Array2D<Out_T> & outputGrid, s32 minX, s32 minY, s32 maxX, s32 maxY) const
+{
+    // Rolling buffer of the three input rows around the current one
+    std::vector<In_T> buffers[3];
+    loadPaddedRow(inputGrid, minY - 1, minX, maxX, buffers[0]);
+    loadPaddedRow(inputGrid, minY, minX, maxX, buffers[1]);
+
+    for(s32 y = minY; y <= maxY; ++y)
+    {
+        u32 k = y - minY;
+        loadPaddedRow(inputGrid, y + 1, minX, maxX, buffers[(k + 2) % 3]);
+
+        const In_T * rows[3] = {
+            &buffers[k % 3][0],
+            &buffers[(k + 1) % 3][0],
+            &buffers[(k + 2) % 3][0]
+        };
+
+        processRow(rows, y, minX, maxX, &outputGrid[outputGrid.getLocation(0, y)]);
+    }
+}
+
+//------------------------------------------------------------------------------
+void AutoTiler::processRow(const In_T * rows[3], s32 y, s32 minX, s32 maxX, Out_T * out_row) const
+{
+    // Note: rows are padded, so cell x of the grid is at x+1
+    const In_T * up = rows[0];
+    const In_T * mid = rows[1];
+    const In_T * down = rows[2];
+
+    s32 previousType = -1;
+    u32 window = 0;
+
+    for(s32 x = minX; x <= maxX; ++x)
+    {
+        In_T type = mid[x + 1];
+
+        if(type >= m_compiledTypeCount)
         {
-            // Apply default outputValue to the cell
-            outputValue = rules.defaultOutput[0];
+            out_row[x] = defaultOutput;
+            previousType = -1;
+            continue;
         }
-        else // The type has rules:
-        {
-            // Retrieve neighboring mask
-            u8 m = 0;
-            for(u32 i = 0; i < 8; ++i)
-            {
-                s32 nx = x + g_nv8[i][0];
-                s32 ny = y + g_nv8[i][1];
-
-                // Get neighboring value
-                In_T ntype = inputGrid.contains(nx, ny) ? inputGrid.getNoEx(nx, ny) : defaultInput;
-
-                // If it connects
-                if(rules.connections.find(ntype) != rules.connections.end())
-                {
-                    // Add to the mask
-                    m |= 1;
-                }
-
-                if(i != 7)
-                {
-                    // Shift the mask to enter next value on next loop
-                    m <<= 1;
-                }
-            }
 
-            ConnectionMask neighboring = m;
+        const u32 * conn = &m_connections[type * 8];
 
-            // Find a rule for the given neighboring
-            auto ruleIt = rules.cases.find(neighboring);
-            if(ruleIt != rules.cases.end())
-            {
-                // Found a rule, apply a corresponding outputValue
-                outputValue = ruleIt->second[0]; // TODO choose variant at random
-            }
-            else
-            {
-                // No rules for this case, use type's default outputValue
-                outputValue = rules.defaultOutput[0];
-            }
+        if(type != previousType)
+        {
+            window = getColumnConnections(conn, up, mid, down, x)
+                | (getColumnConnections(conn, up, mid, down, x + 1) << 3)
+                | (getColumnConnections(conn, up, mid, down, x + 2) << 6);
+            previousType = type;
         }
+        else
+        {
+            // Same connections as the previous cell: slide the window by one column
+            window = (window >> 3) | (getColumnConnections(conn, up, mid, down, x + 2) << 6);
+        }
+
+        out_row[x] = pickVariant(type, g_windowToMask.table[window], x, y);
+    }
+}
+
+//------------------------------------------------------------------------------
+AutoTiler::Out_T AutoTiler::processTile(const Array2D<In_T> & inputGrid, u32 x, u32 y)
+{
+    compileIfNeeded();
+
+    // Get the type of the cell
+    In_T type = inputGrid.getNoEx(x,y);
+
+    // If the type is not referenced
+    if(type >= m_compiledTypeCount)
+        return defaultOutput;
+
+    // Retrieve neighboring mask
+    ConnectionMask neighboring = 0;
+    for(u32 i = 0; i < 8; ++i)
+    {
+        s32 nx = x + g_nv8[i][0];
+        s32 ny = y + g_nv8[i][1];
+
+        // Get neighboring value
+        In_T ntype = inputGrid.contains(nx, ny) ? inputGrid.getNoEx(nx, ny) : defaultInput;
+
+        // If it connects, add to the mask
+        if(connects(type, ntype))
+            neighboring |= 1 << (7 - i);
     }
 
-    return outputValue;
+    return pickVariant(type, neighboring, x, y);
 }
 
 //------------------------------------------------------------------------------
@@ -223,9 +388,11 @@ void AutoTiler::unserialize(const Variant & o)
     defaultOutput = o["defaultOutput"].getInt();
 
     const Variant & jRuleSets = o["ruleSets"];
-    ruleSets.resize(jRuleSets.getArray().size());
+    const u32 jRuleSetsSize = jRuleSets.getArray().size();
+    ruleSets.resize(jRuleSetsSize);
 
-    for(u32 i = 0; i < ruleSets.size(); ++i)
+    // Explicit inputs can grow ruleSets, so only the JSON array bounds the loop
+    for(u32 i = 0; i < jRuleSetsSize; ++i)
     {
         const Variant & jrs = jRuleSets[i];
 
@@ -234,6 +401,10 @@ void AutoTiler::unserialize(const Variant & o)
         {
             input = jrs["input"].getInt();
         }
+        if(input >= ruleSets.size())
+        {
+            ruleSets.resize(input + 1);
+        }
         RuleSet & rs = ruleSets[input];
 
         // Default output
@@ -261,6 +432,8 @@ void AutoTiler::unserialize(const Variant & o)
             rs.addCase(conMask, dontCareMask, variants);
         }
     }
+
+    m_needCompile = true;
 }
 
 } // namespace sn
@@ -14,6 +14,7 @@ This file is part of the SnowfeetEngine project.
 
 #include <core/util/Array2D.h>
 #include <core/util/Variant.h>
+#include <core/math/Random.h>
 
 namespace sn
 {
@@ -26,6 +27,7 @@ namespace sn
 /// The approach here is to define all possible cases instead of using
 /// fixed IF block or bitwise presets. It consumes more memory, but that's
 /// an acceptable tradeoff for handling almost all possible cases and being very flexible.
+/// Rule sets are compiled into flat tables before processing, see compile().
 class SN_API AutoTiler
 {
 public:
@@ -56,10 +58,8 @@ public:
         // TODO add neighboring pattern option
 
         RuleSet(Out_T pDefaultOutput = 0):
-            defaultOutput(pDefaultOutput)
-        {
-            defaultOutput.push_back(0);
-        }
+            defaultOutput(1, pDefaultOutput)
+        {}
 
         void setDefaultOutput(Out_T singleValue)
         {
@@ -94,13 +94,16 @@ public:
 
     In_T defaultInput; // Type used when out of bounds
     Out_T defaultOutput; // Tile used when no rules match
+    u32 variantSeed; // Seed used to pick variants. The same seed and input always give the same output.
 
     // Tiling rules for each type in input grids
     std::vector<RuleSet> ruleSets;
 
     AutoTiler() :
         defaultInput(0),
-        defaultOutput(0)
+        defaultOutput(0),
+        variantSeed(0),
+        m_needCompile(true)
     {}
 
     void addRuleSet(In_T inputValue, const RuleSet & ruleset)
@@ -110,19 +113,78 @@ public:
             ruleSets.resize(inputValue+1);
         }
         ruleSets[inputValue] = ruleset;
+        m_needCompile = true;
     }
 
-    // Converts a grid of types into a grid of tiles
-    void process(const Array2D<In_T> & inputGrid, Array2D<Out_T> & outputGrid) const;
+    // Builds lookup tables from the rule sets: for each input type, the tiles of all 256 neighborings,
+    // and the types it connects to as a bitmap.
+    // Process functions compile when rules were added with addRuleSet() or unserialize(),
+    // but if ruleSets or defaultOutput are modified directly, this must be called afterwards.
+    void compile();
+
+    // Converts a grid of types into a grid of tiles.
+    // The output grid is re-created if it doesn't have the same size as the input.
+    // threadCount: number of threads processing rows, including the calling one.
+    void process(const Array2D<In_T> & inputGrid, Array2D<Out_T> & outputGrid, u32 threadCount = 1);
+
+    // Updates tiles after input cells changed in the given area (inclusive bounds).
+    // Tiles of the area and of its border are recalculated, because their neighboring changed.
+    void processArea(const Array2D<In_T> & inputGrid, Array2D<Out_T> & outputGrid, s32 minX, s32 minY, s32 maxX, s32 maxY);
 
     // Calculates a tile from its type at the given position
-    Out_T processTile(const Array2D<In_T> & inputGrid, u32 x, u32 y) const;
+    Out_T processTile(const Array2D<In_T> & inputGrid, u32 x, u32 y);
 
     // Loads pattern data from a JSON file
     void unserialize(const sn::Variant & o);
 
     static void stringToCaseKey(const std::string & s, ConnectionMask & conMask, u8 & dontCareMask);
 
+private:
+
+    // Tiles of a neighboring, as a range in m_compiledVariants
+    struct CompiledCase
+    {
+        u32 first;
+        u32 count;
+    };
+
+    inline void compileIfNeeded()
+    {
+        if(m_needCompile)
+            compile();
+    }
+
+    inline bool connects(In_T type, In_T neighborType) const
+    {
+        return (m_connections[type * 8 + (neighborType >> 5)] >> (neighborType & 31)) & 1;
+    }
+
+    inline Out_T pickVariant(In_T type, ConnectionMask neighboring, s32 x, s32 y) const
+    {
+        const CompiledCase & c = m_cases[type * 256 + neighboring];
+        if(c.count == 1)
+            return m_compiledVariants[c.first];
+        return m_compiledVariants[c.first + Random::hash(variantSeed, x, y) % c.count];
+    }
+
+    // Processes cells [minX, maxX] of a row.
+    // rows: three rows of input centered on y, padded with one cell on each side.
+    void processRow(const In_T * rows[3], s32 y, s32 minX, s32 maxX, Out_T * out_row) const;
+
+    // Copies the part of a row of input needed to process cells [minX, maxX],
+    // padded with defaultInput on each side and outside the grid
+    void loadPaddedRow(const Array2D<In_T> & inputGrid, s32 y, s32 minX, s32 maxX, std::vector<In_T> & out_row) const;
+
+    void processRows(const Array2D<In_T> & inputGrid, Array2D<Out_T> & outputGrid, s32 minX, s32 minY, s32 maxX, s32 maxY) const;
+
+private:
+
+    bool m_needCompile;
+    u32 m_compiledTypeCount;
+    std::vector<CompiledCase> m_cases; // [type * 256 + neighboring]
+    std::vector<Out_T> m_compiledVariants;
+    std::vector<u32> m_connections; // [type * 8 + neighborType / 32], 256 bits per type
+
 };
 
 } // namespace sn
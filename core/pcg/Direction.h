@@ -39,7 +39,7 @@ namespace Direction
         ANY_BITS   = LEFT_BIT | RIGHT_BIT | UP_BIT | DOWN_BIT
     };
 
-    u8 opposite(u8 dir)
+    inline u8 opposite(u8 dir)
     {
         switch(dir)
         {
@@ -51,7 +51,7 @@ namespace Direction
         }
     }
 
-    u8 left(u8 dir)
+    inline u8 left(u8 dir)
     {
         switch(dir)
         {
@@ -63,7 +63,7 @@ namespace Direction
         }
     }
 
-    u8 right(u8 dir)
+    inline u8 right(u8 dir)
     {
         switch(dir)
         {
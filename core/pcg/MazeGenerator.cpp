@@ -19,6 +19,12 @@ MazeGenerator::MazeGenerator(u32 width, u32 height)
 
 //------------------------------------------------------------------------------
 void MazeGenerator::generate(u32 seedX, u32 seedY)
+{
+    generate(seedX, seedY, Random::getThreadDefault());
+}
+
+//------------------------------------------------------------------------------
+void MazeGenerator::generate(u32 seedX, u32 seedY, Random & rng)
 {
     u32 iterations = 0;
     u32 maxIterations = 100000; // Infinite loop security
@@ -41,12 +47,12 @@ void MazeGenerator::generate(u32 seedX, u32 seedY)
     while(!startNodes.empty())
     {
         // Choose at random from the available start nodes
-        u32 j = math::rand(0, startNodes.size()-1);
+        u32 j = rng.range(0, startNodes.size());
         pos = startNodes[j];
         startNodes.erase(startNodes.begin() + j);
 
         // Randomize the maximum length of the corridor
-        u32 corridorLength = math::rand(corridorLengthMin, corridorLengthMax);
+        u32 corridorLength = rng.range(corridorLengthMin, corridorLengthMax + 1);
 
         // Generate the corridor by iteration
         for(u32 i = 0; i < corridorLength; ++i)
@@ -68,7 +74,7 @@ void MazeGenerator::generate(u32 seedX, u32 seedY)
                 }
 
                 // Choose a random direction
-                dir = availableDirs[math::rand(0, availableDirs.size()-1)];
+                dir = availableDirs[rng.range(0, availableDirs.size())];
 
                 // Add the available direction to cell's mask (from)
                 if((grid[l] & UNVISITED_BIT) != 0)
@@ -108,7 +114,7 @@ void MazeGenerator::generate(u32 seedX, u32 seedY)
 
     if(loopChance > 0.0001f)
     {
-        connectRandomNodes(loopChance);
+        connectRandomNodes(loopChance, rng);
     }
 }
 
@@ -138,7 +144,7 @@ std::vector<u32> MazeGenerator::unvisitedDirections(s32 x, s32 y)
 }
 
 //------------------------------------------------------------------------------
-void MazeGenerator::connectRandomNodes(f32 chance)
+void MazeGenerator::connectRandomNodes(f32 chance, Random & rng)
 {
     bool gen = false;
     for(s32 y  = 0; y < static_cast<s32>(grid.sizeY()); ++y)
@@ -156,7 +162,7 @@ void MazeGenerator::connectRandomNodes(f32 chance)
                 // Connecting can fail, so we try to do it here and at the next iteration until it works.
                 // In that case, gen is set to false.
 
-                gen = gen | (math::randf(0.f, 1.f) < chance);
+                gen = gen | rng.chance(chance);
 
                 if(gen)
                 {
@@ -176,12 +182,12 @@ void MazeGenerator::connectRandomNodes(f32 chance)
                     }
                     if(c & Direction::UP_BIT)
                     {
-                        unavailableDirs.push_back(Direction::UP_BIT);
+                        unavailableDirs.push_back(Direction::UP);
                     }
 
                     if(!unavailableDirs.empty())
                     {
-                        u32 dir = unavailableDirs[math::rand(0, unavailableDirs.size()-1)];
+                        u32 dir = unavailableDirs[rng.range(0, unavailableDirs.size())];
 
                         s32 nx = x + Direction::toVector<s32>(dir).x();
                         s32 ny = y + Direction::toVector<s32>(dir).y();
@@ -45,13 +45,17 @@ public:
     /// and no one will make any loop.
     /// \param seedX: Seed x.
     /// \param seedY: Seed y.
+    /// \param rng: Random generator to use. Given the same generator state, the maze will be the same.
+    void generate(u32 seedX, u32 seedY, Random & rng);
+
+    /// \brief Generates a maze using the calling thread's default random generator.
     void generate(u32 seedX, u32 seedY);
 
 private:
 
     /// \brief This function creates loops at random in the maze by joining corridors together.
     /// \param chance: Probability for a dead-end to join.
-    void connectRandomNodes(f32 chance);
+    void connectRandomNodes(f32 chance, Random & rng);
 
     std::vector<u32> unvisitedDirections(s32 x, s32 y);
 
@@ -1,6 +1,7 @@
 #include "PackedEntity.h"
 #include <core/asset/AssetDatabase.h>
 #include "helpers/DumpToObjectDBConverter.h"
+#include <algorithm>
 
 namespace sn
 {
@@ -11,6 +12,13 @@ SN_OBJECT_IMPL(PackedEntity)
 //------------------------------------------------------------------------------
 const char * PackedEntity::CHILDREN_TAG = "_children";
 
+//------------------------------------------------------------------------------
+PackedEntity::PackedEntity():
+    m_planRevision(0),
+    m_isPlanValid(false)
+{
+}
+
 //------------------------------------------------------------------------------
 bool PackedEntity::loadFromVariant(Variant & doc)
 {
@@ -72,116 +80,132 @@ void PackedEntity::instantiate(
     if (!isFlattened())
         flatten();
 
+    if (!m_isPlanValid || m_planRevision != getRevision())
+        compilePlan();
+
     instantiateOnly(a_parent, contextProjectName, out_rootEntities);
 }
 
 //------------------------------------------------------------------------------
-void PackedEntity::instantiateOnly(
-        Entity & a_parent, 
-        const std::string & contextProjectName, 
-        std::vector<Entity*> * out_rootEntities
-        ) const
+void PackedEntity::compilePlan()
 {
-    SerializationContext context(contextProjectName);
+    m_plan.clear();
 
     const auto & objects = getObjects();
-
-    // TODO Entity order inside children vector is not guaranteed!
-
     const ObjectType & entityT = sn::getObjectType<Entity>();
-    std::unordered_map<u32, sn::Object*> & entities = context.getObjectMap();
 
-    // Create instances first
+    // Sort by ID so instantiation order is the same each time
+    std::vector<u32> ids;
+    ids.reserve(objects.size());
     for (auto it = objects.begin(); it != objects.end(); ++it)
-    {
-        u32 id = it->first;
-        const Variant & o = it->second.data;
+        ids.push_back(it->first);
+    std::sort(ids.begin(), ids.end());
+
+    std::unordered_map<u32, u32> idToIndex;
+    m_plan.resize(ids.size());
 
-        std::string typeName = o["@type"].getString();
-        const ObjectType * ot = ObjectTypeDatabase::get().getType(typeName);
+    // Resolve types
+    for (u32 i = 0; i < ids.size(); ++i)
+    {
+        PlanNode & node = m_plan[i];
+        node.id = ids[i];
+        node.state = &objects.find(node.id)->second.data;
+        node.type = nullptr;
+        idToIndex[node.id] = i;
+
+        const Variant & typeTag = (*node.state)["@type"];
+        const ObjectType * ot = typeTag.isString() ? ObjectTypeDatabase::get().getType(typeTag.getString()) : nullptr;
         if (ot)
         {
-            sn::Object * obj = instantiateDerivedObject(*ot, entityT);
-            if (obj)
-            {
-                entities[id] = (Entity*)obj;
-            }
+            if (ot->is(entityT))
+                node.type = ot;
+            else
+                SN_ERROR("Type '" << ot->toString() << "' doesn't derive from '" << entityT.toString() << "'");
         }
         else
         {
-            SN_ERROR("Unknown object type from JSON (name=" << typeName << ")");
+            SN_ERROR("Unknown object type from JSON (name=" << toString(typeTag) << ")");
         }
     }
 
-    // Rebuild children hierarchy
-    for (auto it = entities.begin(); it != entities.end(); ++it)
+    // Resolve children references
+    for (u32 i = 0; i < m_plan.size(); ++i)
     {
-        // For each entity
-        Entity * e = (Entity*)it->second;
-        const Variant * o = getObject(it->first);
-        SN_ASSERT(o != nullptr, "Invalid state");
-
-        // Get children array
-        const Variant & childrenValue = (*o)[CHILDREN_TAG];
+        PlanNode & node = m_plan[i];
+        const Variant & childrenValue = (*node.state)[CHILDREN_TAG];
         if (childrenValue.isArray())
         {
-            // For each child element
             const Variant::Array & childrenArray = childrenValue.getArray();
-            for (size_t i = 0; i < childrenArray.size(); ++i)
+            node.children.reserve(childrenArray.size());
+            for (size_t j = 0; j < childrenArray.size(); ++j)
             {
-                const Variant & childValue = childrenArray[i];
-                u32 parentID = 0;
-                if (ObjectDB::getRef(childValue, parentID))
+                u32 childID = 0;
+                if (ObjectDB::getRef(childrenArray[j], childID))
                 {
-                    auto childIt = entities.find(parentID);
-                    if (childIt != entities.end())
-                    {
-                        // Set child parent
-                        Entity * child = (Entity*)childIt->second;
-                        child->setParent(e);
-                    }
+                    auto indexIt = idToIndex.find(childID);
+                    if (indexIt != idToIndex.end())
+                        node.children.push_back(indexIt->second);
                 }
-                //else
-                //{
-                //    // The element is not a reference...
-                //}
             }
         }
+    }
+
+    m_planRevision = getRevision();
+    m_isPlanValid = true;
+}
+
+//------------------------------------------------------------------------------
+void PackedEntity::instantiateOnly(
+        Entity & a_parent, 
+        const std::string & contextProjectName, 
+        std::vector<Entity*> * out_rootEntities
+        ) const
+{
+    SerializationContext context(contextProjectName);
+    std::unordered_map<u32, sn::Object*> & objectMap = context.getObjectMap();
+    objectMap.reserve(m_plan.size());
+
+    // Create instances first
+    std::vector<Entity*> instances(m_plan.size(), nullptr);
+    for (u32 i = 0; i < m_plan.size(); ++i)
+    {
+        const PlanNode & node = m_plan[i];
+        if (node.type)
+        {
+            sn::Object * obj = node.type->instantiate();
+            if (obj)
+            {
+                instances[i] = (Entity*)obj;
+                objectMap[node.id] = obj;
+            }
+            else
+            {
+                SN_ERROR("Cannot instantiate object type '" << node.type->toString() << "'");
+            }
+        }
+    }
 
-        //JsonBox::Value & parentValue = (*o)["parent"];
-        //
-        //u32 parentIndex = -1;
-        //JsonBox::Value & parentIndexValue = (*o)["parentIndex"];
-        //if (parentIndexValue.isInteger())
-        //{
-        //    parentIndexValue = parentIndexValue.getInt();
-        //}
-
-        //if (parentValue.isNull())
-        //{
-        //    e->setParent(&a_parent, parentIndex);
-        //    rootEntities.push_back(e);
-        //}
-        //else
-        //{
-        //    u32 parentID = 0;
-        //    if (ObjectDB::getRef(parentValue, parentID))
-        //    {
-        //        auto it = entities.find(parentID);
-        //        if (it != entities.end())
-        //        {
-        //            Entity * parent = (Entity*)it->second;
-        //            e->setParent(parent, parentIndex);
-        //        }
-        //    }
-        //}
+    // Rebuild children hierarchy
+    for (u32 i = 0; i < m_plan.size(); ++i)
+    {
+        Entity * e = instances[i];
+        if (e == nullptr)
+            continue;
+        const std::vector<u32> & children = m_plan[i].children;
+        for (u32 j = 0; j < children.size(); ++j)
+        {
+            Entity * child = instances[children[j]];
+            if (child)
+                child->setParent(e);
+        }
     }
+
     std::vector<Entity*> rootEntities_;
     std::vector<Entity*> & rootEntities = out_rootEntities ? *out_rootEntities : rootEntities_;
-    for (auto it = entities.begin(); it != entities.end(); ++it)
+    for (u32 i = 0; i < instances.size(); ++i)
     {
-        Entity * e = (Entity*)it->second;
-        if (e->getParent() == nullptr)
+        Entity * e = instances[i];
+        if (e && e->getParent() == nullptr)
         {
             e->setParent(&a_parent);
             rootEntities.push_back(e);
@@ -189,11 +213,11 @@ void PackedEntity::instantiateOnly(
     }
 
     // Deserialize states
-    for (auto it = entities.begin(); it != entities.end(); ++it)
+    for (u32 i = 0; i < instances.size(); ++i)
     {
-        Entity * e = (Entity*)it->second;
-        const Variant * o = getObject(it->first);
-        e->unserializeState(*o, context);
+        Entity * e = instances[i];
+        if (e)
+            e->unserializeState(*m_plan[i].state, context);
     }
 
     // Trigger onReady() event
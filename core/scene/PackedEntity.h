@@ -16,6 +16,8 @@ public:
 
     static const char * CHILDREN_TAG;
 
+    PackedEntity();
+
     bool loadFromVariant(Variant & doc) override;
     bool loadFromLegacyDump(Variant & doc);
 
@@ -45,12 +47,36 @@ protected:
     ObjectDB * getFromAssetDatabase(const std::string & location) const override;
 
 private:
+    /// \brief Pre-resolved information about an object to instantiate
+    struct PlanNode
+    {
+        // ID of the object in the database
+        u32 id;
+        // Type to instantiate, null if it can't be
+        const ObjectType * type;
+        // Flattened state of the object, owned by the database
+        const Variant * state;
+        // Indexes of the child nodes in the plan
+        std::vector<u32> children;
+    };
+
+    /// \brief Builds the instantiation plan from the flattened objects,
+    /// so types and hierarchy don't have to be looked up again for each instance.
+    void compilePlan();
+
     void instantiateOnly(
         Entity & a_parent, 
         const std::string & contextProjectName, 
         std::vector<Entity*> * out_rootEntities
     ) const;
 
+private:
+    /// \brief Objects to instantiate, sorted by ID
+    std::vector<PlanNode> m_plan;
+    /// \brief Revision of the flattened data the plan was compiled from
+    u32 m_planRevision;
+    bool m_isPlanValid;
+
 };
 
 } // namespace sn
@@ -1,79 +1,293 @@
+
 #include <sstream>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
 #include "SmlParser.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define SN_SML_SSE2
+	#include <emmintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#endif
+#endif
+
 namespace sn
 {
 
+namespace
+{
+	enum CharClass
+	{
+		SML_CC_SPACE = 1,
+		SML_CC_KEY = 1 << 1,
+		SML_CC_KEY_START = 1 << 2,
+		SML_CC_NUMBER = 1 << 3,
+		SML_CC_ALPHA = 1 << 4,
+		SML_CC_VALUE_NUMBER = 1 << 5
+	};
+
+	/// \brief Lookup table replacing isspace/isalpha/isdigit calls in hot loops.
+	/// Only ASCII is classified, like the "C" locale does.
+	struct CharTable
+	{
+		u8 classes[256];
+
+		CharTable()
+		{
+			memset(classes, 0, sizeof(classes));
+
+			const char spaces[] = " \t\n\v\f\r";
+			for (const char * p = spaces; *p; ++p)
+				classes[(u8)*p] |= SML_CC_SPACE;
+
+			for (u32 c = 'a'; c <= 'z'; ++c)
+				classes[c] |= SML_CC_ALPHA | SML_CC_KEY | SML_CC_KEY_START;
+			for (u32 c = 'A'; c <= 'Z'; ++c)
+				classes[c] |= SML_CC_ALPHA | SML_CC_KEY | SML_CC_KEY_START;
+			for (u32 c = '0'; c <= '9'; ++c)
+				classes[c] |= SML_CC_KEY | SML_CC_NUMBER | SML_CC_VALUE_NUMBER;
+
+			classes['_'] |= SML_CC_KEY | SML_CC_KEY_START;
+			classes['@'] |= SML_CC_KEY | SML_CC_KEY_START;
+			classes['.'] |= SML_CC_KEY | SML_CC_NUMBER;
+			classes['"'] |= SML_CC_KEY_START;
+			classes['-'] |= SML_CC_NUMBER | SML_CC_VALUE_NUMBER;
+		}
+	};
+
+	const CharTable g_charTable;
+
+	inline bool hasClass(char c, u8 cc)
+	{
+		return (g_charTable.classes[(u8)c] & cc) != 0;
+	}
+
+#ifdef SN_SML_SSE2
+	inline u32 countTrailingZeros(u32 mask)
+	{
+	#ifdef _MSC_VER
+		unsigned long i;
+		_BitScanForward(&i, mask);
+		return i;
+	#else
+		return __builtin_ctz(mask);
+	#endif
+	}
+#endif
+
+	/// \brief Finds the first quote or backslash in [p, end), 16 bytes at a time when possible.
+	inline const char * findStringSpecial(const char * p, const char * end)
+	{
+#ifdef SN_SML_SSE2
+		const __m128i quote = _mm_set1_epi8('"');
+		const __m128i backslash = _mm_set1_epi8('\\');
+		while (end - p >= 16)
+		{
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			const u32 mask = _mm_movemask_epi8(_mm_or_si128(
+				_mm_cmpeq_epi8(chunk, quote),
+				_mm_cmpeq_epi8(chunk, backslash)));
+			if (mask != 0)
+				return p + countTrailingZeros(mask);
+			p += 16;
+		}
+#endif
+		while (p != end && *p != '"' && *p != '\\')
+			++p;
+		return p;
+	}
+
+	/// \brief Skips the most common blanks (space, tab, CR, LF) 16 bytes at a time when possible.
+	/// The remaining characters have to be checked by the caller.
+	inline const char * skipCommonBlanks(const char * p, const char * end)
+	{
+#ifdef SN_SML_SSE2
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i tab = _mm_set1_epi8('\t');
+		const __m128i lf = _mm_set1_epi8('\n');
+		const __m128i cr = _mm_set1_epi8('\r');
+		while (end - p >= 16)
+		{
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			const __m128i blanks = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+				_mm_or_si128(_mm_cmpeq_epi8(chunk, lf), _mm_cmpeq_epi8(chunk, cr)));
+			const u32 mask = ~(u32)_mm_movemask_epi8(blanks) & 0xffff;
+			if (mask != 0)
+				return p + countTrailingZeros(mask);
+			p += 16;
+		}
+#endif
+		return p;
+	}
+
+	inline char unescape(char c)
+	{
+		switch (c)
+		{
+		case 'n': return '\n';
+		case 'r': return '\r';
+		case 't': return '\t';
+		default: return c;
+		}
+	}
+
+	inline bool equals(const char * begin, const char * end, const char * str)
+	{
+		const size_t len = strlen(str);
+		return static_cast<size_t>(end - begin) == len && memcmp(begin, str, len) == 0;
+	}
+}
+
 //------------------------------------------------------------------------------
 SmlParser::SmlParser() :
-	m_lastCharacter('%')
+	m_cursor(nullptr),
+	m_end(nullptr),
+	m_inSitu(false)
 {
 }
 
 //------------------------------------------------------------------------------
 bool SmlParser::parseValue(std::istream & input, Variant & out_value)
+{
+	if (!readStream(input))
+		return false;
+	if (m_buffer.empty())
+		return false;
+	// We own the buffer, so strings can be unescaped in-situ
+	return parseBuffer(&m_buffer[0], &m_buffer[0] + m_buffer.size(), true, out_value);
+}
+
+//------------------------------------------------------------------------------
+bool SmlParser::parseValue(const char * data, size_t size, Variant & out_value)
+{
+	return parseBuffer(data, data + size, false, out_value);
+}
+
+//------------------------------------------------------------------------------
+bool SmlParser::parseValueInSitu(char * data, size_t size, Variant & out_value)
+{
+	return parseBuffer(data, data + size, true, out_value);
+}
+
+//------------------------------------------------------------------------------
+bool SmlParser::parseFile(const std::string & filePath, Variant & out_value)
+{
+	std::ifstream ifs(filePath.c_str(), std::ios::in | std::ios::binary);
+	if (!ifs.good())
+		return false;
+	return parseValue(ifs, out_value);
+}
+
+//------------------------------------------------------------------------------
+bool SmlParser::readStream(std::istream & input)
+{
+	m_buffer.clear();
+
+	// Read everything in one go if the stream tells us its size
+	const std::streampos start = input.tellg();
+	if (start != std::streampos(-1))
+	{
+		input.seekg(0, std::ios::end);
+		const std::streampos end = input.tellg();
+		input.seekg(start);
+		if (end != std::streampos(-1) && input.good())
+		{
+			m_buffer.resize(static_cast<size_t>(end - start));
+			if (!m_buffer.empty())
+			{
+				input.read(&m_buffer[0], m_buffer.size());
+				m_buffer.resize(static_cast<size_t>(input.gcount()));
+			}
+			return true;
+		}
+		input.clear();
+	}
+
+	// Non-seekable stream, fallback on chunked reads
+	char chunk[4096];
+	while (input.good())
+	{
+		input.read(chunk, sizeof(chunk));
+		m_buffer.insert(m_buffer.end(), chunk, chunk + input.gcount());
+	}
+	return !input.bad();
+}
+
+//------------------------------------------------------------------------------
+bool SmlParser::parseBuffer(const char * begin, const char * end, bool inSitu, Variant & out_value)
+{
+	m_cursor = begin;
+	m_end = end;
+	m_inSitu = inSitu;
+
+	bool found = parseValue(out_value);
+
+	m_cursor = nullptr;
+	m_end = nullptr;
+	return found;
+}
+
+//------------------------------------------------------------------------------
+bool SmlParser::parseValue(Variant & out_value)
 {
 	bool found = false;
 
-	while (!found && !input.eof())
+	while (!found && m_cursor != m_end)
 	{
-		const char c = input.peek();
+		const char c = *m_cursor;
 
 		switch (c)
 		{
 		case '/':
 		case '#':
-			parseComment(input);
-			//found = true;
+			parseComment();
 			break;
 
 		case '{':
-			m_lastCharacter = input.get();
+			++m_cursor;
 			out_value.setDictionary();
-			parseObject(input, out_value.getDictionary());
+			parseObject(out_value.getDictionary());
 			found = true;
 			break;
 
 		case '[':
 		case '(':
-			m_lastCharacter = input.get();
+			++m_cursor;
 			out_value.setArray();
-			parseArray(input, out_value.getArray());
+			parseArray(out_value.getArray());
 			found = true;
 			break;
 
 		case '"':
-			m_lastCharacter = input.get();
+			++m_cursor;
 			out_value.setString("");
-			parseString(input, out_value.getString());
+			parseString(out_value.getString());
 			found = true;
 			break;
 
-		case ' ':
-		case '\t':
-			m_lastCharacter = input.get();
-			break;
-
-		case '\n':
-		case '\r':
-			m_lastCharacter = input.get();
-			break;
-
 		default:
-			if (isalpha(c))
+			if (hasClass(c, SML_CC_SPACE))
 			{
-				parseTypedObject(input, out_value);
+				skipWhiteSpace();
+			}
+			else if (hasClass(c, SML_CC_ALPHA))
+			{
+				parseTypedObject(out_value);
 				found = true;
 			}
-			else if (isdigit(c) || c == '-')
+			else if (hasClass(c, SML_CC_VALUE_NUMBER))
 			{
-				parseNumber(input, out_value);
+				parseNumber(out_value);
 				found = true;
 			}
 			else
 			{
 				// Value not found
-				m_lastCharacter = input.get();
+				++m_cursor;
 			}
 			break;
 		}
@@ -83,308 +297,258 @@ bool SmlParser::parseValue(std::istream & input, Variant & out_value)
 }
 
 //------------------------------------------------------------------------------
-void SmlParser::parseNumber(std::istream & input, Variant & out_value)
+void SmlParser::parseNumber(Variant & out_value)
 {
-	std::stringstream ss;
-	//const char lastChar = input.peek();
-	//if (isdigit(lastChar) || lastChar == '-')
-	//{
-	//	ss << lastChar;
-	//}
-
+	const char * begin = m_cursor;
 	VariantType numberType = SN_VT_INT;
 
-	while (!input.eof())
+	while (m_cursor != m_end && hasClass(*m_cursor, SML_CC_NUMBER))
 	{
-		const char c = input.peek();
-		//m_lastCharacter = input.get();
-		//const char c = m_lastCharacter;
-
-		if (!isNumberChar(c))
-		{
-			break;
-		}
-
-		if (c == '.')
-		{
+		if (*m_cursor == '.')
 			numberType = SN_VT_FLOAT;
-		}
-
-		ss << c;
-		m_lastCharacter = input.get();
+		++m_cursor;
 	}
 
+	// strto* functions need a null-terminated string, and the buffer may not be.
+	// Numbers are short, so copy them on the stack.
+	char str[64];
+	const size_t len = std::min(static_cast<size_t>(m_cursor - begin), sizeof(str) - 1);
+	memcpy(str, begin, len);
+	str[len] = '\0';
+
 	if (numberType == SN_VT_FLOAT)
 	{
-		f32 v = 0;
-		ss >> v;
-		out_value.setFloat(v);
+		out_value.setFloat(strtof(str, nullptr));
 	}
 	else
 	{
-		s32 v = 0;
-		ss >> v;
-		out_value.setInt(v);
+		long v = strtol(str, nullptr, 10);
+		if (v > 0x7fffffffL)
+			v = 0x7fffffffL;
+		else if (v < -0x7fffffffL - 1)
+			v = -0x7fffffffL - 1;
+		out_value.setInt(static_cast<s32>(v));
 	}
 }
 
 //------------------------------------------------------------------------------
-void SmlParser::parseComment(std::istream & input)
+void SmlParser::parseComment()
 {
-	while (!input.eof())
-	{
-		char c = input.get();
-		if (c == '\n' || c == '\r')
-			break;
-	}
-	while (!input.eof())
-	{
-		char c = input.peek();
-        if (c != '\n' && c != '\r')
-            break;
-        else
-            input.get();
-	}
+	while (m_cursor != m_end && *m_cursor != '\n' && *m_cursor != '\r')
+		++m_cursor;
+	while (m_cursor != m_end && (*m_cursor == '\n' || *m_cursor == '\r'))
+		++m_cursor;
 }
 
 //------------------------------------------------------------------------------
-void SmlParser::parseObject(std::istream & input, Variant::Dictionary & out_value)
+void SmlParser::parseObject(Variant::Dictionary & out_value)
 {
-	while (!input.eof())
+	// Fields are accumulated on a stack shared by all nesting levels,
+	// so the dictionary can be allocated once with the right size
+	const size_t stackBase = m_fieldStack.size();
+
+	while (m_cursor != m_end)
 	{
-		const char c = input.peek();
+		const char c = *m_cursor;
 
-		if (isalpha(c) || c == '"' || c == '_' || c == '@')
+		if (hasClass(c, SML_CC_KEY_START))
 		{
 			// Parse key
-			std::string key;
-			bool allowSpaces = (c == '"');
-			parseKey(input, key, allowSpaces);
-			Variant & value = out_value[key]; // Access creates the pair
+			const char * keyBegin;
+			const char * keyEnd;
+			parseKey(keyBegin, keyEnd);
+			std::string key(keyBegin, keyEnd);
 
 			// Make sure to read after a ':'
-			if (m_lastCharacter != ':')
-			{
-				skipUntil(input, ':');
-			}
+			skipUntil(':');
 
 			// Parse value
-			parseValue(input, value);
-
-			// If the value parsing encountered the end of the object
-			//if (m_lastCharacter == '}')
-			//{
-			//	m_lastCharacter = input.get();
-			//	break;
-			//}
+			// Note: the stack may grow while parsing, so don't hold a reference in it
+			Variant value;
+			parseValue(value);
+			m_fieldStack.push_back(Field(std::move(key), std::move(value)));
 		}
 		else if (c == '}')
 		{
 			// End of object
-			m_lastCharacter = input.get();
+			++m_cursor;
 			break;
 		}
+		else if (c == '/' || c == '#')
+		{
+			parseComment();
+		}
+		else if (hasClass(c, SML_CC_SPACE))
+		{
+			skipWhiteSpace();
+		}
 		else
 		{
-			m_lastCharacter = input.get();
+			++m_cursor;
 		}
 	}
+
+	out_value.reserve(out_value.size() + m_fieldStack.size() - stackBase);
+	for (size_t i = stackBase; i < m_fieldStack.size(); ++i)
+	{
+		Field & field = m_fieldStack[i];
+		out_value[std::move(field.first)] = std::move(field.second);
+	}
+	m_fieldStack.resize(stackBase);
 }
 
 //------------------------------------------------------------------------------
-/// \brief Starts at a begin quote or an alphanumeric character, ends at a closing quote or non-alphanumeric character
-void SmlParser::parseKey(std::istream & input, std::string & out_value, bool allowSpaces)
+/// \brief Starts at a begin quote or an alphanumeric character, ends after a closing quote or at a non-alphanumeric character.
+/// The returned range points inside the parsed buffer.
+void SmlParser::parseKey(const char *& out_begin, const char *& out_end)
 {
-	//out_value = m_lastCharacter;
-	bool next = true;
-	while (next && !input.eof())
+	if (*m_cursor == '"')
 	{
-		const char c = input.peek();
-
-		switch (c)
-		{
-		case '"':
-			if (m_lastCharacter == '"')
-				next = false;
-			else
-				m_lastCharacter = input.get();
-			break;
-
-		case ' ':
-			if (allowSpaces)
-			{
-				out_value += c;
-				m_lastCharacter = input.get();
-			}
-			else
-				next = false;
-			break;
-
-		default:
-			if (isKeyChar(c))
-			{
-				out_value += c;
-				m_lastCharacter = input.get();
-			}
-			else
-				next = false;
-			break;
-		}
+		++m_cursor;
+		out_begin = m_cursor;
+		const void * quote = memchr(m_cursor, '"', m_end - m_cursor);
+		out_end = quote ? static_cast<const char*>(quote) : m_end;
+		m_cursor = quote ? out_end + 1 : m_end;
+	}
+	else
+	{
+		out_begin = m_cursor;
+		while (m_cursor != m_end && hasClass(*m_cursor, SML_CC_KEY))
+			++m_cursor;
+		out_end = m_cursor;
 	}
 }
 
 //------------------------------------------------------------------------------
-void SmlParser::parseTypedObject(std::istream & input, Variant & out_value)
+void SmlParser::parseTypedObject(Variant & out_value)
 {
 	// Parse type
-	std::string typeKey;
-	parseKey(input, typeKey, false);
+	const char * typeBegin;
+	const char * typeEnd;
+	parseKey(typeBegin, typeEnd);
 
-	if (typeKey == "true")
+	if (equals(typeBegin, typeEnd, "true"))
 	{
 		out_value.setBool(true);
 	}
-	else if (typeKey == "false")
+	else if (equals(typeBegin, typeEnd, "false"))
 	{
 		out_value.setBool(false);
 	}
-	else if (typeKey == "null")
+	else if (equals(typeBegin, typeEnd, "null"))
 	{
 		out_value.reset();
 	}
-	//else
-	//{
-	//	// TODO FIXME There is a leading space in type names!
-	//	// This is a custom typed object
-	//	out_value.resetTypedObject();
-	//	TypedObject & o = *out_value.m_data.pCustom;
-	//	o.typeName = typeKey;
-	//	// Parse value
-	//	// TODO Can the value be a typed object itself?
-	//	parseValue(input, o.value);
-	//}
 }
 
 //------------------------------------------------------------------------------
-void SmlParser::parseArray(std::istream & input, Variant::Array & out_value)
+void SmlParser::parseArray(Variant::Array & out_value)
 {
-	bool next = true;
-	while (next && !input.eof())
+	// Same as objects, elements are accumulated on a stack first
+	const size_t stackBase = m_elementStack.size();
+
+	while (m_cursor != m_end)
 	{
-		const char c = input.peek();
+		const char c = *m_cursor;
 
-		switch (c)
+		if (c == ']' || c == ')')
 		{
-		case ']':
-		case ')':
-            // Check for the end of the array
-			next = false;
-			m_lastCharacter = input.get();
+			// End of the array
+			++m_cursor;
 			break;
-
-		//case '[':
-		//case '(':
-		//	m_lastCharacter = input.get();
-		//	break;
-
-		case ',':
-            // Next element separator
-			m_lastCharacter = input.get();
-			break;
-
-		default:
-            // A value?
-			if (!isWhiteSpace(c))
-			{
-				out_value.push_back(Variant());
-				if (!parseValue(input, out_value.back()))
-				{
-					out_value.pop_back();
-				}
-			}
-			else
+		}
+		else if (c == ',')
+		{
+			// Next element separator
+			++m_cursor;
+		}
+		else if (hasClass(c, SML_CC_SPACE))
+		{
+			skipWhiteSpace();
+		}
+		else
+		{
+			// A value?
+			Variant value;
+			if (parseValue(value))
 			{
-				m_lastCharacter = input.get();
+				m_elementStack.push_back(std::move(value));
 			}
-			break;
 		}
 	}
+
+	out_value.reserve(out_value.size() + m_elementStack.size() - stackBase);
+	for (size_t i = stackBase; i < m_elementStack.size(); ++i)
+	{
+		out_value.push_back(std::move(m_elementStack[i]));
+	}
+	m_elementStack.resize(stackBase);
 }
 
 //------------------------------------------------------------------------------
-void SmlParser::parseString(std::istream & input, Variant::String & out_value)
+/// \brief Starts after the opening quote, ends after the closing quote.
+/// Unescaped runs are copied in bulk. In in-situ mode, the unescaped string is
+/// compacted in the buffer itself and assigned once.
+void SmlParser::parseString(Variant::String & out_value)
 {
-	bool escaping = false;
-	bool inString = true;
-	while (inString && !input.eof())
+	char * dstBegin = m_inSitu ? const_cast<char*>(m_cursor) : nullptr;
+	char * dst = dstBegin;
+
+	while (m_cursor != m_end)
 	{
-		char c = input.get();
-		switch (c)
+		const char * special = findStringSpecial(m_cursor, m_end);
+		const size_t len = special - m_cursor;
+		if (m_inSitu)
 		{
-		case '"':
-			if (escaping)
-			{
-				out_value += c;
-				escaping = false;
-			}
-			else
-				inString = false;
-			break;
+			if (dst != m_cursor)
+				memmove(dst, m_cursor, len);
+			dst += len;
+		}
+		else
+		{
+			out_value.append(m_cursor, len);
+		}
+		m_cursor = special;
 
-		case '\\':
-			if (escaping)
-			{
-				out_value += c;
-				escaping = false;
-			}
-			else
-				escaping = true;
+		if (m_cursor == m_end)
 			break;
 
-		default:
-			if (escaping)
-			{
-				switch (c)
-				{
-				case 'n': c = '\n'; break;
-				case 'r': c = '\r'; break;
-				case 't': c = '\t'; break;
-                default: break;
-				}
-                escaping = false; 
-			}
-			out_value += c;
+		if (*m_cursor == '"')
+		{
+			// End of string
+			++m_cursor;
 			break;
 		}
-	}
-}
 
-//------------------------------------------------------------------------------
-void SmlParser::skipUntil(std::istream & input, char c)
-{
-	while (!input.eof())
-	{
-		if (input.get() == c)
+		// Escape sequence
+		++m_cursor;
+		if (m_cursor == m_end)
 			break;
+		const char c = unescape(*m_cursor);
+		++m_cursor;
+		if (m_inSitu)
+			*dst++ = c;
+		else
+			out_value += c;
 	}
-}
 
-//------------------------------------------------------------------------------
-bool SmlParser::isWhiteSpace(char c)
-{
-	return !!isspace(c);
+	if (m_inSitu)
+		out_value.assign(dstBegin, dst);
 }
 
 //------------------------------------------------------------------------------
-bool SmlParser::isKeyChar(char c)
+void SmlParser::skipWhiteSpace()
 {
-	return isalpha(c) || isdigit(c) || c == '_' || c == '.' || c == '@';
+	m_cursor = skipCommonBlanks(m_cursor, m_end);
+	while (m_cursor != m_end && hasClass(*m_cursor, SML_CC_SPACE))
+		++m_cursor;
 }
 
 //------------------------------------------------------------------------------
-bool SmlParser::isNumberChar(char c)
+void SmlParser::skipUntil(char c)
 {
-	return isdigit(c) || c == '-' || c == '.';
+	const void * p = memchr(m_cursor, c, m_end - m_cursor);
+	m_cursor = p ? static_cast<const char*>(p) + 1 : m_end;
 }
 
 } // namespace sn
@@ -2,6 +2,7 @@
 #define __HEADER_SML_PARSER__
 
 #include <istream>
+#include <vector>
 #include <core/util/Variant.h>
 
 namespace sn
@@ -9,30 +10,62 @@ namespace sn
 
 /// \brief Parses SML byte stream into Variants.
 /// The input can be either JSON or SML.
+/// Parsing always happens on a contiguous memory buffer:
+/// streams and files are read in one go before being parsed.
 class SN_API SmlParser
 {
 public:
 	SmlParser();
 
+	/// \brief Reads the remaining contents of the stream into memory, then parses them.
 	bool parseValue(std::istream & input, Variant & out_value);
 
+	/// \brief Parses a value from a read-only memory buffer.
+	/// \param data: pointer to the first character. The buffer doesn't have to be null-terminated.
+	/// \param size: size of the buffer in bytes
+	bool parseValue(const char * data, size_t size, Variant & out_value);
+
+	/// \brief Parses a value from a mutable memory buffer.
+	/// Strings are unescaped in-situ, which avoids temporary per-character appends.
+	/// The contents of the buffer are undefined after the call.
+	bool parseValueInSitu(char * data, size_t size, Variant & out_value);
+
+	/// \brief Reads a whole file in one go and parses it.
+	/// \return false if the file couldn't be read or no value was found.
+	bool parseFile(const std::string & filePath, Variant & out_value);
+
 private:
-	void parseComment(std::istream & input);
-	void parseObject(std::istream & input, Variant::Dictionary & out_value);
-	void parseKey(std::istream & input, std::string & out_value, bool allowSpaces);
-	void parseTypedObject(std::istream & input, Variant & out_value);
-	void parseArray(std::istream & input, Variant::Array & out_value);
-	void parseNumber(std::istream & input, Variant & out_value);
-	void parseString(std::istream & input, Variant::String & out_value);
+	typedef std::pair<std::string, Variant> Field;
+
+	bool parseBuffer(const char * begin, const char * end, bool inSitu, Variant & out_value);
+
+	bool parseValue(Variant & out_value);
+	void parseComment();
+	void parseObject(Variant::Dictionary & out_value);
+	void parseKey(const char *& out_begin, const char *& out_end);
+	void parseTypedObject(Variant & out_value);
+	void parseArray(Variant::Array & out_value);
+	void parseNumber(Variant & out_value);
+	void parseString(Variant::String & out_value);
 
-	void skipUntil(std::istream & input, char c);
+	void skipWhiteSpace();
+	void skipUntil(char c);
 
-	bool isWhiteSpace(char c);
-	bool isKeyChar(char c);
-	bool isNumberChar(char c);
+	bool readStream(std::istream & input);
 
 private:
-	char m_lastCharacter;
+	/// \brief Current read position
+	const char * m_cursor;
+	/// \brief End of the buffer being parsed (exclusive)
+	const char * m_end;
+	/// \brief Are we allowed to write in the buffer being parsed?
+	bool m_inSitu;
+	/// \brief Storage used when reading streams or files, kept between calls
+	std::vector<char> m_buffer;
+	/// \brief Values of the arrays being parsed, before they get moved in their final container
+	std::vector<Variant> m_elementStack;
+	/// \brief Fields of the objects being parsed, before they get moved in their final container
+	std::vector<Field> m_fieldStack;
 
 };
 
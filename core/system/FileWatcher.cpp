@@ -1,5 +1,6 @@
 #include "FileWatcher.h"
 #include "FilePath.h"
+#include <core/util/Log.h>
 
 // http://stackoverflow.com/questions/931093/how-do-i-make-my-program-watch-for-file-modification-in-c
 
@@ -9,6 +10,8 @@ namespace sn
 FileWatcher::FileWatcher():
     m_enabled(true),
     m_isRecursive(false),
+    m_filterDuplicateEvents(true),
+    m_events(1024),
     m_impl(nullptr)
 {
     m_duplicateEventTimeThreshold = Time::milliseconds(10);
@@ -49,32 +52,57 @@ void FileWatcher::setRecursive(bool r)
 
 bool FileWatcher::popEvent(Event & event)
 {
-    Lock lock(m_eventsMutex);
-    if (!m_events.empty())
-    {
-        event = m_events.back();
-        m_events.pop();
-        return true;
-    }
-    else
+    return m_events.pop(event);
+}
+
+u32 FileWatcher::popEvents(std::vector<Event> & out_events, u32 maxCount)
+{
+    return m_events.popBatch(out_events, maxCount);
+}
+
+void FileWatcher::pushEvent(Event event)
+{
+    event.path = FilePath::normalize(event.path);
+    event.newPath = FilePath::normalize(event.newPath);
+    if (!m_events.push(std::move(event)))
     {
-        return false;
+        SN_WARNING("FileWatcher queue is full, dropped event on " << event.path);
     }
 }
 
-void FileWatcher::pushEvent(Event event)
+void FileWatcher::addPendingEvent(std::vector<Event> & pending, Event event) const
 {
     event.path = FilePath::normalize(event.path);
     event.newPath = FilePath::normalize(event.newPath);
-    Lock lock(m_eventsMutex);
-    if (m_filterDuplicateEvents
-        && !m_events.empty()
-        && m_lastEventTime.restart() >= m_duplicateEventTimeThreshold
-        && m_events.back() == event)
+
+    if (m_filterDuplicateEvents)
+    {
+        // Find the last event concerning the same file
+        for (auto it = pending.rbegin(); it != pending.rend(); ++it)
+        {
+            if (it->path == event.path)
+            {
+                if (*it == event)
+                    return;
+                break;
+            }
+        }
+    }
+
+    pending.push_back(std::move(event));
+}
+
+void FileWatcher::pushEvents(std::vector<Event> & events)
+{
+    for (auto it = events.begin(); it != events.end(); ++it)
     {
-        return;
+        if (!m_events.push(std::move(*it)))
+        {
+            SN_WARNING("FileWatcher queue is full, dropped " << (events.end() - it) << " events");
+            break;
+        }
     }
-    m_events.push(event);
+    events.clear();
 }
 
 void FileWatcher::create()
@@ -2,10 +2,10 @@
 #define __HEADER_SN_FILEWATCHER__
 
 #include <string>
-#include <queue>
-#include <core/system/Lock.h>
-#include <core/system/Clock.h>
+#include <vector>
+#include <core/system/Time.h>
 #include <core/util/NonCopyable.h>
+#include <core/util/MPSCQueue.h>
 
 namespace sn
 {
@@ -15,6 +15,8 @@ class FileWatcherImpl;
 /// \brief Wraps filesystem notifications under a specified path.
 /// It can detect file changes under the path like addition, deletion or modification.
 /// Events are asynchronous and can be retrieved through a queue.
+/// They are gathered by a background thread and published in batches,
+/// which lets duplicates be coalesced before they reach the queue.
 class SN_API FileWatcher : public NonCopyable
 {
 public:
@@ -44,12 +46,12 @@ public:
             isDirectory(false)
         {}
 
-        bool operator==(const Event & other)
+        bool operator==(const Event & other) const
         {
             return type == other.type
                 && path == other.path
                 && newPath == other.newPath
-                && isDirectory == isDirectory;
+                && isDirectory == other.isDirectory;
         }
     };
 
@@ -82,12 +84,31 @@ public:
     /// \return true if an event has been popped, false if there is no event
     bool popEvent(Event & event);
 
+    /// \brief Pops up to maxCount events and appends them to the given vector, oldest first.
+    /// \return Number of events popped
+    u32 popEvents(std::vector<Event> & out_events, u32 maxCount = 64);
+
     /// \brief Pushes a file system event to the internal queue.
     /// \warning This method is reserved for internal use.
     void pushEvent(Event event);
 
+    /// \brief Adds an event to a batch being gathered by the watching thread.
+    /// The path is normalized, and if duplicates filtering is enabled,
+    /// the event is dropped if the last one concerning the same file in the batch is identical.
+    /// \warning This method is reserved for internal use.
+    void addPendingEvent(std::vector<Event> & pending, Event event) const;
+
+    /// \brief Publishes a batch of events to the internal queue, and clears it.
+    /// \warning This method is reserved for internal use.
+    void pushEvents(std::vector<Event> & events);
+
     void setFilterDuplicateEvents(bool enable);
+    bool isFilteringDuplicateEvents() const { return m_filterDuplicateEvents; }
+
+    /// \brief Sets how long the watching thread waits for more events before publishing a batch.
+    /// Duplicates are only coalesced within a batch.
     void setDuplicateEventsFilterTimeThreshold(Time threshold);
+    Time getDuplicateEventsFilterTimeThreshold() const { return m_duplicateEventTimeThreshold; }
 
 private:
     void create();
@@ -103,10 +124,8 @@ private:
     bool m_filterDuplicateEvents;
     Time m_duplicateEventTimeThreshold;
     std::string m_watchedPath;
-    std::queue<Event> m_events;
-    Mutex m_eventsMutex;
+    MPSCQueue<Event> m_events;
     FileWatcherImpl * m_impl;
-    Clock m_lastEventTime;
 
 };
 
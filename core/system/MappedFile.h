@@ -0,0 +1,47 @@
+/*
+MappedFile.h
+Copyright (C) 2015-2015 Marc GILLERON
+This file is part of the SnowfeetEngine project.
+*/
+
+#ifndef __HEADER_SN_MAPPEDFILE__
+#define __HEADER_SN_MAPPEDFILE__
+
+#include <core/util/NonCopyable.h>
+#include <core/util/String.h>
+
+namespace sn
+{
+
+class MappedFileImpl;
+
+/// \brief Read-only view of a whole file in memory.
+/// Pages are read by the OS when they are accessed, and don't count as allocated memory,
+/// so parsers can read files without copying them into a buffer first.
+class SN_API MappedFile : NonCopyable
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    /// \brief Maps a file, closing the previous one if any.
+    /// \return false if the file can't be opened or is empty
+    bool open(const String & filePath);
+    void close();
+
+    bool isOpen() const { return m_data != nullptr; }
+
+    /// \brief Gets the contents of the file. They stay valid until the file is closed.
+    const u8 * getData() const { return m_data; }
+    size_t getSize() const { return m_size; }
+
+private:
+    MappedFileImpl * m_impl;
+    const u8 * m_data;
+    size_t m_size;
+};
+
+} // namespace sn
+
+#endif // __HEADER_SN_MAPPEDFILE__
+
@@ -6,6 +6,8 @@ This file is part of the SnowfeetEngine project.
 
 #include "SystemGUI.h"
 #include "../util/assert.h"
+#include "../util/Log.h"
+#include "Lock.h"
 
 namespace sn
 {
@@ -19,7 +21,9 @@ SystemGUI & SystemGUI::get()
 
 //------------------------------------------------------------------------------
 SystemGUI::SystemGUI():
-    m_nextWindowID(0)
+    m_nextWindowID(0),
+    m_events(1024),
+    m_hasOverflow(false)
 {
     onCreate();
     initImpl();
@@ -124,20 +128,47 @@ u32 SystemGUI::makeWindowID()
 //------------------------------------------------------------------------------
 void SystemGUI::pushEvent(Event e)
 {
-    m_events.push(e);
+    if (!m_hasOverflow.load(std::memory_order_acquire) && m_events.push(std::move(e)))
+        return;
+
+    // The queue is full, or was full and the consumer didn't catch up yet.
+    // push() leaves the event untouched when it fails.
+    Lock lock(m_overflowMutex);
+    if (m_overflowEvents.empty())
+    {
+        if (m_events.push(std::move(e)))
+            return;
+        SN_WARNING("SystemGUI event queue is full, storing events in an overflow list");
+    }
+    m_overflowEvents.push_back(std::move(e));
+    m_hasOverflow.store(true, std::memory_order_release);
 }
 
 //------------------------------------------------------------------------------
 bool SystemGUI::popEvent(Event & e)
 {
-    if (m_events.empty())
-        return false;
-    else
+    return popEvents(&e, 1) != 0;
+}
+
+//------------------------------------------------------------------------------
+u32 SystemGUI::popEvents(Event * out_events, u32 maxCount)
+{
+    u32 count = static_cast<u32>(m_events.popBatch(out_events, maxCount));
+
+    // Overflowing events came after everything in the queue
+    if (count < maxCount && m_events.isEmpty() && m_hasOverflow.load(std::memory_order_acquire))
     {
-        e = m_events.front();
-        m_events.pop();
-        return true;
+        Lock lock(m_overflowMutex);
+        while (count < maxCount && !m_overflowEvents.empty())
+        {
+            out_events[count++] = std::move(m_overflowEvents.front());
+            m_overflowEvents.pop_front();
+        }
+        if (m_overflowEvents.empty())
+            m_hasOverflow.store(false, std::memory_order_release);
     }
+
+    return count;
 }
 
 } // namespace sn
@@ -12,10 +12,13 @@ This file is part of the SnowfeetEngine project.
 #include <core/system/Event.h>
 #include <core/math/Vector2.h>
 #include <core/system/Cursor.h>
+#include <core/util/MPSCQueue.h>
+#include <core/system/Mutex.h>
 
 #include <vector>
 #include <map>
-#include <queue>
+#include <deque>
+#include <atomic>
 
 namespace sn
 {
@@ -65,9 +68,14 @@ public:
     void refWindow(Window & win);
     void unrefWindow(Window & win);
 
+    /// \brief Pushes a system event. Can be called from any thread.
     void pushEvent(Event e);
     bool popEvent(Event & e);
 
+    /// \brief Pops up to maxCount events in one go, oldest first.
+    /// \return Number of events written in out_events
+    u32 popEvents(Event * out_events, u32 maxCount);
+
 private:
     // TODO These two functions are not used?
     void onCreate();
@@ -83,7 +91,13 @@ private:
     std::map<u32, Window*> m_idToWindow;
     u32 m_nextWindowID;
 
-    std::queue<Event> m_events;
+    MPSCQueue<Event> m_events;
+
+    // Events that didn't fit in the queue. While there are some, new events go there too,
+    // so they are still popped in order.
+    Mutex m_overflowMutex;
+    std::deque<Event> m_overflowEvents;
+    std::atomic<bool> m_hasOverflow;
 
     SystemGUIImpl * m_impl;
 };
@@ -5,6 +5,7 @@ This file is part of the SnowfeetEngine project.
 */
 
 #include "Thread.h"
+#include <thread>
 
 namespace sn
 {
@@ -25,5 +26,13 @@ void Thread::run()
     }
 }
 
+//------------------------------------------------------------------------------
+u32 Thread::getHardwareConcurrency()
+{
+    // Can be 0 if the information is not available
+    u32 count = std::thread::hardware_concurrency();
+    return count > 0 ? count : 1;
+}
+
 } // namespace sn
 
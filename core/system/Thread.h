@@ -30,6 +30,10 @@ public:
 
     static void sleep(Time duration);
 
+    /// \brief Gets how many threads can run at the same time on this machine.
+    /// \return Number of hardware threads, at least 1
+    static u32 getHardwareConcurrency();
+
 private:
     friend class ThreadImpl;
 
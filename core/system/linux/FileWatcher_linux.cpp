@@ -0,0 +1,320 @@
+#include <core/util/Log.h>
+#include <core/system/FilePath.h>
+#include "FileWatcher_linux.h"
+
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace sn
+{
+
+//=============================================================================
+// Helpers
+//=============================================================================
+
+// Changes we want to be notified for
+const u32 WATCH_MASK =
+      IN_CREATE
+    | IN_DELETE
+    | IN_MODIFY
+    | IN_CLOSE_WRITE
+    | IN_ATTRIB
+    | IN_MOVED_FROM
+    | IN_MOVED_TO
+;
+
+// Publish events without waiting if that many are gathered
+const size_t MAX_PENDING_EVENTS = 256;
+
+//=============================================================================
+// FileWatcher
+//=============================================================================
+
+void FileWatcher::createImpl()
+{
+    m_impl = new FileWatcherImpl(*this);
+}
+
+void FileWatcher::destroyImpl()
+{
+    delete m_impl;
+}
+
+//=============================================================================
+// Impl
+//=============================================================================
+
+FileWatcherImpl::FileWatcherImpl(FileWatcher & owner):
+    r_owner(owner),
+    m_continueWatching(true),
+    m_isActive(false),
+    m_fd(-1)
+{
+    m_watcherThread = std::thread([this](){
+        startWatching(r_owner.getPath(), r_owner.isRecursive());
+    });
+}
+
+FileWatcherImpl::~FileWatcherImpl()
+{
+    m_continueWatching = false;
+    if (m_watcherThread.joinable())
+        m_watcherThread.join();
+}
+
+bool FileWatcherImpl::isActive() const
+{
+    return m_isActive;
+}
+
+void FileWatcherImpl::addWatch(const std::string & rootPath, const std::string & relativePath, bool recursive)
+{
+    std::string fullPath = relativePath.empty() ? rootPath : FilePath::join(rootPath, relativePath);
+
+    int wd = ::inotify_add_watch(m_fd, fullPath.c_str(), WATCH_MASK);
+    if (wd < 0)
+    {
+        SN_ERROR("Failed to watch '" << fullPath << "': " << strerror(errno));
+        return;
+    }
+    m_watchedDirs[wd] = relativePath;
+
+    if (!recursive)
+        return;
+
+    // inotify is not recursive, so we have to watch each sub-directory
+    DIR * dir = ::opendir(fullPath.c_str());
+    if (dir == nullptr)
+        return;
+
+    while (const dirent * entry = ::readdir(dir))
+    {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+
+        std::string childPath = relativePath.empty() ? entry->d_name : FilePath::join(relativePath, entry->d_name);
+
+        bool isDirectory = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN)
+        {
+            // Some filesystems don't fill d_type.
+            // Note: lstat, so we don't follow symlinks and risk cycles
+            struct stat st;
+            std::string childFullPath = FilePath::join(rootPath, childPath);
+            isDirectory = ::lstat(childFullPath.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+        }
+
+        if (isDirectory)
+            addWatch(rootPath, childPath, true);
+    }
+
+    ::closedir(dir);
+}
+
+void FileWatcherImpl::readEvents(std::vector<FileWatcher::Event> & pendingEvents, const std::string & rootPath, bool recursive)
+{
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    for (;;)
+    {
+        ssize_t len = ::read(m_fd, buffer, sizeof(buffer));
+        if (len <= 0)
+        {
+            if (len < 0 && errno != EAGAIN && errno != EINTR)
+                SN_ERROR("FileWatcher failed to read inotify events: " << strerror(errno));
+            break;
+        }
+
+        // Iterate over notifications
+        const char * p = buffer;
+        while (p < buffer + len)
+        {
+            const inotify_event * ie = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + ie->len;
+
+            if (ie->mask & IN_Q_OVERFLOW)
+            {
+                SN_WARNING("FileWatcher: inotify queue overflowed, some events were lost");
+                continue;
+            }
+
+            if (ie->mask & IN_IGNORED)
+            {
+                // The directory was removed or unmounted
+                m_watchedDirs.erase(ie->wd);
+                continue;
+            }
+
+            auto dirIt = m_watchedDirs.find(ie->wd);
+            if (dirIt == m_watchedDirs.end() || ie->len == 0)
+            {
+                // Unknown watch, or event concerning the watched directory itself
+                continue;
+            }
+
+            // Note: the path is relative to the watched directory
+            const std::string & dirPath = dirIt->second;
+            std::string path = dirPath.empty() ? std::string(ie->name) : FilePath::join(dirPath, ie->name);
+
+            FileWatcher::Event ev;
+            ev.isDirectory = (ie->mask & IN_ISDIR) != 0;
+
+            if (ie->mask & IN_CREATE)
+            {
+                ev.type = FileWatcher::FILE_ADDED;
+                if (ev.isDirectory && recursive)
+                    addWatch(rootPath, path, true);
+            }
+            else if (ie->mask & IN_DELETE)
+            {
+                ev.type = FileWatcher::FILE_REMOVED;
+            }
+            else if (ie->mask & (IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB))
+            {
+                // Writing a file usually gives several of these in a row, they get coalesced
+                ev.type = FileWatcher::FILE_MODIFIED;
+            }
+            else if (ie->mask & IN_MOVED_FROM)
+            {
+                // Wait for the IN_MOVED_TO with the same cookie.
+                // If it doesn't come, the file was moved out of the watched directory.
+                ev.type = FileWatcher::FILE_REMOVED;
+                ev.path = path;
+                m_pendingMoves[ie->cookie] = std::move(ev);
+                continue;
+            }
+            else if (ie->mask & IN_MOVED_TO)
+            {
+                auto moveIt = m_pendingMoves.find(ie->cookie);
+                if (moveIt != m_pendingMoves.end())
+                {
+                    ev.type = FileWatcher::FILE_RENAMED;
+                    ev.newPath = path;
+                    path = moveIt->second.path;
+                    m_pendingMoves.erase(moveIt);
+
+                    if (ev.isDirectory)
+                    {
+                        // Update paths of the directories we watch in the moved one
+                        const std::string & oldPrefix = path;
+                        for (auto it = m_watchedDirs.begin(); it != m_watchedDirs.end(); ++it)
+                        {
+                            std::string & watchedPath = it->second;
+                            if (watchedPath.compare(0, oldPrefix.size(), oldPrefix) == 0
+                                && (watchedPath.size() == oldPrefix.size() || watchedPath[oldPrefix.size()] == '/'))
+                            {
+                                watchedPath = ev.newPath + watchedPath.substr(oldPrefix.size());
+                            }
+                        }
+                    }
+                }
+                else
+                {
+                    // Moved from outside the watched directory
+                    ev.type = FileWatcher::FILE_ADDED;
+                    if (ev.isDirectory && recursive)
+                        addWatch(rootPath, path, true);
+                }
+            }
+            else
+            {
+                continue;
+            }
+
+            ev.path = path;
+            r_owner.addPendingEvent(pendingEvents, std::move(ev));
+        }
+    }
+}
+
+void FileWatcherImpl::startWatching(std::string pathStr, bool recursive)
+{
+    SN_LOG("FileWatcher thread begin at '" << pathStr << "'");
+
+    m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0)
+    {
+        SN_ERROR("An error occurred while creating a FileWatcher handle: " << strerror(errno));
+        return;
+    }
+
+    addWatch(pathStr, "", recursive);
+
+    if (m_watchedDirs.empty())
+    {
+        ::close(m_fd);
+        m_fd = -1;
+        return;
+    }
+
+    m_isActive = true;
+
+    const int idleTimeoutMilliseconds = 100;
+
+    // Events gathered since the last time we published them
+    std::vector<FileWatcher::Event> pendingEvents;
+
+    pollfd pfd;
+    pfd.fd = m_fd;
+    pfd.events = POLLIN;
+
+    while (m_continueWatching)
+    {
+        // While events are pending, only wait a short time for more of them so they can be coalesced
+        int waitTimeoutMilliseconds = pendingEvents.empty() && m_pendingMoves.empty() ?
+            idleTimeoutMilliseconds :
+            r_owner.getDuplicateEventsFilterTimeThreshold().asMilliseconds();
+
+        pfd.revents = 0;
+        int pollResult = ::poll(&pfd, 1, waitTimeoutMilliseconds);
+
+        if (pollResult < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            SN_ERROR("FileWatcher poll failed: " << strerror(errno));
+            break;
+        }
+
+        if (pollResult == 0)
+        {
+            // Timeout: moves that were not paired went out of the watched directory
+            for (auto it = m_pendingMoves.begin(); it != m_pendingMoves.end(); ++it)
+                r_owner.addPendingEvent(pendingEvents, std::move(it->second));
+            m_pendingMoves.clear();
+
+            if (!pendingEvents.empty())
+                r_owner.pushEvents(pendingEvents);
+            continue;
+        }
+
+        readEvents(pendingEvents, pathStr, recursive);
+
+        if (!r_owner.isFilteringDuplicateEvents() || pendingEvents.size() >= MAX_PENDING_EVENTS)
+            r_owner.pushEvents(pendingEvents);
+
+    } // while m_continueWatching
+
+    for (auto it = m_pendingMoves.begin(); it != m_pendingMoves.end(); ++it)
+        r_owner.addPendingEvent(pendingEvents, std::move(it->second));
+    m_pendingMoves.clear();
+
+    if (!pendingEvents.empty())
+        r_owner.pushEvents(pendingEvents);
+
+    // Closing the descriptor removes all watches
+    ::close(m_fd);
+    m_fd = -1;
+    m_watchedDirs.clear();
+    m_isActive = false;
+
+    SN_LOG("FileWatcher thread end");
+}
+
+} // namespace sn
+
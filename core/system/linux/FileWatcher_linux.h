@@ -0,0 +1,53 @@
+#ifndef __HEADER_SN_FILEWATCHER_LINUX__
+#define __HEADER_SN_FILEWATCHER_LINUX__
+
+#include <core/system/FileWatcher.h>
+
+#include <thread>
+#include <atomic>
+#include <unordered_map>
+
+namespace sn
+{
+
+/// \cond INTERNAL
+
+/// \brief Represents an inotify watching session over a defined path.
+/// Must be re-created to change.
+class FileWatcherImpl
+{
+public:
+    FileWatcherImpl(FileWatcher & owner);
+    ~FileWatcherImpl();
+
+    bool isActive() const;
+
+private:
+    void startWatching(std::string pathStr, bool recursive);
+
+    /// \brief Adds a watch on a directory, and on its sub-directories if recursive.
+    /// \param relativePath: path of the directory relative to the watched root
+    void addWatch(const std::string & rootPath, const std::string & relativePath, bool recursive);
+
+    void readEvents(std::vector<FileWatcher::Event> & pendingEvents, const std::string & rootPath, bool recursive);
+
+private:
+    FileWatcher & r_owner;
+    // Note: sn::Thread has no Linux backend yet
+    std::thread m_watcherThread;
+    std::atomic<bool> m_continueWatching;
+    std::atomic<bool> m_isActive;
+    int m_fd;
+    // Watch descriptors and the directories they are associated to, relative to the root
+    std::unordered_map<int, std::string> m_watchedDirs;
+    // There are two messages for renaming, so we need to memorize the first one.
+    // They are paired with a cookie.
+    std::unordered_map<u32, FileWatcher::Event> m_pendingMoves;
+};
+
+/// \endcond
+
+} // namespace sn
+
+#endif // __HEADER_SN_FILEWATCHER_LINUX__
+
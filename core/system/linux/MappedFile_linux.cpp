@@ -0,0 +1,87 @@
+#include "../MappedFile.h"
+#include <core/util/stringutils.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sn
+{
+
+/// \cond INTERNAL
+class MappedFileImpl
+{
+public:
+    MappedFileImpl() : fd(-1), address(MAP_FAILED), size(0) {}
+
+    ~MappedFileImpl()
+    {
+        if (address != MAP_FAILED)
+            munmap(address, size);
+        if (fd != -1)
+            ::close(fd);
+    }
+
+    int fd;
+    void * address;
+    size_t size;
+};
+/// \endcond
+
+//------------------------------------------------------------------------------
+MappedFile::MappedFile() :
+    m_impl(nullptr),
+    m_data(nullptr),
+    m_size(0)
+{
+}
+
+//------------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+//------------------------------------------------------------------------------
+bool MappedFile::open(const String & filePath)
+{
+    close();
+
+    MappedFileImpl * impl = new MappedFileImpl();
+    impl->fd = ::open(toString(filePath).c_str(), O_RDONLY);
+
+    struct stat info;
+    if (impl->fd == -1 || fstat(impl->fd, &info) != 0 || info.st_size <= 0)
+    {
+        delete impl;
+        return false;
+    }
+
+    impl->size = static_cast<size_t>(info.st_size);
+    impl->address = mmap(nullptr, impl->size, PROT_READ, MAP_PRIVATE, impl->fd, 0);
+    if (impl->address == MAP_FAILED)
+    {
+        delete impl;
+        return false;
+    }
+
+    // Files are mostly parsed from start to end
+    madvise(impl->address, impl->size, MADV_SEQUENTIAL);
+
+    m_impl = impl;
+    m_data = static_cast<const u8*>(impl->address);
+    m_size = impl->size;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void MappedFile::close()
+{
+    delete m_impl;
+    m_impl = nullptr;
+    m_data = nullptr;
+    m_size = 0;
+}
+
+} // namespace sn
+
@@ -0,0 +1,48 @@
+#include "../ThreadLocal.h"
+#include <core/util/assert.h>
+#include <pthread.h>
+
+namespace sn
+{
+
+/// \cond INTERNAL
+class ThreadLocalImpl
+{
+public:
+	ThreadLocalImpl() : key(0)
+	{
+		int result = pthread_key_create(&key, nullptr);
+		SN_ASSERT(result == 0, "Couldn't allocate thread-local storage (pthread)");
+	}
+	~ThreadLocalImpl()
+	{
+		pthread_key_delete(key);
+	}
+
+	pthread_key_t key;
+};
+/// \endcond
+
+ThreadLocal::ThreadLocal(void* value /* = nullptr */)
+{
+	m_impl = new ThreadLocalImpl();
+	set(value);
+}
+
+ThreadLocal::~ThreadLocal()
+{
+	delete m_impl;
+}
+
+void* ThreadLocal::get() const
+{
+	return pthread_getspecific(m_impl->key);
+}
+
+void ThreadLocal::set(void* ptr)
+{
+	pthread_setspecific(m_impl->key, ptr);
+}
+
+} // namespace sn
+
@@ -0,0 +1,57 @@
+/*
+parallel.h
+Copyright (C) 2015-2015 Marc GILLERON
+This file is part of the SnowfeetEngine project.
+*/
+
+#ifndef __HEADER_SN_PARALLEL__
+#define __HEADER_SN_PARALLEL__
+
+#include <core/system/Thread.h>
+#include <vector>
+#include <algorithm>
+
+namespace sn
+{
+
+/// \brief Calls job(begin, end) over contiguous ranges of [0, count[, from the given number of threads.
+/// The calling thread processes the first range, and the function returns when all ranges are done.
+/// \note Threads are created for each call, so this is meant for jobs of at least a few milliseconds.
+template <typename Job_T>
+void parallelFor(u32 count, u32 threadCount, const Job_T & job)
+{
+    if (threadCount > count)
+        threadCount = count;
+    if (threadCount <= 1)
+    {
+        job(0, count);
+        return;
+    }
+
+    u32 chunkSize = (count + threadCount - 1) / threadCount;
+
+    std::vector<Thread*> threads;
+    for (u32 begin = chunkSize; begin < count; begin += chunkSize)
+    {
+        u32 end = std::min(begin + chunkSize, count);
+        Thread * thread = new Thread([&job, begin, end](){
+            job(begin, end);
+        });
+        thread->start();
+        threads.push_back(thread);
+    }
+
+    // The calling thread does its share too
+    job(0, std::min(chunkSize, count));
+
+    for (auto it = threads.begin(); it != threads.end(); ++it)
+    {
+        (*it)->wait();
+        delete *it;
+    }
+}
+
+} // namespace sn
+
+#endif // __HEADER_SN_PARALLEL__
+
@@ -2,6 +2,7 @@
 #include <core/system/FilePath.h>
 #include "FileWatcher_win32.h"
 #include "../win32/helpers_win32.h"
+#include <vector>
 
 // Based on this code
 // https://developersarea.wordpress.com/2014/09/26/win32-file-watcher-api-to-monitor-directory-changes/
@@ -23,6 +24,9 @@ private:
     T * m_aptr;
 };
 
+// Publish events without waiting if that many are gathered
+const size_t MAX_PENDING_EVENTS = 256;
+
 //=============================================================================
 // FileWatcher
 //=============================================================================
@@ -116,36 +120,51 @@ void FileWatcherImpl::startWatching(std::string pathStr, bool recursive)
 
     // Used for asynchronous I/O
     OVERLAPPED pollingOverlap;
-    pollingOverlap.OffsetHigh = 0;
+    ZeroMemory(&pollingOverlap, sizeof(pollingOverlap));
     pollingOverlap.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
 
-    DWORD waitTimeoutMilliseconds = 100;
+    DWORD idleTimeoutMilliseconds = 100;
+    bool isReadPending = false;
+
+    // Events gathered since the last time we published them
+    std::vector<FileWatcher::Event> pendingEvents;
 
     while (m_continueWatching)
     {
-        DWORD nRet = 0;
-        BOOL result = ::ReadDirectoryChangesW(
-            hDir, // handle to the directory to be watched
-            &resultsBuffer, // pointer to the buffer to receive the read results
-            sizeof(resultsBuffer), // length of resultsBuffer
-            recursive ? TRUE : FALSE, // flag for monitoring directory or directory tree
-            dwNotifyFilter,
-            &nRet, // number of bytes returned
-            &pollingOverlap,// pointer to structure needed for overlapped I/O
-            NULL
-        );
-
-        if (result == 0)
+        if (!isReadPending)
         {
-            SN_ERROR("Failed to ReadDirectoryChangesW: " << win32::getLastError());
-            break;
+            BOOL result = ::ReadDirectoryChangesW(
+                hDir, // handle to the directory to be watched
+                &resultsBuffer, // pointer to the buffer to receive the read results
+                sizeof(resultsBuffer), // length of resultsBuffer
+                recursive ? TRUE : FALSE, // flag for monitoring directory or directory tree
+                dwNotifyFilter,
+                NULL, // number of bytes returned (undefined for asynchronous calls)
+                &pollingOverlap,// pointer to structure needed for overlapped I/O
+                NULL
+            );
+
+            if (result == 0)
+            {
+                SN_ERROR("Failed to ReadDirectoryChangesW: " << win32::getLastError());
+                break;
+            }
+
+            isReadPending = true;
         }
 
+        // While events are pending, only wait a short time for more of them so they can be coalesced
+        DWORD waitTimeoutMilliseconds = pendingEvents.empty() ? 
+            idleTimeoutMilliseconds : 
+            r_owner.getDuplicateEventsFilterTimeThreshold().asMilliseconds();
+
         // Wait for events
         DWORD waitResult = ::WaitForSingleObject(pollingOverlap.hEvent, waitTimeoutMilliseconds);
 
         if (waitResult == WAIT_TIMEOUT)
         {
+            if (!pendingEvents.empty())
+                r_owner.pushEvents(pendingEvents);
             continue;
         }
 
@@ -161,6 +180,15 @@ void FileWatcherImpl::startWatching(std::string pathStr, bool recursive)
             continue;
         }
 
+        isReadPending = false;
+
+        DWORD nRet = 0;
+        if (!::GetOverlappedResult(hDir, &pollingOverlap, &nRet, FALSE) || nRet == 0)
+        {
+            // The buffer overflowed, or the read failed
+            continue;
+        }
+
         int offset = 0;
         FILE_NOTIFY_INFORMATION * pNotification = nullptr;
 
@@ -193,21 +221,21 @@ void FileWatcherImpl::startWatching(std::string pathStr, bool recursive)
             case FILE_ACTION_ADDED:
                 ev.type = FileWatcher::FILE_ADDED;
                 ev.path = filename;
-                r_owner.pushEvent(ev);
+                r_owner.addPendingEvent(pendingEvents, std::move(ev));
                 //SN_LOG("The file is added to the directory: " << filename);
                 break;
 
             case FILE_ACTION_REMOVED:
                 ev.type = FileWatcher::FILE_REMOVED;
                 ev.path = filename;
-                r_owner.pushEvent(ev);
+                r_owner.addPendingEvent(pendingEvents, std::move(ev));
                 //SN_LOG("The file is removed from the directory: " << filename);
                 break;
 
             case FILE_ACTION_MODIFIED:
                 ev.type = FileWatcher::FILE_MODIFIED;
                 ev.path = filename;
-                r_owner.pushEvent(ev);
+                r_owner.addPendingEvent(pendingEvents, std::move(ev));
                 //SN_LOG("The file is modified. This can be a change in the time stamp or attributes: " << filename);
                 break;
 
@@ -220,7 +248,7 @@ void FileWatcherImpl::startWatching(std::string pathStr, bool recursive)
                 ev.type = FileWatcher::FILE_RENAMED;
                 ev.path = m_oldFileName;
                 ev.newPath = filename;
-                r_owner.pushEvent(ev);
+                r_owner.addPendingEvent(pendingEvents, std::move(ev));
                 //SN_LOG("The file was renamed and this is the new name: " << filename);
                 break;
 
@@ -233,8 +261,21 @@ void FileWatcherImpl::startWatching(std::string pathStr, bool recursive)
        
         } while(pNotification->NextEntryOffset); //(offset != 0);
 
+        if (!r_owner.isFilteringDuplicateEvents() || pendingEvents.size() >= MAX_PENDING_EVENTS)
+            r_owner.pushEvents(pendingEvents);
+
     } // while m_continueWatching
 
+    if (isReadPending)
+    {
+        // Don't let the system write into our buffer after we leave
+        ::CancelIo(hDir);
+    }
+
+    if (!pendingEvents.empty())
+        r_owner.pushEvents(pendingEvents);
+
+    CloseHandle(pollingOverlap.hEvent);
     CloseHandle(hDir);
 
     SN_LOG("FileWatcher thread end");
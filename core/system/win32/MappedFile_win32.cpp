@@ -0,0 +1,97 @@
+/*
+MappedFile_win32.cpp
+Copyright (C) 2015-2015 Marc GILLERON
+This file is part of the SnowfeetEngine project.
+*/
+
+#include "../MappedFile.h"
+#include "../FilePath.h"
+#include <Windows.h>
+
+namespace sn
+{
+
+/// \cond INTERNAL
+class MappedFileImpl
+{
+public:
+    MappedFileImpl() :
+        file(INVALID_HANDLE_VALUE),
+        mapping(NULL),
+        view(NULL)
+    {}
+
+    ~MappedFileImpl()
+    {
+        if (view)
+            UnmapViewOfFile(view);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+    }
+
+    HANDLE file;
+    HANDLE mapping;
+    LPVOID view;
+};
+/// \endcond
+
+//------------------------------------------------------------------------------
+MappedFile::MappedFile() :
+    m_impl(nullptr),
+    m_data(nullptr),
+    m_size(0)
+{
+}
+
+//------------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+//------------------------------------------------------------------------------
+bool MappedFile::open(const String & filePath)
+{
+    close();
+
+    MappedFileImpl * impl = new MappedFileImpl();
+
+    // Files are mostly parsed from start to end
+    impl->file = CreateFileW(FilePath::platformize(filePath).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+    LARGE_INTEGER size;
+    if (impl->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(impl->file, &size) || size.QuadPart <= 0)
+    {
+        delete impl;
+        return false;
+    }
+
+    impl->mapping = CreateFileMappingW(impl->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (impl->mapping)
+        impl->view = MapViewOfFile(impl->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (impl->view == NULL)
+    {
+        delete impl;
+        return false;
+    }
+
+    m_impl = impl;
+    m_data = static_cast<const u8*>(impl->view);
+    m_size = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void MappedFile::close()
+{
+    delete m_impl;
+    m_impl = nullptr;
+    m_data = nullptr;
+    m_size = 0;
+}
+
+} // namespace sn
+
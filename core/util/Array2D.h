@@ -13,6 +13,7 @@ This file is part of the SnowfeetEngine project.
 #include <core/math/Vector2.h>
 #include <core/util/Exception.h>
 #include <core/util/Log.h>
+#include <core/util/ArrayLayouts.h>
 
 namespace sn
 {
@@ -21,9 +22,11 @@ namespace sn
     Bi-dimensionnal flat array.
     Static because it is not resizeable,
     dynamic because it can be re-created without destroy its instance.
+    The order of cells in memory is given by a layout (see ArrayLayouts.h),
+    row-major by default.
 */
 
-template <typename T>
+template <typename T, typename Layout_T = RowMajorLayout2D>
 class Array2D
 {
 public :
@@ -50,7 +53,8 @@ public :
         else
         {
             // Allocate memory
-            m_data = new T[area()];
+            m_layout.create(m_sizeX, m_sizeY);
+            m_data = new T[m_layout.getCapacity()];
         }
     }
 
@@ -68,7 +72,8 @@ public :
         else
         {
             // Allocate memory
-            m_data = new T[area()];
+            m_layout.create(m_sizeX, m_sizeY);
+            m_data = new T[m_layout.getCapacity()];
         }
 
         fill(value);
@@ -85,30 +90,43 @@ public :
         clear();
     }
 
-    Array2D<T> & operator=(const Array2D<T> & other)
+    Array2D & operator=(const Array2D & other)
     {
         copyFrom(other);
         return *this;
     }
 
+    // Accesses the storage directly. Cells are in the order of the layout.
     inline T * raw()
     {
         return m_data;
     }
 
+    inline const T * raw() const
+    {
+        return m_data;
+    }
+
     // Accesses directly the flat array.
-    // i must be in [0, area()[.
+    // i must be in [0, capacity()[.
     // i can be computed with getLocation(x,y).
     inline T & operator[](u32 i)
     {
         return m_data[i];
     }
 
+    inline const T & operator[](u32 i) const
+    {
+        return m_data[i];
+    }
+
     inline u32 getLocation(u32 x, u32 y) const
     {
-        return m_sizeX * y + x;
+        return m_layout.getLocation(x, y);
     }
 
+    inline const Layout_T & getLayout() const { return m_layout; }
+
     // creates the buffer from the specified area.
     // old data is cleared.
     // Note : data values are not initialized, use the fill() function if necessary.
@@ -132,13 +150,14 @@ public :
         else
         {
             // Allocate memory
-            m_data = new T[area()];
+            m_layout.create(m_sizeX, m_sizeY);
+            m_data = new T[m_layout.getCapacity()];
         }
     }
 
     // Copies data from another array into this one.
     // Copy an empty array will clear this one.
-    void copyFrom(const Array2D<T> & other)
+    void copyFrom(const Array2D & other)
     {
         if(other.empty())
         {
@@ -147,7 +166,7 @@ public :
         else
         {
             create(other.sizeX(), other.sizeY());
-            memcpy(m_data, other.m_data, area() * sizeof(T));
+            memcpy(m_data, other.m_data, capacity() * sizeof(T));
         }
     }
 
@@ -157,6 +176,12 @@ public :
         return m_sizeX * m_sizeY;
     }
 
+    // Returns the count of cells in storage, which can be more than area() if the layout uses padding
+    inline u32 capacity() const
+    {
+        return m_data == nullptr ? 0 : m_layout.getCapacity();
+    }
+
     inline u32 sizeX() const { return m_sizeX; }
     inline u32 sizeY() const { return m_sizeY; }
 
@@ -182,11 +207,31 @@ public :
     void fill(const T & val)
     {
         // TODO optimize for byte-size types (memset)
-        const u32 vol = area();
+        const u32 vol = capacity();
         for(u32 i = 0; i < vol; ++i)
             m_data[i] = val;
     }
 
+    // Calls f(x, y, value) for each cell, in storage order.
+    // With tiled layouts, this goes block by block, which is faster than nested loops on X and Y.
+    template <typename Func_T>
+    void forEach(Func_T f)
+    {
+        T * data = m_data;
+        m_layout.forEachLocation([&f, data](u32 x, u32 y, u32 i) {
+            f(x, y, data[i]);
+        });
+    }
+
+    template <typename Func_T>
+    void forEach(Func_T f) const
+    {
+        const T * data = m_data;
+        m_layout.forEachLocation([&f, data](u32 x, u32 y, u32 i) {
+            f(x, y, data[i]);
+        });
+    }
+
     // get an element without position validation (it must be valid !)
     inline T getNoEx(s32 x, s32 y) const
     {
@@ -247,7 +292,7 @@ public :
     // (convenience)
     inline u32 byteCount() const
     {
-        return area() * elementByteCount();
+        return capacity() * elementByteCount();
     }
 
 #ifdef __HEADER_SN_VECTOR2__
@@ -270,7 +315,7 @@ public :
     // (convenience)
     inline T get(const Vector2i & pos) const
     {
-        get(pos.x(), pos.y());
+        return get(pos.x(), pos.y());
     }
 
     // get an element without position validation (it must be valid !)
@@ -287,6 +332,7 @@ private :
     T * m_data;	// linear data storage (nullptr if empty)
     u32 m_sizeX;
     u32 m_sizeY;
+    Layout_T m_layout;
 
 };
 
@@ -13,15 +13,18 @@ This file is part of the SnowfeetEngine project.
 #include <core/math/Vector3.h>
 #include <core/util/Exception.h>
 #include <core/util/Log.h>
+#include <core/util/ArrayLayouts.h>
 
 namespace sn
 {
 
 /*
     Tri-dimensionnal array.
+    The order of cells in memory is given by a layout (see ArrayLayouts.h),
+    row-major by default.
 */
 
-template <typename T>
+template <typename T, typename Layout_T = RowMajorLayout3D>
 class Array3D
 {
 public :
@@ -37,18 +40,30 @@ public :
     // creates an array with the specified size.
     // Note : data values are not initialized, use the fill() function if necessary.
     Array3D(u32 sizeX, u32 sizeY, u32 sizeZ)
+        : m_data(nullptr),
+        m_sizeX(0),
+        m_sizeY(0),
+        m_sizeZ(0)
     {
         create(sizeX, sizeY, sizeZ);
     }
 
     // creates an array with the specified size and value
     Array3D(u32 sizeX, u32 sizeY, u32 sizeZ, const T & value)
+        : m_data(nullptr),
+        m_sizeX(0),
+        m_sizeY(0),
+        m_sizeZ(0)
     {
         create(sizeX, sizeY, sizeZ, value);
     }
 
     // creates an array as copy from another
     Array3D(const Array3D & other)
+        : m_data(nullptr),
+        m_sizeX(0),
+        m_sizeY(0),
+        m_sizeZ(0)
     {
         copyFrom(other);
     }
@@ -58,7 +73,7 @@ public :
         clear();
     }
 
-    Array3D<T> & operator=(const Array3D<T> & other)
+    Array3D & operator=(const Array3D & other)
     {
         copyFrom(other);
         return *this;
@@ -70,11 +85,29 @@ public :
         return m_data[i];
     }
 
+    inline const T & operator[](u32 i) const
+    {
+        return m_data[i];
+    }
+
+    // Accesses the storage directly. Cells are in the order of the layout.
+    inline T * raw()
+    {
+        return m_data;
+    }
+
+    inline const T * raw() const
+    {
+        return m_data;
+    }
+
     inline u32 getLocation(u32 x, u32 y, u32 z) const
     {
-        return m_sizeX * (z * m_sizeY + y) + x;
+        return m_layout.getLocation(x, y, z);
     }
 
+    inline const Layout_T & getLayout() const { return m_layout; }
+
     // creates the buffer from the specified area.
     // old data is cleared.
     // Note : data values are not initialized, use the fill() function if necessary.
@@ -97,19 +130,20 @@ public :
         m_sizeX = sizeX;
         m_sizeY = sizeY;
         m_sizeZ = sizeZ;
-        m_data = new T[volume()];
+        m_layout.create(sizeX, sizeY, sizeZ);
+        m_data = new T[m_layout.getCapacity()];
     }
 
     // Copies data from another array into this one.
     // Copy an empty array will clear this one.
-    void copyFrom(const Array3D<T> & other)
+    void copyFrom(const Array3D & other)
     {
         if(other.empty())
             clear();
         else
         {
             create(other.sizeX(), other.sizeY(), other.sizeZ());
-            memcpy(m_data, other.m_data, volume() * sizeof(T));
+            memcpy(m_data, other.m_data, capacity() * sizeof(T));
         }
     }
 
@@ -119,6 +153,12 @@ public :
         return m_sizeX * m_sizeY * m_sizeZ;
     }
 
+    // Returns the count of cells in storage, which can be more than volume() if the layout uses padding
+    inline u32 capacity() const
+    {
+        return m_data == nullptr ? 0 : m_layout.getCapacity();
+    }
+
     inline u32 sizeX() const { return m_sizeX; }
     inline u32 sizeY() const { return m_sizeY; }
     inline u32 sizeZ() const { return m_sizeZ; }
@@ -146,11 +186,31 @@ public :
     void fill(const T & val)
     {
         // TODO optimize for byte-size types (memset)
-        const u32 vol = volume();
+        const u32 vol = capacity();
         for(u32 i = 0; i < vol; ++i)
             m_data[i] = val;
     }
 
+    // Calls f(x, y, z, value) for each cell, in storage order.
+    // With tiled layouts, this goes block by block, which is faster than nested loops on X, Y and Z.
+    template <typename Func_T>
+    void forEach(Func_T f)
+    {
+        T * data = m_data;
+        m_layout.forEachLocation([&f, data](u32 x, u32 y, u32 z, u32 i) {
+            f(x, y, z, data[i]);
+        });
+    }
+
+    template <typename Func_T>
+    void forEach(Func_T f) const
+    {
+        const T * data = m_data;
+        m_layout.forEachLocation([&f, data](u32 x, u32 y, u32 z, u32 i) {
+            f(x, y, z, data[i]);
+        });
+    }
+
     // get an element without position validation (it must be valid !)
     inline T getNoEx(s32 x, s32 y, s32 z) const
     {
@@ -161,7 +221,7 @@ public :
     T get(s32 x, s32 y, s32 z) const throw(Exception)
     {
         if(x < 0 || y < 0 || z < 0 || x >= m_sizeX || y >= m_sizeY || z >= m_sizeZ)
-            throw Exception("Array3D::get " + Vector3i(x,y,z));
+            throw Exception(std::string("Array3D::get ") + toString(Vector3i(x,y,z)));
         else
             return getNoEx(x, y, z);
     }
@@ -176,9 +236,9 @@ public :
     void set(s32 x, s32 y, s32 z, const T & value) throw(Exception)
     {
         if(x < 0 || y < 0 || z < 0 || x >= m_sizeX || y >= m_sizeY || z >= m_sizeZ)
-            throw Exception("Array3D::set " + Vector3i(x,y,z));
+            throw Exception(std::string("Array3D::set ") + toString(Vector3i(x,y,z)));
         else
-            return setNoEx(x, y, z);
+            setNoEx(x, y, z, value);
     }
 
     //
@@ -204,7 +264,7 @@ public :
     // (convenience)
     inline u32 byteCount() const
     {
-        return volume() * elementByteCount();
+        return capacity() * elementByteCount();
     }
 
     // set an element
@@ -225,7 +285,7 @@ public :
     // (convenience)
     inline T get(const Vector3i & pos) const throw(Exception)
     {
-        get(pos.x(), pos.y(), pos.y());
+        return get(pos.x(), pos.y(), pos.z());
     }
 
     // get an element without position validation (it must be valid !)
@@ -241,6 +301,7 @@ private :
     u32 m_sizeX;
     u32 m_sizeY;
     u32 m_sizeZ;
+    Layout_T m_layout;
 
 };
 
@@ -0,0 +1,417 @@
+/*
+ArrayLayouts.h
+Copyright (C) 2015-2015 Marc GILLERON
+This file is part of the SnowfeetEngine project.
+*/
+
+#ifndef __HEADER_SN_ARRAYLAYOUTS__
+#define __HEADER_SN_ARRAYLAYOUTS__
+
+#include <core/types.h>
+#include <vector>
+#include <algorithm>
+
+namespace sn
+{
+
+//
+// Storage layouts for Array2D and Array3D.
+// A layout maps coordinates to indexes in the flat storage of an array.
+// Row-major layouts are the default. With them, neighbors on Y (and Z) are far away in memory,
+// so on large arrays, operations looking at neighborhoods get a lot of cache misses.
+// Tiled and Morton layouts keep nearby cells close in memory on all axes.
+// They pay off for local accesses at scattered places (areas being updated, chunks, flood fills...).
+// For sweeps over the whole array, row-major stays faster, because its index computation is the cheapest
+// and hardware prefetching follows rows well.
+//
+// A layout provides:
+// - void create(sizeX, sizeY[, sizeZ]): computes the mapping for an array of the given size
+// - u32 getCapacity() const: count of cells to allocate, can be more than the size because of padding
+// - u32 getLocation(x, y[, z]) const
+// - void forEachLocation(f) const: calls f(x, y[, z], index) for each cell of the array,
+//   in an order that follows the storage.
+//
+
+//------------------------------------------------------------------------------
+namespace layout_detail
+{
+    inline u32 getPowerOfTwoLog2(u32 size)
+    {
+        u32 bits = 0;
+        while ((1u << bits) < size)
+            ++bits;
+        return bits;
+    }
+
+    // Builds lookup tables of Z-order curves:
+    // bits of each coordinate are interleaved, and when an axis runs out of bits,
+    // the remaining ones continue without it.
+    // Index of a cell is then tables[0][x] | tables[1][y] | ...
+    inline void buildMortonTables(const u32 * bits, u32 axisCount, std::vector<u32> * tables)
+    {
+        u32 bitPositions[3][32];
+        u32 maxBits = 0;
+        for (u32 axis = 0; axis < axisCount; ++axis)
+            maxBits = std::max(maxBits, bits[axis]);
+
+        u32 p = 0;
+        for (u32 k = 0; k < maxBits; ++k)
+        {
+            for (u32 axis = 0; axis < axisCount; ++axis)
+            {
+                if (k < bits[axis])
+                    bitPositions[axis][k] = p++;
+            }
+        }
+
+        for (u32 axis = 0; axis < axisCount; ++axis)
+        {
+            std::vector<u32> & table = tables[axis];
+            table.resize(1u << bits[axis]);
+            for (u32 c = 0; c < table.size(); ++c)
+            {
+                u32 index = 0;
+                for (u32 k = 0; k < bits[axis]; ++k)
+                {
+                    if (c & (1u << k))
+                        index |= 1u << bitPositions[axis][k];
+                }
+                table[c] = index;
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/// \brief Cells are stored row by row: index = y * sizeX + x
+class RowMajorLayout2D
+{
+public:
+    RowMajorLayout2D(): m_sizeX(0), m_sizeY(0) {}
+
+    void create(u32 sizeX, u32 sizeY)
+    {
+        m_sizeX = sizeX;
+        m_sizeY = sizeY;
+    }
+
+    inline u32 getCapacity() const { return m_sizeX * m_sizeY; }
+
+    inline u32 getLocation(u32 x, u32 y) const
+    {
+        return m_sizeX * y + x;
+    }
+
+    template <typename Func_T>
+    void forEachLocation(Func_T f) const
+    {
+        u32 i = 0;
+        for (u32 y = 0; y < m_sizeY; ++y)
+        {
+            for (u32 x = 0; x < m_sizeX; ++x)
+                f(x, y, i++);
+        }
+    }
+
+private:
+    u32 m_sizeX;
+    u32 m_sizeY;
+};
+
+//------------------------------------------------------------------------------
+/// \brief Cells are stored in square blocks of 2^BlockSizeLog2 cells of side,
+/// which are row-major inside, and blocks are row-major too.
+/// The storage is padded to a whole number of blocks.
+template <u32 BlockSizeLog2 = 3>
+class TiledLayout2D
+{
+public:
+    static const u32 BLOCK_SIZE = 1u << BlockSizeLog2;
+    static const u32 BLOCK_MASK = BLOCK_SIZE - 1;
+
+    TiledLayout2D(): m_sizeX(0), m_sizeY(0), m_blocksX(0), m_blocksY(0) {}
+
+    void create(u32 sizeX, u32 sizeY)
+    {
+        m_sizeX = sizeX;
+        m_sizeY = sizeY;
+        m_blocksX = (sizeX + BLOCK_MASK) >> BlockSizeLog2;
+        m_blocksY = (sizeY + BLOCK_MASK) >> BlockSizeLog2;
+    }
+
+    inline u32 getCapacity() const { return (m_blocksX * m_blocksY) << (2 * BlockSizeLog2); }
+
+    inline u32 getLocation(u32 x, u32 y) const
+    {
+        u32 block = (y >> BlockSizeLog2) * m_blocksX + (x >> BlockSizeLog2);
+        return (block << (2 * BlockSizeLog2)) | ((y & BLOCK_MASK) << BlockSizeLog2) | (x & BLOCK_MASK);
+    }
+
+    template <typename Func_T>
+    void forEachLocation(Func_T f) const
+    {
+        for (u32 by = 0; by < m_blocksY; ++by)
+        {
+            u32 minY = by << BlockSizeLog2;
+            u32 maxY = std::min(minY + BLOCK_SIZE, m_sizeY);
+            for (u32 bx = 0; bx < m_blocksX; ++bx)
+            {
+                u32 minX = bx << BlockSizeLog2;
+                u32 maxX = std::min(minX + BLOCK_SIZE, m_sizeX);
+                u32 blockBegin = (by * m_blocksX + bx) << (2 * BlockSizeLog2);
+                for (u32 y = minY; y < maxY; ++y)
+                {
+                    u32 i = blockBegin + ((y - minY) << BlockSizeLog2);
+                    for (u32 x = minX; x < maxX; ++x)
+                        f(x, y, i++);
+                }
+            }
+        }
+    }
+
+private:
+    u32 m_sizeX;
+    u32 m_sizeY;
+    u32 m_blocksX;
+    u32 m_blocksY;
+};
+
+//------------------------------------------------------------------------------
+/// \brief Cells are stored along a Z-order curve (Morton order),
+/// which keeps them close to their neighbors at every scale.
+/// Each axis is padded to a power of two, so sizes just above one waste memory.
+class MortonLayout2D
+{
+public:
+    MortonLayout2D(): m_sizeX(0), m_sizeY(0), m_tileLog2(0) {}
+
+    void create(u32 sizeX, u32 sizeY)
+    {
+        m_sizeX = sizeX;
+        m_sizeY = sizeY;
+        u32 bits[2] = { layout_detail::getPowerOfTwoLog2(sizeX), layout_detail::getPowerOfTwoLog2(sizeY) };
+        layout_detail::buildMortonTables(bits, 2, m_tables);
+        // Aligned square tiles below the size of the shortest axis are contiguous
+        m_tileLog2 = std::min(std::min(bits[0], bits[1]), 4u);
+    }
+
+    inline u32 getCapacity() const { return m_sizeX == 0 || m_sizeY == 0 ? 0 : m_tables[0].size() * m_tables[1].size(); }
+
+    inline u32 getLocation(u32 x, u32 y) const
+    {
+        return m_tables[0][x] | m_tables[1][y];
+    }
+
+    template <typename Func_T>
+    void forEachLocation(Func_T f) const
+    {
+        const u32 tileSize = 1u << m_tileLog2;
+        for (u32 minY = 0; minY < m_sizeY; minY += tileSize)
+        {
+            u32 maxY = std::min(minY + tileSize, m_sizeY);
+            for (u32 minX = 0; minX < m_sizeX; minX += tileSize)
+            {
+                u32 maxX = std::min(minX + tileSize, m_sizeX);
+                for (u32 y = minY; y < maxY; ++y)
+                {
+                    u32 ty = m_tables[1][y];
+                    for (u32 x = minX; x < maxX; ++x)
+                        f(x, y, m_tables[0][x] | ty);
+                }
+            }
+        }
+    }
+
+private:
+    u32 m_sizeX;
+    u32 m_sizeY;
+    u32 m_tileLog2;
+    std::vector<u32> m_tables[2];
+};
+
+//------------------------------------------------------------------------------
+/// \brief Cells are stored row by row, then slice by slice: index = (z * sizeY + y) * sizeX + x
+class RowMajorLayout3D
+{
+public:
+    RowMajorLayout3D(): m_sizeX(0), m_sizeY(0), m_sizeZ(0) {}
+
+    void create(u32 sizeX, u32 sizeY, u32 sizeZ)
+    {
+        m_sizeX = sizeX;
+        m_sizeY = sizeY;
+        m_sizeZ = sizeZ;
+    }
+
+    inline u32 getCapacity() const { return m_sizeX * m_sizeY * m_sizeZ; }
+
+    inline u32 getLocation(u32 x, u32 y, u32 z) const
+    {
+        return m_sizeX * (z * m_sizeY + y) + x;
+    }
+
+    template <typename Func_T>
+    void forEachLocation(Func_T f) const
+    {
+        u32 i = 0;
+        for (u32 z = 0; z < m_sizeZ; ++z)
+        {
+            for (u32 y = 0; y < m_sizeY; ++y)
+            {
+                for (u32 x = 0; x < m_sizeX; ++x)
+                    f(x, y, z, i++);
+            }
+        }
+    }
+
+private:
+    u32 m_sizeX;
+    u32 m_sizeY;
+    u32 m_sizeZ;
+};
+
+//------------------------------------------------------------------------------
+/// \brief Cells are stored in cubic blocks of 2^BlockSizeLog2 cells of side,
+/// which are row-major inside, and blocks are row-major too.
+/// The storage is padded to a whole number of blocks.
+template <u32 BlockSizeLog2 = 3>
+class TiledLayout3D
+{
+public:
+    static const u32 BLOCK_SIZE = 1u << BlockSizeLog2;
+    static const u32 BLOCK_MASK = BLOCK_SIZE - 1;
+
+    TiledLayout3D(): m_sizeX(0), m_sizeY(0), m_sizeZ(0), m_blocksX(0), m_blocksY(0), m_blocksZ(0) {}
+
+    void create(u32 sizeX, u32 sizeY, u32 sizeZ)
+    {
+        m_sizeX = sizeX;
+        m_sizeY = sizeY;
+        m_sizeZ = sizeZ;
+        m_blocksX = (sizeX + BLOCK_MASK) >> BlockSizeLog2;
+        m_blocksY = (sizeY + BLOCK_MASK) >> BlockSizeLog2;
+        m_blocksZ = (sizeZ + BLOCK_MASK) >> BlockSizeLog2;
+    }
+
+    inline u32 getCapacity() const { return (m_blocksX * m_blocksY * m_blocksZ) << (3 * BlockSizeLog2); }
+
+    inline u32 getLocation(u32 x, u32 y, u32 z) const
+    {
+        u32 block = ((z >> BlockSizeLog2) * m_blocksY + (y >> BlockSizeLog2)) * m_blocksX + (x >> BlockSizeLog2);
+        return (block << (3 * BlockSizeLog2))
+            | ((z & BLOCK_MASK) << (2 * BlockSizeLog2))
+            | ((y & BLOCK_MASK) << BlockSizeLog2)
+            | (x & BLOCK_MASK);
+    }
+
+    template <typename Func_T>
+    void forEachLocation(Func_T f) const
+    {
+        for (u32 bz = 0; bz < m_blocksZ; ++bz)
+        {
+            u32 minZ = bz << BlockSizeLog2;
+            u32 maxZ = std::min(minZ + BLOCK_SIZE, m_sizeZ);
+            for (u32 by = 0; by < m_blocksY; ++by)
+            {
+                u32 minY = by << BlockSizeLog2;
+                u32 maxY = std::min(minY + BLOCK_SIZE, m_sizeY);
+                for (u32 bx = 0; bx < m_blocksX; ++bx)
+                {
+                    u32 minX = bx << BlockSizeLog2;
+                    u32 maxX = std::min(minX + BLOCK_SIZE, m_sizeX);
+                    u32 blockBegin = ((bz * m_blocksY + by) * m_blocksX + bx) << (3 * BlockSizeLog2);
+                    for (u32 z = minZ; z < maxZ; ++z)
+                    {
+                        for (u32 y = minY; y < maxY; ++y)
+                        {
+                            u32 i = blockBegin | ((z - minZ) << (2 * BlockSizeLog2)) | ((y - minY) << BlockSizeLog2);
+                            for (u32 x = minX; x < maxX; ++x)
+                                f(x, y, z, i++);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    u32 m_sizeX;
+    u32 m_sizeY;
+    u32 m_sizeZ;
+    u32 m_blocksX;
+    u32 m_blocksY;
+    u32 m_blocksZ;
+};
+
+//------------------------------------------------------------------------------
+/// \brief Cells are stored along a 3D Z-order curve (Morton order).
+/// Each axis is padded to a power of two, so sizes just above one waste memory.
+class MortonLayout3D
+{
+public:
+    MortonLayout3D(): m_sizeX(0), m_sizeY(0), m_sizeZ(0), m_tileLog2(0) {}
+
+    void create(u32 sizeX, u32 sizeY, u32 sizeZ)
+    {
+        m_sizeX = sizeX;
+        m_sizeY = sizeY;
+        m_sizeZ = sizeZ;
+        u32 bits[3] = {
+            layout_detail::getPowerOfTwoLog2(sizeX),
+            layout_detail::getPowerOfTwoLog2(sizeY),
+            layout_detail::getPowerOfTwoLog2(sizeZ)
+        };
+        layout_detail::buildMortonTables(bits, 3, m_tables);
+        m_tileLog2 = std::min(std::min(std::min(bits[0], bits[1]), bits[2]), 3u);
+    }
+
+    inline u32 getCapacity() const
+    {
+        return m_sizeX == 0 || m_sizeY == 0 || m_sizeZ == 0 ? 0 : m_tables[0].size() * m_tables[1].size() * m_tables[2].size();
+    }
+
+    inline u32 getLocation(u32 x, u32 y, u32 z) const
+    {
+        return m_tables[0][x] | m_tables[1][y] | m_tables[2][z];
+    }
+
+    template <typename Func_T>
+    void forEachLocation(Func_T f) const
+    {
+        const u32 tileSize = 1u << m_tileLog2;
+        for (u32 minZ = 0; minZ < m_sizeZ; minZ += tileSize)
+        {
+            u32 maxZ = std::min(minZ + tileSize, m_sizeZ);
+            for (u32 minY = 0; minY < m_sizeY; minY += tileSize)
+            {
+                u32 maxY = std::min(minY + tileSize, m_sizeY);
+                for (u32 minX = 0; minX < m_sizeX; minX += tileSize)
+                {
+                    u32 maxX = std::min(minX + tileSize, m_sizeX);
+                    for (u32 z = minZ; z < maxZ; ++z)
+                    {
+                        u32 tz = m_tables[2][z];
+                        for (u32 y = minY; y < maxY; ++y)
+                        {
+                            u32 tyz = m_tables[1][y] | tz;
+                            for (u32 x = minX; x < maxX; ++x)
+                                f(x, y, z, m_tables[0][x] | tyz);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    u32 m_sizeX;
+    u32 m_sizeY;
+    u32 m_sizeZ;
+    u32 m_tileLog2;
+    std::vector<u32> m_tables[3];
+};
+
+} // namespace sn
+
+#endif // __HEADER_SN_ARRAYLAYOUTS__
+
@@ -0,0 +1,179 @@
+/*
+FlatMap.h
+Copyright (C) 2015-2015 Marc GILLERON
+This file is part of the SnowfeetEngine project.
+*/
+
+#ifndef __HEADER_SN_FLATMAP__
+#define __HEADER_SN_FLATMAP__
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+namespace sn
+{
+
+/// \brief Associative container storing its pairs contiguously, sorted by key.
+/// Lookups are binary searches, insertions shift the elements after the new one.
+/// It is best suited to small maps (such as the fields of a document object),
+/// where it is faster and much lighter than a node-based map.
+/// Inserting keys in ascending order is amortized O(1).
+/// Keys are compared with operator<.
+/// \warning Unlike std::map, inserting or erasing elements invalidates references and iterators.
+/// \warning Keys must not be modified through iterators.
+template <typename K, typename V>
+class FlatMap
+{
+public:
+    typedef K key_type;
+    typedef V mapped_type;
+    typedef std::pair<K, V> value_type;
+    typedef std::vector<value_type> container_type;
+    typedef typename container_type::iterator iterator;
+    typedef typename container_type::const_iterator const_iterator;
+    typedef typename container_type::size_type size_type;
+
+    //--------------------------------------
+    // Constructors
+    //--------------------------------------
+
+    FlatMap() {}
+    FlatMap(const FlatMap & other) : m_pairs(other.m_pairs) {}
+    FlatMap(FlatMap && other) : m_pairs(std::move(other.m_pairs)) {}
+
+    FlatMap & operator=(const FlatMap & other)
+    {
+        m_pairs = other.m_pairs;
+        return *this;
+    }
+
+    FlatMap & operator=(FlatMap && other)
+    {
+        m_pairs = std::move(other.m_pairs);
+        return *this;
+    }
+
+    //--------------------------------------
+    // Iteration
+    //--------------------------------------
+
+    inline iterator begin()                 { return m_pairs.begin(); }
+    inline iterator end()                   { return m_pairs.end(); }
+    inline const_iterator begin() const     { return m_pairs.begin(); }
+    inline const_iterator end() const       { return m_pairs.end(); }
+    inline const_iterator cbegin() const    { return m_pairs.cbegin(); }
+    inline const_iterator cend() const      { return m_pairs.cend(); }
+
+    //--------------------------------------
+    // Capacity
+    //--------------------------------------
+
+    inline size_type size() const   { return m_pairs.size(); }
+    inline bool empty() const       { return m_pairs.empty(); }
+    inline void reserve(size_type n) { m_pairs.reserve(n); }
+    inline void clear()             { m_pairs.clear(); }
+
+    //--------------------------------------
+    // Lookup
+    //--------------------------------------
+
+    iterator find(const K & key)
+    {
+        iterator it = lowerBound(key);
+        if (it != m_pairs.end() && !(key < it->first))
+            return it;
+        return m_pairs.end();
+    }
+
+    const_iterator find(const K & key) const
+    {
+        const_iterator it = lowerBound(key);
+        if (it != m_pairs.end() && !(key < it->first))
+            return it;
+        return m_pairs.end();
+    }
+
+    inline size_type count(const K & key) const { return find(key) == end() ? 0 : 1; }
+
+    //--------------------------------------
+    // Modifiers
+    //--------------------------------------
+
+    /// \brief Gets the value associated to the given key, inserting a default one if not found.
+    V & operator[](const K & key)
+    {
+        iterator it = lowerBound(key);
+        if (it == m_pairs.end() || key < it->first)
+            it = m_pairs.insert(it, value_type(key, V()));
+        return it->second;
+    }
+
+    V & operator[](K && key)
+    {
+        iterator it = lowerBound(key);
+        if (it == m_pairs.end() || key < it->first)
+            it = m_pairs.insert(it, value_type(std::move(key), V()));
+        return it->second;
+    }
+
+    /// \brief Inserts a pair if its key is not already present.
+    /// \return iterator to the element with this key, and true if the insertion took place.
+    std::pair<iterator, bool> insert(const value_type & pair)
+    {
+        iterator it = lowerBound(pair.first);
+        if (it != m_pairs.end() && !(pair.first < it->first))
+            return std::make_pair(it, false);
+        return std::make_pair(m_pairs.insert(it, pair), true);
+    }
+
+    size_type erase(const K & key)
+    {
+        iterator it = find(key);
+        if (it == m_pairs.end())
+            return 0;
+        m_pairs.erase(it);
+        return 1;
+    }
+
+    inline iterator erase(const_iterator it) { return m_pairs.erase(m_pairs.begin() + (it - m_pairs.cbegin())); }
+
+    inline void swap(FlatMap & other) { m_pairs.swap(other.m_pairs); }
+
+    //--------------------------------------
+    // Comparison
+    //--------------------------------------
+
+    inline bool operator==(const FlatMap & other) const { return m_pairs == other.m_pairs; }
+    inline bool operator!=(const FlatMap & other) const { return m_pairs != other.m_pairs; }
+
+private:
+    iterator lowerBound(const K & key)
+    {
+        // Fast path for keys inserted in order
+        if (m_pairs.empty() || m_pairs.back().first < key)
+            return m_pairs.end();
+        return std::lower_bound(m_pairs.begin(), m_pairs.end(), key, PairCompare());
+    }
+
+    const_iterator lowerBound(const K & key) const
+    {
+        if (m_pairs.empty() || m_pairs.back().first < key)
+            return m_pairs.end();
+        return std::lower_bound(m_pairs.begin(), m_pairs.end(), key, PairCompare());
+    }
+
+    struct PairCompare
+    {
+        inline bool operator()(const value_type & pair, const K & key) const { return pair.first < key; }
+    };
+
+private:
+    container_type m_pairs;
+
+};
+
+} // namespace sn
+
+#endif // __HEADER_SN_FLATMAP__
+
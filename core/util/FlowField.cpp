@@ -0,0 +1,161 @@
+/*
+FlowField.cpp
+Copyright (C) 2015-2015 Marc GILLERON
+This file is part of the SnowfeetEngine project.
+*/
+
+#include <core/util/FlowField.h>
+#include <algorithm>
+
+namespace sn
+{
+
+// Storage for constants taken by reference, such as by std::vector::assign
+const s32 FlowField::UNREACHABLE;
+const u8 FlowField::NO_DIRECTION;
+
+//------------------------------------------------------------------------------
+FlowField::FlowField():
+    m_sizeX(0),
+    m_sizeY(0)
+{
+}
+
+//------------------------------------------------------------------------------
+void FlowField::compute(const PathFinder & finder, s32 goalX, s32 goalY, s32 maxCost)
+{
+    reset(finder);
+    pushGoal(finder, goalX, goalY);
+    propagate(finder, maxCost);
+}
+
+//------------------------------------------------------------------------------
+void FlowField::compute(const PathFinder & finder, const std::vector<Vector2i> & goals, s32 maxCost)
+{
+    reset(finder);
+    for (u32 i = 0; i < goals.size(); ++i)
+        pushGoal(finder, goals[i].x(), goals[i].y());
+    propagate(finder, maxCost);
+}
+
+//------------------------------------------------------------------------------
+void FlowField::reset(const PathFinder & finder)
+{
+    m_sizeX = finder.getGridSizeX();
+    m_sizeY = finder.getGridSizeY();
+
+    u32 area = m_sizeX * m_sizeY;
+    m_costs.assign(area, UNREACHABLE);
+    m_directions.assign(area, NO_DIRECTION);
+    m_open.clear();
+}
+
+//------------------------------------------------------------------------------
+void FlowField::pushGoal(const PathFinder & finder, s32 x, s32 y)
+{
+    if (!finder.isCrossable(x, y))
+        return;
+
+    u32 i = y * m_sizeX + x;
+    if (m_costs[i] == 0)
+        return;
+
+    m_costs[i] = 0;
+    OpenEntry e = { 0, i };
+    m_open.push_back(e);
+}
+
+//------------------------------------------------------------------------------
+// Dijkstra from the goals, going backwards:
+// a cell gets the cost of the step leading to its neighbor, plus the cost of that neighbor.
+void FlowField::propagate(const PathFinder & finder, s32 maxCost)
+{
+    u32 directionCount = finder.hasDiagonals() ? 8 : 4;
+
+    std::make_heap(m_open.begin(), m_open.end());
+
+    while (!m_open.empty())
+    {
+        std::pop_heap(m_open.begin(), m_open.end());
+        OpenEntry e = m_open.back();
+        m_open.pop_back();
+
+        // Outdated entry, the cell was reached with a lower cost since it was pushed
+        if (e.cost != m_costs[e.index])
+            continue;
+
+        s32 x = e.index % m_sizeX;
+        s32 y = e.index / m_sizeX;
+
+        for (u32 dir = 0; dir < directionCount; ++dir)
+        {
+            // The neighbor from which a step in this direction leads to the current cell
+            s32 nx = x - PathFinder::s_directions[dir][0];
+            s32 ny = y - PathFinder::s_directions[dir][1];
+            if (!finder.isCrossable(nx, ny))
+                continue;
+
+            s32 stepCost = finder.getStepCost(nx, ny, dir);
+            if (stepCost == 0)
+                continue;
+
+            s32 cost = e.cost + stepCost;
+            if (maxCost >= 0 && cost > maxCost)
+                continue;
+
+            u32 ni = ny * m_sizeX + nx;
+            if (m_costs[ni] != UNREACHABLE && m_costs[ni] <= cost)
+                continue;
+
+            m_costs[ni] = cost;
+            m_directions[ni] = static_cast<u8>(dir);
+
+            OpenEntry ne = { cost, ni };
+            m_open.push_back(ne);
+            std::push_heap(m_open.begin(), m_open.end());
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+s32 FlowField::getCost(s32 x, s32 y) const
+{
+    if (static_cast<u32>(x) >= m_sizeX || static_cast<u32>(y) >= m_sizeY)
+        return UNREACHABLE;
+    return m_costs[y * m_sizeX + x];
+}
+
+//------------------------------------------------------------------------------
+u8 FlowField::getDirection(s32 x, s32 y) const
+{
+    if (static_cast<u32>(x) >= m_sizeX || static_cast<u32>(y) >= m_sizeY)
+        return NO_DIRECTION;
+    return m_directions[y * m_sizeX + x];
+}
+
+//------------------------------------------------------------------------------
+bool FlowField::getPath(s32 startX, s32 startY, std::vector<Vector2i> & out_path) const
+{
+    out_path.clear();
+
+    if (getCost(startX, startY) == UNREACHABLE)
+        return false;
+
+    s32 x = startX;
+    s32 y = startY;
+    out_path.push_back(Vector2i(x, y));
+
+    // Costs strictly decrease along directions, so this always ends on a goal
+    u8 dir;
+    while ((dir = m_directions[y * m_sizeX + x]) != NO_DIRECTION)
+    {
+        x += PathFinder::s_directions[dir][0];
+        y += PathFinder::s_directions[dir][1];
+        out_path.push_back(Vector2i(x, y));
+    }
+
+    return true;
+}
+
+} // namespace sn
+
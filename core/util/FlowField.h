@@ -0,0 +1,76 @@
+/*
+FlowField.h
+Copyright (C) 2015-2015 Marc GILLERON
+This file is part of the SnowfeetEngine project.
+*/
+
+#ifndef __HEADER_SN_FLOWFIELD__
+#define __HEADER_SN_FLOWFIELD__
+
+#include <core/util/PathFinder.h>
+
+namespace sn
+{
+
+/// \brief Cost to reach a goal from every cell of a grid (also known as a Dijkstra map),
+/// along with the direction to follow from each cell.
+/// Computing it costs about one search over the whole grid, after which the path of
+/// any number of agents heading to the same goal is a simple walk.
+class SN_API FlowField
+{
+public:
+    static const s32 UNREACHABLE = -1;
+    static const u8 NO_DIRECTION = 0xff;
+
+    FlowField();
+
+    /// \brief Computes costs and directions toward a goal,
+    /// using the grid and movement options of a path finder.
+    /// \param maxCost: cells costing more than this to reach the goal are left unreachable.
+    /// Negative means no limit.
+    void compute(const PathFinder & finder, s32 goalX, s32 goalY, s32 maxCost = -1);
+
+    /// \brief Same as above, with several goals. Each cell leads to its closest goal.
+    void compute(const PathFinder & finder, const std::vector<Vector2i> & goals, s32 maxCost = -1);
+
+    inline u32 getSizeX() const { return m_sizeX; }
+    inline u32 getSizeY() const { return m_sizeY; }
+
+    /// \brief Gets the cost of the path from a cell to the goal, or UNREACHABLE.
+    s32 getCost(s32 x, s32 y) const;
+
+    /// \brief Gets the direction of the next step from a cell.
+    /// \return index in PathFinder::s_directions, or NO_DIRECTION if the cell is a goal or can't reach one.
+    u8 getDirection(s32 x, s32 y) const;
+
+    /// \brief Follows directions from a cell to the goal.
+    /// \param out_path: receives cells from the start to the goal, both included. Cleared first.
+    /// \return true if the goal can be reached from the start.
+    bool getPath(s32 startX, s32 startY, std::vector<Vector2i> & out_path) const;
+
+private:
+    struct OpenEntry
+    {
+        s32 cost;
+        u32 index;
+        // Note: reversed, so std heap functions give the lowest cost first
+        inline bool operator<(const OpenEntry & other) const { return cost > other.cost; }
+    };
+
+    void reset(const PathFinder & finder);
+    void pushGoal(const PathFinder & finder, s32 x, s32 y);
+    void propagate(const PathFinder & finder, s32 maxCost);
+
+private:
+    u32 m_sizeX;
+    u32 m_sizeY;
+    std::vector<s32> m_costs;
+    std::vector<u8> m_directions;
+    std::vector<OpenEntry> m_open;
+
+};
+
+} // namespace sn
+
+#endif // __HEADER_SN_FLOWFIELD__
+
@@ -0,0 +1,627 @@
+/*
+HierarchicalPathFinder.cpp
+Copyright (C) 2015-2015 Marc GILLERON
+This file is part of the SnowfeetEngine project.
+*/
+
+#include <core/util/HierarchicalPathFinder.h>
+#include <core/util/Log.h>
+#include <algorithm>
+
+namespace sn
+{
+
+namespace
+{
+    // Openings narrower than this get one node in their middle, larger ones get one node at each end
+    const s32 MAX_ENTRANCE_WIDTH = 6;
+
+    // Index in PathFinder::s_directions of the opposite direction
+    inline u32 getOppositeDirection(u32 dir)
+    {
+        return dir < 4 ? (dir + 2) % 4 : 4 + (dir - 4 + 2) % 4;
+    }
+}
+
+//------------------------------------------------------------------------------
+HierarchicalPathFinder::HierarchicalPathFinder(const PathFinder & finder, u32 clusterSize):
+    r_finder(finder),
+    m_clusterSize(clusterSize < 2 ? 2 : clusterSize),
+    m_searchLimit(-1),
+    m_searchID(0),
+    m_localSearchID(0),
+    m_localOriginX(0),
+    m_localOriginY(0),
+    m_localSizeX(0),
+    m_localSizeY(0)
+{
+    m_clustersX = (finder.getGridSizeX() + m_clusterSize - 1) / m_clusterSize;
+    m_clustersY = (finder.getGridSizeY() + m_clusterSize - 1) / m_clusterSize;
+
+    u32 clusterCount = m_clustersX * m_clustersY;
+    m_clusterNodes.resize(clusterCount);
+    m_rightBorders.resize(clusterCount);
+    m_bottomBorders.resize(clusterCount);
+    m_dirtyClusters.resize(clusterCount, 0);
+
+    u32 clusterArea = m_clusterSize * m_clusterSize;
+    m_localCosts.resize(clusterArea, 0);
+    m_localParents.resize(clusterArea, -1);
+    m_localSearchIDs.resize(clusterArea, 0);
+
+    rebuild();
+}
+
+//------------------------------------------------------------------------------
+u32 HierarchicalPathFinder::getAbstractNodeCount() const
+{
+    return m_nodes.size() - m_freeNodes.size();
+}
+
+//------------------------------------------------------------------------------
+void HierarchicalPathFinder::rebuild()
+{
+    m_nodes.clear();
+    m_freeNodes.clear();
+    for (u32 i = 0; i < m_clusterNodes.size(); ++i)
+    {
+        m_clusterNodes[i].clear();
+        m_rightBorders[i].clear();
+        m_bottomBorders[i].clear();
+    }
+
+    onCellsChanged(0, 0, r_finder.getGridSizeX() - 1, r_finder.getGridSizeY() - 1);
+    update();
+}
+
+//------------------------------------------------------------------------------
+void HierarchicalPathFinder::onCellsChanged(s32 minX, s32 minY, s32 maxX, s32 maxY)
+{
+    minX = std::max(minX, 0);
+    minY = std::max(minY, 0);
+    maxX = std::min(maxX, (s32)r_finder.getGridSizeX() - 1);
+    maxY = std::min(maxY, (s32)r_finder.getGridSizeY() - 1);
+    if (minX > maxX || minY > maxY)
+        return;
+
+    for (s32 cy = minY / m_clusterSize; cy <= maxY / (s32)m_clusterSize; ++cy)
+    {
+        for (s32 cx = minX / m_clusterSize; cx <= maxX / (s32)m_clusterSize; ++cx)
+        {
+            u32 c = cy * m_clustersX + cx;
+            if (!m_dirtyClusters[c])
+            {
+                m_dirtyClusters[c] = 1;
+                m_dirtyClusterList.push_back(c);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void HierarchicalPathFinder::update()
+{
+    if (m_dirtyClusterList.empty())
+        return;
+
+    // A modified cluster changes the openings on its four borders
+    std::vector<u32> rightBorders;
+    std::vector<u32> bottomBorders;
+    // ...which changes the paths inside its neighbors too
+    std::vector<u32> affectedClusters;
+
+    for (u32 i = 0; i < m_dirtyClusterList.size(); ++i)
+    {
+        u32 c = m_dirtyClusterList[i];
+        u32 cx = c % m_clustersX;
+        u32 cy = c / m_clustersX;
+
+        rightBorders.push_back(c);
+        bottomBorders.push_back(c);
+        affectedClusters.push_back(c);
+
+        if (cx > 0)
+        {
+            rightBorders.push_back(c - 1);
+            affectedClusters.push_back(c - 1);
+        }
+        if (cy > 0)
+        {
+            bottomBorders.push_back(c - m_clustersX);
+            affectedClusters.push_back(c - m_clustersX);
+        }
+        if (cx + 1 < m_clustersX)
+            affectedClusters.push_back(c + 1);
+        if (cy + 1 < m_clustersY)
+            affectedClusters.push_back(c + m_clustersX);
+
+        m_dirtyClusters[c] = 0;
+    }
+    m_dirtyClusterList.clear();
+
+    std::sort(rightBorders.begin(), rightBorders.end());
+    rightBorders.erase(std::unique(rightBorders.begin(), rightBorders.end()), rightBorders.end());
+    std::sort(bottomBorders.begin(), bottomBorders.end());
+    bottomBorders.erase(std::unique(bottomBorders.begin(), bottomBorders.end()), bottomBorders.end());
+    std::sort(affectedClusters.begin(), affectedClusters.end());
+    affectedClusters.erase(std::unique(affectedClusters.begin(), affectedClusters.end()), affectedClusters.end());
+
+    for (u32 i = 0; i < affectedClusters.size(); ++i)
+        removeIntraEdges(affectedClusters[i]);
+
+    for (u32 i = 0; i < rightBorders.size(); ++i)
+        removeEntrances(m_rightBorders[rightBorders[i]]);
+    for (u32 i = 0; i < bottomBorders.size(); ++i)
+        removeEntrances(m_bottomBorders[bottomBorders[i]]);
+
+    for (u32 i = 0; i < rightBorders.size(); ++i)
+        buildEntrances(rightBorders[i], false);
+    for (u32 i = 0; i < bottomBorders.size(); ++i)
+        buildEntrances(bottomBorders[i], true);
+
+    for (u32 i = 0; i < affectedClusters.size(); ++i)
+        buildIntraEdges(affectedClusters[i]);
+}
+
+//------------------------------------------------------------------------------
+u32 HierarchicalPathFinder::createNode(s32 x, s32 y)
+{
+    u32 id;
+    if (m_freeNodes.empty())
+    {
+        id = m_nodes.size();
+        m_nodes.push_back(AbstractNode());
+    }
+    else
+    {
+        id = m_freeNodes.back();
+        m_freeNodes.pop_back();
+    }
+
+    AbstractNode & node = m_nodes[id];
+    node.x = x;
+    node.y = y;
+    node.cluster = getClusterIndex(x, y);
+    node.edges.clear();
+    node.goneCost = 0;
+    node.parent = INVALID_NODE;
+    node.searchID = 0;
+    node.closed = false;
+
+    m_clusterNodes[node.cluster].push_back(id);
+    return id;
+}
+
+//------------------------------------------------------------------------------
+void HierarchicalPathFinder::removeNode(u32 id)
+{
+    // Note: edges pointing to this node must be removed by the caller
+    AbstractNode & node = m_nodes[id];
+    std::vector<u32> & clusterNodes = m_clusterNodes[node.cluster];
+    clusterNodes.erase(std::find(clusterNodes.begin(), clusterNodes.end(), id));
+    node.edges.clear();
+    m_freeNodes.push_back(id);
+}
+
+//------------------------------------------------------------------------------
+void HierarchicalPathFinder::removeEntrances(std::vector<u32> & borderNodes)
+{
+    // Nodes come in pairs linked to each other, and edges from other nodes of the same clusters
+    // have been removed before, so there is no dangling edge left
+    for (u32 i = 0; i < borderNodes.size(); ++i)
+        removeNode(borderNodes[i]);
+    borderNodes.clear();
+}
+
+//------------------------------------------------------------------------------
+void HierarchicalPathFinder::buildEntrances(u32 cluster, bool vertical)
+{
+    u32 cx = cluster % m_clustersX;
+    u32 cy = cluster / m_clustersX;
+    std::vector<u32> & borderNodes = vertical ? m_bottomBorders[cluster] : m_rightBorders[cluster];
+
+    if (vertical ? cy + 1 >= m_clustersY : cx + 1 >= m_clustersX)
+        return;
+
+    // Cells along the border, inside the cluster. Outside cells are one step further.
+    s32 borderX = vertical ? cx * m_clusterSize : (cx + 1) * m_clusterSize - 1;
+    s32 borderY = vertical ? (cy + 1) * m_clusterSize - 1 : cy * m_clusterSize;
+    s32 stepX = vertical ? 1 : 0;
+    s32 stepY = vertical ? 0 : 1;
+    s32 outX = vertical ? 0 : 1;
+    s32 outY = vertical ? 1 : 0;
+    u32 outDir = vertical ? 2 : 1;
+    s32 length = vertical ?
+        std::min((s32)m_clusterSize, (s32)r_finder.getGridSizeX() - borderX) :
+        std::min((s32)m_clusterSize, (s32)r_finder.getGridSizeY() - borderY);
+
+    s32 segmentBegin = -1;
+    for (s32 i = 0; i <= length; ++i)
+    {
+        s32 x = borderX + i * stepX;
+        s32 y = borderY + i * stepY;
+        bool open = i < length && r_finder.isCrossable(x, y) && r_finder.isCrossable(x + outX, y + outY);
+
+        if (open)
+        {
+            if (segmentBegin < 0)
+                segmentBegin = i;
+            continue;
+        }
+
+        if (segmentBegin < 0)
+            continue;
+
+        // End of an opening
+        s32 segmentEnd = i - 1;
+        s32 positions[2];
+        u32 positionCount = 0;
+        if (segmentEnd - segmentBegin + 1 < MAX_ENTRANCE_WIDTH)
+        {
+            positions[positionCount++] = (segmentBegin + segmentEnd) / 2;
+        }
+        else
+        {
+            positions[positionCount++] = segmentBegin;
+            positions[positionCount++] = segmentEnd;
+        }
+
+        for (u32 j = 0; j < positionCount; ++j)
+        {
+            s32 px = borderX + positions[j] * stepX;
+            s32 py = borderY + positions[j] * stepY;
+
+            u32 inside = createNode(px, py);
+            u32 outside = createNode(px + outX, py + outY);
+
+            Edge edge;
+            edge.target = outside;
+            edge.cost = r_finder.getStepCost(px, py, outDir);
+            m_nodes[inside].edges.push_back(edge);
+
+            edge.target = inside;
+            edge.cost = r_finder.getStepCost(px + outX, py + outY, getOppositeDirection(outDir));
+            m_nodes[outside].edges.push_back(edge);
+
+            borderNodes.push_back(inside);
+            borderNodes.push_back(outside);
+        }
+
+        segmentBegin = -1;
+    }
+}
+
+//------------------------------------------------------------------------------
+void HierarchicalPathFinder::removeIntraEdges(u32 cluster)
+{
+    // Note: this must be done before nodes are removed,
+    // because their IDs may be reused by nodes of other clusters
+    const std::vector<u32> & nodes = m_clusterNodes[cluster];
+    for (u32 i = 0; i < nodes.size(); ++i)
+    {
+        std::vector<Edge> & edges = m_nodes[nodes[i]].edges;
+        u32 k = 0;
+        for (u32 j = 0; j < edges.size(); ++j)
+        {
+            if (m_nodes[edges[j].target].cluster != cluster)
+                edges[k++] = edges[j];
+        }
+        edges.resize(k);
+    }
+}
+
+//------------------------------------------------------------------------------
+void HierarchicalPathFinder::buildIntraEdges(u32 cluster)
+{
+    const std::vector<u32> & nodes = m_clusterNodes[cluster];
+
+    for (u32 i = 0; i < nodes.size(); ++i)
+    {
+        AbstractNode & node = m_nodes[nodes[i]];
+        searchCluster(cluster, node.x, node.y, false);
+
+        for (u32 j = 0; j < nodes.size(); ++j)
+        {
+            if (i == j)
+                continue;
+            const AbstractNode & other = m_nodes[nodes[j]];
+            s32 cost = getLocalCost(other.x, other.y);
+            if (cost >= 0)
+            {
+                Edge edge;
+                edge.target = nodes[j];
+                edge.cost = cost;
+                node.edges.push_back(edge);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void HierarchicalPathFinder::searchCluster(u32 cluster, s32 startX, s32 startY, bool reverse)
+{
+    ++m_localSearchID;
+    if (m_localSearchID == 0)
+    {
+        std::fill(m_localSearchIDs.begin(), m_localSearchIDs.end(), 0);
+        m_localSearchID = 1;
+    }
+
+    m_localOriginX = (cluster % m_clustersX) * m_clusterSize;
+    m_localOriginY = (cluster / m_clustersX) * m_clusterSize;
+    m_localSizeX = std::min((s32)m_clusterSize, (s32)r_finder.getGridSizeX() - m_localOriginX);
+    m_localSizeY = std::min((s32)m_clusterSize, (s32)r_finder.getGridSizeY() - m_localOriginY);
+
+    s32 startIndex = (startY - m_localOriginY) * m_clusterSize + (startX - m_localOriginX);
+    m_localCosts[startIndex] = 0;
+    m_localParents[startIndex] = -1;
+    m_localSearchIDs[startIndex] = m_localSearchID;
+
+    m_localOpen.clear();
+    OpenEntry entry;
+    entry.cost = 0;
+    entry.index = startIndex;
+    m_localOpen.push_back(entry);
+
+    while (!m_localOpen.empty())
+    {
+        std::pop_heap(m_localOpen.begin(), m_localOpen.end());
+        entry = m_localOpen.back();
+        m_localOpen.pop_back();
+
+        if (entry.cost > m_localCosts[entry.index])
+            continue; // Outdated
+
+        s32 x = m_localOriginX + entry.index % m_clusterSize;
+        s32 y = m_localOriginY + entry.index / m_clusterSize;
+
+        for (u32 dir = 0; dir < 8; ++dir)
+        {
+            s32 nx = x + PathFinder::s_directions[dir][0];
+            s32 ny = y + PathFinder::s_directions[dir][1];
+            s32 lx = nx - m_localOriginX;
+            s32 ly = ny - m_localOriginY;
+            if (lx < 0 || ly < 0 || lx >= m_localSizeX || ly >= m_localSizeY)
+                continue;
+
+            s32 stepCost;
+            if (reverse)
+                stepCost = r_finder.isCrossable(nx, ny) ? r_finder.getStepCost(nx, ny, getOppositeDirection(dir)) : 0;
+            else
+                stepCost = r_finder.getStepCost(x, y, dir);
+            if (stepCost <= 0)
+                continue;
+
+            s32 newCost = entry.cost + stepCost;
+            s32 index = ly * m_clusterSize + lx;
+            if (m_localSearchIDs[index] == m_localSearchID && m_localCosts[index] <= newCost)
+                continue;
+
+            m_localSearchIDs[index] = m_localSearchID;
+            m_localCosts[index] = newCost;
+            m_localParents[index] = entry.index;
+
+            OpenEntry next;
+            next.cost = newCost;
+            next.index = index;
+            m_localOpen.push_back(next);
+            std::push_heap(m_localOpen.begin(), m_localOpen.end());
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+inline s32 HierarchicalPathFinder::getLocalCost(s32 x, s32 y) const
+{
+    s32 lx = x - m_localOriginX;
+    s32 ly = y - m_localOriginY;
+    if (lx < 0 || ly < 0 || lx >= m_localSizeX || ly >= m_localSizeY)
+        return -1;
+    s32 index = ly * m_clusterSize + lx;
+    return m_localSearchIDs[index] == m_localSearchID ? m_localCosts[index] : -1;
+}
+
+//------------------------------------------------------------------------------
+void HierarchicalPathFinder::appendLocalPath(s32 endX, s32 endY, std::vector<Vector2i> & out_path)
+{
+    size_t begin = out_path.size();
+
+    s32 index = (endY - m_localOriginY) * m_clusterSize + (endX - m_localOriginX);
+    while (index >= 0)
+    {
+        out_path.push_back(Vector2i(m_localOriginX + index % m_clusterSize, m_localOriginY + index / m_clusterSize));
+        index = m_localParents[index];
+    }
+
+    std::reverse(out_path.begin() + begin, out_path.end());
+
+    // The start of this part is the end of the previous one
+    if (begin > 0 && out_path[begin] == out_path[begin - 1])
+        out_path.erase(out_path.begin() + begin);
+}
+
+//------------------------------------------------------------------------------
+bool HierarchicalPathFinder::searchAbstract(u32 startNode, u32 endNode)
+{
+    ++m_searchID;
+    if (m_searchID == 0)
+    {
+        for (u32 i = 0; i < m_nodes.size(); ++i)
+            m_nodes[i].searchID = 0;
+        m_searchID = 1;
+    }
+
+    const AbstractNode & end = m_nodes[endNode];
+
+    AbstractNode & start = m_nodes[startNode];
+    start.goneCost = 0;
+    start.parent = INVALID_NODE;
+    start.searchID = m_searchID;
+    start.closed = false;
+
+    m_open.clear();
+    OpenEntry entry;
+    entry.cost = r_finder.getCostLowerBound(start.x, start.y, end.x, end.y);
+    entry.index = startNode;
+    m_open.push_back(entry);
+
+    s32 closedCount = 0;
+
+    while (!m_open.empty())
+    {
+        std::pop_heap(m_open.begin(), m_open.end());
+        entry = m_open.back();
+        m_open.pop_back();
+
+        AbstractNode & node = m_nodes[entry.index];
+        if (node.closed)
+            continue;
+
+        if (entry.index == endNode)
+            return true;
+
+        if (m_searchLimit >= 0 && closedCount > m_searchLimit)
+        {
+#ifdef SN_BUILD_DEBUG
+            SN_DLOG("HierarchicalPathFinder searchLimit exceed");
+#endif
+            return false;
+        }
+
+        node.closed = true;
+        ++closedCount;
+
+        for (u32 i = 0; i < node.edges.size(); ++i)
+        {
+            const Edge & edge = node.edges[i];
+            AbstractNode & target = m_nodes[edge.target];
+            s32 newCost = node.goneCost + edge.cost;
+
+            if (target.searchID == m_searchID)
+            {
+                if (target.closed || target.goneCost <= newCost)
+                    continue;
+            }
+            else
+            {
+                target.searchID = m_searchID;
+                target.closed = false;
+            }
+
+            target.goneCost = newCost;
+            target.parent = entry.index;
+
+            OpenEntry next;
+            next.cost = newCost + r_finder.getCostLowerBound(target.x, target.y, end.x, end.y);
+            next.index = edge.target;
+            m_open.push_back(next);
+            std::push_heap(m_open.begin(), m_open.end());
+        }
+    }
+
+    return false;
+}
+
+//------------------------------------------------------------------------------
+bool HierarchicalPathFinder::findPath(s32 startX, s32 startY, s32 endX, s32 endY, std::vector<Vector2i> & out_path)
+{
+    out_path.clear();
+
+    if (!r_finder.isCrossable(startX, startY) || !r_finder.isCrossable(endX, endY))
+        return false;
+
+    update();
+
+    u32 startCluster = getClusterIndex(startX, startY);
+    u32 endCluster = getClusterIndex(endX, endY);
+
+    if (startCluster == endCluster)
+    {
+        // Try without leaving the cluster first
+        searchCluster(startCluster, startX, startY, false);
+        if (getLocalCost(endX, endY) >= 0)
+        {
+            appendLocalPath(endX, endY, out_path);
+            return true;
+        }
+    }
+
+    // Insert start and end in the abstract graph temporarily
+    u32 startNode = createNode(startX, startY);
+    u32 endNode = createNode(endX, endY);
+
+    searchCluster(startCluster, startX, startY, false);
+    const std::vector<u32> & startClusterNodes = m_clusterNodes[startCluster];
+    for (u32 i = 0; i < startClusterNodes.size(); ++i)
+    {
+        u32 id = startClusterNodes[i];
+        if (id == startNode || id == endNode)
+            continue;
+        s32 cost = getLocalCost(m_nodes[id].x, m_nodes[id].y);
+        if (cost >= 0)
+        {
+            Edge edge;
+            edge.target = id;
+            edge.cost = cost;
+            m_nodes[startNode].edges.push_back(edge);
+        }
+    }
+
+    // Nodes that temporarily got an edge to the end
+    std::vector<u32> linkedToEnd;
+    searchCluster(endCluster, endX, endY, true);
+    const std::vector<u32> & endClusterNodes = m_clusterNodes[endCluster];
+    for (u32 i = 0; i < endClusterNodes.size(); ++i)
+    {
+        u32 id = endClusterNodes[i];
+        if (id == startNode || id == endNode)
+            continue;
+        s32 cost = getLocalCost(m_nodes[id].x, m_nodes[id].y);
+        if (cost >= 0)
+        {
+            Edge edge;
+            edge.target = endNode;
+            edge.cost = cost;
+            m_nodes[id].edges.push_back(edge);
+            linkedToEnd.push_back(id);
+        }
+    }
+
+    bool found = searchAbstract(startNode, endNode);
+
+    if (found)
+    {
+        m_abstractPath.clear();
+        for (u32 id = endNode; id != INVALID_NODE; id = m_nodes[id].parent)
+            m_abstractPath.push_back(id);
+        std::reverse(m_abstractPath.begin(), m_abstractPath.end());
+
+        // Refine abstract steps into cells
+        out_path.push_back(Vector2i(startX, startY));
+        for (u32 i = 1; i < m_abstractPath.size(); ++i)
+        {
+            const AbstractNode & a = m_nodes[m_abstractPath[i - 1]];
+            const AbstractNode & b = m_nodes[m_abstractPath[i]];
+            if (a.cluster == b.cluster)
+            {
+                searchCluster(a.cluster, a.x, a.y, false);
+                appendLocalPath(b.x, b.y, out_path);
+            }
+            else
+            {
+                // Nodes on each side of an opening are neighbors
+                out_path.push_back(Vector2i(b.x, b.y));
+            }
+        }
+    }
+
+    for (u32 i = 0; i < linkedToEnd.size(); ++i)
+        m_nodes[linkedToEnd[i]].edges.pop_back();
+    removeNode(endNode);
+    removeNode(startNode);
+
+    return found;
+}
+
+} // namespace sn
+
@@ -0,0 +1,142 @@
+/*
+HierarchicalPathFinder.h
+Copyright (C) 2015-2015 Marc GILLERON
+This file is part of the SnowfeetEngine project.
+*/
+
+#ifndef __HEADER_SN_HIERARCHICALPATHFINDER__
+#define __HEADER_SN_HIERARCHICALPATHFINDER__
+
+#include <core/util/PathFinder.h>
+
+namespace sn
+{
+
+/// \brief Path finder for large grids, based on HPA* (Botea, Muller & Schaeffer, 2004).
+/// The grid is divided in square clusters. Crossable openings between neighbor clusters
+/// become nodes of an abstract graph, linked by the costs of the paths between them.
+/// Searches happen on the abstract graph first, then abstract steps are refined into cells
+/// with small searches limited to one cluster, so long paths evaluate far less nodes than A*.
+/// Paths are near-optimal (usually within a few percent of the best one).
+/// When the grid changes, only the clusters around the modified cells are rebuilt.
+/// \note The grid and movement options are the ones of the PathFinder given at construction.
+/// If options change, call rebuild().
+class SN_API HierarchicalPathFinder
+{
+public:
+    HierarchicalPathFinder(const PathFinder & finder, u32 clusterSize = 16);
+
+    /// \brief Rebuilds the whole abstract graph.
+    void rebuild();
+
+    /// \brief Tells that cells of the grid changed in the given area (inclusive bounds).
+    /// The affected clusters will be rebuilt before the next search, or when update() is called.
+    void onCellsChanged(s32 minX, s32 minY, s32 maxX, s32 maxY);
+
+    /// \brief Rebuilds clusters affected by changes right now.
+    void update();
+
+    /// \brief Sets the maximum number of abstract nodes a search can evaluate. Negative means no limit.
+    inline void setSearchLimit(s32 lim) { m_searchLimit = lim; }
+
+    /// \brief Finds a path and writes it in a buffer provided by the caller.
+    /// \param out_path: receives cells from the start to the end, both included. Cleared first.
+    /// \return true if a path was found.
+    bool findPath(s32 startX, s32 startY, s32 endX, s32 endY, std::vector<Vector2i> & out_path);
+
+    inline u32 getClusterSize() const { return m_clusterSize; }
+    u32 getAbstractNodeCount() const;
+
+private:
+    static const u32 INVALID_NODE = 0xffffffff;
+
+    struct Edge
+    {
+        u32 target;
+        s32 cost;
+    };
+
+    struct AbstractNode
+    {
+        s32 x;
+        s32 y;
+        u32 cluster;
+        std::vector<Edge> edges;
+
+        // Search data
+        s32 goneCost;
+        u32 parent;
+        u32 searchID;
+        bool closed;
+    };
+
+    struct OpenEntry
+    {
+        s32 cost;
+        u32 index;
+        // Note: reversed, so std heap functions give the lowest cost first
+        inline bool operator<(const OpenEntry & other) const { return cost > other.cost; }
+    };
+
+    inline u32 getClusterIndex(s32 x, s32 y) const
+    {
+        return (y / m_clusterSize) * m_clustersX + (x / m_clusterSize);
+    }
+
+    u32 createNode(s32 x, s32 y);
+    void removeNode(u32 node);
+
+    /// \brief Creates nodes for the openings between a cluster and its right (vertical=false) or bottom neighbor.
+    void buildEntrances(u32 cluster, bool vertical);
+    void removeEntrances(std::vector<u32> & borderNodes);
+    void removeIntraEdges(u32 cluster);
+    void buildIntraEdges(u32 cluster);
+
+    /// \brief Dijkstra search restricted to a cluster.
+    /// \param reverse: if true, computes the costs to reach the start cell instead of costs from it
+    void searchCluster(u32 cluster, s32 startX, s32 startY, bool reverse);
+    inline s32 getLocalCost(s32 x, s32 y) const;
+    void appendLocalPath(s32 endX, s32 endY, std::vector<Vector2i> & out_path);
+
+    bool searchAbstract(u32 startNode, u32 endNode);
+
+private:
+    const PathFinder & r_finder;
+    u32 m_clusterSize;
+    u32 m_clustersX;
+    u32 m_clustersY;
+    s32 m_searchLimit;
+
+    std::vector<AbstractNode> m_nodes;
+    std::vector<u32> m_freeNodes;
+    // [cluster][i]
+    std::vector<std::vector<u32>> m_clusterNodes;
+    // Node pairs (inside, outside) on the right and bottom borders of each cluster
+    std::vector<std::vector<u32>> m_rightBorders;
+    std::vector<std::vector<u32>> m_bottomBorders;
+
+    std::vector<u8> m_dirtyClusters;
+    std::vector<u32> m_dirtyClusterList;
+
+    // Abstract search data
+    u32 m_searchID;
+    std::vector<OpenEntry> m_open;
+    std::vector<u32> m_abstractPath;
+
+    // Local search data, sized to one cluster
+    u32 m_localSearchID;
+    s32 m_localOriginX;
+    s32 m_localOriginY;
+    s32 m_localSizeX;
+    s32 m_localSizeY;
+    std::vector<s32> m_localCosts;
+    std::vector<s32> m_localParents;
+    std::vector<u32> m_localSearchIDs;
+    std::vector<OpenEntry> m_localOpen;
+
+};
+
+} // namespace sn
+
+#endif // __HEADER_SN_HIERARCHICALPATHFINDER__
+
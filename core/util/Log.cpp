@@ -6,7 +6,10 @@ This file is part of the SnowfeetEngine project.
 
 #include "Log.h"
 #include "stringutils.h"
+#include "MPSCQueue.h"
 #include <core/system/console.h>
+#include <core/system/Thread.h>
+#include <vector>
 
 #ifdef _MSC_VER
 #include <Windows.h> // For OutputDebugString on Windows
@@ -15,6 +18,15 @@ This file is part of the SnowfeetEngine project.
 namespace sn
 {
 
+// Capacity of the asynchronous queue
+const size_t LOG_QUEUE_CAPACITY = 4096;
+
+// Maximum number of messages written between two flushes
+const size_t LOG_BATCH_SIZE = 256;
+
+// A message repeated in a row is written at most once in this interval
+const s32 LOG_REPEAT_INTERVAL_MS = 1000;
+
 //------------------------------------------------------------------------------
 // Static
 Log & Log::get()
@@ -23,11 +35,46 @@ Log & Log::get()
     return s_log;
 }
 
+//------------------------------------------------------------------------------
+Log::Log() :
+    m_messageType(SN_LTM_INFO),
+    m_fileOutputFlags(SN_LTM_ALL),
+#ifdef SN_BUILD_DEBUG
+    m_consoleOutputFlags(SN_LTM_ALL),
+#else
+    m_consoleOutputFlags(SN_LTM_INFO | SN_LTM_WARNING | SN_LTM_ERROR),
+#endif
+    m_enabledOutputFlags(0),
+    m_consoleBufferType(SN_LTM_INFO),
+    m_lastMessageType(SN_LTM_NONE),
+    m_repeatCount(0),
+    m_queue(nullptr),
+    m_writerThread(nullptr),
+    m_isAsync(false),
+    m_continueWriting(false),
+    m_pushedCount(0),
+    m_writtenCount(0)
+{
+    updateEnabledOutputFlags();
+}
+
+//------------------------------------------------------------------------------
+Log::~Log()
+{
+    stopAsync();
+    delete m_queue;
+
+    Lock lock(m_mutex);
+    writeRepeatCount();
+    flushOutputs();
+}
+
 //------------------------------------------------------------------------------
 void Log::setFileOutputFlags(u32 flags)
 {
     Lock lock(m_mutex);
     m_fileOutputFlags = flags;
+    updateEnabledOutputFlags();
 }
 
 //------------------------------------------------------------------------------
@@ -35,13 +82,18 @@ void Log::setConsoleOutputFlags(u32 flags)
 {
     Lock lock(m_mutex);
     m_consoleOutputFlags = flags;
+    updateEnabledOutputFlags();
 }
 
 //------------------------------------------------------------------------------
 void Log::closeFile()
 {
+    flush();
     Lock lock(m_mutex);
+    writeRepeatCount();
+    flushOutputs();
     m_file.close();
+    updateEnabledOutputFlags();
 }
 
 //------------------------------------------------------------------------------
@@ -52,16 +104,178 @@ bool Log::openFile(const std::string & fpath)
     if(!m_file.good())
     {
         std::cout << "E: Log: failed to open file \"" << fpath << '"' << std::endl;
+        m_file.close();
+        updateEnabledOutputFlags();
         return false;
     }
+    updateEnabledOutputFlags();
     return true;
 }
 
+//------------------------------------------------------------------------------
+void Log::startAsync()
+{
+    if (m_isAsync)
+        return;
+
+    if (m_queue == nullptr)
+        m_queue = new MPSCQueue<Message>(LOG_QUEUE_CAPACITY);
+
+    m_continueWriting = true;
+    m_writerThread = new Thread([this](){
+        writerLoop();
+    });
+    m_writerThread->start();
+
+    m_isAsync = true;
+}
+
+//------------------------------------------------------------------------------
+void Log::stopAsync()
+{
+    if (!m_isAsync)
+        return;
+
+    m_isAsync = false;
+
+    // The writer thread empties the queue before exiting
+    m_continueWriting = false;
+    m_writerThread->wait();
+    delete m_writerThread;
+    m_writerThread = nullptr;
+
+    Lock lock(m_mutex);
+
+    // Messages pushed by threads that didn't see the change yet
+    Message msg;
+    while (m_queue->pop(msg))
+    {
+        writeMessage(msg.type, msg.text);
+        ++m_writtenCount;
+    }
+
+    writeRepeatCount();
+    flushOutputs();
+}
+
+//------------------------------------------------------------------------------
+void Log::flush()
+{
+    if (!m_isAsync)
+        return;
+
+    u32 target = m_pushedCount;
+    while (m_isAsync && static_cast<s32>(m_writtenCount - target) < 0)
+    {
+        Thread::sleep(Time::milliseconds(0));
+    }
+}
+
 //------------------------------------------------------------------------------
 void Log::print(LogTypeMask logType, std::string msg)
 {
-    std::string prefix;
+    if (m_isAsync)
+    {
+        Message m;
+        m.type = logType;
+        m.text = std::move(msg);
+
+        ++m_pushedCount;
+        while (!m_queue->push(std::move(m)))
+        {
+            // The queue is full, wait for the writer to catch up
+            Thread::sleep(Time::milliseconds(0));
+        }
+
+        // Make sure errors reach the outputs before a possible crash
+        if (logType == SN_LTM_ERROR)
+            flush();
+    }
+    else
+    {
+        Lock lock(m_mutex);
+        writeMessage(logType, msg);
+        flushOutputs();
+    }
+}
+
+//------------------------------------------------------------------------------
+void Log::wprint(LogTypeMask logType, std::wstring msg)
+{
+    // TODO Log: better support for wide chars
+    print(logType, sn::toString(msg));
+}
+
+//------------------------------------------------------------------------------
+void Log::writerLoop()
+{
+    std::vector<Message> batch;
+    batch.reserve(LOG_BATCH_SIZE);
+
+    while (m_continueWriting || !m_queue->isEmpty())
+    {
+        batch.clear();
+        if (m_queue->popBatch(batch, LOG_BATCH_SIZE) == 0)
+        {
+            Thread::sleep(Time::milliseconds(1));
+            continue;
+        }
+
+        Lock lock(m_mutex);
+        for (auto it = batch.begin(); it != batch.end(); ++it)
+        {
+            writeMessage(it->type, it->text);
+        }
+        flushOutputs();
+
+        m_writtenCount += static_cast<u32>(batch.size());
+    }
+}
+
+//------------------------------------------------------------------------------
+void Log::writeMessage(LogTypeMask logType, const std::string & msg)
+{
+    // Rate-limit messages repeated in a row
+    if (logType != SN_LTM_MORE && logType == m_lastMessageType && msg == m_lastMessage)
+    {
+        ++m_repeatCount;
+        Time now = Time::getCurrent();
+        if (now.asMicroseconds() - m_lastRepeatWriteTime.asMicroseconds() >= LOG_REPEAT_INTERVAL_MS * 1000)
+        {
+            writeRepeatCount();
+            m_lastRepeatWriteTime = now;
+        }
+        return;
+    }
+
+    writeRepeatCount();
+
+    emit(logType, msg);
+
+    if (logType != SN_LTM_MORE)
+    {
+        m_lastMessage = msg;
+        m_lastMessageType = logType;
+        m_lastRepeatWriteTime = Time::getCurrent();
+    }
+}
+
+//------------------------------------------------------------------------------
+void Log::writeRepeatCount()
+{
+    if (m_repeatCount == 0)
+        return;
+
+    std::stringstream ss;
+    ss << "(previous message repeated " << m_repeatCount << " times)";
+    emit(SN_LTM_MORE, ss.str());
+    m_repeatCount = 0;
+}
 
+//------------------------------------------------------------------------------
+void Log::emit(LogTypeMask logType, const std::string & msg)
+{
+    const char * prefix = nullptr;
     switch (logType)
     {
     case SN_LTM_INFO:     prefix = "I: "; break;
@@ -71,14 +285,73 @@ void Log::print(LogTypeMask logType, std::string msg)
     default:              prefix = "D: "; break; // SN_LTM_DEBUG
     }
 
-    Lock lock(m_mutex);
+    // Continuations use the outputs of the message they continue
+    if (logType == SN_LTM_MORE)
+        logType = m_messageType;
+    else
+        m_messageType = logType;
 
     // TODO Log: add timestamp
 
+    if (m_file.is_open() && (logType & m_fileOutputFlags))
+    {
+        m_fileBuffer += prefix;
+        m_fileBuffer += msg;
+        m_fileBuffer += '\n';
+    }
+
+    if (logType & m_consoleOutputFlags)
+    {
+        // Messages are written by runs of the same type, so the color doesn't change for each line
+        if (logType != m_consoleBufferType)
+        {
+            flushConsoleBuffer();
+            m_consoleBufferType = logType;
+        }
+        m_consoleBuffer += prefix;
+        m_consoleBuffer += msg;
+        m_consoleBuffer += '\n';
+    }
+
+#if defined(SN_BUILD_DEBUG) && defined(_MSC_VER)
+    std::string debugMsg = prefix + msg + '\n';
+    OutputDebugString(debugMsg.c_str());
+#endif
+}
+
+//------------------------------------------------------------------------------
+void Log::flushOutputs()
+{
+    if (!m_fileBuffer.empty())
+    {
+        // Write messages in log file
+        m_file.write(m_fileBuffer.c_str(), m_fileBuffer.size());
+        m_file.flush();
+        m_fileBuffer.clear();
+    }
+
+    flushConsoleBuffer();
+}
+
+//------------------------------------------------------------------------------
+void Log::updateEnabledOutputFlags()
+{
+    u32 flags = m_consoleOutputFlags;
+    if (m_file.is_open())
+        flags |= m_fileOutputFlags;
+    m_enabledOutputFlags.store(flags, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+void Log::flushConsoleBuffer()
+{
+    if (m_consoleBuffer.empty())
+        return;
+
     // Set console color
     ConsoleColor oldColor = getConsoleForeground();
     ConsoleColor currentColor = oldColor;
-    switch (logType)
+    switch (m_consoleBufferType)
     {
     case SN_LTM_INFO:     currentColor = SN_CC_DEFAULT; break;
     case SN_LTM_WARNING:  currentColor = SN_CC_YELLOW; break;
@@ -90,46 +363,18 @@ void Log::print(LogTypeMask logType, std::string msg)
         setConsoleForeground(currentColor);
     }
 
-    msg = prefix + msg;
-
-    if (m_file && (m_messageType & m_fileOutputFlags))
-    {
-        // Write message in log file
-        m_file << msg << std::endl;
-    }
-
-    if (m_consoleOutputFlags & m_consoleOutputFlags)
-    {
-        // Write message in console
-        if (m_messageType == SN_LTM_ERROR)
-        {
-            std::cerr << msg << std::endl;
-        }
-        else
-        {
-            std::cout << msg << std::endl;
-        }
-    }
+    // Write messages in console
+    std::ostream & os = m_consoleBufferType == SN_LTM_ERROR ? std::cerr : std::cout;
+    os.write(m_consoleBuffer.c_str(), m_consoleBuffer.size());
+    os.flush();
+    m_consoleBuffer.clear();
 
     // Restore old console color
     if (currentColor != oldColor)
     {
         setConsoleForeground(oldColor);
     }
-
-#if defined(SN_BUILD_DEBUG) && defined(_MSC_VER)
-    msg += '\n';
-    OutputDebugString(msg.c_str());
-#endif
 }
 
-//------------------------------------------------------------------------------
-void Log::wprint(LogTypeMask logType, std::wstring msg)
-{
-    // TODO Log: better support for wide chars
-    print(logType, sn::toString(msg));
-}
-
-
 } // namespace sn
 
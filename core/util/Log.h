@@ -10,44 +10,89 @@ This file is part of the SnowfeetEngine project.
 #include <core/types.h>
 #include <core/util/NonCopyable.h>
 #include <core/system/Lock.h>
+#include <core/system/Time.h>
+#include <atomic>
 #include <iostream>
 #include <cassert>
 #include <fstream>
 #include <string>
 #include <sstream>
 
+//------------------------------------------------------------------------------
+// Levels for SN_LOG_MIN_LEVEL
+#define SN_LOG_LEVEL_DEBUG      0
+#define SN_LOG_LEVEL_INFO       1
+#define SN_LOG_LEVEL_WARNING    2
+#define SN_LOG_LEVEL_ERROR      3
+
+// Messages below this level are removed at compile time, and their arguments are not evaluated.
+// Can be defined by the build to override the default.
+#ifndef SN_LOG_MIN_LEVEL
+    #ifdef SN_BUILD_DEBUG
+        #define SN_LOG_MIN_LEVEL SN_LOG_LEVEL_DEBUG
+    #else
+        #define SN_LOG_MIN_LEVEL SN_LOG_LEVEL_INFO
+    #endif
+#endif
+
 //------------------------------------------------------------------------------
 #define _SN_LOG(logType, expr) \
     do {\
-        std::stringstream __sn_ss;\
-        __sn_ss << expr;\
-        sn::Log::get().print(logType, __sn_ss.str());\
+        if (sn::Log::get().isEnabled(logType)) {\
+            std::stringstream __sn_ss;\
+            __sn_ss << expr;\
+            sn::Log::get().print(logType, __sn_ss.str());\
+        }\
     } while (false)
 
 #define _SN_WLOG(logType, wexpr) \
     do {\
-        std::wstringstream __sn_wss;\
-        __sn_wss << wexpr;\
-        sn::Log::get().wprint(logType, __sn_wss.str());\
+        if (sn::Log::get().isEnabled(logType)) {\
+            std::wstringstream __sn_wss;\
+            __sn_wss << wexpr;\
+            sn::Log::get().wprint(logType, __sn_wss.str());\
+        }\
     } while (false)
 
+#define _SN_LOG_DISCARD(expr) do {} while (false)
+
 #ifdef SN_BUILD_DEBUG
 #define _SN_LOG_PREFIX __FILE__ << ":" << __LINE__ << ": " << 
 #else
 #define _SN_LOG_PREFIX
 #endif
 
-#define SN_LOG(expr)        _SN_LOG(sn::SN_LTM_INFO, expr)
-#define SN_DLOG(expr)       _SN_LOG(sn::SN_LTM_DEBUG, expr)
-#define SN_WARNING(expr)    _SN_LOG(sn::SN_LTM_WARNING, expr)
-#define SN_ERROR(expr)      _SN_LOG(sn::SN_LTM_ERROR, _SN_LOG_PREFIX expr)
-#define SN_MORE(expr)       _SN_LOG(sn::SN_LTM_MORE, expr)
+#if SN_LOG_MIN_LEVEL <= SN_LOG_LEVEL_DEBUG
+    #define SN_DLOG(expr)       _SN_LOG(sn::SN_LTM_DEBUG, expr)
+    #define SN_WDLOG(wexpr)     _SN_WLOG(sn::SN_LTM_DEBUG, wexpr)
+#else
+    #define SN_DLOG(expr)       _SN_LOG_DISCARD(expr)
+    #define SN_WDLOG(wexpr)     _SN_LOG_DISCARD(wexpr)
+#endif
 
-#define SN_WLOG(wexpr)      _SN_WLOG(sn::SN_LTM_INFO, wexpr)
-#define SN_WDLOG(wexpr)     _SN_WLOG(sn::SN_LTM_DEBUG, wexpr)
-#define SN_WWARNING(wexpr)  _SN_WLOG(sn::SN_LTM_WARNING, wexpr)
+#if SN_LOG_MIN_LEVEL <= SN_LOG_LEVEL_INFO
+    #define SN_LOG(expr)        _SN_LOG(sn::SN_LTM_INFO, expr)
+    #define SN_WLOG(wexpr)      _SN_WLOG(sn::SN_LTM_INFO, wexpr)
+#else
+    #define SN_LOG(expr)        _SN_LOG_DISCARD(expr)
+    #define SN_WLOG(wexpr)      _SN_LOG_DISCARD(wexpr)
+#endif
+
+#if SN_LOG_MIN_LEVEL <= SN_LOG_LEVEL_WARNING
+    #define SN_WARNING(expr)    _SN_LOG(sn::SN_LTM_WARNING, expr)
+    #define SN_WWARNING(wexpr)  _SN_WLOG(sn::SN_LTM_WARNING, wexpr)
+#else
+    #define SN_WARNING(expr)    _SN_LOG_DISCARD(expr)
+    #define SN_WWARNING(wexpr)  _SN_LOG_DISCARD(wexpr)
+#endif
+
+// Errors are always compiled
+#define SN_ERROR(expr)      _SN_LOG(sn::SN_LTM_ERROR, _SN_LOG_PREFIX expr)
 #define SN_WERROR(wexpr)    _SN_WLOG(sn::SN_LTM_ERROR, _SN_LOG_PREFIX wexpr)
-#define SN_WMORE(expr)      _SN_WLOG(sn::SN_LTM_MORE, wexpr)
+
+// Continuation of the previous message, whatever its level
+#define SN_MORE(expr)       _SN_LOG(sn::SN_LTM_MORE, expr)
+#define SN_WMORE(wexpr)     _SN_WLOG(sn::SN_LTM_MORE, wexpr)
 
 //------------------------------------------------------------------------------
 // Logs a message once. Subsequent executions do nothing.
@@ -66,6 +111,9 @@ This file is part of the SnowfeetEngine project.
 namespace sn
 {
 
+class Thread;
+template <typename T> class MPSCQueue;
+
 enum SN_API LogTypeMask
 {
     SN_LTM_DEBUG = 1,
@@ -79,6 +127,10 @@ enum SN_API LogTypeMask
 
 /// \brief Simple stream wrapper providing file and/or console output.
 /// This class can be used from multiple threads.
+/// By default messages are written on the calling thread.
+/// Once startAsync() is called, they are pushed to a lock-free queue instead,
+/// and written in batches by a background thread.
+/// A message repeated many times in a row is only written once per second, with a count.
 class SN_API Log : public NonCopyable
 {
 public:
@@ -86,6 +138,8 @@ public:
     /// \brief Gets global Log singleton
     static Log & get();
 
+    ~Log();
+
 public:
 
     /// \brief Sets which types of messages must be written to the file output.
@@ -96,7 +150,14 @@ public:
     /// \brief Sets which types of messages must be written to the console output.
     /// \param flags: bitmask where set flags activate a type of output.
     /// \see Log::MessageTypeMask
-    inline void setConsoleOutputFlags(u32 flags);
+    void setConsoleOutputFlags(u32 flags);
+
+    /// \brief Tells if a message of the given type would be written anywhere.
+    /// Used to skip formatting messages that would be discarded. Can be called from any thread.
+    inline bool isEnabled(LogTypeMask logType) const
+    {
+        return logType == SN_LTM_MORE || (logType & m_enabledOutputFlags.load(std::memory_order_relaxed)) != 0;
+    }
 
     /// \brief Sets which file will be used to output log messages.
     /// \param fpath: path to the file to open
@@ -107,6 +168,21 @@ public:
     /// \note This also disables outputting messages to a file unless openFile() gets called again.
     void closeFile();
 
+    /// \brief Starts writing messages from a background thread.
+    void startAsync();
+
+    /// \brief Writes pending messages and stops the background thread.
+    /// Messages are written on the calling thread again after this.
+    /// \warning Other threads should not be logging while this is called.
+    void stopAsync();
+
+    /// \brief Tells if messages are written by a background thread
+    inline bool isAsync() const { return m_isAsync; }
+
+    /// \brief Waits until all messages pushed so far are written.
+    /// This is done automatically after errors, so they don't get lost if the program crashes.
+    void flush();
+
     /// \brief Pushes a message to the log system.
     /// \param logType: nature of the message
     /// \param msg: message string
@@ -118,15 +194,26 @@ public:
     void wprint(LogTypeMask logType, std::wstring msg);
 
 private:
-    Log() :
-        m_messageType(SN_LTM_INFO),
-        m_fileOutputFlags(SN_LTM_ALL),
-#ifdef SN_BUILD_DEBUG
-        m_consoleOutputFlags(SN_LTM_WARNING | SN_LTM_ERROR | SN_LTM_DEBUG)
-#else
-        m_consoleOutputFlags(SN_LTM_WARNING | SN_LTM_ERROR)
-#endif
-    {}
+    /// \brief Message as stored in the asynchronous queue
+    struct Message
+    {
+        LogTypeMask type;
+        std::string text;
+
+        Message() : type(SN_LTM_INFO) {}
+    };
+
+    Log();
+
+    void writerLoop();
+
+    // The following must be called with the mutex locked
+    void writeMessage(LogTypeMask logType, const std::string & msg);
+    void writeRepeatCount();
+    void emit(LogTypeMask logType, const std::string & msg);
+    void flushOutputs();
+    void flushConsoleBuffer();
+    void updateEnabledOutputFlags();
 
 private:
 
@@ -142,9 +229,34 @@ private:
     /// \brief Bitmask storing which messages to output to the console.
     u8 m_consoleOutputFlags;
 
-    /// \brief Synchronization mutex to be able to use the logger from multiple threads
+    /// \brief Union of the console flags and the file flags if the file is open.
+    /// Updated with the mutex locked, read without it by isEnabled().
+    std::atomic<u32> m_enabledOutputFlags;
+
+    /// \brief Synchronization mutex to be able to use the logger from multiple threads.
+    /// In asynchronous mode, only the writer thread locks it while writing.
     Mutex m_mutex;
 
+    /// \brief Pending output, written in one go when flushing
+    std::string m_fileBuffer;
+    std::string m_consoleBuffer;
+    LogTypeMask m_consoleBufferType;
+
+    /// \brief Last message written, to detect repetitions
+    std::string m_lastMessage;
+    LogTypeMask m_lastMessageType;
+    u32 m_repeatCount;
+    /// \brief When the repeated message was last written
+    Time m_lastRepeatWriteTime;
+
+    /// \brief Messages waiting to be written by the writer thread
+    MPSCQueue<Message> * m_queue;
+    Thread * m_writerThread;
+    std::atomic<bool> m_isAsync;
+    std::atomic<bool> m_continueWriting;
+    std::atomic<u32> m_pushedCount;
+    std::atomic<u32> m_writtenCount;
+
 };
 
 } // namespace sn
@@ -0,0 +1,170 @@
+/*
+MPSCQueue.h
+Copyright (C) 2015-2015 Marc GILLERON
+This file is part of the SnowfeetEngine project.
+*/
+
+#ifndef __HEADER_SN_MPSCQUEUE__
+#define __HEADER_SN_MPSCQUEUE__
+
+#include <core/types.h>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+namespace sn
+{
+
+/// \brief Bounded lock-free queue with multiple producer threads and a single consumer thread.
+/// Each slot carries a sequence number telling if it is ready to be written or read,
+/// so producers only contend on the write index and the consumer never blocks them.
+/// Values are moved in and out of pre-allocated slots, which keep their capacity between uses
+/// (a string member won't be reallocated if the new one is not longer).
+/// \note T must be default-constructible and move-assignable.
+/// \warning Only one thread at a time may call pop functions.
+template <typename T>
+class MPSCQueue
+{
+public:
+    /// \brief Creates a queue able to hold at least the given number of elements.
+    /// The capacity is rounded up to a power of two.
+    explicit MPSCQueue(size_t capacity = 1024):
+        m_writePos(0),
+        m_readPos(0)
+    {
+        size_t n = 2;
+        while (n < capacity)
+            n <<= 1;
+        m_mask = n - 1;
+        m_cells = new Cell[n];
+        for (size_t i = 0; i < n; ++i)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    ~MPSCQueue()
+    {
+        delete[] m_cells;
+    }
+
+    inline size_t getCapacity() const { return m_mask + 1; }
+
+    /// \brief Pushes a value. Can be called from any thread.
+    /// \return false if the queue is full. In this case the value is left untouched.
+    bool push(T && value)
+    {
+        Cell * cell = nullptr;
+        size_t pos = m_writePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+            if (diff == 0)
+            {
+                // The slot is free, try to claim it
+                if (m_writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                // The consumer didn't read this slot yet: full
+                return false;
+            }
+            else
+            {
+                // Another producer claimed it before us
+                pos = m_writePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = std::move(value);
+        // Publish to the consumer
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    inline bool push(const T & value)
+    {
+        T temp(value);
+        return push(std::move(temp));
+    }
+
+    /// \brief Pops the oldest value. Must be called from the consumer thread only.
+    /// \return false if there was no value to pop.
+    bool pop(T & out_value)
+    {
+        size_t pos = m_readPos;
+        Cell & cell = m_cells[pos & m_mask];
+        if (cell.sequence.load(std::memory_order_acquire) != pos + 1)
+            return false;
+
+        out_value = std::move(cell.value);
+        // Give the slot back to producers
+        cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+        m_readPos = pos + 1;
+        return true;
+    }
+
+    /// \brief Pops up to maxCount values into an array, oldest first.
+    /// Must be called from the consumer thread only.
+    /// \return Number of values popped
+    size_t popBatch(T * out_values, size_t maxCount)
+    {
+        size_t count = 0;
+        while (count < maxCount && pop(out_values[count]))
+            ++count;
+        return count;
+    }
+
+    /// \brief Pops up to maxCount values and appends them to a vector, oldest first.
+    /// Must be called from the consumer thread only.
+    /// \return Number of values popped
+    size_t popBatch(std::vector<T> & out_values, size_t maxCount)
+    {
+        size_t count = 0;
+        T value;
+        while (count < maxCount && pop(value))
+        {
+            out_values.push_back(std::move(value));
+            ++count;
+        }
+        return count;
+    }
+
+    /// \brief Tells if there is nothing to pop.
+    /// Only reliable from the consumer thread, producers may push at any time.
+    bool isEmpty() const
+    {
+        const Cell & cell = m_cells[m_readPos & m_mask];
+        return cell.sequence.load(std::memory_order_acquire) != m_readPos + 1;
+    }
+
+private:
+    // Not copyable
+    MPSCQueue(const MPSCQueue &);
+    MPSCQueue & operator=(const MPSCQueue &);
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    // Indexes are kept on separate cache lines so producers and the consumer don't fight over them
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    Cell * m_cells;
+    size_t m_mask;
+    u8 m_padding0[CACHE_LINE_SIZE];
+    std::atomic<size_t> m_writePos;
+    u8 m_padding1[CACHE_LINE_SIZE];
+    size_t m_readPos;
+    u8 m_padding2[CACHE_LINE_SIZE];
+
+};
+
+} // namespace sn
+
+#endif // __HEADER_SN_MPSCQUEUE__
+
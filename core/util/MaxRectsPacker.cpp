@@ -0,0 +1,220 @@
+#include "MaxRectsPacker.h"
+#include "assert.h"
+#include <algorithm>
+
+namespace sn
+{
+
+namespace
+{
+    bool containsRect(const IntRect & a, const IntRect & b)
+    {
+        return b.x() >= a.x() && b.y() >= a.y()
+            && b.x() + b.width() <= a.x() + a.width()
+            && b.y() + b.height() <= a.y() + a.height();
+    }
+
+    bool overlaps(const IntRect & a, const IntRect & b)
+    {
+        return a.x() < b.x() + b.width() && b.x() < a.x() + a.width()
+            && a.y() < b.y() + b.height() && b.y() < a.y() + a.height();
+    }
+}
+
+//------------------------------------------------------------------------------
+MaxRectsPacker::MaxRectsPacker(u32 width, u32 height) : RectPacker(width, height)
+{
+    clear();
+}
+
+//------------------------------------------------------------------------------
+bool MaxRectsPacker::insert(u32 width, u32 height, IntRect * out_rect)
+{
+    if (width == 0 || height == 0)
+        return false;
+
+    const s32 w = static_cast<s32>(width);
+    const s32 h = static_cast<s32>(height);
+
+    // Best short side fit, then best long side fit
+    s32 bestIndex = -1;
+    s32 bestShortSide = 0;
+    s32 bestLongSide = 0;
+    for (u32 i = 0; i < m_freeRects.size(); ++i)
+    {
+        const IntRect & r = m_freeRects[i];
+        if (r.width() < w || r.height() < h)
+            continue;
+        s32 leftoverX = r.width() - w;
+        s32 leftoverY = r.height() - h;
+        s32 shortSide = std::min(leftoverX, leftoverY);
+        s32 longSide = std::max(leftoverX, leftoverY);
+        if (bestIndex < 0 || shortSide < bestShortSide || (shortSide == bestShortSide && longSide < bestLongSide))
+        {
+            bestIndex = i;
+            bestShortSide = shortSide;
+            bestLongSide = longSide;
+        }
+    }
+    if (bestIndex < 0)
+        return false;
+
+    IntRect rect(m_freeRects[bestIndex].x(), m_freeRects[bestIndex].y(), w, h);
+    pruneFreeRects(splitFreeRects(rect));
+
+    m_usedRects.push_back(rect);
+    onInserted(rect);
+    if (out_rect)
+        *out_rect = rect;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool MaxRectsPacker::remove(const IntRect & rect)
+{
+    auto it = m_usedRects.begin();
+    for (; it != m_usedRects.end(); ++it)
+    {
+        if (isSameRect(*it, rect))
+            break;
+    }
+    if (it == m_usedRects.end())
+        return false;
+    *it = m_usedRects.back();
+    m_usedRects.pop_back();
+    onRemoved(rect);
+
+    // Free rectangles never overlap used ones, so the new one is disjoint from them
+    m_freeRects.push_back(rect);
+    mergeFreeRects();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void MaxRectsPacker::clear()
+{
+    m_freeRects.clear();
+    m_freeRects.push_back(IntRect(0, 0, m_width, m_height));
+    m_usedRects.clear();
+    onCleared();
+}
+
+//------------------------------------------------------------------------------
+void MaxRectsPacker::grow(u32 width, u32 height)
+{
+    SN_ASSERT(width >= m_width && height >= m_height, "Cannot shrink the container");
+
+    const s32 oldWidth = static_cast<s32>(m_width);
+    const s32 oldHeight = static_cast<s32>(m_height);
+    const s32 newWidth = static_cast<s32>(width);
+    const s32 newHeight = static_cast<s32>(height);
+
+    // Free rectangles touching the border extend into the new area, which is all free
+    for (u32 i = 0; i < m_freeRects.size(); ++i)
+    {
+        IntRect & r = m_freeRects[i];
+        if (r.x() + r.width() == oldWidth)
+            r.width() = newWidth - r.x();
+        if (r.y() + r.height() == oldHeight)
+            r.height() = newHeight - r.y();
+    }
+    if (newWidth > oldWidth)
+        m_freeRects.push_back(IntRect(oldWidth, 0, newWidth - oldWidth, newHeight));
+    if (newHeight > oldHeight)
+        m_freeRects.push_back(IntRect(0, oldHeight, newWidth, newHeight - oldHeight));
+
+    m_width = width;
+    m_height = height;
+    pruneFreeRects();
+}
+
+//------------------------------------------------------------------------------
+u32 MaxRectsPacker::splitFreeRects(const IntRect & used)
+{
+    m_splitRects.clear();
+    for (u32 i = 0; i < m_freeRects.size(); ++i)
+    {
+        const IntRect r = m_freeRects[i];
+        if (!overlaps(r, used))
+            continue;
+
+        // Up to four maximal rectangles around the used one
+        if (used.x() > r.x())
+            m_splitRects.push_back(IntRect(r.x(), r.y(), used.x() - r.x(), r.height()));
+        if (used.x() + used.width() < r.x() + r.width())
+            m_splitRects.push_back(IntRect(used.x() + used.width(), r.y(), r.x() + r.width() - used.x() - used.width(), r.height()));
+        if (used.y() > r.y())
+            m_splitRects.push_back(IntRect(r.x(), r.y(), r.width(), used.y() - r.y()));
+        if (used.y() + used.height() < r.y() + r.height())
+            m_splitRects.push_back(IntRect(r.x(), used.y() + used.height(), r.width(), r.y() + r.height() - used.y() - used.height()));
+
+        // Marked for removal
+        m_freeRects[i].width() = 0;
+    }
+
+    m_freeRects.erase(
+        std::remove_if(m_freeRects.begin(), m_freeRects.end(), [](const IntRect & r) { return r.width() == 0; }),
+        m_freeRects.end()
+    );
+
+    u32 firstNew = m_freeRects.size();
+    m_freeRects.insert(m_freeRects.end(), m_splitRects.begin(), m_splitRects.end());
+    return firstNew;
+}
+
+//------------------------------------------------------------------------------
+void MaxRectsPacker::pruneFreeRects(u32 firstNew)
+{
+    for (u32 i = firstNew; i < m_freeRects.size(); ++i)
+    {
+        const IntRect & r = m_freeRects[i];
+        bool contained = false;
+        for (u32 j = 0; j < m_freeRects.size() && !contained; ++j)
+        {
+            // Among identical rectangles, the first one is kept
+            const IntRect & other = m_freeRects[j];
+            contained = j != i && containsRect(other, r) && (j < i || !containsRect(r, other));
+        }
+        if (contained)
+        {
+            m_freeRects.erase(m_freeRects.begin() + i);
+            --i;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void MaxRectsPacker::mergeFreeRects()
+{
+    bool merged = true;
+    while (merged)
+    {
+        merged = false;
+        for (u32 i = 0; i < m_freeRects.size() && !merged; ++i)
+        {
+            for (u32 j = i + 1; j < m_freeRects.size() && !merged; ++j)
+            {
+                IntRect & a = m_freeRects[i];
+                const IntRect & b = m_freeRects[j];
+                if (a.x() == b.x() && a.width() == b.width()
+                    && (a.y() + a.height() == b.y() || b.y() + b.height() == a.y()))
+                {
+                    a = IntRect(a.x(), std::min(a.y(), b.y()), a.width(), a.height() + b.height());
+                    merged = true;
+                }
+                else if (a.y() == b.y() && a.height() == b.height()
+                    && (a.x() + a.width() == b.x() || b.x() + b.width() == a.x()))
+                {
+                    a = IntRect(std::min(a.x(), b.x()), a.y(), a.width() + b.width(), a.height());
+                    merged = true;
+                }
+                if (merged)
+                    m_freeRects.erase(m_freeRects.begin() + j);
+            }
+        }
+    }
+    pruneFreeRects();
+}
+
+} // namespace sn
+
@@ -0,0 +1,48 @@
+#ifndef __HEADER_SN_MAXRECTSPACKER__
+#define __HEADER_SN_MAXRECTSPACKER__
+
+#include <core/util/RectPacker.h>
+#include <vector>
+
+namespace sn
+{
+
+/// \brief Packs rectangles by keeping track of all maximal free rectangles of the container,
+/// and choosing the one the new rectangle fits best (best short side fit).
+/// It gives the densest packings, at the cost of slower insertions when many rectangles are stored.
+class SN_API MaxRectsPacker : public RectPacker
+{
+public:
+    MaxRectsPacker(u32 width, u32 height);
+
+    bool insert(u32 width, u32 height, IntRect * out_rect) override;
+
+    /// \brief Removes a rectangle. Its room is merged with free neighbours sharing a whole side.
+    bool remove(const IntRect & rect) override;
+
+    void clear() override;
+    void grow(u32 width, u32 height) override;
+
+private:
+    /// \brief Cuts free rectangles overlapping a used one into the parts around it
+    /// \return index of the first free rectangle resulting from the split
+    u32 splitFreeRects(const IntRect & usedRect);
+
+    /// \brief Removes free rectangles contained in others.
+    /// \param firstNew: rectangles before this index are known not to be contained in any other
+    void pruneFreeRects(u32 firstNew = 0);
+
+    void mergeFreeRects();
+
+private:
+    std::vector<IntRect> m_freeRects;
+    std::vector<IntRect> m_usedRects;
+
+    // Temporary storage
+    std::vector<IntRect> m_splitRects;
+};
+
+} // namespace sn
+
+#endif // __HEADER_SN_MAXRECTSPACKER__
+
@@ -7,6 +7,7 @@ Based on the work of Gustavo FRANCO (2006)
 
 #include <core/util/PathFinder.h>
 #include <core/util/Log.h>
+#include <algorithm>
 
 namespace sn
 {
@@ -26,37 +27,106 @@ const s8 PathFinder::s_directions[8][2] =
 };
 
 //------------------------------------------------------------------------------
-std::vector<PathFinder::Node> * PathFinder::findPath(s32 startX, s32 startY, s32 endX, s32 endY)
+void PathFinder::beginSearch()
 {
-    bool found = false;
-    bool stop = false;
-    s32 heuristicEstimate = 2;
-    s32 closeNodeCounter = 0;
-    s32 directionCount = m_diagonals ? 8 : 4;
-
     // Instead of clearing the grid each time, I change node state values and simply ignore the other values.
     // It's faster than clearing the grid (not much, but it is).
-    m_openNodeValue += 2;
-    m_closeNodeValue += 2;
+    // When values would overflow, the grid is cleared once so old states can't be taken for new ones.
+    if (m_closeNodeValue >= 126)
+    {
+        s32 area = m_gridSizeX * m_gridSizeY;
+        for (s32 i = 0; i < area; ++i)
+            m_calcGrid[i].state = 0;
+        m_openNodeValue = 1;
+        m_closeNodeValue = 2;
+    }
+    else
+    {
+        m_openNodeValue += 2;
+        m_closeNodeValue += 2;
+    }
 
     m_open.clear();
-    m_close.clear();
+}
+
+//------------------------------------------------------------------------------
+void PathFinder::initSearch(s32 startX, s32 startY, s32 endX, s32 endY, bool jps)
+{
+    beginSearch();
+
+    m_searchStartX = startX;
+    m_searchStartY = startY;
+    m_searchEndX = endX;
+    m_searchEndY = endY;
+    m_searchUsesJPS = jps;
+    m_closeNodeCounter = 0;
+    m_searchStatus = SEARCH_IN_PROGRESS;
 
     s32 location = encodeLocation(startX, startY);
-    s32 endLocation = encodeLocation(endX, endY);
-    u16 locationX=0, locationY=0;
 
     m_calcGrid[location].goneCost  = 0;
-    m_calcGrid[location].cost      = 0 + heuristicEstimate;
+    m_calcGrid[location].cost      = jps ? getCostLowerBound(startX, startY, endX, endY) : 2;
     m_calcGrid[location].parentX   = (u16) startX;
     m_calcGrid[location].parentY   = (u16) startY;
     m_calcGrid[location].state     = m_openNodeValue;
 
-    m_open.push(location);
+    m_open.push(OpenNode(m_calcGrid[location].cost, 0, location));
+}
+
+//------------------------------------------------------------------------------
+void PathFinder::startSearch(s32 startX, s32 startY, s32 endX, s32 endY)
+{
+    if(!isCrossable(startX, startY) || !isCrossable(endX, endY))
+    {
+        m_searchStatus = SEARCH_NOT_FOUND;
+        return;
+    }
+    initSearch(startX, startY, endX, endY, isJumpPointSearchUsable());
+}
+
+//------------------------------------------------------------------------------
+PathFinder::SearchStatus PathFinder::resumeSearch(u32 maxNodes)
+{
+    if(m_searchStatus == SEARCH_IN_PROGRESS)
+    {
+        m_searchStatus = m_searchUsesJPS ? stepJPS(maxNodes) : stepAStar(maxNodes);
+#ifdef SN_BUILD_DEBUG
+        if(m_searchStatus == SEARCH_NOT_FOUND)
+            SN_DLOG("Pathfinder path not found");
+#endif
+    }
+    return m_searchStatus;
+}
+
+//------------------------------------------------------------------------------
+bool PathFinder::getPath(std::vector<Vector2i> & out_path)
+{
+    out_path.clear();
+    if(m_searchStatus != SEARCH_FOUND)
+        return false;
+    buildPath(m_searchEndX, m_searchEndY, out_path);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+PathFinder::SearchStatus PathFinder::stepAStar(u32 maxNodes)
+{
+    const s32 heuristicEstimate = 2;
+    s32 directionCount = m_diagonals ? 8 : 4;
+    s32 endX = m_searchEndX;
+    s32 endY = m_searchEndY;
+
+    s32 endLocation = encodeLocation(endX, endY);
+    u16 locationX=0, locationY=0;
+    u32 evaluatedNodes = 0;
 
-    while(m_open.count() > 0 && !stop)
+    while(m_open.count() > 0)
     {
-        location = m_open.pop();
+        if(evaluatedNodes == maxNodes)
+            return SEARCH_IN_PROGRESS;
+        ++evaluatedNodes;
+
+        s32 location = m_open.pop().location;
 
         // Is it in closed list? means this node was already processed
         if(m_calcGrid[location].state == m_closeNodeValue)
@@ -69,17 +139,16 @@ std::vector<PathFinder::Node> * PathFinder::findPath(s32 startX, s32 startY, s32
         if(location == endLocation)
         {
             m_calcGrid[location].state = m_closeNodeValue;
-            found = true;
-            break;
+            return SEARCH_FOUND;
         }
 
-        if(closeNodeCounter > m_searchLimit)
+        if(m_searchLimit >= 0 && m_closeNodeCounter > m_searchLimit)
         {
             // Evaluated nodes exceeded limit : path not found
 #ifdef SN_BUILD_DEBUG
             SN_DLOG("Pathfinder searchLimit exceed");
 #endif
-            return nullptr;
+            return SEARCH_NOT_FOUND;
         }
 
         // Let's calculate each successors
@@ -153,19 +222,28 @@ std::vector<PathFinder::Node> * PathFinder::findPath(s32 startX, s32 startY, s32
 
             //It is faster if we leave the open node in the priority queue
             //When it is removed, it will be already closed, it will be ignored automatically
-            m_open.push(newLocation);
+            m_open.push(OpenNode(m_calcGrid[newLocation].cost, heuristic, newLocation));
 
             m_calcGrid[newLocation].state = m_openNodeValue;
         }
 
-        ++closeNodeCounter;
+        ++m_closeNodeCounter;
         m_calcGrid[location].state = m_closeNodeValue;
     }
 
-    if(found)
-    {
-        m_close.clear();
+    return SEARCH_NOT_FOUND;
+}
 
+//------------------------------------------------------------------------------
+std::vector<PathFinder::Node> * PathFinder::findPath(s32 startX, s32 startY, s32 endX, s32 endY)
+{
+    m_close.clear();
+
+    initSearch(startX, startY, endX, endY, false);
+    m_searchStatus = stepAStar(0xffffffff);
+
+    if(m_searchStatus == SEARCH_FOUND)
+    {
         int posX = endX;
         int posY = endY;
 
@@ -211,6 +289,229 @@ std::vector<PathFinder::Node> * PathFinder::findPath(s32 startX, s32 startY, s32
     return nullptr;
 }
 
+//------------------------------------------------------------------------------
+bool PathFinder::findPath(s32 startX, s32 startY, s32 endX, s32 endY, std::vector<Vector2i> & out_path)
+{
+    startSearch(startX, startY, endX, endY);
+    resumeSearch(0xffffffff);
+    return getPath(out_path);
+}
+
+//------------------------------------------------------------------------------
+void PathFinder::buildPath(s32 endX, s32 endY, std::vector<Vector2i> & out_path)
+{
+    s32 x = endX;
+    s32 y = endY;
+
+    for(;;)
+    {
+        const NodeFast & node = m_calcGrid[encodeLocation(x, y)];
+        s32 px = node.parentX;
+        s32 py = node.parentY;
+
+        if(px == x && py == y)
+            break;
+
+        // Jump points are not adjacent, but always aligned horizontally, vertically or diagonally
+        s32 dx = px > x ? 1 : (px < x ? -1 : 0);
+        s32 dy = py > y ? 1 : (py < y ? -1 : 0);
+        while(x != px || y != py)
+        {
+            out_path.push_back(Vector2i(x, y));
+            x += dx;
+            y += dy;
+        }
+    }
+
+    out_path.push_back(Vector2i(x, y));
+
+    std::reverse(out_path.begin(), out_path.end());
+}
+
+//------------------------------------------------------------------------------
+// Jump Point Search (Harabor & Grastien, 2011), in its variant where diagonal moves
+// require both adjacent cardinal cells to be crossable.
+// Instead of adding every neighbor to the open list, the search "jumps" in straight lines
+// and only stops on cells where the optimal path may change direction (jump points).
+PathFinder::SearchStatus PathFinder::stepJPS(u32 maxNodes)
+{
+    const s32 straightCost = 1;
+    const s32 diagonalCost = m_heavyDiagonals ? (s32)2.41f : 1;
+    s32 endX = m_searchEndX;
+    s32 endY = m_searchEndY;
+    s32 endLocation = encodeLocation(endX, endY);
+    u32 evaluatedNodes = 0;
+
+    // Directions to explore from the current node
+    s32 dirs[8][2];
+
+    while(m_open.count() > 0)
+    {
+        if(evaluatedNodes == maxNodes)
+            return SEARCH_IN_PROGRESS;
+        ++evaluatedNodes;
+
+        s32 location = m_open.pop().location;
+
+        NodeFast & node = m_calcGrid[location];
+        if(node.state == m_closeNodeValue)
+            continue;
+
+        if(location == endLocation)
+        {
+            node.state = m_closeNodeValue;
+            return SEARCH_FOUND;
+        }
+
+        if(m_searchLimit >= 0 && m_closeNodeCounter > m_searchLimit)
+        {
+#ifdef SN_BUILD_DEBUG
+            SN_DLOG("Pathfinder searchLimit exceed");
+#endif
+            return SEARCH_NOT_FOUND;
+        }
+
+        node.state = m_closeNodeValue;
+        ++m_closeNodeCounter;
+
+        s32 x = location % m_gridSizeX;
+        s32 y = location / m_gridSizeX;
+
+        // Prune neighbors: only keep the ones the path could naturally continue to,
+        // or forced ones because of nearby obstacles.
+        u32 dirCount = 0;
+        s32 dx = node.parentX < x ? 1 : (node.parentX > x ? -1 : 0);
+        s32 dy = node.parentY < y ? 1 : (node.parentY > y ? -1 : 0);
+
+        if(dx == 0 && dy == 0)
+        {
+            // Start node: all directions
+            for(u32 i = 0; i < 8; ++i)
+            {
+                if(getStepCost(x, y, i) != 0)
+                {
+                    dirs[dirCount][0] = s_directions[i][0];
+                    dirs[dirCount][1] = s_directions[i][1];
+                    ++dirCount;
+                }
+            }
+        }
+        else if(dx != 0 && dy != 0)
+        {
+            bool canGoY = isCrossable(x, y + dy);
+            bool canGoX = isCrossable(x + dx, y);
+            if(canGoY) { dirs[dirCount][0] = 0; dirs[dirCount][1] = dy; ++dirCount; }
+            if(canGoX) { dirs[dirCount][0] = dx; dirs[dirCount][1] = 0; ++dirCount; }
+            if(canGoX && canGoY) { dirs[dirCount][0] = dx; dirs[dirCount][1] = dy; ++dirCount; }
+        }
+        else if(dx != 0)
+        {
+            bool canGoNext = isCrossable(x + dx, y);
+            bool canGoDown = isCrossable(x, y + 1);
+            bool canGoUp = isCrossable(x, y - 1);
+            if(canGoNext)
+            {
+                dirs[dirCount][0] = dx; dirs[dirCount][1] = 0; ++dirCount;
+                if(canGoDown) { dirs[dirCount][0] = dx; dirs[dirCount][1] = 1; ++dirCount; }
+                if(canGoUp) { dirs[dirCount][0] = dx; dirs[dirCount][1] = -1; ++dirCount; }
+            }
+            if(canGoDown) { dirs[dirCount][0] = 0; dirs[dirCount][1] = 1; ++dirCount; }
+            if(canGoUp) { dirs[dirCount][0] = 0; dirs[dirCount][1] = -1; ++dirCount; }
+        }
+        else
+        {
+            bool canGoNext = isCrossable(x, y + dy);
+            bool canGoRight = isCrossable(x + 1, y);
+            bool canGoLeft = isCrossable(x - 1, y);
+            if(canGoNext)
+            {
+                dirs[dirCount][0] = 0; dirs[dirCount][1] = dy; ++dirCount;
+                if(canGoRight) { dirs[dirCount][0] = 1; dirs[dirCount][1] = dy; ++dirCount; }
+                if(canGoLeft) { dirs[dirCount][0] = -1; dirs[dirCount][1] = dy; ++dirCount; }
+            }
+            if(canGoRight) { dirs[dirCount][0] = 1; dirs[dirCount][1] = 0; ++dirCount; }
+            if(canGoLeft) { dirs[dirCount][0] = -1; dirs[dirCount][1] = 0; ++dirCount; }
+        }
+
+        for(u32 i = 0; i < dirCount; ++i)
+        {
+            s32 jx, jy;
+            if(!jump(x, y, dirs[i][0], dirs[i][1], endX, endY, jx, jy))
+                continue;
+
+            s32 jumpLocation = encodeLocation(jx, jy);
+            NodeFast & jumpNode = m_calcGrid[jumpLocation];
+            if(jumpNode.state == m_closeNodeValue)
+                continue;
+
+            // Jumps are straight or diagonal lines
+            s32 distance = std::max(std::abs(jx - x), std::abs(jy - y));
+            s32 stepCost = (dirs[i][0] != 0 && dirs[i][1] != 0) ? diagonalCost : straightCost;
+            s32 newGoneCost = m_calcGrid[location].goneCost + distance * stepCost;
+
+            if(jumpNode.state == m_openNodeValue && jumpNode.goneCost <= newGoneCost)
+                continue;
+
+            jumpNode.parentX = x;
+            jumpNode.parentY = y;
+            jumpNode.goneCost = newGoneCost;
+            jumpNode.cost = newGoneCost + getCostLowerBound(jx, jy, endX, endY);
+            jumpNode.state = m_openNodeValue;
+            m_open.push(OpenNode(jumpNode.cost, jumpNode.cost - newGoneCost, jumpLocation));
+        }
+    }
+
+    return SEARCH_NOT_FOUND;
+}
+
+//------------------------------------------------------------------------------
+bool PathFinder::jump(s32 x, s32 y, s32 dx, s32 dy, s32 endX, s32 endY, s32 & out_x, s32 & out_y) const
+{
+    for(;;)
+    {
+        if(dx != 0 && dy != 0)
+        {
+            // Diagonal moves can't cut corners
+            if(!isCrossable(x + dx, y) || !isCrossable(x, y + dy))
+                return false;
+        }
+
+        x += dx;
+        y += dy;
+
+        if(!isCrossable(x, y))
+            return false;
+
+        if(x == endX && y == endY)
+            break;
+
+        if(dx != 0 && dy != 0)
+        {
+            // When moving diagonally, stop if a jump point can be reached horizontally or vertically
+            s32 jx, jy;
+            if(jump(x, y, dx, 0, endX, endY, jx, jy) || jump(x, y, 0, dy, endX, endY, jx, jy))
+                break;
+        }
+        else if(dx != 0)
+        {
+            // Forced neighbors: a cell beside us that could only be reached optimally from here
+            if((isCrossable(x, y - 1) && !isCrossable(x - dx, y - 1)) ||
+                (isCrossable(x, y + 1) && !isCrossable(x - dx, y + 1)))
+                break;
+        }
+        else
+        {
+            if((isCrossable(x - 1, y) && !isCrossable(x - 1, y - dy)) ||
+                (isCrossable(x + 1, y) && !isCrossable(x + 1, y - dy)))
+                break;
+        }
+    }
+
+    out_x = x;
+    out_y = y;
+    return true;
+}
+
 } // namespace sn
 
 
@@ -10,8 +10,10 @@ Based on the work of Gustavo FRANCO (2006)
 #include <cassert>
 #include <iostream>
 #include <cmath>
+#include <vector>
 
 #include <core/util/PriorityQueueB.h>
+#include <core/math/Vector2.h>
 
 namespace sn
 {
@@ -20,6 +22,8 @@ namespace sn
 /// Inspired on a similar implementation here :
 /// http://www.codeguru.com/csharp/csharp/cs_misc/designtechniques/article.php/c12527/AStar-A-Implementation-in-C-Path-Finding-PathFinder.htm
 /// Translated from C#.
+/// Can also use Jump Point Search on grids where all crossable cells have the same cost.
+/// For long paths on large grids, see HierarchicalPathFinder.
 class SN_API PathFinder
 {
 public:
@@ -46,6 +50,17 @@ public:
         s8 state = 0;
     };
 
+    /// \brief Offsets of neighbor cells: 4 cardinals followed by 4 diagonals.
+    static const s8 s_directions[8][2];
+
+    enum SearchStatus
+    {
+        SEARCH_NONE = 0,
+        SEARCH_IN_PROGRESS,
+        SEARCH_FOUND,
+        SEARCH_NOT_FOUND
+    };
+
 public:
 
     PathFinder(s8 * grid, u16 gridSizeX, u16 gridSizeY)
@@ -58,18 +73,6 @@ public:
         m_gridSizeY = gridSizeY;
 
         m_calcGrid = new NodeFast[m_gridSizeX * m_gridSizeY];
-
-        // a and b are not actually compared :
-        // I compare the grid values at [a] and [b].
-        // A lambda is necessary to keep a reference to the grid and still have
-        // a working encapsulated compare function.
-        m_open.m_comparer = [=](s32 a, s32 b) {
-            if(m_calcGrid[a].cost > m_calcGrid[b].cost)
-                return 1;
-            else if (m_calcGrid[a].cost < m_calcGrid[b].cost)
-                return -1;
-            return 0;
-        };
     }
 
     ~PathFinder()
@@ -77,13 +80,90 @@ public:
         delete[] m_calcGrid;
     }
 
+    /// \brief Sets the maximum number of nodes a search can evaluate. Negative means no limit.
     inline void setSearchLimit(s32 lim) { m_searchLimit = lim; }
     inline void setDiagonals(bool enable) { m_diagonals = enable; }
     inline void setHeavyDiagonals(bool enable) { m_heavyDiagonals = enable; }
     inline void setAvoidDiagonalCross(bool enable) { m_avoidDiagonalCross = enable; }
 
+    /// \brief Enables Jump Point Search, which evaluates far less nodes than A* on open areas.
+    /// It assumes all crossable cells have the same cost (values above 1 are treated as 1),
+    /// and is only used when diagonals are enabled and diagonal crossing is avoided.
+    /// A* is used otherwise.
+    inline void setJumpPointSearch(bool enable) { m_jumpPointSearch = enable; }
+
+    inline bool isJumpPointSearchUsable() const { return m_jumpPointSearch && m_diagonals && m_avoidDiagonalCross; }
+
+    inline const s8 * getGrid() const { return m_grid; }
+    inline u16 getGridSizeX() const { return m_gridSizeX; }
+    inline u16 getGridSizeY() const { return m_gridSizeY; }
+    inline bool hasDiagonals() const { return m_diagonals; }
+
+    inline bool isCrossable(s32 x, s32 y) const
+    {
+        return static_cast<u32>(x) < m_gridSizeX && static_cast<u32>(y) < m_gridSizeY && m_grid[y*m_gridSizeX+x] != 0;
+    }
+
+    /// \brief Gets the cost of moving from a cell to its neighbor, using the current options.
+    /// \param dir: index in s_directions
+    /// \return cost of the step, or 0 if it is not possible
+    s32 getStepCost(s32 x, s32 y, u32 dir) const
+    {
+        if (dir > 3 && !m_diagonals)
+            return 0;
+
+        s32 nx = x + s_directions[dir][0];
+        s32 ny = y + s_directions[dir][1];
+        if (!isCrossable(nx, ny))
+            return 0;
+
+        if (dir > 3)
+        {
+            // See findPath() for an explanation
+            if (m_avoidDiagonalCross && (!isCrossable(nx, y) || !isCrossable(x, ny)))
+                return 0;
+            if (m_heavyDiagonals)
+                return (s32) (m_grid[ny*m_gridSizeX+nx] * 2.41f);
+        }
+
+        return m_grid[ny*m_gridSizeX+nx];
+    }
+
+    /// \brief Gets a cost that is never more than the actual cost of a path between two cells.
+    s32 getCostLowerBound(s32 x0, s32 y0, s32 x1, s32 y1) const
+    {
+        s32 dx = std::abs(x1 - x0);
+        s32 dy = std::abs(y1 - y0);
+        if (!m_diagonals)
+            return dx + dy;
+        s32 diagonalCost = m_heavyDiagonals ? (s32)2.41f : 1;
+        s32 diagonalSteps = dx < dy ? dx : dy;
+        return dx + dy + (diagonalCost - 2) * diagonalSteps;
+    }
+
 private:
 
+    // Entry of the open list.
+    // The cost is copied, because it can change in the grid while the entry is still in the queue.
+    // On equal costs, nodes closer to the goal come first, so paths of equal length are not all explored.
+    struct OpenNode
+    {
+        s32 cost;
+        s32 heuristic;
+        s32 location;
+
+        OpenNode(s32 pCost = 0, s32 pHeuristic = 0, s32 pLocation = 0): cost(pCost), heuristic(pHeuristic), location(pLocation) {}
+
+        inline bool operator<(const OpenNode & other) const
+        {
+            return cost < other.cost || (cost == other.cost && heuristic < other.heuristic);
+        }
+        inline bool operator>(const OpenNode & other) const
+        {
+            return other < *this;
+        }
+    };
+
     inline s32 encodeLocation(s32 x, s32 y)
     {
         return y*m_gridSizeX+x;
@@ -97,8 +177,50 @@ private:
 
 public:
 
+    /// \brief Finds a path using A*.
+    /// \return Nodes from the end to the start, or nullptr if no path was found.
+    /// The returned list is owned by the PathFinder and is overwritten by the next search.
     std::vector<Node> * findPath(s32 startX, s32 startY, s32 endX, s32 endY);
 
+    /// \brief Finds a path and writes it in a buffer provided by the caller,
+    /// which can be reused across searches to avoid allocations.
+    /// Uses Jump Point Search if enabled and usable, A* otherwise.
+    /// \param out_path: receives cells from the start to the end, both included. Cleared first.
+    /// \return true if a path was found.
+    bool findPath(s32 startX, s32 startY, s32 endX, s32 endY, std::vector<Vector2i> & out_path);
+
+    /// \brief Starts a search that can be run over several calls to resumeSearch(),
+    /// so a long search can be spread across frames.
+    /// Uses Jump Point Search if enabled and usable, A* otherwise.
+    /// \note The grid must not change until the search is finished.
+    void startSearch(s32 startX, s32 startY, s32 endX, s32 endY);
+
+    /// \brief Continues the current search.
+    /// \param maxNodes: maximum number of nodes to take from the open list during this call
+    /// \return status of the search. Once found, the path can be retrieved with getPath().
+    SearchStatus resumeSearch(u32 maxNodes);
+
+    inline SearchStatus getSearchStatus() const { return m_searchStatus; }
+
+    /// \brief Writes the path found by the last search.
+    /// \param out_path: receives cells from the start to the end, both included. Cleared first.
+    /// \return true if the last search found a path.
+    bool getPath(std::vector<Vector2i> & out_path);
+
+private:
+
+    void beginSearch();
+    void initSearch(s32 startX, s32 startY, s32 endX, s32 endY, bool jps);
+    SearchStatus stepAStar(u32 maxNodes);
+    SearchStatus stepJPS(u32 maxNodes);
+
+    /// \brief Moves from a cell in a direction until a jump point is found.
+    /// \return true if a jump point was found, false if an obstacle was reached.
+    bool jump(s32 x, s32 y, s32 dx, s32 dy, s32 endX, s32 endY, s32 & out_x, s32 & out_y) const;
+
+    /// \brief Writes the path found by the last search, interpolating between jump points.
+    void buildPath(s32 endX, s32 endY, std::vector<Vector2i> & out_path);
+
 private:
 
     s8 * m_grid = nullptr; // 0 means uncrossable, 1 means crossable, more means crossable at higher cost etc.
@@ -110,17 +232,24 @@ private:
     bool m_diagonals = true;
     bool m_heavyDiagonals = true;
     bool m_avoidDiagonalCross = true;
+    bool m_jumpPointSearch = false;
+
+    // State of the current search
+    SearchStatus m_searchStatus = SEARCH_NONE;
+    bool m_searchUsesJPS = false;
+    s32  m_searchStartX = 0;
+    s32  m_searchStartY = 0;
+    s32  m_searchEndX = 0;
+    s32  m_searchEndY = 0;
+    s32  m_closeNodeCounter = 0;
 
     NodeFast *              m_calcGrid = nullptr;
-    PriorityQueueB<s32>     m_open;
+    PriorityQueueB<OpenNode> m_open;
     std::vector<Node>       m_close;
 
-    static const s8 s_directions[8][2];
-
 };
 
 } // namespace sn
 
 #endif // __HEADER_SN_PATHFINDER__
 
-
@@ -0,0 +1,349 @@
+/*
+PathQueryService.cpp
+Copyright (C) 2015-2015 Marc GILLERON
+This file is part of the SnowfeetEngine project.
+*/
+
+#include <core/util/PathQueryService.h>
+#include <core/system/Thread.h>
+#include <core/util/assert.h>
+#include <unordered_map>
+#include <algorithm>
+
+namespace sn
+{
+
+//------------------------------------------------------------------------------
+PathQueryService::PathQueryService(s8 * grid, u16 gridSizeX, u16 gridSizeY, u32 threadCount):
+    m_sliceSize(256),
+    m_flowFieldThreshold(16),
+    m_taskCount(0),
+    m_nextTask(0)
+{
+    if (threadCount == 0)
+        threadCount = 1;
+
+    // Each worker has its own scratch grids, so searches can run concurrently
+    for (u32 i = 0; i < threadCount; ++i)
+    {
+        Worker * worker = new Worker();
+        worker->finder = new PathFinder(grid, gridSizeX, gridSizeY);
+        worker->currentQuery = INVALID_QUERY;
+        m_workers.push_back(worker);
+    }
+}
+
+//------------------------------------------------------------------------------
+PathQueryService::~PathQueryService()
+{
+    for (u32 i = 0; i < m_workers.size(); ++i)
+    {
+        delete m_workers[i]->finder;
+        delete m_workers[i];
+    }
+}
+
+//------------------------------------------------------------------------------
+void PathQueryService::setSearchLimit(s32 lim)
+{
+    for (u32 i = 0; i < m_workers.size(); ++i)
+        m_workers[i]->finder->setSearchLimit(lim);
+}
+
+//------------------------------------------------------------------------------
+void PathQueryService::setDiagonals(bool enable)
+{
+    for (u32 i = 0; i < m_workers.size(); ++i)
+        m_workers[i]->finder->setDiagonals(enable);
+}
+
+//------------------------------------------------------------------------------
+void PathQueryService::setHeavyDiagonals(bool enable)
+{
+    for (u32 i = 0; i < m_workers.size(); ++i)
+        m_workers[i]->finder->setHeavyDiagonals(enable);
+}
+
+//------------------------------------------------------------------------------
+void PathQueryService::setAvoidDiagonalCross(bool enable)
+{
+    for (u32 i = 0; i < m_workers.size(); ++i)
+        m_workers[i]->finder->setAvoidDiagonalCross(enable);
+}
+
+//------------------------------------------------------------------------------
+void PathQueryService::setJumpPointSearch(bool enable)
+{
+    for (u32 i = 0; i < m_workers.size(); ++i)
+        m_workers[i]->finder->setJumpPointSearch(enable);
+}
+
+//------------------------------------------------------------------------------
+PathQueryService::QueryID PathQueryService::request(s32 startX, s32 startY, s32 endX, s32 endY)
+{
+    QueryID id;
+    if (m_freeQueries.empty())
+    {
+        m_queries.push_back(Query());
+        id = m_queries.size();
+    }
+    else
+    {
+        id = m_freeQueries.back();
+        m_freeQueries.pop_back();
+    }
+
+    Query & q = getQuery(id);
+    q.request = Request(startX, startY, endX, endY);
+    q.status = QUERY_PENDING;
+    q.path.clear();
+
+    m_pending.push_back(id);
+    return id;
+}
+
+//------------------------------------------------------------------------------
+void PathQueryService::request(const Request * requests, u32 count, QueryID * out_ids)
+{
+    for (u32 i = 0; i < count; ++i)
+    {
+        const Request & r = requests[i];
+        out_ids[i] = request(r.startX, r.startY, r.endX, r.endY);
+    }
+}
+
+//------------------------------------------------------------------------------
+PathQueryService::QueryStatus PathQueryService::getStatus(QueryID id) const
+{
+    return isValid(id) ? getQuery(id).status : QUERY_NONE;
+}
+
+//------------------------------------------------------------------------------
+bool PathQueryService::getPath(QueryID id, std::vector<Vector2i> & out_path) const
+{
+    out_path.clear();
+    if (getStatus(id) != QUERY_FOUND)
+        return false;
+    out_path = getQuery(id).path;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void PathQueryService::release(QueryID id)
+{
+    if (!isValid(id))
+        return;
+
+    Query & q = getQuery(id);
+    if (q.status == QUERY_PENDING)
+    {
+        m_pending.erase(std::find(m_pending.begin(), m_pending.end(), id));
+    }
+    else if (q.status == QUERY_IN_PROGRESS)
+    {
+        for (u32 i = 0; i < m_workers.size(); ++i)
+        {
+            if (m_workers[i]->currentQuery == id)
+                m_workers[i]->currentQuery = INVALID_QUERY;
+        }
+    }
+
+    q.status = QUERY_NONE;
+    q.path.clear();
+    m_freeQueries.push_back(id);
+}
+
+//------------------------------------------------------------------------------
+void PathQueryService::restartSearches()
+{
+    for (u32 i = 0; i < m_workers.size(); ++i)
+    {
+        Worker & worker = *m_workers[i];
+        if (worker.currentQuery != INVALID_QUERY)
+        {
+            getQuery(worker.currentQuery).status = QUERY_PENDING;
+            m_pending.push_front(worker.currentQuery);
+            worker.currentQuery = INVALID_QUERY;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+u32 PathQueryService::getPendingCount() const
+{
+    u32 count = m_pending.size();
+    for (u32 i = 0; i < m_workers.size(); ++i)
+    {
+        if (m_workers[i]->currentQuery != INVALID_QUERY)
+            ++count;
+    }
+    return count;
+}
+
+//------------------------------------------------------------------------------
+// Turns pending queries into tasks, in the order they were requested.
+// Queries sharing a goal with enough others are grouped in a single flow field task.
+void PathQueryService::buildTasks()
+{
+    m_taskCount = 0;
+
+    std::unordered_map<u64, u32> goalCounts;
+    std::unordered_map<u64, u32> flowTasks;
+
+    if (m_flowFieldThreshold > 0)
+    {
+        for (auto it = m_pending.begin(); it != m_pending.end(); ++it)
+        {
+            const Request & r = getQuery(*it).request;
+            ++goalCounts[(static_cast<u64>(static_cast<u32>(r.endX)) << 32) | static_cast<u32>(r.endY)];
+        }
+    }
+
+    for (auto it = m_pending.begin(); it != m_pending.end(); ++it)
+    {
+        const Request & r = getQuery(*it).request;
+        u64 goalKey = (static_cast<u64>(static_cast<u32>(r.endX)) << 32) | static_cast<u32>(r.endY);
+
+        bool useFlowField = m_flowFieldThreshold > 0 && goalCounts[goalKey] >= m_flowFieldThreshold;
+        if (useFlowField)
+        {
+            auto flowIt = flowTasks.find(goalKey);
+            if (flowIt != flowTasks.end())
+            {
+                m_tasks[flowIt->second].flowQueries.push_back(*it);
+                continue;
+            }
+            flowTasks[goalKey] = m_taskCount;
+        }
+
+        // Task objects are reused to keep their allocated memory
+        if (m_taskCount == m_tasks.size())
+            m_tasks.push_back(Task());
+        Task & task = m_tasks[m_taskCount++];
+        task.flowQueries.clear();
+        if (useFlowField)
+        {
+            task.query = INVALID_QUERY;
+            task.flowQueries.push_back(*it);
+        }
+        else
+        {
+            task.query = *it;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void PathQueryService::update(Time budget)
+{
+    buildTasks();
+
+    bool hasWork = m_taskCount > 0;
+    for (u32 i = 0; i < m_workers.size() && !hasWork; ++i)
+        hasWork = m_workers[i]->currentQuery != INVALID_QUERY;
+    if (!hasWork)
+        return;
+
+    m_nextTask = 0;
+    Time endTime = Time::getCurrent() + budget;
+
+    std::vector<Thread*> threads;
+    for (u32 i = 1; i < m_workers.size(); ++i)
+    {
+        Worker * worker = m_workers[i];
+        Thread * thread = new Thread([this, worker, endTime](){
+            runWorker(*worker, endTime);
+        });
+        thread->start();
+        threads.push_back(thread);
+    }
+
+    // The calling thread does its share too
+    runWorker(*m_workers[0], endTime);
+
+    for (auto it = threads.begin(); it != threads.end(); ++it)
+    {
+        (*it)->wait();
+        delete *it;
+    }
+
+    // Queries taken by workers leave the queue, the others wait for the next update
+    m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(), [this](QueryID id) {
+        return getQuery(id).status != QUERY_PENDING;
+    }), m_pending.end());
+}
+
+//------------------------------------------------------------------------------
+void PathQueryService::runWorker(Worker & worker, Time endTime)
+{
+    if (worker.currentQuery != INVALID_QUERY)
+    {
+        if (!runSearch(worker, worker.currentQuery, endTime))
+            return;
+        worker.currentQuery = INVALID_QUERY;
+    }
+
+    while (Time::getCurrent() < endTime)
+    {
+        u32 taskIndex = m_nextTask.fetch_add(1);
+        if (taskIndex >= m_taskCount)
+            return;
+
+        const Task & task = m_tasks[taskIndex];
+        if (task.query != INVALID_QUERY)
+        {
+            Query & q = getQuery(task.query);
+            q.status = QUERY_IN_PROGRESS;
+            worker.finder->startSearch(q.request.startX, q.request.startY, q.request.endX, q.request.endY);
+            if (!runSearch(worker, task.query, endTime))
+            {
+                worker.currentQuery = task.query;
+                return;
+            }
+        }
+        else
+        {
+            runFlowField(worker, task);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+bool PathQueryService::runSearch(Worker & worker, QueryID id, Time endTime)
+{
+    PathFinder & finder = *worker.finder;
+
+    // Nodes are evaluated by slices, so the clock is not read too often
+    while (finder.resumeSearch(m_sliceSize) == PathFinder::SEARCH_IN_PROGRESS)
+    {
+        if (Time::getCurrent() >= endTime)
+            return false;
+    }
+
+    Query & q = getQuery(id);
+    q.status = finder.getPath(q.path) ? QUERY_FOUND : QUERY_NOT_FOUND;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Note: flow fields are computed in one go, they are not suspended when the budget runs out.
+void PathQueryService::runFlowField(Worker & worker, const Task & task)
+{
+    SN_ASSERT(!task.flowQueries.empty(), "Flow field task has no queries");
+
+    for (u32 i = 0; i < task.flowQueries.size(); ++i)
+        getQuery(task.flowQueries[i]).status = QUERY_IN_PROGRESS;
+
+    const Request & first = getQuery(task.flowQueries[0]).request;
+    worker.flowField.compute(*worker.finder, first.endX, first.endY);
+
+    for (u32 i = 0; i < task.flowQueries.size(); ++i)
+    {
+        Query & q = getQuery(task.flowQueries[i]);
+        bool found = worker.flowField.getPath(q.request.startX, q.request.startY, q.path);
+        q.status = found ? QUERY_FOUND : QUERY_NOT_FOUND;
+    }
+}
+
+} // namespace sn
+
@@ -0,0 +1,155 @@
+/*
+PathQueryService.h
+Copyright (C) 2015-2015 Marc GILLERON
+This file is part of the SnowfeetEngine project.
+*/
+
+#ifndef __HEADER_SN_PATHQUERYSERVICE__
+#define __HEADER_SN_PATHQUERYSERVICE__
+
+#include <core/util/FlowField.h>
+#include <core/util/NonCopyable.h>
+#include <core/system/Time.h>
+#include <deque>
+#include <atomic>
+
+namespace sn
+{
+
+/// \brief Solves batches of path queries on a grid, from several threads.
+/// Each worker thread has its own PathFinder, so searches don't share scratch data.
+/// Queries are processed within a time budget given each frame: searches that
+/// don't fit are suspended and resumed at the next update().
+/// When many queued queries have the same goal, they are all solved with a single FlowField.
+/// \note The grid must not change during update(). If it changes between updates
+/// while searches are suspended, call restartSearches().
+class SN_API PathQueryService : public NonCopyable
+{
+public:
+    /// \brief Identifies a query. IDs are reused after release().
+    typedef u32 QueryID;
+    static const QueryID INVALID_QUERY = 0;
+
+    enum QueryStatus
+    {
+        QUERY_NONE = 0, // Unknown ID
+        QUERY_PENDING,
+        QUERY_IN_PROGRESS,
+        QUERY_FOUND,
+        QUERY_NOT_FOUND
+    };
+
+    struct Request
+    {
+        s32 startX;
+        s32 startY;
+        s32 endX;
+        s32 endY;
+
+        Request(s32 sx = 0, s32 sy = 0, s32 ex = 0, s32 ey = 0):
+            startX(sx), startY(sy), endX(ex), endY(ey)
+        {}
+    };
+
+    /// \param threadCount: number of threads used during update(), including the calling one.
+    PathQueryService(s8 * grid, u16 gridSizeX, u16 gridSizeY, u32 threadCount = 1);
+    ~PathQueryService();
+
+    // Movement options, see PathFinder
+    void setSearchLimit(s32 lim);
+    void setDiagonals(bool enable);
+    void setHeavyDiagonals(bool enable);
+    void setAvoidDiagonalCross(bool enable);
+    void setJumpPointSearch(bool enable);
+
+    /// \brief Sets how many nodes a search evaluates between two checks of the time budget.
+    inline void setSliceSize(u32 nodes) { m_sliceSize = nodes > 0 ? nodes : 1; }
+
+    /// \brief Sets how many pending queries must share the same goal before they are
+    /// solved with a flow field instead of separate searches. 0 disables flow fields.
+    inline void setFlowFieldThreshold(u32 count) { m_flowFieldThreshold = count; }
+
+    /// \brief Queues a query. It will be processed by the next calls to update().
+    QueryID request(s32 startX, s32 startY, s32 endX, s32 endY);
+
+    /// \brief Queues several queries at once.
+    /// \param out_ids: receives the ID of each query, must have room for count elements.
+    void request(const Request * requests, u32 count, QueryID * out_ids);
+
+    /// \brief Processes queries from worker threads for about the given duration.
+    /// Blocks until all workers stopped.
+    void update(Time budget);
+
+    QueryStatus getStatus(QueryID id) const;
+
+    /// \brief Gets the path of a finished query.
+    /// \param out_path: receives cells from the start to the end, both included. Cleared first.
+    /// \return true if a path was found.
+    bool getPath(QueryID id, std::vector<Vector2i> & out_path) const;
+
+    /// \brief Forgets a query, whatever its status. Its ID becomes invalid.
+    void release(QueryID id);
+
+    /// \brief Puts suspended searches back in the queue, so they start over.
+    /// Call it after the grid changed.
+    void restartSearches();
+
+    /// \brief Gets how many queries are waiting to be processed or are suspended.
+    u32 getPendingCount() const;
+
+    inline u32 getThreadCount() const { return m_workers.size(); }
+
+private:
+    struct Query
+    {
+        Request request;
+        QueryStatus status;
+        std::vector<Vector2i> path;
+    };
+
+    struct Task
+    {
+        // Query to solve with a search, or INVALID_QUERY if the task is a flow field
+        QueryID query;
+        // Queries solved by a flow field
+        std::vector<QueryID> flowQueries;
+    };
+
+    struct Worker
+    {
+        PathFinder * finder;
+        FlowField flowField;
+        // Query whose search was suspended, resumed first at the next update
+        QueryID currentQuery;
+    };
+
+    inline Query & getQuery(QueryID id) { return m_queries[id - 1]; }
+    inline const Query & getQuery(QueryID id) const { return m_queries[id - 1]; }
+    inline bool isValid(QueryID id) const { return id != INVALID_QUERY && id <= m_queries.size() && m_queries[id - 1].status != QUERY_NONE; }
+
+    void buildTasks();
+    void runWorker(Worker & worker, Time endTime);
+    /// \return true if the search finished, false if it was suspended
+    bool runSearch(Worker & worker, QueryID id, Time endTime);
+    void runFlowField(Worker & worker, const Task & task);
+
+private:
+    std::vector<Worker*> m_workers;
+    std::vector<Query> m_queries;
+    std::vector<QueryID> m_freeQueries;
+    std::deque<QueryID> m_pending;
+
+    u32 m_sliceSize;
+    u32 m_flowFieldThreshold;
+
+    // Tasks of the current update
+    std::vector<Task> m_tasks;
+    u32 m_taskCount;
+    std::atomic<u32> m_nextTask;
+
+};
+
+} // namespace sn
+
+#endif // __HEADER_SN_PATHQUERYSERVICE__
+
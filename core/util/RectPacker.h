@@ -0,0 +1,91 @@
+#ifndef __HEADER_SN_RECTPACKER__
+#define __HEADER_SN_RECTPACKER__
+
+#include <core/math/Rect.h>
+
+namespace sn
+{
+
+/// \brief Common interface of algorithms placing rectangles into a rectangular container,
+/// such as glyph atlases or sprite sheets.
+/// Rectangles are inserted one by one, and keep their position until they are removed.
+class RectPacker
+{
+public:
+    RectPacker(u32 width, u32 height) :
+        m_width(width),
+        m_height(height),
+        m_usedArea(0),
+        m_rectCount(0)
+    {}
+
+    virtual ~RectPacker() {}
+
+    /// \brief Finds room for a new rectangle.
+    /// \param out_rect: receives the position and size of the rectangle
+    /// \return false if it doesn't fit in the container
+    virtual bool insert(u32 width, u32 height, IntRect * out_rect) = 0;
+
+    /// \brief Frees the room taken by a rectangle returned by insert().
+    /// Depending on the algorithm, the room might only be reusable by smaller rectangles.
+    /// \return false if the rectangle was not found
+    virtual bool remove(const IntRect & rect) = 0;
+
+    /// \brief Removes all rectangles
+    virtual void clear() = 0;
+
+    /// \brief Enlarges the container. Rectangles keep their position.
+    virtual void grow(u32 width, u32 height) = 0;
+
+    u32 getWidth() const { return m_width; }
+    u32 getHeight() const { return m_height; }
+
+    u32 getRectCount() const { return m_rectCount; }
+
+    /// \brief Gets the sum of the areas of inserted rectangles
+    u64 getUsedArea() const { return m_usedArea; }
+
+    /// \brief Gets the ratio of the container covered by rectangles, between 0 and 1
+    f32 getOccupancy() const
+    {
+        u64 area = static_cast<u64>(m_width) * m_height;
+        return area > 0 ? static_cast<f32>(static_cast<f64>(m_usedArea) / static_cast<f64>(area)) : 0.f;
+    }
+
+protected:
+    static bool isSameRect(const IntRect & a, const IntRect & b)
+    {
+        return a.origin() == b.origin() && a.size() == b.size();
+    }
+
+    void onInserted(const IntRect & rect)
+    {
+        m_usedArea += static_cast<u64>(rect.width()) * rect.height();
+        ++m_rectCount;
+    }
+
+    void onRemoved(const IntRect & rect)
+    {
+        m_usedArea -= static_cast<u64>(rect.width()) * rect.height();
+        --m_rectCount;
+    }
+
+    void onCleared()
+    {
+        m_usedArea = 0;
+        m_rectCount = 0;
+    }
+
+protected:
+    u32 m_width;
+    u32 m_height;
+
+private:
+    u64 m_usedArea;
+    u32 m_rectCount;
+};
+
+} // namespace sn
+
+#endif // __HEADER_SN_RECTPACKER__
+
@@ -1,8 +1,10 @@
 #ifndef __HEADER_SN_SHELFPACKER__
 #define __HEADER_SN_SHELFPACKER__
 
-#include <core/math/Rect.h>
+#include <core/util/RectPacker.h>
+#include <core/util/assert.h>
 #include <vector>
+#include <algorithm>
 
 namespace sn
 {
@@ -10,8 +12,10 @@ namespace sn
 /// \brief Packs rectangles into a rectangular container.
 /// Nodes are stored in rows like on a bookshelf.
 /// Possible uses are font glyphes or sprite packing on textures.
+/// It is the fastest packer, but wastes space above nodes smaller than their row.
+/// See SkylinePacker and MaxRectsPacker for denser packings.
 template <typename T>
-class ShelfPacker
+class ShelfPacker : public RectPacker
 {
 public:
     //--------------------------------------------------------------------------
@@ -49,14 +53,13 @@ public:
     //--------------------------------------------------------------------------
     /// \brief Constructs a packer with an initial rectangular container size
     ShelfPacker(u32 initialWidth, u32 initialHeight) :
-        m_width(initialWidth),
-        m_height(initialHeight)
+        RectPacker(initialWidth, initialHeight)
     {}
 
     //--------------------------------------------------------------------------
     /// \brief Tries to dynamically insert a new rectangle into the container.
     /// \param n: node to insert
-    /// \return false if it doesn't fits given the current layout. 
+    /// \return false if it doesn't fits given the current layout.
     /// \note Subsequent calls to this method can lead to an unoptimized packing.
     /// Calling repack() can optimize space if nodes can't be inserted anymore.
     bool insert(Node n, IntRect * out_rect = nullptr)
@@ -80,6 +83,7 @@ public:
             n.rect.y() = row->y;
             row->width += n.rect.width();
             m_nodes.push_back(n);
+            onInserted(n.rect);
 
             if (out_rect)
             {
@@ -90,97 +94,100 @@ public:
         return row != nullptr;
     }
 
+    //--------------------------------------------------------------------------
+    bool insert(u32 width, u32 height, IntRect * out_rect) override
+    {
+        return insert(Node(T(), width, height), out_rect);
+    }
+
+    //--------------------------------------------------------------------------
+    /// \brief Removes a node. Its room can be reused only if no node follows it in its row.
+    bool remove(const IntRect & rect) override
+    {
+        for (auto it = m_nodes.begin(); it != m_nodes.end(); ++it)
+        {
+            if (isSameRect(it->rect, rect))
+            {
+                m_nodes.erase(it);
+                onRemoved(rect);
+                shrinkRow(rect.y());
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //--------------------------------------------------------------------------
+    /// \brief Enlarges the rectangular container. Nodes keep their position.
+    void grow(u32 width, u32 height) override
+    {
+        SN_ASSERT(width >= m_width && height >= m_height, "Cannot shrink the container without repacking");
+        m_width = width;
+        m_height = height;
+    }
+
+    //--------------------------------------------------------------------------
+    /// \brief Removes all nodes
+    void clear() override
+    {
+        m_rows.clear();
+        m_nodes.clear();
+        onCleared();
+    }
+
+    const std::vector<Node> & getNodes() const { return m_nodes; }
+
     //--------------------------------------------------------------------------
     /// \brief Resizes the rectangular container and recalculates packing for a better fit.
-    void repack(u32 width, u32 height)
+    bool repack(u32 width, u32 height)
     {
+        u32 lastWidth = m_width;
+        u32 lastHeight = m_height;
         m_width = width;
         m_height = height;
-        repack();
+        if (repack())
+            return true;
+        m_width = lastWidth;
+        m_height = lastHeight;
+        return false;
     }
 
     //--------------------------------------------------------------------------
     /// \brief Recalculates current packing for a better fit.
-    /// This method takes advantage of the fact that nodes are already known, 
+    /// This method takes advantage of the fact that nodes are already known,
     /// so they can be sorted the right way to form optimized rows.
-    /// \return false if nodes don't fit
+    /// Nodes can move, their new positions are given by getNodes().
+    /// \return false if nodes don't fit, in which case the packing is left unchanged
     bool repack()
     {
-        std::vector<Row> rows;
-        std::vector< Node<T> > nodes = m_nodes;
-
-        // Sort nodes by height (we can do this on the member directly, it doesn't matters)
-        std::sort(nodes.begin(), nodes.end(), compareNodesHeight);
-
-        u32 remainingHeight = m_height;
-
-        Row row;
-        row.width = m_width;
-
-        // Create rows with increasing heights.
-        for (auto it = nodes.begin(); it != nodes.end(); ++it)
+        std::vector<Row> lastRows;
+        std::vector<Node> nodes;
+        lastRows.swap(m_rows);
+        nodes.swap(m_nodes);
+        onCleared();
+
+        // Rows are filled best from the tallest to the smallest node
+        std::vector<u32> order(nodes.size());
+        for (u32 i = 0; i < order.size(); ++i)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&nodes](u32 a, u32 b) {
+            return nodes[a].rect.height() > nodes[b].rect.height();
+        });
+
+        for (u32 i = 0; i < order.size(); ++i)
         {
-            Node<T> & n = *it;
-
-            // If the node doesn't fits horizontally in the row
-            if (n.rect.width() > m_width - row.width)
-            {
-                // If the row contains nodes
-                if (!row.nodes.empty())
-                {
-                    // commit the row to start a new one
-
-                    rows.push_back(row);
-
-                    row.y += row.height;
-                    row.width = 0;
-                    row.height = 0;
-                }
-            }
-
-            // If the node fits horizontally in the row
-            if (n.rect.width() <= m_width - row.width)
-            {
-                // If the node doesn't fits vertically
-                if (row.height < n.rect.height())
-                {
-                    // If there is enough space for the row to be resized
-                    if (remainingHeight >= n.rect.height())
-                    {
-                        // Increase the height of the row
-                        u32 delta = n.height() - row.height;
-                        remainingHeight += delta;
-                        row.height = delta;
-                    }
-                    else
-                    {
-                        // Cannot store the node, cancel packing
-                        return false;
-                    }
-                }
-
-                // Append node to the row
-                n.rect.x() = row.width;
-                n.rect.y() = row.y;
-                row.width += n.rect.width();
-            }
-            else
+            if (!insert(nodes[order[i]]))
             {
-                // The node can't fit, cancel packing
+                // Cancel packing
+                m_rows.swap(lastRows);
+                m_nodes.swap(nodes);
+                onCleared();
+                for (u32 j = 0; j < m_nodes.size(); ++j)
+                    onInserted(m_nodes[j].rect);
                 return false;
             }
         }
 
-        // Commit the last row
-        if (!row.width != 0)
-        {
-            m_rows.push_back(row);
-        }
-
-        // Commit final result
-        m_rows = rows;
-        m_nodes = nodes;
-
         return true;
     }
 
@@ -216,15 +223,30 @@ private:
     }
 
     //--------------------------------------------------------------------------
-    static bool compareNodesHeight(const Node & a, const Node & b)
+    /// \brief Gives back the room after the last node of a row, and removes empty rows at the end
+    void shrinkRow(s32 y)
     {
-        return a.rect.height() < b.rect.height();
+        for (auto it = m_rows.begin(); it != m_rows.end(); ++it)
+        {
+            Row & r = *it;
+            if (static_cast<s32>(r.y) != y)
+                continue;
+            r.width = 0;
+            for (auto nodeIt = m_nodes.begin(); nodeIt != m_nodes.end(); ++nodeIt)
+            {
+                const IntRect & nodeRect = nodeIt->rect;
+                if (nodeRect.y() == y)
+                    r.width = std::max(r.width, static_cast<unsigned int>(nodeRect.x() + nodeRect.width()));
+            }
+            break;
+        }
+
+        while (!m_rows.empty() && m_rows.back().width == 0)
+            m_rows.pop_back();
     }
 
 private:
     //--------------------------------------------------------------------------
-    unsigned int m_width;
-    unsigned int m_height;
     std::vector<Row> m_rows;
     std::vector<Node> m_nodes;
 };
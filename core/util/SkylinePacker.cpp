@@ -0,0 +1,259 @@
+#include "SkylinePacker.h"
+#include "assert.h"
+#include <algorithm>
+
+namespace sn
+{
+
+//------------------------------------------------------------------------------
+SkylinePacker::SkylinePacker(u32 width, u32 height) : RectPacker(width, height)
+{
+    clear();
+}
+
+//------------------------------------------------------------------------------
+bool SkylinePacker::insert(u32 width, u32 height, IntRect * out_rect)
+{
+    if (width == 0 || height == 0)
+        return false;
+
+    const s32 w = static_cast<s32>(width);
+    const s32 h = static_cast<s32>(height);
+
+    IntRect rect;
+    if (!insertInFreeRect(w, h, rect))
+    {
+        // Lowest top, then leftmost position
+        u32 bestIndex = 0;
+        s32 bestY = 0;
+        s32 bestTop = -1;
+        for (u32 i = 0; i < m_skyline.size(); ++i)
+        {
+            s32 y;
+            if (fit(i, w, h, y) && (bestTop < 0 || y + h < bestTop))
+            {
+                bestIndex = i;
+                bestY = y;
+                bestTop = y + h;
+            }
+        }
+        if (bestTop < 0)
+            return false;
+
+        rect = IntRect(m_skyline[bestIndex].x, bestY, w, h);
+        place(bestIndex, rect);
+    }
+
+    m_usedRects.push_back(rect);
+    onInserted(rect);
+    if (out_rect)
+        *out_rect = rect;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool SkylinePacker::remove(const IntRect & rect)
+{
+    auto it = m_usedRects.begin();
+    for (; it != m_usedRects.end(); ++it)
+    {
+        if (isSameRect(*it, rect))
+            break;
+    }
+    if (it == m_usedRects.end())
+        return false;
+    *it = m_usedRects.back();
+    m_usedRects.pop_back();
+    onRemoved(rect);
+
+    // The skyline can go back down only if the rectangle forms it over its whole width
+    const s32 right = rect.x() + rect.width();
+    const s32 top = rect.y() + rect.height();
+    bool onSkyline = true;
+    for (u32 i = 0; i < m_skyline.size() && onSkyline; ++i)
+    {
+        const Segment & s = m_skyline[i];
+        if (s.x < right && s.x + s.width > rect.x() && s.y != top)
+            onSkyline = false;
+    }
+
+    if (!onSkyline)
+    {
+        m_freeRects.push_back(rect);
+        return true;
+    }
+
+    // Cut segments at the edges of the rectangle, and lower those in between
+    std::vector<Segment> skyline;
+    skyline.reserve(m_skyline.size() + 2);
+    for (u32 i = 0; i < m_skyline.size(); ++i)
+    {
+        const Segment & s = m_skyline[i];
+        s32 endX = s.x + s.width;
+        if (endX <= rect.x() || s.x >= right)
+        {
+            skyline.push_back(s);
+            continue;
+        }
+        if (s.x < rect.x())
+            skyline.push_back(Segment(s.x, s.y, rect.x() - s.x));
+        s32 beginX = std::max(s.x, rect.x());
+        skyline.push_back(Segment(beginX, rect.y(), std::min(endX, right) - beginX));
+        if (endX > right)
+            skyline.push_back(Segment(right, s.y, endX - right));
+    }
+    m_skyline.swap(skyline);
+    mergeSegments();
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void SkylinePacker::clear()
+{
+    m_skyline.clear();
+    m_skyline.push_back(Segment(0, 0, m_width));
+    m_freeRects.clear();
+    m_usedRects.clear();
+    onCleared();
+}
+
+//------------------------------------------------------------------------------
+void SkylinePacker::grow(u32 width, u32 height)
+{
+    SN_ASSERT(width >= m_width && height >= m_height, "Cannot shrink the container");
+    if (width > m_width)
+    {
+        m_skyline.push_back(Segment(m_width, 0, width - m_width));
+        mergeSegments();
+    }
+    m_width = width;
+    m_height = height;
+}
+
+//------------------------------------------------------------------------------
+bool SkylinePacker::fit(u32 segmentIndex, s32 width, s32 height, s32 & out_y) const
+{
+    const Segment & first = m_skyline[segmentIndex];
+    if (first.x + width > static_cast<s32>(m_width))
+        return false;
+
+    // The rectangle rests on the highest segment below it
+    s32 y = first.y;
+    s32 remaining = width;
+    for (u32 i = segmentIndex; remaining > 0; ++i)
+    {
+        SN_ASSERT(i < m_skyline.size(), "Skyline doesn't cover the whole width");
+        y = std::max(y, m_skyline[i].y);
+        if (y + height > static_cast<s32>(m_height))
+            return false;
+        remaining -= m_skyline[i].width;
+    }
+
+    out_y = y;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void SkylinePacker::place(u32 segmentIndex, const IntRect & rect)
+{
+    const s32 right = rect.x() + rect.width();
+
+    // Gaps between the skyline and the rectangle can still be used
+    for (u32 i = segmentIndex; i < m_skyline.size() && m_skyline[i].x < right; ++i)
+    {
+        const Segment & s = m_skyline[i];
+        if (s.y < rect.y())
+            m_freeRects.push_back(IntRect(s.x, s.y, std::min(s.x + s.width, right) - s.x, rect.y() - s.y));
+    }
+
+    m_skyline.insert(m_skyline.begin() + segmentIndex, Segment(rect.x(), rect.y() + rect.height(), rect.width()));
+
+    // Cut segments covered by the rectangle
+    u32 i = segmentIndex + 1;
+    while (i < m_skyline.size() && m_skyline[i].x < right)
+    {
+        Segment & s = m_skyline[i];
+        s32 endX = s.x + s.width;
+        if (endX <= right)
+        {
+            m_skyline.erase(m_skyline.begin() + i);
+        }
+        else
+        {
+            s.x = right;
+            s.width = endX - right;
+            break;
+        }
+    }
+
+    mergeSegments();
+}
+
+//------------------------------------------------------------------------------
+bool SkylinePacker::insertInFreeRect(s32 width, s32 height, IntRect & out_rect)
+{
+    // Best area fit
+    s32 bestIndex = -1;
+    s32 bestWaste = 0;
+    for (u32 i = 0; i < m_freeRects.size(); ++i)
+    {
+        const IntRect & r = m_freeRects[i];
+        if (r.width() < width || r.height() < height)
+            continue;
+        s32 waste = r.width() * r.height() - width * height;
+        if (bestIndex < 0 || waste < bestWaste)
+        {
+            bestIndex = i;
+            bestWaste = waste;
+        }
+    }
+    if (bestIndex < 0)
+        return false;
+
+    IntRect freeRect = m_freeRects[bestIndex];
+    m_freeRects[bestIndex] = m_freeRects.back();
+    m_freeRects.pop_back();
+
+    out_rect = IntRect(freeRect.x(), freeRect.y(), width, height);
+
+    // Split the rest along the shorter leftover side, which keeps the larger part in one piece
+    s32 leftoverX = freeRect.width() - width;
+    s32 leftoverY = freeRect.height() - height;
+    IntRect right, bottom;
+    if (leftoverX <= leftoverY)
+    {
+        right = IntRect(freeRect.x() + width, freeRect.y(), leftoverX, height);
+        bottom = IntRect(freeRect.x(), freeRect.y() + height, freeRect.width(), leftoverY);
+    }
+    else
+    {
+        right = IntRect(freeRect.x() + width, freeRect.y(), leftoverX, freeRect.height());
+        bottom = IntRect(freeRect.x(), freeRect.y() + height, width, leftoverY);
+    }
+    if (right.width() > 0 && right.height() > 0)
+        m_freeRects.push_back(right);
+    if (bottom.width() > 0 && bottom.height() > 0)
+        m_freeRects.push_back(bottom);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void SkylinePacker::mergeSegments()
+{
+    if (m_skyline.empty())
+        return;
+    u32 j = 0;
+    for (u32 i = 1; i < m_skyline.size(); ++i)
+    {
+        if (m_skyline[i].y == m_skyline[j].y)
+            m_skyline[j].width += m_skyline[i].width;
+        else
+            m_skyline[++j] = m_skyline[i];
+    }
+    m_skyline.erase(m_skyline.begin() + j + 1, m_skyline.end());
+}
+
+} // namespace sn
+
@@ -0,0 +1,60 @@
+#ifndef __HEADER_SN_SKYLINEPACKER__
+#define __HEADER_SN_SKYLINEPACKER__
+
+#include <core/util/RectPacker.h>
+#include <vector>
+
+namespace sn
+{
+
+/// \brief Packs rectangles by placing them as low as possible over the skyline
+/// formed by the top of the rectangles already inserted (bottom-left heuristic).
+/// Gaps left under rectangles are remembered and reused by smaller ones.
+/// It packs denser than ShelfPacker on mixed heights, for a similar insertion time.
+class SN_API SkylinePacker : public RectPacker
+{
+public:
+    SkylinePacker(u32 width, u32 height);
+
+    bool insert(u32 width, u32 height, IntRect * out_rect) override;
+
+    /// \brief Removes a rectangle. If nothing was put above it, the skyline goes back down,
+    /// otherwise its room can be reused by rectangles fitting in it.
+    bool remove(const IntRect & rect) override;
+
+    void clear() override;
+    void grow(u32 width, u32 height) override;
+
+private:
+    /// \brief Horizontal part of the skyline
+    struct Segment
+    {
+        s32 x;
+        s32 y;
+        s32 width;
+
+        Segment(s32 a_x, s32 a_y, s32 a_width) : x(a_x), y(a_y), width(a_width) {}
+    };
+
+    /// \brief Gets at which height a rectangle would be placed from the start of a segment.
+    /// \return false if it doesn't fit
+    bool fit(u32 segmentIndex, s32 width, s32 height, s32 & out_y) const;
+
+    void place(u32 segmentIndex, const IntRect & rect);
+    bool insertInFreeRect(s32 width, s32 height, IntRect & out_rect);
+    void mergeSegments();
+
+private:
+    /// \brief Segments sorted from left to right, covering the whole width
+    std::vector<Segment> m_skyline;
+
+    /// \brief Free areas under the skyline
+    std::vector<IntRect> m_freeRects;
+
+    std::vector<IntRect> m_usedRects;
+};
+
+} // namespace sn
+
+#endif // __HEADER_SN_SKYLINEPACKER__
+
@@ -9,11 +9,30 @@ This file is part of the SnowfeetEngine project.
 namespace sn
 {
 
+static_assert(sizeof(Variant::String) <= Variant::STORAGE_SIZE, "Variant storage is too small for strings");
+static_assert(sizeof(Variant::Array) <= Variant::STORAGE_SIZE, "Variant storage is too small for arrays");
+static_assert(sizeof(Variant::Dictionary) <= Variant::STORAGE_SIZE, "Variant storage is too small for dictionaries");
+
 //-----------------------------------------------------------------------------
 Variant::Variant(const Variant & other):
+    m_type(other.m_type)
+{
+    switch (m_type.id)
+    {
+    // Objects need proper handling
+    case SN_VT_STRING:      new (m_data.vStorage) String(*other.stringPtr()); break;
+    case SN_VT_ARRAY:       new (m_data.vStorage) Array(*other.arrayPtr()); break;
+    case SN_VT_DICTIONARY:  new (m_data.vStorage) Dictionary(*other.dictionaryPtr()); break;
+    // Null and scalar types just need copy
+    default: m_data = other.m_data; break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+Variant::Variant(Variant && other) SN_NOEXCEPT:
     m_type(SN_VT_NIL)
 {
-    *this = other;
+    moveFrom(other);
 }
 
 //-----------------------------------------------------------------------------
@@ -22,18 +41,31 @@ Variant::~Variant()
     reset();
 }
 
+//-----------------------------------------------------------------------------
+void Variant::moveFrom(Variant & other)
+{
+    m_type = other.m_type;
+    switch (m_type.id)
+    {
+    case SN_VT_STRING:      new (m_data.vStorage) String(std::move(*other.stringPtr())); break;
+    case SN_VT_ARRAY:       new (m_data.vStorage) Array(std::move(*other.arrayPtr())); break;
+    case SN_VT_DICTIONARY:  new (m_data.vStorage) Dictionary(std::move(*other.dictionaryPtr())); break;
+    default: m_data = other.m_data; break;
+    }
+    other.reset();
+}
+
 //-----------------------------------------------------------------------------
 void Variant::reset()
 {
     switch (m_type.id)
     {
-    case SN_VT_STRING:      delete m_data.pString; break;
-    case SN_VT_ARRAY:       delete m_data.pArray; break;
-    case SN_VT_DICTIONARY:  delete m_data.pDictionary; break;
+    case SN_VT_STRING:      stringPtr()->~String(); break;
+    case SN_VT_ARRAY:       arrayPtr()->~Array(); break;
+    case SN_VT_DICTIONARY:  dictionaryPtr()->~Dictionary(); break;
     default: break;
     }
     m_type = SN_VT_NIL;
-    memset(&m_data, 0, sizeof(VariantData));
 }
 
 //-----------------------------------------------------------------------------
@@ -43,13 +75,12 @@ void Variant::reset(VariantType t)
     m_type = t;
     switch (m_type.id)
     {
-    case SN_VT_BOOL:
-    case SN_VT_INT:
-    case SN_VT_FLOAT:
-        memset(&m_data, 0, sizeof(VariantData));
-    case SN_VT_STRING:      m_data.pString = new String(); break;
-    case SN_VT_ARRAY:       m_data.pArray = new Array(); break;
-    case SN_VT_DICTIONARY:  m_data.pDictionary = new Dictionary(); break;
+    case SN_VT_BOOL:        m_data.vBool = false; break;
+    case SN_VT_INT:         m_data.vInt = 0; break;
+    case SN_VT_FLOAT:       m_data.vFloat = 0; break;
+    case SN_VT_STRING:      new (m_data.vStorage) String(); break;
+    case SN_VT_ARRAY:       new (m_data.vStorage) Array(); break;
+    case SN_VT_DICTIONARY:  new (m_data.vStorage) Dictionary(); break;
     default: break;
     }
 }
@@ -82,7 +113,7 @@ f32 Variant::getFloat() const
 const Variant::String & Variant::getString() const
 {
     if (m_type.id == SN_VT_STRING)
-        return *m_data.pString;
+        return *stringPtr();
     else
     {
         static String s_defaultString;
@@ -94,7 +125,7 @@ const Variant::String & Variant::getString() const
 const Variant::Array & Variant::getArray() const
 {
     if (m_type.id == SN_VT_ARRAY)
-        return *m_data.pArray;
+        return *arrayPtr();
     else
     {
         static Array s_defaultArray;
@@ -106,7 +137,7 @@ const Variant::Array & Variant::getArray() const
 const Variant::Dictionary & Variant::getDictionary() const
 {
     if (m_type.id == SN_VT_DICTIONARY)
-        return *m_data.pDictionary;
+        return *dictionaryPtr();
     else
     {
         static Dictionary s_defaultDictionary;
@@ -152,13 +183,31 @@ void Variant::setString(const String & str)
 {
     if (m_type != SN_VT_STRING)
     {
+        // Copy first, str might be owned by this variant
+        String temp(str);
+        reset();
+        m_type = SN_VT_STRING;
+        new (m_data.vStorage) String(std::move(temp));
+    }
+    else
+    {
+        *stringPtr() = str;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void Variant::setString(String && str)
+{
+    if (m_type != SN_VT_STRING)
+    {
+        String temp(std::move(str));
         reset();
         m_type = SN_VT_STRING;
-        m_data.pString = new String(str);
+        new (m_data.vStorage) String(std::move(temp));
     }
     else
     {
-        *m_data.pString = str;
+        *stringPtr() = std::move(str);
     }
 }
 
@@ -169,7 +218,7 @@ void Variant::setArray()
     {
         reset();
         m_type = SN_VT_ARRAY;
-        m_data.pArray = new Array();
+        new (m_data.vStorage) Array();
     }
 }
 
@@ -178,13 +227,30 @@ void Variant::setArray(const Array & va)
 {
     if (m_type != SN_VT_ARRAY)
     {
+        Array temp(va);
         reset();
         m_type = SN_VT_ARRAY;
-        m_data.pArray = new Array(va);
+        new (m_data.vStorage) Array(std::move(temp));
     }
     else
     {
-        *m_data.pArray = va;
+        *arrayPtr() = va;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void Variant::setArray(Array && va)
+{
+    if (m_type != SN_VT_ARRAY)
+    {
+        Array temp(std::move(va));
+        reset();
+        m_type = SN_VT_ARRAY;
+        new (m_data.vStorage) Array(std::move(temp));
+    }
+    else
+    {
+        *arrayPtr() = std::move(va);
     }
 }
 
@@ -195,7 +261,7 @@ void Variant::setDictionary()
     {
         reset();
         m_type = SN_VT_DICTIONARY;
-        m_data.pDictionary = new Dictionary();
+        new (m_data.vStorage) Dictionary();
     }
 }
 
@@ -204,41 +270,62 @@ void Variant::setDictionary(const Dictionary & vd)
 {
     if (m_type != SN_VT_DICTIONARY)
     {
+        Dictionary temp(vd);
         reset();
         m_type = SN_VT_DICTIONARY;
-        m_data.pDictionary = new Dictionary(vd);
+        new (m_data.vStorage) Dictionary(std::move(temp));
     }
     else
     {
-        *m_data.pDictionary = vd;
+        *dictionaryPtr() = vd;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void Variant::setDictionary(Dictionary && vd)
+{
+    if (m_type != SN_VT_DICTIONARY)
+    {
+        Dictionary temp(std::move(vd));
+        reset();
+        m_type = SN_VT_DICTIONARY;
+        new (m_data.vStorage) Dictionary(std::move(temp));
+    }
+    else
+    {
+        *dictionaryPtr() = std::move(vd);
     }
 }
 
 //-----------------------------------------------------------------------------
 void Variant::grab(Variant & other)
 {
-    reset();
-    m_type = other.m_type;
-    m_data = other.m_data;
-    other.m_type = SN_VT_NIL;
-    memset(&other.m_data, 0, sizeof(VariantData));
+    *this = std::move(other);
 }
 
 //-----------------------------------------------------------------------------
 Variant & Variant::operator=(const Variant & other)
 {
-    reset();
-    switch (other.m_type.id)
+    if (this != &other)
     {
-    // Objects need proper handling
-    case SN_VT_STRING:      setString(*other.m_data.pString); break;
-    case SN_VT_ARRAY:       setArray(*other.m_data.pArray); break;
-    case SN_VT_DICTIONARY:  setDictionary(*other.m_data.pDictionary); break;
-    // Null and scalar types just need copy
-    default:
-        m_type = other.m_type;
-        m_data = other.m_data;
-        break;
+        // Copy first, other might be owned by this variant
+        Variant temp(other);
+        reset();
+        moveFrom(temp);
+    }
+    return *this;
+}
+
+//-----------------------------------------------------------------------------
+Variant & Variant::operator=(Variant && other) SN_NOEXCEPT
+{
+    if (this != &other)
+    {
+        // Detach first, other might be owned by this variant
+        Variant temp;
+        temp.moveFrom(other);
+        reset();
+        moveFrom(temp);
     }
     return *this;
 }
@@ -256,9 +343,9 @@ bool Variant::operator==(const Variant & other) const
     case SN_VT_BOOL:        return m_data.vBool == other.m_data.vBool; break;
     case SN_VT_INT:         return m_data.vInt == other.m_data.vInt; break;
     case SN_VT_FLOAT:       return m_data.vFloat == other.m_data.vFloat; break;
-    case SN_VT_STRING:      return *m_data.pString == *other.m_data.pString; break;
-    case SN_VT_ARRAY:       return *m_data.pArray == *other.m_data.pArray; break;
-    case SN_VT_DICTIONARY:  return *m_data.pDictionary == *other.m_data.pDictionary; break;
+    case SN_VT_STRING:      return *stringPtr() == *other.stringPtr(); break;
+    case SN_VT_ARRAY:       return *arrayPtr() == *other.arrayPtr(); break;
+    case SN_VT_DICTIONARY:  return *dictionaryPtr() == *other.dictionaryPtr(); break;
     default: return false;
     }
 }
@@ -267,16 +354,17 @@ bool Variant::operator==(const Variant & other) const
 Variant & Variant::operator[](size_t index)
 {
     assertType(SN_VT_ARRAY);
-    if (m_data.pArray->size() <= index)
-        m_data.pArray->resize(index + 1);
-    return (*m_data.pArray)[index];
+    Array & a = *arrayPtr();
+    if (a.size() <= index)
+        a.resize(index + 1);
+    return a[index];
 }
 
 //-----------------------------------------------------------------------------
 const Variant & Variant::operator[](size_t index) const
 {
     if (m_type.id == SN_VT_ARRAY)
-        return (*m_data.pArray)[index];
+        return (*arrayPtr())[index];
     else
     {
         static Variant s_defaultVariant;
@@ -288,7 +376,7 @@ const Variant & Variant::operator[](size_t index) const
 Variant & Variant::operator[](const String & fieldName)
 {
     assertType(SN_VT_DICTIONARY);
-    return (*m_data.pDictionary)[fieldName];
+    return (*dictionaryPtr())[fieldName];
 }
 
 //-----------------------------------------------------------------------------
@@ -296,7 +384,7 @@ const Variant & Variant::operator[](const String & fieldName) const
 {
     if (m_type.id == SN_VT_DICTIONARY)
     {
-        const Dictionary & dict = *m_data.pDictionary;
+        const Dictionary & dict = *dictionaryPtr();
         auto it = dict.find(fieldName);
         if (it != dict.end())
             return it->second;
@@ -336,14 +424,14 @@ size_t Variant::getHash() const
     // At the moment, addresses are used.
 
     case SN_VT_STRING:
-        return std::hash<String>()(*m_data.pString);
+        return std::hash<String>()(*stringPtr());
 
     case SN_VT_ARRAY:
-        return (size_t)m_data.pArray;
+        return (size_t)arrayPtr();
         //return std::hash<Array>()(*m_data.pArray);
 
     case SN_VT_DICTIONARY:
-        return (size_t)m_data.pDictionary;
+        return (size_t)dictionaryPtr();
         //return std::hash<Dictionary>()(*m_data.pDictionary);
 
     default: return 0;
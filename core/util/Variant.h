@@ -12,10 +12,12 @@ This file is part of the SnowfeetEngine project.
 #include <core/math/Vector3.h>
 #include <core/math/Quaternion.h>
 #include <core/math/Matrix4.h>
+#include <core/util/FlatMap.h>
 
 #include <string>
 #include <unordered_map>
 #include <vector>
+#include <new>
 
 namespace sn
 {
@@ -73,23 +75,31 @@ class Variant;
 std::string SN_API toString(VariantType vt);
 std::string SN_API toString(const Variant & v);
 
-/// \brief Template-free implementation of a variant type
+/// \brief Template-free implementation of a variant type.
+/// Strings, arrays and dictionaries are constructed in-place inside the variant,
+/// so creating one doesn't allocate an extra block, and short strings don't allocate at all
+/// (they fit in the string's own small buffer).
+/// Dictionaries are flat, sorted by key, which suits the small objects documents are made of.
 class SN_API Variant
 {
 public:
 
     typedef std::string String;
     typedef std::vector<Variant> Array;
-    typedef std::unordered_map<std::string, Variant> Dictionary;
+    typedef FlatMap<std::string, Variant> Dictionary;
+
+    /// \brief Size of the in-place storage, large enough to hold any of the containers above.
+    /// Note: vectors have the same size whatever their element type, and FlatMap is only made of a vector.
+    static const size_t STORAGE_SIZE = sizeof(String) > sizeof(std::vector<int>) ? sizeof(String) : sizeof(std::vector<int>);
 
     union VariantData
     {
         bool vBool;
         s32 vInt;
         f32 vFloat;
-        String * pString;
-        Array * pArray;
-        Dictionary * pDictionary;
+        // Containers are constructed in this buffer (the pointer member ensures alignment)
+        void * vAlign;
+        char vStorage[STORAGE_SIZE];
     };
 
     //--------------------------------------
@@ -100,13 +110,19 @@ public:
     Variant(bool b) :                 m_type(SN_VT_BOOL)        { m_data.vBool = b; }
     Variant(s32 n) :                  m_type(SN_VT_INT)         { m_data.vInt = n; }
     Variant(f32 n) :                  m_type(SN_VT_FLOAT)       { m_data.vFloat = n; }
-    Variant(const String & s) :       m_type(SN_VT_STRING)      { m_data.pString = new String(s); }
-    Variant(const Array & o) :        m_type(SN_VT_ARRAY)       { m_data.pArray = new Array(o); }
-    Variant(const Dictionary & o) :   m_type(SN_VT_DICTIONARY)  { m_data.pDictionary = new Dictionary(o); }
-	// TODO C++11 Move constructor
+    Variant(const char * s) :         m_type(SN_VT_STRING)      { new (m_data.vStorage) String(s); }
+    Variant(const String & s) :       m_type(SN_VT_STRING)      { new (m_data.vStorage) String(s); }
+    Variant(const Array & o) :        m_type(SN_VT_ARRAY)       { new (m_data.vStorage) Array(o); }
+    Variant(const Dictionary & o) :   m_type(SN_VT_DICTIONARY)  { new (m_data.vStorage) Dictionary(o); }
+    Variant(String && s) :            m_type(SN_VT_STRING)      { new (m_data.vStorage) String(std::move(s)); }
+    Variant(Array && o) :             m_type(SN_VT_ARRAY)       { new (m_data.vStorage) Array(std::move(o)); }
+    Variant(Dictionary && o) :        m_type(SN_VT_DICTIONARY)  { new (m_data.vStorage) Dictionary(std::move(o)); }
 
     Variant(const Variant & other);
 
+    /// \brief Moves the contents of another variant. The other variant is left null.
+    Variant(Variant && other) SN_NOEXCEPT;
+
     ~Variant();
 
     //--------------------------------------
@@ -121,7 +137,7 @@ public:
 
     inline VariantType getType() const { return m_type; }
 
-	void Variant::assertType(VariantType t) const
+	void assertType(VariantType t) const
 	{
 		SN_ASSERT(m_type.id == t.id, "Variant " << toString(t) << " expected, got " << toString(*this));
 	}
@@ -134,22 +150,22 @@ public:
     const Array & getArray() const;
     const Dictionary & getDictionary() const;
 
-	Variant::String & Variant::getString()
+	String & getString()
 	{
 		assertType(SN_VT_STRING);
-		return *m_data.pString;
+		return *stringPtr();
 	}
 
-	Variant::Array & Variant::getArray()
+	Array & getArray()
 	{
 		assertType(SN_VT_ARRAY);
-		return *m_data.pArray;
+		return *arrayPtr();
 	}
 
-	Variant::Dictionary & Variant::getDictionary()
+	Dictionary & getDictionary()
 	{
 		assertType(SN_VT_DICTIONARY);
-		return *m_data.pDictionary;
+		return *dictionaryPtr();
 	}
 
     void setBool(bool b);
@@ -158,6 +174,9 @@ public:
     void setString(const String & str);
     void setArray(const Array & va);
     void setDictionary(const Dictionary & vd);
+    void setString(String && str);
+    void setArray(Array && va);
+    void setDictionary(Dictionary && vd);
 
     /// \brief Moves the contents of another variant to this one.
     /// This can be faster than copy the values.
@@ -174,13 +193,19 @@ public:
     Variant & operator=(bool b)                  { setBool(b); return *this; }
     Variant & operator=(s32 n)                   { setInt(n); return *this; }
     Variant & operator=(f32 n)                   { setFloat(n); return *this; }
+    Variant & operator=(const char * str)        { setString(str); return *this; }
     Variant & operator=(const String & str)      { setString(str); return *this; }
     Variant & operator=(const Array & va)        { setArray(va); return *this; }
     Variant & operator=(const Dictionary & vd)   { setDictionary(vd); return *this; }
+    Variant & operator=(String && str)           { setString(std::move(str)); return *this; }
+    Variant & operator=(Array && va)             { setArray(std::move(va)); return *this; }
+    Variant & operator=(Dictionary && vd)        { setDictionary(std::move(vd)); return *this; }
 
     Variant & operator=(const Variant & other);
+    Variant & operator=(Variant && other) SN_NOEXCEPT;
 
     bool operator==(const Variant & other) const;
+    bool operator!=(const Variant & other) const { return !(*this == other); }
 
     Variant & operator[](size_t index);
     Variant & operator[](const String & fieldName);
@@ -205,6 +230,17 @@ public:
     inline bool isArray() const       { return m_type.id == SN_VT_ARRAY; }
     inline bool isDictionary() const  { return m_type.id == SN_VT_DICTIONARY; }
 
+private:
+    inline String * stringPtr()                     { return reinterpret_cast<String*>(m_data.vStorage); }
+    inline Array * arrayPtr()                       { return reinterpret_cast<Array*>(m_data.vStorage); }
+    inline Dictionary * dictionaryPtr()             { return reinterpret_cast<Dictionary*>(m_data.vStorage); }
+    inline const String * stringPtr() const         { return reinterpret_cast<const String*>(m_data.vStorage); }
+    inline const Array * arrayPtr() const           { return reinterpret_cast<const Array*>(m_data.vStorage); }
+    inline const Dictionary * dictionaryPtr() const { return reinterpret_cast<const Dictionary*>(m_data.vStorage); }
+
+    /// \brief Move-constructs contents from another variant. This variant must be null.
+    void moveFrom(Variant & other);
+
 private:
 
     VariantType m_type;
@@ -0,0 +1,116 @@
+#include "DistanceField.h"
+#include <vector>
+#include <cmath>
+
+namespace sn
+{
+
+namespace
+{
+    const f32 INF = 1e20f;
+
+    // Squared distance transform of one row or column, in place (Felzenszwalb & Huttenlocher).
+    // Temporary arrays must hold length values, and length + 1 for z.
+    void transform1D(f32 * grid, u32 offset, u32 stride, u32 length, f32 * f, u32 * v, f32 * z)
+    {
+        v[0] = 0;
+        z[0] = -INF;
+        z[1] = INF;
+        f[0] = grid[offset];
+
+        // Lower envelope of the parabolas rooted at each value
+        s32 k = 0;
+        for (u32 q = 1; q < length; ++q)
+        {
+            f[q] = grid[offset + q * stride];
+            f32 q2 = static_cast<f32>(q * q);
+            f32 s;
+            do
+            {
+                u32 r = v[k];
+                s = (f[q] - f[r] + q2 - static_cast<f32>(r * r)) / static_cast<f32>(q - r) / 2.f;
+            } while (s <= z[k] && --k > -1);
+
+            ++k;
+            v[k] = q;
+            z[k] = s;
+            z[k + 1] = INF;
+        }
+
+        k = 0;
+        for (u32 q = 0; q < length; ++q)
+        {
+            while (z[k + 1] < static_cast<f32>(q))
+                ++k;
+            u32 r = v[k];
+            f32 d = static_cast<f32>(q) - static_cast<f32>(r);
+            grid[offset + q * stride] = f[r] + d * d;
+        }
+    }
+
+    void transform2D(f32 * grid, u32 width, u32 height, f32 * f, u32 * v, f32 * z)
+    {
+        for (u32 x = 0; x < width; ++x)
+            transform1D(grid, x, width, height, f, v, z);
+        for (u32 y = 0; y < height; ++y)
+            transform1D(grid, y * width, 1, width, f, v, z);
+    }
+}
+
+//------------------------------------------------------------------------------
+void computeDistanceField(const u8 * coverage, u32 width, u32 height, u32 spread, u8 * out_values)
+{
+    const u32 w = width + 2 * spread;
+    const u32 h = height + 2 * spread;
+    const u32 size = w * h;
+
+    // Squared distances to the nearest pixel outside and inside the shape.
+    // Partially covered pixels start at a fraction of pixel from the edge.
+    std::vector<f32> outer(size, INF);
+    std::vector<f32> inner(size, 0.f);
+    for (u32 y = 0; y < height; ++y)
+    {
+        for (u32 x = 0; x < width; ++x)
+        {
+            u8 c = coverage[x + y * width];
+            if (c == 0)
+                continue;
+            u32 i = (x + spread) + (y + spread) * w;
+            if (c == 255)
+            {
+                outer[i] = 0.f;
+                inner[i] = INF;
+            }
+            else
+            {
+                f32 d = 0.5f - static_cast<f32>(c) / 255.f;
+                outer[i] = d > 0.f ? d * d : 0.f;
+                inner[i] = d < 0.f ? d * d : 0.f;
+            }
+        }
+    }
+
+    const u32 maxLength = w > h ? w : h;
+    std::vector<f32> f(maxLength);
+    std::vector<u32> v(maxLength);
+    std::vector<f32> z(maxLength + 1);
+
+    transform2D(&outer[0], w, h, &f[0], &v[0], &z[0]);
+    transform2D(&inner[0], w, h, &f[0], &v[0], &z[0]);
+
+    const f32 scale = 1.f / (2.f * static_cast<f32>(spread > 0 ? spread : 1));
+    for (u32 i = 0; i < size; ++i)
+    {
+        // Positive outside the shape
+        f32 d = sqrt(outer[i]) - sqrt(inner[i]);
+        f32 value = 0.5f - d * scale;
+        if (value < 0.f)
+            value = 0.f;
+        else if (value > 1.f)
+            value = 1.f;
+        out_values[i] = static_cast<u8>(value * 255.f + 0.5f);
+    }
+}
+
+} // namespace sn
+
@@ -0,0 +1,21 @@
+#ifndef __HEADER_SN_DISTANCEFIELD__
+#define __HEADER_SN_DISTANCEFIELD__
+
+#include <core/types.h>
+
+namespace sn
+{
+
+/// \brief Computes a signed distance field from coverage values, as used to draw glyphs at any size.
+/// Distances are exact euclidean distances (two-pass separable transform), refined by partial coverage on edges.
+/// \param coverage: width * height values, 255 meaning fully inside the shape
+/// \param spread: distance in pixels covered by the output range. The output is enlarged by this amount on each side.
+/// \param out_values: (width + 2 * spread) * (height + 2 * spread) values.
+/// 128 is on the edge, 255 is spread pixels inside or more, 0 is spread pixels outside or more.
+/// \note This function can be called from several threads at the same time.
+void computeDistanceField(const u8 * coverage, u32 width, u32 height, u32 spread, u8 * out_values);
+
+} // namespace sn
+
+#endif // __HEADER_SN_DISTANCEFIELD__
+
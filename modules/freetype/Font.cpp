@@ -1,10 +1,16 @@
 #include "Font.hpp"
+#include "DistanceField.h"
 
 #include <core/asset/AssetDatabase.h>
 #include <core/app/Application.h>
+#include <core/system/parallel.h>
 
 #include <modules/render/VideoDriver.h>
 
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
@@ -18,13 +24,28 @@ namespace sn
 //------------------------------------------------------------------------------
 SN_OBJECT_IMPL(Font)
 
+//------------------------------------------------------------------------------
+Font::Page::Page(u32 width, u32 height) :
+    image(nullptr),
+    texture(nullptr),
+    packer(width, height),
+    isDirty(false),
+    lastUse(0)
+{}
+
 //------------------------------------------------------------------------------
 Font::Font() : sn::Asset(),
     m_face(nullptr),
     m_fileData(nullptr),
-    m_image(nullptr),
-    m_texture(nullptr),
-    m_packer(DEFAULT_PAGE_WIDTH, DEFAULT_PAGE_HEIGHT)
+    m_maxPageSize(DEFAULT_MAX_PAGE_SIZE),
+    m_maxPageCount(DEFAULT_MAX_PAGE_COUNT),
+    m_useClock(0),
+    m_atlasLayoutChanged(false),
+    m_atlasVersion(0),
+    m_distanceField(false),
+    m_distanceFieldSize(DEFAULT_DISTANCE_FIELD_SIZE),
+    m_distanceFieldSpread(DEFAULT_DISTANCE_FIELD_SPREAD),
+    m_distanceFieldThreadCount(DEFAULT_DISTANCE_FIELD_THREAD_COUNT)
 {
 }
 
@@ -32,23 +53,24 @@ Font::Font() : sn::Asset(),
 Font::~Font()
 {
     clearFace();
-    if (m_texture != nullptr)
-        m_texture->release();
-    if (m_image != nullptr)
-        m_image->release();
+    clearPages();
 }
 
 //------------------------------------------------------------------------------
 const Glyph & Font::getGlyph(u32 unicode, FontFormat format) const
 {
+    if (m_distanceField)
+        return getScaledGlyph(unicode, format);
+
     auto & glyphes = m_glyphes[format.style];
-    auto it = glyphes.find(unicode);
+    u64 key = getGlyphKey(unicode, format.size);
+    auto it = glyphes.find(key);
     if (it == glyphes.end())
     {
-        Glyph glyph;
-        if (generateGlyph(glyph, unicode, format))
+        RasterizedGlyph rasterized;
+        if (rasterizeGlyph(rasterized, unicode, format) && insertGlyph(rasterized, format.style, key))
         {
-            auto ret = glyphes.insert(std::make_pair(unicode, glyph));
+            auto ret = glyphes.insert(std::make_pair(key, rasterized.glyph));
             return ret.first->second;
         }
         else
@@ -57,13 +79,199 @@ const Glyph & Font::getGlyph(u32 unicode, FontFormat format) const
             return s_defaultGlyph;
         }
     }
-    return it->second;
+
+    const Glyph & glyph = it->second;
+    if (glyph.imageRect.width() > 0)
+        m_pages[glyph.page]->lastUse = ++m_useClock;
+    return glyph;
+}
+
+//------------------------------------------------------------------------------
+void Font::prewarmGlyphs(const u32 * unicodes, u32 count, FontFormat format) const
+{
+    SN_ASSERT(unicodes != nullptr || count == 0, "Received null unicodes");
+
+    auto & glyphes = m_glyphes[format.style];
+
+    // In distance field mode, reference glyphs are prewarmed, then scaled ones are derived from them
+    FontFormat rasterFormat = format;
+    u32 keySize = format.size;
+    if (m_distanceField)
+    {
+        rasterFormat.size = m_distanceFieldSize;
+        keySize = 0;
+    }
+
+    std::vector<RasterizedGlyph> rasterizedGlyphs;
+    rasterizedGlyphs.reserve(count);
+    for (u32 i = 0; i < count; ++i)
+    {
+        if (glyphes.find(getGlyphKey(unicodes[i], keySize)) != glyphes.end())
+            continue;
+        rasterizedGlyphs.push_back(RasterizedGlyph());
+        if (!rasterizeGlyph(rasterizedGlyphs.back(), unicodes[i], rasterFormat))
+            rasterizedGlyphs.pop_back();
+    }
+
+    if (m_distanceField)
+    {
+        // The FreeType face can only be used from one thread, but distance fields are independent
+        parallelFor(rasterizedGlyphs.size(), m_distanceFieldThreadCount, [this, &rasterizedGlyphs](u32 begin, u32 end) {
+            for (u32 i = begin; i < end; ++i)
+                convertToDistanceField(rasterizedGlyphs[i]);
+        });
+    }
+
+    // Packing is denser when glyphs come from the tallest to the smallest
+    std::vector<u32> order(rasterizedGlyphs.size());
+    for (u32 i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&rasterizedGlyphs](u32 a, u32 b) {
+        return rasterizedGlyphs[a].height > rasterizedGlyphs[b].height;
+    });
+
+    for (u32 i = 0; i < order.size(); ++i)
+    {
+        RasterizedGlyph & rasterized = rasterizedGlyphs[order[i]];
+        u64 key = getGlyphKey(rasterized.unicode, keySize);
+        if (glyphes.find(key) != glyphes.end())
+            continue;
+        if (insertGlyph(rasterized, format.style, key))
+            glyphes.insert(std::make_pair(key, rasterized.glyph));
+    }
+
+    if (m_distanceField)
+    {
+        for (u32 i = 0; i < count; ++i)
+            getScaledGlyph(unicodes[i], format);
+    }
+}
+
+//------------------------------------------------------------------------------
+const Glyph & Font::getScaledGlyph(u32 unicode, FontFormat format) const
+{
+    auto & glyphes = m_glyphes[format.style];
+    u64 key = getGlyphKey(unicode, format.size);
+    auto it = glyphes.find(key);
+    if (it != glyphes.end())
+    {
+        const Glyph & glyph = it->second;
+        if (glyph.imageRect.width() > 0)
+            m_pages[glyph.page]->lastUse = ++m_useClock;
+        return glyph;
+    }
+
+    const Glyph * reference = getReferenceGlyph(unicode, format.style);
+    if (reference == nullptr)
+    {
+        static Glyph s_defaultGlyph;
+        return s_defaultGlyph;
+    }
+
+    // Pixels are shared with the reference glyph, only metrics depend on the size
+    Glyph glyph = *reference;
+    const f32 scale = static_cast<f32>(format.size) / static_cast<f32>(m_distanceFieldSize);
+    glyph.advance = static_cast<s32>(floor(static_cast<f32>(reference->advance) * scale + 0.5f));
+
+    const IntRect & bounds = reference->bounds;
+    s32 minX = static_cast<s32>(floor(static_cast<f32>(bounds.x()) * scale + 0.5f));
+    s32 minY = static_cast<s32>(floor(static_cast<f32>(bounds.y()) * scale + 0.5f));
+    s32 endX = static_cast<s32>(floor(static_cast<f32>(bounds.x() + bounds.width()) * scale + 0.5f));
+    s32 endY = static_cast<s32>(floor(static_cast<f32>(bounds.y() + bounds.height()) * scale + 0.5f));
+    glyph.bounds = IntRect::fromPositionSize(minX, minY, endX - minX, endY - minY);
+
+    // Registered in the page too, so it goes away with the reference glyph
+    if (glyph.imageRect.width() > 0)
+    {
+        Page & page = *m_pages[glyph.page];
+        page.glyphs.push_back(std::make_pair(format.style, key));
+        page.lastUse = ++m_useClock;
+    }
+
+    return glyphes.insert(std::make_pair(key, glyph)).first->second;
 }
 
 //------------------------------------------------------------------------------
-bool Font::generateGlyph(Glyph & out_glyph, sn::u32 unicode, FontFormat format) const
+const Glyph * Font::getReferenceGlyph(u32 unicode, u32 style) const
 {
-    Glyph glyph;
+    auto & glyphes = m_glyphes[style];
+    u64 key = getGlyphKey(unicode, 0);
+    auto it = glyphes.find(key);
+    if (it != glyphes.end())
+        return &it->second;
+
+    RasterizedGlyph rasterized;
+    if (!rasterizeGlyph(rasterized, unicode, FontFormat(m_distanceFieldSize, style)))
+        return nullptr;
+    convertToDistanceField(rasterized);
+    if (!insertGlyph(rasterized, style, key))
+        return nullptr;
+
+    return &glyphes.insert(std::make_pair(key, rasterized.glyph)).first->second;
+}
+
+//------------------------------------------------------------------------------
+void Font::convertToDistanceField(RasterizedGlyph & rasterized) const
+{
+    if (rasterized.width == 0 || rasterized.height == 0)
+        return;
+
+    const u32 spread = m_distanceFieldSpread;
+    std::vector<u8> coverage;
+    coverage.swap(rasterized.pixels);
+
+    rasterized.pixels.resize((rasterized.width + 2 * spread) * (rasterized.height + 2 * spread));
+    computeDistanceField(&coverage[0], rasterized.width, rasterized.height, spread, &rasterized.pixels[0]);
+
+    rasterized.width += 2 * spread;
+    rasterized.height += 2 * spread;
+
+    // The distance field extends around the outline
+    const IntRect & bounds = rasterized.glyph.bounds;
+    rasterized.glyph.bounds = IntRect::fromPositionSize(
+        bounds.x() - spread,
+        bounds.y() - spread,
+        bounds.width() + 2 * spread,
+        bounds.height() + 2 * spread
+    );
+}
+
+//------------------------------------------------------------------------------
+void Font::setDistanceField(bool enable, u32 referenceSize, u32 spread)
+{
+    if (enable == m_distanceField
+        && (!enable || (referenceSize == m_distanceFieldSize && spread == m_distanceFieldSpread)))
+        return;
+
+    m_distanceField = enable;
+    m_distanceFieldSize = referenceSize > 0 ? referenceSize : DEFAULT_DISTANCE_FIELD_SIZE;
+    m_distanceFieldSpread = spread;
+
+    // Glyphs were rasterized for the other mode
+    clearPages();
+    if (m_face)
+        createPage(INITIAL_PAGE_SIZE, INITIAL_PAGE_SIZE);
+    m_atlasLayoutChanged = true;
+    ++m_atlasVersion;
+}
+
+//------------------------------------------------------------------------------
+void Font::prewarmGlyphRange(u32 firstUnicode, u32 lastUnicode, FontFormat format) const
+{
+    std::vector<u32> unicodes;
+    for (u32 unicode = firstUnicode; unicode <= lastUnicode; ++unicode)
+        unicodes.push_back(unicode);
+    if (!unicodes.empty())
+        prewarmGlyphs(&unicodes[0], unicodes.size(), format);
+}
+
+//------------------------------------------------------------------------------
+bool Font::rasterizeGlyph(RasterizedGlyph & out_glyph, sn::u32 unicode, FontFormat format) const
+{
+    Glyph & glyph = out_glyph.glyph;
+    out_glyph.unicode = unicode;
+    out_glyph.width = 0;
+    out_glyph.height = 0;
 
     if (!setCurrentSize(format.size))
         return false;
@@ -115,16 +323,7 @@ bool Font::generateGlyph(Glyph & out_glyph, sn::u32 unicode, FontFormat format)
     {
         // Leave a small padding around characters, so that filtering doesn't
         // pollute them with pixels from neighbours
-        const unsigned int padding = 1;
-
-        ShelfPacker<Glyph>::Node packNode(glyph, width + 2 * padding, height + 2 * padding);
-        if (!m_packer.insert(packNode, &glyph.imageRect))
-        {
-            // TODO Atlas resizing
-            SN_WARNING("Cannot insert new glyph in atlas");
-            FT_Done_Glyph(glyphDesc);
-            return false;
-        }
+        const s32 padding = 1;
 
         // Compute the glyph's bounding box
         glyph.bounds = IntRect::fromPositionSize(
@@ -134,29 +333,21 @@ bool Font::generateGlyph(Glyph & out_glyph, sn::u32 unicode, FontFormat format)
             height + 2 * padding
         );
 
-        // Extract the glyph's pixels from the bitmap
+        // Extract the glyph's pixels from the bitmap as alpha values
+        out_glyph.width = width;
+        out_glyph.height = height;
+        out_glyph.pixels.resize(width * height);
 
-        // Get the source buffer
         const u8 * src = bitmap.buffer;
+        u8 * dst = &out_glyph.pixels[0];
 
-        // Create the destination buffer
-        const u32 dstSize = width * height * 4;
-        u8 * dst = new u8[width * height * 4];
-        // Fill with white
-        memset(dst, 255, dstSize);
-
-        // Convert from source to destination
         if (bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
         {
             // Pixels are 1 bit monochrome values
             for (u32 y = 0; y < height; ++y)
             {
                 for (u32 x = 0; x < width; ++x)
-                {
-                    // The color channels remain white, just fill the alpha channel
-                    size_t dstIndex = (x + y * width) * 4 + 3;
-                    dst[dstIndex] = ((src[x / 8]) & (1 << (7 - (x % 8)))) ? 255 : 0;
-                }
+                    dst[x + y * width] = ((src[x / 8]) & (1 << (7 - (x % 8)))) ? 255 : 0;
                 src += bitmap.pitch;
             }
         }
@@ -165,55 +356,263 @@ bool Font::generateGlyph(Glyph & out_glyph, sn::u32 unicode, FontFormat format)
             // Pixels are 8 bits gray levels
             for (u32 y = 0; y < height; ++y)
             {
-                for (u32 x = 0; x < width; ++x)
-                {
-                    // The color channels remain white, just fill the alpha channel
-                    size_t dstIndex = (x + y * width) * 4 + 3;
-                    dst[dstIndex] = src[x];
-                }
+                memcpy(dst + y * width, src, width);
                 src += bitmap.pitch;
             }
         }
+    }
+    else
+    {
+        SN_DLOG("Character " << unicode << " (ascii: " << (char)unicode << ") has an empty bitmap");
+    }
+
+    // Delete the FT glyph
+    FT_Done_Glyph(glyphDesc);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool Font::insertGlyph(RasterizedGlyph & rasterized, u32 style, u64 key) const
+{
+    if (rasterized.width == 0 || rasterized.height == 0)
+        return true;
+
+    Glyph & glyph = rasterized.glyph;
+    const u32 padding = 1;
+
+    if (!allocateRect(rasterized.width + 2 * padding, rasterized.height + 2 * padding, glyph.page, glyph.imageRect))
+    {
+        SN_WARNING("Cannot insert new glyph in atlas");
+        return false;
+    }
+
+    Page & page = *m_pages[glyph.page];
+    page.image->pasteSubImage(
+        &rasterized.pixels[0],
+        glyph.imageRect.x() + padding,
+        glyph.imageRect.y() + padding,
+        rasterized.width,
+        rasterized.height,
+        SN_IMAGE_ALPHA8
+    );
+    markDirty(page, glyph.imageRect);
+    page.glyphs.push_back(std::make_pair(style, key));
+    page.lastUse = ++m_useClock;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool Font::allocateRect(u32 width, u32 height, u32 & out_page, IntRect & out_rect) const
+{
+    if (width > m_maxPageSize || height > m_maxPageSize)
+        return false;
 
-        // Paste pixels into the image
-        u32 x = glyph.imageRect.x() + padding;
-        u32 y = glyph.imageRect.y() + padding;
-        u32 w = width;//glyph.imageRect.width() - 2 * padding;
-        u32 h = height;//glyph.imageRect.height() - 2 * padding;
-        m_image->pasteSubImage(dst, x, y, w, h, SN_IMAGE_RGBA32);
+    // Fit in an existing page
+    for (u32 i = 0; i < m_pages.size(); ++i)
+    {
+        if (m_pages[i]->packer.insert(width, height, &out_rect))
+        {
+            out_page = i;
+            return true;
+        }
+    }
 
-        if (m_texture)
+    // Grow a page
+    for (u32 i = 0; i < m_pages.size(); ++i)
+    {
+        while (growPage(i))
         {
-            // Update the texture
-            // TODO Optimization: only update a sub-rectangle of the texture
-            m_texture->uploadToVRAM();
+            if (m_pages[i]->packer.insert(width, height, &out_rect))
+            {
+                out_page = i;
+                return true;
+            }
         }
+    }
+
+    // Create a new page
+    if (m_pages.size() < m_maxPageCount)
+    {
+        u32 size = std::min(INITIAL_PAGE_SIZE, m_maxPageSize);
+        while (size < width || size < height)
+            size *= 2;
+        createPage(std::min(size, m_maxPageSize), std::min(size, m_maxPageSize));
+        out_page = m_pages.size() - 1;
+        return m_pages.back()->packer.insert(width, height, &out_rect);
+    }
 
-        delete[] dst;
+    // Reuse the least recently used page
+    u32 oldest = 0;
+    for (u32 i = 1; i < m_pages.size(); ++i)
+    {
+        if (m_pages[i]->lastUse < m_pages[oldest]->lastUse)
+            oldest = i;
     }
-    else
+    clearPage(oldest);
+    out_page = oldest;
+    while (!m_pages[oldest]->packer.insert(width, height, &out_rect))
     {
-        SN_DLOG("Character " << unicode << " (ascii: " << (char)unicode << ") has an empty bitmap");
+        if (!growPage(oldest))
+            return false;
     }
+    return true;
+}
 
-    // Delete the FT glyph
-    FT_Done_Glyph(glyphDesc);
+//------------------------------------------------------------------------------
+void Font::createPage(u32 width, u32 height) const
+{
+    Page * page = new Page(width, height);
 
-    out_glyph = glyph;
+    page->image = new Image();
+    page->image->create(Vector2u(width, height), sn::SN_IMAGE_ALPHA8, sn::Color8(0, 0, 0, 0));
 
+    // TODO Don't do this if we don't want to draw the font
+    sn::VideoDriver * driver = Application::get().getDriverManager().getDriver<sn::VideoDriver>();
+    if (driver)
+    {
+        page->texture = driver->createTexture();
+        page->texture->setSourceImage(*page->image);
+        page->texture->setKeepSourceInMemory(true);
+    }
+
+    markDirty(*page, IntRect::fromPositionSize(0, 0, width, height));
+    m_pages.push_back(page);
+}
+
+//------------------------------------------------------------------------------
+bool Font::growPage(u32 pageIndex) const
+{
+    Page & page = *m_pages[pageIndex];
+    u32 width = page.packer.getWidth();
+    u32 height = page.packer.getHeight();
+
+    // New rows come first, then existing rows get longer
+    if (height <= width && height * 2 <= m_maxPageSize)
+        height *= 2;
+    else if (width * 2 <= m_maxPageSize)
+        width *= 2;
+    else
+        return false;
+
+    // Glyphs keep their position, so only the texture coordinates computed from the page size change
+    Image * image = new Image();
+    image->create(Vector2u(width, height), sn::SN_IMAGE_ALPHA8, sn::Color8(0, 0, 0, 0));
+    image->pasteSubImage(*page.image, 0, 0);
+    page.image->release();
+    page.image = image;
+    if (page.texture)
+        page.texture->setSourceImage(*image);
+
+    page.packer.grow(width, height);
+    markDirty(page, IntRect::fromPositionSize(0, 0, width, height));
+    m_atlasLayoutChanged = true;
+    ++m_atlasVersion;
     return true;
 }
 
+//------------------------------------------------------------------------------
+void Font::clearPage(u32 pageIndex) const
+{
+    Page & page = *m_pages[pageIndex];
+
+    for (u32 i = 0; i < page.glyphs.size(); ++i)
+        m_glyphes[page.glyphs[i].first].erase(page.glyphs[i].second);
+    page.glyphs.clear();
+
+    page.packer.clear();
+    page.image->fill(sn::Color8(0, 0, 0, 0));
+    markDirty(page, IntRect::fromPositionSize(0, 0, page.packer.getWidth(), page.packer.getHeight()));
+    m_atlasLayoutChanged = true;
+    ++m_atlasVersion;
+}
+
+//------------------------------------------------------------------------------
+void Font::markDirty(Page & page, const IntRect & rect) const
+{
+    if (page.isDirty)
+    {
+        page.dirtyRect = IntRect::fromMinMax(
+            std::min(page.dirtyRect.minX(), rect.minX()),
+            std::min(page.dirtyRect.minY(), rect.minY()),
+            std::max(page.dirtyRect.maxX(), rect.maxX()),
+            std::max(page.dirtyRect.maxY(), rect.maxY())
+        );
+    }
+    else
+    {
+        page.dirtyRect = rect;
+        page.isDirty = true;
+    }
+}
+
+//------------------------------------------------------------------------------
+void Font::clearPages()
+{
+    for (u32 i = 0; i < m_pages.size(); ++i)
+    {
+        Page * page = m_pages[i];
+        if (page->texture)
+            page->texture->release();
+        page->image->release();
+        delete page;
+    }
+    m_pages.clear();
+
+    for (u32 i = 0; i < FontFormat::STYLE_COMBINATION_COUNT; ++i)
+        m_glyphes[i].clear();
+}
+
+//------------------------------------------------------------------------------
+void Font::uploadGlyphs() const
+{
+    for (u32 i = 0; i < m_pages.size(); ++i)
+    {
+        Page & page = *m_pages[i];
+        if (!page.isDirty)
+            continue;
+        // The whole texture is uploaded if its size changed
+        if (page.texture)
+            page.texture->uploadRegionToVRAM(page.dirtyRect);
+        page.isDirty = false;
+    }
+    m_atlasLayoutChanged = false;
+}
+
+//------------------------------------------------------------------------------
+bool Font::hasPendingUploads() const
+{
+    for (u32 i = 0; i < m_pages.size(); ++i)
+    {
+        if (m_pages[i]->isDirty)
+            return true;
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+sn::Texture * Font::getPageTexture(u32 page) const
+{
+    return page < m_pages.size() ? m_pages[page]->texture : nullptr;
+}
+
+//------------------------------------------------------------------------------
+const sn::Image * Font::getPageImage(u32 page) const
+{
+    return page < m_pages.size() ? m_pages[page]->image : nullptr;
+}
+
 //------------------------------------------------------------------------------
 sn::Texture * Font::getTexture(FontFormat format) const
 {
-    return m_texture;
+    return getPageTexture(0);
 }
 
 //------------------------------------------------------------------------------
 const sn::Image * Font::getImage(FontFormat format) const
 {
-    return m_image;
+    return getPageImage(0);
 }
 
 //------------------------------------------------------------------------------
@@ -311,18 +710,13 @@ void Font::setFace(void * face, char * fileData)
     if (m_face != face)
     {
         clearFace();
+        // Glyphs of the previous face are no longer valid
+        clearPages();
         m_face = face;
         m_fileData = fileData;
 
         if (m_face)
-        {
-            if (m_image == nullptr)
-                createImage();
-
-            // TODO Don't do this if we don't want to draw the font
-            if (m_texture == nullptr)
-                createTexture();
-        }
+            createPage(INITIAL_PAGE_SIZE, INITIAL_PAGE_SIZE);
     }
 }
 
@@ -341,31 +735,5 @@ void Font::clearFace()
     }
 }
 
-//------------------------------------------------------------------------------
-void Font::createImage() const
-{
-    SN_ASSERT(m_image == nullptr, "Image already created");
-    m_image = new Image();
-    m_image->create(
-        Vector2u(DEFAULT_PAGE_WIDTH, DEFAULT_PAGE_HEIGHT), 
-        sn::SN_IMAGE_RGBA32, 
-        sn::Color8(0,0,0,0)
-    );
-}
-
-//------------------------------------------------------------------------------
-void Font::createTexture() const
-{
-    SN_ASSERT(m_texture == nullptr, "Texture already created");
-    SN_ASSERT(m_image != nullptr, "Image not created");
-    sn::VideoDriver * driver = Application::get().getDriverManager().getDriver<sn::VideoDriver>();
-    if (driver)
-    {
-        m_texture = driver->createTexture();
-        m_texture->setSourceImage(*m_image);
-        m_texture->setKeepSourceInMemory(true);
-    }
-}
-
 } // namespace sn
 
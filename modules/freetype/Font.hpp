@@ -1,7 +1,9 @@
 #ifndef __HEADER_FREETYPE_FONT__
 #define __HEADER_FREETYPE_FONT__
 
-#include <core/util/ShelfPacker.h>
+#include <core/util/SkylinePacker.h>
+#include <unordered_map>
+#include <vector>
 
 #include <modules/render/Texture.h>
 #include <modules/freetype/FontFormat.h>
@@ -14,13 +16,27 @@ namespace sn
 /// accelerated text rendering or conversion pipelines.
 /// \note This class is designed so fonts can be loaded statically
 /// (load all glyphes once) or dynamically (load glyphes as they are requested).
+///
+/// Glyphs are rasterized as alpha into atlas pages. Pages start small and grow up to a maximum size,
+/// then new pages are created, and when the maximum page count is reached,
+/// the least recently used page is cleared to make room.
+/// Textures are only updated by uploadGlyphs(), which uploads one rectangle per page
+/// covering glyphs rasterized since the last call.
+///
+/// In distance field mode, glyphs are rasterized once at a reference size and stored as signed distances
+/// to their outline, so the same atlas serves every character size. They must be drawn with a shader
+/// thresholding the alpha channel at 0.5 (see render:sprite_sdf).
 class SN_FREETYPE_API Font : public sn::Asset, public sn::NonCopyable
 {
 public:
     SN_OBJECT
 
-    static const sn::u32 DEFAULT_PAGE_WIDTH = 512;
-    static const sn::u32 DEFAULT_PAGE_HEIGHT = 512;
+    static const sn::u32 INITIAL_PAGE_SIZE = 256;
+    static const sn::u32 DEFAULT_MAX_PAGE_SIZE = 1024;
+    static const sn::u32 DEFAULT_MAX_PAGE_COUNT = 4;
+    static const sn::u32 DEFAULT_DISTANCE_FIELD_SIZE = 48;
+    static const sn::u32 DEFAULT_DISTANCE_FIELD_SPREAD = 6;
+    static const sn::u32 DEFAULT_DISTANCE_FIELD_THREAD_COUNT = 4;
 
     Font();
 
@@ -30,12 +46,63 @@ public:
     /// \return glyph descriptor. If not found, will be a default glyph.
     const Glyph & getGlyph(sn::u32 unicode, FontFormat format) const;
 
-    /// \brief Gets the texture in which are stored glyphes of the specified format.
+    /// \brief Rasterizes glyphs in advance, so they don't have to be when text is drawn.
+    /// Glyphs are packed from the tallest to the smallest, which uses atlas space better
+    /// than rasterizing them in the order they appear.
+    void prewarmGlyphs(const sn::u32 * unicodes, sn::u32 count, FontFormat format) const;
+
+    /// \brief Rasterizes glyphs of an inclusive range of unicodes in advance
+    void prewarmGlyphRange(sn::u32 firstUnicode, sn::u32 lastUnicode, FontFormat format) const;
+
+    /// \brief Copies glyphs rasterized since the last call into page textures.
+    /// Call it before drawing geometry using these glyphs.
+    void uploadGlyphs() const;
+
+    /// \brief Tells if glyphs were rasterized since the last call to uploadGlyphs()
+    bool hasPendingUploads() const;
+
+    /// \brief Tells if a page was resized or cleared since the last call to uploadGlyphs().
+    /// If true, geometry built with glyphs obtained before must be drawn before uploading.
+    bool hasAtlasLayoutChanged() const { return m_atlasLayoutChanged; }
+
+    /// \brief Gets a number incremented each time a page is resized or cleared.
+    /// Geometry keeping glyph rectangles across frames must be rebuilt when it changes.
+    sn::u32 getAtlasVersion() const { return m_atlasVersion; }
+
+    sn::u32 getPageCount() const { return m_pages.size(); }
+
+    /// \brief Gets the texture of an atlas page, or null if pixels are not stored in graphic memory
+    sn::Texture * getPageTexture(sn::u32 page) const;
+
+    /// \brief Gets the image of an atlas page
+    const sn::Image * getPageImage(sn::u32 page) const;
+
+    /// \brief Sets the size pages can grow up to. Glyphs larger than that can't be stored.
+    void setMaxPageSize(sn::u32 size) { m_maxPageSize = size; }
+
+    /// \brief Sets how many pages can be created before old ones get reused
+    void setMaxPageCount(sn::u32 count) { m_maxPageCount = count > 0 ? count : 1; }
+
+    /// \brief Enables or disables distance field glyphs. Changing mode clears the atlas.
+    /// \param referenceSize: character size at which glyphs are rasterized.
+    /// Larger sizes give sharper corners at the cost of atlas space.
+    /// \param spread: distance in pixels around outlines stored in the atlas, at the reference size.
+    void setDistanceField(bool enable,
+        sn::u32 referenceSize = DEFAULT_DISTANCE_FIELD_SIZE,
+        sn::u32 spread = DEFAULT_DISTANCE_FIELD_SPREAD);
+
+    bool isDistanceField() const { return m_distanceField; }
+    sn::u32 getDistanceFieldSize() const { return m_distanceFieldSize; }
+
+    /// \brief Sets how many threads compute distance fields in prewarmGlyphs()
+    void setDistanceFieldThreadCount(sn::u32 count) { m_distanceFieldThreadCount = count > 0 ? count : 1; }
+
+    /// \brief Gets the texture of the first atlas page.
     /// \param format: the format
     /// \return A texture, or null if pixels are not stored in graphic memory
     sn::Texture * getTexture(FontFormat format) const;
 
-    /// \brief Gets the image in which are stored glyphes of the specified format.
+    /// \brief Gets the image of the first atlas page.
     /// \param format: the format
     /// \return An image, or null if pixels are not stored in memory
     const sn::Image * getImage(FontFormat format) const;
@@ -72,17 +139,56 @@ private:
     void setFace(void * face, char * fileData=nullptr);
     void clearFace();
 
-    bool generateGlyph(Glyph & out_glyph, sn::u32 unicode, FontFormat format) const;
+    /// \brief Glyph pixels before they are copied into the atlas
+    struct RasterizedGlyph
+    {
+        sn::u32 unicode;
+        Glyph glyph;
+        sn::u32 width;
+        sn::u32 height;
+        std::vector<sn::u8> pixels;
+    };
+
+    /// \brief Part of the atlas, with its own image and texture
+    struct Page
+    {
+        sn::Image * image;
+        sn::Texture * texture;
+        sn::SkylinePacker packer;
+        /// \brief Glyphs stored in the page, as (style, key)
+        std::vector< std::pair<sn::u32, sn::u64> > glyphs;
+        /// \brief Area modified since the last upload
+        sn::IntRect dirtyRect;
+        bool isDirty;
+        /// \brief Value of the use clock when a glyph of the page was last requested
+        sn::u32 lastUse;
+
+        Page(sn::u32 width, sn::u32 height);
+    };
+
+    static sn::u64 getGlyphKey(sn::u32 unicode, sn::u32 size) { return (static_cast<sn::u64>(size) << 32) | unicode; }
+
+    bool rasterizeGlyph(RasterizedGlyph & out_glyph, sn::u32 unicode, FontFormat format) const;
+    void convertToDistanceField(RasterizedGlyph & glyph) const;
+    bool insertGlyph(RasterizedGlyph & glyph, sn::u32 style, sn::u64 key) const;
+
+    /// \brief Gets a glyph in distance field mode, derived from the reference glyph
+    const Glyph & getScaledGlyph(sn::u32 unicode, FontFormat format) const;
+    const Glyph * getReferenceGlyph(sn::u32 unicode, sn::u32 style) const;
+    bool allocateRect(sn::u32 width, sn::u32 height, sn::u32 & out_page, sn::IntRect & out_rect) const;
 
     /// \brief FT_Set_Pixel_Sizes is an expensive function, so we must call it
     /// only when necessary to avoid killing performances.
     bool setCurrentSize(sn::u32 characterSize) const;
 
-    void createImage() const;
-    void createTexture() const;
+    void createPage(sn::u32 width, sn::u32 height) const;
+    bool growPage(sn::u32 pageIndex) const;
+    void clearPage(sn::u32 pageIndex) const;
+    void markDirty(Page & page, const sn::IntRect & rect) const;
+    void clearPages();
 
 private:
-    typedef std::unordered_map<sn::u32, Glyph> GlyphTable;
+    typedef std::unordered_map<sn::u64, Glyph> GlyphTable;
 
     /// \brief Freetype font face
     void * m_face; // FT_Face
@@ -91,17 +197,26 @@ private:
     /// If provided, it will be freed after the font is destroyed.
     char * m_fileData;
 
-    /// \brief Atlassed image in which glyphes will be rasterized
-    mutable sn::Image * m_image;
+    /// \brief Atlas pages in which glyphes are rasterized
+    mutable std::vector<Page*> m_pages;
+
+    sn::u32 m_maxPageSize;
+    sn::u32 m_maxPageCount;
+
+    /// \brief Incremented each time a glyph is requested, to find the least recently used page
+    mutable sn::u32 m_useClock;
 
-    /// \brief VRAM texture in which the image will be uploaded.
-    mutable sn::Texture* m_texture;
+    mutable bool m_atlasLayoutChanged;
+    mutable sn::u32 m_atlasVersion;
 
-    /// \brief Packing algorithm used to atlas the glyphes
-    mutable sn::ShelfPacker<Glyph> m_packer;
+    bool m_distanceField;
+    sn::u32 m_distanceFieldSize;
+    sn::u32 m_distanceFieldSpread;
+    sn::u32 m_distanceFieldThreadCount;
 
     /// \brief Glyph informations.
-    /// Access: [style][unicode] => Glyph
+    /// Access: [style][(size, unicode)] => Glyph
+    /// In distance field mode, reference glyphs are stored with a size of 0.
     mutable GlyphTable m_glyphes[FontFormat::STYLE_COMBINATION_COUNT];
 
 };
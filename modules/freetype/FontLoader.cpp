@@ -89,6 +89,18 @@ bool FontLoader::load(std::ifstream & ifs, sn::Asset & asset) const
         return false;
     }
 
+    // Distance field mode is optional, and is set in the .meta file like this:
+    // "distanceField": { "size": 48, "spread": 6 }
+    const Variant & distanceField = asset.getAssetMetadata().variantData["distanceField"];
+    if (distanceField.isDictionary())
+    {
+        s32 size = distanceField["size"].getInt();
+        s32 spread = distanceField["spread"].getInt();
+        font->setDistanceField(true,
+            size > 0 ? size : Font::DEFAULT_DISTANCE_FIELD_SIZE,
+            spread > 0 ? spread : Font::DEFAULT_DISTANCE_FIELD_SPREAD);
+    }
+
     // Store the loaded font
     font->setFace(face, fileData);
 
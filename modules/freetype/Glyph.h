@@ -9,10 +9,12 @@ namespace sn
 /// \brief Describes one character of a Font
 struct Glyph
 {
-    Glyph() : advance(0) {}
+    Glyph() : advance(0), page(0) {}
 
     /// \brief Offset to apply after printing this glyph
     sn::s32 advance;
+    /// \brief Index of the atlas page holding the glyph
+    sn::u32 page;
     /// \brief coordinates of the glyph within the image holding it
     sn::IntRect imageRect;
     /// \brief Bounds of the glyph relative to the baseline
@@ -0,0 +1,550 @@
+#include "BlockCompression.h"
+#include "ImageKernels.h"
+#include <core/system/parallel.h>
+#include <core/util/assert.h>
+#include <cmath>
+#include <cstring>
+
+namespace sn
+{
+
+namespace
+{
+    //--------------------------------------------------------------------------
+    // Block pixels are gathered as 16 RGBA texels, in rows of 4
+    void loadBlock(const u8 * pixels, u32 width, u32 height, u32 channelCount, u32 bx, u32 by, u8 out_texels[64])
+    {
+        for (u32 j = 0; j < 4; ++j)
+        {
+            u32 y = by * 4 + j;
+            if (y >= height)
+                y = height - 1;
+            for (u32 i = 0; i < 4; ++i)
+            {
+                u32 x = bx * 4 + i;
+                if (x >= width)
+                    x = width - 1;
+                const u8 * p = pixels + (x + y * width) * channelCount;
+                u8 * t = out_texels + (i + j * 4) * 4;
+                t[0] = p[0];
+                t[1] = channelCount > 1 ? p[1] : 0;
+                t[2] = channelCount > 2 ? p[2] : 0;
+                t[3] = channelCount > 3 ? p[3] : 255;
+            }
+        }
+    }
+
+    inline void writeU16(u8 * p, u32 v) { p[0] = v & 0xff; p[1] = (v >> 8) & 0xff; }
+    inline u32 readU16(const u8 * p) { return p[0] | (p[1] << 8); }
+
+    //--------------------------------------------------------------------------
+    // Colors
+    //--------------------------------------------------------------------------
+
+    inline u32 packRGB565(const f32 c[3])
+    {
+        s32 r = static_cast<s32>(c[0] * (31.f / 255.f) + 0.5f);
+        s32 g = static_cast<s32>(c[1] * (63.f / 255.f) + 0.5f);
+        s32 b = static_cast<s32>(c[2] * (31.f / 255.f) + 0.5f);
+        r = r < 0 ? 0 : (r > 31 ? 31 : r);
+        g = g < 0 ? 0 : (g > 63 ? 63 : g);
+        b = b < 0 ? 0 : (b > 31 ? 31 : b);
+        return (r << 11) | (g << 5) | b;
+    }
+
+    inline void unpackRGB565(u32 v, s32 out_color[3])
+    {
+        s32 r = (v >> 11) & 31;
+        s32 g = (v >> 5) & 63;
+        s32 b = v & 31;
+        out_color[0] = (r << 3) | (r >> 2);
+        out_color[1] = (g << 2) | (g >> 4);
+        out_color[2] = (b << 3) | (b >> 2);
+    }
+
+    /// \brief Computes the colors endpoints can be interpolated to.
+    /// \param fourColors: false for the BC1 mode where the last color is transparent black
+    void getColorPalette(u32 c0, u32 c1, bool fourColors, s32 out_palette[4][4])
+    {
+        unpackRGB565(c0, out_palette[0]);
+        unpackRGB565(c1, out_palette[1]);
+        out_palette[0][3] = 255;
+        out_palette[1][3] = 255;
+        for (u32 c = 0; c < 3; ++c)
+        {
+            s32 a = out_palette[0][c];
+            s32 b = out_palette[1][c];
+            if (fourColors)
+            {
+                out_palette[2][c] = (2 * a + b) / 3;
+                out_palette[3][c] = (a + 2 * b) / 3;
+            }
+            else
+            {
+                out_palette[2][c] = (a + b) / 2;
+                out_palette[3][c] = 0;
+            }
+        }
+        out_palette[2][3] = 255;
+        out_palette[3][3] = fourColors ? 255 : 0;
+    }
+
+    /// \brief Picks the nearest palette color for each texel
+    /// \return squared error of the block
+    u32 fitColorIndexes(const u8 texels[64], u32 c0, u32 c1, u32 & out_indexes)
+    {
+        s32 palette[4][4];
+        getColorPalette(c0, c1, true, palette);
+
+        u32 error = 0;
+        out_indexes = 0;
+        for (u32 i = 0; i < 16; ++i)
+        {
+            const u8 * t = texels + i * 4;
+            u32 best = 0;
+            u32 bestDistance = 0xffffffff;
+            for (u32 k = 0; k < 4; ++k)
+            {
+                s32 dr = palette[k][0] - t[0];
+                s32 dg = palette[k][1] - t[1];
+                s32 db = palette[k][2] - t[2];
+                u32 d = dr * dr + dg * dg + db * db;
+                if (d < bestDistance)
+                {
+                    bestDistance = d;
+                    best = k;
+                }
+            }
+            error += bestDistance;
+            out_indexes |= best << (2 * i);
+        }
+        return error;
+    }
+
+    /// \brief Computes endpoints minimizing the error of the given indexes
+    /// \return false if indexes don't give a solvable system, such as when they are all the same
+    bool solveColorEndpoints(const u8 texels[64], u32 indexes, f32 out_a[3], f32 out_b[3])
+    {
+        // Weight of the second endpoint for each index
+        const f32 weights[4] = { 0.f, 1.f, 1.f / 3.f, 2.f / 3.f };
+
+        f32 aa = 0.f, ab = 0.f, bb = 0.f;
+        f32 ax[3] = { 0.f, 0.f, 0.f };
+        f32 bx[3] = { 0.f, 0.f, 0.f };
+        for (u32 i = 0; i < 16; ++i)
+        {
+            f32 t = weights[(indexes >> (2 * i)) & 3];
+            f32 s = 1.f - t;
+            aa += s * s;
+            ab += s * t;
+            bb += t * t;
+            for (u32 c = 0; c < 3; ++c)
+            {
+                ax[c] += s * texels[i * 4 + c];
+                bx[c] += t * texels[i * 4 + c];
+            }
+        }
+
+        f32 det = aa * bb - ab * ab;
+        if (std::fabs(det) < 1e-6f)
+            return false;
+        f32 invDet = 1.f / det;
+        for (u32 c = 0; c < 3; ++c)
+        {
+            out_a[c] = (bb * ax[c] - ab * bx[c]) * invDet;
+            out_b[c] = (aa * bx[c] - ab * ax[c]) * invDet;
+        }
+        return true;
+    }
+
+    void findColorEndpoints(const u8 texels[64], BlockQuality quality, f32 out_a[3], f32 out_b[3])
+    {
+        if (quality == SN_BLOCK_QUALITY_FAST)
+        {
+            // Bounding box, inset a bit because extremes are rarely the best endpoints
+            for (u32 c = 0; c < 3; ++c)
+            {
+                f32 minV = 255.f;
+                f32 maxV = 0.f;
+                for (u32 i = 0; i < 16; ++i)
+                {
+                    f32 v = texels[i * 4 + c];
+                    minV = v < minV ? v : minV;
+                    maxV = v > maxV ? v : maxV;
+                }
+                f32 inset = (maxV - minV) / 16.f;
+                out_a[c] = maxV - inset;
+                out_b[c] = minV + inset;
+            }
+            return;
+        }
+
+        // Principal axis of the colors, from the covariance matrix
+        f32 mean[3] = { 0.f, 0.f, 0.f };
+        for (u32 i = 0; i < 16; ++i)
+        {
+            for (u32 c = 0; c < 3; ++c)
+                mean[c] += texels[i * 4 + c];
+        }
+        for (u32 c = 0; c < 3; ++c)
+            mean[c] /= 16.f;
+
+        f32 cov[6] = { 0.f, 0.f, 0.f, 0.f, 0.f, 0.f };
+        for (u32 i = 0; i < 16; ++i)
+        {
+            f32 r = texels[i * 4] - mean[0];
+            f32 g = texels[i * 4 + 1] - mean[1];
+            f32 b = texels[i * 4 + 2] - mean[2];
+            cov[0] += r * r;
+            cov[1] += r * g;
+            cov[2] += r * b;
+            cov[3] += g * g;
+            cov[4] += g * b;
+            cov[5] += b * b;
+        }
+
+        // Power iteration converges quickly on such small matrices
+        f32 axis[3] = { 1.f, 1.f, 1.f };
+        for (u32 k = 0; k < 8; ++k)
+        {
+            f32 x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+            f32 y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+            f32 z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+            f32 len = std::sqrt(x * x + y * y + z * z);
+            if (len < 1e-6f)
+                break;
+            axis[0] = x / len;
+            axis[1] = y / len;
+            axis[2] = z / len;
+        }
+
+        f32 minT = 0.f;
+        f32 maxT = 0.f;
+        for (u32 i = 0; i < 16; ++i)
+        {
+            f32 t = (texels[i * 4] - mean[0]) * axis[0]
+                + (texels[i * 4 + 1] - mean[1]) * axis[1]
+                + (texels[i * 4 + 2] - mean[2]) * axis[2];
+            minT = t < minT ? t : minT;
+            maxT = t > maxT ? t : maxT;
+        }
+        for (u32 c = 0; c < 3; ++c)
+        {
+            out_a[c] = mean[c] + axis[c] * maxT;
+            out_b[c] = mean[c] + axis[c] * minT;
+        }
+    }
+
+    void encodeColorBlock(const u8 texels[64], BlockQuality quality, u8 * out_block)
+    {
+        f32 a[3], b[3];
+        findColorEndpoints(texels, quality, a, b);
+        u32 c0 = packRGB565(a);
+        u32 c1 = packRGB565(b);
+
+        u32 indexes = 0;
+        u32 error = fitColorIndexes(texels, c0, c1, indexes);
+
+        if (quality == SN_BLOCK_QUALITY_HIGH)
+        {
+            // Endpoints fitting the chosen indexes best may give other indexes, iterate a few times
+            for (u32 k = 0; k < 2 && error > 0; ++k)
+            {
+                if (!solveColorEndpoints(texels, indexes, a, b))
+                    break;
+                u32 n0 = packRGB565(a);
+                u32 n1 = packRGB565(b);
+                u32 newIndexes = 0;
+                u32 newError = fitColorIndexes(texels, n0, n1, newIndexes);
+                if (newError >= error)
+                    break;
+                c0 = n0;
+                c1 = n1;
+                indexes = newIndexes;
+                error = newError;
+            }
+        }
+
+        // The first endpoint must be greater for the four colors mode
+        if (c0 < c1)
+        {
+            u32 t = c0;
+            c0 = c1;
+            c1 = t;
+            // Swap 0 <-> 1 and 2 <-> 3
+            indexes ^= 0x55555555;
+        }
+        else if (c0 == c1)
+        {
+            indexes = 0;
+        }
+
+        writeU16(out_block, c0);
+        writeU16(out_block + 2, c1);
+        out_block[4] = indexes & 0xff;
+        out_block[5] = (indexes >> 8) & 0xff;
+        out_block[6] = (indexes >> 16) & 0xff;
+        out_block[7] = (indexes >> 24) & 0xff;
+    }
+
+    void decodeColorBlock(const u8 * block, bool allowThreeColors, u8 out_texels[64])
+    {
+        u32 c0 = readU16(block);
+        u32 c1 = readU16(block + 2);
+        u32 indexes = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<u32>(block[7]) << 24);
+
+        s32 palette[4][4];
+        getColorPalette(c0, c1, !allowThreeColors || c0 > c1, palette);
+
+        for (u32 i = 0; i < 16; ++i)
+        {
+            const s32 * c = palette[(indexes >> (2 * i)) & 3];
+            u8 * t = out_texels + i * 4;
+            t[0] = static_cast<u8>(c[0]);
+            t[1] = static_cast<u8>(c[1]);
+            t[2] = static_cast<u8>(c[2]);
+            t[3] = static_cast<u8>(c[3]);
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    // Single channels (BC3 alpha, BC4, BC5)
+    //--------------------------------------------------------------------------
+
+    void getChannelPalette(u32 a0, u32 a1, s32 out_palette[8])
+    {
+        out_palette[0] = a0;
+        out_palette[1] = a1;
+        if (a0 > a1)
+        {
+            for (u32 k = 1; k < 7; ++k)
+                out_palette[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+        }
+        else
+        {
+            for (u32 k = 1; k < 5; ++k)
+                out_palette[k + 1] = ((5 - k) * a0 + k * a1) / 5;
+            out_palette[6] = 0;
+            out_palette[7] = 255;
+        }
+    }
+
+    /// \return squared error of the block
+    u32 fitChannelIndexes(const u8 values[16], u32 a0, u32 a1, u64 & out_indexes)
+    {
+        s32 palette[8];
+        getChannelPalette(a0, a1, palette);
+
+        u32 error = 0;
+        out_indexes = 0;
+        for (u32 i = 0; i < 16; ++i)
+        {
+            u32 best = 0;
+            u32 bestDistance = 0xffffffff;
+            for (u32 k = 0; k < 8; ++k)
+            {
+                s32 d = palette[k] - values[i];
+                u32 d2 = d * d;
+                if (d2 < bestDistance)
+                {
+                    bestDistance = d2;
+                    best = k;
+                }
+            }
+            error += bestDistance;
+            out_indexes |= static_cast<u64>(best) << (3 * i);
+        }
+        return error;
+    }
+
+    void encodeChannelBlock(const u8 texels[64], u32 channel, BlockQuality quality, u8 * out_block)
+    {
+        u8 values[16];
+        u32 minV = 255, maxV = 0;
+        // Range without the values the 6 values mode stores exactly
+        u32 minInner = 255, maxInner = 0;
+        for (u32 i = 0; i < 16; ++i)
+        {
+            u32 v = texels[i * 4 + channel];
+            values[i] = static_cast<u8>(v);
+            minV = v < minV ? v : minV;
+            maxV = v > maxV ? v : maxV;
+            if (v != 0 && v != 255)
+            {
+                minInner = v < minInner ? v : minInner;
+                maxInner = v > maxInner ? v : maxInner;
+            }
+        }
+
+        // 8 values mode
+        u32 a0 = maxV;
+        u32 a1 = minV;
+        u64 indexes = 0;
+        u32 error = fitChannelIndexes(values, a0, a1, indexes);
+
+        if (quality == SN_BLOCK_QUALITY_HIGH && error > 0 && maxV > minV)
+        {
+            // Endpoints a little inside the range often interpolate better
+            const s32 range = 2;
+            for (s32 d0 = -range; d0 <= 0; ++d0)
+            {
+                for (s32 d1 = 0; d1 <= range; ++d1)
+                {
+                    s32 n0 = static_cast<s32>(maxV) + d0;
+                    s32 n1 = static_cast<s32>(minV) + d1;
+                    if (n0 <= n1 || (d0 == 0 && d1 == 0))
+                        continue;
+                    u64 newIndexes = 0;
+                    u32 newError = fitChannelIndexes(values, n0, n1, newIndexes);
+                    if (newError < error)
+                    {
+                        a0 = n0;
+                        a1 = n1;
+                        indexes = newIndexes;
+                        error = newError;
+                    }
+                }
+            }
+        }
+
+        // 6 values mode, where 0 and 255 are exact, for blocks with fully transparent or opaque texels
+        if (quality != SN_BLOCK_QUALITY_FAST && error > 0 && (minV == 0 || maxV == 255))
+        {
+            u32 n0 = minInner <= maxInner ? minInner : 0;
+            u32 n1 = minInner <= maxInner ? maxInner : 255;
+            u64 newIndexes = 0;
+            u32 newError = fitChannelIndexes(values, n0, n1, newIndexes);
+            if (newError < error)
+            {
+                a0 = n0;
+                a1 = n1;
+                indexes = newIndexes;
+                error = newError;
+            }
+        }
+
+        out_block[0] = static_cast<u8>(a0);
+        out_block[1] = static_cast<u8>(a1);
+        for (u32 k = 0; k < 6; ++k)
+            out_block[2 + k] = static_cast<u8>((indexes >> (8 * k)) & 0xff);
+    }
+
+    void decodeChannelBlock(const u8 * block, u32 channel, u8 out_texels[64])
+    {
+        s32 palette[8];
+        getChannelPalette(block[0], block[1], palette);
+
+        u64 indexes = 0;
+        for (u32 k = 0; k < 6; ++k)
+            indexes |= static_cast<u64>(block[2 + k]) << (8 * k);
+
+        for (u32 i = 0; i < 16; ++i)
+            out_texels[i * 4 + channel] = static_cast<u8>(palette[(indexes >> (3 * i)) & 7]);
+    }
+
+} // anonymous namespace
+
+//------------------------------------------------------------------------------
+void compressBlocks(
+    const u8 * pixels, u32 width, u32 height, u32 channelCount,
+    BlockFormat format, BlockQuality quality,
+    u8 * out_blocks,
+    u32 threadCount)
+{
+    SN_ASSERT(pixels != nullptr && out_blocks != nullptr, "Received null pixels");
+    SN_ASSERT(channelCount >= 1 && channelCount <= 4, "Invalid channel count " << channelCount);
+    SN_ASSERT((format != SN_BLOCK_BC1 && format != SN_BLOCK_BC3) || channelCount >= 3, "Color blocks need RGB pixels");
+    SN_ASSERT(format != SN_BLOCK_BC5 || channelCount >= 2, "BC5 needs two channels");
+    if (width == 0 || height == 0)
+        return;
+
+    const u32 blockCountX = (width + 3) / 4;
+    const u32 blockCountY = (height + 3) / 4;
+    const u32 blockSize = getBlockSize(format);
+
+    parallelFor(blockCountY, getImageThreadCount(width * height, threadCount), [=](u32 begin, u32 end)
+    {
+        u8 texels[64];
+        for (u32 by = begin; by < end; ++by)
+        {
+            u8 * out = out_blocks + by * blockCountX * blockSize;
+            for (u32 bx = 0; bx < blockCountX; ++bx, out += blockSize)
+            {
+                loadBlock(pixels, width, height, channelCount, bx, by, texels);
+                switch (format)
+                {
+                case SN_BLOCK_BC1:
+                    encodeColorBlock(texels, quality, out);
+                    break;
+                case SN_BLOCK_BC3:
+                    encodeChannelBlock(texels, 3, quality, out);
+                    encodeColorBlock(texels, quality, out + 8);
+                    break;
+                case SN_BLOCK_BC4:
+                    encodeChannelBlock(texels, 0, quality, out);
+                    break;
+                case SN_BLOCK_BC5:
+                    encodeChannelBlock(texels, 0, quality, out);
+                    encodeChannelBlock(texels, 1, quality, out + 8);
+                    break;
+                }
+            }
+        }
+    });
+}
+
+//------------------------------------------------------------------------------
+void decompressBlocks(
+    const u8 * blocks, u32 width, u32 height,
+    BlockFormat format,
+    u8 * out_pixels)
+{
+    SN_ASSERT(blocks != nullptr && out_pixels != nullptr, "Received null blocks");
+
+    const u32 blockCountX = (width + 3) / 4;
+    const u32 blockCountY = (height + 3) / 4;
+    const u32 blockSize = getBlockSize(format);
+    const u32 channelCount = getBlockChannelCount(format);
+
+    u8 texels[64];
+    for (u32 by = 0; by < blockCountY; ++by)
+    {
+        for (u32 bx = 0; bx < blockCountX; ++bx)
+        {
+            const u8 * block = blocks + (bx + by * blockCountX) * blockSize;
+            switch (format)
+            {
+            case SN_BLOCK_BC1:
+                decodeColorBlock(block, true, texels);
+                break;
+            case SN_BLOCK_BC3:
+                // Color blocks of BC3 always have four colors
+                decodeColorBlock(block + 8, false, texels);
+                decodeChannelBlock(block, 3, texels);
+                break;
+            case SN_BLOCK_BC4:
+                decodeChannelBlock(block, 0, texels);
+                break;
+            case SN_BLOCK_BC5:
+                decodeChannelBlock(block, 0, texels);
+                decodeChannelBlock(block + 8, 1, texels);
+                break;
+            }
+
+            // Texels out of the image are dropped
+            for (u32 j = 0; j < 4 && by * 4 + j < height; ++j)
+            {
+                for (u32 i = 0; i < 4 && bx * 4 + i < width; ++i)
+                {
+                    const u8 * t = texels + (i + j * 4) * 4;
+                    u8 * p = out_pixels + ((bx * 4 + i) + (by * 4 + j) * width) * channelCount;
+                    for (u32 c = 0; c < channelCount; ++c)
+                        p[c] = t[c];
+                }
+            }
+        }
+    }
+}
+
+} // namespace sn
+
@@ -0,0 +1,80 @@
+#ifndef __HEADER_SN_BLOCKCOMPRESSION__
+#define __HEADER_SN_BLOCKCOMPRESSION__
+
+#include <core/types.h>
+
+namespace sn
+{
+
+/// \brief GPU formats storing pixels as independently compressed blocks of 4x4 pixels
+enum BlockFormat
+{
+    /// \brief Opaque RGB, 8 bytes per block (DXT1)
+    SN_BLOCK_BC1 = 0,
+    /// \brief RGB with smooth alpha, 16 bytes per block (DXT5)
+    SN_BLOCK_BC3,
+    /// \brief Single channel, 8 bytes per block, such as height or roughness maps
+    SN_BLOCK_BC4,
+    /// \brief Two channels, 16 bytes per block, such as normal maps
+    SN_BLOCK_BC5
+};
+
+/// \brief Trade-offs between encoding time and quality
+enum BlockQuality
+{
+    /// \brief Endpoints from the bounding box of block colors
+    SN_BLOCK_QUALITY_FAST = 0,
+    /// \brief Endpoints along the principal axis of block colors
+    SN_BLOCK_QUALITY_NORMAL,
+    /// \brief Endpoints refined by least squares, and more alpha modes tried
+    SN_BLOCK_QUALITY_HIGH
+};
+
+/// \brief Gets the number of bytes of a 4x4 block
+inline u32 getBlockSize(BlockFormat format)
+{
+    return format == SN_BLOCK_BC1 || format == SN_BLOCK_BC4 ? 8 : 16;
+}
+
+/// \brief Gets the number of components of decompressed pixels
+inline u32 getBlockChannelCount(BlockFormat format)
+{
+    switch (format)
+    {
+    case SN_BLOCK_BC4: return 1;
+    case SN_BLOCK_BC5: return 2;
+    default: return 4;
+    }
+}
+
+/// \brief Gets the number of bytes of an image compressed in the given format.
+/// Sizes that are not multiples of 4 are rounded up to whole blocks.
+inline u32 getCompressedSize(BlockFormat format, u32 width, u32 height)
+{
+    return ((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+}
+
+/// \brief Compresses pixels made of interleaved 8-bit components.
+/// BC1 and BC3 take RGBA pixels (BC1 ignores alpha), BC4 takes the first component, BC5 the first two.
+/// Pixels out of the image in partial blocks repeat the edges.
+/// Rows of blocks are split across threads on big images.
+/// \param out_blocks: getCompressedSize() bytes
+void compressBlocks(
+    const u8 * pixels, u32 width, u32 height, u32 channelCount,
+    BlockFormat format, BlockQuality quality,
+    u8 * out_blocks,
+    u32 threadCount
+);
+
+/// \brief Decompresses blocks as a GPU would, so compression can be checked without one.
+/// \param out_pixels: width * height pixels of getBlockChannelCount() components
+void decompressBlocks(
+    const u8 * blocks, u32 width, u32 height,
+    BlockFormat format,
+    u8 * out_pixels
+);
+
+} // namespace sn
+
+#endif // __HEADER_SN_BLOCKCOMPRESSION__
+
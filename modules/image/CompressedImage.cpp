@@ -0,0 +1,203 @@
+#include "CompressedImage.h"
+#include "Image.h"
+#include <core/util/Log.h>
+#include <cstring>
+#include <fstream>
+
+namespace sn
+{
+
+namespace
+{
+    const char CACHE_MAGIC[4] = { 'S', 'N', 'B', 'C' };
+    const u32 CACHE_VERSION = 1;
+
+    struct CacheHeader
+    {
+        char magic[4];
+        u32 version;
+        u64 sourceHash;
+        u32 format;
+        u32 width;
+        u32 height;
+        u32 levelCount;
+    };
+}
+
+//------------------------------------------------------------------------------
+u64 hashBytes(const void * data, size_t size, u64 seed)
+{
+    const u8 * bytes = static_cast<const u8*>(data);
+    u64 hash = seed;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+//------------------------------------------------------------------------------
+CompressedImage::CompressedImage() :
+    m_format(SN_BLOCK_BC1)
+{
+}
+
+//------------------------------------------------------------------------------
+bool CompressedImage::compress(const Image & image, BlockFormat format, BlockQuality quality, u32 threadCount)
+{
+    clear();
+
+    PixelFormat pixelFormat = image.getPixelFormat();
+    u32 channelCount = image.getChannelCount();
+    if (!hasByteChannels(pixelFormat) || pixelFormat == SN_IMAGE_ALPHA8)
+    {
+        SN_ERROR("CompressedImage::compress: pixel format " << pixelFormat << " can't be compressed");
+        return false;
+    }
+    if ((format == SN_BLOCK_BC1 || format == SN_BLOCK_BC3) && channelCount < 3)
+    {
+        SN_ERROR("CompressedImage::compress: color block formats need RGBA images");
+        return false;
+    }
+    if (format == SN_BLOCK_BC5 && channelCount < 2)
+    {
+        SN_ERROR("CompressedImage::compress: BC5 needs two channels");
+        return false;
+    }
+
+    m_format = format;
+    m_size = image.getSize();
+
+    m_levels.resize(image.getMipmapCount());
+    for (u32 level = 0; level < m_levels.size(); ++level)
+    {
+        Vector2u size = image.getMipmapSize(level);
+        std::vector<u8> & blocks = m_levels[level];
+        blocks.resize(getCompressedSize(format, size.x(), size.y()));
+        if (!blocks.empty())
+        {
+            compressBlocks(image.getMipmapPixelsPtr(level), size.x(), size.y(), channelCount,
+                format, quality, &blocks[0], threadCount);
+        }
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void CompressedImage::decompress(Image & out_image) const
+{
+    PixelFormat pixelFormat = SN_IMAGE_RGBA32;
+    if (m_format == SN_BLOCK_BC4)
+        pixelFormat = SN_IMAGE_R8;
+    else if (m_format == SN_BLOCK_BC5)
+        pixelFormat = SN_IMAGE_RG16;
+
+    if (m_levels.empty())
+    {
+        out_image.clear();
+        return;
+    }
+
+    std::vector<u8> pixels(m_size.x() * m_size.y() * getBlockChannelCount(m_format));
+    if (!pixels.empty())
+        decompressBlocks(&m_levels[0][0], m_size.x(), m_size.y(), m_format, &pixels[0]);
+    out_image.loadFromPixels(m_size, pixelFormat, pixels.empty() ? nullptr : &pixels[0]);
+}
+
+//------------------------------------------------------------------------------
+void CompressedImage::clear()
+{
+    m_levels.clear();
+    m_size = Vector2u(0, 0);
+}
+
+//------------------------------------------------------------------------------
+Vector2u CompressedImage::getMipmapSize(u32 level) const
+{
+    u32 x = m_size.x() >> level;
+    u32 y = m_size.y() >> level;
+    return Vector2u(x > 0 ? x : 1, y > 0 ? y : 1);
+}
+
+//------------------------------------------------------------------------------
+u32 CompressedImage::getDataLength() const
+{
+    u32 len = 0;
+    for (u32 i = 0; i < m_levels.size(); ++i)
+        len += m_levels[i].size();
+    return len;
+}
+
+//------------------------------------------------------------------------------
+bool CompressedImage::saveToFile(const String & filePath, u64 sourceHash) const
+{
+    std::ofstream ofs(filePath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!ofs.good())
+    {
+        SN_WERROR(L"Couldn't write compressed image to " << filePath);
+        return false;
+    }
+
+    CacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.sourceHash = sourceHash;
+    header.format = m_format;
+    header.width = m_size.x();
+    header.height = m_size.y();
+    header.levelCount = m_levels.size();
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for (u32 i = 0; i < m_levels.size(); ++i)
+    {
+        if (!m_levels[i].empty())
+            ofs.write(reinterpret_cast<const char*>(&m_levels[i][0]), m_levels[i].size());
+    }
+    return ofs.good();
+}
+
+//------------------------------------------------------------------------------
+bool CompressedImage::loadFromFile(const String & filePath, u64 sourceHash)
+{
+    clear();
+
+    std::ifstream ifs(filePath.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs.good())
+        return false;
+
+    CacheHeader header;
+    ifs.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!ifs.good()
+        || memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+        || header.version != CACHE_VERSION
+        || header.sourceHash != sourceHash
+        || header.format > SN_BLOCK_BC5
+        || header.levelCount > 32)
+    {
+        return false;
+    }
+
+    m_format = static_cast<BlockFormat>(header.format);
+    m_size = Vector2u(header.width, header.height);
+    m_levels.resize(header.levelCount);
+    for (u32 i = 0; i < m_levels.size(); ++i)
+    {
+        Vector2u size = getMipmapSize(i);
+        std::vector<u8> & blocks = m_levels[i];
+        blocks.resize(getCompressedSize(m_format, size.x(), size.y()));
+        if (!blocks.empty())
+            ifs.read(reinterpret_cast<char*>(&blocks[0]), blocks.size());
+    }
+
+    if (!ifs.good())
+    {
+        SN_WARNING("Compressed image file is truncated");
+        clear();
+        return false;
+    }
+    return true;
+}
+
+} // namespace sn
+
@@ -0,0 +1,63 @@
+#ifndef __HEADER_SN_COMPRESSEDIMAGE__
+#define __HEADER_SN_COMPRESSEDIMAGE__
+
+#include <core/math/Vector2.h>
+#include <core/util/String.h>
+
+#include <modules/image/common.h>
+#include <modules/image/BlockCompression.h>
+#include <vector>
+
+namespace sn
+{
+
+class Image;
+
+/// \brief Computes a 64-bit FNV-1a hash of bytes.
+/// Pass the previous result as seed to hash several buffers as one.
+SN_IMAGE_API u64 hashBytes(const void * data, size_t size, u64 seed = 14695981039346656037ULL);
+
+/// \brief Mipmap levels of an image compressed in a GPU block format, ready to be uploaded.
+/// Compression is slow, so results are meant to be saved in a cache and loaded back
+/// as long as the hash of their source doesn't change.
+class SN_IMAGE_API CompressedImage
+{
+public:
+    CompressedImage();
+
+    /// \brief Compresses an image and all its mipmaps.
+    /// \return false if the pixel format can't be compressed in the requested format
+    bool compress(const Image & image, BlockFormat format, BlockQuality quality, u32 threadCount);
+
+    /// \brief Decompresses the first level into an image, as a GPU would see it
+    void decompress(Image & out_image) const;
+
+    void clear();
+
+    /// \brief Saves compressed levels to a file, along with the hash of what they were made from
+    bool saveToFile(const String & filePath, u64 sourceHash) const;
+
+    /// \brief Loads compressed levels from a file.
+    /// \return false if the file doesn't exist, is invalid, or was made from another source
+    bool loadFromFile(const String & filePath, u64 sourceHash);
+
+    BlockFormat getFormat() const { return m_format; }
+    Vector2u getSize() const { return m_size; }
+
+    u32 getMipmapCount() const { return m_levels.size(); }
+    Vector2u getMipmapSize(u32 level) const;
+    const std::vector<u8> & getMipmapBlocks(u32 level) const { return m_levels[level]; }
+
+    /// \brief Gets the number of bytes of all levels
+    u32 getDataLength() const;
+
+private:
+    BlockFormat m_format;
+    Vector2u m_size;
+    std::vector< std::vector<u8> > m_levels;
+};
+
+} // namespace sn
+
+#endif // __HEADER_SN_COMPRESSEDIMAGE__
+
@@ -1,4 +1,7 @@
 #include "Image.h"
+#include <core/util/Log.h>
+#include <core/system/Thread.h>
+#include <cstdlib>
 
 namespace sn
 {
@@ -13,6 +16,12 @@ Image::Image() : Asset(),
 {
 }
 
+//------------------------------------------------------------------------------
+u32 Image::getDefaultThreadCount()
+{
+    return Thread::getHardwareConcurrency();
+}
+
 //------------------------------------------------------------------------------
 Image::~Image()
 {
@@ -29,22 +38,23 @@ void Image::create(Vector2u size, PixelFormat format, Color8 defaultColor)
 //------------------------------------------------------------------------------
 void Image::createNoFill(Vector2u size, PixelFormat format)
 {
-    SN_ASSERT(format == SN_IMAGE_RGBA32, "Image format not supported yet");
     if (m_size != size || m_pixelData == nullptr || m_pixelFormat != format)
     {
         clear();
         m_pixelFormat = format;
         m_size = size;
         u32 len = getDataLength();
-        m_pixelData = new u8[sizeof(u8) * len];
+        m_pixelData = static_cast<u8*>(malloc(len));
+    }
+    else
+    {
+        clearMipmaps();
     }
 }
 
 //------------------------------------------------------------------------------
 void Image::loadFromPixels(Vector2u size, PixelFormat format, const u8 * pixelData)
 {
-    SN_ASSERT(format == SN_IMAGE_RGBA32, "Image format not supported yet");
-
     clear();
     m_pixelFormat = format;
     m_size = size;
@@ -53,20 +63,30 @@ void Image::loadFromPixels(Vector2u size, PixelFormat format, const u8 * pixelDa
 
     if (len)
     {
-        m_pixelData = new u8[sizeof(u8)* len];
+        m_pixelData = static_cast<u8*>(malloc(len));
         memcpy(m_pixelData, pixelData, len);
     }
 }
 
+//------------------------------------------------------------------------------
+void Image::adoptPixels(Vector2u size, PixelFormat format, u8 * pixelData)
+{
+    clear();
+    m_pixelFormat = format;
+    m_size = size;
+    m_pixelData = pixelData;
+}
+
 //------------------------------------------------------------------------------
 void Image::clear()
 {
     if (m_pixelData)
     {
-        delete[] m_pixelData;
+        free(m_pixelData);
         m_pixelData = nullptr;
     }
     m_size = Vector2u(0, 0);
+    clearMipmaps();
 }
 
 //------------------------------------------------------------------------------
@@ -74,8 +94,9 @@ bool Image::getPixel(u32 x, u32 y, Color8 & out_color) const
 {
     if (x < m_size.x() && y < m_size.y() && m_pixelData)
     {
-        const u8 * p = &m_pixelData[getPixelIndex(x, y)];
-        out_color.set(p[0], p[1], p[2], p[3]);
+        u8 rgba[4];
+        convertPixels(&m_pixelData[getPixelIndex(x, y)], m_pixelFormat, rgba, SN_IMAGE_RGBA32, 1);
+        out_color.set(rgba[0], rgba[1], rgba[2], rgba[3]);
         return true;
     }
     return false;
@@ -86,11 +107,8 @@ bool Image::setPixel(u32 x, u32 y, Color8 c)
 {
     if (x < m_size.x() && y < m_size.y() && m_pixelData)
     {
-        u8 * p = &m_pixelData[getPixelIndex(x, y)];
-        p[0] = c.r;
-        p[1] = c.g;
-        p[2] = c.b;
-        p[3] = c.a;
+        const u8 rgba[4] = { c.r, c.g, c.b, c.a };
+        convertPixels(rgba, SN_IMAGE_RGBA32, &m_pixelData[getPixelIndex(x, y)], m_pixelFormat, 1);
         return true;
     }
     return false;
@@ -101,27 +119,25 @@ void Image::fill(Color8 color)
 {
     if (m_pixelData)
     {
-        if (color.r == color.g && 
-            color.r == color.b && 
-            color.r == color.a)
+        const u8 rgba[4] = { color.r, color.g, color.b, color.a };
+        u8 pixel[4];
+        convertPixels(rgba, SN_IMAGE_RGBA32, pixel, m_pixelFormat, 1);
+
+        const u32 pixelSize = getPixelSize(m_pixelFormat);
+        bool uniform = true;
+        for (u32 i = 1; i < pixelSize; ++i)
+            uniform &= pixel[i] == pixel[0];
+
+        if (uniform)
         {
-            // Optimization: if all components are equal, use memset
-            memset(m_pixelData, color.r, getDataLength());
+            // Optimization: if all bytes are equal, use memset
+            memset(m_pixelData, pixel[0], getDataLength());
         }
         else
         {
             u32 pixelCount = m_size.x() * m_size.y();
-            if (pixelCount)
-            {
-                for (u32 i = 0; i < pixelCount; ++i)
-                {
-                    u32 j = i * 4;
-                    m_pixelData[j++] = color.r;
-                    m_pixelData[j++] = color.g;
-                    m_pixelData[j++] = color.b;
-                    m_pixelData[j++] = color.a;
-                }
-            }
+            for (u32 i = 0; i < pixelCount; ++i)
+                memcpy(m_pixelData + i * pixelSize, pixel, pixelSize);
         }
     }
 }
@@ -182,18 +198,129 @@ void Image::pasteSubImage(const u8 * pixels, s32 x, s32 y, u32 w, u32 h, PixelFo
     //}
 
     // Copy row by row (much faster)
+    const u32 pixelSize = getPixelSize(m_pixelFormat);
     for (u32 srcY = 0; srcY < h; ++srcY)
     {
-        size_t src_i = (srcY * w) * 4;
+        size_t src_i = (srcY * w) * pixelSize;
         size_t dst_i = getPixelIndex(x, y + srcY);
-        memcpy(m_pixelData + dst_i, pixels + src_i, w * 4);
+        memcpy(m_pixelData + dst_i, pixels + src_i, w * pixelSize);
+    }
+}
+
+//------------------------------------------------------------------------------
+void Image::convert(PixelFormat format)
+{
+    if (format == m_pixelFormat)
+        return;
+    clearMipmaps();
+    if (m_pixelData == nullptr)
+    {
+        m_pixelFormat = format;
+        return;
+    }
+
+    u32 pixelCount = m_size.x() * m_size.y();
+    u8 * pixels = static_cast<u8*>(malloc(pixelCount * getPixelSize(format)));
+    convertPixels(m_pixelData, m_pixelFormat, pixels, format, pixelCount);
+
+    free(m_pixelData);
+    m_pixelData = pixels;
+    m_pixelFormat = format;
+}
+
+//------------------------------------------------------------------------------
+void Image::premultiplyAlpha()
+{
+    if (m_pixelData && m_pixelFormat == SN_IMAGE_RGBA32)
+        sn::premultiplyAlpha(m_pixelData, m_size.x() * m_size.y());
+}
+
+//------------------------------------------------------------------------------
+void Image::resize(Vector2u size, ImageFilter filter, bool sRGB, u32 threadCount)
+{
+    if (!hasByteChannels(m_pixelFormat))
+    {
+        SN_ERROR("Image::resize: pixel format " << m_pixelFormat << " can't be filtered, convert it first");
+        return;
+    }
+    if (size == m_size)
+        return;
+    clearMipmaps();
+    if (m_pixelData == nullptr || size.x() == 0 || size.y() == 0)
+    {
+        createNoFill(size, m_pixelFormat);
+        return;
+    }
+
+    u8 * pixels = static_cast<u8*>(malloc(size.x() * size.y() * getPixelSize(m_pixelFormat)));
+    resample(m_pixelData, m_size.x(), m_size.y(), getChannelCount(), sRGB,
+        pixels, size.x(), size.y(), filter, threadCount);
+
+    free(m_pixelData);
+    m_pixelData = pixels;
+    m_size = size;
+}
+
+//------------------------------------------------------------------------------
+void Image::generateMipmaps(ImageFilter filter, bool sRGB, u32 threadCount)
+{
+    clearMipmaps();
+    if (m_pixelData == nullptr)
+        return;
+    if (!hasByteChannels(m_pixelFormat))
+    {
+        SN_ERROR("Image::generateMipmaps: pixel format " << m_pixelFormat << " can't be filtered, convert it first");
+        return;
+    }
+
+    const u32 channelCount = getChannelCount();
+    Vector2u size = m_size;
+    const u8 * pixels = m_pixelData;
+
+    while (size.x() > 1 || size.y() > 1)
+    {
+        // Each level is computed from the previous one, which is 4 times bigger at most
+        Mipmap level;
+        level.size = Vector2u(size.x() > 1 ? size.x() / 2 : 1, size.y() > 1 ? size.y() / 2 : 1);
+        level.pixels = new u8[level.size.x() * level.size.y() * channelCount];
+
+        if (filter == SN_IMAGE_FILTER_BOX)
+            downsampleBox(pixels, size.x(), size.y(), channelCount, sRGB, level.pixels, threadCount);
+        else
+            resample(pixels, size.x(), size.y(), channelCount, sRGB, level.pixels, level.size.x(), level.size.y(), filter, threadCount);
+
+        m_mipmaps.push_back(level);
+        size = level.size;
+        pixels = level.pixels;
     }
 }
 
+//------------------------------------------------------------------------------
+void Image::clearMipmaps()
+{
+    for (u32 i = 0; i < m_mipmaps.size(); ++i)
+        delete[] m_mipmaps[i].pixels;
+    m_mipmaps.clear();
+}
+
+//------------------------------------------------------------------------------
+Vector2u Image::getMipmapSize(u32 level) const
+{
+    SN_ASSERT(level < getMipmapCount(), "Invalid mipmap level " << level);
+    return level == 0 ? m_size : m_mipmaps[level - 1].size;
+}
+
+//------------------------------------------------------------------------------
+const u8 * Image::getMipmapPixelsPtr(u32 level) const
+{
+    SN_ASSERT(level < getMipmapCount(), "Invalid mipmap level " << level);
+    return level == 0 ? m_pixelData : m_mipmaps[level - 1].pixels;
+}
+
 //------------------------------------------------------------------------------
 Image & Image::operator=(const Image & other)
 {
-    if (m_size != other.m_size)
+    if (m_size != other.m_size || m_pixelFormat != other.m_pixelFormat)
     {
         createNoFill(other.m_size, other.m_pixelFormat);
     }
@@ -201,6 +328,17 @@ Image & Image::operator=(const Image & other)
     {
         memcpy(m_pixelData, other.m_pixelData, sizeof(u8)* getDataLength());
     }
+
+    clearMipmaps();
+    const u32 pixelSize = getPixelSize(m_pixelFormat);
+    for (u32 i = 0; i < other.m_mipmaps.size(); ++i)
+    {
+        Mipmap level = other.m_mipmaps[i];
+        u32 len = level.size.x() * level.size.y() * pixelSize;
+        level.pixels = new u8[len];
+        memcpy(level.pixels, other.m_mipmaps[i].pixels, len);
+        m_mipmaps.push_back(level);
+    }
     return *this;
 }
 
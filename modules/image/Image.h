@@ -5,21 +5,24 @@
 #include <core/math/Vector2.h>
 
 #include <modules/image/common.h>
+#include <modules/image/PixelFormat.h>
+#include <modules/image/ImageKernels.h>
+
+#include <vector>
 
 namespace sn
 {
 
-enum PixelFormat
-{
-    SN_IMAGE_RGBA32 = 0
-};
-
 /// \brief 2D container for pixel data, stored as 8 bit components.
 class SN_IMAGE_API Image : public Asset
 {
 public:
     SN_OBJECT
 
+    /// \brief Gets how many threads processing functions use by default on big images.
+    /// This is the number of hardware threads of the machine.
+    static u32 getDefaultThreadCount();
+
     /// \brief Constructs an empty image.
     Image();
     /// \brief Constructs an image as a copy of another
@@ -45,6 +48,14 @@ public:
         const u8 * pixelData
     );
 
+    /// \brief Sets the size and format of the image and takes ownership of given pixel data, without copying it.
+    /// \param pixelData: pixels allocated with malloc, such as the ones returned by decodeImage()
+    void adoptPixels(
+        Vector2u size,
+        PixelFormat format,
+        u8 * pixelData
+    );
+
     /// \brief Clears the image and resets its size to zero.
     void clear();
 
@@ -54,9 +65,8 @@ public:
     /// \brief Gets the pixel format of the image
     PixelFormat getPixelFormat() const { return m_pixelFormat; }
 
-    /// \brief Gets the number of components have pixels.
-    /// \note Only RGBA is supported at the moment, so this method always returns 4.
-    u32 getChannelCount() const { return 4; }
+    /// \brief Gets the number of components pixels have.
+    u32 getChannelCount() const { return sn::getChannelCount(m_pixelFormat); }
 
     /// \brief Gets the color of an individual pixel.
     /// \param x: X coordinate of the pixel
@@ -77,7 +87,7 @@ public:
     const u8 * getPixelsPtr() const { return m_pixelData; }
 
     /// \brief Gets the raw index of a pixel.
-    u32 getPixelIndex(u32 x, u32 y) const { return (x + m_size.x() * y) * getChannelCount(); }
+    u32 getPixelIndex(u32 x, u32 y) const { return (x + m_size.x() * y) * getPixelSize(m_pixelFormat); }
 
     /// \brief Fills the image with a color.
     void fill(Color8 color);
@@ -87,6 +97,32 @@ public:
     /// \brief Copies raw pixels into a sub-rectangle of the image.
     void pasteSubImage(const u8 * pixels, s32 x, s32 y, u32 w, u32 h, PixelFormat format);
 
+    //---------------------------------------
+    // Processing
+    //---------------------------------------
+
+    /// \brief Converts pixels to another format. Mipmaps are cleared.
+    void convert(PixelFormat format);
+
+    /// \brief Multiplies colors by alpha, so filtering and blending don't bleed the color of transparent pixels.
+    /// Only RGBA32 images have colors to premultiply.
+    void premultiplyAlpha();
+
+    /// \brief Changes the size of the image, interpolating its pixels. Mipmaps are cleared.
+    /// \param sRGB: if true, colors are filtered in linear space (see ImageKernels.h)
+    void resize(Vector2u size, ImageFilter filter = SN_IMAGE_FILTER_BILINEAR, bool sRGB = true, u32 threadCount = getDefaultThreadCount());
+
+    /// \brief Computes smaller versions of the image down to 1x1, each half the size of the previous one.
+    /// They are not updated when pixels change, generate them again instead.
+    void generateMipmaps(ImageFilter filter = SN_IMAGE_FILTER_BOX, bool sRGB = true, u32 threadCount = getDefaultThreadCount());
+
+    void clearMipmaps();
+
+    /// \brief Gets the number of mipmap levels, including the image itself as level 0
+    u32 getMipmapCount() const { return m_mipmaps.size() + 1; }
+    Vector2u getMipmapSize(u32 level) const;
+    const u8 * getMipmapPixelsPtr(u32 level) const;
+
     /// \brief Copies an image.
     Image & operator=(const Image & other);
 
@@ -94,13 +130,23 @@ private:
     ~Image();
 
     void createNoFill(Vector2u size, PixelFormat format);
-    u32 getDataLength() const { return m_size.x() * m_size.y() * getChannelCount(); }
+    u32 getDataLength() const { return m_size.x() * m_size.y() * getPixelSize(m_pixelFormat); }
 
 private:
+    struct Mipmap
+    {
+        Vector2u size;
+        u8 * pixels;
+    };
+
+    /// \brief Allocated with malloc, so buffers made by decoders can be adopted
     u8 * m_pixelData;
     Vector2u m_size;
     PixelFormat m_pixelFormat;
 
+    /// \brief Levels after the image itself, from the biggest to 1x1
+    std::vector<Mipmap> m_mipmaps;
+
 };
 
 } // namespace sn
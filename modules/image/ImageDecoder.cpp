@@ -0,0 +1,51 @@
+#include "ImageDecoder.h"
+#include "ImageKernels.h"
+#include <cstdlib>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stbi/stb_image.h"
+
+namespace sn
+{
+
+//------------------------------------------------------------------------------
+u8 * decodeImage(const u8 * data, u32 dataSize, u32 maxSize, bool sRGB, Vector2u & out_size)
+{
+    out_size = Vector2u(0, 0);
+
+    s32 width = 0;
+    s32 height = 0;
+    s32 channels = 0;
+    u8 * pixels = stbi_load_from_memory(data, static_cast<s32>(dataSize), &width, &height, &channels, STBI_rgb_alpha);
+    if (pixels == nullptr)
+        return nullptr;
+
+    u32 w = width;
+    u32 h = height;
+    if (maxSize > 0 && (w > maxSize || h > maxSize))
+    {
+        // A single thread can write each level over the previous one
+        while (w > maxSize || h > maxSize)
+        {
+            downsampleBox(pixels, w, h, 4, sRGB, pixels, 1);
+            w = w > 1 ? w / 2 : 1;
+            h = h > 1 ? h / 2 : 1;
+        }
+        // Give back what the full size image used
+        u8 * shrunk = static_cast<u8*>(realloc(pixels, w * h * 4));
+        if (shrunk)
+            pixels = shrunk;
+    }
+
+    out_size = Vector2u(w, h);
+    return pixels;
+}
+
+//------------------------------------------------------------------------------
+const char * getImageDecodeError()
+{
+    return stbi_failure_reason();
+}
+
+} // namespace sn
+
@@ -0,0 +1,25 @@
+#ifndef __HEADER_SN_IMAGEDECODER__
+#define __HEADER_SN_IMAGEDECODER__
+
+#include <core/math/Vector2.h>
+
+namespace sn
+{
+
+/// \brief Decodes a PNG, TGA or BMP file held in memory into RGBA32 pixels.
+/// PNG pixels are unfiltered where they were inflated, so the file and the result are
+/// the only big buffers alive during decoding. Pass a memory-mapped file to not copy it either.
+/// \param maxSize: if not zero, the image is halved in place until both sides fit in it,
+/// which makes thumbnails or low quality textures without a second buffer.
+/// \param sRGB: if true, colors are averaged in linear space when halving (see ImageKernels.h)
+/// \param out_size: size of the returned pixels
+/// \return pixels allocated with malloc, to be freed or adopted by an Image. nullptr if decoding failed.
+u8 * decodeImage(const u8 * data, u32 dataSize, u32 maxSize, bool sRGB, Vector2u & out_size);
+
+/// \brief Gets why the last decodeImage() failed
+const char * getImageDecodeError();
+
+} // namespace sn
+
+#endif // __HEADER_SN_IMAGEDECODER__
+
@@ -0,0 +1,505 @@
+#include "ImageKernels.h"
+#include <core/system/parallel.h>
+#include <core/util/assert.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace sn
+{
+
+namespace
+{
+    const u32 LINEAR_TO_SRGB_SIZE = 4096;
+
+    /// \brief Number of output rows resampled from the same block of horizontally filtered rows
+    const u32 BAND_ROWS = 64;
+
+    const f32 KAISER_WIDTH = 3.f;
+    const f64 KAISER_ALPHA = 4.0;
+
+    struct GammaTables
+    {
+        /// \brief Component values as they are
+        f32 identity[256];
+        /// \brief sRGB components to linear values
+        f32 toLinear[256];
+        /// \brief Linear values to sRGB components
+        u8 toSRGB[LINEAR_TO_SRGB_SIZE];
+
+        GammaTables()
+        {
+            for (u32 i = 0; i < 256; ++i)
+            {
+                f32 c = static_cast<f32>(i) / 255.f;
+                identity[i] = c;
+                toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            for (u32 i = 0; i < LINEAR_TO_SRGB_SIZE; ++i)
+            {
+                f32 l = static_cast<f32>(i) / static_cast<f32>(LINEAR_TO_SRGB_SIZE - 1);
+                f32 c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.f / 2.4f) - 0.055f;
+                toSRGB[i] = static_cast<u8>(c * 255.f + 0.5f);
+            }
+        }
+    };
+
+    // Built when the module is loaded, so kernels can use them from any thread
+    const GammaTables g_gamma;
+
+    inline u8 encodeLinear(f32 v)
+    {
+        s32 i = static_cast<s32>(v * 255.f + 0.5f);
+        return static_cast<u8>(i < 0 ? 0 : (i > 255 ? 255 : i));
+    }
+
+    inline u8 encodeSRGB(f32 v)
+    {
+        const s32 maxIndex = LINEAR_TO_SRGB_SIZE - 1;
+        s32 i = static_cast<s32>(v * static_cast<f32>(maxIndex) + 0.5f);
+        return g_gamma.toSRGB[i < 0 ? 0 : (i > maxIndex ? maxIndex : i)];
+    }
+
+    //--------------------------------------------------------------------------
+    f32 sinc(f32 x)
+    {
+        if (std::fabs(x) < 1e-6f)
+            return 1.f;
+        x *= 3.14159265f;
+        return std::sin(x) / x;
+    }
+
+    // Modified Bessel function of the first kind, used by the Kaiser window
+    f64 besselI0(f64 x)
+    {
+        f64 sum = 1.0;
+        f64 term = 1.0;
+        f64 halfX = x * 0.5;
+        for (u32 k = 1; k < 50; ++k)
+        {
+            f64 t = halfX / static_cast<f64>(k);
+            term *= t * t;
+            sum += term;
+            if (term < sum * 1e-12)
+                break;
+        }
+        return sum;
+    }
+
+    f32 getFilterSupport(ImageFilter filter)
+    {
+        switch (filter)
+        {
+        case SN_IMAGE_FILTER_BOX: return 0.5f;
+        case SN_IMAGE_FILTER_LANCZOS: return 3.f;
+        case SN_IMAGE_FILTER_KAISER: return KAISER_WIDTH;
+        default: return 1.f;
+        }
+    }
+
+    f32 evaluateFilter(ImageFilter filter, f32 x, f64 kaiserNorm)
+    {
+        switch (filter)
+        {
+        case SN_IMAGE_FILTER_BOX:
+            return x >= -0.5f && x < 0.5f ? 1.f : 0.f;
+
+        case SN_IMAGE_FILTER_LANCZOS:
+            return std::fabs(x) < 3.f ? sinc(x) * sinc(x / 3.f) : 0.f;
+
+        case SN_IMAGE_FILTER_KAISER:
+        {
+            f32 t = x / KAISER_WIDTH;
+            if (t <= -1.f || t >= 1.f)
+                return 0.f;
+            f64 window = besselI0(KAISER_ALPHA * std::sqrt(1.0 - t * t)) / kaiserNorm;
+            return sinc(x) * static_cast<f32>(window);
+        }
+
+        default:
+            x = std::fabs(x);
+            return x < 1.f ? 1.f - x : 0.f;
+        }
+    }
+
+    /// \brief Source pixels contributing to each output pixel along an axis,
+    /// stored as tapCount indexes and weights per output pixel.
+    struct Contributions
+    {
+        u32 tapCount;
+        std::vector<u32> indexes;
+        std::vector<f32> weights;
+
+        void compute(u32 size, u32 outSize, ImageFilter filter)
+        {
+            f32 scale = static_cast<f32>(size) / static_cast<f32>(outSize);
+            // Widen the filter when downscaling, so it covers all source pixels
+            f32 filterScale = scale > 1.f ? scale : 1.f;
+            f32 support = getFilterSupport(filter) * filterScale;
+            f64 kaiserNorm = besselI0(KAISER_ALPHA);
+
+            tapCount = static_cast<u32>(std::ceil(support * 2.f)) + 1;
+            indexes.resize(outSize * tapCount);
+            weights.resize(outSize * tapCount);
+
+            for (u32 i = 0; i < outSize; ++i)
+            {
+                f32 center = (static_cast<f32>(i) + 0.5f) * scale;
+                s32 first = static_cast<s32>(std::ceil(center - 0.5f - support));
+                u32 * taps = &indexes[i * tapCount];
+                f32 * w = &weights[i * tapCount];
+
+                f32 sum = 0.f;
+                u32 nearest = 0;
+                f32 nearestDistance = 1e9f;
+                for (u32 k = 0; k < tapCount; ++k)
+                {
+                    s32 j = first + static_cast<s32>(k);
+                    f32 d = (static_cast<f32>(j) + 0.5f - center) / filterScale;
+                    w[k] = evaluateFilter(filter, d, kaiserNorm);
+                    sum += w[k];
+                    // Pixels out of the image repeat the edge
+                    taps[k] = j < 0 ? 0 : (j >= static_cast<s32>(size) ? size - 1 : j);
+                    if (std::fabs(d) < nearestDistance)
+                    {
+                        nearestDistance = std::fabs(d);
+                        nearest = k;
+                    }
+                }
+
+                if (sum != 0.f)
+                {
+                    for (u32 k = 0; k < tapCount; ++k)
+                        w[k] /= sum;
+                }
+                else
+                {
+                    w[nearest] = 1.f;
+                }
+            }
+        }
+    };
+
+    //--------------------------------------------------------------------------
+    // RGB565 is stored as 16-bit values in little endian, as GL reads them on the platforms we run on
+    inline u16 readRGB565(const u8 * p) { return static_cast<u16>(p[0] | (p[1] << 8)); }
+    inline void writeRGB565(u8 * p, u16 v) { p[0] = v & 0xff; p[1] = v >> 8; }
+
+    void decodeToRGBA(const u8 * pixels, PixelFormat format, u8 * out_rgba, u32 count)
+    {
+        switch (format)
+        {
+        case SN_IMAGE_ALPHA8:
+            for (u32 i = 0; i < count; ++i)
+            {
+                u8 * o = out_rgba + 4 * i;
+                o[0] = 255; o[1] = 255; o[2] = 255; o[3] = pixels[i];
+            }
+            break;
+
+        case SN_IMAGE_R8:
+            for (u32 i = 0; i < count; ++i)
+            {
+                u8 * o = out_rgba + 4 * i;
+                o[0] = pixels[i]; o[1] = 0; o[2] = 0; o[3] = 255;
+            }
+            break;
+
+        case SN_IMAGE_RG16:
+            for (u32 i = 0; i < count; ++i)
+            {
+                u8 * o = out_rgba + 4 * i;
+                o[0] = pixels[2 * i]; o[1] = pixels[2 * i + 1]; o[2] = 0; o[3] = 255;
+            }
+            break;
+
+        case SN_IMAGE_RGB565:
+            for (u32 i = 0; i < count; ++i)
+            {
+                u16 v = readRGB565(pixels + 2 * i);
+                u32 r = (v >> 11) & 31;
+                u32 g = (v >> 5) & 63;
+                u32 b = v & 31;
+                // Replicate high bits, so the full range maps to 0..255
+                u8 * o = out_rgba + 4 * i;
+                o[0] = static_cast<u8>((r << 3) | (r >> 2));
+                o[1] = static_cast<u8>((g << 2) | (g >> 4));
+                o[2] = static_cast<u8>((b << 3) | (b >> 2));
+                o[3] = 255;
+            }
+            break;
+
+        default:
+            memcpy(out_rgba, pixels, count * 4);
+            break;
+        }
+    }
+
+    void encodeFromRGBA(const u8 * rgba, u8 * out_pixels, PixelFormat format, u32 count)
+    {
+        switch (format)
+        {
+        case SN_IMAGE_ALPHA8:
+            for (u32 i = 0; i < count; ++i)
+                out_pixels[i] = rgba[4 * i + 3];
+            break;
+
+        case SN_IMAGE_R8:
+            for (u32 i = 0; i < count; ++i)
+                out_pixels[i] = rgba[4 * i];
+            break;
+
+        case SN_IMAGE_RG16:
+            for (u32 i = 0; i < count; ++i)
+            {
+                out_pixels[2 * i] = rgba[4 * i];
+                out_pixels[2 * i + 1] = rgba[4 * i + 1];
+            }
+            break;
+
+        case SN_IMAGE_RGB565:
+            for (u32 i = 0; i < count; ++i)
+            {
+                const u8 * p = rgba + 4 * i;
+                // Rounded to the nearest representable value
+                u32 r = (p[0] * 31 + 127) / 255;
+                u32 g = (p[1] * 63 + 127) / 255;
+                u32 b = (p[2] * 31 + 127) / 255;
+                writeRGB565(out_pixels + 2 * i, static_cast<u16>((r << 11) | (g << 5) | b));
+            }
+            break;
+
+        default:
+            memcpy(out_pixels, rgba, count * 4);
+            break;
+        }
+    }
+
+} // anonymous namespace
+
+//------------------------------------------------------------------------------
+void downsampleBox(
+    const u8 * pixels, u32 width, u32 height, u32 channelCount, bool sRGB,
+    u8 * out_pixels,
+    u32 threadCount)
+{
+    SN_ASSERT(pixels != nullptr && out_pixels != nullptr, "Received null pixels");
+    SN_ASSERT(channelCount >= 1 && channelCount <= 4, "Invalid channel count " << channelCount);
+
+    const u32 outWidth = width > 1 ? width / 2 : 1;
+    const u32 outHeight = height > 1 ? height / 2 : 1;
+    const u32 rowLength = width * channelCount;
+    const bool gamma = sRGB && channelCount == 4;
+
+    // On images of width or height 1, the same pixels are averaged twice
+    const u32 dx = width > 1 ? channelCount : 0;
+    const u32 dy = height > 1 ? rowLength : 0;
+
+    parallelFor(outHeight, getImageThreadCount(outWidth * outHeight, threadCount), [=](u32 begin, u32 end)
+    {
+        for (u32 y = begin; y < end; ++y)
+        {
+            const u8 * row = pixels + 2 * y * rowLength;
+            u8 * out = out_pixels + y * outWidth * channelCount;
+
+            if (gamma)
+            {
+                const f32 * toLinear = g_gamma.toLinear;
+                for (u32 x = 0; x < outWidth; ++x)
+                {
+                    const u8 * p = row + 2 * x * channelCount;
+                    u8 * o = out + x * 4;
+                    for (u32 c = 0; c < 3; ++c)
+                    {
+                        f32 sum = toLinear[p[c]] + toLinear[p[c + dx]] + toLinear[p[c + dy]] + toLinear[p[c + dx + dy]];
+                        o[c] = encodeSRGB(sum * 0.25f);
+                    }
+                    o[3] = static_cast<u8>((p[3] + p[3 + dx] + p[3 + dy] + p[3 + dx + dy] + 2) >> 2);
+                }
+            }
+            else
+            {
+                for (u32 x = 0; x < outWidth; ++x)
+                {
+                    const u8 * p = row + 2 * x * channelCount;
+                    u8 * o = out + x * channelCount;
+                    for (u32 c = 0; c < channelCount; ++c)
+                        o[c] = static_cast<u8>((p[c] + p[c + dx] + p[c + dy] + p[c + dx + dy] + 2) >> 2);
+                }
+            }
+        }
+    });
+}
+
+//------------------------------------------------------------------------------
+void resample(
+    const u8 * pixels, u32 width, u32 height, u32 channelCount, bool sRGB,
+    u8 * out_pixels, u32 outWidth, u32 outHeight,
+    ImageFilter filter,
+    u32 threadCount)
+{
+    SN_ASSERT(pixels != nullptr && out_pixels != nullptr, "Received null pixels");
+    SN_ASSERT(channelCount >= 1 && channelCount <= 4, "Invalid channel count " << channelCount);
+    if (width == 0 || height == 0 || outWidth == 0 || outHeight == 0)
+        return;
+
+    Contributions columns;
+    Contributions rows;
+    columns.compute(width, outWidth, filter);
+    rows.compute(height, outHeight, filter);
+
+    const bool gamma = sRGB && channelCount == 4;
+    const f32 * decode[4];
+    for (u32 c = 0; c < 4; ++c)
+        decode[c] = gamma && c < 3 ? g_gamma.toLinear : g_gamma.identity;
+
+    const u32 rowLength = width * channelCount;
+    const u32 outRowLength = outWidth * channelCount;
+
+    parallelFor(outHeight, getImageThreadCount(outWidth * outHeight, threadCount), [&](u32 begin, u32 end)
+    {
+        // Decoded source row, rows filtered horizontally, and the output row being accumulated
+        std::vector<f32> row(rowLength);
+        std::vector<f32> band;
+        std::vector<f32> sum(outRowLength);
+
+        for (u32 bandBegin = begin; bandBegin < end; bandBegin += BAND_ROWS)
+        {
+            u32 bandEnd = bandBegin + BAND_ROWS < end ? bandBegin + BAND_ROWS : end;
+
+            // Source rows used by the band
+            u32 minRow = height;
+            u32 maxRow = 0;
+            for (u32 i = bandBegin * rows.tapCount; i < bandEnd * rows.tapCount; ++i)
+            {
+                u32 j = rows.indexes[i];
+                if (j < minRow)
+                    minRow = j;
+                if (j > maxRow)
+                    maxRow = j;
+            }
+
+            // Horizontal pass
+            band.resize((maxRow - minRow + 1) * outRowLength);
+            for (u32 sy = minRow; sy <= maxRow; ++sy)
+            {
+                // Decode the row once, as each pixel is used by several taps
+                const u8 * src = pixels + sy * rowLength;
+                for (u32 x = 0; x < width; ++x)
+                {
+                    for (u32 c = 0; c < channelCount; ++c)
+                        row[x * channelCount + c] = decode[c][src[x * channelCount + c]];
+                }
+
+                f32 * dst = &band[(sy - minRow) * outRowLength];
+                for (u32 x = 0; x < outWidth; ++x)
+                {
+                    const u32 * taps = &columns.indexes[x * columns.tapCount];
+                    const f32 * w = &columns.weights[x * columns.tapCount];
+                    f32 acc[4] = { 0.f, 0.f, 0.f, 0.f };
+                    for (u32 k = 0; k < columns.tapCount; ++k)
+                    {
+                        const f32 * p = &row[taps[k] * channelCount];
+                        for (u32 c = 0; c < channelCount; ++c)
+                            acc[c] += w[k] * p[c];
+                    }
+                    for (u32 c = 0; c < channelCount; ++c)
+                        dst[x * channelCount + c] = acc[c];
+                }
+            }
+
+            // Vertical pass, accumulating whole rows
+            for (u32 y = bandBegin; y < bandEnd; ++y)
+            {
+                const u32 * taps = &rows.indexes[y * rows.tapCount];
+                const f32 * w = &rows.weights[y * rows.tapCount];
+
+                std::fill(sum.begin(), sum.end(), 0.f);
+                for (u32 k = 0; k < rows.tapCount; ++k)
+                {
+                    if (w[k] == 0.f)
+                        continue;
+                    const f32 weight = w[k];
+                    const f32 * src = &band[(taps[k] - minRow) * outRowLength];
+                    f32 * acc = &sum[0];
+                    for (u32 i = 0; i < outRowLength; ++i)
+                        acc[i] += weight * src[i];
+                }
+
+                u8 * out = out_pixels + y * outRowLength;
+                if (gamma)
+                {
+                    for (u32 i = 0; i < outRowLength; i += 4)
+                    {
+                        out[i] = encodeSRGB(sum[i]);
+                        out[i + 1] = encodeSRGB(sum[i + 1]);
+                        out[i + 2] = encodeSRGB(sum[i + 2]);
+                        out[i + 3] = encodeLinear(sum[i + 3]);
+                    }
+                }
+                else
+                {
+                    for (u32 i = 0; i < outRowLength; ++i)
+                        out[i] = encodeLinear(sum[i]);
+                }
+            }
+        }
+    });
+}
+
+//------------------------------------------------------------------------------
+void convertPixels(
+    const u8 * pixels, PixelFormat format,
+    u8 * out_pixels, PixelFormat outFormat,
+    u32 pixelCount)
+{
+    SN_ASSERT(pixels != nullptr && out_pixels != nullptr, "Received null pixels");
+
+    if (format == outFormat)
+    {
+        memcpy(out_pixels, pixels, pixelCount * getPixelSize(format));
+    }
+    else if (format == SN_IMAGE_RGBA32)
+    {
+        encodeFromRGBA(pixels, out_pixels, outFormat, pixelCount);
+    }
+    else if (outFormat == SN_IMAGE_RGBA32)
+    {
+        decodeToRGBA(pixels, format, out_pixels, pixelCount);
+    }
+    else
+    {
+        // Through RGBA, by chunks small enough to stay in cache
+        const u32 chunkSize = 256;
+        u8 rgba[chunkSize * 4];
+        const u32 pixelSize = getPixelSize(format);
+        const u32 outPixelSize = getPixelSize(outFormat);
+        for (u32 i = 0; i < pixelCount; i += chunkSize)
+        {
+            u32 count = pixelCount - i < chunkSize ? pixelCount - i : chunkSize;
+            decodeToRGBA(pixels + i * pixelSize, format, rgba, count);
+            encodeFromRGBA(rgba, out_pixels + i * outPixelSize, outFormat, count);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void premultiplyAlpha(u8 * pixels, u32 pixelCount)
+{
+    SN_ASSERT(pixels != nullptr, "Received null pixels");
+    for (u32 i = 0; i < pixelCount; ++i)
+    {
+        u8 * p = pixels + 4 * i;
+        u32 a = p[3];
+        for (u32 c = 0; c < 3; ++c)
+        {
+            // Exact rounding of p[c] * a / 255
+            u32 t = p[c] * a + 128;
+            p[c] = static_cast<u8>((t + (t >> 8)) >> 8);
+        }
+    }
+}
+
+} // namespace sn
+
@@ -0,0 +1,74 @@
+#ifndef __HEADER_SN_IMAGEKERNELS__
+#define __HEADER_SN_IMAGEKERNELS__
+
+#include <modules/image/PixelFormat.h>
+
+namespace sn
+{
+
+/// \brief Filters used to compute pixels of an image of a different size
+enum ImageFilter
+{
+    /// \brief Average of covered pixels. Fastest for mipmaps.
+    SN_IMAGE_FILTER_BOX = 0,
+    /// \brief Linear interpolation (tent filter, widened when downscaling)
+    SN_IMAGE_FILTER_BILINEAR,
+    /// \brief Windowed sinc of 3 lobes. Sharp, with slight ringing on hard edges.
+    SN_IMAGE_FILTER_LANCZOS,
+    /// \brief Kaiser-windowed sinc. Sharp mipmaps with little aliasing.
+    SN_IMAGE_FILTER_KAISER
+};
+
+/// \brief Minimum number of output pixels given to each thread.
+/// Threads are created for each call, so smaller images run on the calling thread only.
+static const u32 SN_IMAGE_MIN_PIXELS_PER_THREAD = 256 * 256;
+
+/// \brief Gets how many of the given threads are worth using to process a number of pixels
+inline u32 getImageThreadCount(u32 pixelCount, u32 maxThreadCount)
+{
+    u32 threadCount = pixelCount / SN_IMAGE_MIN_PIXELS_PER_THREAD;
+    if (threadCount > maxThreadCount)
+        threadCount = maxThreadCount;
+    return threadCount > 0 ? threadCount : 1;
+}
+
+// Kernels below work on rows of interleaved 8-bit components.
+// If sRGB is true and pixels have 4 components, the first three are converted to linear values
+// before being filtered, and converted back after. Alpha and other formats are filtered as they are.
+// They can be called from several threads at the same time.
+
+/// \brief Computes the next mipmap level, where each pixel is the average of 2x2 pixels.
+/// \param out_pixels: max(1, width/2) * max(1, height/2) pixels. On odd sizes, the last row or column is ignored.
+/// With a single thread, out_pixels can be the same as pixels to downsample in place.
+void downsampleBox(
+    const u8 * pixels, u32 width, u32 height, u32 channelCount, bool sRGB,
+    u8 * out_pixels,
+    u32 threadCount
+);
+
+/// \brief Computes pixels of an image of another size, using a separable filter.
+/// Filters are widened when downscaling, so every source pixel contributes.
+void resample(
+    const u8 * pixels, u32 width, u32 height, u32 channelCount, bool sRGB,
+    u8 * out_pixels, u32 outWidth, u32 outHeight,
+    ImageFilter filter,
+    u32 threadCount
+);
+
+/// \brief Converts pixels from a format to another.
+/// Components missing from the source format are black, with opaque alpha,
+/// except ALPHA8 pixels which become white with their alpha, like masks.
+/// Color formats converted to ALPHA8 keep their alpha.
+void convertPixels(
+    const u8 * pixels, PixelFormat format,
+    u8 * out_pixels, PixelFormat outFormat,
+    u32 pixelCount
+);
+
+/// \brief Multiplies color components of RGBA32 pixels by their alpha
+void premultiplyAlpha(u8 * pixels, u32 pixelCount);
+
+} // namespace sn
+
+#endif // __HEADER_SN_IMAGEKERNELS__
+
@@ -1,11 +1,13 @@
 #include <core/util/Log.h>
 #include <core/util/stringutils.h>
 #include <core/util/typecheck.h>
+#include <core/system/MappedFile.h>
 
 #include "ImageLoader.hpp"
+#include "ImageDecoder.h"
+
+#include <cstdlib>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "stbi/stb_image.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stbi/stb_image_write.h"
 
@@ -37,62 +39,77 @@ bool ImageLoader::load(std::ifstream & ifs, Asset & asset) const
     sn::Image * image = checked_cast<Image*>(&asset);
     SN_ASSERT(image != nullptr, "Image type to load mismatches");
 
-    // TODO [Optimize] I was tired when writing this
-    // TODO I was tired too when reading this again
-    std::vector<u8> buffer;
-    while (!ifs.eof())
+    const AssetMetadata & meta = image->getAssetMetadata();
+    const Variant & args = meta.variantData;
+    u32 maxSize = args["maxSize"].getInt();
+    bool sRGB = !args["linear"].getBool();
+
+    // Images created by other loaders have no path, only the stream
+    if (!meta.path.empty())
+        return loadFromFile(*image, meta.path, maxSize, sRGB);
+    return loadFromStream(*image, ifs, maxSize, sRGB);
+}
+
+//------------------------------------------------------------------------------
+bool ImageLoader::loadFromFile(sn::Image & image, const String & filePath, u32 maxSize, bool sRGB)
+{
+    MappedFile file;
+    if (file.open(filePath))
+        return loadFromMemory(image, file.getData(), static_cast<u32>(file.getSize()), maxSize, sRGB);
+
+    // Some files can't be mapped, such as empty ones
+    std::ifstream ifs(filePath.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs.good())
     {
-        buffer.push_back(ifs.get());
+        SN_WERROR(L"Couldn't open image file " << filePath);
+        return false;
     }
+    return loadFromStream(image, ifs, maxSize, sRGB);
+}
+
+//------------------------------------------------------------------------------
+bool ImageLoader::loadFromStream(sn::Image & image, std::ifstream & ifs, u32 maxSize, bool sRGB)
+{
+    ifs.seekg(0, std::ios::end);
+    std::streamoff size = ifs.tellg();
+    ifs.seekg(0, std::ios::beg);
 
-    if (buffer.empty())
+    if (size <= 0)
     {
         SN_ERROR("The image file is empty");
         return false;
     }
-    else
+
+    std::vector<u8> buffer(static_cast<size_t>(size));
+    ifs.read(reinterpret_cast<char*>(&buffer[0]), buffer.size());
+    if (!ifs.good())
     {
-        return loadFromMemory(*image, &buffer[0], buffer.size());
+        SN_ERROR("Failed to read image file");
+        return false;
     }
+    return loadFromMemory(image, &buffer[0], buffer.size(), maxSize, sRGB);
 }
 
 //------------------------------------------------------------------------------
-bool ImageLoader::loadFromMemory(sn::Image & image, const u8 * data, u32 dataSize)
+bool ImageLoader::loadFromMemory(sn::Image & image, const u8 * data, u32 dataSize, u32 maxSize, bool sRGB)
 {
     image.clear();
 
     // Check input parameters
     if (data && dataSize)
     {
-        // Load image
-        s32 width = 0;
-        s32 height = 0;
-        s32 channels = 0;
-        u8 * pixels = stbi_load_from_memory(data,
-            static_cast<s32>(dataSize),
-            &width, &height, &channels, STBI_rgb_alpha
-        );
-
-        if (pixels && width && height)
+        // The image keeps the decoded pixels as they are
+        Vector2u size;
+        u8 * pixels = decodeImage(data, dataSize, maxSize, sRGB, size);
+        if (pixels && size.x() && size.y())
         {
-            // Assign loaded data
-            if (channels == 4)
-            {
-                image.loadFromPixels(Vector2u(width, height), SN_IMAGE_RGBA32, pixels);
-            }
-            else
-            {
-                SN_WERROR(L"Unsupported image format (" << image.getAssetMetadata().path << L")");
-            }
-
-            // Free STB data
-            stbi_image_free(pixels);
-
+            image.adoptPixels(size, SN_IMAGE_RGBA32, pixels);
             return true;
         }
         else
         {
-            SN_ERROR("Failed to load image from memory: " << stbi_failure_reason());
+            free(pixels);
+            SN_ERROR("Failed to load image from memory: " << getImageDecodeError());
             return false;
         }
     }
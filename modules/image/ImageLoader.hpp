@@ -24,8 +24,14 @@ public:
     bool isDirect(const AssetMetadata & meta) const override;
     bool load(std::ifstream & ifs, Asset & asset) const override;
 
+    /// \brief Decodes an image file mapped in memory, straight into the pixels the image keeps.
+    /// \param maxSize: if not zero, the image is halved until it fits in it (see decodeImage())
+    /// \param sRGB: if true, colors are halved in linear space
+    static bool loadFromFile(sn::Image & image, const String & filePath, u32 maxSize = 0, bool sRGB = true);
+
 private:
-    static bool loadFromMemory(sn::Image & image, const u8 * data, u32 dataSize);
+    static bool loadFromStream(sn::Image & image, std::ifstream & ifs, u32 maxSize, bool sRGB);
+    static bool loadFromMemory(sn::Image & image, const u8 * data, u32 dataSize, u32 maxSize, bool sRGB);
 
 };
 
@@ -0,0 +1,65 @@
+#ifndef __HEADER_SN_PIXELFORMAT__
+#define __HEADER_SN_PIXELFORMAT__
+
+#include <core/types.h>
+
+namespace sn
+{
+
+enum PixelFormat
+{
+    SN_IMAGE_RGBA32 = 0,
+    /// \brief Single 8-bit alpha channel, such as glyph coverage.
+    /// Textures store it in one channel (R8), sampled as white with alpha.
+    SN_IMAGE_ALPHA8,
+    /// \brief Single 8-bit red channel, such as height or roughness maps
+    SN_IMAGE_R8,
+    /// \brief Two 8-bit channels, red and green, such as normal maps
+    SN_IMAGE_RG16,
+    /// \brief Colors packed in 16 bits, 5 for red and blue, 6 for green
+    SN_IMAGE_RGB565
+};
+
+/// \brief Gets the number of components pixels have in the given format
+inline u32 getChannelCount(PixelFormat format)
+{
+    switch (format)
+    {
+    case SN_IMAGE_ALPHA8:
+    case SN_IMAGE_R8:
+        return 1;
+    case SN_IMAGE_RG16:
+        return 2;
+    case SN_IMAGE_RGB565:
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+/// \brief Gets the number of bytes pixels take in the given format
+inline u32 getPixelSize(PixelFormat format)
+{
+    switch (format)
+    {
+    case SN_IMAGE_ALPHA8:
+    case SN_IMAGE_R8:
+        return 1;
+    case SN_IMAGE_RG16:
+    case SN_IMAGE_RGB565:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+/// \brief Tells if pixels of the format are made of one byte per component
+inline bool hasByteChannels(PixelFormat format)
+{
+    return format != SN_IMAGE_RGB565;
+}
+
+} // namespace sn
+
+#endif // __HEADER_SN_PIXELFORMAT__
+
@@ -2083,6 +2083,7 @@ static int stbi__zbuild_huffman(stbi__zhuffman *z, stbi_uc *sizelist, int num)
 typedef struct
 {
    stbi_uc *zbuffer, *zbuffer_end;
+   stbi_uc *zchunks_end; // SN: if not NULL, zbuffer is a PNG chunk that can be followed by more IDAT chunks until there
    int num_bits;
    stbi__uint32 code_buffer;
 
@@ -2094,9 +2095,24 @@ typedef struct
    stbi__zhuffman z_length, z_distance;
 } stbi__zbuf;
 
+// SN: moves to the data of the next IDAT chunk, when inflating straight from a PNG in memory
+static int stbi__znext_chunk(stbi__zbuf *z)
+{
+   stbi_uc *p = z->zbuffer_end + 4; // skip CRC
+   stbi__uint32 len;
+   if (z->zchunks_end == NULL || z->zchunks_end - p < 8) return 0;
+   len = ((stbi__uint32) p[0] << 24) + (p[1] << 16) + (p[2] << 8) + p[3];
+   if (p[4] != 'I' || p[5] != 'D' || p[6] != 'A' || p[7] != 'T') return 0;
+   if ((stbi__uint32) (z->zchunks_end - p - 8) < len) return 0;
+   z->zbuffer = p + 8;
+   z->zbuffer_end = p + 8 + len;
+   return 1;
+}
+
 stbi_inline static stbi_uc stbi__zget8(stbi__zbuf *z)
 {
-   if (z->zbuffer >= z->zbuffer_end) return 0;
+   while (z->zbuffer >= z->zbuffer_end)
+      if (!stbi__znext_chunk(z)) return 0;
    return *z->zbuffer++;
 }
 
@@ -2271,12 +2287,19 @@ static int stbi__parse_uncomperssed_block(stbi__zbuf *a)
    len  = header[1] * 256 + header[0];
    nlen = header[3] * 256 + header[2];
    if (nlen != (len ^ 0xffff)) return stbi__err("zlib corrupt","Corrupt PNG");
-   if (a->zbuffer + len > a->zbuffer_end) return stbi__err("read past buffer","Corrupt PNG");
    if (a->zout + len > a->zout_end)
       if (!stbi__zexpand(a, len)) return 0;
-   memcpy(a->zout, a->zbuffer, len);
-   a->zbuffer += len;
-   a->zout += len;
+   // SN: stored data can span several chunks
+   while (len > 0) {
+      int n;
+      if (a->zbuffer >= a->zbuffer_end && !stbi__znext_chunk(a)) return stbi__err("read past buffer","Corrupt PNG");
+      n = (int) (a->zbuffer_end - a->zbuffer);
+      if (n > len) n = len;
+      memcpy(a->zout, a->zbuffer, n);
+      a->zbuffer += n;
+      a->zout += n;
+      len -= n;
+   }
    return 1;
 }
 
@@ -2352,6 +2375,7 @@ STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int
    if (p == NULL) return NULL;
    a.zbuffer = (stbi_uc *) buffer;
    a.zbuffer_end = (stbi_uc *) buffer + len;
+   a.zchunks_end = NULL;
    if (stbi__do_zlib(&a, p, initial_size, 1, 1)) {
       if (outlen) *outlen = (int) (a.zout - a.zout_start);
       return a.zout_start;
@@ -2361,6 +2385,24 @@ STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int
    }
 }
 
+// SN: inflates consecutive IDAT chunks where they are, instead of copying them together first
+static char *stbi__zlib_decode_png_chunks(stbi_uc *chunk, int chunk_len, stbi_uc *end, int initial_size, int *outlen, int parse_header)
+{
+   stbi__zbuf a;
+   char *p = (char *) stbi__malloc(initial_size);
+   if (p == NULL) return NULL;
+   a.zbuffer = chunk;
+   a.zbuffer_end = chunk + chunk_len;
+   a.zchunks_end = end;
+   if (stbi__do_zlib(&a, p, initial_size, 1, parse_header)) {
+      if (outlen) *outlen = (int) (a.zout - a.zout_start);
+      return a.zout_start;
+   } else {
+      free(a.zout_start);
+      return NULL;
+   }
+}
+
 STBIDEF char *stbi_zlib_decode_malloc(char const *buffer, int len, int *outlen)
 {
    return stbi_zlib_decode_malloc_guesssize(buffer, len, 16384, outlen);
@@ -2373,6 +2415,7 @@ STBIDEF char *stbi_zlib_decode_malloc_guesssize_headerflag(const char *buffer, i
    if (p == NULL) return NULL;
    a.zbuffer = (stbi_uc *) buffer;
    a.zbuffer_end = (stbi_uc *) buffer + len;
+   a.zchunks_end = NULL;
    if (stbi__do_zlib(&a, p, initial_size, 1, parse_header)) {
       if (outlen) *outlen = (int) (a.zout - a.zout_start);
       return a.zout_start;
@@ -2387,6 +2430,7 @@ STBIDEF int stbi_zlib_decode_buffer(char *obuffer, int olen, char const *ibuffer
    stbi__zbuf a;
    a.zbuffer = (stbi_uc *) ibuffer;
    a.zbuffer_end = (stbi_uc *) ibuffer + ilen;
+   a.zchunks_end = NULL;
    if (stbi__do_zlib(&a, obuffer, olen, 0, 1))
       return (int) (a.zout - a.zout_start);
    else
@@ -2400,6 +2444,7 @@ STBIDEF char *stbi_zlib_decode_noheader_malloc(char const *buffer, int len, int
    if (p == NULL) return NULL;
    a.zbuffer = (stbi_uc *) buffer;
    a.zbuffer_end = (stbi_uc *) buffer+len;
+   a.zchunks_end = NULL;
    if (stbi__do_zlib(&a, p, 16384, 1, 0)) {
       if (outlen) *outlen = (int) (a.zout - a.zout_start);
       return a.zout_start;
@@ -2414,6 +2459,7 @@ STBIDEF int stbi_zlib_decode_noheader_buffer(char *obuffer, int olen, const char
    stbi__zbuf a;
    a.zbuffer = (stbi_uc *) ibuffer;
    a.zbuffer_end = (stbi_uc *) ibuffer + ilen;
+   a.zchunks_end = NULL;
    if (stbi__do_zlib(&a, obuffer, olen, 0, 0))
       return (int) (a.zout - a.zout_start);
    else
@@ -2487,14 +2533,17 @@ static int stbi__paeth(int a, int b, int c)
 #define STBI__BYTECAST(x)  ((stbi_uc) ((x) & 255))  // truncate int to byte without warnings
 
 // create the png data from post-deflated data
-static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 raw_len, int out_n, stbi__uint32 x, stbi__uint32 y)
+// SN: if in_place is set, raw becomes the output. Each output byte comes before the raw byte
+// it is computed from, so unfiltering can overwrite raw data as it goes.
+static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 raw_len, int out_n, stbi__uint32 x, stbi__uint32 y, int in_place)
 {
    stbi__context *s = a->s;
    stbi__uint32 i,j,stride = x*out_n;
    int k;
    int img_n = s->img_n; // copy it into a local for later
    STBI_ASSERT(out_n == s->img_n || out_n == s->img_n+1);
-   a->out = (stbi_uc *) stbi__malloc(x * y * out_n);
+   STBI_ASSERT(!in_place || out_n == s->img_n);
+   a->out = in_place ? raw : (stbi_uc *) stbi__malloc(x * y * out_n);
    if (!a->out) return stbi__err("outofmem", "Out of memory");
    if (s->img_x == x && s->img_y == y) {
       if (raw_len != (img_n * x + 1) * y) return stbi__err("not enough pixels","Corrupt PNG");
@@ -2565,8 +2614,19 @@ static int stbi__create_png_image(stbi__png *a, stbi_uc *raw, stbi__uint32 raw_l
 {
    stbi_uc *final;
    int p;
-   if (!interlaced)
-      return stbi__create_png_image_raw(a, raw, raw_len, out_n, a->s->img_x, a->s->img_y);
+   if (!interlaced) {
+      // SN: unfilter in place when components don't change, instead of holding the image twice
+      if (out_n == a->s->img_n && raw == a->expanded) {
+         stbi_uc *p;
+         a->expanded = NULL; // now owned by a->out
+         if (!stbi__create_png_image_raw(a, raw, raw_len, out_n, a->s->img_x, a->s->img_y, 1)) return 0;
+         // drop the filter bytes of each row
+         p = (stbi_uc *) realloc(a->out, a->s->img_x * a->s->img_y * out_n);
+         if (p) a->out = p;
+         return 1;
+      }
+      return stbi__create_png_image_raw(a, raw, raw_len, out_n, a->s->img_x, a->s->img_y, 0);
+   }
 
    // de-interlacing
    final = (stbi_uc *) stbi__malloc(a->s->img_x * a->s->img_y * out_n);
@@ -2580,7 +2640,7 @@ static int stbi__create_png_image(stbi__png *a, stbi_uc *raw, stbi__uint32 raw_l
       x = (a->s->img_x - xorig[p] + xspc[p]-1) / xspc[p];
       y = (a->s->img_y - yorig[p] + yspc[p]-1) / yspc[p];
       if (x && y) {
-         if (!stbi__create_png_image_raw(a, raw, raw_len, out_n, x, y)) {
+         if (!stbi__create_png_image_raw(a, raw, raw_len, out_n, x, y, 0)) {
             free(final);
             return 0;
          }
@@ -2715,6 +2775,26 @@ static void stbi__de_iphone(stbi__png *z)
    }
 }
 
+// SN: size of filtered rows of all passes, which is what IDAT chunks inflate to
+static stbi__uint32 stbi__png_raw_size(stbi__uint32 x, stbi__uint32 y, int img_n, int interlaced)
+{
+   stbi__uint32 size = 0;
+   int p;
+   if (!interlaced)
+      return (x * img_n + 1) * y;
+   for (p=0; p < 7; ++p) {
+      int xorig[] = { 0,4,0,2,0,1,0 };
+      int yorig[] = { 0,0,4,0,2,0,1 };
+      int xspc[]  = { 8,8,4,4,2,2,1 };
+      int yspc[]  = { 8,8,8,4,4,2,2 };
+      stbi__uint32 px = (x - xorig[p] + xspc[p]-1) / xspc[p];
+      stbi__uint32 py = (y - yorig[p] + yspc[p]-1) / yspc[p];
+      if (px && py)
+         size += (px * img_n + 1) * py;
+   }
+   return size;
+}
+
 static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
 {
    stbi_uc palette[1024], pal_img_n=0;
@@ -2722,6 +2802,8 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
    stbi__uint32 ioff=0, idata_limit=0, i, pal_len=0;
    int first=1,k,interlace=0, is_iphone=0;
    stbi__context *s = z->s;
+   stbi_uc *idat_chunk=NULL; // SN: first IDAT chunk when decoding from memory
+   int idat_ended=0;
 
    z->expanded = NULL;
    z->idata = NULL;
@@ -2733,6 +2815,7 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
 
    for (;;) {
       stbi__pngchunk c = stbi__get_chunk_header(s);
+      if (idat_chunk && c.type != PNG_TYPE('I','D','A','T')) idat_ended = 1;
       switch (c.type) {
          case PNG_TYPE('C','g','B','I'):
             is_iphone = 1;
@@ -2782,7 +2865,7 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
 
          case PNG_TYPE('t','R','N','S'): {
             if (first) return stbi__err("first not IHDR", "Corrupt PNG");
-            if (z->idata) return stbi__err("tRNS after IDAT","Corrupt PNG");
+            if (z->idata || idat_chunk) return stbi__err("tRNS after IDAT","Corrupt PNG");
             if (pal_img_n) {
                if (scan == SCAN_header) { s->img_n = 4; return 1; }
                if (pal_len == 0) return stbi__err("tRNS before PLTE","Corrupt PNG");
@@ -2804,6 +2887,14 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
             if (first) return stbi__err("first not IHDR", "Corrupt PNG");
             if (pal_img_n && !pal_len) return stbi__err("no PLTE","Corrupt PNG");
             if (scan == SCAN_header) { s->img_n = pal_img_n; return 1; }
+            if (s->io.read == NULL) {
+               // SN: chunks in memory are inflated where they are, they only need to follow each other
+               if (idat_ended) return stbi__err("IDAT not consecutive","Corrupt PNG");
+               if (c.length > (stbi__uint32) (s->img_buffer_end - s->img_buffer)) return stbi__err("outofdata","Corrupt PNG");
+               if (idat_chunk == NULL) { idat_chunk = s->img_buffer; ioff = c.length; }
+               stbi__skip(s, c.length);
+               break;
+            }
             if (ioff + c.length > idata_limit) {
                stbi_uc *p;
                if (idata_limit == 0) idata_limit = c.length > 4096 ? c.length : 4096;
@@ -2821,8 +2912,13 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
             stbi__uint32 raw_len;
             if (first) return stbi__err("first not IHDR", "Corrupt PNG");
             if (scan != SCAN_load) return 1;
-            if (z->idata == NULL) return stbi__err("no IDAT","Corrupt PNG");
-            z->expanded = (stbi_uc *) stbi_zlib_decode_malloc_guesssize_headerflag((char *) z->idata, ioff, 16384, (int *) &raw_len, !is_iphone);
+            if (z->idata == NULL && idat_chunk == NULL) return stbi__err("no IDAT","Corrupt PNG");
+            // SN: the inflated size is known from the header, allocate it once instead of doubling from 16KB
+            raw_len = stbi__png_raw_size(s->img_x, s->img_y, s->img_n, interlace);
+            if (idat_chunk)
+               z->expanded = (stbi_uc *) stbi__zlib_decode_png_chunks(idat_chunk, ioff, s->img_buffer_end, raw_len, (int *) &raw_len, !is_iphone);
+            else
+               z->expanded = (stbi_uc *) stbi_zlib_decode_malloc_guesssize_headerflag((char *) z->idata, ioff, raw_len, (int *) &raw_len, !is_iphone);
             if (z->expanded == NULL) return 0; // zlib should set error
             free(z->idata); z->idata = NULL;
             if ((req_comp == s->img_n+1 && req_comp != 3 && !pal_img_n) || has_trans)
@@ -100,7 +100,7 @@ void Mesh::updateIndices(const u32 * indices, u32 count, u32 offset)
         offset = m_indices.size();
     if (m_indices.size() < offset+count)
         m_indices.resize(offset+count);
-    memcpy(m_indices.data() + offset * sizeof(u32), indices, count * sizeof(u32));
+    memcpy(m_indices.data() + offset, indices, count * sizeof(u32));
 }
 
 //------------------------------------------------------------------------------
@@ -4,11 +4,58 @@
 #include "gl_check.h"
 #include "Texture.h"
 #include <GL/glew.h>
+#include <algorithm>
 
 
 namespace sn
 {
 
+namespace
+{
+    struct GLPixelFormat
+    {
+        GLint internalFormat;
+        GLenum format;
+        GLenum type;
+        /// \brief Row alignment in bytes
+        GLint alignment;
+    };
+
+    GLPixelFormat getGLPixelFormat(PixelFormat format)
+    {
+        // Rows of pixels smaller than 4 bytes are not aligned on 4 bytes
+        GLPixelFormat f;
+        switch (format)
+        {
+        case SN_IMAGE_ALPHA8:
+        case SN_IMAGE_R8:
+            f.internalFormat = GL_R8; f.format = GL_RED; f.type = GL_UNSIGNED_BYTE; f.alignment = 1;
+            break;
+        case SN_IMAGE_RG16:
+            f.internalFormat = GL_RG8; f.format = GL_RG; f.type = GL_UNSIGNED_BYTE; f.alignment = 1;
+            break;
+        case SN_IMAGE_RGB565:
+            f.internalFormat = GL_RGB565; f.format = GL_RGB; f.type = GL_UNSIGNED_SHORT_5_6_5; f.alignment = 1;
+            break;
+        default:
+            f.internalFormat = GL_RGBA8; f.format = GL_RGBA; f.type = GL_UNSIGNED_BYTE; f.alignment = 4;
+            break;
+        }
+        return f;
+    }
+
+    GLenum getGLBlockFormat(BlockFormat format)
+    {
+        switch (format)
+        {
+        case SN_BLOCK_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case SN_BLOCK_BC4: return GL_COMPRESSED_RED_RGTC1;
+        case SN_BLOCK_BC5: return GL_COMPRESSED_RG_RGTC2;
+        default: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        }
+    }
+}
+
 SN_OBJECT_IMPL(Texture)
 
 //-----------------------------------------------------------------------------
@@ -16,7 +63,10 @@ Texture::Texture() : sn::Asset(),
     m_isSmooth(true),
     m_isRepeated(false),
     m_handle(nullptr),
-    m_keepSourceInMemory(false)
+    m_keepSourceInMemory(false),
+    m_pixelFormat(SN_IMAGE_RGBA32),
+    m_mipmapCount(1),
+    m_isCompressed(false)
 {
 }
 
@@ -33,10 +83,15 @@ bool Texture::uploadToVRAM()
     bool success = false;
     if (img)
     {
-        Image * img = m_image.get();
-        bool success = false;
-        if (img)
-            success = loadFromPixelsRGBA8(img->getSize(), reinterpret_cast<const char*>(img->getPixelsPtr()));
+        success = loadFromPixels(img->getSize(), img->getPixelFormat(), img->getPixelsPtr());
+        if (success && img->getMipmapCount() > 1)
+        {
+            for (u32 level = 1; level < img->getMipmapCount(); ++level)
+                uploadLevel(level, img->getMipmapSize(level), img->getMipmapPixelsPtr(level));
+            m_mipmapCount = img->getMipmapCount();
+            glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_mipmapCount - 1));
+            updateFilter();
+        }
         if (success && !isKeepSourceInMemory())
         {
             img->clear();
@@ -45,6 +100,44 @@ bool Texture::uploadToVRAM()
     return success;
 }
 
+//------------------------------------------------------------------------------
+bool Texture::uploadRegionToVRAM(IntRect rect)
+{
+    Image * img = m_image.get();
+    if (img == nullptr || img->getPixelsPtr() == nullptr)
+        return false;
+
+    Vector2u size = img->getSize();
+    // Mipmaps don't match the region anymore, they are uploaded again with the whole image
+    if (m_handle == nullptr || m_size != size || m_pixelFormat != img->getPixelFormat()
+        || m_isCompressed || m_mipmapCount > 1 || img->getMipmapCount() > 1)
+        return uploadToVRAM();
+
+    s32 minX = std::max(rect.minX(), 0);
+    s32 minY = std::max(rect.minY(), 0);
+    s32 maxX = std::min(rect.maxX(), static_cast<s32>(size.x()));
+    s32 maxY = std::min(rect.maxY(), static_cast<s32>(size.y()));
+    if (minX >= maxX || minY >= maxY)
+        return true;
+    rect = IntRect::fromMinMax(minX, minY, maxX, maxY);
+
+    bind(this);
+
+    // Rows of the sub-rectangle are read from the whole image
+    GLPixelFormat f = getGLPixelFormat(img->getPixelFormat());
+    glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+    glCheck(glPixelStorei(GL_UNPACK_ROW_LENGTH, size.x()));
+    glCheck(glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x(), rect.y(), rect.width(), rect.height(), f.format, f.type,
+        img->getPixelsPtr() + img->getPixelIndex(rect.x(), rect.y())));
+    glCheck(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
+    glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+
+    if (!isKeepSourceInMemory())
+        img->clear();
+
+    return true;
+}
+
 //------------------------------------------------------------------------------
 bool Texture::downloadFromVRAM()
 {
@@ -93,11 +186,20 @@ bool Texture::create(Vector2u size)
 
 //-----------------------------------------------------------------------------
 bool Texture::loadFromPixelsRGBA8(Vector2u size, const char * data)
+{
+    return loadFromPixels(size, SN_IMAGE_RGBA32, reinterpret_cast<const u8*>(data));
+}
+
+//-----------------------------------------------------------------------------
+bool Texture::loadFromPixels(Vector2u size, PixelFormat format, const u8 * data)
 {
     // Note: data can be null in the case we don't want to initialize pixels
     SN_ASSERT(size.x() > 0 && size.y() > 0, "Invalid pixel data");
 
     m_size = size;
+    m_pixelFormat = format;
+    m_mipmapCount = 1;
+    m_isCompressed = false;
 
     GLuint textureID = reinterpret_cast<GLuint>(getHandle());
 
@@ -113,8 +215,10 @@ bool Texture::loadFromPixelsRGBA8(Vector2u size, const char * data)
         bind(this);
 
         // Set image data
-        glCheck(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.x(), size.y(), 0, GL_RGBA, GL_UNSIGNED_BYTE, data));
+        uploadLevel(0, size, data);
+        glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0));
 
+        updateSwizzle();
         updateRepeat();
         updateFilter();
 
@@ -127,6 +231,67 @@ bool Texture::loadFromPixelsRGBA8(Vector2u size, const char * data)
     }
 }
 
+//-----------------------------------------------------------------------------
+bool Texture::loadFromCompressed(const CompressedImage & image)
+{
+    SN_ASSERT(image.getMipmapCount() > 0, "Compressed image is empty");
+
+    m_size = image.getSize();
+    m_mipmapCount = image.getMipmapCount();
+    m_isCompressed = true;
+    // Decompressed channels are sampled like the equivalent uncompressed format
+    switch (image.getFormat())
+    {
+    case SN_BLOCK_BC4: m_pixelFormat = SN_IMAGE_R8; break;
+    case SN_BLOCK_BC5: m_pixelFormat = SN_IMAGE_RG16; break;
+    default: m_pixelFormat = SN_IMAGE_RGBA32; break;
+    }
+
+    GLuint textureID = reinterpret_cast<GLuint>(getHandle());
+    if (textureID == 0)
+    {
+        glCheck(glGenTextures(1, &textureID));
+        m_handle = reinterpret_cast<TextureHandle>(textureID);
+    }
+    if (textureID == 0)
+    {
+        SN_ERROR("Couldn't create texture");
+        return false;
+    }
+
+    bind(this);
+
+    GLenum format = getGLBlockFormat(image.getFormat());
+    for (u32 level = 0; level < m_mipmapCount; ++level)
+    {
+        Vector2u size = image.getMipmapSize(level);
+        const std::vector<u8> & blocks = image.getMipmapBlocks(level);
+        glCheck(glCompressedTexImage2D(GL_TEXTURE_2D, level, format, size.x(), size.y(), 0, blocks.size(), &blocks[0]));
+    }
+    glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_mipmapCount - 1));
+
+    updateSwizzle();
+    updateRepeat();
+    updateFilter();
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void Texture::uploadLevel(u32 level, Vector2u size, const u8 * data)
+{
+    GLPixelFormat f = getGLPixelFormat(m_pixelFormat);
+    if (f.alignment != 4)
+    {
+        glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, f.alignment));
+    }
+    glCheck(glTexImage2D(GL_TEXTURE_2D, level, f.internalFormat, size.x(), size.y(), 0, f.format, f.type, data));
+    if (f.alignment != 4)
+    {
+        glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+    }
+}
+
 //-----------------------------------------------------------------------------
 void Texture::setSmooth(bool enable)
 {
@@ -154,9 +319,24 @@ void Texture::updateFilter()
 {
     // Set upscale and downscale filters
     glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_isSmooth ? GL_LINEAR : GL_NEAREST));
-    glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_isSmooth ? GL_LINEAR : GL_NEAREST));
+    GLint minFilter = m_isSmooth ? GL_LINEAR : GL_NEAREST;
+    if (m_mipmapCount > 1)
+        minFilter = m_isSmooth ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST_MIPMAP_NEAREST;
+    glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter));
 }
 
+//-----------------------------------------------------------------------------
+void Texture::updateSwizzle()
+{
+    // Alpha textures are sampled as white with alpha, so shaders don't need to know about them
+    bool alpha = m_pixelFormat == SN_IMAGE_ALPHA8;
+    glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, alpha ? GL_ONE : GL_RED));
+    glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, alpha ? GL_ONE : GL_GREEN));
+    glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, alpha ? GL_ONE : GL_BLUE));
+    glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, alpha ? GL_RED : GL_ALPHA));
+}
+
+//-----------------------------------------------------------------------------
 void Texture::updateRepeat()
 {
     // Set wrapping for X and Y
@@ -2,9 +2,11 @@
 #define __HEADER_SNR_TEXTURE__
 
 #include <core/math/Vector2.h>
+#include <core/math/Rect.h>
 #include <core/util/SharedRef.h>
 
 #include <modules/image/Image.h>
+#include <modules/image/CompressedImage.h>
 #include <modules/render/common.h>
 
 namespace sn
@@ -27,6 +29,10 @@ public:
     bool uploadToVRAM();
     bool downloadFromVRAM();
 
+    /// \brief Uploads a sub-rectangle of the source image, leaving other pixels as they are.
+    /// If the texture was not created yet, or if the image changed size or format, the whole image is uploaded.
+    bool uploadRegionToVRAM(IntRect rect);
+
     /// \brief Gets the pixels from the texture currently stored in memory.
     /// If the pixels aren't stored or are not up to date with VRAM,
     /// you should call downloadFromVRAM() instead.
@@ -54,6 +60,14 @@ public:
 
     bool create(Vector2u size);
     bool loadFromPixelsRGBA8(Vector2u size, const char * data);
+    bool loadFromPixels(Vector2u size, PixelFormat format, const u8 * data);
+
+    /// \brief Uploads all levels of a block-compressed image.
+    /// The source image, if any, is left as it is.
+    bool loadFromCompressed(const CompressedImage & image);
+
+    /// \brief Tells if the texture is stored compressed in VRAM
+    bool isCompressed() const { return m_isCompressed; }
 
     void setSmooth(bool enable);
     void setRepeated(bool enable);
@@ -61,6 +75,10 @@ public:
     bool isSmooth() const { return m_isSmooth; }
     bool isRepeated() const { return m_isRepeated; }
 
+    /// \brief Gets the number of mipmap levels uploaded to VRAM, including the full size one.
+    /// They are taken from the source image (see Image::generateMipmaps()).
+    u32 getMipmapCount() const { return m_mipmapCount; }
+
     //Texture & operator=(const Texture & other);
 
     static void bind(Texture * tex);
@@ -69,8 +87,10 @@ public:
 private:
     ~Texture(); // use release();
 
+    void uploadLevel(u32 level, Vector2u size, const u8 * data);
     void updateFilter();
     void updateRepeat();
+    void updateSwizzle();
 
 private:
     bool m_isSmooth;
@@ -85,6 +105,12 @@ private:
     /// It is stored here because the source image can be unloaded after upload to VRAM.
     Vector2u m_size;
 
+    /// \brief Format of the pixels in VRAM
+    PixelFormat m_pixelFormat;
+
+    u32 m_mipmapCount;
+    bool m_isCompressed;
+
     /// \brief Implementation-specific handle to the texture object.
     /// In OpenGL this is a GLuint, in D3D11 it would be an ID3D11Texture2D.
     TextureHandle m_handle;
@@ -60,8 +60,13 @@ struct VertexAttribute
 	/// \brief Name of the attribute
 	std::string name;
 
+	/// \brief If true, integer values are mapped to [0,1] (or [-1,1] if signed) when read by shaders.
+	/// Otherwise they are converted to floats as they are.
+	bool normalize;
+
     VertexAttribute():
-        count(0)
+        count(0),
+        normalize(false)
     {}
 
     bool isValid() const { return count != 0; }
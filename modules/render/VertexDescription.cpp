@@ -38,7 +38,7 @@ namespace sn
 		}
 	}
 
-void VertexDescription::addAttribute(const std::string name, u32 use, VertexAttribute::Type type, u32 elemCount)
+void VertexDescription::addAttribute(const std::string name, u32 use, VertexAttribute::Type type, u32 elemCount, bool normalize)
 {
 	SN_ASSERT(elemCount > 0, "An attribute must have at least 1 element");
 	
@@ -49,6 +49,7 @@ void VertexDescription::addAttribute(const std::string name, u32 use, VertexAttr
     //a.offset = m_attributes.empty() ? 0 : m_attributes.back().offset + elemCount * getType(type).size;
     a.index = m_attributes.size();
     a.name = name;
+    a.normalize = normalize;
 
 	m_attributes.push_back(a);
 }
@@ -23,7 +23,7 @@ public:
 
 	const VertexAttributeList & getAttributes() const { return m_attributes; }
 
-	void addAttribute(const std::string name, u32 use, VertexAttribute::Type type, u32 elemCount = 1);
+	void addAttribute(const std::string name, u32 use, VertexAttribute::Type type, u32 elemCount = 1, bool normalize = false);
 
     const VertexAttribute * getAttributeByUse(u32 use) const
     {
@@ -157,7 +157,7 @@ void VideoDriver::drawMesh(const Mesh & mesh)
 
         if (!va.data.empty())
         {
-            glCheck(glVertexAttribPointer(attrib.use, attrib.count, genericTypeToGL(attrib.type), GL_FALSE, 0, va.data.data()));
+            glCheck(glVertexAttribPointer(attrib.use, attrib.count, genericTypeToGL(attrib.type), attrib.normalize ? GL_TRUE : GL_FALSE, 0, va.data.data()));
             glCheck(glEnableVertexAttribArray(attrib.use));
         }
     }
@@ -1,5 +1,11 @@
 #include <core/asset/AssetDatabase.h>
+#include <core/system/filesystem.h>
+#include <core/system/MappedFile.h>
+#include <core/util/stringutils.h>
+#include <iomanip>
+#include <sstream>
 
+#include <modules/image/ImageLoader.hpp>
 #include <modules/render/Texture.h>
 
 #include "TextureLoader.h"
@@ -8,6 +14,84 @@
 namespace sn
 {
 
+namespace
+{
+    /// \brief Where block-compressed textures are saved, relative to the working directory
+    const char * BLOCK_CACHE_PARENT_DIRECTORY = "_cache";
+    const char * BLOCK_CACHE_DIRECTORY = "_cache/textures";
+
+    struct CompressionSettings
+    {
+        BlockFormat format;
+        BlockQuality quality;
+        bool mipmaps;
+        ImageFilter mipmapFilter;
+        bool sRGB;
+        u32 maxSize;
+    };
+
+    /// \brief Reads texture processing options from .meta data
+    /// \return false if the texture is not compressed
+    bool getCompressionSettings(const Variant & metaArgs, CompressionSettings & out_settings)
+    {
+        const std::string & formatName = metaArgs["compression"].getString();
+        if (formatName.empty() || formatName == "none")
+            return false;
+        if (formatName == "bc1")
+            out_settings.format = SN_BLOCK_BC1;
+        else if (formatName == "bc3")
+            out_settings.format = SN_BLOCK_BC3;
+        else if (formatName == "bc4")
+            out_settings.format = SN_BLOCK_BC4;
+        else if (formatName == "bc5")
+            out_settings.format = SN_BLOCK_BC5;
+        else
+        {
+            SN_WARNING("Unknown texture compression \"" << formatName << "\", texture will not be compressed");
+            return false;
+        }
+
+        const std::string & qualityName = metaArgs["compressionQuality"].getString();
+        out_settings.quality = SN_BLOCK_QUALITY_NORMAL;
+        if (qualityName == "fast")
+            out_settings.quality = SN_BLOCK_QUALITY_FAST;
+        else if (qualityName == "high")
+            out_settings.quality = SN_BLOCK_QUALITY_HIGH;
+        return true;
+    }
+
+    ImageFilter getMipmapFilter(const Variant & metaArgs)
+    {
+        const std::string & filterName = metaArgs["mipmapFilter"].getString();
+        if (filterName == "kaiser")
+            return SN_IMAGE_FILTER_KAISER;
+        if (filterName == "lanczos")
+            return SN_IMAGE_FILTER_LANCZOS;
+        if (!filterName.empty() && filterName != "box")
+            SN_WARNING("Unknown mipmap filter \"" << filterName << "\", using box");
+        return SN_IMAGE_FILTER_BOX;
+    }
+
+    /// \brief Hashes the source file and everything that changes the compressed result
+    u64 hashCompressionSource(const String & path, const CompressionSettings & settings)
+    {
+        MappedFile file;
+        u64 hash = file.open(path) ? hashBytes(file.getData(), file.getSize()) : hashBytes(nullptr, 0);
+
+        const u32 options[] = {
+            settings.format, settings.quality, settings.mipmaps, settings.mipmapFilter, settings.sRGB, settings.maxSize
+        };
+        return hashBytes(options, sizeof(options), hash);
+    }
+
+    String getCompressionCachePath(u64 hash)
+    {
+        std::stringstream ss;
+        ss << BLOCK_CACHE_DIRECTORY << "/" << std::hex << std::setw(16) << std::setfill('0') << hash << ".bcn";
+        return toWideString(ss.str());
+    }
+}
+
 SN_OBJECT_IMPL(TextureLoader)
 
 //-----------------------------------------------------------------------------
@@ -61,20 +145,66 @@ bool TextureLoader::load(std::ifstream & ifs, Asset & asset) const
         //}
     }
 
-    // Load image
-    AssetLoader * imageLoader = AssetDatabase::get().findLoader<Image>();
-    if (imageLoader)
+    const Variant & metaArgs = meta.variantData;
+
+    // Mipmaps are computed in linear space unless the image is data, such as normals or heights
+    bool mipmaps = metaArgs["mipmaps"].getBool();
+    ImageFilter mipmapFilter = mipmaps ? getMipmapFilter(metaArgs) : SN_IMAGE_FILTER_BOX;
+    bool sRGB = !metaArgs["linear"].getBool();
+    // Low quality textures can be made smaller while loading
+    u32 maxSize = metaArgs["maxSize"].getInt();
+
+    // Compressed textures are encoded once and then loaded from the cache
+    CompressionSettings compression;
+    bool compress = getCompressionSettings(metaArgs, compression);
+    u64 sourceHash = 0;
+    String cachePath;
+    if (compress)
     {
-        if (!imageLoader->load(ifs, *texture->getImage()))
-            return false;
+        compression.mipmaps = mipmaps;
+        compression.mipmapFilter = mipmapFilter;
+        compression.sRGB = sRGB;
+        compression.maxSize = maxSize;
+        sourceHash = hashCompressionSource(meta.path, compression);
+        cachePath = getCompressionCachePath(sourceHash);
     }
 
     // Set texture flags
-    const Variant & metaArgs = meta.variantData;
     texture->setKeepSourceInMemory(metaArgs["keepInMemory"].getBool());
     texture->setSmooth(metaArgs["smooth"].getBool());
     texture->setRepeated(metaArgs["repeated"].getBool());
 
+    // The source image is still loaded if it has to stay in memory
+    CompressedImage compressed;
+    bool hasBlocks = compress && compressed.loadFromFile(cachePath, sourceHash);
+    if (hasBlocks && !texture->isKeepSourceInMemory())
+        return texture->loadFromCompressed(compressed);
+
+    // Load image, decoded from the mapped file into the pixels the image keeps
+    if (!ImageLoader::loadFromFile(*texture->getImage(), meta.path, maxSize, sRGB))
+        return false;
+
+    if (mipmaps)
+        texture->getImage()->generateMipmaps(mipmapFilter, sRGB);
+
+    if (compress && !hasBlocks)
+    {
+        hasBlocks = compressed.compress(*texture->getImage(), compression.format, compression.quality, Image::getDefaultThreadCount());
+        if (hasBlocks)
+        {
+            makeDir(toWideString(BLOCK_CACHE_PARENT_DIRECTORY));
+            if (makeDir(toWideString(BLOCK_CACHE_DIRECTORY)))
+                compressed.saveToFile(cachePath, sourceHash);
+        }
+    }
+
+    if (hasBlocks)
+    {
+        if (!texture->isKeepSourceInMemory())
+            texture->getImage()->clear();
+        return texture->loadFromCompressed(compressed);
+    }
+
     return texture->uploadToVRAM();
 }
 
@@ -1,6 +1,7 @@
 #include "DrawBatch.h"
 #include <core/system/SystemGUI.h>
 #include <core/util/stringutils.h>
+#include <algorithm>
 
 using namespace sn;
 
@@ -10,22 +11,18 @@ namespace tgui
 //------------------------------------------------------------------------------
 DrawBatch::DrawBatch(sn::VideoDriver & driver):
     r_driver(driver),
-    r_material(nullptr)
+    r_defaultMaterial(nullptr),
+    r_textMaterial(nullptr),
+    r_target(&m_frame),
+    m_frameChanged(false)
 {
-    VertexDescription desc;
-    desc.addAttribute("Position", VertexAttribute::USE_POSITION, VertexAttribute::TYPE_FLOAT32, 3);
-    desc.addAttribute("Texcoord", VertexAttribute::USE_TEXCOORD, VertexAttribute::TYPE_FLOAT32, 2);
-    desc.addAttribute("Color", VertexAttribute::USE_COLOR, VertexAttribute::TYPE_FLOAT32, 4);
-
-    m_mesh = new sn::Mesh();
-    m_mesh->create(desc);
-    m_mesh->setPrimitiveType(SN_MESH_QUADS);
 }
 
 //------------------------------------------------------------------------------
 DrawBatch::~DrawBatch()
 {
-    m_mesh->release();
+    for (u32 i = 0; i < m_meshes.size(); ++i)
+        m_meshes[i]->release();
 }
 
 //------------------------------------------------------------------------------
@@ -42,6 +39,13 @@ void DrawBatch::setProjectionMatrix(const Matrix4 & matrix)
 
 //------------------------------------------------------------------------------
 void DrawBatch::setMaterial(sn::Material & m)
+{
+    m_state.material = &m;
+    m_state.texture = m.getTexture(sn::Material::MAIN_TEXTURE);
+}
+
+//------------------------------------------------------------------------------
+void DrawBatch::applyMaterial(sn::Material & m)
 {
     sn::ShaderProgram * shader = m.getShader();
     if (shader)
@@ -57,42 +61,44 @@ void DrawBatch::setMaterial(sn::Material & m)
         shader->setParam(sn::Material::PROJECTION_MATRIX, m_projectionMatrix);
 
         m.applyParameters();
-
-        r_material = &m;
     }
 }
 
 //------------------------------------------------------------------------------
-void DrawBatch::fillRect(const IntRect & r, const IntRect & texRect, Vector2u ts, Color color)
+void DrawBatch::beginRecord(DrawList & list)
 {
-    std::array<f32, 4 * 3> positions = {
-        static_cast<f32>(r.minX()), static_cast<f32>(r.minY()), 0.f,
-        static_cast<f32>(r.maxX()), static_cast<f32>(r.minY()), 0.f,
-        static_cast<f32>(r.maxX()), static_cast<f32>(r.maxY()), 0.f,
-        static_cast<f32>(r.minX()), static_cast<f32>(r.maxY()), 0.f
-    };
-
-    FloatRect uvRectf = FloatRect::fromMinMax(
-        static_cast<f32>(texRect.minX()) / static_cast<f32>(ts.x()),
-        static_cast<f32>(texRect.minY()) / static_cast<f32>(ts.y()),
-        static_cast<f32>(texRect.maxX()) / static_cast<f32>(ts.x()),
-        static_cast<f32>(texRect.maxY()) / static_cast<f32>(ts.y())
-    );
+    SN_ASSERT(r_target == &m_frame, "Cannot record into two lists at the same time");
+    SN_ASSERT(r_defaultMaterial != nullptr, "Default material is not set");
+    list.clear();
+    r_target = &list;
+    setMaterial(*r_defaultMaterial);
+    m_state.scissorEnabled = false;
+}
 
-    std::array<f32, 4*2> uvs = {
-        uvRectf.minX(), uvRectf.minY(),
-        uvRectf.maxX(), uvRectf.minY(),
-        uvRectf.maxX(), uvRectf.maxY(),
-        uvRectf.minX(), uvRectf.maxY()
-    };
+//------------------------------------------------------------------------------
+void DrawBatch::endRecord()
+{
+    r_target = &m_frame;
+}
 
-    std::array<Color, 4> colors = { color, color, color, color };
+//------------------------------------------------------------------------------
+void DrawBatch::clearFrame()
+{
+    m_frame.clear();
+    m_frameChanged = true;
+}
 
-    Mesh & m = *m_mesh;
-    m.updateArray(VertexAttribute::USE_POSITION, positions, -1);
-    m.updateArray(VertexAttribute::USE_TEXCOORD, uvs, -1);
-    m.updateArray(VertexAttribute::USE_COLOR, colors, -1);
+//------------------------------------------------------------------------------
+void DrawBatch::append(const DrawList & list)
+{
+    m_frame.append(list);
+    m_frameChanged = true;
+}
 
+//------------------------------------------------------------------------------
+void DrawBatch::fillRect(const IntRect & r, const IntRect & texRect, Vector2u ts, Color color)
+{
+    r_target->addQuad(m_state, r, texRect, ts, Color8(color));
 }
 
 //------------------------------------------------------------------------------
@@ -194,58 +200,84 @@ void DrawBatch::drawTextLine(
 )
 /////////////////////////////////
 {
-    // TODO Optimize: we can pre-allocate a bunch of quads in the mesh rather than adding vertices one by one
-
-    if (r_material == nullptr)
+    if (m_state.material == nullptr)
         return;
     if (charCount == 0)
         return;
     SN_ASSERT(str != nullptr, "Reveived null string");
 
-    sn::Texture * tex = font.getTexture(format);
-    if (tex == nullptr)
-        return;
-
-    // TODO Improve DrawBatch so we don't have to swap textures like this?
+    // Get glyphs before adding quads, because rasterizing new ones changes the font's textures
+    m_glyphs.clear();
+    s32 width = 0;
+    for (u32 i = 0; i < charCount; ++i)
+    {
+        char c = str[i];
+        if (!isEOL(c))
+        {
+            m_glyphs.push_back(font.getGlyph(c, format));
+            width += m_glyphs.back().advance;
+        }
+    }
+    // Quads are drawn later, but glyph rectangles are final.
+    // If the atlas layout changed, the GUI records its geometry again (see Font::getAtlasVersion()).
+    addUsedFont(font);
 
+    sn::Material * lastMaterial = nullptr;
     sn::Texture * lastTexture = nullptr;
     if (swapFontTexture)
     {
-        lastTexture = getTexture();
-        setTexture(tex);
+        lastMaterial = beginTextMaterial(font);
+        if (lastMaterial == nullptr)
+            lastTexture = getTexture();
     }
-    
-    Vector2u ts = tex->getSize();
 
     Vector2i pos = area.origin();
     pos.y() += font.getLineHeight(format.size);
 
     if (align != TGUI_ALIGN_LEFT)
     {
-        s32 w = font.getLineWidth(str, charCount, format);
         if (align == TGUI_ALIGN_RIGHT)
-            pos.x() = area.maxX() - w;
+            pos.x() = area.maxX() - width;
         else
-            pos.x() = area.x() + (area.width() - w) / 2;
+            pos.x() = area.x() + (area.width() - width) / 2;
     }
 
-    for (u32 i = 0; i < charCount; ++i)
-    {
-        char c = str[i];
-        if (!isEOL(c))
-        {
-            const Glyph & glyph = font.getGlyph(c, format);
-
-            IntRect rect = glyph.bounds;
-            rect.origin() += pos;
+    // Glyphs can be on different pages of the font atlas
+    sn::Texture * tex = nullptr;
+    Vector2u ts;
+    u32 page = static_cast<u32>(-1);
 
-            fillRect(rect, glyph.imageRect, ts, color);
+    for (u32 i = 0; i < m_glyphs.size(); ++i)
+    {
+        const Glyph & glyph = m_glyphs[i];
 
-            pos.x() += glyph.advance;
+        if (glyph.imageRect.width() > 0)
+        {
+            if (glyph.page != page)
+            {
+                page = glyph.page;
+                tex = font.getPageTexture(page);
+                if (tex)
+                {
+                    setTexture(tex);
+                    ts = tex->getSize();
+                }
+            }
+
+            if (tex)
+            {
+                IntRect rect = glyph.bounds;
+                rect.origin() += pos;
+                fillRect(rect, glyph.imageRect, ts, color);
+            }
         }
+
+        pos.x() += glyph.advance;
     }
 
-    if (swapFontTexture)
+    if (lastMaterial)
+        endTextMaterial(lastMaterial);
+    else if (swapFontTexture)
         setTexture(lastTexture);
 }
 
@@ -261,14 +293,11 @@ void DrawBatch::drawText(
 )
 /////////////////////////////////
 {
-    sn::Texture * tex = font.getTexture(format);
-    if (tex == nullptr)
-        return;
-
     s32 lineHeight = font.getLineHeight(format.size);
 
-    sn::Texture * lastTexture = getTexture();
-    setTexture(tex);
+    // Lines set the textures of the font pages they use
+    sn::Material * lastMaterial = beginTextMaterial(font);
+    sn::Texture * lastTexture = lastMaterial ? nullptr : getTexture();
 
     for (u32 i = 0; i < model.getLineCount(); ++i)
     {
@@ -282,7 +311,7 @@ void DrawBatch::drawText(
             format,
             align,
             color,
-            false // Don't set the font's texture (batching)
+            false // Don't restore the texture after each line (batching)
         );
 
         if (lineHeight > area.height())
@@ -291,12 +320,17 @@ void DrawBatch::drawText(
         area.height() -= lineHeight;
     }
 
-    setTexture(lastTexture);
+    if (lastMaterial)
+        endTextMaterial(lastMaterial);
+    else
+        setTexture(lastTexture);
 }
 
 //------------------------------------------------------------------------------
 void DrawBatch::drawText(
     const TextWrapper & wrapper,
+    GlyphRunCache & runs,
+    sn::u32 firstRow,
     sn::IntRect area,
     const Font & font,
     FontFormat format,
@@ -304,99 +338,241 @@ void DrawBatch::drawText(
     sn::Color color
     )
 {
-    sn::Texture * tex = font.getTexture(format);
-    if (tex == nullptr)
+    if (m_state.material == nullptr)
         return;
-
     s32 lineHeight = font.getLineHeight(format.size);
+    if (lineHeight <= 0)
+        return;
 
-    sn::Texture * lastTexture = getTexture();
-    setTexture(tex);
-
-    const TextModel & model = wrapper.getTextModel();
+    // Rows set the textures of the font pages they use
+    sn::Material * lastMaterial = beginTextMaterial(font);
+    sn::Texture * lastTexture = lastMaterial ? nullptr : getTexture();
 
-    for (u32 i = 0; i < wrapper.getWrapCount(); ++i)
+    // Rows below the area are not visited at all
+    s32 y = area.y();
+    for (u32 i = firstRow; i < wrapper.getWrapCount() && y < area.maxY(); ++i)
     {
         TextWrapper::Wrap wrap = wrapper.getWrap(i);
+        const GlyphRunCache::Run & run = runs.getRun(wrap.line, font, format);
 
-        const std::string & line = model.getLine(wrap.line);
+        s32 begin = run.getX(wrap.begin);
+        s32 width = run.getX(wrap.end) - begin;
+        Vector2i origin(area.x() - begin, y + lineHeight);
+        if (align == TGUI_ALIGN_RIGHT)
+            origin.x() += area.width() - width;
+        else if (align == TGUI_ALIGN_CENTER)
+            origin.x() += (area.width() - width) / 2;
 
-        drawTextLine(
-            line.c_str() + wrap.begin,
-            wrap.end - wrap.begin,
-            area,
-            font,
-            format,
-            align,
-            color,
-            false // Don't set the font's texture (batching)
-        );
+        drawGlyphs(run, wrap.begin, wrap.end, origin, font, color);
 
-        if (lineHeight > area.height())
-            break;
-        area.y() += lineHeight;
-        area.height() -= lineHeight;
+        y += lineHeight;
     }
 
-    setTexture(lastTexture);
+    // Quads are drawn later, but glyph rectangles are final.
+    // If the atlas layout changed, the GUI records its geometry again.
+    addUsedFont(font);
+
+    if (lastMaterial)
+        endTextMaterial(lastMaterial);
+    else
+        setTexture(lastTexture);
 }
 
 //------------------------------------------------------------------------------
-void DrawBatch::setTexture(sn::Texture * tex)
+void DrawBatch::drawGlyphs(
+    const GlyphRunCache::Run & run,
+    sn::u32 begin,
+    sn::u32 end,
+    sn::Vector2i origin,
+    const Font & font,
+    sn::Color color
+    )
 {
-    SN_ASSERT(r_material != nullptr, "Cannot set texture when material is not set");
-    
-    const sn::Texture * lastTexture = r_material->getTexture(sn::Material::MAIN_TEXTURE);
-    if (tex != lastTexture)
+    sn::Texture * tex = nullptr;
+    Vector2u ts;
+    u32 page = static_cast<u32>(-1);
+
+    for (u32 i = begin; i < end && i < run.glyphs.size(); ++i)
     {
-        flush();
-        r_material->setTexture(sn::Material::MAIN_TEXTURE, tex);
-        // TODO Needed to update uniforms...
-        setMaterial(*r_material);
+        const GlyphRunCache::PlacedGlyph & glyph = run.glyphs[i];
+        if (glyph.imageRect.width() <= 0)
+            continue;
+
+        if (glyph.page != page)
+        {
+            page = glyph.page;
+            tex = font.getPageTexture(page);
+            if (tex)
+            {
+                setTexture(tex);
+                ts = tex->getSize();
+            }
+        }
+
+        if (tex)
+        {
+            IntRect rect = glyph.bounds;
+            rect.x() += origin.x() + glyph.x;
+            rect.y() += origin.y();
+            fillRect(rect, glyph.imageRect, ts, color);
+        }
     }
 }
 
+//------------------------------------------------------------------------------
+void DrawBatch::setTexture(sn::Texture * tex)
+{
+    SN_ASSERT(m_state.material != nullptr, "Cannot set texture when material is not set");
+    m_state.texture = tex;
+}
+
 //------------------------------------------------------------------------------
 sn::Texture * DrawBatch::getTexture() const
 {
-    SN_ASSERT(r_material != nullptr, "Cannot get texture when material is not set");
-    return r_material->getTexture(sn::Material::MAIN_TEXTURE);
+    SN_ASSERT(m_state.material != nullptr, "Cannot get texture when material is not set");
+    return m_state.texture;
+}
+
+//------------------------------------------------------------------------------
+sn::Material * DrawBatch::beginTextMaterial(const Font & font)
+{
+    // Distance field glyphs need a shader thresholding their alpha
+    if (!font.isDistanceField() || r_textMaterial == nullptr || r_textMaterial == m_state.material)
+        return nullptr;
+
+    sn::Material * previous = m_state.material;
+    setMaterial(*r_textMaterial);
+    return previous;
 }
 
 //------------------------------------------------------------------------------
-void DrawBatch::setScissor(sn::IntRect rect, u32 windowID)
+void DrawBatch::endTextMaterial(sn::Material * previous)
 {
-    // The batch must be flushed before because previous geometry is not necessarily affected by scissor
-    flush();
+    setMaterial(*previous);
+}
 
+//------------------------------------------------------------------------------
+void DrawBatch::setScissor(sn::IntRect rect)
+{
     if (rect.width() < 0)
         rect.width() = 0;
     if (rect.height() < 0)
         rect.height() = 0;
 
-    sn::Window * win = SystemGUI::get().getWindowByID(windowID);
-    if (win)
+    // Converted to OpenGL coordinates when drawn, so resizing the window doesn't invalidate it
+    m_state.scissor = rect;
+    m_state.scissorEnabled = true;
+}
+
+//------------------------------------------------------------------------------
+void DrawBatch::disableScissor()
+{
+    m_state.scissorEnabled = false;
+}
+
+//------------------------------------------------------------------------------
+void DrawBatch::updateMeshes()
+{
+    const std::vector<DrawList::Run> & runs = m_frame.getRuns();
+    const std::vector<s16> & positions = m_frame.getPositions();
+    const std::vector<u16> & texCoords = m_frame.getTexCoords();
+    const std::vector<Color8> & colors = m_frame.getColors();
+
+    while (m_meshes.size() < runs.size())
+    {
+        VertexDescription desc;
+        desc.addAttribute("Position", VertexAttribute::USE_POSITION, VertexAttribute::TYPE_INT16, 2);
+        desc.addAttribute("Texcoord", VertexAttribute::USE_TEXCOORD, VertexAttribute::TYPE_UINT16, 2, true);
+        desc.addAttribute("Color", VertexAttribute::USE_COLOR, VertexAttribute::TYPE_UINT8, 4, true);
+
+        sn::Mesh * mesh = new sn::Mesh();
+        mesh->create(desc);
+        mesh->setPrimitiveType(SN_MESH_QUADS);
+        m_meshes.push_back(mesh);
+    }
+
+    for (u32 i = 0; i < runs.size(); ++i)
     {
-        Vector2u winSize = win->getClientSize();
-        rect.y() = static_cast<s32>(winSize.y()) - rect.y() - rect.height();
-        r_driver.setScissor(rect);
+        const DrawList::Run & run = runs[i];
+        u32 begin = run.firstVertex;
+        u32 end = begin + run.vertexCount;
+
+        m_runPositions.assign(positions.begin() + 2 * begin, positions.begin() + 2 * end);
+        m_runTexCoords.assign(texCoords.begin() + 2 * begin, texCoords.begin() + 2 * end);
+        m_runColors.assign(colors.begin() + begin, colors.begin() + end);
+
+        sn::Mesh & m = *m_meshes[i];
+        m.clear();
+        m.updateArray(VertexAttribute::USE_POSITION, m_runPositions);
+        m.updateArray(VertexAttribute::USE_TEXCOORD, m_runTexCoords);
+        m.updateArray(VertexAttribute::USE_COLOR, m_runColors);
+        m.recalculateIndices();
     }
+
+    m_frameChanged = false;
 }
 
 //------------------------------------------------------------------------------
-void DrawBatch::disableScissor()
+void DrawBatch::addUsedFont(const Font & font)
 {
-    flush();
-    r_driver.disableScissor();
+    if (std::find(m_usedFonts.begin(), m_usedFonts.end(), &font) == m_usedFonts.end())
+        m_usedFonts.push_back(&font);
 }
 
 //------------------------------------------------------------------------------
-void DrawBatch::flush()
+void DrawBatch::uploadGlyphs()
 {
-    sn::Mesh & m = *m_mesh;
-    m.recalculateIndices();
-    r_driver.drawMesh(m);
-    m.clear();
+    for (u32 i = 0; i < m_usedFonts.size(); ++i)
+    {
+        const Font & font = *m_usedFonts[i];
+        if (font.hasPendingUploads())
+            font.uploadGlyphs();
+    }
+    m_usedFonts.clear();
+}
+
+//------------------------------------------------------------------------------
+void DrawBatch::submit(u32 windowID)
+{
+    if (m_frameChanged)
+        updateMeshes();
+
+    Vector2u winSize;
+    sn::Window * win = SystemGUI::get().getWindowByID(windowID);
+    if (win)
+        winSize = win->getClientSize();
+
+    const std::vector<DrawList::Run> & runs = m_frame.getRuns();
+    for (u32 i = 0; i < runs.size(); ++i)
+    {
+        const DrawState & state = runs[i].state;
+        if (state.material == nullptr)
+            continue;
+
+        // Materials are shared with the theme, so their texture is only swapped while parameters are applied
+        sn::Material & material = *state.material;
+        sn::Texture * lastTexture = material.getTexture(sn::Material::MAIN_TEXTURE);
+        if (lastTexture != state.texture)
+            material.setTexture(sn::Material::MAIN_TEXTURE, state.texture);
+        applyMaterial(material);
+        if (lastTexture != state.texture)
+            material.setTexture(sn::Material::MAIN_TEXTURE, lastTexture);
+
+        if (state.scissorEnabled)
+        {
+            IntRect rect = state.scissor;
+            rect.y() = static_cast<s32>(winSize.y()) - rect.y() - rect.height();
+            r_driver.setScissor(rect);
+        }
+        else
+        {
+            r_driver.disableScissor();
+        }
+
+        r_driver.drawMesh(*m_meshes[i]);
+    }
+
+    r_driver.disableScissor();
 }
 
 } // namespace tgui
@@ -9,12 +9,19 @@
 #include <modules/freetype/Font.hpp>
 
 #include "Border.h"
+#include "DrawList.h"
 #include "TextAlignment.h"
 #include "TextWrapper.h"
+#include "GlyphRunCache.h"
 
 namespace tgui
 {
 
+/// \brief Tessellates GUI geometry and draws it.
+/// Quads are not drawn immediately: they are recorded into DrawLists, which controls keep
+/// as long as they are not invalidated. Lists are then appended to the frame, which is
+/// drawn by submit() with one draw call per run of quads sharing the same texture and scissor.
+/// The frame is kept as meshes, so drawing it again without changes costs no tessellation.
 class DrawBatch
 {
 public:
@@ -24,9 +31,43 @@ public:
     void setViewMatrix(const sn::Matrix4 & matrix);
     void setProjectionMatrix(const sn::Matrix4 & matrix);
 
+    /// \brief Sets the material new recordings start with
+    void setDefaultMaterial(sn::Material & m) { r_defaultMaterial = &m; }
+
+    /// \brief Sets the material of next quads. Their texture becomes the main texture of the material.
     void setMaterial(sn::Material & m);
-    void flush();
-    
+
+    /// \brief Sets the material used to draw text of distance field fonts.
+    /// If null, such text is drawn with the current material.
+    void setTextMaterial(sn::Material * m) { r_textMaterial = m; }
+
+    //--------------------------------
+    // Recording
+    //--------------------------------
+
+    /// \brief Starts recording quads into a list, replacing its content.
+    /// The render state is reset to the default material without scissor.
+    void beginRecord(DrawList & list);
+    void endRecord();
+
+    /// \brief Removes everything from the frame
+    void clearFrame();
+
+    /// \brief Appends recorded quads to the frame
+    void append(const DrawList & list);
+
+    /// \brief Copies glyphs rasterized while recording into the textures of their fonts.
+    /// Called once per frame before submit(), so each font page gets at most one upload.
+    void uploadGlyphs();
+
+    /// \brief Draws the frame.
+    /// \param windowID: window the frame is drawn into, used to convert scissor rectangles
+    void submit(sn::u32 windowID);
+
+    //--------------------------------
+    // Tessellation
+    //--------------------------------
+
     void fillRect(
         const sn::IntRect & r, 
         const sn::IntRect & texRect, 
@@ -62,8 +103,12 @@ public:
         sn::Color color = sn::Color(1,1,1,1)
     );
 
+    /// \brief Draws rows of wrapped text from firstRow until the bottom of the area.
+    /// Glyphs come from the cache, so only lines of drawn rows are shaped.
     void drawText(
         const TextWrapper & wrapper,
+        GlyphRunCache & runs,
+        sn::u32 firstRow,
         sn::IntRect area,
         const sn::Font & font,
         sn::FontFormat format,
@@ -71,20 +116,68 @@ public:
         sn::Color color = sn::Color(1,1,1,1)
     );
 
-    void setScissor(sn::IntRect rect, sn::u32 windowID);
+    /// \brief Clips next quads to a rectangle given in window coordinates
+    void setScissor(sn::IntRect rect);
     void disableScissor();
 
 private:
     void setTexture(sn::Texture * tex);
     sn::Texture * getTexture() const;
 
+    /// \brief Switches to the text material if the font needs it.
+    /// \return the previous material if it was switched, null otherwise
+    sn::Material * beginTextMaterial(const sn::Font & font);
+    void endTextMaterial(sn::Material * previous);
+
+    /// \brief Remembers a font drawn with, so its new glyphs get uploaded by uploadGlyphs()
+    void addUsedFont(const sn::Font & font);
+
+    /// \brief Draws characters [begin, end) of a shaped line.
+    /// \param origin: position of the first character on the baseline
+    void drawGlyphs(
+        const GlyphRunCache::Run & run,
+        sn::u32 begin,
+        sn::u32 end,
+        sn::Vector2i origin,
+        const sn::Font & font,
+        sn::Color color
+    );
+
+    /// \brief Converts runs of the frame into meshes
+    void updateMeshes();
+
+    void applyMaterial(sn::Material & m);
+
 private:
-    sn::Mesh * m_mesh;
     sn::VideoDriver & r_driver;
-    sn::Material * r_material;
+    sn::Material * r_defaultMaterial;
+    sn::Material * r_textMaterial;
     sn::Matrix4 m_viewMatrix;
     sn::Matrix4 m_projectionMatrix;
 
+    /// \brief State of next quads
+    DrawState m_state;
+
+    /// \brief List receiving quads. Quads go to the frame when nothing is being recorded.
+    DrawList * r_target;
+
+    DrawList m_frame;
+    bool m_frameChanged;
+
+    /// \brief One mesh per run of the frame
+    std::vector<sn::Mesh*> m_meshes;
+
+    // Packed vertices of the run being converted
+    std::vector<sn::s16> m_runPositions;
+    std::vector<sn::u16> m_runTexCoords;
+    std::vector<sn::Color8> m_runColors;
+
+    // Glyphs of the line being drawn
+    std::vector<sn::Glyph> m_glyphs;
+
+    /// \brief Fonts text was recorded with since the last uploadGlyphs()
+    std::vector<const sn::Font*> m_usedFonts;
+
 };
 
 } // namespace tgui
@@ -0,0 +1,110 @@
+#include "DrawList.h"
+#include <core/math/math.h>
+
+using namespace sn;
+
+namespace tgui
+{
+
+namespace
+{
+    s16 packPosition(s32 x)
+    {
+        return static_cast<s16>(math::clamp(x, -32768, 32767));
+    }
+
+    u16 packTexCoord(s32 x, u32 size)
+    {
+        if (size == 0)
+            return 0;
+        s32 v = static_cast<s32>((static_cast<s64>(x) * 65535 + size / 2) / size);
+        return static_cast<u16>(math::clamp(v, 0, 65535));
+    }
+}
+
+//------------------------------------------------------------------------------
+bool DrawState::operator==(const DrawState & other) const
+{
+    if (material != other.material || texture != other.texture || scissorEnabled != other.scissorEnabled)
+        return false;
+    // The rectangle doesn't matter when scissor is disabled
+    if (!scissorEnabled)
+        return true;
+    return scissor.origin() == other.scissor.origin() && scissor.size() == other.scissor.size();
+}
+
+//------------------------------------------------------------------------------
+void DrawList::clear()
+{
+    m_runs.clear();
+    m_positions.clear();
+    m_texCoords.clear();
+    m_colors.clear();
+}
+
+//------------------------------------------------------------------------------
+DrawList::Run & DrawList::requireRun(const DrawState & state, u32 firstVertex)
+{
+    if (m_runs.empty() || m_runs.back().state != state)
+    {
+        Run run;
+        run.state = state;
+        run.firstVertex = firstVertex;
+        run.vertexCount = 0;
+        m_runs.push_back(run);
+    }
+    return m_runs.back();
+}
+
+//------------------------------------------------------------------------------
+void DrawList::addQuad(const DrawState & state, const IntRect & rect, const IntRect & texRect, Vector2u ts, Color8 color)
+{
+    Run & run = requireRun(state, m_colors.size());
+
+    const s16 minX = packPosition(rect.minX());
+    const s16 minY = packPosition(rect.minY());
+    const s16 maxX = packPosition(rect.maxX());
+    const s16 maxY = packPosition(rect.maxY());
+    const s16 positions[] = {
+        minX, minY,
+        maxX, minY,
+        maxX, maxY,
+        minX, maxY
+    };
+    m_positions.insert(m_positions.end(), positions, positions + 8);
+
+    const u16 minU = packTexCoord(texRect.minX(), ts.x());
+    const u16 minV = packTexCoord(texRect.minY(), ts.y());
+    const u16 maxU = packTexCoord(texRect.maxX(), ts.x());
+    const u16 maxV = packTexCoord(texRect.maxY(), ts.y());
+    const u16 texCoords[] = {
+        minU, minV,
+        maxU, minV,
+        maxU, maxV,
+        minU, maxV
+    };
+    m_texCoords.insert(m_texCoords.end(), texCoords, texCoords + 8);
+
+    m_colors.insert(m_colors.end(), 4, color);
+
+    run.vertexCount += 4;
+}
+
+//------------------------------------------------------------------------------
+void DrawList::append(const DrawList & other)
+{
+    const u32 offset = m_colors.size();
+    for (u32 i = 0; i < other.m_runs.size(); ++i)
+    {
+        const Run & src = other.m_runs[i];
+        Run & run = requireRun(src.state, offset + src.firstVertex);
+        run.vertexCount += src.vertexCount;
+    }
+
+    m_positions.insert(m_positions.end(), other.m_positions.begin(), other.m_positions.end());
+    m_texCoords.insert(m_texCoords.end(), other.m_texCoords.begin(), other.m_texCoords.end());
+    m_colors.insert(m_colors.end(), other.m_colors.begin(), other.m_colors.end());
+}
+
+} // namespace tgui
+
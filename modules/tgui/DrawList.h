@@ -0,0 +1,101 @@
+#ifndef __HEADER_TGUI_DRAWLIST__
+#define __HEADER_TGUI_DRAWLIST__
+
+#include <core/math/Rect.h>
+#include <core/math/Color.h>
+#include <core/math/Vector2.h>
+#include <vector>
+
+namespace sn
+{
+    class Material;
+    class Texture;
+}
+
+namespace tgui
+{
+
+/// \brief Render state shared by consecutive quads of a DrawList
+struct DrawState
+{
+    sn::Material * material;
+    sn::Texture * texture;
+
+    /// \brief Scissor rectangle in window coordinates (Y pointing down)
+    sn::IntRect scissor;
+    bool scissorEnabled;
+
+    DrawState() :
+        material(nullptr),
+        texture(nullptr),
+        scissorEnabled(false)
+    {}
+
+    bool operator==(const DrawState & other) const;
+    bool operator!=(const DrawState & other) const { return !(*this == other); }
+};
+
+/// \brief Quads recorded by DrawBatch, stored with packed vertices:
+/// positions as 16-bit integers, texture coordinates as normalized 16-bit integers
+/// and colors as normalized bytes.
+/// Controls keep one so their geometry is only tessellated again when they are invalidated,
+/// and the GUI concatenates them into runs of quads sharing the same render state.
+class DrawList
+{
+public:
+    /// \brief Range of vertices drawn with the same render state
+    struct Run
+    {
+        DrawState state;
+        sn::u32 firstVertex;
+        sn::u32 vertexCount;
+    };
+
+    /// \brief Removes all quads. Memory is kept for the next recording.
+    void clear();
+
+    bool isEmpty() const { return m_colors.empty(); }
+    sn::u32 getVertexCount() const { return m_colors.size(); }
+
+    /// \brief Adds a quad
+    /// \param rect: rectangle covered by the quad, in pixels
+    /// \param texRect: rectangle of the texture, in pixels
+    /// \param ts: size of the texture
+    void addQuad(
+        const DrawState & state,
+        const sn::IntRect & rect,
+        const sn::IntRect & texRect,
+        sn::Vector2u ts,
+        sn::Color8 color
+    );
+
+    /// \brief Adds all quads of another list.
+    /// Runs of the same state at the junction are merged.
+    void append(const DrawList & other);
+
+    const std::vector<Run> & getRuns() const { return m_runs; }
+
+    /// \brief X, Y pairs
+    const std::vector<sn::s16> & getPositions() const { return m_positions; }
+
+    /// \brief U, V pairs, where 65535 maps to 1
+    const std::vector<sn::u16> & getTexCoords() const { return m_texCoords; }
+
+    const std::vector<sn::Color8> & getColors() const { return m_colors; }
+
+private:
+    /// \brief Gets the run new vertices of the given state go to
+    /// \param firstVertex: index of the first vertex if a run has to be created
+    Run & requireRun(const DrawState & state, sn::u32 firstVertex);
+
+private:
+    std::vector<Run> m_runs;
+    std::vector<sn::s16> m_positions;
+    std::vector<sn::u16> m_texCoords;
+    std::vector<sn::Color8> m_colors;
+};
+
+} // namespace tgui
+
+#endif // __HEADER_TGUI_DRAWLIST__
+
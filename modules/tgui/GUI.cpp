@@ -8,6 +8,8 @@
 #include "GUI.h"
 #include "DrawBatch.h"
 
+#include <algorithm>
+
 using namespace sn;
 
 namespace tgui
@@ -20,7 +22,13 @@ GUI::GUI():
 	m_defaultTheme(nullptr),
 	r_captureControl(nullptr),
     r_focusControl(nullptr),
-    m_clearMask(sn::SNR_CLEAR_NONE)
+    m_clearMask(sn::SNR_CLEAR_NONE),
+    m_batch(nullptr),
+    m_frameDirty(true),
+    r_drawnTheme(nullptr),
+    r_drawnMaterial(nullptr),
+    m_drawnAtlasVersion(0),
+    m_hitIndexDirty(true)
 {
     m_defaultTheme = new Theme();
 }
@@ -29,6 +37,8 @@ GUI::GUI():
 GUI::~GUI()
 {
     delete m_defaultTheme;
+    if (m_batch)
+        delete m_batch;
 }
 
 //------------------------------------------------------------------------------
@@ -57,7 +67,7 @@ void GUI::onReady()
     {
         sn::Vector2u size = window->getClientSize();
         setLocalClientBounds(sn::IntRect::fromPositionSize(0, 0, size.x(), size.y()));
-        layoutChildren();
+        invalidateLayout();
     }
 
     listenToSystemEvents();
@@ -79,6 +89,8 @@ void GUI::draw(sn::VideoDriver & driver)
 {
     SN_BEGIN_PROFILE_SAMPLE_NAMED("TGUI draw");
 
+    updateLayout();
+
     const Theme & theme = getTheme();
 
     sn::Material * themeMaterial = theme.getMaterial();
@@ -114,13 +126,40 @@ void GUI::draw(sn::VideoDriver & driver)
 
                     driver.setViewport(0, 0, screenSize.x(), screenSize.y());
 
-                    DrawBatch batch(driver);
+                    if (m_batch == nullptr)
+                        m_batch = new DrawBatch(driver);
+                    DrawBatch & batch = *m_batch;
                     batch.setProjectionMatrix(projection);
                     batch.setViewMatrix(view);
-                    batch.setMaterial(*themeMaterial);
+                    batch.setDefaultMaterial(*themeMaterial);
+                    batch.setTextMaterial(theme.getTextMaterial());
+
+                    // Recorded geometry refers to the theme and to glyph rectangles in the font atlas
+                    const Font * font = theme.getFont();
+                    u32 atlasVersion = font ? font->getAtlasVersion() : 0;
+                    if (&theme != r_drawnTheme || themeMaterial != r_drawnMaterial || atlasVersion != m_drawnAtlasVersion)
+                    {
+                        invalidateDrawTree();
+                        r_drawnTheme = &theme;
+                        r_drawnMaterial = themeMaterial;
+                    }
 
-                    onDraw(batch);
-                    batch.flush();
+                    if (m_frameDirty)
+                    {
+                        recordFrame(batch);
+
+                        // Glyphs rasterized while recording may have moved others in the atlas
+                        if (font && font->getAtlasVersion() != atlasVersion)
+                        {
+                            invalidateDrawTree();
+                            recordFrame(batch);
+                        }
+                        m_drawnAtlasVersion = font ? font->getAtlasVersion() : 0;
+                    }
+
+                    // Glyphs rasterized by all controls are uploaded together
+                    batch.uploadGlyphs();
+                    batch.submit(getWindowID());
                 }
             }
         }
@@ -129,6 +168,18 @@ void GUI::draw(sn::VideoDriver & driver)
     SN_END_PROFILE_SAMPLE();
 }
 
+//------------------------------------------------------------------------------
+void GUI::recordFrame(DrawBatch & batch)
+{
+    SN_BEGIN_PROFILE_SAMPLE_NAMED("TGUI record");
+
+    batch.clearFrame();
+    onDraw(batch);
+    m_frameDirty = false;
+
+    SN_END_PROFILE_SAMPLE();
+}
+
 //------------------------------------------------------------------------------
 void GUI::setCapture(Control * captureControl)
 {
@@ -151,20 +202,34 @@ bool GUI::onSystemEvent(const sn::Event & systemEvent)
 
         if (ev.value.type == SN_EVENT_WINDOW_RESIZED)
         {
-            // Fill the window
+            // Fill the window. Layout is deferred, so a burst of resize events is laid out once.
             setLocalClientBounds(sn::IntRect::fromPositionSize(0, 0, ev.value.window.width, ev.value.window.height));
-            layoutChildren();
+            invalidateLayout();
         }
         else if (r_captureControl)
         {
+            // Controls handle events with up to date bounds
+            updateLayout();
 			r_captureControl->onEvent(ev);
         }
         else
         {
-	        dispatchEventToChildren(ev);
-            if (!ev.consumed && systemEvent.type == SN_EVENT_MOUSE_MOVED)
+            updateLayout();
+            if (systemEvent.type == SN_EVENT_MOUSE_MOVED)
+            {
+                // Only controls under the mouse are visited
+                updateHitIndex();
+                dispatchMouseMove(ev);
+                if (!ev.consumed)
+                    onSetCursor(ev);
+            }
+            else if (systemEvent.type == SN_EVENT_MOUSE_DOWN)
+            {
+                dispatchMousePress(ev);
+            }
+            else
             {
-                onSetCursor(ev);
+	            dispatchEventToChildren(ev);
             }
         }
 
@@ -173,6 +238,150 @@ bool GUI::onSystemEvent(const sn::Event & systemEvent)
     return false;
 }
 
+//------------------------------------------------------------------------------
+void GUI::invalidateHitArea(Control & c)
+{
+    // A rebuild will include the new position anyway
+    if (m_hitIndexDirty || c.m_hitAreaMoved)
+        return;
+    c.m_hitAreaMoved = true;
+    m_movedControls.push_back(&c);
+}
+
+//------------------------------------------------------------------------------
+void GUI::onControlRemoved(Control & c)
+{
+    invalidateHitIndex();
+
+    // Forget the control and its children, which come before it in paths
+    std::vector<Control*> * paths[] = { &m_hoverPath, &m_hitPath };
+    for (u32 p = 0; p < 2; ++p)
+    {
+        std::vector<Control*> & path = *paths[p];
+        auto it = std::find(path.begin(), path.end(), &c);
+        if (it != path.end())
+            path.erase(path.begin(), it + 1);
+    }
+}
+
+//------------------------------------------------------------------------------
+void GUI::updateHitIndex()
+{
+    // Cells depend on the size of the window
+    if (m_hitIndex.getWindowSize() != getSize())
+        m_hitIndexDirty = true;
+
+    if (m_hitIndexDirty)
+    {
+        // Moved controls may have been destroyed since, so they are not dereferenced.
+        // Their flag is reset while visiting the tree.
+        m_movedControls.clear();
+        m_hitIndex.clear(getSize());
+
+        Vector2i origin = getPosition();
+        for (u32 i = 0; i < getChildCount(); ++i)
+        {
+            Control * child = Object::cast<Control>(getChildByIndex(i));
+            if (child)
+                child->addHitAreas(m_hitIndex, HitIndex::NONE, origin);
+        }
+        m_hitIndexDirty = false;
+    }
+    else
+    {
+        for (u32 i = 0; i < m_movedControls.size(); ++i)
+        {
+            // Already updated if one of its parents moved too
+            Control & c = *m_movedControls[i];
+            if (c.m_hitAreaMoved)
+            {
+                Control * parent = c.getParentControl();
+                c.updateHitAreas(m_hitIndex, parent ? parent->getPosition() : Vector2i());
+            }
+        }
+        m_movedControls.clear();
+    }
+}
+
+//------------------------------------------------------------------------------
+Control * GUI::getControlAt(sn::Vector2i position)
+{
+    updateLayout();
+    updateHitIndex();
+    u32 i = m_hitIndex.hitTest(position);
+    return i != HitIndex::NONE ? m_hitIndex.getControl(i) : nullptr;
+}
+
+//------------------------------------------------------------------------------
+void GUI::getHitPath(sn::Vector2i position, std::vector<Control*> & out_path)
+{
+    out_path.clear();
+    for (u32 i = m_hitIndex.hitTest(position); i != HitIndex::NONE; i = m_hitIndex.getParent(i))
+        out_path.push_back(m_hitIndex.getControl(i));
+
+    // Disabled controls and their children don't receive events
+    for (u32 i = out_path.size(); i-- > 0;)
+    {
+        if (!out_path[i]->isEnabledSelf())
+        {
+            out_path.erase(out_path.begin(), out_path.begin() + i + 1);
+            break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void GUI::dispatchMouseMove(Event & ev)
+{
+    getHitPath(Vector2i(ev.value.mouse.x, ev.value.mouse.y), m_hitPath);
+
+    // Only controls of the previous and current paths can change hover state
+    for (u32 i = 0; i < m_hoverPath.size(); ++i)
+    {
+        Control & c = *m_hoverPath[i];
+        if (c.isHovered() && std::find(m_hitPath.begin(), m_hitPath.end(), &c) == m_hitPath.end())
+        {
+            c.setControlFlag(TGUI_CF_HOVERED, false);
+            c.onMouseLeave(ev);
+        }
+    }
+    m_hoverPath.swap(m_hitPath);
+
+    for (u32 i = 0; i < m_hoverPath.size(); ++i)
+    {
+        Control & c = *m_hoverPath[i];
+        if (!c.isHovered())
+        {
+            c.setControlFlag(TGUI_CF_HOVERED, true);
+            c.onMouseEnter(ev);
+            c.onSetCursor(ev);
+        }
+    }
+
+    // Bubble from the deepest control
+    for (u32 i = 0; i < m_hoverPath.size() && !ev.consumed; ++i)
+    {
+        Control & c = *m_hoverPath[i];
+        c.onMouseMove(ev);
+        c.onSetCursor(ev);
+    }
+}
+
+//------------------------------------------------------------------------------
+void GUI::dispatchMousePress(Event & ev)
+{
+    // Presses go to controls under the mouse since the last move.
+    // Handlers can remove controls, which erases them from the hover path,
+    // so a copy is iterated and each control is checked to be still there.
+    const std::vector<Control*> path = m_hoverPath;
+    for (u32 i = 0; i < path.size() && !ev.consumed; ++i)
+    {
+        Control * c = path[i];
+        if (std::find(m_hoverPath.begin(), m_hoverPath.end(), c) != m_hoverPath.end())
+            c->processMousePress(ev);
+    }
+}
+
 //------------------------------------------------------------------------------
 void GUI::serializeState(sn::Variant & o, const sn::SerializationContext & ctx)
 {
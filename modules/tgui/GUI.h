@@ -19,8 +19,26 @@ public:
 
     GUI();
 
+    /// \brief Draws the GUI. Invalidated layouts are updated first.
+    /// Geometry is only recorded again for controls that were invalidated,
+    /// and nothing is tessellated if none were.
     void draw(sn::VideoDriver & driver);
 
+    /// \brief Tells the geometry of the frame must be assembled again from controls
+    void invalidateFrame() { m_frameDirty = true; }
+
+    /// \brief Tells the hit index must be rebuilt, after controls were added, removed or shown
+    void invalidateHitIndex() { m_hitIndexDirty = true; }
+
+    /// \brief Tells the hit areas of a control and its children must be moved
+    void invalidateHitArea(Control & c);
+
+    /// \brief Called when a control is destroyed or moved out of the GUI
+    void onControlRemoved(Control & c);
+
+    /// \brief Gets the topmost visible control at a position in the window
+    Control * getControlAt(sn::Vector2i position);
+
     void onReady() override;
 
     const Theme & getTheme() const;
@@ -43,6 +61,17 @@ protected:
 
     bool onSystemEvent(const sn::Event & systemEvent) override;
 
+private:
+    void recordFrame(DrawBatch & batch);
+
+    void updateHitIndex();
+
+    /// \brief Gets the hit control and its parents receiving mouse events, deepest first
+    void getHitPath(sn::Vector2i position, std::vector<Control*> & out_path);
+
+    void dispatchMouseMove(Event & ev);
+    void dispatchMousePress(Event & ev);
+
 private:
     Theme * m_defaultTheme;
 	Control * r_captureControl;
@@ -52,6 +81,22 @@ private:
     sn::ClearMask m_clearMask;
     sn::Color m_clearColor;
 
+    DrawBatch * m_batch;
+    bool m_frameDirty;
+
+    // What geometry of the frame was recorded with
+    const Theme * r_drawnTheme;
+    sn::Material * r_drawnMaterial;
+    sn::u32 m_drawnAtlasVersion;
+
+    HitIndex m_hitIndex;
+    bool m_hitIndexDirty;
+    std::vector<Control*> m_movedControls;
+
+    /// \brief Controls the mouse was over after the last move, deepest first
+    std::vector<Control*> m_hoverPath;
+    std::vector<Control*> m_hitPath;
+
 };
 
 } // namespace tgui
@@ -0,0 +1,125 @@
+#include "GlyphRunCache.h"
+#include <core/util/stringutils.h>
+
+using namespace sn;
+
+namespace tgui
+{
+
+//------------------------------------------------------------------------------
+GlyphRunCache::GlyphRunCache(const TextModel & model) :
+    r_model(model),
+    r_font(nullptr),
+    m_atlasVersion(0),
+    m_glyphCount(0)
+{
+}
+
+//------------------------------------------------------------------------------
+void GlyphRunCache::clear()
+{
+    m_runs.clear();
+    m_glyphCount = 0;
+}
+
+//------------------------------------------------------------------------------
+void GlyphRunCache::onLinesChanged(const TextModel::Change & change)
+{
+    if (change.firstLine >= m_runs.size())
+        return;
+
+    u32 end = change.firstLine + change.oldLineCount;
+    if (end > m_runs.size())
+        end = m_runs.size();
+    for (u32 i = change.firstLine; i < end; ++i)
+        release(m_runs[i]);
+
+    // Edited lines become unshaped runs
+    u32 oldCount = end - change.firstLine;
+    if (change.newLineCount > oldCount)
+        m_runs.insert(m_runs.begin() + end, change.newLineCount - oldCount, Run());
+    else if (change.newLineCount < oldCount)
+        m_runs.erase(m_runs.begin() + change.firstLine + change.newLineCount, m_runs.begin() + end);
+}
+
+//------------------------------------------------------------------------------
+const GlyphRunCache::Run & GlyphRunCache::getRun(u32 line, const Font & font, FontFormat format)
+{
+    // Glyph rectangles are only valid for the atlas layout they were obtained with
+    if (&font != r_font || format.size != m_format.size || format.style != m_format.style || font.getAtlasVersion() != m_atlasVersion)
+    {
+        clear();
+        r_font = &font;
+        m_format = format;
+        m_atlasVersion = font.getAtlasVersion();
+    }
+
+    if (m_runs.size() != r_model.getLineCount())
+        m_runs.resize(r_model.getLineCount());
+
+    Run & run = m_runs[line];
+    if (!run.isShaped)
+        shape(run, r_model.getLine(line), font, format);
+    return run;
+}
+
+//------------------------------------------------------------------------------
+void GlyphRunCache::trim(u32 firstLine, u32 lineCount)
+{
+    if (m_glyphCount <= MAX_GLYPH_COUNT)
+        return;
+
+    for (u32 i = 0; i < m_runs.size(); ++i)
+    {
+        if (i < firstLine || i >= firstLine + lineCount)
+            release(m_runs[i]);
+    }
+}
+
+//------------------------------------------------------------------------------
+void GlyphRunCache::shape(Run & run, const std::string & str, const Font & font, FontFormat format)
+{
+    run.glyphs.resize(str.size());
+    s32 x = 0;
+
+    for (u32 i = 0; i < str.size(); ++i)
+    {
+        PlacedGlyph & placed = run.glyphs[i];
+        placed.x = x;
+
+        char c = str[i];
+        if (isEOL(c))
+        {
+            placed.page = 0;
+            placed.bounds = IntRect(0, 0, 0, 0);
+            placed.imageRect = IntRect(0, 0, 0, 0);
+        }
+        else
+        {
+            const Glyph & glyph = font.getGlyph(c, format);
+            placed.page = glyph.page;
+            placed.bounds = glyph.bounds;
+            placed.imageRect = glyph.imageRect;
+            x += glyph.advance;
+        }
+    }
+
+    run.width = x;
+    run.isShaped = true;
+    m_glyphCount += run.glyphs.size();
+}
+
+//------------------------------------------------------------------------------
+void GlyphRunCache::release(Run & run)
+{
+    if (!run.isShaped)
+        return;
+    m_glyphCount -= run.glyphs.size();
+    // Free the memory, long texts can't keep glyphs of all their lines
+    std::vector<PlacedGlyph>().swap(run.glyphs);
+    run.width = 0;
+    run.isShaped = false;
+}
+
+} // namespace tgui
+
@@ -0,0 +1,83 @@
+#ifndef __HEADER_TGUI_GLYPHRUNCACHE__
+#define __HEADER_TGUI_GLYPHRUNCACHE__
+
+#include "TextModel.h"
+
+namespace tgui
+{
+
+/// \brief Keeps the glyphs of lines of a TextModel placed on a row,
+/// so text can be drawn and measured without looking up the font for each character.
+/// Lines are shaped the first time they are requested, and runs are kept until lines are edited.
+/// Runs refer to rectangles of the font atlas, so they are all dropped when the font,
+/// the format or the atlas layout changes (see Font::getAtlasVersion()).
+class GlyphRunCache
+{
+public:
+    /// \brief Above this number of cached glyphs, trim() releases lines that are not displayed
+    static const sn::u32 MAX_GLYPH_COUNT = 65536;
+
+    struct PlacedGlyph
+    {
+        /// \brief Position of the glyph origin from the beginning of the line
+        sn::s32 x;
+        /// \brief Index of the atlas page holding the glyph
+        sn::u32 page;
+        /// \brief Bounds of the glyph relative to its origin on the baseline
+        sn::IntRect bounds;
+        /// \brief Coordinates of the glyph within the atlas page
+        sn::IntRect imageRect;
+    };
+
+    struct Run
+    {
+        Run() : isShaped(false), width(0) {}
+
+        /// \brief Gets the position of the caret before a character
+        sn::s32 getX(sn::u32 column) const { return column < glyphs.size() ? glyphs[column].x : width; }
+
+        bool isShaped;
+        /// \brief One glyph per character of the line. End of line characters have no advance.
+        std::vector<PlacedGlyph> glyphs;
+        /// \brief Position after the last character
+        sn::s32 width;
+    };
+
+    GlyphRunCache(const TextModel & model);
+
+    /// \brief Drops all runs. Call it when the whole text changed.
+    void clear();
+
+    /// \brief Drops runs of lines replaced by an edit of the model and moves runs of next lines
+    void onLinesChanged(const TextModel::Change & change);
+
+    /// \brief Gets the glyphs of a line, shaping it if needed
+    const Run & getRun(sn::u32 line, const sn::Font & font, sn::FontFormat format);
+
+    /// \brief If too many glyphs are cached, releases runs out of a range of lines.
+    void trim(sn::u32 firstLine, sn::u32 lineCount);
+
+    sn::u32 getGlyphCount() const { return m_glyphCount; }
+
+private:
+    void shape(Run & run, const std::string & str, const sn::Font & font, sn::FontFormat format);
+    void release(Run & run);
+
+private:
+    /// \brief Source text
+    const TextModel & r_model;
+
+    /// \brief One run per line of the model
+    std::vector<Run> m_runs;
+
+    /// \brief Font and format runs were shaped with
+    const sn::Font * r_font;
+    sn::FontFormat m_format;
+    sn::u32 m_atlasVersion;
+
+    sn::u32 m_glyphCount;
+};
+
+} // namespace tgui
+
+#endif // __HEADER_TGUI_GLYPHRUNCACHE__
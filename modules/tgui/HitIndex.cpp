@@ -0,0 +1,134 @@
+#include "HitIndex.h"
+#include <algorithm>
+
+using namespace sn;
+
+namespace tgui
+{
+
+//------------------------------------------------------------------------------
+HitIndex::HitIndex(s32 cellSize) :
+    m_cellSize(cellSize > 0 ? cellSize : 64)
+{
+}
+
+//------------------------------------------------------------------------------
+void HitIndex::clear(Vector2i windowSize)
+{
+    m_areas.clear();
+    m_windowSize = windowSize;
+    m_cellCount.x() = windowSize.x() > 0 ? (windowSize.x() + m_cellSize - 1) / m_cellSize : 0;
+    m_cellCount.y() = windowSize.y() > 0 ? (windowSize.y() + m_cellSize - 1) / m_cellSize : 0;
+
+    // Keep the memory of cell lists when the size didn't change
+    m_cells.resize(m_cellCount.x() * m_cellCount.y());
+    for (u32 i = 0; i < m_cells.size(); ++i)
+        m_cells[i].clear();
+}
+
+//------------------------------------------------------------------------------
+u32 HitIndex::add(Control * control, const IntRect & bounds, u32 parent)
+{
+    // Not in any cell until its bounds are set
+    Entry e;
+    e.control = control;
+    e.rect = IntRect(0, 0, 0, 0);
+    e.parent = parent;
+    m_areas.push_back(e);
+
+    u32 i = m_areas.size() - 1;
+    setBounds(i, bounds);
+    return i;
+}
+
+//------------------------------------------------------------------------------
+void HitIndex::setBounds(u32 i, const IntRect & bounds)
+{
+    Entry & e = m_areas[i];
+
+    // Clip to the window
+    s32 minX = std::max(bounds.minX(), 0);
+    s32 minY = std::max(bounds.minY(), 0);
+    s32 maxX = std::min(bounds.maxX(), m_windowSize.x());
+    s32 maxY = std::min(bounds.maxY(), m_windowSize.y());
+    IntRect rect(0, 0, 0, 0);
+    if (maxX > minX && maxY > minY)
+        rect = IntRect::fromPositionSize(minX, minY, maxX - minX, maxY - minY);
+
+    removeFromCells(i);
+    e.rect = rect;
+    insertInCells(i);
+}
+
+//------------------------------------------------------------------------------
+bool HitIndex::getCellRange(const IntRect & rect, Vector2i & out_min, Vector2i & out_max) const
+{
+    if (rect.width() <= 0 || rect.height() <= 0)
+        return false;
+    out_min.x() = rect.minX() / m_cellSize;
+    out_min.y() = rect.minY() / m_cellSize;
+    out_max.x() = (rect.maxX() - 1) / m_cellSize;
+    out_max.y() = (rect.maxY() - 1) / m_cellSize;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void HitIndex::insertInCells(u32 i)
+{
+    Vector2i minCell, maxCell;
+    if (!getCellRange(m_areas[i].rect, minCell, maxCell))
+        return;
+
+    for (s32 y = minCell.y(); y <= maxCell.y(); ++y)
+    {
+        for (s32 x = minCell.x(); x <= maxCell.x(); ++x)
+        {
+            std::vector<u32> & cell = m_cells[y * m_cellCount.x() + x];
+            // Areas are mostly added in drawing order, so this is usually a push_back
+            if (cell.empty() || cell.back() < i)
+                cell.push_back(i);
+            else
+                cell.insert(std::lower_bound(cell.begin(), cell.end(), i), i);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void HitIndex::removeFromCells(u32 i)
+{
+    Vector2i minCell, maxCell;
+    if (!getCellRange(m_areas[i].rect, minCell, maxCell))
+        return;
+
+    for (s32 y = minCell.y(); y <= maxCell.y(); ++y)
+    {
+        for (s32 x = minCell.x(); x <= maxCell.x(); ++x)
+        {
+            std::vector<u32> & cell = m_cells[y * m_cellCount.x() + x];
+            auto it = std::lower_bound(cell.begin(), cell.end(), i);
+            if (it != cell.end() && *it == i)
+                cell.erase(it);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+u32 HitIndex::hitTest(Vector2i position) const
+{
+    if (position.x() < 0 || position.y() < 0 || position.x() >= m_windowSize.x() || position.y() >= m_windowSize.y())
+        return NONE;
+
+    const std::vector<u32> & cell = m_cells[(position.y() / m_cellSize) * m_cellCount.x() + position.x() / m_cellSize];
+
+    // Topmost areas are at the end
+    for (u32 j = cell.size(); j-- > 0;)
+    {
+        u32 i = cell[j];
+        if (m_areas[i].rect.contains(position))
+            return i;
+    }
+    return NONE;
+}
+
+} // namespace tgui
+
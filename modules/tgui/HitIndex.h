@@ -0,0 +1,79 @@
+#ifndef __HEADER_TGUI_HITINDEX__
+#define __HEADER_TGUI_HITINDEX__
+
+#include <core/math/Rect.h>
+#include <core/math/Vector2.h>
+#include <vector>
+
+namespace tgui
+{
+
+class Control;
+
+/// \brief Spatial index of the areas where controls can be hit by the mouse, in window coordinates.
+/// Areas are kept in the order controls are drawn, so the last one containing a point is on top.
+/// The window is divided in square cells listing the areas overlapping them,
+/// so hit tests only look at a few areas regardless of how many controls there are.
+class HitIndex
+{
+public:
+    static const sn::u32 NONE = -1;
+
+    HitIndex(sn::s32 cellSize = 64);
+
+    /// \brief Removes all areas and sets the size of the window.
+    /// Areas are clipped to it, like the scissor the GUI is drawn with.
+    /// Controls don't clip their children, so areas are not clipped by their parent.
+    void clear(sn::Vector2i windowSize);
+
+    /// \brief Adds an area above all others
+    /// \param bounds: bounds of the control in window coordinates
+    /// \param parent: area of the parent control, NONE for top-level controls
+    /// \return index of the area
+    sn::u32 add(Control * control, const sn::IntRect & bounds, sn::u32 parent);
+
+    /// \brief Moves an area. It stays at the same place in the drawing order.
+    void setBounds(sn::u32 i, const sn::IntRect & bounds);
+
+    /// \brief Gets the topmost area containing a point
+    /// \return index of the area, or NONE
+    sn::u32 hitTest(sn::Vector2i position) const;
+
+    sn::u32 getAreaCount() const { return m_areas.size(); }
+    const sn::Vector2i & getWindowSize() const { return m_windowSize; }
+
+    Control * getControl(sn::u32 i) const { return m_areas[i].control; }
+    sn::u32 getParent(sn::u32 i) const { return m_areas[i].parent; }
+
+    /// \brief Gets the part of an area that can be hit
+    const sn::IntRect & getRect(sn::u32 i) const { return m_areas[i].rect; }
+
+private:
+    struct Entry
+    {
+        Control * control;
+        sn::IntRect rect;
+        sn::u32 parent;
+    };
+
+    /// \brief Gets the range of cells covered by a rectangle.
+    /// \return false if the rectangle is empty
+    bool getCellRange(const sn::IntRect & rect, sn::Vector2i & out_min, sn::Vector2i & out_max) const;
+
+    void insertInCells(sn::u32 i);
+    void removeFromCells(sn::u32 i);
+
+private:
+    sn::s32 m_cellSize;
+    sn::Vector2i m_windowSize;
+    sn::Vector2i m_cellCount;
+    std::vector<Entry> m_areas;
+
+    /// \brief Indexes of the areas overlapping each cell, sorted in drawing order
+    std::vector< std::vector<sn::u32> > m_cells;
+};
+
+} // namespace tgui
+
+#endif // __HEADER_TGUI_HITINDEX__
+
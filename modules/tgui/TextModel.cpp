@@ -6,25 +6,35 @@ using namespace sn;
 namespace tgui
 {
 
+namespace
+{
+    // Splits text into lines keeping their EOL characters, like they are stored in the model.
+    // There is always at least one line.
+    void splitLines(const std::string & text, std::vector<std::string> & out_lines)
+    {
+        out_lines.push_back("");
+        for (u32 i = 0; i < text.size(); ++i)
+        {
+            char c = text[i];
+            if (c != '\r')
+            {
+                out_lines.back() += c;
+            }
+            if (c == '\n')
+            {
+                out_lines.push_back("");
+            }
+        }
+    }
+}
+
 //------------------------------------------------------------------------------
 void TextModel::setSource(const std::string & sourceText)
 {
     m_lines.clear();
     if (sourceText.empty())
         return;
-    m_lines.push_back("");
-    for (u32 i = 0; i < sourceText.size(); ++i)
-    {
-        char c = sourceText[i];
-        if (c != '\r')
-        {
-            m_lines.back() += c;
-        }
-        if (c == '\n')
-        {
-            m_lines.push_back("");
-        }
-    }
+    splitLines(sourceText, m_lines);
 }
 
 //------------------------------------------------------------------------------
@@ -52,5 +62,87 @@ const std::string & TextModel::getLine(sn::u32 i) const
     return m_lines[i];
 }
 
+//------------------------------------------------------------------------------
+TextModel::Change TextModel::insertText(sn::Vector2u & position, const std::string & text)
+{
+    Change change;
+
+    if (m_lines.empty())
+    {
+        m_lines.push_back("");
+        position = Vector2u(0, 0);
+        change.oldLineCount = 0;
+    }
+    else
+    {
+        if (position.y() >= m_lines.size())
+            position.y() = m_lines.size() - 1;
+        change.oldLineCount = 1;
+    }
+
+    std::vector<std::string> parts;
+    splitLines(text, parts);
+
+    u32 y = position.y();
+    std::string & line = m_lines[y];
+    // Text can't go after the end of line character
+    u32 lineEnd = line.size();
+    if (lineEnd > 0 && line[lineEnd - 1] == '\n')
+        --lineEnd;
+    u32 x = position.x() < lineEnd ? position.x() : lineEnd;
+
+    // The end of the line goes after the inserted text
+    std::string tail = line.substr(x);
+    line.erase(x);
+    line += parts[0];
+    if (parts.size() > 1)
+        m_lines.insert(m_lines.begin() + y + 1, parts.begin() + 1, parts.end());
+
+    u32 lastY = y + parts.size() - 1;
+    position = Vector2u(m_lines[lastY].size(), lastY);
+    m_lines[lastY] += tail;
+
+    change.firstLine = y;
+    change.newLineCount = parts.size();
+    return change;
+}
+
+//------------------------------------------------------------------------------
+TextModel::Change TextModel::appendText(const std::string & text)
+{
+    Vector2u position;
+    if (!m_lines.empty())
+        position = Vector2u(m_lines.back().size(), m_lines.size() - 1);
+    return insertText(position, text);
+}
+
+//------------------------------------------------------------------------------
+TextModel::Change TextModel::eraseText(sn::Vector2u begin, sn::Vector2u end)
+{
+    Change change = { 0, 0, 0 };
+    if (m_lines.empty())
+        return change;
+
+    u32 lastLine = m_lines.size() - 1;
+    if (begin.y() > lastLine)
+        begin.y() = lastLine;
+    if (end.y() > lastLine)
+        end.y() = lastLine;
+    SN_ASSERT(begin.y() < end.y() || (begin.y() == end.y() && begin.x() <= end.x()), "Invalid text range");
+
+    std::string & first = m_lines[begin.y()];
+    const std::string & last = m_lines[end.y()];
+    std::string tail = end.x() < last.size() ? last.substr(end.x()) : "";
+    if (begin.x() < first.size())
+        first.erase(begin.x());
+    first += tail;
+    m_lines.erase(m_lines.begin() + begin.y() + 1, m_lines.begin() + end.y() + 1);
+
+    change.firstLine = begin.y();
+    change.oldLineCount = end.y() - begin.y() + 1;
+    change.newLineCount = 1;
+    return change;
+}
+
 } // namespace tgui
 
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <core/types.h>
+#include <core/math/Vector2.h>
 #include <modules/freetype/Font.hpp>
 
 namespace tgui
@@ -13,12 +14,33 @@ namespace tgui
 class TextModel
 {
 public:
+    /// \brief Describes which lines an edit replaced, so views of the text can update only them.
+    /// Lines [firstLine, firstLine + oldLineCount) before the edit
+    /// became lines [firstLine, firstLine + newLineCount).
+    struct Change
+    {
+        sn::u32 firstLine;
+        sn::u32 oldLineCount;
+        sn::u32 newLineCount;
+    };
+
     void setSource(const std::string & sourceText);
     void getSource(std::string & out_text) const;
 
     sn::u32 getLineCount() const { return m_lines.size(); }
     const std::string & getLine(sn::u32 i) const;
 
+    /// \brief Inserts text at a position.
+    /// \param position: X is the column, Y is the line. It is moved after the inserted text.
+    Change insertText(sn::Vector2u & position, const std::string & text);
+
+    /// \brief Inserts text after the last line
+    Change appendText(const std::string & text);
+
+    /// \brief Erases characters between two positions, end excluded.
+    /// Erasing the end of line character of a line joins it with the next one.
+    Change eraseText(sn::Vector2u begin, sn::Vector2u end);
+
 private:
     std::vector<std::string> m_lines;
 };
@@ -26,4 +48,3 @@ private:
 } // namespace tgui
 
 #endif // __HEADER_TGUI_TEXTMODEL__
-
@@ -1,11 +1,20 @@
 #include "TextWrapper.h"
 #include <core/util/stringutils.h>
+#include <algorithm>
 
 using namespace sn;
 
 namespace tgui
 {
 
+namespace
+{
+    TextWrapper::CharAdvance getFontAdvance(const Font & font, const FontFormat & format)
+    {
+        return [&font, &format](char c) { return static_cast<u32>(font.getGlyph(c, format).advance); };
+    }
+}
+
 //------------------------------------------------------------------------------
 void serialize(Variant & o, TextWrapMode m)
 {
@@ -41,6 +50,12 @@ void TextWrapper::updateNoWrap()
 
 //------------------------------------------------------------------------------
 void TextWrapper::update(sn::u32 width, const Font & font, const FontFormat & format)
+{
+    update(width, getFontAdvance(font, format));
+}
+
+//------------------------------------------------------------------------------
+void TextWrapper::update(sn::u32 width, const CharAdvance & advance)
 {
     if (m_wrapMode == TGUI_WRAP_NONE)
     {
@@ -48,41 +63,85 @@ void TextWrapper::update(sn::u32 width, const Font & font, const FontFormat & fo
         return;
     }
 
-    // TODO Implement word-based wrapping
+    m_wraps.clear();
+    for (u32 j = 0; j < r_model.getLineCount(); ++j)
+        wrapLine(j, width, advance, m_wraps);
+}
 
-    m_wraps.resize(r_model.getLineCount());
-    u32 wrapCount = 0;
+//------------------------------------------------------------------------------
+u32 TextWrapper::updateLines(const TextModel::Change & change, sn::u32 width, const Font & font, const FontFormat & format)
+{
+    return updateLines(change, width, getFontAdvance(font, format));
+}
 
-    for (u32 j = 0; j < r_model.getLineCount(); ++j)
+//------------------------------------------------------------------------------
+u32 TextWrapper::updateLines(const TextModel::Change & change, sn::u32 width, const CharAdvance & advance)
+{
+    // Find wraps of the lines that were replaced
+    auto lessLine = [](const LightWrap & wrap, u32 line) { return wrap.line < line; };
+    auto beginIt = std::lower_bound(m_wraps.begin(), m_wraps.end(), change.firstLine, lessLine);
+    auto endIt = std::lower_bound(beginIt, m_wraps.end(), change.firstLine + change.oldLineCount, lessLine);
+    u32 begin = beginIt - m_wraps.begin();
+    u32 end = endIt - m_wraps.begin();
+
+    m_editedWraps.clear();
+    for (u32 j = change.firstLine; j < change.firstLine + change.newLineCount; ++j)
+        wrapLine(j, width, advance, m_editedWraps);
+
+    // Replace them, most edits change as many wraps as they remove
+    u32 oldCount = end - begin;
+    u32 newCount = m_editedWraps.size();
+    u32 common = oldCount < newCount ? oldCount : newCount;
+    std::copy(m_editedWraps.begin(), m_editedWraps.begin() + common, m_wraps.begin() + begin);
+    if (newCount > oldCount)
+        m_wraps.insert(m_wraps.begin() + end, m_editedWraps.begin() + common, m_editedWraps.end());
+    else if (oldCount > newCount)
+        m_wraps.erase(m_wraps.begin() + begin + common, m_wraps.begin() + end);
+
+    // Renumber lines after the edit
+    if (change.newLineCount != change.oldLineCount)
     {
-        const std::string & str = r_model.getLine(j);
-        u32 x = 0;
+        s32 delta = static_cast<s32>(change.newLineCount) - static_cast<s32>(change.oldLineCount);
+        for (u32 i = begin + newCount; i < m_wraps.size(); ++i)
+            m_wraps[i].line += delta;
+    }
 
-        for (u32 i = 0; i < str.size(); ++i)
+    return begin;
+}
+
+//------------------------------------------------------------------------------
+void TextWrapper::wrapLine(u32 line, u32 width, const CharAdvance & advance, std::vector<LightWrap> & out_wraps) const
+{
+    const std::string & str = r_model.getLine(line);
+
+    if (m_wrapMode == TGUI_WRAP_NONE)
+    {
+        out_wraps.push_back({ line, str.size() });
+        return;
+    }
+
+    // TODO Implement word-based wrapping
+
+    u32 begin = 0;
+    u32 x = 0;
+
+    for (u32 i = 0; i < str.size(); ++i)
+    {
+        char c = str[i];
+        if (isEOL(c))
+            break;
+        u32 offset = advance(c);
+        x += offset;
+        // A character wider than the whole row still gets a row
+        if (x > width && i > begin)
         {
-            char c = str[i];
-            if (isEOL(c))
-                break;
-            const Glyph & glyph = font.getGlyph(c, format);
-            u32 offset = glyph.advance;
-            x += offset;
-            if (x > width)
-            {
-                if (m_wraps.size() == wrapCount)
-                    m_wraps.push_back({ j, i });
-                else
-                    m_wraps[wrapCount] = { j, i };
-                ++wrapCount;
-                x = 0;
-            }
+            out_wraps.push_back({ line, i });
+            begin = i;
+            x = offset;
         }
-
-        if (m_wraps.size() == wrapCount)
-            m_wraps.push_back({ j, str.size() });
-        else
-            m_wraps[wrapCount] = { j, str.size() };
-        ++wrapCount;
     }
+
+    out_wraps.push_back({ line, str.size() });
 }
 
 //------------------------------------------------------------------------------
@@ -120,20 +179,16 @@ u32 TextWrapper::getWrapFromLine(u32 lineIndex) const
 {
     if (m_wraps.empty())
         return 0;
-    
-    // Wrap count will always be equal or greater than the actual line count,
-    // So we can optimize and start right at the line.
-    u32 i = lineIndex;
 
-    // Iterate through next wraps until we find one having the corresponding line number
-    for (; i < m_wraps.size(); ++i)
-    {
-        if (m_wraps[i].line == lineIndex)
-            return i;
-    }
+    // Wraps are sorted by line
+    auto it = std::lower_bound(m_wraps.begin(), m_wraps.end(), lineIndex, 
+        [](const LightWrap & wrap, u32 line) { return wrap.line < line; });
 
     // We didn't found the line, so simply return the last wrap
-    return m_wraps.size() - 1;
+    if (it == m_wraps.end())
+        return m_wraps.size() - 1;
+
+    return it - m_wraps.begin();
 }
 
 //------------------------------------------------------------------------------
@@ -144,10 +199,10 @@ sn::u32 TextWrapper::getWrapFromLineAndColumn(sn::u32 line, sn::u32 column) cons
 
     u32 i = getWrapFromLine(line);
 
-    while (m_wraps[i].end < column && i < m_wraps.size())
+    while (i + 1 < m_wraps.size() && m_wraps[i + 1].line == m_wraps[i].line && m_wraps[i].end < column)
         ++i;
 
-    return i == m_wraps.size() ? i - 1 : i;
+    return i;
 }
 
 //------------------------------------------------------------------------------
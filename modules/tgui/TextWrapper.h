@@ -3,6 +3,7 @@
 
 #include <core/util/Variant.h>
 #include "TextModel.h"
+#include <functional>
 
 namespace tgui
 {
@@ -44,6 +45,9 @@ public:
         sn::u32 end;
     };
 
+    /// \brief Gives the width of a character in pixels
+    typedef std::function<sn::u32(char)> CharAdvance;
+
     //---------------------------------
     // Constructor and options
     //---------------------------------
@@ -67,7 +71,7 @@ public:
     void updateNoWrap();
 
     /// \brief Executes wrapping on all lines.
-    /// \note: prefer using specialized methods rather than updating the whole text,
+    /// \note: prefer using updateLines() after edits rather than updating the whole text,
     /// it often results in better performances.
     void update(
         sn::u32 width,
@@ -75,7 +79,21 @@ public:
         const sn::FontFormat & format
     );
 
-    // TODO Per-case functions for more efficiency
+    /// \brief Executes wrapping on lines replaced by an edit of the model.
+    /// Other lines keep their wraps, they are only renumbered if the line count changed.
+    /// \return index of the first wrap of the edited lines
+    sn::u32 updateLines(
+        const TextModel::Change & change,
+        sn::u32 width,
+        const sn::Font & font,
+        const sn::FontFormat & format
+    );
+
+    /// \brief Same as update(), with character widths given by a function instead of a font
+    void update(sn::u32 width, const CharAdvance & advance);
+
+    /// \brief Same as updateLines(), with character widths given by a function instead of a font
+    sn::u32 updateLines(const TextModel::Change & change, sn::u32 width, const CharAdvance & advance);
 
     //---------------------------------
     // State access
@@ -101,6 +119,15 @@ public:
     /// \brief Gets the last wrap corresponding to the same line as the given wrap
     sn::u32 getEndWrap(sn::u32 beginWrap) const;
 
+private:
+    /// \brief Appends wraps of a line of the model
+    void wrapLine(
+        sn::u32 line,
+        sn::u32 width,
+        const CharAdvance & advance,
+        std::vector<LightWrap> & out_wraps
+    ) const;
+
 private:
     /// \brief Current wrap mode
     TextWrapMode m_wrapMode;
@@ -111,6 +138,9 @@ private:
     /// \brief Rows of text obtained after wrapping. One row corresponds to a part of a line.
     std::vector<LightWrap> m_wraps;
 
+    /// \brief Wraps of edited lines before they replace old ones
+    std::vector<LightWrap> m_editedWraps;
+
 };
 
 } // namespace tgui
@@ -88,7 +88,6 @@ void Button::layoutChildren()
                 childBounds.height() = getLocalClientBounds().height() - margin.top - margin.bottom - childBounds.y() - getPadding().bottom;
 
             child.setLocalClientBounds(childBounds);
-            child.layoutChildren();
         }
     }
 }
@@ -20,7 +20,12 @@ Control::Control() : sn::Entity(),
     m_controlFlags((1 << TGUI_CF_ENABLED) | (1 << TGUI_CF_VISIBLE)),
     m_windowID(0),
     m_positionMode(TGUI_LAYOUT),
-    m_layout(nullptr)
+    m_layout(nullptr),
+    m_drawCacheDirty(true),
+    m_layoutDirty(true),
+    m_childLayoutDirty(false),
+    m_hitArea(HitIndex::NONE),
+    m_hitAreaMoved(false)
 {
 }
 
@@ -53,9 +58,20 @@ sn::IntRect Control::getClientBounds() const
 void Control::setLocalClientBounds(sn::IntRect bounds)
 {
     bool sizeChanged = m_localBounds.size() != bounds.size();
+    bool moved = m_localBounds.origin() != bounds.origin();
     m_localBounds = bounds;
+    // Geometry and hit areas of children are in window coordinates too
+    if (sizeChanged || moved)
+    {
+        invalidateDrawTree();
+        GUI * gui = getGUI();
+        if (gui)
+            gui->invalidateHitArea(*this);
+    }
     if (sizeChanged)
     {
+        // Children are positioned relatively, so moving alone doesn't lay them out again
+        invalidateLayout();
         onSizeChanged();
     }
 }
@@ -66,6 +82,9 @@ void Control::setAnchors(Anchors anchors)
     if (anchors != m_anchors)
     {
         m_anchors = anchors;
+        Control * parent = getParentControl();
+        if (parent)
+            parent->invalidateLayout();
     }
 }
 
@@ -78,7 +97,31 @@ bool Control::getControlFlag(sn::u32 i) const
 //------------------------------------------------------------------------------
 void Control::setControlFlag(sn::u32 i, bool value)
 {
-    m_controlFlags[i] = value;
+    if (m_controlFlags[i] != value)
+    {
+        m_controlFlags[i] = value;
+        invalidateDraw();
+    }
+}
+
+//------------------------------------------------------------------------------
+void Control::invalidateDraw()
+{
+    m_drawCacheDirty = true;
+    GUI * gui = getGUI();
+    if (gui)
+        gui->invalidateFrame();
+}
+
+//------------------------------------------------------------------------------
+void Control::invalidateDrawTree()
+{
+    invalidateDraw();
+
+    std::vector<Control*> children;
+    getChildrenOfType<Control>(children);
+    for (u32 i = 0; i < children.size(); ++i)
+        children[i]->invalidateDrawTree();
 }
 
 //------------------------------------------------------------------------------
@@ -88,6 +131,47 @@ void Control::setLayout(Layout * newLayout)
         delete m_layout;
     m_layout = newLayout;
 	m_layout->setContainer(*this);
+    invalidateLayout();
+}
+
+//------------------------------------------------------------------------------
+void Control::invalidateLayout()
+{
+    m_layoutDirty = true;
+
+    // Mark the path from the GUI so the layout pass can find this control
+    Control * parent = getParentControl();
+    while (parent && !parent->m_childLayoutDirty)
+    {
+        parent->m_childLayoutDirty = true;
+        parent = parent->getParentControl();
+    }
+}
+
+//------------------------------------------------------------------------------
+void Control::updateLayout()
+{
+    if (!m_layoutDirty && !m_childLayoutDirty)
+        return;
+
+    // Children invalidated by the layout below are handled in this pass,
+    // they don't need to mark ancestors again
+    m_childLayoutDirty = true;
+
+    if (m_layoutDirty)
+    {
+        m_layoutDirty = false;
+        layoutChildren();
+    }
+
+    for (u32 i = 0; i < getChildCount(); ++i)
+    {
+        Control * child = Object::cast<Control>(getChildByIndex(i));
+        if (child)
+            child->updateLayout();
+    }
+
+    m_childLayoutDirty = false;
 }
 
 //------------------------------------------------------------------------------
@@ -146,12 +230,22 @@ GUI * Control::getGUI() const
 void Control::setParent(Entity * newParent)
 {
     Control * oldParent = getParentControl();
+    GUI * oldGUI = getGUI();
     Entity::setParent(newParent);
+    if (oldGUI)
+    {
+        oldGUI->invalidateFrame();
+        oldGUI->onControlRemoved(*this);
+    }
+    GUI * gui = getGUI();
+    if (gui)
+        gui->invalidateHitIndex();
+    invalidateDrawTree();
     if (oldParent)
-        oldParent->layoutChildren();
+        oldParent->invalidateLayout();
     Control * parent = getParentControl();
     if (parent)
-        parent->layoutChildren();
+        parent->invalidateLayout();
 }
 
 //------------------------------------------------------------------------------
@@ -159,7 +253,7 @@ void Control::onReady()
 {
 	if (m_layout)
 		m_layout->onReady();
-	layoutChildren();
+	invalidateLayout();
 	Entity::onReady();
 }
 
@@ -168,7 +262,16 @@ void Control::onDestroy()
 {
 	Control * parent = getParentControl();
 	if (parent)
+	{
 		parent->onChildControlRemoved(*this);
+		parent->invalidateLayout();
+	}
+	GUI * gui = getGUI();
+	if (gui)
+	{
+		gui->invalidateFrame();
+		gui->onControlRemoved(*this);
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -219,21 +322,19 @@ void Control::layoutChildren()
 	{
 		// Default layout: only anchors are applied
 
-		std::vector<Control*> children;
-		getChildrenOfType<Control>(children);
-
 		IntRect cellBounds = getLocalClientBounds();
 		cellBounds.x() = 0;
 		cellBounds.y() = 0;
 		getPadding().crop(cellBounds);
 
-		for (auto it = children.begin(); it != children.end(); ++it)
+		for (u32 i = 0; i < getChildCount(); ++i)
 		{
-			Control & child = **it;
-			IntRect childBounds = child.getLocalClientBounds();
-			applyAnchors(childBounds, cellBounds, child.getAnchors());
-			child.setLocalClientBounds(childBounds);
-			child.layoutChildren();
+			Control * child = Object::cast<Control>(getChildByIndex(i));
+			if (child == nullptr)
+				continue;
+			IntRect childBounds = child->getLocalClientBounds();
+			applyAnchors(childBounds, cellBounds, child->getAnchors());
+			child->setLocalClientBounds(childBounds);
 		}
 	}
 }
@@ -241,7 +342,15 @@ void Control::layoutChildren()
 //------------------------------------------------------------------------------
 void Control::onDraw(DrawBatch & batch)
 {
-    onDrawSelf(batch);
+    // Controls are only tessellated again when they were invalidated
+    if (m_drawCacheDirty)
+    {
+        batch.beginRecord(m_drawCache);
+        onDrawSelf(batch);
+        batch.endRecord();
+        m_drawCacheDirty = false;
+    }
+    batch.append(m_drawCache);
 
     std::vector<Control*> children;
     getChildrenOfType<Control>(children);
@@ -299,7 +408,66 @@ void Control::setFocus(bool isFocused)
 //------------------------------------------------------------------------------
 void Control::setVisible(bool visible)
 {
-    setControlFlag(TGUI_CF_VISIBLE, visible);
+    if (visible != isVisible())
+    {
+        setControlFlag(TGUI_CF_VISIBLE, visible);
+        // Hidden controls have no hit area
+        GUI * gui = getGUI();
+        if (gui)
+            gui->invalidateHitIndex();
+    }
+}
+
+//------------------------------------------------------------------------------
+void Control::addHitAreas(HitIndex & index, u32 parentArea, Vector2i origin)
+{
+    m_hitAreaMoved = false;
+    if (!isVisible())
+    {
+        clearHitAreas();
+        return;
+    }
+
+    Vector2i pos = origin + m_localBounds.origin();
+    m_hitArea = index.add(this, IntRect::fromPositionSize(pos.x(), pos.y(), m_localBounds.width(), m_localBounds.height()), parentArea);
+
+    for (u32 i = 0; i < getChildCount(); ++i)
+    {
+        Control * child = Object::cast<Control>(getChildByIndex(i));
+        if (child)
+            child->addHitAreas(index, m_hitArea, pos);
+    }
+}
+
+//------------------------------------------------------------------------------
+void Control::updateHitAreas(HitIndex & index, Vector2i origin)
+{
+    m_hitAreaMoved = false;
+    if (m_hitArea == HitIndex::NONE)
+        return;
+
+    Vector2i pos = origin + m_localBounds.origin();
+    index.setBounds(m_hitArea, IntRect::fromPositionSize(pos.x(), pos.y(), m_localBounds.width(), m_localBounds.height()));
+
+    for (u32 i = 0; i < getChildCount(); ++i)
+    {
+        Control * child = Object::cast<Control>(getChildByIndex(i));
+        if (child)
+            child->updateHitAreas(index, pos);
+    }
+}
+
+//------------------------------------------------------------------------------
+void Control::clearHitAreas()
+{
+    m_hitArea = HitIndex::NONE;
+    m_hitAreaMoved = false;
+    for (u32 i = 0; i < getChildCount(); ++i)
+    {
+        Control * child = Object::cast<Control>(getChildByIndex(i));
+        if (child)
+            child->clearHitAreas();
+    }
 }
 
 //------------------------------------------------------------------------------
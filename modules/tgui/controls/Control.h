@@ -8,6 +8,7 @@
 #include "../Direction.h"
 #include "../theme/Theme.h"
 #include "../DrawBatch.h"
+#include "../HitIndex.h"
 #include "../Anchors.h"
 #include "../Position.h"
 
@@ -73,8 +74,21 @@ public:
 
 	Layout * getLayout() const { return m_layout; }
 
+    /// \brief Installs a layout positioning children of the control. The control takes ownership of it.
+    void setLayout(Layout * newLayout);
+
+    /// \brief Immediately positions direct children of the control.
+    /// Children whose size changed are invalidated and laid out by the next updateLayout().
     virtual void layoutChildren();
 
+    /// \brief Tells children of the control must be laid out again.
+    /// Layout is deferred to the next updateLayout(), so invalidating many times costs nothing more.
+    void invalidateLayout();
+
+    /// \brief Lays out invalidated controls of the subtree, and only them.
+    /// The GUI calls it once per frame and before dispatching events.
+    void updateLayout();
+
     //--------------------------------
     // State
     //--------------------------------
@@ -99,6 +113,10 @@ public:
 
     void setVisible(bool visible);
 
+    /// \brief Tells the control must tessellate its geometry again before the next frame.
+    /// Controls call it when their appearance changes, other than bounds or state flags.
+    void invalidateDraw();
+
     //--------------------------------
     // Entity event handlers
     //--------------------------------
@@ -145,7 +163,9 @@ protected:
 	virtual void onChildControlRemoved(Control & child);
 
     bool hasLayout() const { return m_layout != nullptr; }
-    void setLayout(Layout * newLayout);
+
+    /// \brief Invalidates the geometry of the control and its children
+    void invalidateDrawTree();
 
 	//--------------------------------
     // Helpers
@@ -155,6 +175,9 @@ protected:
 	void endCapture();
 
 private:
+    // Mouse moves and presses are dispatched by the GUI along the path of hit controls
+    friend class GUI;
+
     void processMouseMove(Event & e);
     void processMousePress(Event & e);
     void processMouseRelease(Event & e);
@@ -162,6 +185,15 @@ private:
 
     void setControlFlag(sn::u32 i, bool value);
 
+    /// \brief Adds areas of the control and its children to the hit index, in drawing order
+    /// \param origin: position of the parent in window coordinates
+    void addHitAreas(HitIndex & index, sn::u32 parentArea, sn::Vector2i origin);
+
+    /// \brief Moves areas of the control and its children in the hit index
+    void updateHitAreas(HitIndex & index, sn::Vector2i origin);
+
+    void clearHitAreas();
+
 private:
     sn::IntRect m_localBounds;
     std::bitset<TGUI_CF_COUNT> m_controlFlags;
@@ -171,6 +203,22 @@ private:
     Anchors m_anchors;
     Position m_positionMode;
     Layout * m_layout; // TODO Layout should be a Component in future design
+
+    /// \brief Geometry drawn by onDrawSelf() the last time the control was invalidated
+    DrawList m_drawCache;
+    bool m_drawCacheDirty;
+
+    /// \brief Children of the control must be laid out again
+    bool m_layoutDirty;
+
+    /// \brief A descendant of the control has its layout invalidated
+    bool m_childLayoutDirty;
+
+    /// \brief Area of the control in the hit index of the GUI, NONE if hidden
+    sn::u32 m_hitArea;
+
+    /// \brief The control moved since the hit index was updated
+    bool m_hitAreaMoved;
 };
 
 } // namespace tgui
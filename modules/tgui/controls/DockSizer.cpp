@@ -67,8 +67,8 @@ void DockSizer::onMouseMove(Event & e)
 		SplitLayout * layout = getLayout();
 		if (layout)
 		{
+			// The parent is laid out again before the next frame
 			layout->setSplitPosition(m_path, splitPos);
-			parent->layoutChildren();
 			//layout->layout(getParentControl()->getLocalClientBounds());
 		}
 	}
@@ -93,7 +93,6 @@ void Panel::onMouseMove(Event & e)
             }
 
             setLocalClientBounds(b);
-            layoutChildren();
 
             //e.consume();
         }
@@ -24,6 +24,7 @@ void Slider::setValue(f32 v)
     if (v != m_value)
     {
         m_value = v;
+        invalidateDraw();
         notifyValueChanged();
     }
 }
@@ -41,12 +42,14 @@ void Slider::setStep(sn::f32 step)
         step = 0.0001f;
     m_step = step;
     m_stepEnabled = true;
+    invalidateDraw();
 }
 
 //------------------------------------------------------------------------------
 void Slider::setStepEnabled(bool enable)
 {
     m_stepEnabled = enable;
+    invalidateDraw();
 }
 
 //------------------------------------------------------------------------------
@@ -54,6 +57,7 @@ void Slider::setMin(sn::f32 min)
 {
     m_range.setMin(min);
     m_value = math::clamp(m_value, m_range.min(), m_range.max());
+    invalidateDraw();
 }
 
 //------------------------------------------------------------------------------
@@ -61,6 +65,7 @@ void Slider::setMax(sn::f32 max)
 {
     m_range.setMax(max);
     m_value = math::clamp(m_value, m_range.min(), m_range.max());
+    invalidateDraw();
 }
 
 //------------------------------------------------------------------------------
@@ -248,6 +253,7 @@ void Slider::unserializeState(const sn::Variant & o, const sn::SerializationCont
     }
 
     m_value = math::clamp(m_value, m_range.min(), m_range.max());
+    invalidateDraw();
 }
 
 } // namespace tgui
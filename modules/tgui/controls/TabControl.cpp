@@ -43,7 +43,6 @@ void TabControl::layoutTabBar()
 			tabBounds.height() = barBounds.height();
 			pos.x() += tabBounds.width();
 			tab.setLocalClientBounds(tabBounds);
-            tab.layoutChildren();
 		}
 	}
 }
@@ -68,7 +67,6 @@ void TabControl::layoutPage()
 			    bounds.height() -= barSize;
 			    c.getMargin().crop(bounds);
 			    c.setLocalClientBounds(bounds);
-			    c.layoutChildren();
             }
 		}
 	}
@@ -130,7 +128,7 @@ void TabControl::removePage(sn::u32 i)
 
 			setCurrentPageIndex(currentPage);
 
-			layoutChildren();
+			invalidateLayout();
 		}
 		else
 		{
@@ -163,7 +161,7 @@ void TabControl::setCurrentPageIndex(sn::u32 i)
 
         m_currentPageIndex = i;
 
-		layoutPage();
+		invalidateLayout();
 	}
 }
 
@@ -20,6 +20,7 @@ Text::Text():
 void Text::setSource(const std::string & str)
 {
     m_model.setSource(str);
+    invalidateDraw();
 }
 
 //------------------------------------------------------------------------------
@@ -43,7 +44,7 @@ void Text::onDrawSelf(DrawBatch & batch)
     const FontFormat & format = theme->textFormat;
     IntRect controlBounds = getClientBounds();
 
-    batch.setScissor(controlBounds, getWindowID());
+    batch.setScissor(controlBounds);
 
     batch.drawText(
         m_model,
@@ -81,6 +82,7 @@ void Text::unserializeState(const sn::Variant & o, const sn::SerializationContex
     m_model.setSource(text);
 
     tgui::unserialize(o["align"], m_align);
+    invalidateDraw();
 }
 
 } // namespace tgui
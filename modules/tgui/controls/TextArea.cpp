@@ -14,10 +14,33 @@ SN_OBJECT_IMPL(TextArea)
 //------------------------------------------------------------------------------
 TextArea::TextArea():
     m_wrapper(m_model),
-    m_currentWrap(0)
+    m_glyphRuns(m_model),
+    m_currentWrap(0),
+    m_scrollRow(0),
+    m_caretVisible(true)
 {
 }
 
+//------------------------------------------------------------------------------
+void TextArea::onReady()
+{
+    Control::onReady();
+    // Needed to make the caret blink
+    setUpdatable(true);
+}
+
+//------------------------------------------------------------------------------
+void TextArea::onUpdate()
+{
+    // Geometry is cached, so it's only drawn again when the caret appears or disappears
+    bool caretVisible = isCaretBlinkOn();
+    if (caretVisible != m_caretVisible)
+    {
+        m_caretVisible = caretVisible;
+        invalidateDraw();
+    }
+}
+
 //------------------------------------------------------------------------------
 void TextArea::onDrawSelf(DrawBatch & batch)
 {
@@ -40,12 +63,15 @@ void TextArea::onDrawSelf(DrawBatch & batch)
 
     // Draw content:
 
-    batch.setScissor(bounds, getWindowID());
+    batch.setScissor(bounds);
 
-    // Draw text
+    // Draw text, starting from the first visible row
     const FontFormat & format = theme->textFormat;
+    s32 lineHeight = font->getLineHeight(format.size);
     batch.drawText(
         m_wrapper,
+        m_glyphRuns,
+        m_scrollRow,
         bounds,
         *font,
         theme->textFormat,
@@ -54,16 +80,14 @@ void TextArea::onDrawSelf(DrawBatch & batch)
     );
 
     // Draw caret
-    Time time = getScene()->getTimeSinceStartup();
-    bool blink = ((time - m_lastMoveTime).asMilliseconds() % (2*CARET_BLINK_INTERVAL_MS)) < CARET_BLINK_INTERVAL_MS;
-    if (blink)
+    if (m_caretVisible)
     {
         const ControlTheme & caretTheme = theme->textAreaCaret;
         batch.fillRect(
             IntRect::fromPositionSize(
                 bounds.x() + m_caretPosition.x(), 
-                bounds.y() + m_caretPosition.y(), 
-                1, font->getLineHeight(format.size)
+                bounds.y() + m_caretPosition.y() - static_cast<s32>(m_scrollRow) * lineHeight, 
+                1, lineHeight
             ), 
             caretTheme.statesUV[0], ts
         );
@@ -71,6 +95,18 @@ void TextArea::onDrawSelf(DrawBatch & batch)
 
     batch.disableScissor();
 
+    // Don't keep glyphs of the whole text
+    u32 wrapCount = m_wrapper.getWrapCount();
+    if (m_scrollRow < wrapCount)
+    {
+        u32 lastRow = m_scrollRow + getVisibleRowCount();
+        if (lastRow >= wrapCount)
+            lastRow = wrapCount - 1;
+        u32 firstLine = m_wrapper.getLightWrap(m_scrollRow).line;
+        u32 lastLine = m_wrapper.getLightWrap(lastRow).line;
+        m_glyphRuns.trim(firstLine, lastLine - firstLine + 1);
+    }
+
 	// DEBUG
 	//std::stringstream ss;
 	//ss << "Caret: " << sn::toString(m_caretIndex) << ", row: " << m_currentWrap;
@@ -126,11 +162,13 @@ void TextArea::onKeyDown(Event & ev)
         moveCaretDown();
         break;
 
-    //case SN_KEY_DELETE:
-    //    break;
+    case SN_KEY_DELETE:
+        eraseAfterCaret();
+        break;
 
-    //case SN_KEY_BACKSPACE:
-    //    break;
+    case SN_KEY_BACKSPACE:
+        eraseBeforeCaret();
+        break;
 
     default:
         break;
@@ -273,18 +311,26 @@ void TextArea::moveCaretToEndOfLine()
         }
         else
         {
-            // If the line has no newline character, place the caret at the end index.
-            u32 i = str.size();
+            m_caretIndex.x() = getLineEnd(wrap.line);
+        }
+    }
+}
 
-            // If the line has newline characters, go back to the first one
-            while (isEOL(str[i - 1]) && i > 0)
-            {
-                --i;
-            }
+//------------------------------------------------------------------------------
+sn::u32 TextArea::getLineEnd(sn::u32 line) const
+{
+    const std::string & str = m_model.getLine(line);
 
-            m_caretIndex.x() = i;
-        }
+    // If the line has no newline character, place the caret at the end index.
+    u32 i = str.size();
+
+    // If the line has newline characters, go back to the first one
+    while (i > 0 && isEOL(str[i - 1]))
+    {
+        --i;
     }
+
+    return i;
 }
 
 //------------------------------------------------------------------------------
@@ -330,6 +376,46 @@ void TextArea::updateCaretPosition()
 {
     m_caretPosition = getCaretPositionFromIndex(m_caretIndex);
     resetCaretBlink();
+    scrollToCaret();
+}
+
+//------------------------------------------------------------------------------
+void TextArea::scrollToCaret()
+{
+    u32 rowCount = getVisibleRowCount();
+    if (m_currentWrap < m_scrollRow)
+        setScrollRow(m_currentWrap);
+    else if (m_currentWrap >= m_scrollRow + rowCount)
+        setScrollRow(m_currentWrap - rowCount + 1);
+}
+
+//------------------------------------------------------------------------------
+void TextArea::setScrollRow(sn::u32 row)
+{
+    u32 wrapCount = m_wrapper.getWrapCount();
+    if (row >= wrapCount)
+        row = wrapCount > 0 ? wrapCount - 1 : 0;
+    if (row != m_scrollRow)
+    {
+        m_scrollRow = row;
+        invalidateDraw();
+    }
+}
+
+//------------------------------------------------------------------------------
+sn::u32 TextArea::getVisibleRowCount() const
+{
+    const Theme * theme = getTheme();
+    if (theme == nullptr)
+        return 1;
+    const Font * font = theme->getFont();
+    if (font == nullptr)
+        return 1;
+
+    // Only rows entirely visible
+    s32 lineHeight = font->getLineHeight(theme->textFormat.size);
+    s32 rowCount = lineHeight > 0 ? getLocalClientBounds().height() / lineHeight : 0;
+    return rowCount > 1 ? rowCount : 1;
 }
 
 //------------------------------------------------------------------------------
@@ -354,9 +440,9 @@ sn::Vector2i TextArea::getCaretPositionFromIndex(sn::Vector2u index)
     // Get X
     if (index.y() < m_model.getLineCount())
     {
-        const std::string & str = m_model.getLine(index.y());
         const auto & wrap = m_wrapper.getWrap(m_currentWrap);
-        pos.x() = font->getLineWidth(str.c_str() + wrap.begin, index.x() - wrap.begin, format);
+        const GlyphRunCache::Run & run = m_glyphRuns.getRun(index.y(), *font, format);
+        pos.x() = run.getX(index.x()) - run.getX(wrap.begin);
     }
 
     return pos;
@@ -390,46 +476,57 @@ void TextArea::findCaretPositionFromPixelPos(Vector2i pixelPos, Vector2u & out_c
         return;
 
     // Find visual row
-    u32 visualRow = math::clamp(pixelPos.y() / lineHeight, 0, static_cast<s32>(m_wrapper.getWrapCount())-1);
+    s32 row = pixelPos.y() / lineHeight + static_cast<s32>(m_scrollRow);
+    u32 visualRow = math::clamp(row, 0, static_cast<s32>(m_wrapper.getWrapCount())-1);
     const auto & wrap = m_wrapper.getWrap(visualRow);
     out_wrapIndex = visualRow;
 
     // Find Y
     out_caretIndex.y() = wrap.line;
     out_caretPixelPos.y() = visualRow * lineHeight;
+    out_caretIndex.x() = wrap.begin;
 
     // Find column number and X coordinate
     if (pixelPos.x() > 0)
     {
         const std::string & str = m_model.getLine(wrap.line);
+        const GlyphRunCache::Run & run = m_glyphRuns.getRun(wrap.line, *font, format);
+        s32 rowX = run.getX(wrap.begin);
 
         u32 column = wrap.begin;
-        s32 cx = 0;
-
-        for (; column < str.size(); ++column)
+        for (; column < wrap.end; ++column)
         {
             char c = str[column];
             if (c == '\n' || c == '\r')
                 break;
-            const Glyph & glyph = font->getGlyph(c, format);
-            s32 offset = glyph.advance;
-            if (pixelPos.x() >= cx && pixelPos.x() < cx + offset)
+            if (pixelPos.x() < run.getX(column + 1) - rowX)
             {
                 // Found inline
                 break;
             }
-            cx += offset;
         }
         
         out_caretIndex.x() = column;
-        out_caretPixelPos.x() = cx;
+        out_caretPixelPos.x() = run.getX(column) - rowX;
     }
 }
 
 //------------------------------------------------------------------------------
 void TextArea::resetCaretBlink()
 {
-    m_lastMoveTime = getScene()->getTimeSinceStartup();
+    // Text can be edited before the control is in a scene
+    Scene * scene = getScene();
+    if (scene)
+        m_lastMoveTime = scene->getTimeSinceStartup();
+    m_caretVisible = true;
+    invalidateDraw();
+}
+
+//------------------------------------------------------------------------------
+bool TextArea::isCaretBlinkOn() const
+{
+    Time time = getScene()->getTimeSinceStartup();
+    return ((time - m_lastMoveTime).asMilliseconds() % (2*CARET_BLINK_INTERVAL_MS)) < CARET_BLINK_INTERVAL_MS;
 }
 
 //------------------------------------------------------------------------------
@@ -444,6 +541,127 @@ void TextArea::updateWrap()
         return;
 
     m_wrapper.update(getLocalClientBounds().width(), *font, theme->textFormat);
+    invalidateDraw();
+    updateCurrentWrapIndex();
+    setScrollRow(m_scrollRow);
+    updateCaretPosition();
+}
+
+//------------------------------------------------------------------------------
+void TextArea::updateLines(const TextModel::Change & change)
+{
+    // Only edited lines are shaped and wrapped again
+    m_glyphRuns.onLinesChanged(change);
+
+    const Theme * theme = getTheme();
+    const Font * font = theme ? theme->getFont() : nullptr;
+    if (font)
+        m_wrapper.updateLines(change, getLocalClientBounds().width(), *font, theme->textFormat);
+    else
+        m_wrapper.updateNoWrap(); // Will be wrapped once the control has a theme
+
+    invalidateDraw();
+}
+
+//------------------------------------------------------------------------------
+void TextArea::setText(const std::string & text)
+{
+    m_model.setSource(text);
+    m_glyphRuns.clear();
+    m_caretIndex = Vector2u(0, 0);
+    m_currentWrap = 0;
+    m_scrollRow = 0;
+
+    const Theme * theme = getTheme();
+    if (theme && theme->getFont())
+        updateWrap();
+    else
+        m_wrapper.updateNoWrap();
+
+    invalidateDraw();
+}
+
+//------------------------------------------------------------------------------
+void TextArea::getText(std::string & out_text) const
+{
+    m_model.getSource(out_text);
+}
+
+//------------------------------------------------------------------------------
+void TextArea::insertText(const std::string & text)
+{
+    updateLines(m_model.insertText(m_caretIndex, text));
+    updateCurrentWrapIndex();
+    updateCaretPosition();
+}
+
+//------------------------------------------------------------------------------
+void TextArea::appendText(const std::string & text)
+{
+    u32 rowCount = getVisibleRowCount();
+    bool followEnd = m_scrollRow + rowCount >= m_wrapper.getWrapCount();
+
+    updateLines(m_model.appendText(text));
+
+    // The caret keeps its index, but its row may have been wrapped again
+    updateCurrentWrapIndex();
+    m_caretPosition = getCaretPositionFromIndex(m_caretIndex);
+
+    u32 wrapCount = m_wrapper.getWrapCount();
+    if (followEnd && wrapCount > rowCount)
+        setScrollRow(wrapCount - rowCount);
+}
+
+//------------------------------------------------------------------------------
+void TextArea::eraseBeforeCaret()
+{
+    if (m_model.getLineCount() == 0)
+        return;
+
+    Vector2u begin = m_caretIndex;
+    if (begin.x() > 0)
+    {
+        --begin.x();
+    }
+    else if (begin.y() > 0)
+    {
+        // Join with the previous line
+        --begin.y();
+        begin.x() = getLineEnd(begin.y());
+    }
+    else
+    {
+        return;
+    }
+
+    updateLines(m_model.eraseText(begin, m_caretIndex));
+    m_caretIndex = begin;
+    updateCurrentWrapIndex();
+    updateCaretPosition();
+}
+
+//------------------------------------------------------------------------------
+void TextArea::eraseAfterCaret()
+{
+    if (m_model.getLineCount() == 0)
+        return;
+
+    Vector2u end = m_caretIndex;
+    if (end.x() < getLineEnd(end.y()))
+    {
+        ++end.x();
+    }
+    else if (end.y() + 1 < m_model.getLineCount())
+    {
+        // Join with the next line
+        end = Vector2u(0, end.y() + 1);
+    }
+    else
+    {
+        return;
+    }
+
+    updateLines(m_model.eraseText(m_caretIndex, end));
     updateCurrentWrapIndex();
     updateCaretPosition();
 }
@@ -465,7 +683,7 @@ void TextArea::unserializeState(const Variant & o, const sn::SerializationContex
 
     std::string text;
     sn::unserialize(o["text"], text);
-    m_model.setSource(text);
+    setText(text);
 }
 
 } // namespace tgui
@@ -6,6 +6,7 @@
 #include "Control.h"
 #include "../TextModel.h"
 #include "../TextWrapper.h"
+#include "../GlyphRunCache.h"
 
 namespace tgui
 {
@@ -26,6 +27,42 @@ public:
     void moveCaretUp();
     void moveCaretDown();
 
+    //--------------------------------
+    // Edition
+    //--------------------------------
+
+    /// \brief Replaces the whole text and puts the caret at the beginning
+    void setText(const std::string & text);
+    void getText(std::string & out_text) const;
+
+    /// \brief Inserts text at the caret and moves the caret after it
+    void insertText(const std::string & text);
+
+    /// \brief Adds text at the end without moving the caret.
+    /// If the end was visible, the view follows it, like a log.
+    void appendText(const std::string & text);
+
+    /// \brief Erases the character before the caret, joining lines at their beginning
+    void eraseBeforeCaret();
+
+    /// \brief Erases the character after the caret, joining lines at their end
+    void eraseAfterCaret();
+
+    //--------------------------------
+    // Scrolling
+    //--------------------------------
+
+    /// \brief Sets the first visual row drawn at the top of the control
+    void setScrollRow(sn::u32 row);
+    sn::u32 getScrollRow() const { return m_scrollRow; }
+
+    //--------------------------------
+    // Entity event handlers
+    //--------------------------------
+
+    void onReady() override;
+    void onUpdate() override;
+
     //--------------------------------
     // Serialization
     //--------------------------------
@@ -55,8 +92,13 @@ private:
     void updateCaretPosition();
     void updateCurrentWrapIndex();
     void resetCaretBlink();
+    bool isCaretBlinkOn() const;
     void moveCaretToEndOfLine();
+    sn::u32 getLineEnd(sn::u32 line) const;
     void updateWrap();
+    void updateLines(const TextModel::Change & change);
+    void scrollToCaret();
+    sn::u32 getVisibleRowCount() const;
 
 private:
     /// \brief Where the text is stored
@@ -65,6 +107,9 @@ private:
     /// \brief View of the text with wrapping
     TextWrapper m_wrapper;
 
+    /// \brief Glyphs of lines that were drawn or measured
+    GlyphRunCache m_glyphRuns;
+
     /// \brief Caret index within the text.
     /// X is the character number within the string (not wrapped),
     /// Y is the line number within TextModel.
@@ -73,6 +118,9 @@ private:
     /// \brief Current visual row of the caret (= wrap index)
     sn::u32 m_currentWrap;
 
+    /// \brief Visual row drawn at the top of the control
+    sn::u32 m_scrollRow;
+
     /// \brief Position of the caret in pixels.
     sn::Vector2i m_caretPosition;
 
@@ -80,6 +128,9 @@ private:
     /// Used for cursor blinking.
     sn::Time m_lastMoveTime;
 
+    /// \brief Blink state of the caret when the control was last drawn
+    bool m_caretVisible;
+
 };
 
 } // namespace tgui
@@ -24,6 +24,7 @@ void GridLayout::setColumnCount(sn::u32 newCount)
     Column defaultColumn;
     defaultColumn.scale = 1.f;
     m_columns.resize(newCount, defaultColumn);
+    invalidate();
 }
 
 //------------------------------------------------------------------------------
@@ -31,18 +32,21 @@ void GridLayout::setColumnScale(sn::u32 i, sn::f32 scale)
 {
     SN_ASSERT(i < m_columns.size(), "Column index is out of bounds");
     m_columns[i].scale = scale;
+    invalidate();
 }
 
 //------------------------------------------------------------------------------
 void GridLayout::setConstantRowHeight(sn::u32 h)
 {
     m_constantRowHeight = h;
+    invalidate();
 }
 
 //------------------------------------------------------------------------------
 void GridLayout::setIsConstantRowHeight(bool enable)
 {
     m_isConstantRowHeight = enable;
+    invalidate();
 }
 
 //------------------------------------------------------------------------------
@@ -56,7 +60,8 @@ void GridLayout::update()
 
     recalculateColumnSizes(*container);
 
-    std::vector<Control*> children;
+    std::vector<Control*> & children = m_children;
+    children.clear();
 	container->getChildrenOfType<Control>(children);
 
 	const Border & padding = container->getPadding();
@@ -109,7 +114,6 @@ void GridLayout::update()
             childBounds.height() = rowHeight - childMargin.top - childMargin.bottom;
 
             child.setLocalClientBounds(childBounds);
-            child.layoutChildren();
         }
 
         childIndex += m_columns.size();
@@ -40,6 +40,7 @@ private:
 
 private:
     std::vector<Column> m_columns;
+    std::vector<Control*> m_children; // Kept between updates to avoid allocating on each layout
     sn::s32 m_columnSpacing;
     sn::s32 m_rowSpacing;
     bool m_isConstantRowHeight;
@@ -37,9 +37,12 @@ protected:
 	Control * getContainer() const { return r_container; }
 	void setContainer(Control & c) { r_container = &c; }
 
+	/// \brief Tells the container must be laid out again, after a parameter of the layout changed
+	void invalidate();
+
 	/// \brief Gets child controls affected by layout positionning.
 	/// \param parent: container
-	/// \param out_controls
+	/// \param out_controls: controls are appended to it, so a vector kept between updates can be reused.
 	/// \param out_indexes: if not null, indexes in the parent will be stored here.
 	static void getChildrenToLayout(
 		Control & parent, 
@@ -21,13 +21,21 @@ ListLayout::ListLayout(Control * control):
 //------------------------------------------------------------------------------
 void ListLayout::setOrientation(Orientation newOrientation)
 {
-    m_orientation = newOrientation;
+    if (newOrientation != m_orientation)
+    {
+        m_orientation = newOrientation;
+        invalidate();
+    }
 }
 
 //------------------------------------------------------------------------------
 void ListLayout::setSpacing(sn::s32 newSpacing)
 {
-    m_spacing = newSpacing;
+    if (newSpacing != m_spacing)
+    {
+        m_spacing = newSpacing;
+        invalidate();
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -36,10 +44,12 @@ void ListLayout::update()
 	Control * container = getContainer();
 	SN_ASSERT(container != nullptr, "ListLayout container is null!");
 
-	// TODO Have a dirty flag to avoid calculating layouts when nothing changed
+	// Only called when the container was invalidated or resized
 
-    std::vector<Control*> children;
-	std::vector<u32> childrenIndex;
+	std::vector<Control*> & children = m_children;
+	std::vector<u32> & childrenIndex = m_childrenIndex;
+	children.clear();
+	childrenIndex.clear();
 	Layout::getChildrenToLayout(*container, children, &childrenIndex);
 
 	// Get container bounds with padding
@@ -58,7 +68,7 @@ void ListLayout::update()
 
 	cellBounds.size()[xi] = localBounds.size()[xi];
 
-	std::vector<IntRect> calculatedBounds;
+	std::vector<IntRect> & calculatedBounds = m_calculatedBounds;
 	calculatedBounds.resize(children.size());
 
 	// Space left for filler controls
@@ -119,8 +129,8 @@ void ListLayout::update()
 	{
 		const auto & p = calculatedBounds[i];
 		Control & child = *children[i];
+		// Children are laid out in the same pass if their size changed
 		child.setLocalClientBounds(p);
-		child.layoutChildren();
 	}
 }
 
@@ -1,6 +1,8 @@
 #ifndef __HEADER_TGUI_LIST_LAYOUT__
 #define __HEADER_TGUI_LIST_LAYOUT__
 
+#include <vector>
+#include <core/math/Rect.h>
 #include "Layout.h"
 #include "../Orientation.h"
 
@@ -31,6 +33,11 @@ private:
     Orientation m_orientation;
 	std::unordered_set<sn::u32> m_fillers; // TODO Should use weak refs rather than child indexes
 
+	// Kept between updates to avoid allocating on each layout
+	std::vector<Control*> m_children;
+	std::vector<sn::u32> m_childrenIndex;
+	std::vector<sn::IntRect> m_calculatedBounds;
+
 };
 
 } // namespace tgui
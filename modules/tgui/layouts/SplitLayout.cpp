@@ -120,6 +120,7 @@ void SplitLayout::split(Control * dockContent, Direction direction)
     m_orientation = o;
     m_position = 0.5f;
     r_control = nullptr;
+    invalidate();
 }
 
 //------------------------------------------------------------------------------
@@ -129,6 +130,7 @@ void SplitLayout::join(u8 i)
         
     r_control = m_children[i]->r_control;
     clearChildren();
+    invalidate();
 }
 
 //------------------------------------------------------------------------------
@@ -187,6 +189,7 @@ void SplitLayout::setSplitPosition(const DockPath & path, sn::s32 pixelPos)
 
 	// Set sizer position
 	target->setLocalSplitPosition(pixelPos - offset);
+	invalidate();
 }
 
 //------------------------------------------------------------------------------
@@ -277,7 +280,6 @@ void SplitLayout::layout(const IntRect & bounds)
         if (r_control)
         {
             r_control->setLocalClientBounds(bounds);
-			r_control->layoutChildren();
         }
     }
     else
@@ -95,6 +95,15 @@ bool ThemeLoader::load(std::ifstream & ifs, sn::Asset & asset) const
     else
         SN_WERROR(L"No material specified in theme " << asset.getAssetMetadata().path);
 
+    // Get text material (optional, needed by distance field fonts)
+    const Variant & textMaterialData = o["textMaterial"];
+    if (!textMaterialData.isNil())
+    {
+        sn::Material * textMat = sn::getAssetBySerializedLocation<sn::Material>(textMaterialData.getString(), ctx.getProject(), true);
+        if (textMat)
+            theme->setTextMaterial(*textMat);
+    }
+
     // Get font
     Font * font = sn::getAssetBySerializedLocation<Font>(o["font"].getString(), ctx.getProject(), true);
     if (font)
@@ -55,6 +55,10 @@ public:
     void setMaterial(sn::Material & m) { r_material.set(&m); }
     sn::Material * getMaterial() const { return r_material.isNull() ? nullptr : r_material.get(); }
 
+    /// \brief Sets the material used to draw text of distance field fonts
+    void setTextMaterial(sn::Material & m) { r_textMaterial.set(&m); }
+    sn::Material * getTextMaterial() const { return r_textMaterial.isNull() ? nullptr : r_textMaterial.get(); }
+
     sn::Vector2u getTextureAtlasSize() const { return m_textureSize; }
 
     void setFont(sn::Font & font) { r_font.set(&font); }
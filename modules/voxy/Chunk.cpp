@@ -0,0 +1,68 @@
+#include "Chunk.h"
+
+namespace voxy
+{
+
+//------------------------------------------------------------------------------
+Chunk::Chunk(const sn::Vector3i & position, const u8 * defaultValues):
+	m_position(position),
+	m_refCount(1)
+{
+	if (defaultValues)
+	{
+		for (u32 i = 0; i < ATTRIB_MAX; ++i)
+			m_channels[i].fill(defaultValues[i]);
+	}
+}
+
+//------------------------------------------------------------------------------
+Chunk * Chunk::clone() const
+{
+	Chunk * chunk = new Chunk(m_position);
+	for (u32 i = 0; i < ATTRIB_MAX; ++i)
+		chunk->m_channels[i] = m_channels[i];
+	return chunk;
+}
+
+//------------------------------------------------------------------------------
+void Chunk::release() const
+{
+	if (--m_refCount == 0)
+		delete this;
+}
+
+//------------------------------------------------------------------------------
+bool Chunk::isUniform() const
+{
+	for (u32 i = 0; i < ATTRIB_MAX; ++i)
+	{
+		if (!m_channels[i].isUniform())
+			return false;
+	}
+	return true;
+}
+
+//------------------------------------------------------------------------------
+void Chunk::optimize()
+{
+	for (u32 i = 0; i < ATTRIB_MAX; ++i)
+		m_channels[i].optimize();
+}
+
+//------------------------------------------------------------------------------
+void Chunk::compress()
+{
+	for (u32 i = 0; i < ATTRIB_MAX; ++i)
+		m_channels[i].compress();
+}
+
+//------------------------------------------------------------------------------
+u32 Chunk::getMemoryUsage() const
+{
+	u32 bytes = sizeof(Chunk) - sizeof(m_channels);
+	for (u32 i = 0; i < ATTRIB_MAX; ++i)
+		bytes += m_channels[i].getMemoryUsage();
+	return bytes;
+}
+
+} // namespace voxy
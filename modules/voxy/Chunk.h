@@ -0,0 +1,63 @@
+#ifndef __HEADER_VOXY_CHUNK__
+#define __HEADER_VOXY_CHUNK__
+
+#include "VoxelChannel.h"
+#include <core/math/Vector3.h>
+#include <atomic>
+
+namespace voxy
+{
+
+/// \brief Cubic piece of terrain of CHUNK_SIZE voxels, with one compressed channel per attribute.
+/// Chunks are reference-counted so terrains and snapshots can share them (copy-on-write):
+/// a chunk referenced more than once must not be modified, clone it instead.
+/// Unlike sn::RefCounted, the count is atomic so snapshots can be released from any thread.
+class Chunk
+{
+public:
+	/// \brief Creates a chunk with a reference count of 1
+	Chunk(const sn::Vector3i & position, const u8 * defaultValues = nullptr);
+
+	/// \brief Creates a copy of the chunk, with a reference count of 1
+	Chunk * clone() const;
+
+	void addRef() const { ++m_refCount; }
+	void release() const;
+	u32 getRefCount() const { return m_refCount; }
+	bool isShared() const { return m_refCount > 1; }
+
+	/// \brief Gets the position of the chunk, in chunks
+	const sn::Vector3i & getPosition() const { return m_position; }
+
+	static u32 getIndex(u32 x, u32 y, u32 z) { return x | ((y | (z << CHUNK_SIZE_LOG2)) << CHUNK_SIZE_LOG2); }
+
+	u8 get(Attribute a, u32 x, u32 y, u32 z) const { return m_channels[a].get(getIndex(x, y, z)); }
+	void set(Attribute a, u32 x, u32 y, u32 z, u8 v) { m_channels[a].set(getIndex(x, y, z), v); }
+
+	const VoxelChannel & getChannel(Attribute a) const { return m_channels[a]; }
+	VoxelChannel & getChannel(Attribute a) { return m_channels[a]; }
+
+	/// \brief Tests if all attributes are uniform
+	bool isUniform() const;
+
+	void optimize();
+	void compress();
+
+	u32 getMemoryUsage() const;
+
+private:
+	// Chunks are deleted by release()
+	~Chunk() {}
+	Chunk(const Chunk &);
+	Chunk & operator=(const Chunk &);
+
+private:
+	sn::Vector3i m_position;
+	VoxelChannel m_channels[ATTRIB_MAX];
+	mutable std::atomic<u32> m_refCount;
+
+};
+
+} // namespace voxy
+
+#endif // __HEADER_VOXY_CHUNK__
@@ -1,47 +1,305 @@
 #include "MeshBuilder.h"
+#include <cstring>
 
 using namespace sn;
 
 namespace voxy
 {
 
-	namespace
+//------------------------------------------------------------------------------
+void VoxelMeshData::clear()
+{
+	positions.clear();
+	normals.clear();
+	colors.clear();
+	indices.clear();
+}
+
+//------------------------------------------------------------------------------
+MeshBuilder::MeshBuilder()
+{
+	for (u32 i = 0; i < 256; ++i)
+		m_colorPalette[i] = Color8(255, 255, 255);
+}
+
+//------------------------------------------------------------------------------
+void MeshBuilder::process(const ChunkNeighborhood & chunks, VoxelMeshData & out_data)
+{
+	out_data.clear();
+
+	// Nothing to see in empty chunks
+	const Chunk * center = chunks.getCenter();
+	if (center == nullptr || center->getChannel(ATTRIB_TYPE).isUniform())
+	{
+		if (chunks.get(ATTRIB_TYPE, 0, 0, 0) == 0)
+			return;
+	}
+
+	// Colors of neighbors are not needed, faces only use colors of their own voxel
+	chunks.copyPadded(ATTRIB_TYPE, 1, m_types);
+	if (center)
+		center->getChannel(ATTRIB_COLOR).copyTo(m_colors);
+	else
+		memset(m_colors, chunks.get(ATTRIB_COLOR, 0, 0, 0), sizeof(m_colors));
+	buildGeometry(out_data);
+}
+
+//------------------------------------------------------------------------------
+void MeshBuilder::process(const ChunkNeighborhood & chunks, sn::Mesh & out_mesh)
+{
+	process(chunks, m_data);
+	upload(m_data, out_mesh);
+}
+
+//------------------------------------------------------------------------------
+void MeshBuilder::process(const Block & block, sn::Mesh & out_mesh)
+{
+	memset(m_types, 0, sizeof(m_types));
+	const u8 * types = block.getArray(ATTRIB_TYPE);
+	for (u32 z = 0; z < CHUNK_SIZE; ++z)
 	{
-		struct Face
+		for (u32 y = 0; y < CHUNK_SIZE; ++y)
 		{
+			u8 * row = m_types + 1 + PADDED_SIZE * ((y + 1) + PADDED_SIZE * (z + 1));
+			if (types)
+				memcpy(row, types + block.getIndex(0, y, z), CHUNK_SIZE);
+			else
+				memset(row, block.getAttributeDefaultValue(ATTRIB_TYPE), CHUNK_SIZE);
+		}
+	}
+
+	// Blocks are laid out like chunks
+	const u8 * colors = block.getArray(ATTRIB_COLOR);
+	if (colors)
+		memcpy(m_colors, colors, sizeof(m_colors));
+	else
+		memset(m_colors, block.getAttributeDefaultValue(ATTRIB_COLOR), sizeof(m_colors));
+
+	m_data.clear();
+	buildGeometry(m_data);
+	upload(m_data, out_mesh);
+}
+
+//------------------------------------------------------------------------------
+void MeshBuilder::buildGeometry(VoxelMeshData & out_data)
+{
+	const u32 S = CHUNK_SIZE;
+	const u32 P = PADDED_SIZE;
+
+	// Solid voxels as rows of bits along X, bit 0 being the padding voxel at x = -1.
+	// Faces of a whole row are then found with a few bitwise operations.
+	for (u32 i = 0; i < P * P; ++i)
+	{
+		const u8 * types = m_types + i * P;
+		u32 row = 0;
+		for (u32 x = 0; x < P; ++x)
+			row |= (types[x] != 0) << x;
+		m_solidRows[i] = row;
+	}
 
-		};
+	// Directions are -X, +X, -Y, +Y, -Z, +Z
+	for (u32 dir = 0; dir < 6; ++dir)
+	{
+		const u32 d = dir / 2;
+		const u32 side = dir & 1;
+		const u32 u = (d + 1) % 3;
+		const u32 v = (d + 2) % 3;
 
-		struct VoxelDescription
+		// Rows of visible faces in the chunk, indexed by y + z * S, bit x for voxel x
+		u32 anyFaces = 0;
+		for (u32 z = 0; z < S; ++z)
 		{
-			bool isTransparent;
-			bool isCube;
-		};
+			for (u32 y = 0; y < S; ++y)
+			{
+				u32 i = (y + 1) + P * (z + 1);
+				u32 row = m_solidRows[i];
+				u32 neighbors;
+				switch (dir)
+				{
+				case 0: neighbors = row << 1; break;
+				case 1: neighbors = row >> 1; break;
+				case 2: neighbors = m_solidRows[i - 1]; break;
+				case 3: neighbors = m_solidRows[i + 1]; break;
+				case 4: neighbors = m_solidRows[i - P]; break;
+				default: neighbors = m_solidRows[i + P]; break;
+				}
+				u32 faces = ((row & ~neighbors) >> 1) & ((1 << S) - 1);
+				m_faceRows[y + z * S] = faces;
+				anyFaces |= faces;
+			}
+		}
+		if (anyFaces == 0)
+			continue;
+
+		for (u32 layer = 0; layer < S; ++layer)
+		{
+			// Find faces of the slice, in the plane of the two other axes
+			if (!gatherSliceFaces(d, layer, anyFaces))
+				continue;
+
+			// Merge them into rectangles
+			for (u32 j = 0; j < S; ++j)
+			{
+				for (u32 i = 0; i < S;)
+				{
+					u16 key = m_faceMask[j * S + i];
+					if (key == 0)
+					{
+						++i;
+						continue;
+					}
 
+					u32 width = 1;
+					while (i + width < S && m_faceMask[j * S + i + width] == key)
+						++width;
 
+					u32 height = 1;
+					for (; j + height < S; ++height)
+					{
+						const u16 * row = m_faceMask + (j + height) * S + i;
+						u32 k = 0;
+						while (k < width && row[k] == key)
+							++k;
+						if (k < width)
+							break;
+					}
+
+					for (u32 h = 0; h < height; ++h)
+						memset(m_faceMask + (j + h) * S + i, 0, width * sizeof(u16));
+
+					u32 origin[3];
+					origin[d] = layer + side;
+					origin[u] = i;
+					origin[v] = j;
+					addQuad(out_data, d, side, origin, width, height, key);
+
+					i += width;
+				}
+			}
+		}
 	}
+}
 
-void MeshBuilder::process(const Block & block, sn::Mesh & out_mesh)
+//------------------------------------------------------------------------------
+// Fills the face mask from face rows, as (type << 8) | color.
+// The mask is indexed by i + j * S, where i and j go along the U and V axes of the slice.
+bool MeshBuilder::gatherSliceFaces(u32 d, u32 layer, u32 anyFaces)
 {
-	//const u8 * attribArray = block.getArray(Block::ATTRIB_COLOR);
+	const u32 S = CHUNK_SIZE;
+	const u32 P = PADDED_SIZE;
 
-	for (u32 z = 0; z < block.sizeZ(); ++z)
+	if (d == 0)
 	{
-		for (u32 y = 0; y < block.sizeY(); ++y)
+		// U = Y, V = Z: each row gives at most one face
+		if ((anyFaces & (1 << layer)) == 0)
+			return false;
+		for (u32 z = 0; z < S; ++z)
 		{
-			u8 a_prev = 0;
-			for (u32 x = 0; x < block.sizeX(); ++x)
+			for (u32 y = 0; y < S; ++y)
 			{
-				u8 a = block.getValueRaw(ATTRIB_COLOR, block.getIndex(x, y, z));
-				
-                // TODO
+				u16 key = 0;
+				if (m_faceRows[y + z * S] & (1 << layer))
+				{
+					u32 i = (layer + 1) + P * ((y + 1) + P * (z + 1));
+					key = (m_types[i] << 8) | m_colors[Chunk::getIndex(layer, y, z)];
+				}
+				m_faceMask[y + z * S] = key;
+			}
+		}
+		return true;
+	}
+
+	bool hasFaces = false;
+	memset(m_faceMask, 0, sizeof(m_faceMask));
 
+	// Y slices have U = Z and V = X, Z slices have U = X and V = Y
+	for (u32 k = 0; k < S; ++k)
+	{
+		u32 y = d == 1 ? layer : k;
+		u32 z = d == 1 ? k : layer;
+		u32 faces = m_faceRows[y + z * S];
+		if (faces == 0)
+			continue;
+		hasFaces = true;
 
-				a_prev = a;
+		const u8 * types = m_types + P * ((y + 1) + P * (z + 1)) + 1;
+		const u8 * colors = m_colors + Chunk::getIndex(0, y, z);
+		for (u32 x = 0; faces != 0; ++x, faces >>= 1)
+		{
+			if (faces & 1)
+			{
+				u32 maskIndex = d == 1 ? k + x * S : x + k * S;
+				m_faceMask[maskIndex] = (types[x] << 8) | colors[x];
 			}
 		}
 	}
+	return hasFaces;
 }
 
-} // namespace voxy
+//------------------------------------------------------------------------------
+void MeshBuilder::addQuad(VoxelMeshData & out_data, u32 d, u32 side, const u32 origin[3], u32 width, u32 height, u16 key)
+{
+	const u32 u = (d + 1) % 3;
+	const u32 v = (d + 2) % 3;
 
+	u32 firstIndex = out_data.getVertexCount();
+
+	// Corners go counter-clockwise around the U x V axis, which is the D axis
+	const u32 cornerU[4] = { 0, width, width, 0 };
+	const u32 cornerV[4] = { 0, 0, height, height };
+	for (u32 c = 0; c < 4; ++c)
+	{
+		u8 p[4] = { 0, 0, 0, 1 };
+		p[d] = origin[d];
+		p[u] = origin[u] + cornerU[c];
+		p[v] = origin[v] + cornerV[c];
+		out_data.positions.insert(out_data.positions.end(), p, p + 4);
+
+		s8 n[4] = { 0, 0, 0, 0 };
+		n[d] = side ? 127 : -127;
+		out_data.normals.insert(out_data.normals.end(), n, n + 4);
+
+		out_data.colors.push_back(m_colorPalette[key & 0xff]);
+	}
+
+	// Faces looking towards negative coordinates go the other way around
+	static const u32 s_quadIndices[2][6] = {
+		{ 0, 2, 1, 0, 3, 2 },
+		{ 0, 1, 2, 0, 2, 3 }
+	};
+	for (u32 k = 0; k < 6; ++k)
+		out_data.indices.push_back(firstIndex + s_quadIndices[side][k]);
+}
+
+//------------------------------------------------------------------------------
+void MeshBuilder::createVertexDescription(VertexDescription & out_description)
+{
+	out_description.addAttribute("Position", VertexAttribute::USE_POSITION, VertexAttribute::TYPE_UINT8, 4);
+	out_description.addAttribute("Normal", VertexAttribute::USE_NORMAL, VertexAttribute::TYPE_INT8, 4, true);
+	out_description.addAttribute("Color", VertexAttribute::USE_COLOR, VertexAttribute::TYPE_UINT8, 4, true);
+}
+
+//------------------------------------------------------------------------------
+void MeshBuilder::upload(const VoxelMeshData & data, sn::Mesh & out_mesh)
+{
+	const VertexAttribute * position = out_mesh.getVertexDescription().getAttributeByUse(VertexAttribute::USE_POSITION);
+	if (position == nullptr || position->type != VertexAttribute::TYPE_UINT8)
+	{
+		VertexDescription description;
+		createVertexDescription(description);
+		out_mesh.create(description);
+	}
+
+	out_mesh.clear();
+	out_mesh.setPrimitiveType(SN_MESH_TRIANGLES);
+	out_mesh.setBounds(FloatAABB(0, 0, 0, CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE));
+	if (data.isEmpty())
+		return;
+
+	out_mesh.updateArray(VertexAttribute::USE_POSITION, data.positions);
+	out_mesh.updateArray(VertexAttribute::USE_NORMAL, data.normals);
+	out_mesh.updateArray(VertexAttribute::USE_COLOR, data.colors);
+	out_mesh.updateIndices(data.indices);
+}
+
+} // namespace voxy
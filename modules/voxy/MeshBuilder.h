@@ -8,17 +8,80 @@
 namespace voxy
 {
 
+/// \brief Geometry of a chunk in the vertex format of voxel meshes, before it is copied into a sn::Mesh.
+/// Vertices take 12 bytes:
+/// - Position: 4 unsigned bytes, in voxels relative to the chunk origin, w = 1
+/// - Normal: 4 signed normalized bytes, w = 0
+/// - Color: 4 unsigned normalized bytes
+struct VoxelMeshData
+{
+	std::vector<u8> positions;
+	std::vector<sn::s8> normals;
+	std::vector<sn::Color8> colors;
+	std::vector<u32> indices;
+
+	void clear();
+	bool isEmpty() const { return indices.empty(); }
+	u32 getVertexCount() const { return positions.size() / 4; }
+	u32 getTriangleCount() const { return indices.size() / 3; }
+};
+
+/// \brief Builds meshes from voxels.
+/// Voxels are solid when their type is not zero, and only faces between solid and empty voxels are generated.
+/// Adjacent faces of the same type and color are merged into larger quads (greedy meshing).
+/// Note: a MeshBuilder must be used by one thread at a time, but several builders can run in parallel.
 class MeshBuilder
 {
 public:
+	static const u32 PADDED_SIZE = CHUNK_SIZE + 2;
+	static const u32 PADDED_VOLUME = PADDED_SIZE * PADDED_SIZE * PADDED_SIZE;
+
+	MeshBuilder();
+
+	/// \brief Sets the color of voxels having the given value in their ATTRIB_COLOR attribute
+	void setColor(u8 index, const sn::Color8 & color) { m_colorPalette[index] = color; }
+	const sn::Color8 & getColor(u8 index) const { return m_colorPalette[index]; }
+
+	/// \brief Builds the geometry of the central chunk of a neighborhood.
+	/// Faces hidden by voxels of neighbor chunks are culled.
+	void process(const ChunkNeighborhood & chunks, VoxelMeshData & out_data);
+	void process(const ChunkNeighborhood & chunks, sn::Mesh & out_mesh);
+
+	/// \brief Builds the geometry of a block, as if it was surrounded by empty voxels.
 	void process(const Block & block, sn::Mesh & out_mesh);
 
+	/// \brief Copies geometry into a mesh, setting up the vertex format of voxel meshes if needed.
+	static void upload(const VoxelMeshData & data, sn::Mesh & out_mesh);
+
+	static void createVertexDescription(sn::VertexDescription & out_description);
+
+private:
+	void buildGeometry(VoxelMeshData & out_data);
+	bool gatherSliceFaces(u32 d, u32 layer, u32 anyFaces);
+	void addQuad(VoxelMeshData & out_data, u32 d, u32 side, const u32 origin[3], u32 width, u32 height, u16 key);
+
 private:
-	sn::Color8 m_colorPalette[255];
+	sn::Color8 m_colorPalette[256];
+
+	// Types of the voxels to process, with one voxel of padding on each side
+	u8 m_types[PADDED_VOLUME];
+	// Colors of the voxels to process, without padding
+	u8 m_colors[CHUNK_VOLUME];
+
+	// Solid voxels of the padded area, as one row of bits along X per Y and Z
+	u32 m_solidRows[PADDED_SIZE * PADDED_SIZE];
+
+	// Visible faces of the chunk in the current direction, as one row of bits along X per Y and Z
+	u32 m_faceRows[CHUNK_SIZE * CHUNK_SIZE];
+
+	// Faces of the current slice, as (type << 8) | color. Zero means no face.
+	u16 m_faceMask[CHUNK_SIZE * CHUNK_SIZE];
+
+	// Used when building directly into a sn::Mesh
+	VoxelMeshData m_data;
 
 };
 
 } // namespace voxy
 
 #endif // __HEADER_VOXY_MESHBUILDER__
-
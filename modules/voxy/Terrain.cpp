@@ -1,7 +1,343 @@
 #include "Terrain.h"
+#include <core/util/assert.h>
+#include <cstring>
+
+using namespace sn;
 
 namespace voxy
 {
 
-} // namespace voxy
+//------------------------------------------------------------------------------
+TerrainMemoryStats::TerrainMemoryStats():
+	chunkCount(0),
+	sharedChunkCount(0),
+	uniformChunkCount(0),
+	byteCount(0),
+	uncompressedByteCount(0)
+{
+	memset(channelCounts, 0, sizeof(channelCounts));
+}
+
+//------------------------------------------------------------------------------
+Terrain::Terrain()
+{
+	memset(m_defaultValues, 0, sizeof(m_defaultValues));
+}
+
+//------------------------------------------------------------------------------
+Terrain::Terrain(const Terrain & other)
+{
+	memset(m_defaultValues, 0, sizeof(m_defaultValues));
+	*this = other;
+}
+
+//------------------------------------------------------------------------------
+Terrain::~Terrain()
+{
+	clear();
+}
+
+//------------------------------------------------------------------------------
+Terrain & Terrain::operator=(const Terrain & other)
+{
+	if (&other == this)
+		return *this;
+
+	clear();
+
+	// Chunks are shared, the first modification on either side will copy them
+	m_chunks = other.m_chunks;
+	for (auto it = m_chunks.begin(); it != m_chunks.end(); ++it)
+		it->second->addRef();
+
+	memcpy(m_defaultValues, other.m_defaultValues, sizeof(m_defaultValues));
+	return *this;
+}
+
+//------------------------------------------------------------------------------
+Vector3i Terrain::toChunkPosition(s32 x, s32 y, s32 z)
+{
+	return Vector3i(toChunkCoordinate(x), toChunkCoordinate(y), toChunkCoordinate(z));
+}
+
+//------------------------------------------------------------------------------
+void Terrain::setDefaultValue(Attribute a, u8 value)
+{
+	m_defaultValues[a] = value;
+}
 
+//------------------------------------------------------------------------------
+u8 Terrain::getVoxel(Attribute a, s32 x, s32 y, s32 z) const
+{
+	const Chunk * chunk = getChunk(toChunkPosition(x, y, z));
+	if (chunk == nullptr)
+		return m_defaultValues[a];
+	return chunk->get(a, x & CHUNK_MASK, y & CHUNK_MASK, z & CHUNK_MASK);
+}
+
+//------------------------------------------------------------------------------
+void Terrain::setVoxel(Attribute a, s32 x, s32 y, s32 z, u8 value)
+{
+	Vector3i position = toChunkPosition(x, y, z);
+
+	// Don't create a chunk if it wouldn't change anything
+	const Chunk * chunk = getChunk(position);
+	u8 previousValue = chunk ? chunk->get(a, x & CHUNK_MASK, y & CHUNK_MASK, z & CHUNK_MASK) : m_defaultValues[a];
+	if (previousValue == value)
+		return;
+
+	getChunkForWrite(position)->set(a, x & CHUNK_MASK, y & CHUNK_MASK, z & CHUNK_MASK, value);
+}
+
+//------------------------------------------------------------------------------
+const Chunk * Terrain::getChunk(const Vector3i & position) const
+{
+	auto it = m_chunks.find(position);
+	return it != m_chunks.end() ? it->second : nullptr;
+}
+
+//------------------------------------------------------------------------------
+Chunk * Terrain::getChunkForWrite(const Vector3i & position)
+{
+	Chunk *& chunk = m_chunks[position];
+	if (chunk == nullptr)
+	{
+		chunk = new Chunk(position, m_defaultValues);
+	}
+	else if (chunk->isShared())
+	{
+		Chunk * copy = chunk->clone();
+		chunk->release();
+		chunk = copy;
+	}
+	return chunk;
+}
+
+//------------------------------------------------------------------------------
+const Chunk * Terrain::acquireChunk(const Vector3i & position) const
+{
+	const Chunk * chunk = getChunk(position);
+	if (chunk)
+		chunk->addRef();
+	return chunk;
+}
+
+//------------------------------------------------------------------------------
+void Terrain::setChunk(Chunk * chunk)
+{
+	SN_ASSERT(chunk != nullptr, "Invalid state");
+	Chunk *& slot = m_chunks[chunk->getPosition()];
+	if (slot)
+		slot->release();
+	slot = chunk;
+}
+
+//------------------------------------------------------------------------------
+void Terrain::removeChunk(const Vector3i & position)
+{
+	auto it = m_chunks.find(position);
+	if (it != m_chunks.end())
+	{
+		it->second->release();
+		m_chunks.erase(it);
+	}
+}
+
+//------------------------------------------------------------------------------
+void Terrain::getChunkPositions(std::vector<Vector3i> & out_positions) const
+{
+	out_positions.clear();
+	out_positions.reserve(m_chunks.size());
+	for (auto it = m_chunks.begin(); it != m_chunks.end(); ++it)
+		out_positions.push_back(it->first);
+}
+
+//------------------------------------------------------------------------------
+void Terrain::clear()
+{
+	for (auto it = m_chunks.begin(); it != m_chunks.end(); ++it)
+		it->second->release();
+	m_chunks.clear();
+}
+
+//------------------------------------------------------------------------------
+void Terrain::optimize()
+{
+	// Shared chunks may be read by other threads, they are left as they are
+	for (auto it = m_chunks.begin(); it != m_chunks.end(); ++it)
+	{
+		if (!it->second->isShared())
+			it->second->optimize();
+	}
+}
+
+//------------------------------------------------------------------------------
+void Terrain::compress()
+{
+	for (auto it = m_chunks.begin(); it != m_chunks.end(); ++it)
+	{
+		if (!it->second->isShared())
+			it->second->compress();
+	}
+}
+
+//------------------------------------------------------------------------------
+void Terrain::removeDefaultChunks()
+{
+	for (auto it = m_chunks.begin(); it != m_chunks.end();)
+	{
+		const Chunk & chunk = *it->second;
+		bool isDefault = true;
+		for (u32 a = 0; a < ATTRIB_MAX && isDefault; ++a)
+		{
+			const VoxelChannel & channel = chunk.getChannel(static_cast<Attribute>(a));
+			isDefault = channel.isUniform() && channel.getUniformValue() == m_defaultValues[a];
+		}
+
+		if (isDefault)
+		{
+			chunk.release();
+			it = m_chunks.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+void Terrain::getMemoryStats(TerrainMemoryStats & out_stats) const
+{
+	out_stats = TerrainMemoryStats();
+	out_stats.chunkCount = m_chunks.size();
+
+	for (auto it = m_chunks.begin(); it != m_chunks.end(); ++it)
+	{
+		const Chunk & chunk = *it->second;
+		if (chunk.isShared())
+			++out_stats.sharedChunkCount;
+		if (chunk.isUniform())
+			++out_stats.uniformChunkCount;
+		for (u32 a = 0; a < ATTRIB_MAX; ++a)
+			++out_stats.channelCounts[chunk.getChannel(static_cast<Attribute>(a)).getMode()];
+		out_stats.byteCount += chunk.getMemoryUsage();
+	}
+
+	out_stats.uncompressedByteCount = out_stats.chunkCount * (sizeof(Block) + ATTRIB_MAX * CHUNK_VOLUME);
+}
+
+//------------------------------------------------------------------------------
+// ChunkNeighborhood
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+ChunkNeighborhood::ChunkNeighborhood()
+{
+	memset(m_chunks, 0, sizeof(m_chunks));
+	memset(m_defaultValues, 0, sizeof(m_defaultValues));
+}
+
+//------------------------------------------------------------------------------
+ChunkNeighborhood::~ChunkNeighborhood()
+{
+	clear();
+}
+
+//------------------------------------------------------------------------------
+void ChunkNeighborhood::load(const Terrain & terrain, const Vector3i & position)
+{
+	clear();
+	m_position = position;
+	memcpy(m_defaultValues, terrain.getDefaultValues(), sizeof(m_defaultValues));
+
+	u32 i = 0;
+	for (s32 z = -1; z <= 1; ++z)
+	{
+		for (s32 y = -1; y <= 1; ++y)
+		{
+			for (s32 x = -1; x <= 1; ++x)
+				m_chunks[i++] = terrain.acquireChunk(position + Vector3i(x, y, z));
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+void ChunkNeighborhood::clear()
+{
+	for (u32 i = 0; i < 27; ++i)
+	{
+		if (m_chunks[i])
+		{
+			m_chunks[i]->release();
+			m_chunks[i] = nullptr;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+void ChunkNeighborhood::copyPadded(Attribute a, u32 padding, u8 * out_values) const
+{
+	SN_ASSERT(padding <= CHUNK_SIZE, "Invalid padding");
+
+	const u32 size = CHUNK_SIZE + 2 * padding;
+
+	// For each relative chunk position on an axis: first source voxel, first destination voxel, count
+	const u32 ranges[3][3] = {
+		{ CHUNK_SIZE - padding, 0, padding },
+		{ 0, padding, CHUNK_SIZE },
+		{ 0, padding + CHUNK_SIZE, padding }
+	};
+
+	u8 values[CHUNK_VOLUME];
+
+	for (u32 cz = 0; cz < 3; ++cz)
+	{
+		for (u32 cy = 0; cy < 3; ++cy)
+		{
+			for (u32 cx = 0; cx < 3; ++cx)
+			{
+				const u32 * rx = ranges[cx];
+				const u32 * ry = ranges[cy];
+				const u32 * rz = ranges[cz];
+				if (rx[2] == 0 || ry[2] == 0 || rz[2] == 0)
+					continue;
+
+				const Chunk * chunk = m_chunks[cx + 3 * (cy + 3 * cz)];
+				const VoxelChannel * channel = chunk ? &chunk->getChannel(a) : nullptr;
+
+				// Uniform areas are filled without decoding anything,
+				// and thin slices of neighbors are read voxel by voxel rather than decoding the whole chunk
+				bool uniform = channel == nullptr || channel->isUniform();
+				u8 uniformValue = channel ? channel->getUniformValue() : m_defaultValues[a];
+				bool decode = !uniform && rx[2] * ry[2] * rz[2] >= CHUNK_VOLUME / 4;
+				if (decode)
+					channel->copyTo(values);
+
+				for (u32 z = 0; z < rz[2]; ++z)
+				{
+					for (u32 y = 0; y < ry[2]; ++y)
+					{
+						u8 * dst = out_values + rx[1] + size * ((ry[1] + y) + size * (rz[1] + z));
+						u32 src = Chunk::getIndex(rx[0], ry[0] + y, rz[0] + z);
+						if (uniform)
+						{
+							memset(dst, uniformValue, rx[2]);
+						}
+						else if (decode)
+						{
+							memcpy(dst, values + src, rx[2]);
+						}
+						else
+						{
+							for (u32 x = 0; x < rx[2]; ++x)
+								dst[x] = channel->get(src + x);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+} // namespace voxy
@@ -2,24 +2,148 @@
 #define __HEADER_VOXY_TERRAIN__
 
 #include "VoxelArray.h"
+#include "Chunk.h"
 #include <unordered_map>
+#include <vector>
 #include <core/math/Vector3.h>
 
 namespace voxy
 {
 
-typedef VoxelArray<16,16,16> Block;
+typedef VoxelArray<CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE> Block;
 
+/// \brief Memory used by a terrain, see Terrain::getMemoryStats()
+struct TerrainMemoryStats
+{
+	u32 chunkCount;
+	// Chunks also referenced by other terrains or snapshots
+	u32 sharedChunkCount;
+	u32 uniformChunkCount;
+	// Number of channels using each VoxelChannel::Mode
+	u32 channelCounts[VoxelChannel::MODE_COUNT];
+	// Bytes used by chunks. Shared chunks are counted too.
+	u32 byteCount;
+	// Bytes chunks would use if every attribute was a plain array
+	u32 uncompressedByteCount;
+
+	TerrainMemoryStats();
+};
+
+/// \brief Voxel volume of unlimited size, stored by chunks.
+/// Areas where no chunk is stored have the default values.
+/// Copies of a terrain share their chunks until they get modified.
+/// Note: a terrain must be modified by one thread at a time. Use acquireChunk() to read chunks from other threads.
 class Terrain
 {
 public:
-	
+	Terrain();
+	Terrain(const Terrain & other);
+	~Terrain();
+
+	Terrain & operator=(const Terrain & other);
+
+	/// \brief Converts voxel coordinates into the coordinates of the chunk containing them
+	static s32 toChunkCoordinate(s32 x) { return x >= 0 ? x >> CHUNK_SIZE_LOG2 : ~((~x) >> CHUNK_SIZE_LOG2); }
+	static sn::Vector3i toChunkPosition(s32 x, s32 y, s32 z);
+
+	u8 getDefaultValue(Attribute a) const { return m_defaultValues[a]; }
+	const u8 * getDefaultValues() const { return m_defaultValues; }
+
+	/// \brief Sets the value of voxels where no chunk is stored.
+	/// It also applies to chunks created afterwards.
+	void setDefaultValue(Attribute a, u8 value);
+
+	u8 getVoxel(Attribute a, s32 x, s32 y, s32 z) const;
+
+	/// \brief Sets the value of a voxel. Creates or un-shares its chunk if needed.
+	void setVoxel(Attribute a, s32 x, s32 y, s32 z, u8 value);
+
+	/// \brief Gets a chunk for reading.
+	/// \return The chunk, or null if none is stored at this position
+	const Chunk * getChunk(const sn::Vector3i & position) const;
+
+	/// \brief Gets a chunk for modification. It is created if it doesn't exist,
+	/// and copied if it is shared with another terrain or snapshot.
+	Chunk * getChunkForWrite(const sn::Vector3i & position);
+
+	/// \brief Gets a reference to a chunk, which stays valid and unchanged even if the terrain is modified.
+	/// It can be read from other threads, and must be released when done.
+	/// \return The chunk, or null if none is stored at this position
+	const Chunk * acquireChunk(const sn::Vector3i & position) const;
+
+	/// \brief Stores a chunk at its position, replacing the previous one.
+	/// The terrain takes over the reference of the caller.
+	void setChunk(Chunk * chunk);
+
+	void removeChunk(const sn::Vector3i & position);
+	bool hasChunk(const sn::Vector3i & position) const { return m_chunks.find(position) != m_chunks.end(); }
+	u32 getChunkCount() const { return m_chunks.size(); }
+	void getChunkPositions(std::vector<sn::Vector3i> & out_positions) const;
+
+	void clear();
+
+	/// \brief Reduces the memory used by chunks that aren't shared
+	void optimize();
+
+	/// \brief Like optimize(), but also uses run-length encoding where it is smaller.
+	/// Voxels are slower to read and the first write decompresses their channel.
+	void compress();
+
+	/// \brief Removes chunks that are uniform and equal to the default values
+	void removeDefaultChunks();
+
+	void getMemoryStats(TerrainMemoryStats & out_stats) const;
+
+private:
+	std::unordered_map<sn::Vector3i, Chunk*> m_chunks;
+	u8 m_defaultValues[ATTRIB_MAX];
+
+};
+
+/// \brief Gives access to voxels of a chunk and of its 26 neighbors, using coordinates relative to the chunk.
+/// It keeps references to the chunks, so it can be used from another thread while the terrain changes.
+class ChunkNeighborhood
+{
+public:
+	ChunkNeighborhood();
+	~ChunkNeighborhood();
+
+	void load(const Terrain & terrain, const sn::Vector3i & position);
+	void clear();
+
+	const sn::Vector3i & getPosition() const { return m_position; }
+	const Chunk * getCenter() const { return m_chunks[13]; }
+
+	/// \brief Gets the chunk at a relative position, from -1 to 1 on each axis.
+	const Chunk * getChunk(s32 rx, s32 ry, s32 rz) const { return m_chunks[(rx + 1) + 3 * ((ry + 1) + 3 * (rz + 1))]; }
+
+	/// \brief Gets a voxel at coordinates relative to the central chunk, from -CHUNK_SIZE to 2*CHUNK_SIZE-1.
+	u8 get(Attribute a, s32 x, s32 y, s32 z) const
+	{
+		u32 cx = static_cast<u32>(x + CHUNK_SIZE) >> CHUNK_SIZE_LOG2;
+		u32 cy = static_cast<u32>(y + CHUNK_SIZE) >> CHUNK_SIZE_LOG2;
+		u32 cz = static_cast<u32>(z + CHUNK_SIZE) >> CHUNK_SIZE_LOG2;
+		const Chunk * chunk = m_chunks[cx + 3 * (cy + 3 * cz)];
+		if (chunk == nullptr)
+			return m_defaultValues[a];
+		return chunk->get(a, x & CHUNK_MASK, y & CHUNK_MASK, z & CHUNK_MASK);
+	}
+
+	/// \brief Writes the voxels of the central chunk into an array of (CHUNK_SIZE+2*padding)^3 voxels,
+	/// including the voxels of neighbors in the padding.
+	void copyPadded(Attribute a, u32 padding, u8 * out_values) const;
 
 private:
-	std::unordered_map<sn::Vector3i, Block*> m_blocks;
+	ChunkNeighborhood(const ChunkNeighborhood &);
+	ChunkNeighborhood & operator=(const ChunkNeighborhood &);
+
+private:
+	sn::Vector3i m_position;
+	const Chunk * m_chunks[27];
+	u8 m_defaultValues[ATTRIB_MAX];
+
 };
 
 } // namespace voxy
 
 #endif // __HEADER_VOXY_TERRAIN__
-
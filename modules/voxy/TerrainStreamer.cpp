@@ -0,0 +1,586 @@
+#include "TerrainStreamer.h"
+#include <core/scene/Entity3D.h>
+#include <core/system/Thread.h>
+#include <core/system/Lock.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace sn;
+
+namespace voxy
+{
+
+namespace
+{
+	const Vector3i s_faceNeighbors[6] = {
+		Vector3i(-1, 0, 0),
+		Vector3i(1, 0, 0),
+		Vector3i(0, -1, 0),
+		Vector3i(0, 1, 0),
+		Vector3i(0, 0, -1),
+		Vector3i(0, 0, 1)
+	};
+}
+
+//------------------------------------------------------------------------------
+TerrainStreamer::Task::Task():
+	type(TASK_MESH),
+	loadId(0),
+	priority(0),
+	revision(0),
+	taken(false),
+	canceled(false),
+	chunk(nullptr)
+{}
+
+//------------------------------------------------------------------------------
+TerrainStreamer::ChunkState::ChunkState():
+	loadId(0),
+	mesh(nullptr),
+	revision(0),
+	meshedRevision(0),
+	pendingMeshTask(nullptr),
+	uploadTask(nullptr),
+	generateTask(nullptr)
+{}
+
+//------------------------------------------------------------------------------
+TerrainStreamer::TerrainStreamer(Terrain & terrain, u32 threadCount):
+	r_terrain(terrain),
+	m_needRefresh(true),
+	m_nextLoadId(1),
+	m_radius(4),
+	m_unloadMargin(2),
+	m_maxUploadsPerFrame(4),
+	m_maxUploadBytesPerFrame(256 * 1024),
+	m_lastUploadCount(0),
+	m_runningTaskCount(0),
+	m_running(true)
+{
+	// When there are no threads, tasks run in update() with the first builder
+	u32 builderCount = threadCount > 0 ? threadCount : 1;
+	for (u32 i = 0; i < builderCount; ++i)
+		m_builders.push_back(new MeshBuilder());
+
+	for (u32 i = 0; i < threadCount; ++i)
+	{
+		Thread * thread = new Thread([this, i]() {
+			runWorker(i);
+		});
+		m_threads.push_back(thread);
+		thread->start();
+	}
+}
+
+//------------------------------------------------------------------------------
+TerrainStreamer::~TerrainStreamer()
+{
+	m_running = false;
+	for (u32 i = 0; i < m_threads.size(); ++i)
+	{
+		m_threads[i]->wait();
+		delete m_threads[i];
+	}
+	m_threads.clear();
+
+	// Workers are stopped, every task is in one of these lists now
+	std::vector<Task*> tasks;
+	tasks.insert(tasks.end(), m_tasks.begin(), m_tasks.end());
+	tasks.insert(tasks.end(), m_results.begin(), m_results.end());
+	tasks.insert(tasks.end(), m_uploads.begin(), m_uploads.end());
+	tasks.insert(tasks.end(), m_freeTasks.begin(), m_freeTasks.end());
+	for (u32 i = 0; i < tasks.size(); ++i)
+	{
+		if (tasks[i]->chunk)
+			tasks[i]->chunk->release();
+		delete tasks[i];
+	}
+
+	for (auto it = m_chunks.begin(); it != m_chunks.end(); ++it)
+	{
+		if (it->second.mesh)
+			it->second.mesh->release();
+	}
+
+	for (u32 i = 0; i < m_builders.size(); ++i)
+		delete m_builders[i];
+}
+
+//------------------------------------------------------------------------------
+void TerrainStreamer::setViewer(Entity3D * viewer)
+{
+	r_viewer.set(viewer);
+}
+
+//------------------------------------------------------------------------------
+void TerrainStreamer::setColor(u8 index, const Color8 & color)
+{
+	for (u32 i = 0; i < m_builders.size(); ++i)
+		m_builders[i]->setColor(index, color);
+}
+
+//------------------------------------------------------------------------------
+void TerrainStreamer::invalidateChunk(const Vector3i & position)
+{
+	auto it = m_chunks.find(position);
+	if (it == m_chunks.end())
+		return;
+
+	ChunkState & state = it->second;
+	++state.revision;
+
+	// Chunks being generated, or next to chunks being generated, are meshed once generation is done
+	if (state.generateTask == nullptr && isReadyToMesh(position))
+		requestMesh(position, state);
+}
+
+//------------------------------------------------------------------------------
+void TerrainStreamer::invalidateVoxel(s32 x, s32 y, s32 z)
+{
+	Vector3i position = Terrain::toChunkPosition(x, y, z);
+	invalidateChunk(position);
+
+	// Faces of neighbor chunks may appear or disappear
+	const u32 local[3] = { x & CHUNK_MASK, y & CHUNK_MASK, z & CHUNK_MASK };
+	for (u32 d = 0; d < 3; ++d)
+	{
+		if (local[d] == 0)
+			invalidateChunk(position + s_faceNeighbors[d * 2]);
+		else if (local[d] == CHUNK_MASK)
+			invalidateChunk(position + s_faceNeighbors[d * 2 + 1]);
+	}
+}
+
+//------------------------------------------------------------------------------
+void TerrainStreamer::update()
+{
+	if (!r_viewer.isNull())
+		m_viewerPosition = r_viewer.get()->getGlobalPosition();
+
+	Vector3i viewerChunk = Terrain::toChunkPosition(
+		static_cast<s32>(floor(m_viewerPosition.x())),
+		static_cast<s32>(floor(m_viewerPosition.y())),
+		static_cast<s32>(floor(m_viewerPosition.z()))
+	);
+	if (m_needRefresh || viewerChunk != m_viewerChunk)
+	{
+		m_viewerChunk = viewerChunk;
+		m_needRefresh = false;
+		refreshArea();
+	}
+
+	if (m_threads.empty())
+	{
+		for (u32 i = 0; i < m_maxUploadsPerFrame && processNextTask(*m_builders[0]); ++i)
+		{}
+	}
+
+	handleResults();
+	uploadMeshes();
+}
+
+//------------------------------------------------------------------------------
+Mesh * TerrainStreamer::getMesh(const Vector3i & position) const
+{
+	auto it = m_chunks.find(position);
+	return it != m_chunks.end() ? it->second.mesh : nullptr;
+}
+
+//------------------------------------------------------------------------------
+u32 TerrainStreamer::getPendingCount() const
+{
+	Lock lock(const_cast<Mutex&>(m_tasksMutex));
+	return m_tasks.size() + m_runningTaskCount + m_results.size() + m_uploads.size();
+}
+
+//------------------------------------------------------------------------------
+bool TerrainStreamer::isInRange(const Vector3i & position, u32 radius) const
+{
+	Vector3i d = position - m_viewerChunk;
+	s32 r = static_cast<s32>(radius);
+	return d.x() * d.x() + d.y() * d.y() + d.z() * d.z() <= r * r;
+}
+
+//------------------------------------------------------------------------------
+s32 TerrainStreamer::getPriority(const Vector3i & position) const
+{
+	Vector3i d = position - m_viewerChunk;
+	return d.x() * d.x() + d.y() * d.y() + d.z() * d.z();
+}
+
+//------------------------------------------------------------------------------
+void TerrainStreamer::refreshArea()
+{
+	// Stream out chunks that went too far
+	std::vector<Vector3i> farChunks;
+	for (auto it = m_chunks.begin(); it != m_chunks.end(); ++it)
+	{
+		if (!isInRange(it->first, m_radius + m_unloadMargin))
+			farChunks.push_back(it->first);
+	}
+	for (u32 i = 0; i < farChunks.size(); ++i)
+	{
+		auto it = m_chunks.find(farChunks[i]);
+		unloadChunk(it->first, it->second);
+		m_chunks.erase(it);
+	}
+
+	// Stream in chunks that came in range
+	const s32 r = static_cast<s32>(m_radius);
+	for (s32 z = -r; z <= r; ++z)
+	{
+		for (s32 y = -r; y <= r; ++y)
+		{
+			for (s32 x = -r; x <= r; ++x)
+			{
+				Vector3i position = m_viewerChunk + Vector3i(x, y, z);
+				if (isInRange(position, m_radius) && m_chunks.find(position) == m_chunks.end())
+					loadChunk(position);
+			}
+		}
+	}
+
+	reprioritizeTasks();
+}
+
+//------------------------------------------------------------------------------
+void TerrainStreamer::loadChunk(const Vector3i & position)
+{
+	ChunkState & state = m_chunks[position];
+	state.loadId = m_nextLoadId++;
+
+	if (m_generator && !r_terrain.hasChunk(position))
+	{
+		// Chunks are generated into a new chunk, and added to the terrain when done
+		Task * task = createTask(TASK_GENERATE, position, state);
+		task->chunk = new Chunk(position, r_terrain.getDefaultValues());
+		state.generateTask = task;
+
+		Lock lock(m_tasksMutex);
+		m_tasks.push_back(task);
+		std::push_heap(m_tasks.begin(), m_tasks.end(), TaskCompare());
+	}
+	else
+	{
+		// The chunk is already in the terrain, it only needs a mesh
+		invalidateChunk(position);
+	}
+}
+
+//------------------------------------------------------------------------------
+void TerrainStreamer::unloadChunk(const Vector3i & position, ChunkState & state)
+{
+	{
+		// Results of tasks already taken will be ignored because the chunk state will be gone
+		Lock lock(m_tasksMutex);
+		if (state.pendingMeshTask)
+			state.pendingMeshTask->canceled = true;
+		if (state.generateTask)
+			state.generateTask->canceled = true;
+	}
+
+	if (state.uploadTask)
+	{
+		auto it = std::find(m_uploads.begin(), m_uploads.end(), state.uploadTask);
+		m_uploads.erase(it);
+		std::make_heap(m_uploads.begin(), m_uploads.end(), TaskCompare());
+		recycleTask(state.uploadTask);
+	}
+
+	if (state.mesh)
+	{
+		if (m_meshCallback)
+			m_meshCallback(position, nullptr);
+		state.mesh->release();
+		state.mesh = nullptr;
+	}
+
+	// Without a generator, chunks can't be brought back, so they stay in the terrain
+	if (m_generator)
+	{
+		const Chunk * chunk = r_terrain.getChunk(position);
+		if (chunk)
+		{
+			if (m_unloadCallback)
+				m_unloadCallback(*chunk);
+			r_terrain.removeChunk(position);
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+bool TerrainStreamer::isReadyToMesh(const Vector3i & position) const
+{
+	// Meshing before neighbors are generated would show faces on the border, then mesh again
+	for (u32 i = 0; i < 6; ++i)
+	{
+		auto it = m_chunks.find(position + s_faceNeighbors[i]);
+		if (it != m_chunks.end() && it->second.generateTask)
+			return false;
+	}
+	return true;
+}
+
+//------------------------------------------------------------------------------
+void TerrainStreamer::requestMesh(const Vector3i & position, ChunkState & state)
+{
+	Lock lock(m_tasksMutex);
+
+	// A task still in the queue only needs a more recent snapshot
+	Task * task = state.pendingMeshTask;
+	if (task && !task->taken)
+	{
+		task->revision = state.revision;
+		task->neighborhood.load(r_terrain, position);
+		return;
+	}
+
+	task = createTask(TASK_MESH, position, state);
+	task->neighborhood.load(r_terrain, position);
+	state.pendingMeshTask = task;
+	m_tasks.push_back(task);
+	std::push_heap(m_tasks.begin(), m_tasks.end(), TaskCompare());
+}
+
+//------------------------------------------------------------------------------
+TerrainStreamer::Task * TerrainStreamer::createTask(TaskType type, const Vector3i & position, const ChunkState & state)
+{
+	Task * task;
+	if (m_freeTasks.empty())
+	{
+		task = new Task();
+	}
+	else
+	{
+		task = m_freeTasks.back();
+		m_freeTasks.pop_back();
+	}
+
+	task->type = type;
+	task->position = position;
+	task->loadId = state.loadId;
+	task->priority = getPriority(position);
+	task->revision = state.revision;
+	return task;
+}
+
+//------------------------------------------------------------------------------
+void TerrainStreamer::recycleTask(Task * task)
+{
+	if (task->chunk)
+	{
+		task->chunk->release();
+		task->chunk = nullptr;
+	}
+	task->neighborhood.clear();
+	// Vectors keep their capacity for the next use
+	task->meshData.clear();
+	task->taken = false;
+	task->canceled = false;
+	m_freeTasks.push_back(task);
+}
+
+//------------------------------------------------------------------------------
+void TerrainStreamer::reprioritizeTasks()
+{
+	{
+		Lock lock(m_tasksMutex);
+		for (u32 i = 0; i < m_tasks.size(); ++i)
+			m_tasks[i]->priority = getPriority(m_tasks[i]->position);
+		std::make_heap(m_tasks.begin(), m_tasks.end(), TaskCompare());
+	}
+
+	for (u32 i = 0; i < m_uploads.size(); ++i)
+		m_uploads[i]->priority = getPriority(m_uploads[i]->position);
+	std::make_heap(m_uploads.begin(), m_uploads.end(), TaskCompare());
+}
+
+//------------------------------------------------------------------------------
+void TerrainStreamer::runWorker(u32 workerIndex)
+{
+	MeshBuilder & builder = *m_builders[workerIndex];
+	while (m_running)
+	{
+		if (!processNextTask(builder))
+			Thread::sleep(Time::milliseconds(1));
+	}
+}
+
+//------------------------------------------------------------------------------
+bool TerrainStreamer::processNextTask(MeshBuilder & builder)
+{
+	Task * task;
+	{
+		Lock lock(m_tasksMutex);
+		if (m_tasks.empty())
+			return false;
+
+		std::pop_heap(m_tasks.begin(), m_tasks.end(), TaskCompare());
+		task = m_tasks.back();
+		m_tasks.pop_back();
+
+		if (task->canceled)
+		{
+			m_results.push_back(task);
+			return true;
+		}
+
+		task->taken = true;
+		++m_runningTaskCount;
+	}
+
+	runTask(*task, builder);
+
+	Lock lock(m_tasksMutex);
+	m_results.push_back(task);
+	--m_runningTaskCount;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+void TerrainStreamer::runTask(Task & task, MeshBuilder & builder)
+{
+	if (task.type == TASK_GENERATE)
+	{
+		m_generator(*task.chunk);
+		task.chunk->optimize();
+	}
+	else
+	{
+		builder.process(task.neighborhood, task.meshData);
+		// Snapshots are released as soon as possible, so the terrain can modify chunks without copying them
+		task.neighborhood.clear();
+	}
+}
+
+//------------------------------------------------------------------------------
+void TerrainStreamer::handleResults()
+{
+	std::vector<Task*> results;
+	{
+		Lock lock(m_tasksMutex);
+		results.swap(m_results);
+	}
+
+	for (u32 i = 0; i < results.size(); ++i)
+	{
+		Task * task = results[i];
+
+		auto it = m_chunks.find(task->position);
+		if (task->canceled || it == m_chunks.end() || it->second.loadId != task->loadId)
+		{
+			recycleTask(task);
+			continue;
+		}
+
+		if (task->type == TASK_GENERATE)
+			handleGenerateResult(task, it->second);
+		else
+			handleMeshResult(task, it->second);
+	}
+}
+
+//------------------------------------------------------------------------------
+void TerrainStreamer::handleGenerateResult(Task * task, ChunkState & state)
+{
+	const Vector3i position = task->position;
+
+	r_terrain.setChunk(task->chunk);
+	task->chunk = nullptr;
+	state.generateTask = nullptr;
+	recycleTask(task);
+
+	// The chunk and its neighbors can be meshed with the new voxels
+	invalidateChunk(position);
+	for (u32 i = 0; i < 6; ++i)
+		invalidateChunk(position + s_faceNeighbors[i]);
+}
+
+//------------------------------------------------------------------------------
+void TerrainStreamer::handleMeshResult(Task * task, ChunkState & state)
+{
+	if (state.pendingMeshTask == task)
+		state.pendingMeshTask = nullptr;
+
+	// Workers may finish tasks of the same chunk out of order
+	if (task->revision < state.meshedRevision)
+	{
+		recycleTask(task);
+		return;
+	}
+	state.meshedRevision = task->revision;
+
+	if (state.uploadTask)
+	{
+		// Replace geometry that was not uploaded yet
+		std::swap(state.uploadTask->meshData, task->meshData);
+		state.uploadTask->revision = task->revision;
+		recycleTask(task);
+	}
+	else
+	{
+		state.uploadTask = task;
+		task->priority = getPriority(task->position);
+		m_uploads.push_back(task);
+		std::push_heap(m_uploads.begin(), m_uploads.end(), TaskCompare());
+	}
+}
+
+//------------------------------------------------------------------------------
+void TerrainStreamer::uploadMeshes()
+{
+	u32 count = 0;
+	u32 byteCount = 0;
+
+	while (!m_uploads.empty() && count < m_maxUploadsPerFrame)
+	{
+		Task * task = m_uploads.front();
+		const VoxelMeshData & data = task->meshData;
+
+		// Copying vertices is most of the cost, so the budget is in bytes
+		u32 taskBytes = data.positions.size() + data.normals.size()
+			+ data.colors.size() * sizeof(Color8) + data.indices.size() * sizeof(u32);
+		if (count > 0 && byteCount + taskBytes > m_maxUploadBytesPerFrame)
+			break;
+
+		std::pop_heap(m_uploads.begin(), m_uploads.end(), TaskCompare());
+		m_uploads.pop_back();
+
+		ChunkState & state = m_chunks[task->position];
+		state.uploadTask = nullptr;
+
+		// Most chunks are empty or full, they have no mesh and cost nothing
+		bool changed = false;
+		if (data.isEmpty())
+		{
+			if (state.mesh)
+			{
+				if (m_meshCallback)
+					m_meshCallback(task->position, nullptr);
+				state.mesh->release();
+				state.mesh = nullptr;
+				changed = true;
+			}
+		}
+		else
+		{
+			if (state.mesh == nullptr)
+				state.mesh = new Mesh();
+			MeshBuilder::upload(data, *state.mesh);
+			if (m_meshCallback)
+				m_meshCallback(task->position, state.mesh);
+			changed = true;
+		}
+
+		recycleTask(task);
+		if (changed)
+		{
+			byteCount += taskBytes;
+			++count;
+		}
+	}
+
+	m_lastUploadCount = count;
+}
+
+} // namespace voxy
@@ -0,0 +1,227 @@
+#ifndef __HEADER_VOXY_TERRAINSTREAMER__
+#define __HEADER_VOXY_TERRAINSTREAMER__
+
+#include "MeshBuilder.h"
+#include <core/util/NonCopyable.h>
+#include <core/util/WeakRef.h>
+#include <core/system/Mutex.h>
+#include <core/math/Vector3.h>
+#include <functional>
+#include <unordered_map>
+#include <atomic>
+
+namespace sn
+{
+	class Entity3D;
+	class Thread;
+}
+
+namespace voxy
+{
+
+/// \brief Loads and meshes chunks of a terrain around a viewer, using worker threads.
+/// Chunks are generated and meshed in order of distance to the viewer. Meshes are built
+/// into separate buffers, so the previous mesh of a chunk can still be drawn while the new one is built,
+/// and results are copied into sn::Meshes on the main thread, a limited number per frame.
+/// Note: except callbacks documented otherwise, everything runs on the thread calling update().
+/// The terrain must only be modified from that thread, workers read copy-on-write snapshots of chunks.
+class TerrainStreamer : public sn::NonCopyable
+{
+public:
+	/// \brief Fills a new chunk. Called from worker threads, so it must not access the terrain.
+	typedef std::function<void(Chunk & chunk)> GenerateFunc;
+
+	/// \brief Called before a chunk leaves the terrain because it is too far, so it can be saved.
+	typedef std::function<void(const Chunk & chunk)> UnloadFunc;
+
+	/// \brief Called when the mesh of a chunk changes. The mesh is null if the chunk no longer has one.
+	/// Vertices are relative to the chunk origin, which is position * CHUNK_SIZE.
+	/// Meshes belong to the streamer, they must be retained if they are kept after being replaced.
+	typedef std::function<void(const sn::Vector3i & position, sn::Mesh * mesh)> MeshFunc;
+
+	/// \param threadCount: number of worker threads. If zero, tasks run during update().
+	TerrainStreamer(Terrain & terrain, u32 threadCount = 1);
+	~TerrainStreamer();
+
+	//--------------------------------
+	// Settings
+	//--------------------------------
+
+	/// \brief Sets the entity chunks are streamed around. Its global position is read in update().
+	void setViewer(sn::Entity3D * viewer);
+
+	/// \brief Sets the position chunks are streamed around, when no viewer entity is set.
+	/// Coordinates are in voxels, relative to the terrain.
+	void setViewerPosition(const sn::Vector3f & position) { m_viewerPosition = position; }
+
+	/// \brief Sets the distance in chunks within which chunks are loaded and meshed
+	void setRadius(u32 radius) { m_radius = radius; m_needRefresh = true; }
+	u32 getRadius() const { return m_radius; }
+
+	/// \brief Sets how many chunks farther than the radius a chunk must go before it gets unloaded.
+	/// It avoids reloading chunks when the viewer moves back and forth around a chunk border.
+	void setUnloadMargin(u32 margin) { m_unloadMargin = margin; m_needRefresh = true; }
+
+	/// \brief Limits how many meshes are updated by each call to update(), at least one is always updated.
+	void setMaxUploadsPerFrame(u32 count) { m_maxUploadsPerFrame = count; }
+
+	/// \brief Limits how many bytes of vertices and indices are copied into meshes by each call to update().
+	/// At least one mesh is always updated.
+	void setMaxUploadBytesPerFrame(u32 bytes) { m_maxUploadBytesPerFrame = bytes; }
+
+	/// \brief Sets the function generating chunks that are not in the terrain.
+	/// If set, chunks going out of range are also removed from the terrain.
+	/// Otherwise, chunks are expected to be in the terrain already, and only their meshes are streamed.
+	void setGenerator(GenerateFunc func) { m_generator = func; }
+	void setUnloadCallback(UnloadFunc func) { m_unloadCallback = func; }
+	void setMeshCallback(MeshFunc func) { m_meshCallback = func; }
+
+	/// \brief Sets the color of voxels with the given ATTRIB_COLOR value. Call before the first update().
+	void setColor(u8 index, const sn::Color8 & color);
+
+	//--------------------------------
+	// Methods
+	//--------------------------------
+
+	/// \brief Marks a chunk so it gets meshed again
+	void invalidateChunk(const sn::Vector3i & position);
+
+	/// \brief Call this after modifying a voxel, so its chunk gets meshed again,
+	/// including neighbor chunks if the voxel is on their border.
+	void invalidateVoxel(s32 x, s32 y, s32 z);
+
+	/// \brief Call this once per frame
+	void update();
+
+	/// \brief Gets the current mesh of a chunk, or null
+	sn::Mesh * getMesh(const sn::Vector3i & position) const;
+
+	/// \brief Gets the number of tasks being processed, and meshes waiting to be uploaded
+	u32 getPendingCount() const;
+
+	u32 getLoadedChunkCount() const { return m_chunks.size(); }
+
+	/// \brief Gets how many meshes were updated by the last call to update()
+	u32 getLastUploadCount() const { return m_lastUploadCount; }
+
+private:
+	enum TaskType
+	{
+		TASK_GENERATE = 0,
+		TASK_MESH
+	};
+
+	struct Task
+	{
+		TaskType type;
+		sn::Vector3i position;
+		// Identifies which loading of the chunk the task was made for
+		u32 loadId;
+		// Squared distance to the viewer in chunks, closest tasks go first
+		s32 priority;
+		// Revision of the chunk when the neighborhood was loaded
+		u32 revision;
+		// Set by the worker taking the task
+		bool taken;
+		// Set if the result is no longer needed
+		bool canceled;
+
+		// Snapshot of the chunks to mesh
+		ChunkNeighborhood neighborhood;
+		// Geometry built by a worker, waiting to be copied into the mesh
+		VoxelMeshData meshData;
+		// Chunk to generate, not in the terrain yet
+		Chunk * chunk;
+
+		Task();
+	};
+
+	struct ChunkState
+	{
+		u32 loadId;
+		// Current mesh of the chunk, drawn while the next one is built
+		sn::Mesh * mesh;
+		// Increases each time the chunk is invalidated
+		u32 revision;
+		// Revision of the most recent geometry built
+		u32 meshedRevision;
+		// Meshing task not taken by a worker yet
+		Task * pendingMeshTask;
+		// Geometry waiting to be uploaded
+		Task * uploadTask;
+		// Set while the chunk is being generated
+		Task * generateTask;
+
+		ChunkState();
+	};
+
+	struct TaskCompare
+	{
+		bool operator()(const Task * a, const Task * b) const { return a->priority > b->priority; }
+	};
+
+	void refreshArea();
+	void loadChunk(const sn::Vector3i & position);
+	void unloadChunk(const sn::Vector3i & position, ChunkState & state);
+	bool isInRange(const sn::Vector3i & position, u32 radius) const;
+	s32 getPriority(const sn::Vector3i & position) const;
+	bool isReadyToMesh(const sn::Vector3i & position) const;
+	void requestMesh(const sn::Vector3i & position, ChunkState & state);
+	Task * createTask(TaskType type, const sn::Vector3i & position, const ChunkState & state);
+	void recycleTask(Task * task);
+	void reprioritizeTasks();
+
+	void runWorker(u32 workerIndex);
+	bool processNextTask(MeshBuilder & builder);
+	void runTask(Task & task, MeshBuilder & builder);
+
+	void handleResults();
+	void handleGenerateResult(Task * task, ChunkState & state);
+	void handleMeshResult(Task * task, ChunkState & state);
+	void uploadMeshes();
+
+private:
+	Terrain & r_terrain;
+
+	sn::WeakRef<sn::Entity3D> r_viewer;
+	sn::Vector3f m_viewerPosition;
+	sn::Vector3i m_viewerChunk;
+	bool m_needRefresh;
+	u32 m_nextLoadId;
+
+	u32 m_radius;
+	u32 m_unloadMargin;
+	u32 m_maxUploadsPerFrame;
+	u32 m_maxUploadBytesPerFrame;
+	u32 m_lastUploadCount;
+
+	GenerateFunc m_generator;
+	UnloadFunc m_unloadCallback;
+	MeshFunc m_meshCallback;
+
+	// Chunks within range. Only accessed by the main thread.
+	std::unordered_map<sn::Vector3i, ChunkState> m_chunks;
+
+	// Tasks ordered by priority, as a heap
+	std::vector<Task*> m_tasks;
+	// Tasks done by workers
+	std::vector<Task*> m_results;
+	// Protects m_tasks, m_results and flags of tasks
+	sn::Mutex m_tasksMutex;
+	// Number of tasks taken by workers and not finished yet
+	std::atomic<u32> m_runningTaskCount;
+
+	// Mesh results waiting to be copied into meshes, as a heap ordered by priority.
+	// Only accessed by the main thread.
+	std::vector<Task*> m_uploads;
+	std::vector<Task*> m_freeTasks;
+
+	std::vector<sn::Thread*> m_threads;
+	std::vector<MeshBuilder*> m_builders;
+	std::atomic<bool> m_running;
+
+};
+
+} // namespace voxy
+
+#endif // __HEADER_VOXY_TERRAINSTREAMER__
@@ -7,7 +7,9 @@ namespace voxy
 {
 
 typedef sn::u8 u8;
+typedef sn::u16 u16;
 typedef sn::u32 u32;
+typedef sn::s32 s32;
 
 enum Attribute
 {
@@ -19,6 +21,12 @@ enum Attribute
 	ATTRIB_MAX // Keep last
 };
 
+// Terrain is stored by cubic chunks of CHUNK_SIZE voxels
+const u32 CHUNK_SIZE_LOG2 = 4;
+const u32 CHUNK_SIZE = 1 << CHUNK_SIZE_LOG2;
+const u32 CHUNK_MASK = CHUNK_SIZE - 1;
+const u32 CHUNK_VOLUME = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
+
 } // namespace voxy
 
 #endif // __HEADER_VOXY_VOXEL__
@@ -2,6 +2,7 @@
 #define __HEADER_VOXY_VOXELARRAY__
 
 #include "Voxel.h"
+#include <cstring>
 
 namespace voxy
 {
@@ -27,9 +28,14 @@ public:
 		for (u32 i = 0; i < ATTRIB_MAX; ++i)
 		{
 			if (other.m_arrays[i])
+			{
+				m_arrays[i] = new u8[VOLUME];
 				memcpy(m_arrays[i], other.m_arrays[i], sizeof(u8)*VOLUME);
+			}
 			else
+			{
 				m_arrays[i] = nullptr;
+			}
 		}
 		memcpy(m_defaultValues, other.m_defaultValues, sizeof(u8)*ATTRIB_MAX);
 	}
@@ -57,12 +63,13 @@ public:
 
 	bool hasAttribute(Attribute a) const { return m_arrays[a] != nullptr; }
 	void setAttributeDefaultValue(Attribute a, u8 val) { m_defaultValues[a] = val; };
+	u8 getAttributeDefaultValue(Attribute a) const { return m_defaultValues[a]; }
 	
 	void setAttribute(Attribute a, sn::u8 fillValue)
 	{
 		if(!m_arrays[a])
-			m_arrays[a] = new u8(VOLUME);
-		memset(m_arrays[a], fillValue, v);
+			m_arrays[a] = new u8[VOLUME];
+		memset(m_arrays[a], fillValue, sizeof(u8)*VOLUME);
 	}
 
 	void removeAttribute(Attribute a)
@@ -79,7 +86,10 @@ public:
 		for (u32 i = 0; i < ATTRIB_MAX; ++i)
 		{
 			if (m_arrays[i])
+			{
 				delete[] m_arrays[i];
+				m_arrays[i] = nullptr;
+			}
 		}
 	}
 
@@ -95,7 +105,7 @@ public:
 			}
 			else
 			{
-				removeAttribute(i);
+				removeAttribute(static_cast<Attribute>(i));
 			}
 		}
 
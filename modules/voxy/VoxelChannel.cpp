@@ -0,0 +1,283 @@
+#include "VoxelChannel.h"
+#include <algorithm>
+#include <cstring>
+
+namespace voxy
+{
+
+namespace
+{
+	const u32 MAX_PALETTE_SIZE = 16;
+
+	// Unlike clear() or assign(), this releases the memory
+	template <typename T>
+	void freeVector(std::vector<T> & v)
+	{
+		std::vector<T>().swap(v);
+	}
+
+	// Goes byte by byte rather than index by index.
+	// The number of bits is a template parameter so the inner loop gets unrolled.
+	template <u32 BITS>
+	void decodePalette(const u8 * data, const u8 * palette, u8 * out_values)
+	{
+		const u32 perByte = 8 / BITS;
+		const u8 mask = (1 << BITS) - 1;
+		for (u32 j = 0; j < CHUNK_VOLUME / perByte; ++j)
+		{
+			u8 byte = data[j];
+			for (u32 k = 0; k < perByte; ++k)
+			{
+				*out_values++ = palette[byte & mask];
+				byte >>= BITS;
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+VoxelChannel::VoxelChannel(u8 value):
+	m_mode(MODE_UNIFORM),
+	m_bits(0),
+	m_value(value)
+{
+}
+
+//------------------------------------------------------------------------------
+u8 VoxelChannel::getRLE(u32 i) const
+{
+	// First run ending after i
+	auto it = std::upper_bound(m_runEnds.begin(), m_runEnds.end(), i);
+	return m_data[it - m_runEnds.begin()];
+}
+
+//------------------------------------------------------------------------------
+void VoxelChannel::set(u32 i, u8 v)
+{
+	switch (m_mode)
+	{
+	case MODE_UNIFORM:
+		if (v == m_value)
+			return;
+		m_palette.resize(2);
+		m_palette[0] = m_value;
+		m_palette[1] = v;
+		m_bits = 1;
+		std::vector<u8>(CHUNK_VOLUME / 8, 0).swap(m_data);
+		m_mode = MODE_PALETTE;
+		setPaletteIndex(i, 1);
+		break;
+
+	case MODE_PALETTE:
+	{
+		u32 index = std::find(m_palette.begin(), m_palette.end(), v) - m_palette.begin();
+		if (index == m_palette.size())
+		{
+			if (index == (1u << m_bits))
+			{
+				if (m_bits * 2 > 4)
+				{
+					// Too many different values, store them as they are
+					u8 values[CHUNK_VOLUME];
+					copyTo(values);
+					m_data.assign(values, values + CHUNK_VOLUME);
+					freeVector(m_palette);
+					m_mode = MODE_RAW;
+					m_data[i] = v;
+					return;
+				}
+				repack(m_bits * 2);
+			}
+			m_palette.push_back(v);
+		}
+		setPaletteIndex(i, index);
+		break;
+	}
+
+	case MODE_RAW:
+		m_data[i] = v;
+		break;
+
+	default:
+		if (getRLE(i) == v)
+			return;
+		// Decompress
+		optimize();
+		set(i, v);
+		break;
+	}
+}
+
+//------------------------------------------------------------------------------
+void VoxelChannel::fill(u8 v)
+{
+	m_mode = MODE_UNIFORM;
+	m_value = v;
+	m_bits = 0;
+	freeVector(m_palette);
+	freeVector(m_data);
+	freeVector(m_runEnds);
+}
+
+//------------------------------------------------------------------------------
+void VoxelChannel::copyTo(u8 * out_values) const
+{
+	switch (m_mode)
+	{
+	case MODE_UNIFORM:
+		memset(out_values, m_value, CHUNK_VOLUME);
+		break;
+
+	case MODE_PALETTE:
+		switch (m_bits)
+		{
+		case 1: decodePalette<1>(&m_data[0], &m_palette[0], out_values); break;
+		case 2: decodePalette<2>(&m_data[0], &m_palette[0], out_values); break;
+		default: decodePalette<4>(&m_data[0], &m_palette[0], out_values); break;
+		}
+		break;
+
+	case MODE_RAW:
+		memcpy(out_values, &m_data[0], CHUNK_VOLUME);
+		break;
+
+	default:
+	{
+		u32 begin = 0;
+		for (u32 r = 0; r < m_runEnds.size(); ++r)
+		{
+			memset(out_values + begin, m_data[r], m_runEnds[r] - begin);
+			begin = m_runEnds[r];
+		}
+		break;
+	}
+	}
+}
+
+//------------------------------------------------------------------------------
+void VoxelChannel::copyFrom(const u8 * values)
+{
+	bool used[256] = { false };
+	u8 distinct[MAX_PALETTE_SIZE];
+	u32 distinctCount = 0;
+	for (u32 i = 0; i < CHUNK_VOLUME && distinctCount <= MAX_PALETTE_SIZE; ++i)
+	{
+		u8 v = values[i];
+		if (!used[v])
+		{
+			used[v] = true;
+			if (distinctCount < MAX_PALETTE_SIZE)
+				distinct[distinctCount] = v;
+			++distinctCount;
+		}
+	}
+
+	freeVector(m_runEnds);
+
+	if (distinctCount == 1)
+	{
+		fill(values[0]);
+	}
+	else if (distinctCount <= MAX_PALETTE_SIZE)
+	{
+		m_mode = MODE_PALETTE;
+		m_bits = distinctCount <= 2 ? 1 : distinctCount <= 4 ? 2 : 4;
+		m_palette.assign(distinct, distinct + distinctCount);
+
+		u8 indexes[256];
+		for (u32 k = 0; k < distinctCount; ++k)
+			indexes[distinct[k]] = k;
+
+		std::vector<u8>(CHUNK_VOLUME * m_bits / 8, 0).swap(m_data);
+		for (u32 i = 0; i < CHUNK_VOLUME; ++i)
+		{
+			u32 bit = i * m_bits;
+			m_data[bit >> 3] |= indexes[values[i]] << (bit & 7);
+		}
+	}
+	else
+	{
+		m_mode = MODE_RAW;
+		m_bits = 0;
+		freeVector(m_palette);
+		std::vector<u8>(values, values + CHUNK_VOLUME).swap(m_data);
+	}
+}
+
+//------------------------------------------------------------------------------
+void VoxelChannel::optimize()
+{
+	if (m_mode == MODE_UNIFORM)
+		return;
+	u8 values[CHUNK_VOLUME];
+	copyTo(values);
+	copyFrom(values);
+}
+
+//------------------------------------------------------------------------------
+void VoxelChannel::compress()
+{
+	if (m_mode == MODE_UNIFORM || m_mode == MODE_RLE)
+		return;
+
+	u8 values[CHUNK_VOLUME];
+	copyTo(values);
+	copyFrom(values);
+	if (m_mode == MODE_UNIFORM)
+		return;
+
+	u32 runCount = 1;
+	for (u32 i = 1; i < CHUNK_VOLUME; ++i)
+	{
+		if (values[i] != values[i - 1])
+			++runCount;
+	}
+
+	// Each run takes an end index and a value
+	u32 rleSize = runCount * (sizeof(u16) + sizeof(u8));
+	if (rleSize >= m_data.size() + m_palette.size())
+		return;
+
+	std::vector<u8> runValues;
+	std::vector<u16> runEnds;
+	runValues.reserve(runCount);
+	runEnds.reserve(runCount);
+	for (u32 i = 1; i <= CHUNK_VOLUME; ++i)
+	{
+		if (i == CHUNK_VOLUME || values[i] != values[i - 1])
+		{
+			runValues.push_back(values[i - 1]);
+			runEnds.push_back(i);
+		}
+	}
+
+	m_mode = MODE_RLE;
+	m_bits = 0;
+	freeVector(m_palette);
+	m_data.swap(runValues);
+	m_runEnds.swap(runEnds);
+}
+
+//------------------------------------------------------------------------------
+void VoxelChannel::repack(u8 bits)
+{
+	std::vector<u8> data(CHUNK_VOLUME * bits / 8, 0);
+	for (u32 i = 0; i < CHUNK_VOLUME; ++i)
+	{
+		u32 bit = i * bits;
+		data[bit >> 3] |= getPaletteIndex(i) << (bit & 7);
+	}
+	m_data.swap(data);
+	m_bits = bits;
+}
+
+//------------------------------------------------------------------------------
+u32 VoxelChannel::getMemoryUsage() const
+{
+	return sizeof(VoxelChannel)
+		+ m_palette.capacity()
+		+ m_data.capacity()
+		+ m_runEnds.capacity() * sizeof(u16);
+}
+
+} // namespace voxy
@@ -0,0 +1,103 @@
+#ifndef __HEADER_VOXY_VOXELCHANNEL__
+#define __HEADER_VOXY_VOXELCHANNEL__
+
+#include "Voxel.h"
+#include <vector>
+
+namespace voxy
+{
+
+/// \brief Values of one attribute over the CHUNK_VOLUME voxels of a chunk, stored in a compact form.
+/// Voxels are indexed by x + (y + z * CHUNK_SIZE) * CHUNK_SIZE.
+class VoxelChannel
+{
+public:
+	enum Mode
+	{
+		// All voxels have the same value, nothing is allocated
+		MODE_UNIFORM = 0,
+		// Voxels store 1, 2 or 4-bit indexes into a palette of at most 16 values
+		MODE_PALETTE,
+		// One byte per voxel
+		MODE_RAW,
+		// Runs of equal values. Reads are slower, writes decompress the channel first.
+		MODE_RLE,
+
+		MODE_COUNT // Keep last
+	};
+
+	VoxelChannel(u8 value = 0);
+
+	Mode getMode() const { return static_cast<Mode>(m_mode); }
+	bool isUniform() const { return m_mode == MODE_UNIFORM; }
+	u8 getUniformValue() const { return m_value; }
+
+	u8 get(u32 i) const
+	{
+		switch (m_mode)
+		{
+		case MODE_UNIFORM: return m_value;
+		case MODE_PALETTE: return m_palette[getPaletteIndex(i)];
+		case MODE_RAW: return m_data[i];
+		default: return getRLE(i);
+		}
+	}
+
+	/// \brief Sets the value of a voxel. The channel switches to a larger representation if needed.
+	void set(u32 i, u8 v);
+
+	/// \brief Sets all voxels to the same value, and frees memory.
+	void fill(u8 v);
+
+	/// \brief Writes the values of all voxels into a CHUNK_VOLUME array.
+	void copyTo(u8 * out_values) const;
+
+	/// \brief Sets the values of all voxels from a CHUNK_VOLUME array, using the smallest non-RLE representation.
+	void copyFrom(const u8 * values);
+
+	/// \brief Switches to the smallest representation that can still be modified in place.
+	/// Palette values that are no longer used are removed.
+	void optimize();
+
+	/// \brief Switches to run-length encoding if it is smaller than the optimized representation.
+	/// Use it on chunks that are not going to be modified soon.
+	void compress();
+
+	/// \brief Gets the number of bytes used by the channel, including allocated memory.
+	u32 getMemoryUsage() const;
+
+private:
+	u8 getPaletteIndex(u32 i) const
+	{
+		u32 bit = i * m_bits;
+		return (m_data[bit >> 3] >> (bit & 7)) & ((1 << m_bits) - 1);
+	}
+
+	void setPaletteIndex(u32 i, u8 index)
+	{
+		u32 bit = i * m_bits;
+		u8 & byte = m_data[bit >> 3];
+		u8 mask = ((1 << m_bits) - 1) << (bit & 7);
+		byte = (byte & ~mask) | ((index << (bit & 7)) & mask);
+	}
+
+	u8 getRLE(u32 i) const;
+	void repack(u8 bits);
+
+private:
+	u8 m_mode;
+	// Bits per palette index
+	u8 m_bits;
+	// Value of all voxels in uniform mode
+	u8 m_value;
+	std::vector<u8> m_palette;
+	// Packed palette indexes, raw values, or values of runs
+	std::vector<u8> m_data;
+	// Exclusive end indexes of runs
+	std::vector<u16> m_runEnds;
+
+};
+
+} // namespace voxy
+
+#endif // __HEADER_VOXY_VOXELCHANNEL__
@@ -1,5 +1,8 @@
 project "ModVoxy"
     commonModConfigCPP()
+    moduleDependencies {
+        "ModRender"
+    }
     files {
         "**.h",
         "**.cpp"
@@ -19,9 +19,47 @@ int main(int argc, char * argv[])
 {
     test_guid();
     //test_sml();
+    //test_smlParserPerformance();
     //test_squirrelBinding();
 	//test_variant();
+	//test_variantParseAndDestroy();
     //test_fileWatcher();
+    //test_mpscQueue();
+    //test_noise();
+    //test_noisePerformance();
+    //test_random();
+    //test_packedEntity();
+    //test_probabilityField();
+    //test_probabilityFieldPerformance();
+    //test_pathFinder();
+    //test_pathFinderPerformance();
+    //test_pathQueryService();
+    //test_arrayLayouts();
+    //test_arrayLayoutsPerformance();
+    //test_autoTiler();
+    //test_autoTilerPerformance();
+    //test_voxyTerrain();
+    //test_voxyMeshBuilder();
+    //test_voxyMeshBuilderPerformance();
+    //test_voxyTerrainStreamer();
+    //test_distanceField();
+    //test_distanceFieldPerformance();
+    //test_rectPackers();
+    //test_rectPackersPerformance();
+    //test_tguiDrawList();
+    //test_tguiDrawListPerformance();
+    //test_tguiLayout();
+    //test_tguiLayoutPerformance();
+    //test_tguiHitIndex();
+    //test_tguiHitIndexPerformance();
+    //test_tguiText();
+    //test_tguiTextPerformance();
+    //test_imageKernels();
+    //test_imageKernelsPerformance();
+    //test_blockCompression();
+    //test_blockCompressionPerformance();
+    //test_imageDecode();
+    //test_imageDecodePerformance();
     //test_stringSplit();
     //test_reflection();
     //testNTree();
@@ -5,16 +5,39 @@ project "Tests"
 		"../squirrel"
 	}
 	dependson {
-		"SnowfeetCore"
+		"SnowfeetCore",
+		"ModRender",
+		"ModFreetype"
 	}
 	location "."
 	files {
 		"**.h",
 		"**.hpp",
-		"**.cpp"
+		"**.cpp",
+		-- Voxel storage and meshing are tested without loading the module
+		"../modules/voxy/VoxelChannel.cpp",
+		"../modules/voxy/Chunk.cpp",
+		"../modules/voxy/Terrain.cpp",
+		"../modules/voxy/MeshBuilder.cpp",
+		"../modules/voxy/TerrainStreamer.cpp",
+		-- Distance fields are computed without FreeType
+		"../modules/freetype/DistanceField.cpp",
+		-- Image kernels work on raw pixels, without the image module
+		"../modules/image/ImageKernels.cpp",
+		"../modules/image/BlockCompression.cpp",
+		"../modules/image/ImageDecoder.cpp",
+		-- GUI controls are created and laid out without loading the module
+		"../modules/tgui/**.cpp"
+	}
+	excludes {
+		"../modules/tgui/mod_TGUI.cpp",
+		"../modules/tgui/RenderStep.cpp",
+		"../modules/tgui/bind/**"
 	}
 	links {
-		"SnowfeetCore"
+		"SnowfeetCore",
+		"ModRender",
+		"ModFreetype"
 	}
 	filter "configurations:Debug"
 		targetdir "../_bin/debug"
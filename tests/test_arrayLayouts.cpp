@@ -0,0 +1,281 @@
+#include "tests.hpp"
+
+#include <core/util/Array2D.h>
+#include <core/util/Array3D.h>
+#include <core/math/Random.h>
+#include <core/system/Clock.h>
+#include <core/util/Log.h>
+
+using namespace sn;
+
+namespace
+{
+    template <typename Layout_T>
+    u32 checkLayout2D(u32 sizeX, u32 sizeY)
+    {
+        u32 errors = 0;
+
+        Array2D<u32, Layout_T> a(sizeX, sizeY, 0xffffffff);
+        for (u32 y = 0; y < sizeY; ++y)
+        {
+            for (u32 x = 0; x < sizeX; ++x)
+            {
+                // Locations must be unique
+                if (a.getLocation(x, y) >= a.capacity() || a[a.getLocation(x, y)] != 0xffffffff)
+                    ++errors;
+                a.setNoEx(x, y, y * sizeX + x);
+            }
+        }
+
+        Array2D<u32, Layout_T> b = a;
+
+        u32 visited = 0;
+        b.forEach([&](u32 x, u32 y, u32 & value) {
+            if (value != y * sizeX + x || b.getNoEx(x, y) != value)
+                ++errors;
+            value = 0xffffffff;
+            ++visited;
+        });
+
+        if (visited != sizeX * sizeY)
+            ++errors;
+        return errors;
+    }
+
+    template <typename Layout_T>
+    u32 checkLayout3D(u32 sizeX, u32 sizeY, u32 sizeZ)
+    {
+        u32 errors = 0;
+
+        Array3D<u32, Layout_T> a(sizeX, sizeY, sizeZ, 0xffffffff);
+        for (u32 z = 0; z < sizeZ; ++z)
+        {
+            for (u32 y = 0; y < sizeY; ++y)
+            {
+                for (u32 x = 0; x < sizeX; ++x)
+                {
+                    if (a.getLocation(x, y, z) >= a.capacity() || a[a.getLocation(x, y, z)] != 0xffffffff)
+                        ++errors;
+                    a.setNoEx(x, y, z, (z * sizeY + y) * sizeX + x);
+                }
+            }
+        }
+
+        Array3D<u32, Layout_T> b = a;
+
+        u32 visited = 0;
+        b.forEach([&](u32 x, u32 y, u32 z, u32 & value) {
+            if (value != (z * sizeY + y) * sizeX + x || b.getNoEx(x, y, z) != value)
+                ++errors;
+            value = 0xffffffff;
+            ++visited;
+        });
+
+        if (visited != sizeX * sizeY * sizeZ)
+            ++errors;
+        return errors;
+    }
+
+    // Computes a 8-neighbor mask for each cell, like AutoTiler does
+    template <typename Layout_T>
+    u32 scanNeighbors2D(const Array2D<u8, Layout_T> & grid, Array2D<u8, Layout_T> & masks, bool useForEach)
+    {
+        const s32 offsets[8][2] = { {-1,-1}, {0,-1}, {1,-1}, {-1,0}, {1,0}, {-1,1}, {0,1}, {1,1} };
+        const s32 maxX = grid.sizeX() - 1;
+        const s32 maxY = grid.sizeY() - 1;
+
+        auto processCell = [&](u32 x, u32 y) {
+            u8 mask = 0;
+            if (x > 0 && y > 0 && x < (u32)maxX && y < (u32)maxY)
+            {
+                for (u32 i = 0; i < 8; ++i)
+                    mask |= (grid.getNoEx(x + offsets[i][0], y + offsets[i][1]) != 0) << i;
+            }
+            return mask;
+        };
+
+        if (useForEach)
+        {
+            masks.forEach([&](u32 x, u32 y, u8 & mask) {
+                mask = processCell(x, y);
+            });
+        }
+        else
+        {
+            for (u32 y = 0; y < grid.sizeY(); ++y)
+            {
+                for (u32 x = 0; x < grid.sizeX(); ++x)
+                    masks.setNoEx(x, y, processCell(x, y));
+            }
+        }
+
+        u32 checksum = 0;
+        masks.forEach([&checksum](u32 x, u32 y, u8 mask) {
+            checksum += mask * (x ^ y);
+        });
+        return checksum;
+    }
+
+    // Counts the faces between solid and empty voxels, like a mesher would
+    template <typename Layout_T>
+    u32 scanNeighbors3D(const Array3D<u8, Layout_T> & voxels, bool useForEach)
+    {
+        const s32 offsets[6][3] = { {-1,0,0}, {1,0,0}, {0,-1,0}, {0,1,0}, {0,0,-1}, {0,0,1} };
+        const u32 maxX = voxels.sizeX() - 1;
+        const u32 maxY = voxels.sizeY() - 1;
+        const u32 maxZ = voxels.sizeZ() - 1;
+
+        u32 faces = 0;
+        auto processCell = [&](u32 x, u32 y, u32 z, u8 v) {
+            if (v == 0 || x == 0 || y == 0 || z == 0 || x == maxX || y == maxY || z == maxZ)
+                return;
+            for (u32 i = 0; i < 6; ++i)
+                faces += voxels.getNoEx(x + offsets[i][0], y + offsets[i][1], z + offsets[i][2]) == 0;
+        };
+
+        if (useForEach)
+        {
+            voxels.forEach([&](u32 x, u32 y, u32 z, u8 v) {
+                processCell(x, y, z, v);
+            });
+        }
+        else
+        {
+            for (u32 z = 0; z < voxels.sizeZ(); ++z)
+            {
+                for (u32 y = 0; y < voxels.sizeY(); ++y)
+                {
+                    for (u32 x = 0; x < voxels.sizeX(); ++x)
+                        processCell(x, y, z, voxels.getNoEx(x, y, z));
+                }
+            }
+        }
+
+        return faces;
+    }
+
+    // Sums small square areas at random places, like local updates of a map would do
+    template <typename Layout_T>
+    u32 scanWindows2D(const Array2D<u8, Layout_T> & grid, u32 windowSize, u32 count)
+    {
+        Random rng(7);
+        u32 sum = 0;
+        for (u32 i = 0; i < count; ++i)
+        {
+            u32 minX = rng.nextBounded(grid.sizeX() - windowSize);
+            u32 minY = rng.nextBounded(grid.sizeY() - windowSize);
+            for (u32 y = minY; y < minY + windowSize; ++y)
+            {
+                for (u32 x = minX; x < minX + windowSize; ++x)
+                    sum += grid.getNoEx(x, y);
+            }
+        }
+        return sum;
+    }
+
+    template <typename Layout_T>
+    u32 scanWindows3D(const Array3D<u8, Layout_T> & voxels, u32 windowSize, u32 count)
+    {
+        Random rng(7);
+        u32 sum = 0;
+        for (u32 i = 0; i < count; ++i)
+        {
+            u32 minX = rng.nextBounded(voxels.sizeX() - windowSize);
+            u32 minY = rng.nextBounded(voxels.sizeY() - windowSize);
+            u32 minZ = rng.nextBounded(voxels.sizeZ() - windowSize);
+            for (u32 z = minZ; z < minZ + windowSize; ++z)
+            {
+                for (u32 y = minY; y < minY + windowSize; ++y)
+                {
+                    for (u32 x = minX; x < minX + windowSize; ++x)
+                        sum += voxels.getNoEx(x, y, z);
+                }
+            }
+        }
+        return sum;
+    }
+
+    template <typename Layout_T>
+    void benchmark2D(const char * name, u32 size)
+    {
+        Array2D<u8, Layout_T> grid(size, size);
+        Array2D<u8, Layout_T> masks(size, size, 0);
+        // Content depends on coordinates only, so it is the same whatever the layout
+        grid.forEach([](u32 x, u32 y, u8 & v) {
+            v = (Random::hash(3, x, y) % 10) < 3 ? 1 : 0;
+        });
+
+        for (u32 useForEach = 0; useForEach < 2; ++useForEach)
+        {
+            Clock clock;
+            u32 checksum = scanNeighbors2D(grid, masks, useForEach != 0);
+            Time time = clock.getElapsedTime();
+            SN_LOG("Array2D " << size << "x" << size << " " << name << (useForEach ? ", forEach: " : ", nested loops: ")
+                << time.asMilliseconds() << "ms (checksum " << checksum << ", " << grid.byteCount() << " bytes)");
+        }
+
+        Clock clock;
+        u32 sum = scanWindows2D(grid, 16, 200000);
+        Time time = clock.getElapsedTime();
+        SN_LOG("Array2D " << size << "x" << size << " " << name << ", random 16x16 windows: "
+            << time.asMilliseconds() << "ms (sum " << sum << ")");
+    }
+
+    template <typename Layout_T>
+    void benchmark3D(const char * name, u32 size)
+    {
+        Array3D<u8, Layout_T> voxels(size, size, size);
+        voxels.forEach([](u32 x, u32 y, u32 z, u8 & v) {
+            v = (Random::hash(z, x, y) % 10) < 4 ? 1 : 0;
+        });
+
+        for (u32 useForEach = 0; useForEach < 2; ++useForEach)
+        {
+            Clock clock;
+            u32 faces = scanNeighbors3D(voxels, useForEach != 0);
+            Time time = clock.getElapsedTime();
+            SN_LOG("Array3D " << size << "^3 " << name << (useForEach ? ", forEach: " : ", nested loops: ")
+                << time.asMilliseconds() << "ms (" << faces << " faces, " << voxels.byteCount() << " bytes)");
+        }
+
+        Clock clock;
+        u32 sum = scanWindows3D(voxels, 8, 100000);
+        Time time = clock.getElapsedTime();
+        SN_LOG("Array3D " << size << "^3 " << name << ", random 8^3 windows: "
+            << time.asMilliseconds() << "ms (sum " << sum << ")");
+    }
+}
+
+void test_arrayLayouts()
+{
+    u32 errors = 0;
+
+    // Sizes that are not multiples of blocks nor powers of two
+    errors += checkLayout2D<RowMajorLayout2D>(37, 21);
+    errors += checkLayout2D<TiledLayout2D<3> >(37, 21);
+    errors += checkLayout2D<TiledLayout2D<2> >(1, 70);
+    errors += checkLayout2D<MortonLayout2D>(37, 21);
+    errors += checkLayout2D<MortonLayout2D>(130, 3);
+
+    errors += checkLayout3D<RowMajorLayout3D>(13, 7, 9);
+    errors += checkLayout3D<TiledLayout3D<3> >(13, 7, 9);
+    errors += checkLayout3D<TiledLayout3D<2> >(16, 1, 33);
+    errors += checkLayout3D<MortonLayout3D>(13, 7, 9);
+    errors += checkLayout3D<MortonLayout3D>(2, 40, 5);
+
+    SN_LOG("Array layouts: " << errors << " errors");
+}
+
+void test_arrayLayoutsPerformance()
+{
+    benchmark2D<RowMajorLayout2D>("row-major", 4096);
+    benchmark2D<TiledLayout2D<3> >("tiled 8x8", 4096);
+    benchmark2D<TiledLayout2D<5> >("tiled 32x32", 4096);
+    benchmark2D<MortonLayout2D>("Morton", 4096);
+
+    benchmark3D<RowMajorLayout3D>("row-major", 256);
+    benchmark3D<TiledLayout3D<3> >("tiled 8^3", 256);
+    benchmark3D<TiledLayout3D<4> >("tiled 16^3", 256);
+    benchmark3D<MortonLayout3D>("Morton", 256);
+}
+
@@ -0,0 +1,273 @@
+#include "tests.hpp"
+
+#include <core/pcg/AutoTiler.h>
+#include <core/math/Random.h>
+#include <core/system/Clock.h>
+#include <core/util/Log.h>
+#include <core/util/Variant.h>
+
+using namespace sn;
+
+namespace
+{
+    const s32 g_neighbors[8][2] = { {-1,-1}, {0,-1}, {1,-1}, {-1,0}, {1,0}, {-1,1}, {0,1}, {1,1} };
+
+    // Straightforward version using the rule sets as they are defined
+    AutoTiler::Out_T referenceTile(const AutoTiler & tiler, const Array2D<AutoTiler::In_T> & grid, s32 x, s32 y)
+    {
+        AutoTiler::In_T type = grid.getNoEx(x, y);
+        if (type >= tiler.ruleSets.size())
+            return tiler.defaultOutput;
+
+        const AutoTiler::RuleSet & rules = tiler.ruleSets[type];
+        AutoTiler::ConnectionMask m = 0;
+        for (u32 i = 0; i < 8; ++i)
+        {
+            s32 nx = x + g_neighbors[i][0];
+            s32 ny = y + g_neighbors[i][1];
+            AutoTiler::In_T ntype = grid.contains(nx, ny) ? grid.getNoEx(nx, ny) : tiler.defaultInput;
+            if (rules.connections.count(ntype))
+                m |= 1 << (7 - i);
+        }
+
+        auto it = rules.cases.find(m);
+        if (it == rules.cases.end())
+            return rules.defaultOutput[0];
+        if (it->second.empty())
+            return tiler.defaultOutput;
+        return it->second[Random::hash(tiler.variantSeed, x, y) % it->second.size()];
+    }
+
+    void makeTiler(AutoTiler & tiler)
+    {
+        tiler.defaultInput = 1;
+        tiler.defaultOutput = 999;
+        tiler.variantSeed = 42;
+
+        // 0: no rules
+        AutoTiler::RuleSet empty(10);
+        tiler.addRuleSet(0, empty);
+
+        // 1 and 2: walls connecting to each other, with variants
+        AutoTiler::RuleSet walls(20);
+        walls.connections.insert(1);
+        walls.connections.insert(2);
+        Random rng(1);
+        for (u32 i = 0; i < 40; ++i)
+        {
+            std::vector<AutoTiler::Out_T> variants;
+            u32 variantCount = rng.range(0, 4);
+            for (u32 j = 0; j < variantCount; ++j)
+                variants.push_back(100 + i * 4 + j);
+            // Only cardinals matter in some cases
+            u8 careMask = (i % 3 == 0) ? 0x5a : 0xff;
+            walls.addCase(static_cast<AutoTiler::ConnectionMask>(rng.next()), careMask, variants);
+        }
+        tiler.addRuleSet(1, walls);
+        walls.connections.insert(3);
+        tiler.addRuleSet(2, walls);
+
+        // 3: water connecting to itself, everything is "don't care" but the cardinals
+        AutoTiler::RuleSet water(30);
+        water.connections.insert(3);
+        for (u32 i = 0; i < 16; ++i)
+        {
+            std::vector<AutoTiler::Out_T> variants(1, 300 + i);
+            u8 n = ((i & 1) << 6) | ((i & 2) << 3) | ((i & 4) << 1) | ((i & 8) >> 2);
+            water.addCase(n, 0x5a, variants);
+        }
+        tiler.addRuleSet(3, water);
+
+        // 4 and above are not referenced
+    }
+
+    void makeGrid(Array2D<AutoTiler::In_T> & grid, u32 sizeX, u32 sizeY)
+    {
+        // Blobs of types, so rows have runs of the same type like real maps
+        grid.create(sizeX, sizeY);
+        for (u32 y = 0; y < sizeY; ++y)
+        {
+            for (u32 x = 0; x < sizeX; ++x)
+            {
+                u32 h = Random::hash(7, x / 5, y / 4);
+                grid.setNoEx(x, y, (Random::hash(9, x, y) % 16 == 0) ? h % 6 : (h >> 8) % 5);
+            }
+        }
+    }
+
+    // Rule sets listed out of order, with explicit inputs beyond the array size
+    void makeTilerData(Variant & o)
+    {
+        o.setDictionary();
+        o["defaultInput"] = 0;
+        o["defaultOutput"] = 999;
+
+        Variant & ruleSets = o["ruleSets"];
+        ruleSets.setArray();
+
+        Variant & water = ruleSets[0];
+        water.setDictionary();
+        water["input"] = 5;
+        water["defaultOutput"].setArray();
+        water["defaultOutput"][0] = 50;
+        water["connections"].setArray();
+        water["connections"][0] = 5;
+        water["cases"].setArray();
+        water["cases"][0].setDictionary();
+        water["cases"][0]["n"] = "*1*00*0*";
+        water["cases"][0]["v"].setArray();
+        water["cases"][0]["v"][0] = 51;
+
+        Variant & walls = ruleSets[1];
+        walls.setDictionary();
+        walls["input"] = 2;
+        walls["defaultOutput"].setArray();
+        walls["defaultOutput"][0] = 20;
+    }
+
+    u32 countDifferences(const AutoTiler & tiler, const Array2D<AutoTiler::In_T> & grid, const Array2D<AutoTiler::Out_T> & tiles)
+    {
+        u32 differences = 0;
+        for (u32 y = 0; y < grid.sizeY(); ++y)
+        {
+            for (u32 x = 0; x < grid.sizeX(); ++x)
+            {
+                if (tiles.getNoEx(x, y) != referenceTile(tiler, grid, x, y))
+                    ++differences;
+            }
+        }
+        return differences;
+    }
+}
+
+void test_autoTiler()
+{
+    AutoTiler tiler;
+    makeTiler(tiler);
+
+    Array2D<AutoTiler::In_T> grid;
+    makeGrid(grid, 67, 41);
+
+    Array2D<AutoTiler::Out_T> tiles;
+    tiler.process(grid, tiles);
+    u32 differences = countDifferences(tiler, grid, tiles);
+
+    u32 tileDifferences = 0;
+    for (u32 y = 0; y < grid.sizeY(); ++y)
+    {
+        for (u32 x = 0; x < grid.sizeX(); ++x)
+        {
+            if (tiler.processTile(grid, x, y) != tiles.getNoEx(x, y))
+                ++tileDifferences;
+        }
+    }
+
+    Array2D<AutoTiler::Out_T> threadedTiles;
+    tiler.process(grid, threadedTiles, 4);
+    u32 threadedDifferences = countDifferences(tiler, grid, threadedTiles);
+
+    // Edits followed by incremental updates
+    Random rng(3);
+    for (u32 i = 0; i < 30; ++i)
+    {
+        s32 minX = rng.range(-2, grid.sizeX());
+        s32 minY = rng.range(-2, grid.sizeY());
+        s32 maxX = minX + rng.range(0, 6);
+        s32 maxY = minY + rng.range(0, 6);
+        AutoTiler::In_T type = rng.range(0, 6);
+        for (s32 y = minY; y <= maxY; ++y)
+        {
+            for (s32 x = minX; x <= maxX; ++x)
+            {
+                if (grid.contains(x, y))
+                    grid.setNoEx(x, y, type);
+            }
+        }
+        tiler.processArea(grid, tiles, minX, minY, maxX, maxY);
+    }
+    u32 incrementalDifferences = countDifferences(tiler, grid, tiles);
+
+    // Unserialized rule sets end up at their explicit inputs, and nothing is read past the array
+    Variant data;
+    makeTilerData(data);
+    AutoTiler loadedTiler;
+    loadedTiler.unserialize(data);
+    u32 unserializeErrors = 0;
+    if (loadedTiler.ruleSets.size() != 6)
+    {
+        SN_ERROR("Unserialized AutoTiler has " << loadedTiler.ruleSets.size() << " rule sets instead of 6");
+        ++unserializeErrors;
+    }
+    else
+    {
+        const AutoTiler::RuleSet & water = loadedTiler.ruleSets[5];
+        if (water.defaultOutput != std::vector<AutoTiler::Out_T>(1, 50) || water.connections.count(5) == 0 || water.cases.size() != 16)
+        {
+            SN_ERROR("Rule set 5 was not unserialized at its input");
+            ++unserializeErrors;
+        }
+        if (loadedTiler.ruleSets[2].defaultOutput != std::vector<AutoTiler::Out_T>(1, 20))
+        {
+            SN_ERROR("Rule set 2 was not unserialized at its input");
+            ++unserializeErrors;
+        }
+        for (u32 i = 0; i < 5; ++i)
+        {
+            if (i == 2)
+                continue;
+            const AutoTiler::RuleSet & rs = loadedTiler.ruleSets[i];
+            if (rs.defaultOutput != std::vector<AutoTiler::Out_T>(1, 0) || !rs.cases.empty() || !rs.connections.empty())
+            {
+                SN_ERROR("Rule set " << i << " should be empty");
+                ++unserializeErrors;
+            }
+        }
+    }
+
+    SN_LOG("AutoTiler: " << differences << " differences, "
+        << tileDifferences << " with processTile, "
+        << threadedDifferences << " with threads, "
+        << incrementalDifferences << " after incremental updates, "
+        << unserializeErrors << " unserialize errors");
+}
+
+void test_autoTilerPerformance()
+{
+    AutoTiler tiler;
+    makeTiler(tiler);
+
+    const u32 size = 2048;
+    Array2D<AutoTiler::In_T> grid;
+    makeGrid(grid, size, size);
+    Array2D<AutoTiler::Out_T> tiles(size, size);
+
+    Clock clock;
+    u32 checksum = 0;
+    for (u32 y = 0; y < size; ++y)
+    {
+        for (u32 x = 0; x < size; ++x)
+            checksum += referenceTile(tiler, grid, x, y);
+    }
+    Time referenceTime = clock.restart();
+
+    tiler.process(grid, tiles);
+    Time time = clock.restart();
+
+    tiler.process(grid, tiles, 4);
+    Time threadedTime = clock.restart();
+
+    for (u32 i = 0; i < 1000; ++i)
+    {
+        s32 x = (i * 97) % size;
+        s32 y = (i * 61) % size;
+        tiler.processArea(grid, tiles, x, y, x + 3, y + 3);
+    }
+    Time areaTime = clock.restart();
+
+    SN_LOG("AutoTiler on " << size << "x" << size << ": "
+        << "hash lookups " << referenceTime.asMilliseconds() << "ms (checksum " << checksum << "), "
+        << "tables " << time.asMilliseconds() << "ms, "
+        << "tables with 4 threads " << threadedTime.asMilliseconds() << "ms, "
+        << "1000 updates of 4x4 areas " << areaTime.asMicroseconds() << "us");
+}
+
@@ -0,0 +1,193 @@
+#include "tests.hpp"
+
+#include <modules/image/BlockCompression.h>
+#include <core/system/Clock.h>
+#include <core/util/Log.h>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace sn;
+
+namespace
+{
+    // Smooth colors with noise and a few hard edges, like most textures
+    void makeTestImage(std::vector<u8> & out_pixels, u32 width, u32 height)
+    {
+        out_pixels.resize(width * height * 4);
+        for (u32 y = 0; y < height; ++y)
+        {
+            for (u32 x = 0; x < width; ++x)
+            {
+                u8 * p = &out_pixels[(x + y * width) * 4];
+                s32 noise = static_cast<s32>(((x * 73856093u) ^ (y * 19349663u)) % 33) - 16;
+                s32 r = static_cast<s32>(x * 255 / width) + noise;
+                p[0] = static_cast<u8>(r < 0 ? 0 : (r > 255 ? 255 : r));
+                p[1] = static_cast<u8>(y * 255 / height);
+                p[2] = ((x / 32) + (y / 32)) % 2 ? 200 : 40;
+                p[3] = static_cast<u8>(128 + 127 * std::sin(x * 0.05f) * std::cos(y * 0.07f));
+            }
+        }
+    }
+
+    /// \brief Compresses and decompresses pixels, and gets the PSNR of each channel
+    void getRoundTripPSNR(const std::vector<u8> & pixels, u32 width, u32 height,
+        BlockFormat format, BlockQuality quality, f32 out_psnr[4])
+    {
+        std::vector<u8> blocks(getCompressedSize(format, width, height));
+        compressBlocks(&pixels[0], width, height, 4, format, quality, &blocks[0], 1);
+
+        u32 channelCount = getBlockChannelCount(format);
+        std::vector<u8> decoded(width * height * channelCount);
+        decompressBlocks(&blocks[0], width, height, format, &decoded[0]);
+
+        for (u32 c = 0; c < 4; ++c)
+        {
+            out_psnr[c] = 0.f;
+            if (c >= channelCount)
+                continue;
+            f64 error = 0.0;
+            for (u32 i = 0; i < width * height; ++i)
+            {
+                f64 d = static_cast<f64>(pixels[i * 4 + c]) - decoded[i * channelCount + c];
+                error += d * d;
+            }
+            f64 mse = error / (width * height);
+            out_psnr[c] = mse > 0.0 ? static_cast<f32>(10.0 * std::log10(255.0 * 255.0 / mse)) : 99.f;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void test_blockCompression()
+{
+    u32 errors = 0;
+
+    // Known BC1 block: red and blue endpoints, all texels on the first one
+    const u8 redBlock[8] = { 0x00, 0xf8, 0x1f, 0x00, 0, 0, 0, 0 };
+    u8 texels[16 * 4];
+    decompressBlocks(redBlock, 4, 4, SN_BLOCK_BC1, texels);
+    if (texels[0] != 255 || texels[1] != 0 || texels[2] != 0 || texels[3] != 255)
+    {
+        SN_ERROR("BC1 block was not decoded as red");
+        ++errors;
+    }
+
+    // Uniform blocks come back within quantization error
+    const u8 color[4] = { 200, 100, 30, 77 };
+    std::vector<u8> uniform(6 * 5 * 4);
+    for (u32 i = 0; i < uniform.size(); ++i)
+        uniform[i] = color[i % 4];
+    std::vector<u8> blocks(getCompressedSize(SN_BLOCK_BC3, 6, 5));
+    std::vector<u8> decoded(6 * 5 * 4);
+    if (blocks.size() != 4 * 16)
+    {
+        SN_ERROR("Wrong compressed size for partial blocks");
+        ++errors;
+    }
+    compressBlocks(&uniform[0], 6, 5, 4, SN_BLOCK_BC3, SN_BLOCK_QUALITY_NORMAL, &blocks[0], 1);
+    decompressBlocks(&blocks[0], 6, 5, SN_BLOCK_BC3, &decoded[0]);
+    for (u32 i = 0; i < decoded.size(); ++i)
+    {
+        if (std::abs(decoded[i] - color[i % 4]) > 4)
+        {
+            SN_ERROR("Uniform BC3 pixel " << i / 4 << " is too far from the source: " << (u32)decoded[i]);
+            ++errors;
+            break;
+        }
+    }
+
+    // Single and two channel formats are exact on uniform blocks
+    std::vector<u8> channels(getCompressedSize(SN_BLOCK_BC5, 6, 5));
+    std::vector<u8> rg(6 * 5 * 2);
+    compressBlocks(&uniform[0], 6, 5, 4, SN_BLOCK_BC5, SN_BLOCK_QUALITY_FAST, &channels[0], 1);
+    decompressBlocks(&channels[0], 6, 5, SN_BLOCK_BC5, &rg[0]);
+    if (rg[0] != color[0] || rg[1] != color[1] || rg[rg.size() - 1] != color[1])
+    {
+        SN_ERROR("Uniform BC5 block is not exact");
+        ++errors;
+    }
+
+    // Quality of a typical image, and higher qualities are not worse
+    const u32 size = 256;
+    std::vector<u8> pixels;
+    makeTestImage(pixels, size, size);
+
+    f32 fast[4], normal[4], high[4];
+    getRoundTripPSNR(pixels, size, size, SN_BLOCK_BC1, SN_BLOCK_QUALITY_FAST, fast);
+    getRoundTripPSNR(pixels, size, size, SN_BLOCK_BC1, SN_BLOCK_QUALITY_NORMAL, normal);
+    getRoundTripPSNR(pixels, size, size, SN_BLOCK_BC1, SN_BLOCK_QUALITY_HIGH, high);
+    SN_LOG("BC1 PSNR (R, G, B): fast " << fast[0] << ", " << fast[1] << ", " << fast[2]
+        << ", normal " << normal[0] << ", " << normal[1] << ", " << normal[2]
+        << ", high " << high[0] << ", " << high[1] << ", " << high[2]);
+    if (normal[0] < 30.f || normal[1] < 30.f || normal[2] < 30.f)
+    {
+        SN_ERROR("BC1 quality is too low");
+        ++errors;
+    }
+    // Refinement lowers the error of whole blocks, single channels may get slightly worse
+    if (high[0] < normal[0] - 0.5f || high[1] < normal[1] - 0.5f || high[2] < normal[2] - 0.5f)
+    {
+        SN_ERROR("High quality BC1 is worse than normal");
+        ++errors;
+    }
+
+    f32 bc3[4], bc4[4];
+    getRoundTripPSNR(pixels, size, size, SN_BLOCK_BC3, SN_BLOCK_QUALITY_NORMAL, bc3);
+    getRoundTripPSNR(pixels, size, size, SN_BLOCK_BC4, SN_BLOCK_QUALITY_HIGH, bc4);
+    SN_LOG("BC3 alpha PSNR " << bc3[3] << ", BC4 PSNR " << bc4[0]);
+    if (bc3[3] < 40.f || bc4[0] < 40.f)
+    {
+        SN_ERROR("Single channel quality is too low");
+        ++errors;
+    }
+
+    // Threads compress the same blocks
+    std::vector<u8> pixels2;
+    makeTestImage(pixels2, 1024, 1024);
+    std::vector<u8> single(getCompressedSize(SN_BLOCK_BC3, 1024, 1024));
+    std::vector<u8> threaded(single.size());
+    compressBlocks(&pixels2[0], 1024, 1024, 4, SN_BLOCK_BC3, SN_BLOCK_QUALITY_NORMAL, &single[0], 1);
+    compressBlocks(&pixels2[0], 1024, 1024, 4, SN_BLOCK_BC3, SN_BLOCK_QUALITY_NORMAL, &threaded[0], 4);
+    if (single != threaded)
+    {
+        SN_ERROR("Threaded compression differs");
+        ++errors;
+    }
+
+    SN_LOG("Block compression: " << errors << " errors");
+}
+
+//------------------------------------------------------------------------------
+void test_blockCompressionPerformance()
+{
+    const u32 size = 2048;
+    const f32 megaPixels = size * size / 1000000.f;
+
+    std::vector<u8> pixels;
+    makeTestImage(pixels, size, size);
+    std::vector<u8> blocks(getCompressedSize(SN_BLOCK_BC3, size, size));
+
+    const BlockQuality qualities[] = { SN_BLOCK_QUALITY_FAST, SN_BLOCK_QUALITY_NORMAL, SN_BLOCK_QUALITY_HIGH };
+    const char * names[] = { "fast", "normal", "high" };
+    for (u32 q = 0; q < 3; ++q)
+    {
+        Clock clock;
+        compressBlocks(&pixels[0], size, size, 4, SN_BLOCK_BC3, qualities[q], &blocks[0], 1);
+        Time time = clock.getElapsedTime();
+
+        Clock threadedClock;
+        compressBlocks(&pixels[0], size, size, 4, SN_BLOCK_BC3, qualities[q], &blocks[0], 4);
+        Time threadedTime = threadedClock.getElapsedTime();
+
+        SN_LOG("BC3 " << names[q] << " of " << size << "x" << size << ": " << time.asMilliseconds() << "ms ("
+            << megaPixels / time.asSeconds() << " MPixels/s), "
+            << threadedTime.asMilliseconds() << "ms on 4 threads");
+    }
+
+    // VRAM taken by the texture: 4 bytes per pixel uncompressed
+    SN_LOG("Texture of " << size << "x" << size << " takes " << size * size * 4 / 1024 << "KB as RGBA8, "
+        << getCompressedSize(SN_BLOCK_BC1, size, size) / 1024 << "KB as BC1, "
+        << getCompressedSize(SN_BLOCK_BC3, size, size) / 1024 << "KB as BC3");
+}
+
@@ -0,0 +1,187 @@
+#include "tests.hpp"
+
+#include <modules/freetype/DistanceField.h>
+#include <core/system/Clock.h>
+#include <core/system/parallel.h>
+#include <core/util/Log.h>
+#include <cmath>
+#include <vector>
+
+using namespace sn;
+
+namespace
+{
+    // Stands for a glyph rasterized by FreeType: a ring with a vertical stem,
+    // antialiased with 4x4 samples per pixel. Returns the size of the bitmap.
+    u32 rasterizeTestGlyph(u32 index, u32 charSize, bool antialias, std::vector<u8> & out_coverage)
+    {
+        const u32 size = charSize * 3 / 4;
+        const f32 radius = 0.35f * size + 0.05f * size * static_cast<f32>(index % 3);
+        const f32 thickness = 0.12f * charSize + 1.f;
+        const f32 center = 0.5f * size;
+        const u32 samples = antialias ? 4 : 1;
+
+        out_coverage.resize(size * size);
+        for (u32 y = 0; y < size; ++y)
+        {
+            for (u32 x = 0; x < size; ++x)
+            {
+                u32 inside = 0;
+                for (u32 sy = 0; sy < samples; ++sy)
+                {
+                    for (u32 sx = 0; sx < samples; ++sx)
+                    {
+                        f32 px = x + (sx + 0.5f) / samples - center;
+                        f32 py = y + (sy + 0.5f) / samples - center;
+                        f32 d = sqrt(px * px + py * py);
+                        bool ring = d < radius && d > radius - thickness;
+                        bool stem = (index % 2) && px > radius - thickness && px < radius;
+                        inside += ring || stem;
+                    }
+                }
+                out_coverage[x + y * size] = static_cast<u8>(inside * 255 / (samples * samples));
+            }
+        }
+        return size;
+    }
+
+    u8 encodeDistance(f32 d, u32 spread)
+    {
+        f32 value = 0.5f - d / (2.f * spread);
+        value = value < 0.f ? 0.f : (value > 1.f ? 1.f : value);
+        return static_cast<u8>(value * 255.f + 0.5f);
+    }
+}
+
+//------------------------------------------------------------------------------
+void test_distanceField()
+{
+    u32 errors = 0;
+    u32 valueCount = 0;
+
+    // With binary coverage, the distance field must match the distances to the nearest pixel of the other side
+    const u32 spread = 4;
+    std::vector<u8> coverage;
+    std::vector<u8> values;
+    for (u32 index = 0; index < 4; ++index)
+    {
+        u32 size = rasterizeTestGlyph(index, 24, false, coverage);
+        u32 w = size + 2 * spread;
+        values.resize(w * w);
+        computeDistanceField(&coverage[0], size, size, spread, &values[0]);
+
+        for (u32 y = 0; y < w; ++y)
+        {
+            for (u32 x = 0; x < w; ++x)
+            {
+                auto isInside = [&](s32 px, s32 py) {
+                    px -= spread;
+                    py -= spread;
+                    return px >= 0 && py >= 0 && px < (s32)size && py < (s32)size && coverage[px + py * size] == 255;
+                };
+                bool inside = isInside(x, y);
+
+                f32 nearest = 1e9f;
+                for (u32 y2 = 0; y2 < w; ++y2)
+                {
+                    for (u32 x2 = 0; x2 < w; ++x2)
+                    {
+                        if (isInside(x2, y2) == inside)
+                            continue;
+                        f32 dx = static_cast<f32>(x2) - static_cast<f32>(x);
+                        f32 dy = static_cast<f32>(y2) - static_cast<f32>(y);
+                        f32 d = sqrt(dx * dx + dy * dy);
+                        if (d < nearest)
+                            nearest = d;
+                    }
+                }
+
+                s32 expected = encodeDistance(inside ? -nearest : nearest, spread);
+                s32 actual = values[x + y * w];
+                if (std::abs(expected - actual) > 1)
+                {
+                    if (errors < 10)
+                        SN_ERROR("Distance at (" << x << ", " << y << ") of glyph " << index << " is " << actual << ", expected " << expected);
+                    ++errors;
+                }
+                ++valueCount;
+            }
+        }
+    }
+
+    // Partial coverage moves the outline between pixels
+    u8 half = 128;
+    u8 value = 0;
+    computeDistanceField(&half, 1, 1, 0, &value);
+    if (std::abs(static_cast<s32>(value) - 128) > 2)
+    {
+        SN_ERROR("Half covered pixel gives " << (u32)value << ", expected about 128");
+        ++errors;
+    }
+
+    SN_LOG("Distance field: " << errors << " errors over " << valueCount << " values");
+}
+
+//------------------------------------------------------------------------------
+void test_distanceFieldPerformance()
+{
+    // UI using a few text sizes, with printable ASCII characters
+    const u32 sizes[] = { 12, 14, 16, 18, 24, 32 };
+    const u32 sizeCount = sizeof(sizes) / sizeof(sizes[0]);
+    const u32 glyphCount = 95;
+    // Same as Font
+    const u32 padding = 1;
+    const u32 referenceSize = 48;
+    const u32 spread = 6;
+    const u32 threadCount = 4;
+
+    std::vector<u8> coverage;
+
+    // Bitmap mode: one set of glyphs per size
+    u32 bitmapPixels = 0;
+    Clock bitmapClock;
+    for (u32 s = 0; s < sizeCount; ++s)
+    {
+        for (u32 i = 0; i < glyphCount; ++i)
+        {
+            u32 size = rasterizeTestGlyph(i, sizes[s], true, coverage);
+            bitmapPixels += (size + 2 * padding) * (size + 2 * padding);
+        }
+    }
+    Time bitmapTime = bitmapClock.getElapsedTime();
+
+    // Distance field mode: one set at the reference size serves all sizes
+    std::vector< std::vector<u8> > coverages(glyphCount);
+    std::vector< std::vector<u8> > fields(glyphCount);
+    std::vector<u32> glyphSizes(glyphCount);
+
+    Clock rasterClock;
+    u32 fieldPixels = 0;
+    for (u32 i = 0; i < glyphCount; ++i)
+    {
+        glyphSizes[i] = rasterizeTestGlyph(i, referenceSize, true, coverages[i]);
+        u32 w = glyphSizes[i] + 2 * spread;
+        fields[i].resize(w * w);
+        fieldPixels += (w + 2 * padding) * (w + 2 * padding);
+    }
+    Time rasterTime = rasterClock.getElapsedTime();
+
+    Time fieldTimes[2];
+    for (u32 pass = 0; pass < 2; ++pass)
+    {
+        Clock fieldClock;
+        parallelFor(glyphCount, pass == 0 ? 1 : threadCount, [&](u32 begin, u32 end) {
+            for (u32 i = begin; i < end; ++i)
+                computeDistanceField(&coverages[i][0], glyphSizes[i], glyphSizes[i], spread, &fields[i][0]);
+        });
+        fieldTimes[pass] = fieldClock.getElapsedTime();
+    }
+
+    SN_LOG("Glyph atlas for " << glyphCount << " glyphs at " << sizeCount << " sizes: "
+        << "bitmap mode takes " << bitmapPixels << " bytes and " << bitmapTime.asMilliseconds() << "ms, "
+        << "distance field mode (size " << referenceSize << ", spread " << spread << ") takes " << fieldPixels << " bytes and "
+        << (rasterTime + fieldTimes[0]).asMilliseconds() << "ms with one thread, "
+        << (rasterTime + fieldTimes[1]).asMilliseconds() << "ms with " << threadCount << " threads "
+        << "(rasterization " << rasterTime.asMilliseconds() << "ms)");
+}
+
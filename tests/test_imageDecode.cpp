@@ -0,0 +1,253 @@
+#include "tests.hpp"
+
+#include <modules/image/ImageDecoder.h>
+#include <modules/image/ImageKernels.h>
+#include <core/system/MappedFile.h>
+#include <core/system/Clock.h>
+#include <core/util/Log.h>
+#include <core/util/stringutils.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+// The image module is not linked, so PNG files are encoded here
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <modules/image/stbi/stb_image_write.h>
+
+using namespace sn;
+
+namespace
+{
+    // Gradients with noise, so PNG filters and compression have work to do
+    void makeTestImage(std::vector<u8> & out_pixels, u32 width, u32 height, u32 channelCount)
+    {
+        out_pixels.resize(width * height * channelCount);
+        for (u32 y = 0; y < height; ++y)
+        {
+            for (u32 x = 0; x < width; ++x)
+            {
+                u8 * p = &out_pixels[(x + y * width) * channelCount];
+                u8 noise = static_cast<u8>(((x * 73856093u) ^ (y * 19349663u)) % 17);
+                p[0] = static_cast<u8>(x * 255 / width + noise);
+                p[1] = static_cast<u8>(y * 255 / height);
+                p[2] = ((x / 16) + (y / 16)) % 2 ? 220 : 30;
+                if (channelCount == 4)
+                    p[3] = static_cast<u8>(x + y);
+            }
+        }
+    }
+
+    void encodePNG(const std::vector<u8> & pixels, u32 width, u32 height, u32 channelCount, std::vector<u8> & out_file)
+    {
+        int len = 0;
+        u8 * png = stbi_write_png_to_mem(const_cast<u8*>(&pixels[0]), width * channelCount, width, height, channelCount, &len);
+        out_file.assign(png, png + len);
+        free(png);
+    }
+
+    void appendU32(std::vector<u8> & out, u32 v)
+    {
+        out.push_back(static_cast<u8>(v >> 24));
+        out.push_back(static_cast<u8>(v >> 16));
+        out.push_back(static_cast<u8>(v >> 8));
+        out.push_back(static_cast<u8>(v));
+    }
+
+    // Splits the compressed pixels in several IDAT chunks, as encoders writing streams do
+    void splitDataChunk(const std::vector<u8> & file, u32 chunkSize, std::vector<u8> & out_file)
+    {
+        // Signature, IHDR, then the single IDAT chunk written by stb
+        const u32 idatOffset = 8 + 12 + 13;
+        const u8 * p = &file[idatOffset];
+        const u32 length = (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+        const u8 * data = p + 8;
+
+        out_file.assign(file.begin(), file.begin() + idatOffset);
+        for (u32 i = 0; i < length; i += chunkSize)
+        {
+            u32 n = length - i < chunkSize ? length - i : chunkSize;
+            u32 start = out_file.size();
+            appendU32(out_file, n);
+            out_file.insert(out_file.end(), p + 4, p + 8);
+            out_file.insert(out_file.end(), data + i, data + i + n);
+            appendU32(out_file, stbiw__crc32(&out_file[start + 4], n + 4));
+        }
+        out_file.insert(out_file.end(), file.begin() + idatOffset + 12 + length, file.end());
+    }
+
+    // Files written by the test go to the system temporary directory, not next to the fixtures
+    std::string getTempFilePath(const char * name)
+    {
+        const char * dir = std::getenv("TMPDIR");
+        if (dir == nullptr)
+            dir = std::getenv("TEMP");
+        if (dir == nullptr)
+            dir = std::getenv("TMP");
+        return std::string(dir != nullptr ? dir : ".") + "/" + name;
+    }
+}
+
+//------------------------------------------------------------------------------
+void test_imageDecode()
+{
+    u32 errors = 0;
+
+    // RGBA files decode to the same pixels
+    const u32 width = 300;
+    const u32 height = 200;
+    std::vector<u8> pixels;
+    std::vector<u8> file;
+    makeTestImage(pixels, width, height, 4);
+    encodePNG(pixels, width, height, 4, file);
+
+    Vector2u size;
+    u8 * decoded = decodeImage(&file[0], file.size(), 0, true, size);
+    if (decoded == nullptr || size != Vector2u(width, height))
+    {
+        SN_ERROR("RGBA PNG was not decoded: " << getImageDecodeError());
+        ++errors;
+    }
+    else if (memcmp(decoded, &pixels[0], pixels.size()) != 0)
+    {
+        SN_ERROR("Decoded RGBA pixels differ from the source");
+        ++errors;
+    }
+    free(decoded);
+
+    // Data split across chunks is inflated from where it is
+    std::vector<u8> splitFile;
+    splitDataChunk(file, 1000, splitFile);
+    decoded = decodeImage(&splitFile[0], splitFile.size(), 0, true, size);
+    if (decoded == nullptr || size != Vector2u(width, height) || memcmp(decoded, &pixels[0], pixels.size()) != 0)
+    {
+        SN_ERROR("PNG made of several IDAT chunks was not decoded: " << getImageDecodeError());
+        ++errors;
+    }
+    free(decoded);
+
+    // RGB files get opaque alpha
+    std::vector<u8> rgb;
+    std::vector<u8> rgbFile;
+    makeTestImage(rgb, width, height, 3);
+    encodePNG(rgb, width, height, 3, rgbFile);
+    decoded = decodeImage(&rgbFile[0], rgbFile.size(), 0, true, size);
+    if (decoded == nullptr)
+    {
+        SN_ERROR("RGB PNG was not decoded: " << getImageDecodeError());
+        ++errors;
+    }
+    else
+    {
+        for (u32 i = 0; i < width * height; ++i)
+        {
+            if (memcmp(decoded + i * 4, &rgb[i * 3], 3) != 0 || decoded[i * 4 + 3] != 255)
+            {
+                SN_ERROR("Decoded RGB pixel " << i << " differs from the source");
+                ++errors;
+                break;
+            }
+        }
+    }
+    free(decoded);
+
+    // Halving in place gives the same mipmaps as separate buffers
+    decoded = decodeImage(&file[0], file.size(), 64, true, size);
+    if (decoded == nullptr || size != Vector2u(37, 25))
+    {
+        SN_ERROR("Image was not halved to fit in 64 pixels: " << size.x() << "x" << size.y());
+        ++errors;
+    }
+    else
+    {
+        std::vector<u8> level = pixels;
+        std::vector<u8> next;
+        u32 w = width;
+        u32 h = height;
+        while (w > 64 || h > 64)
+        {
+            next.resize((w / 2) * (h / 2) * 4);
+            downsampleBox(&level[0], w, h, 4, true, &next[0], 1);
+            level.swap(next);
+            w /= 2;
+            h /= 2;
+        }
+        if (memcmp(decoded, &level[0], w * h * 4) != 0)
+        {
+            SN_ERROR("Image halved in place differs from separate mipmaps");
+            ++errors;
+        }
+    }
+    free(decoded);
+
+    // Mapped files give the bytes that were written
+    const std::string fileName = getTempFilePath("sn_test_decode_output.png");
+    {
+        std::ofstream ofs(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        ofs.write(reinterpret_cast<const char*>(&file[0]), file.size());
+    }
+    MappedFile mappedFile;
+    if (!mappedFile.open(toWideString(fileName)))
+    {
+        SN_ERROR("Couldn't map " << fileName);
+        ++errors;
+    }
+    else if (mappedFile.getSize() != file.size() || memcmp(mappedFile.getData(), &file[0], file.size()) != 0)
+    {
+        SN_ERROR("Mapped file differs from what was written");
+        ++errors;
+    }
+    mappedFile.close();
+    if (mappedFile.isOpen() || mappedFile.open(L"test_data/missing_file.png"))
+    {
+        SN_ERROR("Missing file was mapped");
+        ++errors;
+    }
+    std::remove(fileName.c_str());
+
+    // Corrupt files fail without crashing
+    file[file.size() / 2] ^= 0xff;
+    file.resize(file.size() * 3 / 4);
+    decoded = decodeImage(&file[0], file.size(), 0, true, size);
+    if (decoded != nullptr)
+    {
+        SN_ERROR("Truncated PNG was decoded");
+        ++errors;
+    }
+    free(decoded);
+
+    SN_LOG("Image decode: " << errors << " errors");
+}
+
+//------------------------------------------------------------------------------
+void test_imageDecodePerformance()
+{
+    const u32 size = 4096;
+    const f32 megaPixels = size * size / 1000000.f;
+
+    std::vector<u8> pixels;
+    std::vector<u8> file;
+    makeTestImage(pixels, size, size, 4);
+    encodePNG(pixels, size, size, 4, file);
+    pixels.clear();
+
+    Vector2u decodedSize;
+    Clock clock;
+    u8 * decoded = decodeImage(&file[0], file.size(), 0, true, decodedSize);
+    Time time = clock.getElapsedTime();
+    free(decoded);
+
+    Clock halfClock;
+    decoded = decodeImage(&file[0], file.size(), size / 2, true, decodedSize);
+    Time halfTime = halfClock.getElapsedTime();
+    free(decoded);
+
+    // Big buffers alive at the same time: the file, compressed pixels, and inflated rows,
+    // which become the pixels of the image
+    SN_LOG("PNG of " << size << "x" << size << " (" << file.size() / 1024 << "KB): decoded in "
+        << time.asMilliseconds() << "ms (" << megaPixels / time.asSeconds() << " MPixels/s), "
+        << halfTime.asMilliseconds() << "ms with half size, "
+        << size * size * 4 / 1024 << "KB of pixels");
+}
+
@@ -0,0 +1,216 @@
+#include "tests.hpp"
+
+#include <modules/image/ImageKernels.h>
+#include <core/system/Clock.h>
+#include <core/util/Log.h>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace sn;
+
+namespace
+{
+    // Tells if all components are within a tolerance of the expected values
+    bool isUniform(const std::vector<u8> & pixels, const u8 * expected, u32 channelCount, s32 tolerance)
+    {
+        for (u32 i = 0; i < pixels.size(); ++i)
+        {
+            if (std::abs(static_cast<s32>(pixels[i]) - static_cast<s32>(expected[i % channelCount])) > tolerance)
+                return false;
+        }
+        return true;
+    }
+
+    void makeGradient(std::vector<u8> & out_pixels, u32 width, u32 height)
+    {
+        out_pixels.resize(width * height * 4);
+        for (u32 y = 0; y < height; ++y)
+        {
+            for (u32 x = 0; x < width; ++x)
+            {
+                u8 * p = &out_pixels[(x + y * width) * 4];
+                p[0] = static_cast<u8>(x);
+                p[1] = static_cast<u8>(y);
+                p[2] = static_cast<u8>(x ^ y);
+                p[3] = 255;
+            }
+        }
+    }
+
+    // What mipmaps would cost with gamma computed for each component
+    void downsamplePow(const u8 * pixels, u32 width, u32 height, u8 * out_pixels)
+    {
+        u32 outWidth = width / 2;
+        u32 outHeight = height / 2;
+        for (u32 y = 0; y < outHeight; ++y)
+        {
+            for (u32 x = 0; x < outWidth; ++x)
+            {
+                const u8 * p = pixels + (2 * x + 2 * y * width) * 4;
+                u8 * o = out_pixels + (x + y * outWidth) * 4;
+                for (u32 c = 0; c < 4; ++c)
+                {
+                    const u8 v[4] = { p[c], p[c + 4], p[c + width * 4], p[c + width * 4 + 4] };
+                    f32 sum = 0.f;
+                    for (u32 k = 0; k < 4; ++k)
+                        sum += c < 3 ? std::pow(v[k] / 255.f, 2.2f) : v[k] / 255.f;
+                    sum *= 0.25f;
+                    o[c] = static_cast<u8>((c < 3 ? std::pow(sum, 1.f / 2.2f) : sum) * 255.f + 0.5f);
+                }
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void test_imageKernels()
+{
+    u32 errors = 0;
+
+    // Conversions keep values the target format can represent
+    const u8 rgba[] = { 255, 0, 0, 255, 0, 255, 0, 255, 0, 0, 255, 128, 255, 255, 255, 0 };
+    u8 packed[8];
+    u8 unpacked[16];
+    convertPixels(rgba, SN_IMAGE_RGBA32, packed, SN_IMAGE_RGB565, 4);
+    convertPixels(packed, SN_IMAGE_RGB565, unpacked, SN_IMAGE_RGBA32, 4);
+    for (u32 i = 0; i < 4; ++i)
+    {
+        const u8 * a = rgba + i * 4;
+        const u8 * b = unpacked + i * 4;
+        if (a[0] != b[0] || a[1] != b[1] || a[2] != b[2] || b[3] != 255)
+        {
+            SN_ERROR("RGB565 round-trip changed pixel " << i);
+            ++errors;
+        }
+    }
+
+    convertPixels(rgba, SN_IMAGE_RGBA32, packed, SN_IMAGE_RG16, 4);
+    convertPixels(packed, SN_IMAGE_RG16, unpacked, SN_IMAGE_R8, 4);
+    if (unpacked[0] != 255 || unpacked[1] != 0 || packed[3] != 255)
+    {
+        SN_ERROR("RG16 or R8 conversion is wrong");
+        ++errors;
+    }
+
+    convertPixels(rgba, SN_IMAGE_RGBA32, packed, SN_IMAGE_ALPHA8, 4);
+    convertPixels(packed, SN_IMAGE_ALPHA8, unpacked, SN_IMAGE_RGBA32, 4);
+    if (packed[2] != 128 || unpacked[8] != 255 || unpacked[11] != 128)
+    {
+        SN_ERROR("Alpha conversion is wrong");
+        ++errors;
+    }
+
+    u8 premultiplied[] = { 255, 128, 0, 128 };
+    premultiplyAlpha(premultiplied, 1);
+    if (premultiplied[0] != 128 || premultiplied[1] != 64 || premultiplied[2] != 0 || premultiplied[3] != 128)
+    {
+        SN_ERROR("Wrong premultiplied alpha");
+        ++errors;
+    }
+
+    // Uniform images stay uniform with every filter
+    const u8 color[] = { 200, 100, 30, 128 };
+    std::vector<u8> uniform(37 * 13 * 4);
+    for (u32 i = 0; i < uniform.size(); ++i)
+        uniform[i] = color[i % 4];
+
+    std::vector<u8> half(18 * 6 * 4);
+    downsampleBox(&uniform[0], 37, 13, 4, true, &half[0], 1);
+    if (!isUniform(half, color, 4, 1))
+    {
+        SN_ERROR("Box mipmap of a uniform image is not uniform");
+        ++errors;
+    }
+
+    const ImageFilter filters[] = { SN_IMAGE_FILTER_BOX, SN_IMAGE_FILTER_BILINEAR, SN_IMAGE_FILTER_LANCZOS, SN_IMAGE_FILTER_KAISER };
+    for (u32 f = 0; f < 4; ++f)
+    {
+        std::vector<u8> smaller(18 * 6 * 4);
+        std::vector<u8> bigger(100 * 7 * 4);
+        resample(&uniform[0], 37, 13, 4, true, &smaller[0], 18, 6, filters[f], 1);
+        resample(&uniform[0], 37, 13, 4, true, &bigger[0], 100, 7, filters[f], 1);
+        if (!isUniform(smaller, color, 4, 1) || !isUniform(bigger, color, 4, 1))
+        {
+            SN_ERROR("Filter " << filters[f] << " changed a uniform image");
+            ++errors;
+        }
+    }
+
+    // Black and white average to middle grey in linear space, which is brighter in sRGB
+    const u8 checker[] = {
+        0, 0, 0, 255,   255, 255, 255, 255,
+        255, 255, 255, 255,   0, 0, 0, 255
+    };
+    u8 grey[4];
+    downsampleBox(checker, 2, 2, 4, true, grey, 1);
+    if (std::abs(grey[0] - 188) > 1 || grey[3] != 255)
+    {
+        SN_ERROR("sRGB average is wrong: " << (u32)grey[0]);
+        ++errors;
+    }
+    downsampleBox(checker, 2, 2, 4, false, grey, 1);
+    if (grey[0] != 128)
+    {
+        SN_ERROR("Linear average is wrong: " << (u32)grey[0]);
+        ++errors;
+    }
+
+    // Threads compute the same pixels
+    std::vector<u8> gradient;
+    makeGradient(gradient, 1024, 1024);
+    std::vector<u8> single(512 * 512 * 4);
+    std::vector<u8> threaded(512 * 512 * 4);
+    resample(&gradient[0], 1024, 1024, 4, true, &single[0], 512, 512, SN_IMAGE_FILTER_KAISER, 1);
+    resample(&gradient[0], 1024, 1024, 4, true, &threaded[0], 512, 512, SN_IMAGE_FILTER_KAISER, 4);
+    if (single != threaded)
+    {
+        SN_ERROR("Threaded resampling differs");
+        ++errors;
+    }
+
+    SN_LOG("Image kernels: " << errors << " errors");
+}
+
+//------------------------------------------------------------------------------
+void test_imageKernelsPerformance()
+{
+    const u32 size = 2048;
+
+    std::vector<u8> pixels;
+    makeGradient(pixels, size, size);
+    std::vector<u8> out(size * size);
+
+    // Before: gamma was computed for every component
+    Clock powClock;
+    downsamplePow(&pixels[0], size, size, &out[0]);
+    Time powTime = powClock.getElapsedTime();
+
+    Clock boxClock;
+    downsampleBox(&pixels[0], size, size, 4, true, &out[0], 1);
+    Time boxTime = boxClock.getElapsedTime();
+
+    Clock boxThreadedClock;
+    downsampleBox(&pixels[0], size, size, 4, true, &out[0], 4);
+    Time boxThreadedTime = boxThreadedClock.getElapsedTime();
+
+    Clock kaiserClock;
+    resample(&pixels[0], size, size, 4, true, &out[0], size / 2, size / 2, SN_IMAGE_FILTER_KAISER, 1);
+    Time kaiserTime = kaiserClock.getElapsedTime();
+
+    Clock kaiserThreadedClock;
+    resample(&pixels[0], size, size, 4, true, &out[0], size / 2, size / 2, SN_IMAGE_FILTER_KAISER, 4);
+    Time kaiserThreadedTime = kaiserThreadedClock.getElapsedTime();
+
+    std::vector<u8> packed(size * size * 2);
+    Clock convertClock;
+    convertPixels(&pixels[0], SN_IMAGE_RGBA32, &packed[0], SN_IMAGE_RGB565, size * size);
+    Time convertTime = convertClock.getElapsedTime();
+
+    SN_LOG("Image kernels, first mipmap of " << size << "x" << size << " RGBA: "
+        << "pow per component takes " << powTime.asMilliseconds() << "ms, "
+        << "box " << boxTime.asMilliseconds() << "ms (" << boxThreadedTime.asMilliseconds() << "ms on 4 threads), "
+        << "Kaiser " << kaiserTime.asMilliseconds() << "ms (" << kaiserThreadedTime.asMilliseconds() << "ms on 4 threads). "
+        << "Converting to RGB565 takes " << convertTime.asMilliseconds() << "ms");
+}
+
@@ -0,0 +1,69 @@
+#include "tests.hpp"
+
+#include <core/util/MPSCQueue.h>
+#include <core/util/Log.h>
+#include <core/system/Thread.h>
+#include <core/system/Clock.h>
+#include <vector>
+
+using namespace sn;
+
+void test_mpscQueue()
+{
+    const u32 producerCount = 4;
+    const u32 valuesPerProducer = 100000;
+
+    MPSCQueue<u32> queue(1024);
+
+    // Each producer pushes its own range of values, in order
+    std::vector<Thread*> producers;
+    for (u32 p = 0; p < producerCount; ++p)
+    {
+        producers.push_back(new Thread([&queue, p, valuesPerProducer](){
+            for (u32 i = 0; i < valuesPerProducer; ++i)
+            {
+                while (!queue.push(p * valuesPerProducer + i))
+                {
+                    // Full, let the consumer catch up
+                    Thread::sleep(Time::milliseconds(0));
+                }
+            }
+        }));
+    }
+
+    Clock clock;
+    for (u32 p = 0; p < producerCount; ++p)
+        producers[p]->start();
+
+    // Consume in batches, and check values from each producer come in order
+    std::vector<u32> nextExpected(producerCount, 0);
+    u32 batch[64];
+    u32 received = 0;
+    u32 errors = 0;
+    while (received < producerCount * valuesPerProducer)
+    {
+        size_t count = queue.popBatch(batch, 64);
+        if (count == 0)
+            Thread::sleep(Time::milliseconds(0));
+        for (size_t i = 0; i < count; ++i)
+        {
+            u32 p = batch[i] / valuesPerProducer;
+            u32 v = batch[i] % valuesPerProducer;
+            if (p >= producerCount || v != nextExpected[p])
+                ++errors;
+            else
+                ++nextExpected[p];
+        }
+        received += count;
+    }
+    Time elapsed = clock.getElapsedTime();
+
+    for (u32 p = 0; p < producerCount; ++p)
+    {
+        producers[p]->wait();
+        delete producers[p];
+    }
+
+    SN_LOG("MPSCQueue: " << received << " values from " << producerCount << " producers in "
+        << elapsed.asMilliseconds() << "ms, " << errors << " errors, empty: " << queue.isEmpty());
+}
@@ -0,0 +1,136 @@
+#include "tests.hpp"
+
+#include <core/math/noise.h>
+#include <core/system/Clock.h>
+#include <core/util/Log.h>
+
+using namespace sn;
+
+namespace
+{
+    u32 countDifferences2D(Array2D<f32> & grid, f32 originX, f32 originY, s32 seed, s32 octaves, f32 persistence, f32 period)
+    {
+        u32 differences = 0;
+        for (u32 y = 0; y < grid.sizeY(); ++y)
+        {
+            for (u32 x = 0; x < grid.sizeX(); ++x)
+            {
+                f32 expected = noise2dPerlin(originX + (f32)x, originY + (f32)y, seed, octaves, persistence, period);
+                if (grid[grid.getLocation(x, y)] != expected)
+                    ++differences;
+            }
+        }
+        return differences;
+    }
+
+    u32 countDifferences3D(Array3D<f32> & grid, f32 originX, f32 originY, f32 originZ, s32 seed, s32 octaves, f32 persistence, f32 period)
+    {
+        u32 differences = 0;
+        for (u32 z = 0; z < grid.sizeZ(); ++z)
+        {
+            for (u32 y = 0; y < grid.sizeY(); ++y)
+            {
+                for (u32 x = 0; x < grid.sizeX(); ++x)
+                {
+                    f32 expected = noise3dPerlin(originX + (f32)x, originY + (f32)y, originZ + (f32)z, seed, octaves, persistence, period);
+                    if (grid[grid.getLocation(x, y, z)] != expected)
+                        ++differences;
+                }
+            }
+        }
+        return differences;
+    }
+
+    f64 samplesPerSecond(u32 samples, Time time)
+    {
+        return time.asMicroseconds() > 0 ? (f64)samples * 1000000.0 / (f64)time.asMicroseconds() : 0.0;
+    }
+}
+
+void test_noise()
+{
+    // Batch results must be the same as scalar ones, bit for bit
+    struct Params { f32 ox, oy, oz; s32 octaves; f32 persistence; f32 period; };
+    const Params params[] = {
+        { 0, 0, 0, 1, 0.5f, 16.f },
+        { -37.5f, 12.25f, -3.f, 6, 0.5f, 32.f },
+        { 1000.f, -2000.f, 7.f, 8, 0.7f, 5.f },
+        { -3.f, -3.f, -3.f, 4, 0.4f, 1.f }
+    };
+
+    Array2D<f32> grid2(67, 45);
+    Array3D<f32> grid3(19, 13, 11);
+
+    for (u32 i = 0; i < sizeof(params) / sizeof(params[0]); ++i)
+    {
+        const Params & p = params[i];
+
+        noise2dPerlin(grid2, p.ox, p.oy, 131, p.octaves, p.persistence, p.period, 3);
+        u32 d2 = countDifferences2D(grid2, p.ox, p.oy, 131, p.octaves, p.persistence, p.period);
+
+        noise3dPerlin(grid3, p.ox, p.oy, p.oz, 131, p.octaves, p.persistence, p.period, 3);
+        u32 d3 = countDifferences3D(grid3, p.ox, p.oy, p.oz, 131, p.octaves, p.persistence, p.period);
+
+        SN_LOG("Noise batch case " << i << ": " << d2 << " 2D differences, " << d3 << " 3D differences");
+    }
+}
+
+void test_noisePerformance()
+{
+    const s32 octaves = 6;
+    const f32 persistence = 0.5f;
+    const f32 period = 64.f;
+
+    // 2D
+    {
+        Array2D<f32> grid(512, 512);
+        const u32 samples = grid.area();
+
+        Clock clock;
+        for (u32 y = 0; y < grid.sizeY(); ++y)
+        {
+            for (u32 x = 0; x < grid.sizeX(); ++x)
+                grid[grid.getLocation(x, y)] = noise2dPerlin((f32)x, (f32)y, 131, octaves, persistence, period);
+        }
+        Time scalarTime = clock.restart();
+
+        noise2dPerlin(grid, 0, 0, 131, octaves, persistence, period, 1);
+        Time batchTime = clock.restart();
+
+        noise2dPerlin(grid, 0, 0, 131, octaves, persistence, period, 4);
+        Time threadedTime = clock.restart();
+
+        SN_LOG("noise2dPerlin " << grid.sizeX() << "x" << grid.sizeY() << ", " << octaves << " octaves:");
+        SN_MORE("scalar:      " << samplesPerSecond(samples, scalarTime) << " samples/s");
+        SN_MORE("batch:       " << samplesPerSecond(samples, batchTime) << " samples/s");
+        SN_MORE("batch (x4):  " << samplesPerSecond(samples, threadedTime) << " samples/s");
+    }
+
+    // 3D
+    {
+        Array3D<f32> grid(64, 64, 64);
+        const u32 samples = grid.volume();
+
+        Clock clock;
+        for (u32 z = 0; z < grid.sizeZ(); ++z)
+        {
+            for (u32 y = 0; y < grid.sizeY(); ++y)
+            {
+                for (u32 x = 0; x < grid.sizeX(); ++x)
+                    grid[grid.getLocation(x, y, z)] = noise3dPerlin((f32)x, (f32)y, (f32)z, 131, octaves, persistence, period);
+            }
+        }
+        Time scalarTime = clock.restart();
+
+        noise3dPerlin(grid, 0, 0, 0, 131, octaves, persistence, period, 1);
+        Time batchTime = clock.restart();
+
+        noise3dPerlin(grid, 0, 0, 0, 131, octaves, persistence, period, 4);
+        Time threadedTime = clock.restart();
+
+        SN_LOG("noise3dPerlin " << grid.sizeX() << "x" << grid.sizeY() << "x" << grid.sizeZ() << ", " << octaves << " octaves:");
+        SN_MORE("scalar:      " << samplesPerSecond(samples, scalarTime) << " samples/s");
+        SN_MORE("batch:       " << samplesPerSecond(samples, batchTime) << " samples/s");
+        SN_MORE("batch (x4):  " << samplesPerSecond(samples, threadedTime) << " samples/s");
+    }
+}
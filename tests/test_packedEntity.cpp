@@ -0,0 +1,150 @@
+#include "tests.hpp"
+
+#include <core/scene/PackedEntity.h>
+#include <core/reflect/ObjectTypeDatabase.h>
+#include <core/object_types.h>
+#include <core/util/macros.h>
+#include <core/util/Log.h>
+
+#include <sstream>
+#include <map>
+
+using namespace sn;
+
+namespace
+{
+    // Prefabs looked up by name from the test instead of the asset database
+    class TestPrefab : public PackedEntity
+    {
+    public:
+        TestPrefab(const std::map<std::string, TestPrefab*> & library) : r_library(library) {}
+
+        bool loadFromString(const std::string & json)
+        {
+            std::stringstream ss(json);
+            return loadFromStream(ss);
+        }
+
+        u32 getFlattenedObjectCount() const { return getObjects().size(); }
+        bool isUpToDate() { return isFlattened(); }
+
+    protected:
+        ObjectDB * getFromAssetDatabase(const std::string & location) const override
+        {
+            auto it = r_library.find(location);
+            return it != r_library.end() ? it->second : nullptr;
+        }
+
+    private:
+        const std::map<std::string, TestPrefab*> & r_library;
+    };
+
+    const char * CRATE =
+        "{\"format\":\"SN2\", \"root\":0, \"next\":2, \"objects\":["
+        "  0, {\"@type\":\"sn::Entity\", \"name\":\"Crate\", \"_children\":[{\"@ref\":1}]},"
+        "  1, {\"@type\":\"sn::Entity\", \"name\":\"Lid\"}"
+        "]}";
+
+    const char * CRATE_WITH_LABEL =
+        "{\"format\":\"SN2\", \"root\":0, \"next\":3, \"objects\":["
+        "  0, {\"@type\":\"sn::Entity\", \"name\":\"Crate\", \"_children\":[{\"@ref\":1}, {\"@ref\":2}]},"
+        "  1, {\"@type\":\"sn::Entity\", \"name\":\"Lid\"},"
+        "  2, {\"@type\":\"sn::Entity\", \"name\":\"Label\"}"
+        "]}";
+
+    // Two crates, one of them renamed
+    const char * LEVEL =
+        "{\"format\":\"SN2\", \"root\":0, \"next\":3, \"objects\":["
+        "  0, {\"@type\":\"sn::Entity\", \"name\":\"Level\", \"_children\":[{\"@ref\":1}, {\"@ref\":2}]},"
+        "  1, {\"@src\":\"crate\"},"
+        "  2, {\"@src\":\"crate\", \"changes\":[0, \"name\", \"BigCrate\"]}"
+        "]}";
+
+    // Names of the entity tree, depth-first, so hierarchies can be compared as strings
+    void getTreeNames(const Entity & e, std::string & out_names)
+    {
+        out_names += e.getName();
+        if (e.getChildCount() == 0)
+            return;
+        out_names += "(";
+        for (u32 i = 0; i < e.getChildCount(); ++i)
+        {
+            if (i != 0)
+                out_names += ",";
+            getTreeNames(*e.getChildByIndex(i), out_names);
+        }
+        out_names += ")";
+    }
+
+    std::string instantiateNames(TestPrefab & prefab)
+    {
+        Entity * parent = new Entity();
+        prefab.instantiate(*parent, "test");
+        std::string names;
+        getTreeNames(*parent, names);
+        parent->destroy();
+        return names;
+    }
+}
+
+//------------------------------------------------------------------------------
+void test_packedEntity()
+{
+    ObjectTypeDatabase & otb = ObjectTypeDatabase::get();
+    if (!otb.isRegistered(SN_TYPESTRING(sn::Entity)))
+        sn::registerObjectTypes(otb);
+
+    u32 errors = 0;
+
+    std::map<std::string, TestPrefab*> library;
+    TestPrefab * crate = new TestPrefab(library);
+    TestPrefab * level = new TestPrefab(library);
+    library["crate"] = crate;
+    crate->loadFromString(CRATE);
+    level->loadFromString(LEVEL);
+
+    // Instances get the objects of their source, with overrides applied
+    const std::string expected = "(Level(Crate(Lid),BigCrate(Lid)))";
+    std::string names = instantiateNames(*level);
+    if (names != expected)
+    {
+        SN_ERROR("Prefab instantiated as " << names << ", expected " << expected);
+        ++errors;
+    }
+
+    // Flattened data is reused, and instantiating again gives the same entities
+    u32 objectCount = level->getFlattenedObjectCount();
+    if (!level->isUpToDate())
+    {
+        SN_ERROR("Prefab is not flattened after instantiation");
+        ++errors;
+    }
+    names = instantiateNames(*level);
+    if (names != expected || level->getFlattenedObjectCount() != objectCount)
+    {
+        SN_ERROR("Prefab instantiated again as " << names << " with " << level->getFlattenedObjectCount()
+            << " objects, expected " << expected << " with " << objectCount);
+        ++errors;
+    }
+
+    // Reloading a source invalidates prefabs made of it, and flattening again doesn't accumulate objects
+    crate->loadFromString(CRATE_WITH_LABEL);
+    if (level->isUpToDate())
+    {
+        SN_ERROR("Prefab is still flattened after its source was reloaded");
+        ++errors;
+    }
+    const std::string expectedWithLabel = "(Level(Crate(Lid,Label),BigCrate(Lid,Label)))";
+    names = instantiateNames(*level);
+    if (names != expectedWithLabel || level->getFlattenedObjectCount() != objectCount + 2)
+    {
+        SN_ERROR("Prefab instantiated after reload as " << names << " with " << level->getFlattenedObjectCount()
+            << " objects, expected " << expectedWithLabel << " with " << objectCount + 2);
+        ++errors;
+    }
+
+    level->release();
+    crate->release();
+
+    SN_LOG("PackedEntity: " << errors << " errors");
+}
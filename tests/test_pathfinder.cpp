@@ -0,0 +1,316 @@
+#include "tests.hpp"
+
+#include <core/util/HierarchicalPathFinder.h>
+#include <core/util/PathQueryService.h>
+#include <core/math/Random.h>
+#include <core/system/Clock.h>
+#include <core/util/Log.h>
+#include <queue>
+#include <functional>
+
+using namespace sn;
+
+namespace
+{
+    // Grid with random blocks and a few walls, 1 = crossable, 0 = not
+    void generateGrid(std::vector<s8> & grid, u32 sizeX, u32 sizeY, f32 blockChance, u64 seed)
+    {
+        Random rng(seed);
+        grid.assign(sizeX * sizeY, 1);
+        for (u32 i = 0; i < grid.size(); ++i)
+        {
+            if (rng.chance(blockChance))
+                grid[i] = 0;
+        }
+        // Long walls with a few holes make paths go around
+        for (u32 x = sizeX / 4; x < sizeX; x += sizeX / 4)
+        {
+            for (u32 y = 0; y < sizeY; ++y)
+            {
+                if (rng.range(0, 40) != 0)
+                    grid[y * sizeX + x] = 0;
+            }
+        }
+    }
+
+    // Returns the cost of a path, or -1 if it contains an invalid step
+    s32 getPathCost(const PathFinder & finder, const std::vector<Vector2i> & path)
+    {
+        s32 cost = 0;
+        for (u32 i = 1; i < path.size(); ++i)
+        {
+            s32 dx = path[i].x() - path[i - 1].x();
+            s32 dy = path[i].y() - path[i - 1].y();
+            s32 stepCost = 0;
+            for (u32 dir = 0; dir < 8; ++dir)
+            {
+                if (PathFinder::s_directions[dir][0] == dx && PathFinder::s_directions[dir][1] == dy)
+                    stepCost = finder.getStepCost(path[i - 1].x(), path[i - 1].y(), dir);
+            }
+            if (stepCost <= 0)
+                return -1;
+            cost += stepCost;
+        }
+        return cost;
+    }
+
+    // Reference Dijkstra on the whole grid
+    s32 getOptimalCost(const PathFinder & finder, s32 startX, s32 startY, s32 endX, s32 endY)
+    {
+        u32 sizeX = finder.getGridSizeX();
+        std::vector<s32> costs(sizeX * finder.getGridSizeY(), -1);
+        typedef std::pair<s32, s32> Entry;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+        costs[startY * sizeX + startX] = 0;
+        open.push(Entry(0, startY * sizeX + startX));
+        while (!open.empty())
+        {
+            Entry e = open.top();
+            open.pop();
+            if (e.first > costs[e.second])
+                continue;
+            s32 x = e.second % sizeX;
+            s32 y = e.second / sizeX;
+            if (x == endX && y == endY)
+                return e.first;
+            for (u32 dir = 0; dir < 8; ++dir)
+            {
+                s32 stepCost = finder.getStepCost(x, y, dir);
+                if (stepCost <= 0)
+                    continue;
+                s32 n = (y + PathFinder::s_directions[dir][1]) * sizeX + x + PathFinder::s_directions[dir][0];
+                if (costs[n] < 0 || costs[n] > e.first + stepCost)
+                {
+                    costs[n] = e.first + stepCost;
+                    open.push(Entry(costs[n], n));
+                }
+            }
+        }
+        return -1;
+    }
+}
+
+void test_pathFinder()
+{
+    const u32 sizeX = 96;
+    const u32 sizeY = 80;
+    std::vector<s8> grid;
+    generateGrid(grid, sizeX, sizeY, 0.25f, 7);
+
+    PathFinder finder(&grid[0], sizeX, sizeY);
+    finder.setSearchLimit(-1);
+    finder.setJumpPointSearch(true);
+
+    Random rng(11);
+    std::vector<Vector2i> path;
+
+    for (u32 pass = 0; pass < 2; ++pass)
+    {
+        finder.setHeavyDiagonals(pass == 0);
+        HierarchicalPathFinder hpa(finder, 10);
+
+        u32 queries = 0, jpsErrors = 0, hpaErrors = 0;
+        f64 hpaOverhead = 0;
+
+        for (u32 i = 0; i < 300; ++i)
+        {
+            // Modify the grid from time to time to test incremental updates
+            if (i % 50 == 25)
+            {
+                s32 x = rng.range(0, sizeX - 8);
+                s32 y = rng.range(0, sizeY - 8);
+                for (s32 j = 0; j < 8; ++j)
+                    grid[(y + j) * sizeX + x + j] = grid[(y + j) * sizeX + x + j] ? 0 : 1;
+                hpa.onCellsChanged(x, y, x + 7, y + 7);
+            }
+
+            s32 sx = rng.range(0, sizeX), sy = rng.range(0, sizeY);
+            s32 ex = rng.range(0, sizeX), ey = rng.range(0, sizeY);
+            if (!finder.isCrossable(sx, sy) || !finder.isCrossable(ex, ey))
+                continue;
+            ++queries;
+
+            s32 optimal = getOptimalCost(finder, sx, sy, ex, ey);
+
+            bool found = finder.findPath(sx, sy, ex, ey, path);
+            s32 cost = found ? getPathCost(finder, path) : -1;
+            if (cost != optimal || (found && (path.front() != Vector2i(sx, sy) || path.back() != Vector2i(ex, ey))))
+                ++jpsErrors;
+
+            found = hpa.findPath(sx, sy, ex, ey, path);
+            cost = found ? getPathCost(finder, path) : -1;
+            if ((cost < 0) != (optimal < 0) || (found && (path.front() != Vector2i(sx, sy) || path.back() != Vector2i(ex, ey))))
+                ++hpaErrors;
+            else if (optimal > 0)
+                hpaOverhead += (f64)(cost - optimal) / (f64)optimal;
+        }
+
+        SN_LOG("PathFinder (heavy diagonals: " << (pass == 0) << "), " << queries << " queries: "
+            << jpsErrors << " JPS errors, " << hpaErrors << " HPA errors, "
+            << "HPA paths " << (100.0 * hpaOverhead / queries) << "% longer than optimal on average");
+    }
+}
+
+void test_pathFinderPerformance()
+{
+    const u32 size = 1024;
+    std::vector<s8> grid;
+    generateGrid(grid, size, size, 0.05f, 3);
+
+    PathFinder finder(&grid[0], size, size);
+    finder.setSearchLimit(-1);
+
+    Clock clock;
+    HierarchicalPathFinder hpa(finder, 16);
+    Time buildTime = clock.restart();
+
+    hpa.onCellsChanged(500, 500, 510, 510);
+    hpa.update();
+    Time updateTime = clock.restart();
+
+    SN_LOG("HierarchicalPathFinder on " << size << "x" << size << ": " << hpa.getAbstractNodeCount() << " abstract nodes, "
+        << "built in " << buildTime.asMilliseconds() << "ms, "
+        << "updated in " << updateTime.asMicroseconds() << "us");
+
+    // Long queries across the map
+    Random rng(5);
+    std::vector<Vector2i> starts, ends;
+    while (starts.size() < 20)
+    {
+        Vector2i a(rng.range(0, 64), rng.range(0, size));
+        Vector2i b(rng.range(size - 64, size), rng.range(0, size));
+        if (finder.isCrossable(a.x(), a.y()) && finder.isCrossable(b.x(), b.y()))
+        {
+            starts.push_back(a);
+            ends.push_back(b);
+        }
+    }
+
+    std::vector<Vector2i> path;
+    u32 found[3] = { 0 };
+    Time times[3];
+
+    for (u32 method = 0; method < 3; ++method)
+    {
+        finder.setJumpPointSearch(method == 1);
+        clock.restart();
+        for (u32 i = 0; i < starts.size(); ++i)
+        {
+            bool ok = method == 2 ?
+                hpa.findPath(starts[i].x(), starts[i].y(), ends[i].x(), ends[i].y(), path) :
+                finder.findPath(starts[i].x(), starts[i].y(), ends[i].x(), ends[i].y(), path);
+            if (ok)
+                ++found[method];
+        }
+        times[method] = clock.restart();
+    }
+
+    SN_LOG(starts.size() << " long queries: "
+        << "A* (weighted, not optimal) " << times[0].asMilliseconds() << "ms (" << found[0] << " found), "
+        << "JPS " << times[1].asMilliseconds() << "ms (" << found[1] << " found), "
+        << "HPA " << times[2].asMilliseconds() << "ms (" << found[2] << " found)");
+}
+
+
+void test_pathQueryService()
+{
+    const u32 size = 256;
+    std::vector<s8> grid;
+    generateGrid(grid, size, size, 0.2f, 13);
+
+    PathFinder finder(&grid[0], size, size);
+    finder.setSearchLimit(-1);
+    finder.setJumpPointSearch(true);
+
+    Random rng(17);
+    std::vector<Vector2i> path, slicedPath;
+
+    // Searches spread over several calls give the same paths as direct ones
+    u32 sliceErrors = 0;
+    for (u32 i = 0; i < 50; ++i)
+    {
+        s32 sx = rng.range(0, size), sy = rng.range(0, size);
+        s32 ex = rng.range(0, size), ey = rng.range(0, size);
+        bool found = finder.findPath(sx, sy, ex, ey, path);
+
+        finder.startSearch(sx, sy, ex, ey);
+        while (finder.resumeSearch(10) == PathFinder::SEARCH_IN_PROGRESS)
+        {}
+        bool slicedFound = finder.getPath(slicedPath);
+        if (found != slicedFound || path != slicedPath)
+            ++sliceErrors;
+    }
+
+    // Flow field costs are the ones of optimal paths
+    Vector2i goal;
+    do
+    {
+        goal = Vector2i(rng.range(0, size), rng.range(0, size));
+    } while (!finder.isCrossable(goal.x(), goal.y()));
+
+    FlowField flowField;
+    flowField.compute(finder, goal.x(), goal.y());
+
+    u32 flowErrors = 0;
+    for (u32 i = 0; i < 50; ++i)
+    {
+        s32 sx = rng.range(0, size), sy = rng.range(0, size);
+        if (!finder.isCrossable(sx, sy))
+            continue;
+        s32 optimal = getOptimalCost(finder, sx, sy, goal.x(), goal.y());
+        bool found = flowField.getPath(sx, sy, path);
+        s32 cost = found ? getPathCost(finder, path) : -1;
+        if (cost != optimal || flowField.getCost(sx, sy) != optimal || (found && path.back() != goal))
+            ++flowErrors;
+    }
+
+    SN_LOG("PathFinder: " << sliceErrors << " errors in sliced searches, " << flowErrors << " errors in flow field");
+
+    // Batch of queries, half of them heading to the same goal
+    std::vector<PathQueryService::Request> requests;
+    for (u32 i = 0; i < 400; ++i)
+    {
+        PathQueryService::Request r(rng.range(0, size), rng.range(0, size), goal.x(), goal.y());
+        if (i % 2)
+        {
+            r.endX = rng.range(0, size);
+            r.endY = rng.range(0, size);
+        }
+        requests.push_back(r);
+    }
+
+    for (u32 threadCount = 1; threadCount <= 4; threadCount *= 4)
+    {
+        PathQueryService service(&grid[0], size, size, threadCount);
+        service.setSearchLimit(-1);
+        service.setJumpPointSearch(true);
+
+        std::vector<PathQueryService::QueryID> ids(requests.size());
+        service.request(&requests[0], requests.size(), &ids[0]);
+
+        Clock clock;
+        u32 frames = 0;
+        while (service.getPendingCount() > 0)
+        {
+            service.update(Time::milliseconds(2));
+            ++frames;
+        }
+        Time time = clock.getElapsedTime();
+
+        u32 errors = 0;
+        for (u32 i = 0; i < ids.size(); ++i)
+        {
+            const PathQueryService::Request & r = requests[i];
+            bool expected = finder.findPath(r.startX, r.startY, r.endX, r.endY, slicedPath);
+            bool found = service.getPath(ids[i], path);
+            if (found != expected)
+                ++errors;
+            else if (found && (getPathCost(finder, path) < 0 || path.front() != Vector2i(r.startX, r.startY) || path.back() != Vector2i(r.endX, r.endY)))
+                ++errors;
+            service.release(ids[i]);
+        }
+
+        SN_LOG("PathQueryService (" << threadCount << " threads): " << requests.size() << " queries in "
+            << time.asMilliseconds() << "ms over " << frames << " updates, " << errors << " errors");
+    }
+}
@@ -0,0 +1,170 @@
+#include "tests.hpp"
+
+#include <core/math/ProbabilityField.h>
+#include <core/system/Clock.h>
+#include <core/util/Log.h>
+#include <cmath>
+
+using namespace sn;
+
+namespace
+{
+    // Largest difference between expected and observed frequencies, relative to the expected ones
+    f64 maxFrequencyError(ProbabilityField & field, const std::vector<f32> & weights, u32 samples)
+    {
+        Random rng(1);
+        std::vector<u32> picks(samples);
+        field.pick(rng, &picks[0], samples);
+
+        std::vector<u32> counts(weights.size(), 0);
+        for (u32 i = 0; i < samples; ++i)
+            ++counts[picks[i]];
+
+        f64 sum = 0;
+        for (u32 i = 0; i < weights.size(); ++i)
+            sum += weights[i];
+
+        f64 maxError = 0;
+        for (u32 i = 0; i < weights.size(); ++i)
+        {
+            f64 expected = weights[i] / sum;
+            f64 observed = (f64)counts[i] / (f64)samples;
+            if (expected == 0)
+            {
+                if (counts[i] != 0)
+                    return 1.0;
+            }
+            else
+            {
+                maxError = std::max(maxError, std::fabs(observed - expected) / expected);
+            }
+        }
+        return maxError;
+    }
+
+    // What pick() used to do
+    u32 pickLinear(const std::vector<f32> & cumul, f32 p)
+    {
+        for (u32 i = 1; i < cumul.size(); ++i)
+        {
+            if (p >= cumul[i - 1] && p < cumul[i])
+                return i - 1;
+        }
+        return cumul.size() - 2;
+    }
+}
+
+void test_probabilityField()
+{
+    std::vector<f32> weights;
+    weights.push_back(1);
+    weights.push_back(2);
+    weights.push_back(0);
+    weights.push_back(5);
+    weights.push_back(0.5f);
+
+    ProbabilityField alias(ProbabilityField::PICK_ALIAS);
+    ProbabilityField cumulative(ProbabilityField::PICK_CUMULATIVE);
+    // Set in reverse order so the field has to grow only once
+    for (u32 i = weights.size(); i-- > 0;)
+    {
+        alias.setFrequency(i, weights[i]);
+        cumulative.setFrequency(i, weights[i]);
+    }
+
+    SN_LOG("ProbabilityField size: " << alias.size() << " (expected " << weights.size() << ")");
+    SN_LOG("ProbabilityField alias max relative error: " << maxFrequencyError(alias, weights, 1000000));
+    SN_LOG("ProbabilityField cumulative max relative error: " << maxFrequencyError(cumulative, weights, 1000000));
+
+    // Batch picks must match single picks
+    Random a(5), b(5);
+    u32 batch[256];
+    alias.pick(a, batch, 256);
+    u32 batchErrors = 0;
+    for (u32 i = 0; i < 256; ++i)
+    {
+        if (alias.pick(b) != batch[i])
+            ++batchErrors;
+    }
+    SN_LOG("ProbabilityField batch errors: " << batchErrors);
+
+    // Events of zero frequency are never picked, whatever the column and the coin
+    u32 zeroErrors = 0;
+    for (u32 seed = 0; seed < 100; ++seed)
+    {
+        Random rng(seed);
+        u32 n = 2 + rng.nextBounded(64);
+        std::vector<f32> sparseWeights(n, 0.f);
+        ProbabilityField sparse(ProbabilityField::PICK_ALIAS);
+        // Only a few events can happen, one at least
+        sparseWeights[rng.nextBounded(n)] = 1.f + rng.nextFloat();
+        for (u32 i = 0; i < n; ++i)
+        {
+            if (rng.nextBounded(4) == 0)
+                sparseWeights[i] = rng.nextFloat() * 1000.f;
+            sparse.setFrequency(i, sparseWeights[i]);
+        }
+        for (u32 i = 0; i < n; ++i)
+        {
+            u32 low = sparse.pick((static_cast<f32>(i) + 0.001f) / n);
+            u32 high = sparse.pick((static_cast<f32>(i) + 0.999f) / n);
+            if (sparseWeights[low] == 0 || sparseWeights[high] == 0)
+                ++zeroErrors;
+        }
+    }
+    SN_LOG("ProbabilityField zero frequency picks: " << zeroErrors);
+}
+
+void test_probabilityFieldPerformance()
+{
+    const u32 eventCount = 4096;
+    const u32 pickCount = 1000000;
+
+    Random rng(123);
+    std::vector<f32> weights(eventCount);
+    rng.fill(&weights[0], eventCount, 0.f, 10.f);
+
+    // Reference linear scan
+    std::vector<f32> cumul(eventCount + 1, 0.f);
+    f32 sum = 0;
+    for (u32 i = 0; i < eventCount; ++i)
+        sum += weights[i];
+    for (u32 i = 0; i < eventCount; ++i)
+        cumul[i + 1] = cumul[i] + weights[i] / sum;
+
+    std::vector<u32> picks(pickCount);
+    u32 checksum = 0;
+
+    Clock clock;
+    for (u32 i = 0; i < pickCount; ++i)
+        checksum += pickLinear(cumul, rng.nextFloat());
+    Time linearTime = clock.restart();
+
+    ProbabilityField cumulative(ProbabilityField::PICK_CUMULATIVE);
+    ProbabilityField alias(ProbabilityField::PICK_ALIAS);
+    for (u32 i = 0; i < eventCount; ++i)
+    {
+        cumulative.setFrequency(i, weights[i]);
+        alias.setFrequency(i, weights[i]);
+    }
+
+    clock.restart();
+    cumulative.compileIfNeeded();
+    Time cumulativeCompileTime = clock.restart();
+    cumulative.pick(rng, &picks[0], pickCount);
+    Time cumulativeTime = clock.restart();
+    checksum += picks[0];
+
+    alias.compileIfNeeded();
+    Time aliasCompileTime = clock.restart();
+    alias.pick(rng, &picks[0], pickCount);
+    Time aliasTime = clock.restart();
+    checksum += picks[0];
+
+    SN_LOG("ProbabilityField, " << pickCount << " picks among " << eventCount << " events:");
+    SN_LOG("  Linear scan: " << linearTime.asMilliseconds() << "ms");
+    SN_LOG("  Binary search: " << cumulativeTime.asMilliseconds() << "ms (compiled in " << cumulativeCompileTime.asMicroseconds() << "us)");
+    SN_LOG("  Alias table: " << aliasTime.asMilliseconds() << "ms (compiled in " << aliasCompileTime.asMicroseconds() << "us)");
+    SN_LOG("  (checksum " << checksum << ")");
+}
+
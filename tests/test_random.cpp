@@ -0,0 +1,97 @@
+#include "tests.hpp"
+
+#include <core/math/Random.h>
+#include <core/pcg/MazeGenerator.h>
+#include <core/system/Clock.h>
+#include <core/util/Log.h>
+#include <vector>
+#include <cstdlib>
+
+using namespace sn;
+
+void test_random()
+{
+    // Reference output of PCG32 seeded with 42 on stream 54
+    const u32 expected[] = { 0xa15c02b7, 0x7b47f409, 0xba1d3330, 0x83d2f293, 0xbfa4784b, 0xcbed606e };
+    Random rng(42, 54);
+    u32 referenceErrors = 0;
+    for (u32 i = 0; i < sizeof(expected) / sizeof(expected[0]); ++i)
+    {
+        if (rng.next() != expected[i])
+            ++referenceErrors;
+    }
+    SN_LOG("Random reference sequence: " << referenceErrors << " errors");
+
+    // Jumping ahead must land where stepping does
+    Random stepped(1234, 5);
+    Random jumped = stepped;
+    for (u32 i = 0; i < 100000; ++i)
+        stepped.next();
+    jumped.advance(100000);
+    SN_LOG("Random advance: " << (stepped == jumped ? "ok" : "FAILED"));
+
+    // Bulk fill must give the same numbers as single calls
+    Random a(77), b(77);
+    std::vector<f32> floats(1000);
+    a.fill(&floats[0], floats.size());
+    u32 fillErrors = 0;
+    for (u32 i = 0; i < floats.size(); ++i)
+    {
+        f32 f = b.nextFloat();
+        if (f != floats[i] || f < 0.f || f >= 1.f)
+            ++fillErrors;
+    }
+    std::vector<s32> ints(1000);
+    a.fill(&ints[0], ints.size(), -3, 4);
+    for (u32 i = 0; i < ints.size(); ++i)
+    {
+        s32 n = b.range(-3, 4);
+        if (n != ints[i] || n < -3 || n >= 4)
+            ++fillErrors;
+    }
+    SN_LOG("Random fill: " << fillErrors << " errors");
+
+    // Streams derived from the same seed must differ
+    Random s0 = Random::forStream(99, 0);
+    Random s1 = Random::forStream(99, 1);
+    Random child = s0.split();
+    u32 sameCount = 0;
+    for (u32 i = 0; i < 1000; ++i)
+    {
+        u32 v0 = s0.next();
+        if (v0 == s1.next() || v0 == child.next())
+            ++sameCount;
+    }
+    SN_LOG("Random streams: " << sameCount << " identical outputs out of 1000");
+
+    // Same generator state, same maze
+    MazeGenerator mazeA(32, 32);
+    MazeGenerator mazeB(32, 32);
+    mazeA.loopChance = 0.2f;
+    mazeB.loopChance = 0.2f;
+    Random mazeRngA(2015), mazeRngB(2015);
+    mazeA.generate(0, 0, mazeRngA);
+    mazeB.generate(0, 0, mazeRngB);
+    u32 mazeDifferences = 0;
+    for (u32 i = 0; i < mazeA.grid.area(); ++i)
+    {
+        if (mazeA.grid[i] != mazeB.grid[i])
+            ++mazeDifferences;
+    }
+    SN_LOG("Random maze reproducibility: " << mazeDifferences << " differences");
+
+    // Speed compared to C rand()
+    const u32 count = 10000000;
+    std::vector<u32> values(count);
+    Clock clock;
+    for (u32 i = 0; i < count; ++i)
+        values[i] = std::rand();
+    Time crandTime = clock.restart();
+    Random fast;
+    fast.fill(&values[0], count);
+    Time fillTime = clock.restart();
+    SN_LOG("Random generation of " << count << " numbers: "
+        << "std::rand " << crandTime.asMilliseconds() << "ms, "
+        << "Random::fill " << fillTime.asMilliseconds() << "ms");
+}
+
@@ -0,0 +1,251 @@
+#include "tests.hpp"
+
+#include <core/util/ShelfPacker.h>
+#include <core/util/SkylinePacker.h>
+#include <core/util/MaxRectsPacker.h>
+#include <core/math/Random.h>
+#include <core/math/Vector2.h>
+#include <core/system/Clock.h>
+#include <core/util/Log.h>
+#include <vector>
+#include <algorithm>
+
+using namespace sn;
+
+namespace
+{
+    struct PackerEntry
+    {
+        const char * name;
+        RectPacker * packer;
+    };
+
+    void createPackers(std::vector<PackerEntry> & out_packers, u32 width, u32 height)
+    {
+        PackerEntry shelf = { "Shelf", new ShelfPacker<u32>(width, height) };
+        PackerEntry skyline = { "Skyline", new SkylinePacker(width, height) };
+        PackerEntry maxRects = { "MaxRects", new MaxRectsPacker(width, height) };
+        out_packers.push_back(shelf);
+        out_packers.push_back(skyline);
+        out_packers.push_back(maxRects);
+    }
+
+    void destroyPackers(std::vector<PackerEntry> & packers)
+    {
+        for (u32 i = 0; i < packers.size(); ++i)
+            delete packers[i].packer;
+        packers.clear();
+    }
+
+    // Checks rectangles are inside the container and don't overlap
+    u32 checkRects(const RectPacker & packer, const std::vector<IntRect> & rects, const char * name)
+    {
+        u32 errors = 0;
+        for (u32 i = 0; i < rects.size(); ++i)
+        {
+            const IntRect & a = rects[i];
+            if (a.x() < 0 || a.y() < 0
+                || a.x() + a.width() > static_cast<s32>(packer.getWidth())
+                || a.y() + a.height() > static_cast<s32>(packer.getHeight()))
+            {
+                SN_ERROR(name << ": rectangle " << a.toString() << " is outside of the container");
+                ++errors;
+            }
+            for (u32 j = i + 1; j < rects.size(); ++j)
+            {
+                const IntRect & b = rects[j];
+                if (a.x() < b.x() + b.width() && b.x() < a.x() + a.width()
+                    && a.y() < b.y() + b.height() && b.y() < a.y() + a.height())
+                {
+                    SN_ERROR(name << ": rectangles " << a.toString() << " and " << b.toString() << " overlap");
+                    ++errors;
+                }
+            }
+        }
+
+        u64 area = 0;
+        for (u32 i = 0; i < rects.size(); ++i)
+            area += rects[i].width() * rects[i].height();
+        if (area != packer.getUsedArea() || rects.size() != packer.getRectCount())
+        {
+            SN_ERROR(name << ": used area or rectangle count doesn't match");
+            ++errors;
+        }
+        return errors;
+    }
+
+    // Glyphs of printable ASCII at a few UI sizes, with one pixel of padding
+    void makeGlyphSizes(std::vector<Vector2u> & out_sizes)
+    {
+        const u32 charSizes[] = { 12, 14, 16, 20, 24, 32 };
+        Random random(42);
+        for (u32 s = 0; s < sizeof(charSizes) / sizeof(charSizes[0]); ++s)
+        {
+            u32 charSize = charSizes[s];
+            for (u32 i = 0; i < 95; ++i)
+            {
+                // Narrow punctuation, lowercase, capitals and descenders
+                u32 w = charSize * random.range(20, 75) / 100 + 2;
+                u32 h = charSize * random.range(30, 100) / 100 + 2;
+                out_sizes.push_back(Vector2u(w, h));
+            }
+        }
+    }
+
+    // Sprite sheet content: mostly small sprites, some large ones
+    void makeSpriteSizes(std::vector<Vector2u> & out_sizes)
+    {
+        Random random(7);
+        for (u32 i = 0; i < 400; ++i)
+        {
+            u32 r = random.range(0, 10);
+            if (r < 7)
+                out_sizes.push_back(Vector2u(random.range(8, 48), random.range(8, 48)));
+            else if (r < 9)
+                out_sizes.push_back(Vector2u(random.range(32, 96), random.range(32, 96)));
+            else
+                out_sizes.push_back(Vector2u(random.range(64, 200), random.range(64, 200)));
+        }
+    }
+
+    void benchmark(const char * setName, const std::vector<Vector2u> & sizes, u32 containerSize, bool sorted)
+    {
+        std::vector<Vector2u> order = sizes;
+        if (sorted)
+        {
+            std::stable_sort(order.begin(), order.end(), [](const Vector2u & a, const Vector2u & b) {
+                return a.y() > b.y();
+            });
+        }
+
+        std::vector<PackerEntry> packers;
+        createPackers(packers, containerSize, containerSize);
+        for (u32 p = 0; p < packers.size(); ++p)
+        {
+            RectPacker & packer = *packers[p].packer;
+
+            // Insert until the first failure, as an atlas page would
+            u32 inserted = 0;
+            s32 usedHeight = 0;
+            Clock clock;
+            for (; inserted < order.size(); ++inserted)
+            {
+                IntRect rect;
+                if (!packer.insert(order[inserted].x(), order[inserted].y(), &rect))
+                    break;
+                usedHeight = std::max(usedHeight, rect.y() + rect.height());
+            }
+            Time time = clock.getElapsedTime();
+
+            SN_LOG(setName << (sorted ? " (sorted)" : " (online)") << ", " << packers[p].name << ": "
+                << inserted << "/" << order.size() << " inserted in " << containerSize << "x" << containerSize << ", "
+                << "occupancy " << static_cast<s32>(packer.getOccupancy() * 100.f) << "%, "
+                << "height used " << usedHeight << ", "
+                << (inserted > 0 ? time.asMicroseconds() / static_cast<f32>(inserted) : 0.f) << "us per insertion");
+        }
+        destroyPackers(packers);
+    }
+}
+
+//------------------------------------------------------------------------------
+void test_rectPackers()
+{
+    u32 errors = 0;
+
+    std::vector<Vector2u> sizes;
+    makeSpriteSizes(sizes);
+
+    std::vector<PackerEntry> packers;
+    createPackers(packers, 512, 512);
+
+    for (u32 p = 0; p < packers.size(); ++p)
+    {
+        RectPacker & packer = *packers[p].packer;
+        const char * name = packers[p].name;
+
+        std::vector<IntRect> rects;
+        for (u32 i = 0; i < sizes.size(); ++i)
+        {
+            IntRect rect;
+            if (packer.insert(sizes[i].x(), sizes[i].y(), &rect))
+                rects.push_back(rect);
+        }
+        errors += checkRects(packer, rects, name);
+
+        // Remove every other rectangle, then fill the room again
+        std::vector<IntRect> kept;
+        for (u32 i = 0; i < rects.size(); ++i)
+        {
+            if (i % 2)
+            {
+                kept.push_back(rects[i]);
+            }
+            else if (!packer.remove(rects[i]))
+            {
+                SN_ERROR(name << ": could not remove " << rects[i].toString());
+                ++errors;
+            }
+        }
+        if (packer.remove(IntRect(1000, 1000, 1, 1)))
+        {
+            SN_ERROR(name << ": removed a rectangle that was never inserted");
+            ++errors;
+        }
+        rects = kept;
+        errors += checkRects(packer, rects, name);
+
+        u32 reinserted = 0;
+        for (u32 i = 0; i < sizes.size(); ++i)
+        {
+            IntRect rect;
+            if (packer.insert(sizes[i].x() / 2 + 1, sizes[i].y() / 2 + 1, &rect))
+            {
+                rects.push_back(rect);
+                ++reinserted;
+            }
+        }
+        errors += checkRects(packer, rects, name);
+
+        // Growing keeps rectangles in place and adds room
+        packer.grow(1024, 1024);
+        IntRect large;
+        if (!packer.insert(400, 400, &large))
+        {
+            SN_ERROR(name << ": could not insert after growing");
+            ++errors;
+        }
+        else
+        {
+            rects.push_back(large);
+        }
+        errors += checkRects(packer, rects, name);
+
+        packer.clear();
+        if (packer.getRectCount() != 0 || packer.getUsedArea() != 0 || !packer.insert(1024, 1024, nullptr))
+        {
+            SN_ERROR(name << ": clear() didn't free the container");
+            ++errors;
+        }
+
+        SN_LOG(name << " packer: " << reinserted << " rectangles reinserted after removal");
+    }
+
+    destroyPackers(packers);
+
+    SN_LOG("Rect packers: " << errors << " errors");
+}
+
+//------------------------------------------------------------------------------
+void test_rectPackersPerformance()
+{
+    std::vector<Vector2u> glyphs;
+    makeGlyphSizes(glyphs);
+    std::vector<Vector2u> sprites;
+    makeSpriteSizes(sprites);
+
+    benchmark("Glyphs", glyphs, 256, false);
+    benchmark("Glyphs", glyphs, 256, true);
+    benchmark("Sprites", sprites, 1024, false);
+    benchmark("Sprites", sprites, 1024, true);
+}
+
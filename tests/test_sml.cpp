@@ -2,6 +2,10 @@
 
 #include <core/sml/SmlParser.h>
 #include <core/sml/SmlWriter.h>
+#include <core/system/Clock.h>
+
+#include <sstream>
+#include <vector>
 
 using namespace sn;
 
@@ -76,3 +80,87 @@ void test_sml()
     writeValue(outputPrettyFileName3, writer, doc3);
 }
 
+
+void test_smlParserPerformance()
+{
+    const std::string inputFileName = "test_data/scene.sml";
+    const u32 copies = 2000;
+    const u32 iterations = 5;
+
+    // Build a big document made of many copies of the test scene
+    std::string source;
+    {
+        std::ifstream ifs(inputFileName.c_str(), std::ios::in | std::ios::binary);
+        if (!ifs.good())
+        {
+            SN_ERROR("Couldn't open file " << inputFileName);
+            return;
+        }
+        std::stringstream ss;
+        ss << ifs.rdbuf();
+        source = ss.str();
+    }
+    std::string text = "[";
+    text.reserve(source.size() * copies + copies + 2);
+    for (u32 i = 0; i < copies; ++i)
+    {
+        if (i != 0)
+            text += ",";
+        text += source;
+    }
+    text += "]";
+
+    const f32 megabytes = static_cast<f32>(text.size() * iterations) / (1024.f * 1024.f);
+    SmlParser parser;
+    Clock clock;
+    Time time;
+
+    // Baseline: the previous parser peeked and read the stream one character at a time.
+    // Doing only that, without parsing anything, gives an upper bound of its speed.
+    u32 checksum = 0;
+    for (u32 i = 0; i < iterations; ++i)
+    {
+        std::istringstream iss(text);
+        clock.restart();
+        while (iss.peek() != EOF)
+            checksum += iss.get();
+        time += clock.getElapsedTime();
+    }
+    SN_LOG("Baseline, reading the stream per character: " << megabytes / time.asSeconds() << " MB/s (checksum " << checksum << ")");
+
+    // Stream input (the whole stream is read into memory first)
+    time = Time();
+    for (u32 i = 0; i < iterations; ++i)
+    {
+        std::istringstream iss(text);
+        Variant doc;
+        clock.restart();
+        parser.parseValue(iss, doc);
+        time += clock.getElapsedTime();
+    }
+    SN_LOG("Stream:  " << megabytes / time.asSeconds() << " MB/s");
+
+    // Read-only buffer
+    time = Time();
+    for (u32 i = 0; i < iterations; ++i)
+    {
+        Variant doc;
+        clock.restart();
+        parser.parseValue(text.data(), text.size(), doc);
+        time += clock.getElapsedTime();
+    }
+    SN_LOG("Buffer:  " << megabytes / time.asSeconds() << " MB/s");
+
+    // In-situ, the buffer gets modified so we parse a copy each time
+    time = Time();
+    for (u32 i = 0; i < iterations; ++i)
+    {
+        std::vector<char> buffer(text.begin(), text.end());
+        Variant doc;
+        clock.restart();
+        parser.parseValueInSitu(&buffer[0], buffer.size(), doc);
+        time += clock.getElapsedTime();
+    }
+    SN_LOG("In-situ: " << megabytes / time.asSeconds() << " MB/s");
+}
+
@@ -0,0 +1,168 @@
+#include "tests.hpp"
+
+#include <modules/tgui/DrawList.h>
+#include <core/system/Clock.h>
+#include <core/util/Log.h>
+#include <vector>
+
+using namespace sn;
+using namespace tgui;
+
+namespace
+{
+    // Stands for a control drawn with a nine-slices background, like buttons and panels
+    void tessellateControl(DrawList & list, const DrawState & state, const IntRect & bounds)
+    {
+        const Vector2u ts(256, 256);
+        const s32 b = 4;
+        const IntRect uv(0, 0, 32, 32);
+        const s32 xs[] = { bounds.minX(), bounds.minX() + b, bounds.maxX() - b, bounds.maxX() };
+        const s32 ys[] = { bounds.minY(), bounds.minY() + b, bounds.maxY() - b, bounds.maxY() };
+        const s32 us[] = { uv.minX(), uv.minX() + b, uv.maxX() - b, uv.maxX() };
+        const s32 vs[] = { uv.minY(), uv.minY() + b, uv.maxY() - b, uv.maxY() };
+        for (u32 y = 0; y < 3; ++y)
+        {
+            for (u32 x = 0; x < 3; ++x)
+            {
+                list.addQuad(state,
+                    IntRect::fromPositionSize(xs[x], ys[y], xs[x + 1] - xs[x], ys[y + 1] - ys[y]),
+                    IntRect::fromPositionSize(us[x], vs[y], us[x + 1] - us[x], vs[y + 1] - vs[y]),
+                    ts, Color8(255, 255, 255, 255));
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void test_tguiDrawList()
+{
+    u32 errors = 0;
+
+    // Fake pointers, the list doesn't use them
+    Material * material = reinterpret_cast<Material*>(0x10);
+    Texture * themeTexture = reinterpret_cast<Texture*>(0x20);
+    Texture * fontTexture = reinterpret_cast<Texture*>(0x30);
+
+    DrawState state;
+    state.material = material;
+    state.texture = themeTexture;
+
+    DrawList list;
+    list.addQuad(state, IntRect(10, 20, 30, 40), IntRect(0, 0, 128, 64), Vector2u(256, 256), Color8(255, 128, 0, 255));
+
+    const std::vector<s16> & positions = list.getPositions();
+    const std::vector<u16> & texCoords = list.getTexCoords();
+    if (list.getVertexCount() != 4 || positions[0] != 10 || positions[1] != 20 || positions[4] != 40 || positions[5] != 60)
+    {
+        SN_ERROR("Quad positions are wrong");
+        ++errors;
+    }
+    if (texCoords[0] != 0 || texCoords[4] != 32768 || texCoords[5] != 16384)
+    {
+        SN_ERROR("Quad texture coordinates are wrong: " << texCoords[4] << ", " << texCoords[5]);
+        ++errors;
+    }
+    if (list.getColors()[3].g != 128)
+    {
+        SN_ERROR("Quad color is wrong");
+        ++errors;
+    }
+
+    // Quads of the same state share a run, the scissor rectangle is ignored when disabled
+    state.scissor = IntRect(1, 2, 3, 4);
+    list.addQuad(state, IntRect(0, 0, 8, 8), IntRect(0, 0, 8, 8), Vector2u(256, 256), Color8());
+    DrawState textState = state;
+    textState.texture = fontTexture;
+    textState.scissorEnabled = true;
+    list.addQuad(textState, IntRect(0, 0, 8, 8), IntRect(0, 0, 8, 8), Vector2u(256, 256), Color8());
+    if (list.getRuns().size() != 2 || list.getRuns()[0].vertexCount != 8 || list.getRuns()[1].firstVertex != 8)
+    {
+        SN_ERROR("Expected 2 runs, got " << list.getRuns().size());
+        ++errors;
+    }
+
+    // Appending merges runs at the junction
+    DrawList frame;
+    frame.append(list);
+    DrawList other;
+    other.addQuad(textState, IntRect(0, 0, 8, 8), IntRect(0, 0, 8, 8), Vector2u(256, 256), Color8());
+    other.addQuad(state, IntRect(0, 0, 8, 8), IntRect(0, 0, 8, 8), Vector2u(256, 256), Color8());
+    frame.append(other);
+    const std::vector<DrawList::Run> & runs = frame.getRuns();
+    if (runs.size() != 3 || runs[1].vertexCount != 8 || runs[2].firstVertex != 16 || frame.getVertexCount() != 20)
+    {
+        SN_ERROR("Runs were not merged when appending");
+        ++errors;
+    }
+
+    // Positions out of range are clamped rather than wrapped
+    DrawList far;
+    far.addQuad(state, IntRect(-40000, 0, 80000, 8), IntRect(0, 0, 8, 8), Vector2u(256, 256), Color8());
+    if (far.getPositions()[0] != -32768 || far.getPositions()[2] != 32767)
+    {
+        SN_ERROR("Positions were not clamped");
+        ++errors;
+    }
+
+    SN_LOG("TGUI draw list: " << errors << " errors");
+}
+
+//------------------------------------------------------------------------------
+void test_tguiDrawListPerformance()
+{
+    // Editor-like UI where a few controls change between frames
+    const u32 controlCount = 5000;
+    const u32 frameCount = 100;
+    const u32 changesPerFrame = 4;
+
+    DrawState state;
+    state.material = reinterpret_cast<Material*>(0x10);
+    state.texture = reinterpret_cast<Texture*>(0x20);
+
+    std::vector<IntRect> bounds(controlCount);
+    for (u32 i = 0; i < controlCount; ++i)
+        bounds[i] = IntRect::fromPositionSize((i % 50) * 40, (i / 50) * 20, 38, 18);
+
+    // Before: every control is tessellated every frame
+    DrawList frame;
+    Clock fullClock;
+    for (u32 f = 0; f < frameCount; ++f)
+    {
+        frame.clear();
+        for (u32 i = 0; i < controlCount; ++i)
+            tessellateControl(frame, state, bounds[i]);
+    }
+    Time fullTime = fullClock.getElapsedTime();
+
+    // After: controls keep their geometry, only invalidated ones are tessellated before assembling the frame
+    std::vector<DrawList> caches(controlCount);
+    for (u32 i = 0; i < controlCount; ++i)
+        tessellateControl(caches[i], state, bounds[i]);
+
+    Clock partialClock;
+    for (u32 f = 0; f < frameCount; ++f)
+    {
+        for (u32 c = 0; c < changesPerFrame; ++c)
+        {
+            u32 i = (f * 97 + c * 1031) % controlCount;
+            caches[i].clear();
+            tessellateControl(caches[i], state, bounds[i]);
+        }
+        frame.clear();
+        for (u32 i = 0; i < controlCount; ++i)
+            frame.append(caches[i]);
+    }
+    Time partialTime = partialClock.getElapsedTime();
+
+    // Float positions (3), texture coordinates (2) and colors (4) used before
+    u32 floatBytes = frame.getVertexCount() * (3 + 2 + 4) * sizeof(f32);
+    u32 packedBytes = frame.getVertexCount() * (2 * sizeof(s16) + 2 * sizeof(u16) + sizeof(Color8));
+
+    SN_LOG("TGUI draw list with " << controlCount << " controls, " << frame.getVertexCount() << " vertices in "
+        << frame.getRuns().size() << " runs: "
+        << "tessellating everything takes " << fullTime.asMicroseconds() / frameCount << "us per frame, "
+        << "tessellating " << changesPerFrame << " controls and assembling takes " << partialTime.asMicroseconds() / frameCount << "us per frame, "
+        << "unchanged frames take no tessellation. "
+        << "Vertices take " << packedBytes << " bytes instead of " << floatBytes);
+}
+
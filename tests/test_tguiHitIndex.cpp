@@ -0,0 +1,198 @@
+#include "tests.hpp"
+
+#include <modules/tgui/HitIndex.h>
+#include <core/math/Random.h>
+#include <core/system/Clock.h>
+#include <core/util/Log.h>
+#include <vector>
+
+using namespace sn;
+using namespace tgui;
+
+namespace
+{
+    struct ControlArea
+    {
+        IntRect bounds;
+        u32 parent;
+    };
+
+    // Areas of an editor-like UI in drawing order: hierarchy rows on the left with an icon and a label,
+    // property cells with a field on the bottom right, docks under them.
+    void makeEditorAreas(std::vector<ControlArea> & out_areas, s32 width, s32 height)
+    {
+        ControlArea dock = { IntRect(0, 0, width / 2, height), HitIndex::NONE };
+        out_areas.push_back(dock);
+        u32 hierarchy = out_areas.size() - 1;
+        for (s32 i = 0; i < 1000; ++i)
+        {
+            ControlArea row = { IntRect(0, i * 18, width / 2, 18), hierarchy };
+            out_areas.push_back(row);
+            u32 r = out_areas.size() - 1;
+            ControlArea icon = { IntRect(2, i * 18 + 2, 14, 14), r };
+            ControlArea label = { IntRect(18, i * 18, width / 2 - 18, 18), r };
+            out_areas.push_back(icon);
+            out_areas.push_back(label);
+        }
+
+        ControlArea viewport = { IntRect(width / 2, 0, width / 2, height / 2), HitIndex::NONE };
+        out_areas.push_back(viewport);
+        ControlArea inspectorDock = { IntRect(width / 2, height / 2, width / 2, height / 2), HitIndex::NONE };
+        out_areas.push_back(inspectorDock);
+        u32 inspector = out_areas.size() - 1;
+        for (s32 i = 0; i < 1000; ++i)
+        {
+            s32 column = i % 2;
+            ControlArea cell = { IntRect(width / 2 + column * width / 4, height / 2 + (i / 2) * 20, width / 4, 20), inspector };
+            out_areas.push_back(cell);
+            ControlArea field = { IntRect(cell.bounds.x() + 2, cell.bounds.y() + 2, cell.bounds.width() - 4, 16), out_areas.size() - 1 };
+            out_areas.push_back(field);
+        }
+    }
+
+    Control * fakeControl(u32 i)
+    {
+        // The index doesn't use them
+        return reinterpret_cast<Control*>(static_cast<size_t>(i + 1) * 16);
+    }
+}
+
+//------------------------------------------------------------------------------
+void test_tguiHitIndex()
+{
+    u32 errors = 0;
+
+    HitIndex index(32);
+    index.clear(Vector2i(200, 100));
+    u32 a = index.add(fakeControl(0), IntRect(0, 0, 200, 100), HitIndex::NONE);
+    u32 b = index.add(fakeControl(1), IntRect(10, 10, 50, 50), a);
+    u32 c = index.add(fakeControl(2), IntRect(40, 40, 100, 50), a);
+
+    // Topmost first
+    if (index.hitTest(Vector2i(20, 20)) != b || index.hitTest(Vector2i(45, 45)) != c || index.hitTest(Vector2i(150, 5)) != a)
+    {
+        SN_ERROR("Hit test didn't return the topmost area");
+        ++errors;
+    }
+    if (index.getParent(c) != a || index.getControl(b) != fakeControl(1))
+    {
+        SN_ERROR("Wrong parent or control");
+        ++errors;
+    }
+
+    // Areas are clipped to the window
+    u32 d = index.add(fakeControl(3), IntRect(-50, 80, 100, 100), HitIndex::NONE);
+    const IntRect & clipped = index.getRect(d);
+    if (clipped.x() != 0 || clipped.y() != 80 || clipped.width() != 50 || clipped.height() != 20)
+    {
+        SN_ERROR("Area was not clipped: " << clipped.toString());
+        ++errors;
+    }
+    if (index.hitTest(Vector2i(250, 5)) != HitIndex::NONE || index.hitTest(Vector2i(-1, 90)) != HitIndex::NONE)
+    {
+        SN_ERROR("Hit outside of the window");
+        ++errors;
+    }
+
+    // Moved areas keep their place in the drawing order
+    index.setBounds(b, IntRect(150, 60, 40, 30));
+    if (index.hitTest(Vector2i(160, 70)) != b || index.hitTest(Vector2i(20, 20)) != a)
+    {
+        SN_ERROR("Area was not moved");
+        ++errors;
+    }
+    index.setBounds(c, IntRect(140, 50, 60, 50));
+    index.setBounds(b, IntRect(150, 60, 40, 30));
+    if (index.hitTest(Vector2i(160, 70)) != c)
+    {
+        SN_ERROR("Moving an area changed the drawing order");
+        ++errors;
+    }
+
+    // Empty areas can't be hit
+    index.setBounds(c, IntRect(140, 50, 0, 50));
+    if (index.hitTest(Vector2i(160, 70)) != b)
+    {
+        SN_ERROR("Empty area was hit");
+        ++errors;
+    }
+
+    SN_LOG("TGUI hit index: " << errors << " errors");
+}
+
+//------------------------------------------------------------------------------
+void test_tguiHitIndexPerformance()
+{
+    const s32 width = 1920;
+    const s32 height = 1080;
+    const u32 moveCount = 100000;
+
+    std::vector<ControlArea> areas;
+    makeEditorAreas(areas, width, height);
+
+    std::vector<Vector2i> positions(moveCount);
+    Random random(42);
+    for (u32 i = 0; i < moveCount; ++i)
+        positions[i] = Vector2i(random.range(0, width), random.range(0, height));
+
+    // Before: every control was tested against the mouse
+    u32 linearHits = 0;
+    Clock linearClock;
+    for (u32 m = 0; m < moveCount; ++m)
+    {
+        for (u32 i = 0; i < areas.size(); ++i)
+        {
+            if (areas[i].bounds.contains(positions[m]))
+                ++linearHits;
+        }
+    }
+    Time linearTime = linearClock.getElapsedTime();
+
+    // After: the topmost control is found from the index
+    HitIndex index;
+    Clock buildClock;
+    index.clear(Vector2i(width, height));
+    for (u32 i = 0; i < areas.size(); ++i)
+        index.add(fakeControl(i), areas[i].bounds, areas[i].parent);
+    Time buildTime = buildClock.getElapsedTime();
+
+    u32 indexHits = 0;
+    Clock indexClock;
+    for (u32 m = 0; m < moveCount; ++m)
+    {
+        // Walk up the hit path like the GUI does
+        for (u32 i = index.hitTest(positions[m]); i != HitIndex::NONE; i = index.getParent(i))
+            ++indexHits;
+    }
+    Time indexTime = indexClock.getElapsedTime();
+
+    if (indexHits != linearHits)
+        SN_ERROR("Hit paths don't match a linear search: " << indexHits << " vs " << linearHits);
+
+    // Moving a dock moves its children too, as when dragging a splitter
+    std::vector<u32> rightAreas;
+    for (u32 i = 0; i < areas.size(); ++i)
+    {
+        if (areas[i].bounds.x() >= width / 2)
+            rightAreas.push_back(i);
+    }
+    Clock moveClock;
+    for (u32 f = 0; f < 100; ++f)
+    {
+        s32 dx = (f % 2) ? 4 : -4;
+        for (u32 j = 0; j < rightAreas.size(); ++j)
+        {
+            ControlArea & area = areas[rightAreas[j]];
+            area.bounds.x() += dx;
+            index.setBounds(rightAreas[j], area.bounds);
+        }
+    }
+    Time moveTime = moveClock.getElapsedTime();
+
+    SN_LOG("TGUI hit index with " << areas.size() << " areas: "
+        << "linear search takes " << linearTime.asMicroseconds() * 1000 / moveCount << "ns per mouse move, "
+        << "index search " << indexTime.asMicroseconds() * 1000 / moveCount << "ns. "
+        << "Building takes " << buildTime.asMicroseconds() << "us, "
+        << "moving " << rightAreas.size() << " areas " << moveTime.asMicroseconds() / 100 << "us");
+}
+
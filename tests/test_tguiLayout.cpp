@@ -0,0 +1,226 @@
+#include "tests.hpp"
+
+#include <modules/tgui/GUI.h>
+#include <modules/tgui/controls/Panel.h>
+#include <modules/tgui/layouts/ListLayout.h>
+#include <modules/tgui/layouts/GridLayout.h>
+#include <modules/tgui/layouts/SplitLayout.h>
+#include <core/reflect/ObjectTypeDatabase.h>
+#include <core/object_types.h>
+#include <core/util/macros.h>
+#include <core/system/Clock.h>
+#include <core/util/Log.h>
+
+using namespace sn;
+using namespace tgui;
+
+namespace
+{
+    void registerLayoutTestTypes()
+    {
+        ObjectTypeDatabase & otb = ObjectTypeDatabase::get();
+        if (otb.isRegistered(SN_TYPESTRING(tgui::Control)))
+            return;
+        if (!otb.isRegistered(SN_TYPESTRING(sn::Entity)))
+            sn::registerObjectTypes(otb);
+        otb.registerType<Control, sn::Entity>(SN_TYPESTRING(tgui::Control));
+        otb.registerType<GUI, Control>(SN_TYPESTRING(tgui::GUI));
+        otb.registerType<Panel, Control>(SN_TYPESTRING(tgui::Panel));
+        otb.registerType<Layout, sn::Object>(SN_TYPESTRING(tgui::Layout));
+        otb.registerType<ListLayout, Layout>(SN_TYPESTRING(tgui::ListLayout));
+        otb.registerType<GridLayout, Layout>(SN_TYPESTRING(tgui::GridLayout));
+        otb.registerType<SplitLayout, Layout>(SN_TYPESTRING(tgui::SplitLayout));
+    }
+
+    Anchors makeAnchors(bool left, bool top, bool right, bool bottom)
+    {
+        Anchors anchors;
+        anchors[TGUI_LEFT] = left;
+        anchors[TGUI_TOP] = top;
+        anchors[TGUI_RIGHT] = right;
+        anchors[TGUI_BOTTOM] = bottom;
+        return anchors;
+    }
+
+    // Hierarchy tree on the left, viewport on the top right, property grid under it.
+    // The tree has 3 controls per row and the grid 2 per cell.
+    GUI * createEditor(u32 rowCount, u32 cellCount, Panel ** out_cell)
+    {
+        GUI * gui = new GUI();
+        gui->setLocalClientBounds(IntRect(0, 0, 1280, 720));
+
+        Panel * hierarchy = gui->createChild<Panel>();
+        Panel * viewport = gui->createChild<Panel>();
+        Panel * inspector = gui->createChild<Panel>();
+
+        SplitLayout * split = new SplitLayout(gui, nullptr, hierarchy);
+        gui->setLayout(split);
+        split->split(viewport, TGUI_RIGHT);
+        DockPath rightPath(1, 1);
+        split->getFromPath(rightPath)->split(inspector, TGUI_BOTTOM);
+
+        hierarchy->setLayout(new ListLayout(hierarchy));
+        for (u32 i = 0; i < rowCount; ++i)
+        {
+            Panel * row = hierarchy->createChild<Panel>();
+            row->setLocalClientBounds(IntRect(0, 0, 100, 18));
+            row->setAnchors(makeAnchors(true, false, true, false));
+
+            Panel * icon = row->createChild<Panel>();
+            icon->setLocalClientBounds(IntRect(2, 2, 14, 14));
+            icon->setAnchors(makeAnchors(true, true, false, false));
+
+            Panel * label = row->createChild<Panel>();
+            label->setLocalClientBounds(IntRect(18, 0, 80, 18));
+            label->setAnchors(makeAnchors(true, true, true, true));
+        }
+
+        GridLayout * grid = new GridLayout(inspector);
+        inspector->setLayout(grid);
+        grid->setColumnCount(2);
+        grid->setColumnScale(0, 0.4f);
+        grid->setColumnScale(1, 0.6f);
+        grid->setIsConstantRowHeight(true);
+        grid->setConstantRowHeight(20);
+        for (u32 i = 0; i < cellCount; ++i)
+        {
+            Panel * cell = inspector->createChild<Panel>();
+            Panel * field = cell->createChild<Panel>();
+            field->setLocalClientBounds(IntRect(0, 0, 50, 20));
+            field->setAnchors(makeAnchors(true, true, true, true));
+            if (out_cell && i == cellCount / 2)
+                *out_cell = cell;
+        }
+
+        return gui;
+    }
+
+    // What layout used to do: every control laid out again, recursively
+    void invalidateLayoutTree(Control & control)
+    {
+        control.invalidateLayout();
+        for (u32 i = 0; i < control.getChildCount(); ++i)
+        {
+            Control * child = Object::cast<Control>(control.getChildByIndex(i));
+            if (child)
+                invalidateLayoutTree(*child);
+        }
+    }
+
+    void resize(GUI & gui, s32 width, s32 height, bool full)
+    {
+        gui.setLocalClientBounds(IntRect(0, 0, width, height));
+        if (full)
+            invalidateLayoutTree(gui);
+        gui.updateLayout();
+    }
+}
+
+//------------------------------------------------------------------------------
+void test_tguiLayout()
+{
+    registerLayoutTestTypes();
+    u32 errors = 0;
+
+    Panel * cell = nullptr;
+    GUI * gui = createEditor(4, 4, &cell);
+    gui->updateLayout();
+
+    Control * hierarchy = gui->getChildControlByIndex(0);
+    Control * row = hierarchy->getChildControlByIndex(0);
+    Control * label = row->getChildControlByIndex(1);
+    if (hierarchy->getSize().x() != 640 || label->getSize().x() != 640)
+    {
+        SN_ERROR("Split or anchors were not applied: " << hierarchy->getSize().x() << ", " << label->getSize().x());
+        ++errors;
+    }
+
+    // Deferred layout is the same as laying out everything
+    resize(*gui, 1000, 600, false);
+    IntRect incremental = label->getLocalClientBounds();
+    Vector2i cellSize = cell->getSize();
+    resize(*gui, 1000, 600, true);
+    if (label->getLocalClientBounds().size() != incremental.size() || cell->getSize() != cellSize)
+    {
+        SN_ERROR("Incremental layout differs from full layout");
+        ++errors;
+    }
+    if (cellSize.x() != 200)
+    {
+        SN_ERROR("Grid column has wrong width: " << cellSize.x());
+        ++errors;
+    }
+
+    // Children of a resized control are laid out in the same pass
+    label->setLocalClientBounds(IntRect(18, 0, 10, 10));
+    row->invalidateLayout();
+    gui->updateLayout();
+    if (label->getSize().x() != 500)
+    {
+        SN_ERROR("Invalidated control was not laid out");
+        ++errors;
+    }
+
+    gui->destroy();
+
+    SN_LOG("TGUI layout: " << errors << " errors");
+}
+
+//------------------------------------------------------------------------------
+void test_tguiLayoutPerformance()
+{
+    registerLayoutTestTypes();
+
+    // Editor-like UI of about 5000 controls
+    const u32 rowCount = 1000;
+    const u32 cellCount = 1000;
+    const u32 frameCount = 100;
+
+    Panel * cell = nullptr;
+    GUI * gui = createEditor(rowCount, cellCount, &cell);
+    gui->updateLayout();
+
+    // Before: the whole tree was laid out on each resize
+    Clock fullClock;
+    for (u32 f = 0; f < frameCount; ++f)
+        resize(*gui, 1280 + (f % 2) * 8, 720, true);
+    Time fullTime = fullClock.getElapsedTime();
+
+    // After: only controls whose size changed are laid out again.
+    // Every row and cell gets wider here, so this costs about as much as laying out everything.
+    Clock widthClock;
+    for (u32 f = 0; f < frameCount; ++f)
+        resize(*gui, 1280 + (f % 2) * 8, 720, false);
+    Time widthTime = widthClock.getElapsedTime();
+
+    // Changing height only resizes containers, rows and cells keep their layout
+    Clock heightClock;
+    for (u32 f = 0; f < frameCount; ++f)
+        resize(*gui, 1280, 720 + (f % 2) * 8, false);
+    Time heightTime = heightClock.getElapsedTime();
+
+    // One property changes, like when editing a value
+    Clock localClock;
+    for (u32 f = 0; f < frameCount; ++f)
+    {
+        cell->invalidateLayout();
+        gui->updateLayout();
+    }
+    Time localTime = localClock.getElapsedTime();
+
+    // Nothing changes
+    Clock idleClock;
+    for (u32 f = 0; f < frameCount; ++f)
+        gui->updateLayout();
+    Time idleTime = idleClock.getElapsedTime();
+
+    SN_LOG("TGUI layout with " << (rowCount * 3 + cellCount * 2) << " controls, per frame: "
+        << "laying out everything takes " << fullTime.asMicroseconds() / frameCount << "us, "
+        << "width resize " << widthTime.asMicroseconds() / frameCount << "us, "
+        << "height resize " << heightTime.asMicroseconds() / frameCount << "us, "
+        << "one control invalidated " << localTime.asMicroseconds() / frameCount << "us, "
+        << "nothing invalidated " << idleTime.asMicroseconds() / frameCount << "us");
+
+    gui->destroy();
+}
+
@@ -0,0 +1,261 @@
+#include "tests.hpp"
+
+#include <modules/tgui/TextWrapper.h>
+#include <core/math/Random.h>
+#include <core/system/Clock.h>
+#include <core/util/Log.h>
+#include <sstream>
+
+using namespace sn;
+using namespace tgui;
+
+namespace
+{
+    bool isSameChange(const TextModel::Change & change, u32 firstLine, u32 oldLineCount, u32 newLineCount)
+    {
+        return change.firstLine == firstLine && change.oldLineCount == oldLineCount && change.newLineCount == newLineCount;
+    }
+
+    bool isSameWrapping(const TextWrapper & a, const TextWrapper & b)
+    {
+        if (a.getWrapCount() != b.getWrapCount())
+            return false;
+        for (u32 i = 0; i < a.getWrapCount(); ++i)
+        {
+            const TextWrapper::LightWrap & wa = a.getLightWrap(i);
+            const TextWrapper::LightWrap & wb = b.getLightWrap(i);
+            if (wa.line != wb.line || wa.end != wb.end)
+                return false;
+        }
+        return true;
+    }
+
+    // Fixed widths, so wrapping can be checked without a font face.
+    // 'W' is wider than the rows it is wrapped into.
+    u32 getTestAdvance(char c)
+    {
+        return c == 'W' ? 100 : 6 + c % 5;
+    }
+
+    // About 2MB of log lines
+    void makeLog(std::string & out_text, u32 lineCount)
+    {
+        std::stringstream ss;
+        for (u32 i = 0; i < lineCount; ++i)
+            ss << "[" << i << "] Loaded asset " << i * 7 << " from the project directory in " << i % 100 << "ms\n";
+        out_text = ss.str();
+    }
+}
+
+//------------------------------------------------------------------------------
+void test_tguiText()
+{
+    u32 errors = 0;
+
+    TextModel model;
+    model.setSource("ab\ncd\nef");
+
+    // Inserting a new line splits the line
+    Vector2u pos(1, 1);
+    TextModel::Change change = model.insertText(pos, "X\nY");
+    if (model.getLineCount() != 4 || model.getLine(1) != "cX\n" || model.getLine(2) != "Yd\n" || !isSameChange(change, 1, 1, 2))
+    {
+        SN_ERROR("Text was not inserted: " << model.getLine(1) << model.getLine(2));
+        ++errors;
+    }
+    if (pos.x() != 1 || pos.y() != 2)
+    {
+        SN_ERROR("Insertion position was not moved after the text");
+        ++errors;
+    }
+
+    // Erasing an end of line joins lines
+    change = model.eraseText(Vector2u(1, 1), Vector2u(0, 2));
+    if (model.getLineCount() != 3 || model.getLine(1) != "cYd\n" || !isSameChange(change, 1, 2, 1))
+    {
+        SN_ERROR("Text was not erased: " << model.getLine(1));
+        ++errors;
+    }
+
+    change = model.appendText("\ngh");
+    if (model.getLineCount() != 4 || model.getLine(2) != "ef\n" || model.getLine(3) != "gh" || !isSameChange(change, 2, 1, 2))
+    {
+        SN_ERROR("Text was not appended");
+        ++errors;
+    }
+
+    TextModel empty;
+    change = empty.appendText("a");
+    if (empty.getLineCount() != 1 || !isSameChange(change, 0, 0, 1))
+    {
+        SN_ERROR("Text was not appended to an empty model");
+        ++errors;
+    }
+
+    // Updating edited lines gives the same wraps as updating everything.
+    // Wrapping is disabled because this test has no font face to measure characters with.
+    Font * font = new Font();
+    FontFormat format;
+    std::string text;
+    makeLog(text, 200);
+    model.setSource(text);
+    TextWrapper incremental(model);
+    TextWrapper full(model);
+    incremental.setWrapMode(TGUI_WRAP_NONE);
+    full.setWrapMode(TGUI_WRAP_NONE);
+    incremental.update(100, *font, format);
+
+    Random random(7);
+    for (u32 i = 0; i < 100; ++i)
+    {
+        u32 line = random.range(0, model.getLineCount() - 1);
+        if (i % 2)
+        {
+            Vector2u at(random.range(0, 5), line);
+            change = model.insertText(at, i % 4 == 1 ? "new\nlines\n" : "word");
+        }
+        else
+        {
+            u32 endLine = line + random.range(0, 2);
+            if (endLine >= model.getLineCount())
+                endLine = model.getLineCount() - 1;
+            change = model.eraseText(Vector2u(1, line), Vector2u(2, endLine));
+        }
+
+        incremental.updateLines(change, 100, *font, format);
+        full.update(100, *font, format);
+        if (!isSameWrapping(incremental, full))
+        {
+            SN_ERROR("Incremental wrapping differs after edit " << i);
+            ++errors;
+            break;
+        }
+    }
+
+    if (full.getWrapFromLine(50) != 50 || full.getWrapFromLineAndColumn(50, 3) != 50)
+    {
+        SN_ERROR("Wrong wrap found from line");
+        ++errors;
+    }
+
+    // Character wrapping carries the width of the character starting a row,
+    // and gives its own row to a character wider than the area
+    TextModel chars;
+    chars.setSource("aaaaaaaaaa\naWa");
+    TextWrapper charWrapper(chars);
+    charWrapper.setWrapMode(TGUI_WRAP_CHARACTERS);
+    TextWrapper::CharAdvance tens = [](char c) { return c == 'W' ? 100u : 10u; };
+    charWrapper.update(35, tens);
+    const u32 expectedEnds[] = { 3, 6, 9, 11, 1, 2, 3 };
+    const u32 expectedLines[] = { 0, 0, 0, 0, 1, 1, 1 };
+    bool sameWraps = charWrapper.getWrapCount() == 7;
+    for (u32 i = 0; sameWraps && i < 7; ++i)
+    {
+        const TextWrapper::LightWrap & wrap = charWrapper.getLightWrap(i);
+        sameWraps = wrap.end == expectedEnds[i] && wrap.line == expectedLines[i];
+    }
+    if (!sameWraps)
+    {
+        SN_ERROR("Wrong character wrapping, got " << charWrapper.getWrapCount() << " rows");
+        ++errors;
+    }
+
+    // Edits changing how many rows lines take
+    model.setSource(text);
+    incremental.setWrapMode(TGUI_WRAP_CHARACTERS);
+    full.setWrapMode(TGUI_WRAP_CHARACTERS);
+    incremental.update(100, getTestAdvance);
+    u32 wrapCount = incremental.getWrapCount();
+    for (u32 i = 0; i < 200; ++i)
+    {
+        u32 line = random.range(0, model.getLineCount() - 1);
+        Vector2u at(random.range(0, 5), line);
+        switch (i % 4)
+        {
+        case 0:
+            change = model.insertText(at, "a long insertion taking rows of its own");
+            break;
+        case 1:
+            change = model.insertText(at, "W\nsplit\nWW");
+            break;
+        default:
+        {
+            u32 endLine = line + random.range(0, 2);
+            if (endLine >= model.getLineCount())
+                endLine = model.getLineCount() - 1;
+            change = model.eraseText(Vector2u(0, line), Vector2u(random.range(0, 30), endLine));
+            break;
+        }
+        }
+
+        incremental.updateLines(change, 100, getTestAdvance);
+        full.update(100, getTestAdvance);
+        if (!isSameWrapping(incremental, full))
+        {
+            SN_ERROR("Incremental character wrapping differs after edit " << i);
+            ++errors;
+            break;
+        }
+    }
+    if (incremental.getWrapCount() <= model.getLineCount() || incremental.getWrapCount() == wrapCount)
+    {
+        SN_ERROR("Character wrapping test didn't change row counts");
+        ++errors;
+    }
+
+    font->release();
+
+    SN_LOG("TGUI text: " << errors << " errors");
+}
+
+//------------------------------------------------------------------------------
+void test_tguiTextPerformance()
+{
+    const u32 lineCount = 30000;
+    const u32 editCount = 1000;
+
+    std::string text;
+    makeLog(text, lineCount);
+
+    TextModel model;
+    model.setSource(text);
+    Font * font = new Font();
+    FontFormat format;
+
+    TextWrapper wrapper(model);
+    wrapper.setWrapMode(TGUI_WRAP_NONE);
+    wrapper.update(800, *font, format);
+
+    // Before: the whole text was wrapped again after each edit
+    Clock fullClock;
+    for (u32 i = 0; i < editCount; ++i)
+    {
+        Vector2u at(0, (i * 31) % model.getLineCount());
+        model.insertText(at, "x");
+        wrapper.update(800, *font, format);
+    }
+    Time fullTime = fullClock.getElapsedTime();
+
+    // After: only the edited line
+    Clock editClock;
+    for (u32 i = 0; i < editCount; ++i)
+    {
+        Vector2u at(0, (i * 31) % model.getLineCount());
+        wrapper.updateLines(model.insertText(at, "x"), 800, *font, format);
+    }
+    Time editTime = editClock.getElapsedTime();
+
+    // Appending to a log only adds wraps at the end
+    Clock appendClock;
+    for (u32 i = 0; i < editCount; ++i)
+        wrapper.updateLines(model.appendText("Appended line\n"), 800, *font, format);
+    Time appendTime = appendClock.getElapsedTime();
+
+    SN_LOG("TGUI text of " << text.size() / 1024 << "KB, " << lineCount << " lines, per edit: "
+        << "wrapping everything takes " << fullTime.asMicroseconds() / editCount << "us, "
+        << "wrapping the edited line " << editTime.asMicroseconds() * 1000 / editCount << "ns, "
+        << "appending a line " << appendTime.asMicroseconds() * 1000 / editCount << "ns");
+
+    font->release();
+}
+
@@ -1,6 +1,11 @@
 #include "tests.hpp"
 
 #include <core/util/Variant.h>
+#include <core/sml/SmlParser.h>
+#include <core/system/Clock.h>
+
+#include <fstream>
+#include <sstream>
 
 using namespace sn;
 
@@ -67,5 +72,65 @@ void test_variant()
 	}
 
 	printVariant(doc, std::cout);
+
+	// Resetting to a plain type gives its default value, not what was stored before
+	Variant n = 3.5f;
+	n.reset(SN_VT_INT);
+	if (n.getInt() != 0)
+		std::cout << "ERROR: reset int is " << n.getInt() << std::endl;
+	n = "some text";
+	n.reset(SN_VT_BOOL);
+	if (n.getBool())
+		std::cout << "ERROR: reset bool is true" << std::endl;
+}
+
+void test_variantParseAndDestroy()
+{
+	const std::string inputFileName = "test_data/scene.sml";
+	const u32 copies = 2000;
+	const u32 iterations = 10;
+
+	// Build a big document made of many copies of the test scene
+	std::string text;
+	{
+		std::ifstream ifs(inputFileName.c_str(), std::ios::in | std::ios::binary);
+		if (!ifs.good())
+		{
+			SN_ERROR("Couldn't open file " << inputFileName);
+			return;
+		}
+		std::stringstream ss;
+		ss << ifs.rdbuf();
+		const std::string source = ss.str();
+		text = "[";
+		for (u32 i = 0; i < copies; ++i)
+		{
+			if (i != 0)
+				text += ",";
+			text += source;
+		}
+		text += "]";
+	}
+
+	SmlParser parser;
+	Clock clock;
+	Time parseTime;
+	Time destroyTime;
+
+	for (u32 i = 0; i < iterations; ++i)
+	{
+		Variant * doc = new Variant();
+
+		clock.restart();
+		parser.parseValue(text.data(), text.size(), *doc);
+		parseTime += clock.restart();
+
+		delete doc;
+		destroyTime += clock.restart();
+	}
+
+	std::cout << "sizeof(Variant): " << sizeof(Variant) << std::endl;
+	std::cout << "Parse:   " << parseTime.asMilliseconds() / static_cast<s32>(iterations) << " ms" << std::endl;
+	std::cout << "Destroy: " << destroyTime.asMilliseconds() / static_cast<s32>(iterations) << " ms" << std::endl;
 }
 
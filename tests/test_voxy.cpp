@@ -0,0 +1,462 @@
+#include "tests.hpp"
+
+#include <modules/voxy/MeshBuilder.h>
+#include <modules/voxy/TerrainStreamer.h>
+#include <core/math/noise.h>
+#include <core/math/Random.h>
+#include <core/system/Clock.h>
+#include <core/system/Thread.h>
+#include <core/util/Log.h>
+#include <map>
+#include <algorithm>
+
+using namespace sn;
+using namespace voxy;
+
+namespace
+{
+    // Hills of stone with grass on top, and a few floating blocks
+    void generateTerrain(Terrain & terrain, s32 sizeX, s32 sizeY, s32 sizeZ)
+    {
+        for (s32 z = 0; z < sizeZ; ++z)
+        {
+            for (s32 x = 0; x < sizeX; ++x)
+            {
+                f32 n = noise2dPerlin(static_cast<f32>(x), static_cast<f32>(z), 131, 4, 0.5f, 64.f);
+                s32 height = std::min(sizeY - 1, std::max(1, static_cast<s32>(sizeY * (0.4f + 0.3f * n))));
+                for (s32 y = 0; y < height; ++y)
+                {
+                    bool top = y == height - 1;
+                    terrain.setVoxel(ATTRIB_TYPE, x, y, z, top ? 2 : 1);
+                    // Some stones have another color
+                    u8 color = top ? 3 : (Random::hash(5, x, y + z * sizeY) % 10 == 0 ? 2 : 1);
+                    terrain.setVoxel(ATTRIB_COLOR, x, y, z, color);
+                }
+                if (Random::hash(9, x, z) % 50 == 0)
+                {
+                    terrain.setVoxel(ATTRIB_TYPE, x, sizeY - 4, z, 1);
+                    terrain.setVoxel(ATTRIB_COLOR, x, sizeY - 4, z, 1);
+                }
+            }
+        }
+        terrain.optimize();
+    }
+
+    // Key of a unit face: voxel position in the chunk and direction (0..5 for -X,+X,-Y,+Y,-Z,+Z)
+    typedef std::map<std::vector<s32>, u32> FaceMap;
+
+    // Lists visible faces of the central chunk one by one, with their color
+    void getExpectedFaces(const ChunkNeighborhood & chunks, const MeshBuilder & builder, FaceMap & out_faces)
+    {
+        const s32 offsets[6][3] = { {-1,0,0}, {1,0,0}, {0,-1,0}, {0,1,0}, {0,0,-1}, {0,0,1} };
+        for (s32 z = 0; z < (s32)CHUNK_SIZE; ++z)
+        {
+            for (s32 y = 0; y < (s32)CHUNK_SIZE; ++y)
+            {
+                for (s32 x = 0; x < (s32)CHUNK_SIZE; ++x)
+                {
+                    if (chunks.get(ATTRIB_TYPE, x, y, z) == 0)
+                        continue;
+                    for (s32 dir = 0; dir < 6; ++dir)
+                    {
+                        if (chunks.get(ATTRIB_TYPE, x + offsets[dir][0], y + offsets[dir][1], z + offsets[dir][2]) != 0)
+                            continue;
+                        std::vector<s32> key = { x, y, z, dir };
+                        out_faces[key] = builder.getColor(chunks.get(ATTRIB_COLOR, x, y, z)).asRGBA32();
+                    }
+                }
+            }
+        }
+    }
+
+    // Splits the quads of a mesh back into unit faces
+    u32 getMeshFaces(const VoxelMeshData & data, FaceMap & out_faces)
+    {
+        u32 errors = 0;
+        for (u32 q = 0; q < data.getVertexCount() / 4; ++q)
+        {
+            const u8 * p = &data.positions[q * 16];
+            const s8 * n = &data.normals[q * 16];
+            s32 d = n[0] != 0 ? 0 : n[1] != 0 ? 1 : 2;
+            s32 side = n[d] > 0 ? 1 : 0;
+
+            s32 minPos[3] = { 255, 255, 255 };
+            s32 maxPos[3] = { 0, 0, 0 };
+            for (u32 c = 0; c < 4; ++c)
+            {
+                for (u32 k = 0; k < 3; ++k)
+                {
+                    minPos[k] = std::min<s32>(minPos[k], p[c * 4 + k]);
+                    maxPos[k] = std::max<s32>(maxPos[k], p[c * 4 + k]);
+                }
+            }
+
+            // Faces of positive sides are on the far plane of their voxel
+            s32 layer = minPos[d] - side;
+            maxPos[d] = minPos[d] + 1;
+            for (s32 z = minPos[2]; z < maxPos[2]; ++z)
+            {
+                for (s32 y = minPos[1]; y < maxPos[1]; ++y)
+                {
+                    for (s32 x = minPos[0]; x < maxPos[0]; ++x)
+                    {
+                        std::vector<s32> key = { x, y, z, d * 2 + side };
+                        key[d] = layer;
+                        if (out_faces.count(key))
+                            ++errors;
+                        out_faces[key] = data.colors[q * 4].asRGBA32();
+                    }
+                }
+            }
+        }
+        return errors;
+    }
+
+    u32 checkMesh(const ChunkNeighborhood & chunks, const MeshBuilder & builder, const VoxelMeshData & data, u32 & faceCount, u32 & quadCount)
+    {
+        FaceMap expected;
+        getExpectedFaces(chunks, builder, expected);
+        FaceMap actual;
+        u32 errors = getMeshFaces(data, actual);
+        if (expected != actual)
+            ++errors;
+
+        faceCount += expected.size();
+        quadCount += data.getVertexCount() / 4;
+        return errors;
+    }
+}
+
+void test_voxyTerrain()
+{
+    u32 errors = 0;
+
+    Terrain terrain;
+    terrain.setDefaultValue(ATTRIB_TYPE, 1);
+
+    Random rng(12);
+    std::map<std::vector<s32>, u8> reference;
+    reference[std::vector<s32>(3, 0)] = 1;
+    for (u32 i = 0; i < 20000; ++i)
+    {
+        std::vector<s32> pos = { rng.range(-40, 40), rng.range(-20, 20), rng.range(-40, 40) };
+        u8 value = rng.range(0, 4);
+        terrain.setVoxel(ATTRIB_TYPE, pos[0], pos[1], pos[2], value);
+        reference[pos] = value;
+        // Some channels get compressed while being edited
+        if (i % 5000 == 0)
+            terrain.compress();
+    }
+
+    // Copies share chunks until one of them is modified
+    Terrain snapshot = terrain;
+    terrain.setVoxel(ATTRIB_TYPE, 0, 0, 0, 200);
+    if (snapshot.getVoxel(ATTRIB_TYPE, 0, 0, 0) == 200 || terrain.getVoxel(ATTRIB_TYPE, 0, 0, 0) != 200)
+        ++errors;
+    terrain.setVoxel(ATTRIB_TYPE, 0, 0, 0, reference[std::vector<s32>(3, 0)]);
+
+    terrain.compress();
+    for (auto it = reference.begin(); it != reference.end(); ++it)
+    {
+        const std::vector<s32> & pos = it->first;
+        if (terrain.getVoxel(ATTRIB_TYPE, pos[0], pos[1], pos[2]) != it->second)
+            ++errors;
+        if (snapshot.getVoxel(ATTRIB_TYPE, pos[0], pos[1], pos[2]) != it->second)
+            ++errors;
+    }
+    if (terrain.getVoxel(ATTRIB_TYPE, 1000, -1000, 5) != 1)
+        ++errors;
+
+    // Reads across chunk borders
+    ChunkNeighborhood chunks;
+    chunks.load(terrain, Vector3i(-1, 0, 0));
+    u8 padded[MeshBuilder::PADDED_VOLUME];
+    chunks.copyPadded(ATTRIB_TYPE, 1, padded);
+    const s32 ox = -(s32)CHUNK_SIZE;
+    const s32 ps = MeshBuilder::PADDED_SIZE;
+    for (s32 z = -1; z <= (s32)CHUNK_SIZE; ++z)
+    {
+        for (s32 y = -1; y <= (s32)CHUNK_SIZE; ++y)
+        {
+            for (s32 x = -1; x <= (s32)CHUNK_SIZE; ++x)
+            {
+                u8 expected = terrain.getVoxel(ATTRIB_TYPE, ox + x, y, z);
+                if (chunks.get(ATTRIB_TYPE, x, y, z) != expected || padded[(x + 1) + ps * ((y + 1) + ps * (z + 1))] != expected)
+                    ++errors;
+            }
+        }
+    }
+
+    TerrainMemoryStats stats;
+    terrain.getMemoryStats(stats);
+    SN_LOG("Voxy terrain: " << errors << " errors, "
+        << stats.chunkCount << " chunks (" << stats.sharedChunkCount << " shared), "
+        << stats.byteCount << " bytes instead of " << stats.uncompressedByteCount);
+}
+
+void test_voxyMeshBuilder()
+{
+    u32 errors = 0;
+    u32 faceCount = 0;
+    u32 quadCount = 0;
+
+    MeshBuilder builder;
+    for (u32 i = 0; i < 8; ++i)
+        builder.setColor(i, Color8(i * 30, 255 - i * 30, 128));
+
+    // Hills, where most faces can be merged
+    Terrain hills;
+    generateTerrain(hills, 48, 48, 48);
+    std::vector<Vector3i> positions;
+    hills.getChunkPositions(positions);
+
+    for (u32 seed = 0; seed < 4 + positions.size(); ++seed)
+    {
+        ChunkNeighborhood chunks;
+        VoxelMeshData data;
+
+        if (seed >= 4)
+        {
+            chunks.load(hills, positions[seed - 4]);
+            builder.process(chunks, data);
+            errors += checkMesh(chunks, builder, data, faceCount, quadCount);
+            continue;
+        }
+
+        // Random voxels of a few types and colors, denser for some seeds so faces can be merged
+        Terrain terrain;
+        Random rng(seed);
+        u32 fillChance = 30 + seed * 20;
+        for (s32 z = -(s32)CHUNK_SIZE; z < 2 * (s32)CHUNK_SIZE; ++z)
+        {
+            for (s32 y = -(s32)CHUNK_SIZE; y < 2 * (s32)CHUNK_SIZE; ++y)
+            {
+                for (s32 x = -(s32)CHUNK_SIZE; x < 2 * (s32)CHUNK_SIZE; ++x)
+                {
+                    if (rng.range(0, 100) < (s32)fillChance)
+                    {
+                        terrain.setVoxel(ATTRIB_TYPE, x, y, z, rng.range(1, 3));
+                        terrain.setVoxel(ATTRIB_COLOR, x, y, z, rng.range(0, 2));
+                    }
+                }
+            }
+        }
+
+        chunks.load(terrain, Vector3i(0, 0, 0));
+        builder.process(chunks, data);
+        errors += checkMesh(chunks, builder, data, faceCount, quadCount);
+    }
+
+    SN_LOG("Voxy mesh builder: " << errors << " errors, " << faceCount << " faces merged into " << quadCount << " quads");
+}
+
+void test_voxyMeshBuilderPerformance()
+{
+    const s32 sizeX = 256;
+    const s32 sizeY = 64;
+    const s32 sizeZ = 256;
+
+    Terrain terrain;
+    generateTerrain(terrain, sizeX, sizeY, sizeZ);
+
+    std::vector<Vector3i> positions;
+    terrain.getChunkPositions(positions);
+
+    MeshBuilder builder;
+    ChunkNeighborhood chunks;
+    VoxelMeshData data;
+    u32 triangleCount = 0;
+    u32 vertexCount = 0;
+    u32 faceCount = 0;
+
+    Time loadTime;
+    Clock clock;
+    for (u32 i = 0; i < positions.size(); ++i)
+    {
+        Clock loadClock;
+        chunks.load(terrain, positions[i]);
+        loadTime += loadClock.getElapsedTime();
+
+        builder.process(chunks, data);
+        triangleCount += data.getTriangleCount();
+        vertexCount += data.getVertexCount();
+    }
+    Time time = clock.getElapsedTime();
+
+    // What meshing without merging faces would give
+    const s32 offsets[6][3] = { {-1,0,0}, {1,0,0}, {0,-1,0}, {0,1,0}, {0,0,-1}, {0,0,1} };
+    for (s32 z = 0; z < sizeZ; ++z)
+    {
+        for (s32 y = 0; y < sizeY; ++y)
+        {
+            for (s32 x = 0; x < sizeX; ++x)
+            {
+                if (terrain.getVoxel(ATTRIB_TYPE, x, y, z) == 0)
+                    continue;
+                for (u32 dir = 0; dir < 6; ++dir)
+                    faceCount += terrain.getVoxel(ATTRIB_TYPE, x + offsets[dir][0], y + offsets[dir][1], z + offsets[dir][2]) == 0;
+            }
+        }
+    }
+
+    TerrainMemoryStats stats;
+    terrain.getMemoryStats(stats);
+
+    f32 chunkCount = static_cast<f32>(positions.size());
+    SN_LOG("Voxy meshing of " << positions.size() << " chunks: "
+        << time.asMicroseconds() / chunkCount << "us per chunk (including "
+        << loadTime.asMicroseconds() / chunkCount << "us to gather neighbors), "
+        << triangleCount / chunkCount << " triangles per chunk, "
+        << triangleCount << " triangles in total instead of " << faceCount * 2 << " without merging, "
+        << vertexCount * 12 << " bytes of vertices, terrain takes " << stats.byteCount << " bytes");
+}
+
+void test_voxyTerrainStreamer()
+{
+    u32 errors = 0;
+
+    Terrain terrain;
+    TerrainStreamer streamer(terrain, 2);
+    streamer.setRadius(4);
+    streamer.setUnloadMargin(1);
+    streamer.setMaxUploadsPerFrame(4);
+    streamer.setColor(1, Color8(128, 128, 128));
+    streamer.setColor(3, Color8(0, 255, 0));
+
+    // Hills between y = 0 and y = 32
+    streamer.setGenerator([](Chunk & chunk)
+    {
+        const Vector3i origin = chunk.getPosition() * CHUNK_SIZE;
+        for (u32 z = 0; z < CHUNK_SIZE; ++z)
+        {
+            for (u32 x = 0; x < CHUNK_SIZE; ++x)
+            {
+                f32 n = noise2dPerlin(static_cast<f32>(origin.x() + x), static_cast<f32>(origin.z() + z), 131, 4, 0.5f, 64.f);
+                s32 height = static_cast<s32>(16 + 12 * n);
+                for (u32 y = 0; y < CHUNK_SIZE; ++y)
+                {
+                    s32 gy = origin.y() + y;
+                    if (gy < height)
+                    {
+                        chunk.set(ATTRIB_TYPE, x, y, z, 1);
+                        chunk.set(ATTRIB_COLOR, x, y, z, gy == height - 1 ? 3 : 1);
+                    }
+                }
+            }
+        }
+    });
+
+    u32 unloadCount = 0;
+    streamer.setUnloadCallback([&unloadCount](const Chunk &) { ++unloadCount; });
+
+    std::map<Vector3i, Mesh*> meshes;
+    streamer.setMeshCallback([&meshes](const Vector3i & position, Mesh * mesh)
+    {
+        if (mesh)
+            meshes[position] = mesh;
+        else
+            meshes.erase(position);
+    });
+
+    // Move the viewer, as a game would do
+    Time maxUpdateTime;
+    Time totalUpdateTime;
+    u32 frameCount = 0;
+    u32 maxUploadCount = 0;
+    auto runFrame = [&]()
+    {
+        Clock clock;
+        streamer.update();
+        Time time = clock.getElapsedTime();
+        totalUpdateTime += time;
+        if (time > maxUpdateTime)
+            maxUpdateTime = time;
+        maxUploadCount = std::max(maxUploadCount, streamer.getLastUploadCount());
+        ++frameCount;
+        Thread::sleep(Time::milliseconds(1));
+    };
+
+    Clock streamClock;
+    for (s32 x = 0; x < 200; x += 2)
+    {
+        streamer.setViewerPosition(Vector3f(static_cast<f32>(x), 24, 0));
+        runFrame();
+    }
+    while (streamer.getPendingCount() > 0)
+        runFrame();
+    Time streamTime = streamClock.getElapsedTime();
+
+    if (maxUploadCount > 4)
+        ++errors;
+
+    // Only chunks around the viewer are loaded, and all of them are
+    const Vector3i viewerChunk = Terrain::toChunkPosition(198, 24, 0);
+    std::vector<Vector3i> positions;
+    terrain.getChunkPositions(positions);
+    u32 inRangeCount = 0;
+    for (u32 i = 0; i < positions.size(); ++i)
+    {
+        Vector3i d = positions[i] - viewerChunk;
+        s32 distance2 = d.x() * d.x() + d.y() * d.y() + d.z() * d.z();
+        if (distance2 > 5 * 5)
+            ++errors;
+        if (distance2 <= 4 * 4)
+            ++inRangeCount;
+    }
+    u32 expectedInRange = 0;
+    for (s32 z = -4; z <= 4; ++z)
+    {
+        for (s32 y = -4; y <= 4; ++y)
+        {
+            for (s32 x = -4; x <= 4; ++x)
+                expectedInRange += x * x + y * y + z * z <= 4 * 4;
+        }
+    }
+    if (inRangeCount != expectedInRange)
+        ++errors;
+
+    // Meshes match what a builder gives on the final terrain
+    MeshBuilder builder;
+    builder.setColor(1, Color8(128, 128, 128));
+    builder.setColor(3, Color8(0, 255, 0));
+    auto checkMeshes = [&]()
+    {
+        for (u32 i = 0; i < positions.size(); ++i)
+        {
+            Vector3i d = positions[i] - viewerChunk;
+            if (d.x() * d.x() + d.y() * d.y() + d.z() * d.z() > 4 * 4)
+                continue;
+
+            ChunkNeighborhood chunks;
+            VoxelMeshData data;
+            chunks.load(terrain, positions[i]);
+            builder.process(chunks, data);
+
+            Mesh * mesh = streamer.getMesh(positions[i]);
+            u32 indexCount = mesh ? mesh->getIndices().size() : 0;
+            if (indexCount != data.indices.size())
+                ++errors;
+
+            auto it = meshes.find(positions[i]);
+            if ((it != meshes.end() ? it->second : nullptr) != mesh)
+                ++errors;
+        }
+    };
+    checkMeshes();
+
+    // Digging at a chunk corner updates the chunks sharing it
+    for (s32 y = 0; y < 32; ++y)
+    {
+        terrain.setVoxel(ATTRIB_TYPE, 192, y, 0, 0);
+        streamer.invalidateVoxel(192, y, 0);
+    }
+    while (streamer.getPendingCount() > 0)
+        runFrame();
+    checkMeshes();
+
+    SN_LOG("Voxy terrain streamer: " << errors << " errors, " << positions.size() << " chunks loaded, "
+        << unloadCount << " unloaded, " << meshes.size() << " meshes, "
+        << frameCount << " frames in " << streamTime.asMilliseconds() << "ms, "
+        << "update takes " << totalUpdateTime.asMicroseconds() / frameCount << "us on average, "
+        << maxUpdateTime.asMicroseconds() << "us at most");
+}
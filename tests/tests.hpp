@@ -5,11 +5,49 @@ void test_reflection();
 void test_stringSplit();
 void test_hashes();
 void test_fileWatcher();
+void test_mpscQueue();
 void test_variant();
+void test_variantParseAndDestroy();
 void test_squirrelBinding();
 void test_sparseArrayPerformance();
 void test_sml();
+void test_smlParserPerformance();
 void test_guid();
+void test_noise();
+void test_noisePerformance();
+void test_random();
+void test_packedEntity();
+void test_probabilityField();
+void test_probabilityFieldPerformance();
+void test_pathFinder();
+void test_pathFinderPerformance();
+void test_pathQueryService();
+void test_arrayLayouts();
+void test_arrayLayoutsPerformance();
+void test_autoTiler();
+void test_autoTilerPerformance();
+void test_voxyTerrain();
+void test_voxyMeshBuilder();
+void test_voxyMeshBuilderPerformance();
+void test_voxyTerrainStreamer();
+void test_distanceField();
+void test_distanceFieldPerformance();
+void test_rectPackers();
+void test_rectPackersPerformance();
+void test_tguiDrawList();
+void test_tguiDrawListPerformance();
+void test_tguiLayout();
+void test_tguiLayoutPerformance();
+void test_tguiHitIndex();
+void test_tguiHitIndexPerformance();
+void test_tguiText();
+void test_tguiTextPerformance();
+void test_imageKernels();
+void test_imageKernelsPerformance();
+void test_blockCompression();
+void test_blockCompressionPerformance();
+void test_imageDecode();
+void test_imageDecodePerformance();
 
 #endif // __HEADER_TEST_REFLECTION__
 